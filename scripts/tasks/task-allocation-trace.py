@@ -0,0 +1,128 @@
+#! /usr/bin/env python3
+import argparse
+import struct
+import time
+import rtmidi
+import util
+
+# main Deluge sysex header, debug namespace, allocation trace command
+TRACE_COMMAND = [0xF0, 0x00, 0x21, 0x7B, 0x01, 0x03, 0x05]
+TRACE_REPLY = [0xF0, 0x00, 0x21, 0x7B, 0x01, 0x03, 0x45]
+RECORD_SIZE = 20
+
+
+def argparser():
+    parser = argparse.ArgumentParser(
+        prog="allocation-trace",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        description="Record and download memory allocation traces from a Deluge",
+        epilog="""\nThe firmware must be built with ENABLE_ALLOCATION_TRACE.
+                  usage example: dbt allocation-trace start
+                  ... load a song on the Deluge ...
+                  dbt allocation-trace dump trace.bin
+                  then replay it with the AllocationTraceReplay test tool""",
+        exit_on_error=False,
+    )
+    parser.group = "Development"
+    parser.add_argument(
+        "action",
+        choices=["start", "stop", "dump", "save"],
+        help="""start or stop recording, dump the trace to a file on this computer,
+                or save it to ALLOCATION_TRACE.BIN on the SD card""",
+    )
+    parser.add_argument(
+        "file", nargs="?", default="allocation_trace.bin", help="output file for dump"
+    )
+    parser.add_argument(
+        "-p",
+        "--ports",
+        nargs="*",
+        type=int,
+        default=[],
+        help="""MIDI output and input port numbers. If not given, the first ports whose
+                names start with "Deluge" are used""",
+    )
+    return parser
+
+
+def unpack_7bit_to_8bit(data):
+    output = bytearray()
+    for i in range(0, len(data), 8):
+        high_bits = data[i]
+        for j, byte in enumerate(data[i + 1 : i + 8]):
+            output.append(byte | (0x80 if high_bits & (1 << j) else 0))
+    return output
+
+
+def request_chunk(midiout, midiin, index, timeout=2.0):
+    request = [0x02, index & 0x7F, (index >> 7) & 0x7F, 0xF7]
+    midiout.send_message(TRACE_COMMAND + request)
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        msg_and_dt = midiin.get_message()
+        if not msg_and_dt:
+            time.sleep(0.001)
+            continue
+        (msg, _) = msg_and_dt
+        if msg[0:7] == TRACE_REPLY and msg[7] | (msg[8] << 7) == index:
+            return unpack_7bit_to_8bit(msg[9:-1])
+    raise TimeoutError(f"no reply for trace chunk {index}")
+
+
+def dump(midiout, midiin, filename):
+    # stop first so the ring buffer doesn't move while it's being read
+    midiout.send_message(TRACE_COMMAND + [0x00, 0xF7])
+    records = bytearray()
+    index = 0
+    num_chunks = 1
+    while index < num_chunks:
+        chunk = request_chunk(midiout, midiin, index)
+        num_recorded, num_chunks, num_in_chunk = struct.unpack_from("<IHH", chunk)
+        records += chunk[8 : 8 + num_in_chunk * RECORD_SIZE]
+        index += 1
+    with open(filename, "wb") as f:
+        f.write(records)
+    num_records = len(records) // RECORD_SIZE
+    print(f"wrote {num_records} of {num_recorded} recorded operations to {filename}")
+    if num_records < num_recorded:
+        print("the ring buffer wrapped, only the most recent operations were kept")
+
+
+def main():
+    midiout = rtmidi.MidiOut()
+    midiin = rtmidi.MidiIn()
+
+    parser = argparser()
+    ok = False
+    try:
+        args = parser.parse_args()
+        outport, inport, *_ = args.ports + [None, None]
+        if outport and not inport:
+            inport = outport
+        outport = util.ensure_midi_port("output", midiout, outport)
+        inport = util.ensure_midi_port("input ", midiin, inport)
+        midiout.open_port(outport)
+        midiin.open_port(inport)
+        midiin.ignore_types(False, True, True)
+        ok = True
+    except Exception as e:
+        util.note(f"ERROR: {e}")
+    finally:
+        if not ok:
+            util.report_available_midi_ports("output", midiout)
+            util.report_available_midi_ports("input", midiin)
+            exit(1)
+
+    with midiout:
+        if args.action == "start":
+            midiout.send_message(TRACE_COMMAND + [0x01, 0xF7])
+        elif args.action == "stop":
+            midiout.send_message(TRACE_COMMAND + [0x00, 0xF7])
+        elif args.action == "save":
+            midiout.send_message(TRACE_COMMAND + [0x03, 0xF7])
+        else:
+            dump(midiout, midiin, args.file)
+
+
+if __name__ == "__main__":
+    main()
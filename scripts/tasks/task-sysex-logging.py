@@ -27,6 +27,31 @@ def argparser():
                 available ports""",
         type=int,
     )
+    parser.add_argument(
+        "-t",
+        "--task-histograms",
+        help="""ask the Deluge to dump the task scheduler's latency and duration
+                histograms every N seconds""",
+        type=float,
+        metavar="N",
+    )
+    parser.add_argument(
+        "-m",
+        "--memory-pools",
+        help="""ask the Deluge to print the small allocation pools' hit rate and
+                fragmentation, and the realtime reserve's hits and fallbacks, every N seconds""",
+        type=float,
+        metavar="N",
+    )
+    parser.add_argument(
+        "-c",
+        "--cpu-load",
+        help="""ask the Deluge to print the audio engine's predicted and actual render
+                times, how often it culled voices or lowered quality ahead of time, and how many
+                messages the USB MIDI send queues dropped or coalesced, every N seconds""",
+        type=float,
+        metavar="N",
+    )
     return parser
 
 
@@ -50,9 +75,16 @@ def unpack_7bit_to_8bit(bytes):
         return bytearray(result)
 
 
-def sysex_console(midiout, midiin):
+def sysex_console(
+    midiout,
+    midiin,
+    histogram_interval=None,
+    pools_interval=None,
+    cpu_load_interval=None,
+):
     midiin.ignore_types(False, True, True)
 
+    # keep the output port open for the whole session, it's used to request histogram dumps
     with midiout:
         data = bytearray(9)
         # main Deluge header
@@ -67,37 +99,64 @@ def sysex_console(midiout, midiin):
         data[7] = 0x01  # 0x01 = enable, 0x00 = disable
         data[8] = 0xF7
         midiout.send_message(data)
-    del midiout
 
-    while True:
-        msg_and_dt = midiin.get_message()
-        if msg_and_dt:
-            # unpack the msg and time tuple
-            (msg, _) = msg_and_dt
+        # 0x03 is the command to dump the task scheduler histograms
+        histogram_request = [0xF0, 0x00, 0x21, 0x7B, 0x01, 0x03, 0x03, 0x00, 0xF7]
+        last_histogram_request = time.monotonic()
+        # 0x04 is the command to print the small allocation pool stats
+        pools_request = [0xF0, 0x00, 0x21, 0x7B, 0x01, 0x03, 0x04, 0x00, 0xF7]
+        last_pools_request = time.monotonic()
+        # 0x06 is the command to print the CPU load governor's and USB MIDI send queues' telemetry
+        cpu_load_request = [0xF0, 0x00, 0x21, 0x7B, 0x01, 0x03, 0x06, 0x00, 0xF7]
+        last_cpu_load_request = time.monotonic()
+
+        while True:
             if (
-                msg[0] == 0xF0
-                and len(msg) > 8
-                and msg[0:8]
-                == [
-                    # main Deluge sysex header
-                    0xF0,
-                    0x00,
-                    0x21,
-                    0x7B,
-                    0x01,
-                    # debug namespace
-                    0x03,
-                    # debug log message command
-                    0x40,
-                    0x00,
-                ]
+                histogram_interval
+                and time.monotonic() > last_histogram_request + histogram_interval
             ):
-                target_bytes = unpack_7bit_to_8bit(msg[5:-1])
-                decoded = target_bytes.decode("ascii").replace("\n", "")
-                print(decoded, flush=True)
-        else:
-            # add a short sleep so the while loop doesn't hammer your cpu
-            time.sleep(0.01)
+                midiout.send_message(histogram_request)
+                last_histogram_request = time.monotonic()
+            if (
+                pools_interval
+                and time.monotonic() > last_pools_request + pools_interval
+            ):
+                midiout.send_message(pools_request)
+                last_pools_request = time.monotonic()
+            if (
+                cpu_load_interval
+                and time.monotonic() > last_cpu_load_request + cpu_load_interval
+            ):
+                midiout.send_message(cpu_load_request)
+                last_cpu_load_request = time.monotonic()
+            msg_and_dt = midiin.get_message()
+            if msg_and_dt:
+                # unpack the msg and time tuple
+                (msg, _) = msg_and_dt
+                if (
+                    msg[0] == 0xF0
+                    and len(msg) > 8
+                    and msg[0:8]
+                    == [
+                        # main Deluge sysex header
+                        0xF0,
+                        0x00,
+                        0x21,
+                        0x7B,
+                        0x01,
+                        # debug namespace
+                        0x03,
+                        # debug log message command
+                        0x40,
+                        0x00,
+                    ]
+                ):
+                    target_bytes = unpack_7bit_to_8bit(msg[5:-1])
+                    decoded = target_bytes.decode("ascii").replace("\n", "")
+                    print(decoded, flush=True)
+            else:
+                # add a short sleep so the while loop doesn't hammer your cpu
+                time.sleep(0.01)
 
 
 def main():
@@ -127,7 +186,9 @@ def main():
             util.report_available_midi_ports("input", midiin)
             exit(1)
 
-    sysex_console(midiout, midiin)
+    sysex_console(
+        midiout, midiin, args.task_histograms, args.memory_pools, args.cpu_load
+    )
 
 
 if __name__ == "__main__":
@@ -20,7 +20,10 @@
 #include "io/debug/log.h"
 #include "util/container/static_vector.hpp"
 #include <algorithm>
+#include <bit>
+#include <cstdio>
 #include <iostream>
+#include <limits>
 
 #if !IN_UNIT_TESTS
 #include "memory/general_memory_allocator.h"
@@ -56,8 +59,67 @@ struct StatBlock {
 	}
 };
 
-// currently 14 are in use
-constexpr int kMaxTasks = 25;
+/// Log2 bucketed histogram of times in microseconds. Bucket 0 counts everything under 1us, bucket n counts
+/// [2^(n-1), 2^n) us and the last bucket counts everything from 2^(kNumBuckets-2) us up. Fixed size and cheap to
+/// update, so it's always compiled in unlike the detailed StatBlock.
+struct Histogram {
+	static constexpr int32_t kNumBuckets = 18;
+	std::array<uint32_t, kNumBuckets> counts{};
+	uint32_t maxMicroseconds{0};
+
+	static constexpr int32_t bucketFor(uint32_t microseconds) {
+		return std::min<int32_t>(std::bit_width(microseconds), kNumBuckets - 1);
+	}
+	/// Lower edge of a bucket in microseconds
+	static constexpr uint32_t bucketStart(int32_t bucket) { return bucket == 0 ? 0 : 1u << (bucket - 1); }
+
+	[[gnu::hot]] void add(double seconds) {
+		// negative times (e.g. running early) go in the bottom bucket
+		uint32_t microseconds = seconds <= 0 ? 0 : seconds >= 4000 ? UINT32_MAX : (uint32_t)(seconds * 1000000.0);
+		counts[bucketFor(microseconds)]++;
+		maxMicroseconds = std::max(maxMicroseconds, microseconds);
+	}
+	[[nodiscard]] uint32_t total() const {
+		uint32_t sum = 0;
+		for (auto count : counts) {
+			sum += count;
+		}
+		return sum;
+	}
+	void reset() { *this = Histogram{}; }
+};
+
+/// Per task instrumentation for finding which task is starving the others. Unlike the StatBlocks this is only reset
+/// when it's dumped, so it covers everything since the last dump.
+struct TaskHistograms {
+	/// The scheduler only forces a task once it's past maxInterval, so tasks with maxInterval == targetInterval are
+	/// routinely called a hair after it. Don't count those as misses.
+	static constexpr double kMaxIntervalMissTolerance = 1 + 1 / 64.;
+
+	/// Time by which each call started after its targetInterval had elapsed
+	Histogram lateness;
+	/// Time spent in each call of the task
+	Histogram duration;
+	/// Number of calls that started later than maxInterval after the previous one
+	uint32_t maxIntervalMisses{0};
+	/// Whether the task has been called since the last reset, the first call has nothing to measure latency from
+	bool hasRun{false};
+
+	void reset() { *this = TaskHistograms{}; }
+};
+
+#if IN_UNIT_TESTS
+// room for the scheduler benchmark
+constexpr int kMaxTasks = 512;
+#else
+// deluge.cpp registers 18 repeating tasks, the rest is for once and conditional tasks
+constexpr int kMaxTasks = 32;
+#endif
+// Up to this many runnable tasks, walking the sorted list is quicker than searching the ready queue - it does less per
+// task, and there's nothing to keep up to date as tasks run. So a build that can't have more than this many tasks
+// doesn't keep a ready queue at all
+constexpr int kLinearWalkMaxTasks = 32;
+constexpr bool kUseReadyQueue = kMaxTasks > kLinearWalkMaxTasks;
 constexpr double rollTime = ((double)(UINT32_MAX) / DELUGE_CLOCKS_PERf);
 struct Task {
 	Task() = default;
@@ -93,6 +155,7 @@ struct Task {
 	double lastFinishTime{0};
 
 	StatBlock durationStats;
+	TaskHistograms histograms;
 #if SCHEDULER_DETAILED_STATS
 	StatBlock latency;
 #endif
@@ -104,13 +167,144 @@ struct Task {
 	double totalTime{0};
 	int32_t timesCalled{0};
 	double lastRunTime;
+	/// Where this task is in TaskManager::sortedList, or -1 if it isn't runnable
+	int16_t queuePosition{-1};
 };
 
 struct SortedTask {
 	uint8_t priority = UINT8_MAX;
 	TaskID task = -1;
-	// priorities are descending, so this puts low pri tasks first
-	bool operator<(const SortedTask& another) const { return priority > another.priority; }
+	// priorities are descending, so this puts low pri tasks first. Equal priorities go in TaskID order
+	bool operator<(const SortedTask& another) const {
+		return priority > another.priority || (priority == another.priority && task < another.task);
+	}
+};
+
+/// The times chooseBestTask compares each task against, precomputed so that ReadyQueue can take the minimum of each
+/// over a range of tasks
+struct QueueKeys {
+	static constexpr double kNever = std::numeric_limits<double>::infinity();
+	/// lastCallTime + targetInterval - average duration
+	double callTime{kNever};
+	/// lastCallTime + maxInterval - average duration
+	double maxCallTime{kNever};
+	/// lastCallTime + maxInterval
+	double overdueTime{kNever};
+	/// average duration
+	double duration{kNever};
+	/// lastFinishTime + max(targetInterval, backOffPeriod)
+	double targetFinishTime{kNever};
+	/// lastFinishTime + backOffPeriod
+	double backOffFinishTime{kNever};
+
+	static QueueKeys forTask(const Task& t) {
+		const TaskSchedule& s = t.schedule;
+		return QueueKeys{
+		    .callTime = t.lastCallTime + s.targetInterval - t.durationStats.average,
+		    .maxCallTime = t.lastCallTime + s.maxInterval - t.durationStats.average,
+		    .overdueTime = t.lastCallTime + s.maxInterval,
+		    .duration = t.durationStats.average,
+		    .targetFinishTime = t.lastFinishTime + std::max(s.targetInterval, s.backOffPeriod),
+		    .backOffFinishTime = t.lastFinishTime + s.backOffPeriod,
+		};
+	}
+	static QueueKeys min(const QueueKeys& a, const QueueKeys& b) {
+		return QueueKeys{
+		    .callTime = std::min(a.callTime, b.callTime),
+		    .maxCallTime = std::min(a.maxCallTime, b.maxCallTime),
+		    .overdueTime = std::min(a.overdueTime, b.overdueTime),
+		    .duration = std::min(a.duration, b.duration),
+		    .targetFinishTime = std::min(a.targetFinishTime, b.targetFinishTime),
+		    .backOffFinishTime = std::min(a.backOffFinishTime, b.backOffFinishTime),
+		};
+	}
+};
+
+/// Min-tree over the QueueKeys of the sorted list, so a search for the first or last task matching a condition can skip
+/// any subtree whose minimums already rule it out. That makes a scheduling decision O(log n) in the number of tasks
+/// rather than a walk over all of them. Positions past the end of the sorted list hold kNever and never match.
+struct ReadyQueue {
+	static constexpr int32_t kNumLeaves = kUseReadyQueue ? std::bit_ceil((uint32_t)kMaxTasks) : 1;
+	std::array<QueueKeys, 2 * kNumLeaves> nodes{};
+
+	void set(int32_t position, const QueueKeys& keys) {
+		int32_t node = kNumLeaves + position;
+		nodes[node] = keys;
+		for (node >>= 1; node > 0; node >>= 1) {
+			nodes[node] = QueueKeys::min(nodes[2 * node], nodes[2 * node + 1]);
+		}
+	}
+
+	/// Set the leaves for positions [first, last) from keysAt(position), then fix up their parents in one pass
+	template <typename KeysAt>
+	void setRange(int32_t first, int32_t last, KeysAt keysAt) {
+		if (first >= last) {
+			return;
+		}
+		for (int32_t position = first; position < last; position++) {
+			nodes[kNumLeaves + position] = keysAt(position);
+		}
+		for (int32_t low = (kNumLeaves + first) >> 1, high = (kNumLeaves + last - 1) >> 1; low > 0;
+		     low >>= 1, high >>= 1) {
+			for (int32_t node = low; node <= high; node++) {
+				nodes[node] = QueueKeys::min(nodes[2 * node], nodes[2 * node + 1]);
+			}
+		}
+	}
+
+	/// First position for which matches(position) is true. mayMatch(keys) must be true for any node whose subtree
+	/// contains a match, and is used to skip the rest.
+	template <typename MayMatch, typename Matches>
+	int32_t findFirst(MayMatch&& mayMatch, Matches&& matches, int32_t node = 1, int32_t low = 0,
+	                  int32_t size = kNumLeaves) {
+		if (!mayMatch(nodes[node])) {
+			return -1;
+		}
+		if (size == 1) {
+			return matches(low) ? low : -1;
+		}
+		size >>= 1;
+		int32_t found = findFirst(mayMatch, matches, 2 * node, low, size);
+		if (found < 0) {
+			found = findFirst(mayMatch, matches, 2 * node + 1, low + size, size);
+		}
+		return found;
+	}
+
+	/// Call visit(position) for each position in order, skipping any subtree for which mayMatch(keys, first, last)
+	/// is false. visit may change what mayMatch accepts, but only for positions after the one visited.
+	template <typename MayMatch, typename Visit>
+	void visitInOrder(MayMatch&& mayMatch, Visit&& visit, int32_t node = 1, int32_t low = 0,
+	                  int32_t size = kNumLeaves) {
+		if (!mayMatch(nodes[node], low, low + size)) {
+			return;
+		}
+		if (size == 1) {
+			visit(low);
+			return;
+		}
+		size >>= 1;
+		visitInOrder(mayMatch, visit, 2 * node, low, size);
+		visitInOrder(mayMatch, visit, 2 * node + 1, low + size, size);
+	}
+
+	/// Last position for which matches(position) is true, see findFirst
+	template <typename MayMatch, typename Matches>
+	int32_t findLast(MayMatch&& mayMatch, Matches&& matches, int32_t node = 1, int32_t low = 0,
+	                 int32_t size = kNumLeaves) {
+		if (!mayMatch(nodes[node])) {
+			return -1;
+		}
+		if (size == 1) {
+			return matches(low) ? low : -1;
+		}
+		size >>= 1;
+		int32_t found = findLast(mayMatch, matches, 2 * node + 1, low + size, size);
+		if (found < 0) {
+			found = findLast(mayMatch, matches, 2 * node, low, size);
+		}
+		return found;
+	}
 };
 
 /// internal only to the task scheduler, hence all public. External interaction to use the api
@@ -120,8 +314,12 @@ struct TaskManager {
 	std::array<Task, kMaxTasks> list{};
 	// Sorted list of the current numActiveTasks, lowest priority (highest number) first
 	std::array<SortedTask, kMaxTasks> sortedList;
-	uint8_t numActiveTasks = 0;
-	uint8_t numRegisteredTasks = 0;
+	// QueueKeys of sortedList, kept up to date whenever a task's timing changes
+	ReadyQueue queue;
+	int16_t numActiveTasks = 0;
+	int16_t numRegisteredTasks = 0;
+	// conditional tasks waiting for their condition, so the idle loop can skip checking when there are none
+	int16_t numWaitingConditionalTasks = 0;
 	double mustEndBefore = -1; // use for testing or I guess if you want a second temporary task manager?
 	bool running{false};
 	double cpuTime{0};
@@ -132,14 +330,20 @@ struct TaskManager {
 	void removeTask(TaskID id);
 	void runTask(TaskID id);
 	TaskID chooseBestTask(double deadline);
+	TaskID chooseBestTaskAt(double currentTime, double deadline);
+	TaskID chooseBestTaskLinear(double currentTime, double deadline);
+	TaskID chooseBestTaskFromQueue(double currentTime, double deadline);
 	TaskID addRepeatingTask(TaskHandle task, TaskSchedule schedule, const char* name);
 
 	TaskID addOnceTask(TaskHandle task, uint8_t priority, double timeToWait, const char* name);
 	TaskID addConditionalTask(TaskHandle task, uint8_t priority, RunCondition condition, const char* name);
 
-	void createSortedList();
+	void addToQueue(TaskID id);
+	void removeFromQueue(TaskID id);
+	void updateQueue(TaskID id);
 	TaskID insertTaskToList(Task task);
 	void printStats();
+	void dumpHistograms();
 	bool checkConditionalTasks();
 	bool yield(RunCondition until, double timeout = 0);
 	double getSecondsFromStart();
@@ -162,26 +366,59 @@ private:
 
 TaskManager taskManager;
 
-void TaskManager::createSortedList() {
-	int j = 0;
-	for (TaskID i = 0; i < kMaxTasks; i++) {
-		if (list[i].handle != nullptr && list[i].runnable) {
-			sortedList[j] = (SortedTask{list[i].schedule.priority, i});
-			j++;
-		}
+void TaskManager::addToQueue(TaskID id) {
+	SortedTask entry{list[id].schedule.priority, id};
+	int32_t position = std::upper_bound(&sortedList[0], &sortedList[0] + numActiveTasks, entry) - &sortedList[0];
+	std::copy_backward(&sortedList[position], &sortedList[numActiveTasks], &sortedList[numActiveTasks + 1]);
+	sortedList[position] = entry;
+	numActiveTasks++;
+	for (int32_t i = position; i < numActiveTasks; i++) {
+		list[sortedList[i].task].queuePosition = i;
 	}
-	numActiveTasks = j;
-	if (numActiveTasks > 1) {
-		// &array[size] is UB, or at least Clang + MSVC manages to choke
-		// on it. So grab what is at worst size-1, and then increment
-		// the pointer.
-		std::sort(&sortedList[0], (&sortedList[numActiveTasks - 1]) + 1);
+	if constexpr (kUseReadyQueue) {
+		queue.setRange(position, numActiveTasks,
+		               [&](int32_t i) { return QueueKeys::forTask(list[sortedList[i].task]); });
+	}
+}
+
+void TaskManager::removeFromQueue(TaskID id) {
+	int32_t position = list[id].queuePosition;
+	if (position < 0) {
+		return;
+	}
+	std::copy(&sortedList[position + 1], &sortedList[numActiveTasks], &sortedList[position]);
+	numActiveTasks--;
+	list[id].queuePosition = -1;
+	for (int32_t i = position; i < numActiveTasks; i++) {
+		list[sortedList[i].task].queuePosition = i;
+	}
+	if constexpr (kUseReadyQueue) {
+		queue.setRange(position, numActiveTasks + 1, [&](int32_t i) {
+			return i < numActiveTasks ? QueueKeys::forTask(list[sortedList[i].task]) : QueueKeys{};
+		});
+	}
+}
+
+/// must be called after changing anything QueueKeys::forTask depends on
+void TaskManager::updateQueue(TaskID id) {
+	if (kUseReadyQueue && list[id].queuePosition >= 0) {
+		queue.set(list[id].queuePosition, QueueKeys::forTask(list[id]));
 	}
 }
 
-// deadline < 0 means no deadline
 TaskID TaskManager::chooseBestTask(double deadline) {
-	double currentTime = getSecondsFromStart();
+	return chooseBestTaskAt(getSecondsFromStart(), deadline);
+}
+
+// deadline < 0 means no deadline
+TaskID TaskManager::chooseBestTaskAt(double currentTime, double deadline) {
+	if (!kUseReadyQueue || numActiveTasks <= kLinearWalkMaxTasks) {
+		return chooseBestTaskLinear(currentTime, deadline);
+	}
+	return chooseBestTaskFromQueue(currentTime, deadline);
+}
+
+TaskID TaskManager::chooseBestTaskLinear(double currentTime, double deadline) {
 	double nextFinishTime = currentTime;
 	TaskID bestTask = -1;
 	uint8_t bestPriority = INT8_MAX;
@@ -241,10 +478,88 @@ TaskID TaskManager::chooseBestTask(double deadline) {
 	return bestTask;
 }
 
+TaskID TaskManager::chooseBestTaskFromQueue(double currentTime, double deadline) {
+	/// The same choice as chooseBestTaskLinear(), but the ready queue lets it skip straight to the tasks which pass
+	/// each test
+
+	// times in the queue are sums, so may round differently to the differences compared below. Be generous when
+	// pruning and make the exact comparison on the task itself
+	constexpr double kSlop = 1e-6;
+	auto taskAt = [&](int32_t position) -> Task& { return list[sortedList[position].task]; };
+
+	// ensure every routine is within its target
+	int32_t overdue = queue.findFirst(
+	    [&](const QueueKeys& k) { return k.overdueTime < currentTime + kSlop; },
+	    [&](int32_t position) {
+		    Task& t = taskAt(position);
+		    return currentTime - t.lastCallTime > t.schedule.maxInterval;
+	    });
+	if (overdue >= 0) {
+		return sortedList[overdue].task;
+	}
+
+	double nextFinishTime = currentTime;
+	TaskID bestTask = -1;
+	uint8_t bestPriority = INT8_MAX;
+	auto isDue = [&](const QueueKeys& k) {
+		return (k.callTime < currentTime || k.maxCallTime < nextFinishTime)
+		       && (deadline < 0 || currentTime + k.duration < deadline);
+	};
+	queue.visitInOrder(
+	    [&](const QueueKeys& k, int32_t first, int32_t last) {
+		    // the list is in decreasing priority, so the last task in range has the highest. Only a task with a strictly
+		    // higher priority than the current best can replace it
+		    last = std::min<int32_t>(last, numActiveTasks);
+		    return first < last && sortedList[last - 1].priority < bestPriority && isDue(k);
+	    },
+	    [&](int32_t position) {
+		    // the leaf holds exactly the values the test above compares, so this task has passed it
+		    Task* t = &taskAt(position);
+		    if (currentTime - t->lastFinishTime > t->schedule.backOffPeriod) {
+			    bestTask = sortedList[position].task;
+			    nextFinishTime = currentTime + t->durationStats.average;
+		    }
+		    else {
+			    bestTask = -1;
+			    nextFinishTime = t->lastCallTime + t->schedule.maxInterval - t->durationStats.average;
+		    }
+		    bestPriority = t->schedule.priority;
+	    });
+	// if we didn't find a task because something high priority needs to wait to run, find the next task we can do
+	// before it needs to start
+	if (bestTask == -1) {
+		auto fitsBefore = [&](const QueueKeys& k) { return currentTime + k.duration < nextFinishTime; };
+		// first look based on target time
+		int32_t position = queue.findLast(
+		    [&](const QueueKeys& k) { return fitsBefore(k) && k.targetFinishTime < currentTime + kSlop; },
+		    [&](int32_t p) {
+			    Task& t = taskAt(p);
+			    return currentTime + t.durationStats.average < nextFinishTime
+			           && currentTime - t.lastFinishTime > t.schedule.targetInterval
+			           && currentTime - t.lastFinishTime > t.schedule.backOffPeriod;
+		    });
+		if (position >= 0) {
+			return sortedList[position].task;
+		}
+		// then look based on min time just to avoid busy waiting
+		position = queue.findLast(
+		    [&](const QueueKeys& k) { return fitsBefore(k) && k.backOffFinishTime < currentTime + kSlop; },
+		    [&](int32_t p) {
+			    Task& t = taskAt(p);
+			    return currentTime + t.durationStats.average < nextFinishTime
+			           && currentTime - t.lastFinishTime > t.schedule.backOffPeriod;
+		    });
+		if (position >= 0) {
+			return sortedList[position].task;
+		}
+	}
+	return bestTask;
+}
+
 /// insert task into the first empty spot in the list
 TaskID TaskManager::insertTaskToList(Task task) {
-	int8_t index = 0;
-	while (list[index].handle && index < kMaxTasks) {
+	TaskID index = 0;
+	while (index < kMaxTasks && list[index].handle) {
 		index += 1;
 	}
 	if (index < kMaxTasks) {
@@ -262,7 +577,7 @@ TaskID TaskManager::addRepeatingTask(TaskHandle task, TaskSchedule schedule, con
 
 	TaskID index = insertTaskToList(Task{task, schedule, name});
 
-	createSortedList();
+	addToQueue(index);
 	return index;
 }
 
@@ -273,7 +588,7 @@ TaskID TaskManager::addOnceTask(TaskHandle task, uint8_t priority, double timeTo
 	double timeToStart = running ? getSecondsFromStart() : 0;
 	TaskID index = insertTaskToList(Task{task, priority, timeToStart, timeToWait, name});
 
-	createSortedList();
+	addToQueue(index);
 	return index;
 }
 
@@ -282,14 +597,21 @@ TaskID TaskManager::addConditionalTask(TaskHandle task, uint8_t priority, RunCon
 		return -1;
 	}
 	TaskID index = insertTaskToList(Task{task, priority, condition, name});
-	//  don't sort since it's not runnable yet anyway, so no change to the active list
+	//  don't queue it since it's not runnable yet anyway, checkConditionalTasks will do that
+	numWaitingConditionalTasks++;
 	return index;
 }
 
 void TaskManager::removeTask(TaskID id) {
+	if (!list[id].handle) {
+		return;
+	}
+	if (list[id].condition != nullptr && !list[id].runnable) {
+		numWaitingConditionalTasks--;
+	}
+	removeFromQueue(id);
 	list[id] = Task{};
 	numRegisteredTasks--;
-	createSortedList();
 	return;
 }
 void TaskManager::ignoreForStats() {
@@ -304,6 +626,7 @@ double TaskManager::getLastRunTimeforCurrentTask() {
 void TaskManager::setNextRunTimeforCurrentTask(double seconds) {
 	auto currentTask = &list[currentID];
 	currentTask->schedule.maxInterval = seconds;
+	updateQueue(currentID);
 }
 
 void TaskManager::runTask(TaskID id) {
@@ -327,6 +650,16 @@ void TaskManager::runTask(TaskID id) {
 #if SCHEDULER_DETAILED_STATS
 			currentTask->latency.update(startTime - currentTask->lastCallTime);
 #endif
+			auto& histograms = currentTask->histograms;
+			if (histograms.hasRun) {
+				double interval = startTime - currentTask->lastCallTime;
+				histograms.lateness.add(interval - currentTask->schedule.targetInterval);
+				if (interval > currentTask->schedule.maxInterval * TaskHistograms::kMaxIntervalMissTolerance) {
+					histograms.maxIntervalMisses++;
+				}
+			}
+			histograms.hasRun = true;
+			histograms.duration.add(runtime);
 			currentTask->lastCallTime = startTime;
 
 			currentTask->durationStats.update(runtime);
@@ -336,6 +669,7 @@ void TaskManager::runTask(TaskID id) {
 		}
 	}
 	currentTask->lastFinishTime = timeNow;
+	updateQueue(id);
 
 	lastFinishTime = timeNow;
 }
@@ -365,11 +699,13 @@ bool TaskManager::yield(RunCondition until, double timeout) {
 	else {
 		yieldingTask->lastFinishTime = timeNow; // update this so it's in its back off window
 		if (countThisTask) {
+			yieldingTask->histograms.duration.add(runtime);
 			yieldingTask->durationStats.update(runtime);
 			yieldingTask->totalTime += runtime;
 			yieldingTask->lastRunTime = runtime;
 			yieldingTask->timesCalled += 1;
 		}
+		updateQueue(yieldingID);
 	}
 	// continue the main loop. The yielding task is still on the stack but that should be fine
 	// run at least once so this can be used for yielding a single call as well
@@ -393,6 +729,7 @@ bool TaskManager::yield(RunCondition until, double timeout) {
 
 		auto finishTime = getSecondsFromStart();
 		yieldingTask->lastCallTime = finishTime; // hack so it won't get called again immediately
+		updateQueue(yieldingID);
 	}
 	return (getSecondsFromStart() < timeNow + timeout);
 }
@@ -439,21 +776,22 @@ void TaskManager::startClock() {
 	lastTime = 0;
 }
 bool TaskManager::checkConditionalTasks() {
+	if (numWaitingConditionalTasks == 0) {
+		return false;
+	}
 	bool addedTask = false;
-	for (int i = 0; i < kMaxTasks; i++) {
+	for (TaskID i = 0; i < kMaxTasks; i++) {
 		struct Task* t = &list[i];
 		if (t->condition != nullptr && !(t->runnable)) {
 			t->runnable = t->condition();
 			if (t->runnable) {
+				numWaitingConditionalTasks--;
+				addToQueue(i);
 				addedTask = true;
 			}
 		}
 	}
-	if (addedTask) {
-		createSortedList();
-		return true;
-	}
-	return false;
+	return addedTask;
 }
 
 void TaskManager::resetStats() {
@@ -467,6 +805,10 @@ void TaskManager::resetStats() {
 #endif
 		}
 	}
+	if constexpr (kUseReadyQueue) {
+		queue.setRange(0, numActiveTasks,
+		               [&](int32_t i) { return QueueKeys::forTask(list[sortedList[i].task]); });
+	}
 	cpuTime = 0;
 	overhead = 0;
 }
@@ -504,6 +846,33 @@ void TaskManager::printStats() {
 	          100 * overhead / totalTime, runningTime);
 	resetStats();
 }
+
+void TaskManager::dumpHistograms() {
+#if ENABLE_TEXT_OUTPUT
+	auto printHistogram = [](const char* label, const Histogram& histogram) {
+		char buffer[200];
+		int32_t length = snprintf(buffer, sizeof(buffer), "  %s (worst %lu us):", label,
+		                          (unsigned long)histogram.maxMicroseconds);
+		for (int32_t i = 0; i < Histogram::kNumBuckets && length < (int32_t)sizeof(buffer); i++) {
+			length += snprintf(&buffer[length], sizeof(buffer) - length, " %lu", (unsigned long)histogram.counts[i]);
+		}
+		D_PRINTLN("%s", buffer);
+	};
+	D_PRINTLN("Task histograms, buckets are log2 microseconds from 0:");
+	for (auto& task : list) {
+		if (task.handle) {
+			D_PRINTLN("Task: %s, Calls: %lu, Max interval misses: %lu", task.name,
+			          (unsigned long)task.histograms.duration.total(), (unsigned long)task.histograms.maxIntervalMisses);
+			printHistogram("Lateness", task.histograms.lateness);
+			printHistogram("Duration", task.histograms.duration);
+		}
+	}
+#endif
+	for (auto& task : list) {
+		task.histograms.reset();
+	}
+}
+
 /// return a monotonic timer value in seconds from when the task manager started
 double TaskManager::getSecondsFromStart() {
 	auto timeNow = getTimerValueSeconds(0);
@@ -531,16 +900,16 @@ void setNextRunTimeforCurrentTask(double seconds) {
 	taskManager.setNextRunTimeforCurrentTask(seconds);
 }
 
-uint8_t addRepeatingTask(TaskHandle task, uint8_t priority, double backOffTime, double targetTimeBetweenCalls,
-                         double maxTimeBetweenCalls, const char* name) {
+TaskID addRepeatingTask(TaskHandle task, uint8_t priority, double backOffTime, double targetTimeBetweenCalls,
+                        double maxTimeBetweenCalls, const char* name) {
 	return taskManager.addRepeatingTask(
 	    task, TaskSchedule{priority, backOffTime, targetTimeBetweenCalls, maxTimeBetweenCalls}, name);
 }
-uint8_t addOnceTask(TaskHandle task, uint8_t priority, double timeToWait, const char* name) {
+TaskID addOnceTask(TaskHandle task, uint8_t priority, double timeToWait, const char* name) {
 	return taskManager.addOnceTask(task, priority, timeToWait, name);
 }
 
-uint8_t addConditionalTask(TaskHandle task, uint8_t priority, RunCondition condition, const char* name) {
+TaskID addConditionalTask(TaskHandle task, uint8_t priority, RunCondition condition, const char* name) {
 	return taskManager.addConditionalTask(task, priority, condition, name);
 }
 
@@ -555,6 +924,9 @@ bool yieldWithTimeout(RunCondition until, double timeout) {
 void removeTask(TaskID id) {
 	return taskManager.removeTask(id);
 }
+void dumpTaskHistograms() {
+	taskManager.dumpHistograms();
+}
 double getSystemTime() {
 	return taskManager.getSecondsFromStart();
 }
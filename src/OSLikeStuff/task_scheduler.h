@@ -25,7 +25,7 @@ extern "C" {
 /// void function with no arguments
 typedef void (*TaskHandle)();
 typedef bool (*RunCondition)();
-typedef int8_t TaskID;
+typedef int16_t TaskID;
 struct TaskSchedule {
 	// 0 is highest priority
 	uint8_t priority;
@@ -44,21 +44,23 @@ struct TaskSchedule {
 ///
 /// Tasks are selected to run based on priority and expected duration (computed via a running average of previous
 /// invocations of the task). The task with the lowest priority that can complete before a task with higher
-/// priority needs to start will run, without violation of the backOffTime.
+/// priority needs to start will run, without violation of the backOffTime. On the device there's room for 32 tasks,
+/// few enough that choosing walks all of them in priority order - the ready queue, whose cost grows with the log of
+/// the number of tasks, is only built in when kMaxTasks is raised past that, as the host benchmarks do.
 ///
 /// @param task The task to call
 /// @param priority Priority of the task. Tasks with lower numbers are given preference over tasks with higher numbers.
 /// @param backOffTime Minimum time from completing the task to calling it again in seconds.
 /// @param targetTimeBetweenCalls Desired time between calls to the task, including the runtime for the task itself.
-uint8_t addRepeatingTask(TaskHandle task, uint8_t priority, double backOffTime, double targetTimeBetweenCalls,
-                         double maxTimeBetweenCalls, const char* name);
+TaskID addRepeatingTask(TaskHandle task, uint8_t priority, double backOffTime, double targetTimeBetweenCalls,
+                        double maxTimeBetweenCalls, const char* name);
 
 /// Add a task to run once, aiming to run at current time + timeToWait and worst case run at timeToWait*10
-uint8_t addOnceTask(TaskHandle task, uint8_t priority, double timeToWait, const char* name);
+TaskID addOnceTask(TaskHandle task, uint8_t priority, double timeToWait, const char* name);
 
 /// add a task that runs only after the condition returns true. Condition checks should be very fast or they could
 /// interfere with scheduling
-uint8_t addConditionalTask(TaskHandle task, uint8_t priority, RunCondition condition, const char* name);
+TaskID addConditionalTask(TaskHandle task, uint8_t priority, RunCondition condition, const char* name);
 void ignoreForStats();
 double getLastRunTimeforCurrentTask();
 double getSystemTime();
@@ -67,6 +69,8 @@ void removeTask(TaskID id);
 void yield(RunCondition until);
 /// timeout in seconds, returns whether the condition was met
 bool yieldWithTimeout(RunCondition until, double timeout);
+/// print each task's lateness and duration histograms and its maxInterval misses to the debug output, then reset them
+void dumpTaskHistograms();
 /// start the task scheduler
 void startTaskManager();
 #ifdef __cplusplus
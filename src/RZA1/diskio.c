@@ -228,6 +228,40 @@ DRESULT disk_read_without_streaming_first(BYTE pdrv, /* Physical drive nmuber to
     }
 }
 
+// Reads count sectors starting at sector, sectorsPerBuff into each of buffs in turn, in one go if the card driver can.
+// For sample Clusters which sit one after the other on the card - see AudioFileManager::loadAnyEnqueuedClusters()
+DRESULT disk_read_scattered_without_streaming_first(BYTE pdrv, BYTE* const* buffs, UINT sectorsPerBuff, LBA_t sector,
+    UINT count)
+{
+
+    logAudioAction("disk_read_scattered_without_streaming_first");
+
+    BYTE err;
+
+    if (currentlyAccessingCard)
+    {
+        if (ALPHA_OR_BETA_VERSION)
+        {
+            FREEZE_WITH_ERROR("E259");
+        }
+    }
+
+    currentlyAccessingCard = 1;
+
+    err = sd_read_sect_scattered(SD_PORT, buffs, sectorsPerBuff, sector, count);
+
+    currentlyAccessingCard = 0;
+
+    if (err == 0)
+    {
+        return RES_OK;
+    }
+    else
+    {
+        return RES_ERROR;
+    }
+}
+
 /*-----------------------------------------------------------------------*/
 /* Write Sector(s)                                                       */
 /*-----------------------------------------------------------------------*/
@@ -51,6 +51,7 @@
 
 static int _sd_single_read(SDHNDL *hndl,unsigned char *buff,unsigned long psn
 	,int mode);
+static int _sd_read_sect_abort(int sd_port, SDHNDL *hndl, int mode);
 
 
 int doActualReadRohan(int sd_port, SDHNDL *hndl, unsigned char *buff, long cnt, int mode, int dma_64) {
@@ -388,6 +389,25 @@ int sd_read_sect(int sd_port, unsigned char *buff,unsigned long psn,long cnt)
 
 ErrExit_DMA:
 ErrExit:
+	return _sd_read_sect_abort(sd_port, hndl, mode);
+}
+
+/*****************************************************************************
+ * ID           :
+ * Summary      : clean up after a failed multiple block read
+ * Include      : 
+ * Declaration  : static int _sd_read_sect_abort(int sd_port, SDHNDL *hndl, int mode);
+ * Functions    : disable DMA, clear and disable interrupts, stop any transfer
+ *              : still running and get the card back to transfer state
+ *              : 
+ * Argument     : int sd_port : channel no (0 or 1)
+ *              : SDHNDL *hndl : SD handle
+ *              : int mode : data transfer mode the read was using
+ * Return       : hndl->error : SD handle error value
+ * Remark       : shared by sd_read_sect and sd_read_sect_scattered
+ *****************************************************************************/
+static int _sd_read_sect_abort(int sd_port, SDHNDL *hndl, int mode)
+{
 	if(mode == SD_MODE_DMA){
 		sddev_disable_dma(sd_port);	/* disable DMA */
 	}
@@ -459,6 +479,209 @@ ErrExit:
 	return hndl->error;
 }
 
+/*****************************************************************************
+ * ID           :
+ * Summary      : read consecutive sectors from card into several buffers
+ * Include      : 
+ * Declaration  : int sd_read_sect_scattered(int sd_port, unsigned char * const *buffs,
+ *              : long sectsPerBuff, unsigned long psn, long cnt);
+ * Functions    : read the number of sectors (=cnt) from physical sector number
+ *              : (=psn) with a single CMD18, sectsPerBuff sectors into each
+ *              : buffer in turn (the last may get fewer). The DMAC is set up
+ *              : afresh for each buffer; the card is held off by the host
+ *              : while that happens, same as between blocks in PIO mode
+ *              : if the transfer can't be done that way (PIO, MMC, too many
+ *              : sectors for SD_SECCNT), falls back to sd_read_sect per buffer
+ *              : 
+ * Argument     : unsigned char * const *buffs : read data buffers
+ *              : long sectsPerBuff : sectors to read into each buffer
+ *              : unsigned long psn : read physical sector number
+ *              : long cnt : number of read sectors
+ * Return       : SD_OK : end of succeed
+ *              : SD_ERR: end of error
+ * Remark       : added for the Deluge, to read several sample Clusters which
+ *              : are consecutive on the card without paying the card's
+ *              : access time for each
+ *****************************************************************************/
+int sd_read_sect_scattered(int sd_port, unsigned char * const *buffs, long sectsPerBuff, unsigned long psn, long cnt)
+{
+	SDHNDL *hndl;
+	long b,numBuffs,buffCnt;
+	int ret,mode=SD_MODE_DMA;
+	int dma_64;
+
+	logAudioAction("sd_read_sect_scattered");
+
+	if( (sd_port != 0) && (sd_port != 1) ){
+		return SD_ERR;
+	}
+
+	hndl = _sd_get_hndls(sd_port);
+	if(hndl == 0){
+		return SD_ERR;	/* not initilized */
+	}
+
+	numBuffs = (cnt + sectsPerBuff - 1) / sectsPerBuff;
+
+	/* ---- anything the single command can't do, do a buffer at a time ---- */
+	for(b=0; b<numBuffs; b++){
+		if((unsigned long)buffs[b] & 0x03u){
+			mode = SD_MODE_SW;
+		}
+	}
+	if(!(hndl->trans_mode & SD_MODE_DMA) || mode != SD_MODE_DMA || hndl->media_type == SD_MEDIA_MMC
+		|| cnt > TRANS_SECTORS || cnt <= 2){
+		for(b=0; b<numBuffs; b++,psn+=sectsPerBuff,cnt-=sectsPerBuff){
+			ret = sd_read_sect(sd_port,buffs[b],psn,(cnt < sectsPerBuff) ? cnt : sectsPerBuff);
+			if(ret != SD_OK){
+				return ret;
+			}
+		}
+		return SD_OK;
+	}
+
+	routineForSD(); // As in sd_read_sect - once per read
+
+	hndl->error = SD_OK;
+
+	/* ---- check card is mounted ---- */
+	if(hndl->mount != SD_MOUNT_UNLOCKED_CARD){
+		_sd_set_err(hndl,SD_ERR);
+		return hndl->error;	/* not mounted yet */
+	}
+
+	/* ---- is stop compulsory? ---- */
+	if(hndl->stop){
+		hndl->stop = 0;
+		_sd_set_err(hndl,SD_ERR_STOP);
+		return SD_ERR_STOP;
+	}
+
+	/* ---- is card existed? ---- */
+	if(_sd_check_media(hndl) != SD_OK){
+		_sd_set_err(hndl,SD_ERR_NO_CARD);	/* no card */
+		return SD_ERR_NO_CARD;
+	}
+
+	/* access area check */
+	if(psn >= hndl->card_sector_size || psn + cnt > hndl->card_sector_size){
+		_sd_set_err(hndl,SD_ERR);
+		return hndl->error;	/* out of area */
+	}
+
+	#if		(TARGET_RZ_A1 == 1)
+	if(hndl->trans_mode & SD_MODE_DMA_64){
+		dma_64 = SD_MODE_DMA_64;
+	}
+	else{
+		dma_64 = SD_MODE_DMA;
+	}
+	#endif
+
+	/* transfer size is fixed (512 bytes) */
+	sd_outp(hndl,SD_SIZE,512);
+
+	/* ---- supply clock (data-transfer ratio) ---- */
+	if(_sd_set_clock(hndl,(int)hndl->csd_tran_speed,SD_CLOCK_ENABLE) != SD_OK){
+		return hndl->error;
+	}
+
+	/* ==== check status precede read operation ==== */
+	if(_sd_card_send_cmd_arg(hndl,CMD13,SD_RESP_R1,hndl->rca[0],0x0000)
+		== SD_OK){
+		if((hndl->resp_status & RES_STATE) != STATE_TRAN){	/* not transfer state */
+			 hndl->error = SD_ERR;
+			goto ErrExit;
+		}
+	}
+	else{	/* SDHI error */
+		goto ErrExit;
+	}
+
+	/* enable SD_SECCNT */
+	sd_outp(hndl,SD_STOP,0x0100);
+	sd_outp(hndl,SD_SECCNT,(unsigned short)cnt);
+
+	/* ---- enable RespEnd and ILA ---- */
+	_sd_set_int_mask(hndl,SD_INFO1_MASK_RESP,0);
+	#if		(TARGET_RZ_A1 == 1)
+	if( dma_64 == SD_MODE_DMA_64 ){
+		sd_outp(hndl,EXT_SWAP,0x0100);		/* Set DMASEL for 64byte transfer */
+	}
+	#endif
+	sd_outp(hndl,CC_EXT_MODE,(unsigned short)(sd_inp(hndl,CC_EXT_MODE) | CC_EXT_MODE_DMASDRW));	/* enable DMA */
+
+	/* issue CMD18 (READ_MULTIPLE_BLOCK) */
+	if(_sd_send_mcmd(hndl,CMD18,SET_ACC_ADDR) != SD_OK){
+		goto ErrExit_DMA;
+	}
+
+	/* ==== one DMA transfer per buffer ==== */
+	for(b=0; b<numBuffs; b++,cnt-=sectsPerBuff){
+		buffCnt = (cnt < sectsPerBuff) ? cnt : sectsPerBuff;
+
+		/* doActualReadRohan leaves DMA disabled when it's done */
+		sd_outp(hndl,CC_EXT_MODE,(unsigned short)(sd_inp(hndl,CC_EXT_MODE) | CC_EXT_MODE_DMASDRW));
+
+		ret = doActualReadRohan(sd_port, hndl, buffs[b], buffCnt, mode, dma_64);
+		if(ret != SD_OK){
+			goto ErrExit;
+		}
+
+		// Invalidate ram
+		v7_dma_inv_range((uintptr_t)buffs[b], (uintptr_t)(buffs[b] + buffCnt * 512));
+	}
+
+	/* ---- wait All end interrupt ---- */
+	logAudioAction("0d");
+	if(sddev_int_wait(sd_port, SD_TIMEOUT_RESP) != SD_OK){
+		_sd_set_err(hndl,SD_ERR_HOST_TOE);
+		goto ErrExit;
+	}
+
+	/* ---- check errors ---- */
+	if(hndl->int_info2&SD_INFO2_MASK_ERR){
+		_sd_check_info2_err(hndl);
+		goto ErrExit;
+	}
+
+	/* clear All end bit */
+	_sd_clear_info(hndl,SD_INFO1_MASK_DATA_TRNS,0x0000);
+
+	/* disable All end, BRE and errors */
+	_sd_clear_int_mask(hndl,SD_INFO1_MASK_DATA_TRNS,SD_INFO2_MASK_BRE);
+
+	/* ==== check status after read operation ==== */
+	if(_sd_card_send_cmd_arg(hndl,CMD13,SD_RESP_R1,hndl->rca[0],0x0000) != SD_OK){
+		goto ErrExit;
+	}
+	if((hndl->resp_status & RES_STATE) != STATE_TRAN){
+		hndl->error = SD_ERR;
+		goto ErrExit;
+	}
+
+	/* ---- is stop compulsory? ---- */
+	if(hndl->stop){
+		hndl->stop = 0;
+		/* data transfer stop (issue CMD12) */
+		sd_outp(hndl,SD_STOP,0x0001);
+		_sd_set_err(hndl,SD_ERR_STOP);
+	}
+
+	#if		(TARGET_RZ_A1 == 1)
+	sd_outp(hndl,EXT_SWAP,0x0000);		/* Clear DMASEL for 64byte transfer */
+	#endif
+
+	/* ---- halt clock ---- */
+	_sd_set_clock(hndl,0,SD_CLOCK_DISABLE);
+
+	return hndl->error;
+
+ErrExit_DMA:
+ErrExit:
+	return _sd_read_sect_abort(sd_port, hndl, mode);
+}
+
 /*****************************************************************************
  * ID           :
  * Summary      : read sector data from card by single block transfer
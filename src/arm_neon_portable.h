@@ -0,0 +1,406 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef ARM_NEON_PORTABLE_H
+#define ARM_NEON_PORTABLE_H
+
+// Bit-exact emulation of the NEON intrinsics the firmware uses, for building the DSP kernels on hosts without NEON
+// (i.e. the unit tests and benchmarks). Vectors are GCC/Clang generic vectors, so the plain lane-wise operations
+// compile to SSE2 on x86; the saturating and widening multiplies are done per lane in scalar code, following the
+// pseudocode in the Arm architecture reference manual.
+//
+// Only intrinsics the firmware actually calls are provided. If a kernel needs a new one, add it here with the same
+// semantics as the real thing - the unit tests rely on this matching the hardware exactly.
+
+#include <stdint.h>
+#include <string.h>
+
+typedef int8_t int8x8_t __attribute__((vector_size(8)));
+typedef int8_t int8x16_t __attribute__((vector_size(16)));
+typedef int16_t int16x4_t __attribute__((vector_size(8)));
+typedef int16_t int16x8_t __attribute__((vector_size(16)));
+typedef int32_t int32x2_t __attribute__((vector_size(8)));
+typedef int32_t int32x4_t __attribute__((vector_size(16)));
+typedef int64_t int64x2_t __attribute__((vector_size(16)));
+typedef uint8_t uint8x8_t __attribute__((vector_size(8)));
+typedef uint8_t uint8x16_t __attribute__((vector_size(16)));
+typedef uint16_t uint16x4_t __attribute__((vector_size(8)));
+typedef uint16_t uint16x8_t __attribute__((vector_size(16)));
+typedef uint32_t uint32x2_t __attribute__((vector_size(8)));
+typedef uint32_t uint32x4_t __attribute__((vector_size(16)));
+typedef float float32_t;
+typedef float float32x2_t __attribute__((vector_size(8)));
+typedef float float32x4_t __attribute__((vector_size(16)));
+
+typedef struct int16x8x4_t {
+	int16x8_t val[4];
+} int16x8x4_t;
+
+typedef struct int32x4x2_t {
+	int32x4_t val[2];
+} int32x4x2_t;
+
+#define NEON_PORTABLE_INLINE static inline __attribute__((always_inline, unused))
+
+NEON_PORTABLE_INLINE int32_t neon_portable_sat32(int64_t value) {
+	return value > INT32_MAX ? INT32_MAX : value < INT32_MIN ? INT32_MIN : (int32_t)value;
+}
+
+NEON_PORTABLE_INLINE int16_t neon_portable_sat16(int32_t value) {
+	return value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : (int16_t)value;
+}
+
+/* Loads, stores and lane access */
+
+NEON_PORTABLE_INLINE int32x4_t vld1q_s32(const int32_t* ptr) {
+	int32x4_t out;
+	memcpy(&out, ptr, sizeof(out));
+	return out;
+}
+
+NEON_PORTABLE_INLINE uint32x4_t vld1q_u32(const uint32_t* ptr) {
+	uint32x4_t out;
+	memcpy(&out, ptr, sizeof(out));
+	return out;
+}
+
+NEON_PORTABLE_INLINE int16x8_t vld1q_s16(const int16_t* ptr) {
+	int16x8_t out;
+	memcpy(&out, ptr, sizeof(out));
+	return out;
+}
+
+// The wave renderers read from 16-bit aligned addresses, which NEON allows, so this must not assume alignment
+NEON_PORTABLE_INLINE uint32x4_t vld1q_lane_u32(const uint32_t* ptr, uint32x4_t vec, int lane) {
+	uint32_t value;
+	memcpy(&value, ptr, sizeof(value));
+	vec[lane] = value;
+	return vec;
+}
+
+NEON_PORTABLE_INLINE int16x8x4_t vld4q_s16(const int16_t* ptr) {
+	int16x8x4_t out;
+	for (int i = 0; i < 8; i++) {
+		for (int j = 0; j < 4; j++) {
+			out.val[j][i] = ptr[i * 4 + j];
+		}
+	}
+	return out;
+}
+
+NEON_PORTABLE_INLINE int32x4x2_t vld2q_s32(const int32_t* ptr) {
+	int32x4x2_t out;
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 2; j++) {
+			out.val[j][i] = ptr[i * 2 + j];
+		}
+	}
+	return out;
+}
+
+NEON_PORTABLE_INLINE void vst2q_s32(int32_t* ptr, int32x4x2_t vecs) {
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 2; j++) {
+			ptr[i * 2 + j] = vecs.val[j][i];
+		}
+	}
+}
+
+NEON_PORTABLE_INLINE void vst1q_s32(int32_t* ptr, int32x4_t vec) {
+	memcpy(ptr, &vec, sizeof(vec));
+}
+
+NEON_PORTABLE_INLINE void vst1q_lane_s32(int32_t* ptr, int32x4_t vec, int lane) {
+	*ptr = vec[lane];
+}
+
+NEON_PORTABLE_INLINE void vst1q_u32(uint32_t* ptr, uint32x4_t vec) {
+	memcpy(ptr, &vec, sizeof(vec));
+}
+
+NEON_PORTABLE_INLINE int16x4_t vdup_n_s16(int16_t value) {
+	return (int16x4_t){value, value, value, value};
+}
+
+NEON_PORTABLE_INLINE int32x4_t vdupq_n_s32(int32_t value) {
+	return (int32x4_t){value, value, value, value};
+}
+
+NEON_PORTABLE_INLINE uint32x4_t vdupq_n_u32(uint32_t value) {
+	return (uint32x4_t){value, value, value, value};
+}
+
+NEON_PORTABLE_INLINE int16x4_t vset_lane_s16(int16_t value, int16x4_t vec, int lane) {
+	vec[lane] = value;
+	return vec;
+}
+
+NEON_PORTABLE_INLINE uint16x4_t vset_lane_u16(uint16_t value, uint16x4_t vec, int lane) {
+	vec[lane] = value;
+	return vec;
+}
+
+NEON_PORTABLE_INLINE int32x4_t vsetq_lane_s32(int32_t value, int32x4_t vec, int lane) {
+	vec[lane] = value;
+	return vec;
+}
+
+NEON_PORTABLE_INLINE uint32x4_t vsetq_lane_u32(uint32_t value, uint32x4_t vec, int lane) {
+	vec[lane] = value;
+	return vec;
+}
+
+NEON_PORTABLE_INLINE int32_t vget_lane_s32(int32x2_t vec, int lane) {
+	return vec[lane];
+}
+
+NEON_PORTABLE_INLINE int32_t vgetq_lane_s32(int32x4_t vec, int lane) {
+	return vec[lane];
+}
+
+NEON_PORTABLE_INLINE uint32_t vgetq_lane_u32(uint32x4_t vec, int lane) {
+	return vec[lane];
+}
+
+NEON_PORTABLE_INLINE int16x4_t vget_low_s16(int16x8_t vec) {
+	return (int16x4_t){vec[0], vec[1], vec[2], vec[3]};
+}
+
+NEON_PORTABLE_INLINE int16x4_t vget_high_s16(int16x8_t vec) {
+	return (int16x4_t){vec[4], vec[5], vec[6], vec[7]};
+}
+
+NEON_PORTABLE_INLINE int32x2_t vget_low_s32(int32x4_t vec) {
+	return (int32x2_t){vec[0], vec[1]};
+}
+
+NEON_PORTABLE_INLINE int32x2_t vget_high_s32(int32x4_t vec) {
+	return (int32x2_t){vec[2], vec[3]};
+}
+
+NEON_PORTABLE_INLINE int32x4_t vcombine_s32(int32x2_t low, int32x2_t high) {
+	return (int32x4_t){low[0], low[1], high[0], high[1]};
+}
+
+NEON_PORTABLE_INLINE int16x4_t vreinterpret_s16_u16(uint16x4_t vec) {
+	return (int16x4_t)vec;
+}
+
+NEON_PORTABLE_INLINE int32x4_t vreinterpretq_s32_u32(uint32x4_t vec) {
+	return (int32x4_t)vec;
+}
+
+NEON_PORTABLE_INLINE uint32x4_t vreinterpretq_u32_s32(int32x4_t vec) {
+	return (uint32x4_t)vec;
+}
+
+/* Wrapping arithmetic and logic. Signed lanes go through unsigned so overflow wraps, as on the hardware. */
+
+NEON_PORTABLE_INLINE int32x2_t vadd_s32(int32x2_t a, int32x2_t b) {
+	return (int32x2_t)((uint32x2_t)a + (uint32x2_t)b);
+}
+
+NEON_PORTABLE_INLINE int32x4_t vaddq_s32(int32x4_t a, int32x4_t b) {
+	return (int32x4_t)((uint32x4_t)a + (uint32x4_t)b);
+}
+
+NEON_PORTABLE_INLINE uint32x4_t vaddq_u32(uint32x4_t a, uint32x4_t b) {
+	return a + b;
+}
+
+NEON_PORTABLE_INLINE int16x8_t vaddq_s16(int16x8_t a, int16x8_t b) {
+	return (int16x8_t)((uint16x8_t)a + (uint16x8_t)b);
+}
+
+NEON_PORTABLE_INLINE int32x4_t vsubq_s32(int32x4_t a, int32x4_t b) {
+	return (int32x4_t)((uint32x4_t)a - (uint32x4_t)b);
+}
+
+NEON_PORTABLE_INLINE int32x4_t vmulq_n_s32(int32x4_t a, int32_t b) {
+	return (int32x4_t)((uint32x4_t)a * (uint32_t)b);
+}
+
+NEON_PORTABLE_INLINE uint32x4_t vmlaq_u32(uint32x4_t acc, uint32x4_t a, uint32x4_t b) {
+	return acc + a * b;
+}
+
+NEON_PORTABLE_INLINE int32x4_t vmaxq_s32(int32x4_t a, int32x4_t b) {
+	return a > b ? a : b;
+}
+
+NEON_PORTABLE_INLINE int32x4_t vminq_s32(int32x4_t a, int32x4_t b) {
+	return a < b ? a : b;
+}
+
+NEON_PORTABLE_INLINE int16x4_t vsub_s16(int16x4_t a, int16x4_t b) {
+	return (int16x4_t)((uint16x4_t)a - (uint16x4_t)b);
+}
+
+NEON_PORTABLE_INLINE int16x8_t vsubq_s16(int16x8_t a, int16x8_t b) {
+	return (int16x8_t)((uint16x8_t)a - (uint16x8_t)b);
+}
+
+NEON_PORTABLE_INLINE int32x2_t vpadd_s32(int32x2_t a, int32x2_t b) {
+	return (int32x2_t){(int32_t)((uint32_t)a[0] + (uint32_t)a[1]), (int32_t)((uint32_t)b[0] + (uint32_t)b[1])};
+}
+
+NEON_PORTABLE_INLINE int16x4_t vorr_s16(int16x4_t a, int16x4_t b) {
+	return a | b;
+}
+
+NEON_PORTABLE_INLINE int16x4_t vand_s16(int16x4_t a, int16x4_t b) {
+	return a & b;
+}
+
+NEON_PORTABLE_INLINE int32x4_t vandq_s32(int32x4_t a, int32x4_t b) {
+	return a & b;
+}
+
+NEON_PORTABLE_INLINE int32x4_t veorq_s32(int32x4_t a, int32x4_t b) {
+	return a ^ b;
+}
+
+/* Shifts */
+
+NEON_PORTABLE_INLINE uint16x4_t vshr_n_u16(uint16x4_t vec, int n) {
+	return vec >> n;
+}
+
+NEON_PORTABLE_INLINE int32x4_t vshlq_n_s32(int32x4_t vec, int n) {
+	return (int32x4_t)((uint32x4_t)vec << n);
+}
+
+NEON_PORTABLE_INLINE uint32x4_t vshlq_n_u32(uint32x4_t vec, int n) {
+	return vec << n;
+}
+
+// arithmetic, like the hardware
+NEON_PORTABLE_INLINE int32x4_t vshrq_n_s32(int32x4_t vec, int n) {
+	return vec >> n;
+}
+
+NEON_PORTABLE_INLINE int32x4_t vshll_n_s16(int16x4_t vec, int n) {
+	int32x4_t out;
+	for (int i = 0; i < 4; i++) {
+		out[i] = (int32_t)((uint32_t)(int32_t)vec[i] << n);
+	}
+	return out;
+}
+
+NEON_PORTABLE_INLINE uint16x4_t vshrn_n_u32(uint32x4_t vec, int n) {
+	uint16x4_t out;
+	for (int i = 0; i < 4; i++) {
+		out[i] = (uint16_t)(vec[i] >> n);
+	}
+	return out;
+}
+
+NEON_PORTABLE_INLINE int16x4_t vshrn_n_s32(int32x4_t vec, int n) {
+	int16x4_t out;
+	for (int i = 0; i < 4; i++) {
+		out[i] = (int16_t)(vec[i] >> n);
+	}
+	return out;
+}
+
+NEON_PORTABLE_INLINE int32x2_t vshrn_n_s64(int64x2_t vec, int n) {
+	return (int32x2_t){(int32_t)(vec[0] >> n), (int32_t)(vec[1] >> n)};
+}
+
+// the rounding constant is added at full precision, which the second shift reproduces without overflowing 64 bits
+NEON_PORTABLE_INLINE int32x2_t vrshrn_n_s64(int64x2_t vec, int n) {
+	return (int32x2_t){(int32_t)((vec[0] >> n) + ((vec[0] >> (n - 1)) & 1)),
+	                   (int32_t)((vec[1] >> n) + ((vec[1] >> (n - 1)) & 1))};
+}
+
+NEON_PORTABLE_INLINE uint16x4_t vmovn_u32(uint32x4_t vec) {
+	uint16x4_t out;
+	for (int i = 0; i < 4; i++) {
+		out[i] = (uint16_t)vec[i];
+	}
+	return out;
+}
+
+/* Multiplies */
+
+NEON_PORTABLE_INLINE int32x4_t vmull_s16(int16x4_t a, int16x4_t b) {
+	int32x4_t out;
+	for (int i = 0; i < 4; i++) {
+		out[i] = (int32_t)a[i] * b[i];
+	}
+	return out;
+}
+
+NEON_PORTABLE_INLINE int32x4_t vmlal_s16(int32x4_t acc, int16x4_t a, int16x4_t b) {
+	for (int i = 0; i < 4; i++) {
+		acc[i] = (int32_t)((uint32_t)acc[i] + (uint32_t)((int32_t)a[i] * b[i]));
+	}
+	return acc;
+}
+
+NEON_PORTABLE_INLINE int64x2_t vmull_s32(int32x2_t a, int32x2_t b) {
+	return (int64x2_t){(int64_t)a[0] * b[0], (int64_t)a[1] * b[1]};
+}
+
+// saturating doubling multiply long: only -32768 * -32768 saturates
+NEON_PORTABLE_INLINE int32x4_t vqdmull_s16(int16x4_t a, int16x4_t b) {
+	int32x4_t out;
+	for (int i = 0; i < 4; i++) {
+		out[i] = neon_portable_sat32(2 * (int64_t)a[i] * b[i]);
+	}
+	return out;
+}
+
+// the product is saturated before the accumulate, and the accumulate is saturated again
+NEON_PORTABLE_INLINE int32x4_t vqdmlal_s16(int32x4_t acc, int16x4_t a, int16x4_t b) {
+	for (int i = 0; i < 4; i++) {
+		acc[i] = neon_portable_sat32((int64_t)acc[i] + neon_portable_sat32(2 * (int64_t)a[i] * b[i]));
+	}
+	return acc;
+}
+
+NEON_PORTABLE_INLINE int16x8_t vqdmulhq_n_s16(int16x8_t a, int16_t b) {
+	int16x8_t out;
+	for (int i = 0; i < 8; i++) {
+		out[i] = neon_portable_sat16(((int32_t)a[i] * b) >> 15);
+	}
+	return out;
+}
+
+NEON_PORTABLE_INLINE int32x4_t vqdmulhq_s32(int32x4_t a, int32x4_t b) {
+	int32x4_t out;
+	for (int i = 0; i < 4; i++) {
+		out[i] = neon_portable_sat32(((int64_t)a[i] * b[i]) >> 31);
+	}
+	return out;
+}
+
+// (2ab + 2^31) >> 32, computed as (ab + 2^30) >> 31 so the intermediate can't overflow
+NEON_PORTABLE_INLINE int32x4_t vqrdmulhq_s32(int32x4_t a, int32x4_t b) {
+	int32x4_t out;
+	for (int i = 0; i < 4; i++) {
+		out[i] = neon_portable_sat32(((int64_t)a[i] * b[i] + (1ll << 30)) >> 31);
+	}
+	return out;
+}
+
+NEON_PORTABLE_INLINE int32x4_t vqrdmulhq_n_s32(int32x4_t a, int32_t b) {
+	return vqrdmulhq_s32(a, vdupq_n_s32(b));
+}
+
+#undef NEON_PORTABLE_INLINE
+
+#endif // ARM_NEON_PORTABLE_H
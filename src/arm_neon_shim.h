@@ -24,7 +24,10 @@
 #define ARM_NEON_SHIM_H
 // this exists to make clang happy because it doesn't use the same types as gcc neon.
 // clangd defins __GNUC__ for us so can't check on that
-#ifndef __clang__
+// Host builds (unit tests, benchmarks) have no NEON at all, so get a portable emulation of the intrinsics we use instead
+#if !defined(__arm__) && !defined(__aarch64__)
+#include "arm_neon_portable.h" // IWYU pragma: export
+#elif !defined(__clang__)
 #include "arm_neon.h" // IWYU pragma: export
 #else
 
@@ -338,5 +341,5 @@ typedef struct poly64x2x4_t {
 	poly64x2_t val[4];
 } poly64x2x4_t;
 #endif
-#endif // ndef clang
+#endif // host / gcc / clang
 #endif // ARM_NEON_SHIM_H
@@ -40,6 +40,7 @@
 #include "gui/views/instrument_clip_view.h"
 #include "gui/views/session_view.h"
 #include "gui/views/view.h"
+#include "gui/waveform/waveform_renderer.h"
 #include "hid/buttons.h"
 #include "hid/display/display.h"
 #include "hid/display/oled.h"
@@ -59,6 +60,7 @@
 #include "model/output.h"
 #include "model/settings/runtime_feature_settings.h"
 #include "model/song/song.h"
+#include "model/song/song_preloader.h"
 #include "modulation/params/param_manager.h"
 #include "playback/mode/arrangement.h"
 #include "playback/mode/session.h"
@@ -595,6 +597,9 @@ void registerTasks() {
 	addRepeatingTask(&doAnyPendingUIRendering, p++, 0.01, 0.01, 0.03, "pending UI");
 	// this one actually actions them
 	addRepeatingTask([]() { encoders::interpretEncoders(false); }, p++, 0.005, 0.005, 0.01, "interpret encoders slow");
+	// tops up the blocks the audio routine allocates from, one block per call
+	addRepeatingTask([]() { GeneralMemoryAllocator::get().refillRealtimeReserve(); }, p++, 0.002, 0.01, 0.05,
+	                 "refill rt memory");
 
 	// 21-29: Low priority (30 for dyn tasks)
 	p = 21;
@@ -604,6 +609,10 @@ void registerTasks() {
 	addRepeatingTask([]() { audioRecorder.slowRoutine(); }, p++, 0.01, 0.1, 0.1, "audio recorder slow");
 	// formerly part of cluster loading (why? no idea), actions undo/redo midi commands
 	addRepeatingTask([]() { playbackHandler.slowRoutine(); }, p++, 0.01, 0.1, 0.1, "playback routine");
+	// reads in the next song of the folder while this one plays, a step at a time
+	addRepeatingTask([]() { songPreloader.routine(); }, p++, 0.05, 0.1, 0.5, "preload next song");
+	// reads the rest of a long sample being looked at, for its waveform peaks
+	addRepeatingTask([]() { waveformRenderer.findPeaksRoutine(); }, p++, 0.005, 0.02, 0.2, "waveform peaks");
 	// 31-39: Idle priority (40 for dyn tasks)
 	p = 31;
 	addRepeatingTask(&(PIC::flush), p++, 0.001, 0.001, 0.02, "PIC flush");
@@ -26,6 +26,11 @@ namespace deluge::dsp::filter {
 constexpr int32_t ONE_Q16 = 134217728;
 
 extern q31_t blendBuffer[SSI_TX_BUFFER_NUM_SAMPLES * 2];
+
+// Filters several voices at once across NEON lanes, working on the filters' state directly. It lives with the host
+// unit tests (tests/unit/filter_batch_renderer.h), which compare it against rendering voices one at a time
+class FilterBatch;
+
 /**
  *  Interface for filters in the sound engine
  * This is a CRTP base class for all filters used in the sound engine. To implement a new filter,
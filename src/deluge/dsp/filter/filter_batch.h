@@ -0,0 +1,53 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "arm_neon_shim.h"
+#include "util/fixedpoint.h"
+#include <cstdint>
+
+/*
+ * Fixed point arithmetic on kBatchSize values at once, one per NEON lane, for DSP that keeps several voices, taps or
+ * channels in a vector. The lane functions match their scalar namesakes in fixedpoint.h bit for bit, so code built on
+ * them renders exactly what the scalar version would.
+ */
+namespace deluge::dsp::filter {
+
+constexpr int32_t kBatchSize = 4;
+
+namespace lanes {
+
+using q31x4_t = int32x4_t;
+
+[[gnu::always_inline]] inline q31x4_t multiply_32x32_rshift32(q31x4_t a, q31x4_t b) {
+	return vcombine_s32(vshrn_n_s64(vmull_s32(vget_low_s32(a), vget_low_s32(b)), 32),
+	                    vshrn_n_s64(vmull_s32(vget_high_s32(a), vget_high_s32(b)), 32));
+}
+
+[[gnu::always_inline]] inline q31x4_t multiply_32x32_rshift32_rounded(q31x4_t a, q31x4_t b) {
+	return vcombine_s32(vrshrn_n_s64(vmull_s32(vget_low_s32(a), vget_low_s32(b)), 32),
+	                    vrshrn_n_s64(vmull_s32(vget_high_s32(a), vget_high_s32(b)), 32));
+}
+
+// the accumulator only ever lands in the top word, so it can be added after rounding without changing the result
+[[gnu::always_inline]] inline q31x4_t multiply_accumulate_32x32_rshift32_rounded(q31x4_t sum, q31x4_t a, q31x4_t b) {
+	return vaddq_s32(sum, multiply_32x32_rshift32_rounded(a, b));
+}
+
+} // namespace lanes
+} // namespace deluge::dsp::filter
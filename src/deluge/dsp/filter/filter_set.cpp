@@ -194,5 +194,9 @@ int32_t FilterSet::setConfig(q31_t lpfFrequency, q31_t lpfResonance, FilterMode
 void FilterSet::reset() {
 	memset(&lpfilter, 0, sizeof(LowPass));
 	memset(&hpfilter, 0, sizeof(HighPass));
+	// Modes neither filter can be in, so the next setConfig() starts whichever it's in afresh, without fading it in.
+	// Otherwise that depended on what this voice last played - or, the first time, whatever was in its memory
+	lastLPFMode_ = FilterMode::HPLADDER;
+	lastHPFMode_ = FilterMode::TRANSISTOR_12DB;
 }
 } // namespace deluge::dsp::filter
@@ -59,6 +59,8 @@ public:
 	inline bool isOn() { return HPFOn || LPFOn; }
 
 private:
+	friend class FilterBatch;
+
 	FilterMode lpfMode_;
 	FilterMode lastLPFMode_;
 	FilterMode hpfMode_;
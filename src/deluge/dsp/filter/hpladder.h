@@ -36,6 +36,8 @@ public:
 	}
 
 private:
+	friend class FilterBatch;
+
 	struct HPLadderState {
 		BasicFilterComponent hpfHPF1;
 		BasicFilterComponent hpfLPF1;
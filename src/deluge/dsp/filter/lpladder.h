@@ -36,6 +36,8 @@ public:
 	}
 
 private:
+	friend class FilterBatch;
+
 	struct LpLadderState {
 		q31_t noiseLastValue;
 		BasicFilterComponent lpfLPF1;
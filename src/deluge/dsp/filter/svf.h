@@ -35,6 +35,8 @@ public:
 	}
 
 private:
+	friend class FilterBatch;
+
 	struct SVFState {
 		q31_t low;
 		q31_t band;
@@ -0,0 +1,337 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "dsp/mod_fx/mod_fx.h"
+#include "arm_neon_shim.h"
+#include "dsp/filter/filter_batch.h"
+#include "util/fixedpoint.h"
+#include "util/waves.h"
+#include <algorithm>
+#include <array>
+
+namespace deluge::dsp::mod_fx {
+
+namespace {
+
+using filter::lanes::q31x4_t;
+
+/// How many samples' LFO values, and the phaser coefficients or delay taps they give, are worked out before rendering
+/// any of them
+constexpr size_t kChunkSize = 32;
+
+constexpr LFOType lfoTypeFor(ModFXType type) {
+	return (type == ModFXType::FLANGER) ? LFOType::TRIANGLE : LFOType::SINE;
+}
+
+/// One sample of the chorus or flanger
+template <ModFXType type>
+[[gnu::always_inline]] inline void delaySample(StereoSample& sample, int32_t lfoOutput, DelayLine line,
+                                               DelayParams const& params) {
+	StereoSample* buffer = line.buffer;
+	int32_t delayTime = multiply_32x32_rshift32(lfoOutput, params.depth) + params.offset;
+
+	int32_t strength2 = (delayTime & 65535) << 15;
+	int32_t strength1 = (65535 << 15) - strength2;
+	int32_t sample1Pos = line.writeIndex - ((delayTime) >> 16);
+
+	int32_t scaledValue1L = multiply_32x32_rshift32_rounded(buffer[sample1Pos & kModFXBufferIndexMask].l, strength1);
+	int32_t scaledValue2L =
+	    multiply_32x32_rshift32_rounded(buffer[(sample1Pos - 1) & kModFXBufferIndexMask].l, strength2);
+	int32_t modFXOutputL = scaledValue1L + scaledValue2L;
+
+	if constexpr (type == ModFXType::CHORUS_STEREO) {
+		delayTime = multiply_32x32_rshift32(lfoOutput, -params.depth) + params.offset;
+		strength2 = (delayTime & 65535) << 15;
+		strength1 = (65535 << 15) - strength2;
+		sample1Pos = line.writeIndex - ((delayTime) >> 16);
+	}
+
+	int32_t scaledValue1R = multiply_32x32_rshift32_rounded(buffer[sample1Pos & kModFXBufferIndexMask].r, strength1);
+	int32_t scaledValue2R =
+	    multiply_32x32_rshift32_rounded(buffer[(sample1Pos - 1) & kModFXBufferIndexMask].r, strength2);
+	int32_t modFXOutputR = scaledValue1R + scaledValue2R;
+
+	if constexpr (type == ModFXType::FLANGER) {
+		modFXOutputL = multiply_32x32_rshift32_rounded(modFXOutputL, params.feedback) << 2;
+		buffer[line.writeIndex].l = modFXOutputL + sample.l; // Feedback
+		modFXOutputR = multiply_32x32_rshift32_rounded(modFXOutputR, params.feedback) << 2;
+		buffer[line.writeIndex].r = modFXOutputR + sample.r; // Feedback
+	}
+
+	else { // Chorus
+		modFXOutputL <<= 1;
+		buffer[line.writeIndex].l = sample.l; // Feedback
+		modFXOutputR <<= 1;
+		buffer[line.writeIndex].r = sample.r; // Feedback
+	}
+
+	sample.l += modFXOutputL;
+	sample.r += modFXOutputR;
+	line.writeIndex = (line.writeIndex + 1) & kModFXBufferIndexMask;
+}
+
+/// The phaser's allpass coefficient for an LFO value. "1" is sorta represented by 1073741824 here
+[[gnu::always_inline]] inline int32_t phaserCoefficient(int32_t lfoOutput, int32_t depth) {
+	return 1073741824 - multiply_32x32_rshift32_rounded((((uint32_t)lfoOutput + (uint32_t)2147483648) >> 1), depth);
+}
+
+/// One sample of the phaser. Each allpass depends on the one before and each sample on the last, so this stays a
+/// sample at a time - and the two channels are already independent work for the core to overlap
+[[gnu::always_inline]] inline void phaserSample(StereoSample& sample, int32_t _a1, PhaserState state,
+                                                int32_t feedback) {
+	StereoSample& phaserMemory = state.memory;
+	phaserMemory.l = sample.l + (multiply_32x32_rshift32_rounded(phaserMemory.l, feedback) << 1);
+	phaserMemory.r = sample.r + (multiply_32x32_rshift32_rounded(phaserMemory.r, feedback) << 1);
+
+	// Do the allpass filters
+	for (auto& allpass : state.allpassMemory) {
+		StereoSample whatWasInput = phaserMemory;
+
+		phaserMemory.l = (multiply_32x32_rshift32_rounded(phaserMemory.l, -_a1) << 2) + allpass.l;
+		allpass.l = (multiply_32x32_rshift32_rounded(phaserMemory.l, _a1) << 2) + whatWasInput.l;
+
+		phaserMemory.r = (multiply_32x32_rshift32_rounded(phaserMemory.r, -_a1) << 2) + allpass.r;
+		allpass.r = (multiply_32x32_rshift32_rounded(phaserMemory.r, _a1) << 2) + whatWasInput.r;
+	}
+
+	sample.l += phaserMemory.l;
+	sample.r += phaserMemory.r;
+}
+
+/// The LFO's value for each of the next kBlockSize samples, leaving it where rendering them one at a time would
+template <LFOType waveType>
+[[gnu::always_inline]] inline q31x4_t renderLFO(LFO& lfo, uint32_t rate) {
+	static constexpr uint32_t kSteps[kBlockSize] = {0, 1, 2, 3};
+	uint32x4_t phases = vmlaq_u32(vdupq_n_u32(lfo.phase), vdupq_n_u32(rate), vld1q_u32(kSteps));
+	lfo.tick(kBlockSize, rate);
+
+	if constexpr (waveType == LFOType::TRIANGLE) {
+		// getTriangle(): twice the phase - or its complement once past half way - made signed
+		q31x4_t doubled = vreinterpretq_s32_u32(vshlq_n_u32(phases, 1));
+		q31x4_t pastHalfWay = vshrq_n_s32(vreinterpretq_s32_u32(phases), 31);
+		return veorq_s32(veorq_s32(doubled, pastHalfWay), vdupq_n_s32(INT32_MIN));
+	}
+	else {
+		// The table lookup can't be vectorised, so a lane at a time
+		uint32_t phaseLanes[kBlockSize];
+		int32_t values[kBlockSize];
+		vst1q_u32(phaseLanes, phases);
+		for (int32_t lane = 0; lane < kBlockSize; lane++) {
+			values[lane] = getSine(phaseLanes[lane]);
+		}
+		return vld1q_s32(values);
+	}
+}
+
+/// Where each sample of a chunk reads from in the delay buffer, and how much of each of the two samples either side
+struct Taps {
+	int32_t strength1[kChunkSize];
+	int32_t strength2[kChunkSize];
+	int32_t sample1Pos[kChunkSize];
+};
+
+/// Fills in the taps for the block starting at sample i of the chunk, whose first sample goes in the delay buffer at
+/// writeIndex. Returns whether no lane reads anything an earlier lane in the block writes
+[[gnu::always_inline]] inline bool getTaps(q31x4_t lfoOutput, int32_t depth, int32_t offset, int32_t writeIndex,
+                                           Taps& taps, size_t i) {
+	static constexpr int32_t kLanes[kBlockSize] = {0, 1, 2, 3};
+	q31x4_t delayTime =
+	    vaddq_s32(filter::lanes::multiply_32x32_rshift32(lfoOutput, vdupq_n_s32(depth)), vdupq_n_s32(offset));
+	q31x4_t strength2 = vshlq_n_s32(vandq_s32(delayTime, vdupq_n_s32(65535)), 15);
+	vst1q_s32(&taps.strength2[i], strength2);
+	vst1q_s32(&taps.strength1[i], vsubq_s32(vdupq_n_s32(65535 << 15), strength2));
+
+	q31x4_t delaySamples = vshrq_n_s32(delayTime, 16);
+	q31x4_t writeIndices = vaddq_s32(vdupq_n_s32(writeIndex), vld1q_s32(kLanes));
+	vst1q_s32(&taps.sample1Pos[i], vsubq_s32(writeIndices, delaySamples));
+
+	// Lane n reads the samples delaySamples and delaySamples + 1 before its own, one of which lanes 0 to n - 1 are
+	// about to write if delaySamples is n or less. The flanger at the bottom of its sweep gets that close
+	int32_t distances[kBlockSize];
+	vst1q_s32(distances, vandq_s32(delaySamples, vdupq_n_s32(kModFXBufferIndexMask)));
+	return distances[1] > 1 && distances[2] > 2 && distances[3] > 3;
+}
+
+/// The interpolated delay buffer reads for one channel of the block starting at sample i of the chunk. NEON can't
+/// gather, so the reads themselves are a lane at a time
+template <q31_t StereoSample::*channel>
+[[gnu::always_inline]] inline q31x4_t readTaps(StereoSample const* buffer, Taps const& taps, size_t i) {
+	int32_t values1[kBlockSize];
+	int32_t values2[kBlockSize];
+	for (int32_t lane = 0; lane < kBlockSize; lane++) {
+		values1[lane] = buffer[taps.sample1Pos[i + lane] & kModFXBufferIndexMask].*channel;
+		values2[lane] = buffer[(taps.sample1Pos[i + lane] - 1) & kModFXBufferIndexMask].*channel;
+	}
+	return vaddq_s32(
+	    filter::lanes::multiply_32x32_rshift32_rounded(vld1q_s32(values1), vld1q_s32(&taps.strength1[i])),
+	    filter::lanes::multiply_32x32_rshift32_rounded(vld1q_s32(values2), vld1q_s32(&taps.strength2[i])));
+}
+
+template <ModFXType type>
+void renderDelayBlocks(std::span<StereoSample> audio, DelayLine line, LFO& lfo, DelayParams const& params) {
+	constexpr LFOType waveType = lfoTypeFor(type);
+	constexpr bool stereo = (type == ModFXType::CHORUS_STEREO);
+	size_t numBlockSamples = audio.size() & ~(size_t)(kBlockSize - 1);
+
+	for (size_t chunkStart = 0; chunkStart < numBlockSamples; chunkStart += kChunkSize) {
+		size_t chunkSize = std::min<size_t>(kChunkSize, numBlockSamples - chunkStart);
+		StereoSample* chunk = &audio[chunkStart];
+
+		// The LFO and where it puts the taps for the whole chunk first, a block at a time
+		int32_t lfoOutputs[kChunkSize];
+		Taps tapsL;
+		Taps tapsStereo;
+		Taps const& tapsR = stereo ? tapsStereo : tapsL;
+		bool independent[kChunkSize / kBlockSize];
+		for (size_t i = 0; i < chunkSize; i += kBlockSize) {
+			q31x4_t lfoOutput = renderLFO<waveType>(lfo, params.rate);
+			vst1q_s32(&lfoOutputs[i], lfoOutput);
+			int32_t writeIndex = line.writeIndex + i;
+			independent[i / kBlockSize] = getTaps(lfoOutput, params.depth, params.offset, writeIndex, tapsL, i);
+			if constexpr (stereo) {
+				independent[i / kBlockSize] &=
+				    getTaps(lfoOutput, -params.depth, params.offset, writeIndex, tapsStereo, i);
+			}
+		}
+
+		for (size_t i = 0; i < chunkSize; i += kBlockSize) {
+			if (!independent[i / kBlockSize]) {
+				for (int32_t lane = 0; lane < kBlockSize; lane++) {
+					delaySample<type>(chunk[i + lane], lfoOutputs[i + lane], line, params);
+				}
+				continue;
+			}
+
+			q31x4_t modFXOutputL = readTaps<&StereoSample::l>(line.buffer, tapsL, i);
+			q31x4_t modFXOutputR = readTaps<&StereoSample::r>(line.buffer, tapsR, i);
+			int32x4x2_t input = vld2q_s32(&chunk[i].l);
+			int32x4x2_t written;
+
+			if constexpr (type == ModFXType::FLANGER) {
+				q31x4_t feedback = vdupq_n_s32(params.feedback);
+				modFXOutputL = vshlq_n_s32(filter::lanes::multiply_32x32_rshift32_rounded(modFXOutputL, feedback), 2);
+				modFXOutputR = vshlq_n_s32(filter::lanes::multiply_32x32_rshift32_rounded(modFXOutputR, feedback), 2);
+				written.val[0] = vaddq_s32(modFXOutputL, input.val[0]);
+				written.val[1] = vaddq_s32(modFXOutputR, input.val[1]);
+			}
+			else {
+				modFXOutputL = vshlq_n_s32(modFXOutputL, 1);
+				modFXOutputR = vshlq_n_s32(modFXOutputR, 1);
+				written = input;
+			}
+
+			if (line.writeIndex <= kModFXBufferSize - kBlockSize) {
+				vst2q_s32(&line.buffer[line.writeIndex].l, written);
+			}
+			else { // Wraps round
+				StereoSample block[kBlockSize];
+				vst2q_s32(&block[0].l, written);
+				for (int32_t lane = 0; lane < kBlockSize; lane++) {
+					line.buffer[(line.writeIndex + lane) & kModFXBufferIndexMask] = block[lane];
+				}
+			}
+			line.writeIndex = (line.writeIndex + kBlockSize) & kModFXBufferIndexMask;
+
+			input.val[0] = vaddq_s32(input.val[0], modFXOutputL);
+			input.val[1] = vaddq_s32(input.val[1], modFXOutputR);
+			vst2q_s32(&chunk[i].l, input);
+		}
+	}
+
+	for (size_t i = numBlockSamples; i < audio.size(); i++) {
+		delaySample<type>(audio[i], lfo.render(1, waveType, params.rate), line, params);
+	}
+}
+
+} // namespace
+
+void renderDelayReference(ModFXType type, std::span<StereoSample> audio, DelayLine line, LFO& lfo,
+                          DelayParams const& params) {
+	for (StereoSample& sample : audio) {
+		int32_t lfoOutput = lfo.render(1, lfoTypeFor(type), params.rate);
+		switch (type) {
+		case ModFXType::FLANGER:
+			delaySample<ModFXType::FLANGER>(sample, lfoOutput, line, params);
+			break;
+		case ModFXType::CHORUS_STEREO:
+			delaySample<ModFXType::CHORUS_STEREO>(sample, lfoOutput, line, params);
+			break;
+		default:
+			delaySample<ModFXType::CHORUS>(sample, lfoOutput, line, params);
+			break;
+		}
+	}
+}
+
+void renderDelay(ModFXType type, std::span<StereoSample> audio, DelayLine line, LFO& lfo, DelayParams const& params) {
+	switch (type) {
+	case ModFXType::FLANGER:
+		renderDelayBlocks<ModFXType::FLANGER>(audio, line, lfo, params);
+		break;
+	case ModFXType::CHORUS_STEREO:
+		renderDelayBlocks<ModFXType::CHORUS_STEREO>(audio, line, lfo, params);
+		break;
+	default:
+		renderDelayBlocks<ModFXType::CHORUS>(audio, line, lfo, params);
+		break;
+	}
+}
+
+void renderPhaserReference(std::span<StereoSample> audio, PhaserState state, LFO& lfo, PhaserParams const& params) {
+	for (StereoSample& sample : audio) {
+		int32_t lfoOutput = lfo.render(1, LFOType::SINE, params.rate);
+		phaserSample(sample, phaserCoefficient(lfoOutput, params.depth), state, params.feedback);
+	}
+}
+
+void renderPhaser(std::span<StereoSample> audio, PhaserState state, LFO& lfo, PhaserParams const& params) {
+	// Worked on in copies, so they can stay in registers rather than being written back after every sample in case
+	// the audio overlaps them
+	StereoSample memory = state.memory;
+	std::array<StereoSample, kNumAllpassFiltersPhaser> allpassMemory;
+	std::copy(state.allpassMemory.begin(), state.allpassMemory.end(), allpassMemory.begin());
+	PhaserState working{memory, allpassMemory};
+
+	size_t numBlockSamples = audio.size() & ~(size_t)(kBlockSize - 1);
+	for (size_t chunkStart = 0; chunkStart < numBlockSamples; chunkStart += kChunkSize) {
+		size_t chunkSize = std::min<size_t>(kChunkSize, numBlockSamples - chunkStart);
+
+		// The coefficients for the whole chunk first, a block at a time
+		int32_t a1[kChunkSize];
+		for (size_t i = 0; i < chunkSize; i += kBlockSize) {
+			q31x4_t lfoOutput = renderLFO<LFOType::SINE>(lfo, params.rate);
+			// phaserCoefficient(): the unsigned halving is the same as a signed one, offset by a quarter
+			q31x4_t halved = vaddq_s32(vshrq_n_s32(lfoOutput, 1), vdupq_n_s32(1073741824));
+			vst1q_s32(&a1[i], vsubq_s32(vdupq_n_s32(1073741824), filter::lanes::multiply_32x32_rshift32_rounded(
+			                                                          halved, vdupq_n_s32(params.depth))));
+		}
+
+		for (size_t i = 0; i < chunkSize; i++) {
+			phaserSample(audio[chunkStart + i], a1[i], working, params.feedback);
+		}
+	}
+
+	for (size_t i = numBlockSamples; i < audio.size(); i++) {
+		int32_t lfoOutput = lfo.render(1, LFOType::SINE, params.rate);
+		phaserSample(audio[i], phaserCoefficient(lfoOutput, params.depth), working, params.feedback);
+	}
+
+	state.memory = memory;
+	std::copy(allpassMemory.begin(), allpassMemory.end(), state.allpassMemory.begin());
+}
+
+} // namespace deluge::dsp::mod_fx
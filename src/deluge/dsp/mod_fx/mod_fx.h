@@ -0,0 +1,75 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "definitions_cxx.hpp"
+#include "dsp/stereo_sample.h"
+#include "modulation/lfo.h"
+#include <cstdint>
+#include <span>
+
+/*
+ * The chorus, flanger and phaser ModControllableAudio::processFX() applies. Each comes two ways: a reference that
+ * goes a sample at a time, the way processFX() always has, and a block version that works out which effect it is once
+ * per buffer and then goes kBlockSize samples at a time - rendering the LFO, the delay times and the interpolation
+ * weights in NEON lanes, and interpolating the chorus and flanger's reads in them too. The two give exactly the same
+ * audio, and leave the LFO, delay buffer and filters in exactly the same state.
+ */
+namespace deluge::dsp::mod_fx {
+
+constexpr int32_t kBlockSize = 4;
+
+/// What the chorus and flanger were set up with for this buffer
+struct DelayParams {
+	/// Centre of the delay time, in samples << 16
+	int32_t offset;
+	/// How far either side of offset the LFO sweeps it
+	int32_t depth;
+	/// Flanger only
+	int32_t feedback;
+	uint32_t rate;
+};
+
+/// The chorus and flanger's buffer, and where in it the next sample goes
+struct DelayLine {
+	StereoSample* buffer; // kModFXBufferSize samples
+	uint16_t& writeIndex;
+};
+
+/// What the phaser was set up with for this buffer
+struct PhaserParams {
+	int32_t depth;
+	int32_t feedback;
+	uint32_t rate;
+};
+
+/// The phaser's state: what's fed back, and its chain of allpass filters
+struct PhaserState {
+	StereoSample& memory;
+	std::span<StereoSample, kNumAllpassFiltersPhaser> allpassMemory;
+};
+
+/// type is FLANGER, CHORUS or CHORUS_STEREO
+void renderDelayReference(ModFXType type, std::span<StereoSample> audio, DelayLine line, LFO& lfo,
+                          DelayParams const& params);
+void renderDelay(ModFXType type, std::span<StereoSample> audio, DelayLine line, LFO& lfo, DelayParams const& params);
+
+void renderPhaserReference(std::span<StereoSample> audio, PhaserState state, LFO& lfo, PhaserParams const& params);
+void renderPhaser(std::span<StereoSample> audio, PhaserState state, LFO& lfo, PhaserParams const& params);
+
+} // namespace deluge::dsp::mod_fx
@@ -0,0 +1,120 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "dsp/reverb/freeverb/block_freeverb.hpp"
+#include <limits>
+
+namespace deluge::dsp::reverb {
+
+BlockFreeverb::BlockFreeverb() {
+	combsL[0].setBuffer(bufcombsL1, {combtuningL1, combtuningL2, combtuningL3, combtuningL4});
+	combsL[1].setBuffer(bufcombsL2, {combtuningL5, combtuningL6, combtuningL7, combtuningL8});
+	combsR[0].setBuffer(bufcombsR1, {combtuningR1, combtuningR2, combtuningR3, combtuningR4});
+	combsR[1].setBuffer(bufcombsR2, {combtuningR5, combtuningR6, combtuningR7, combtuningR8});
+	allpassL[0].setBuffer(bufallpassL1);
+	allpassR[0].setBuffer(bufallpassR1);
+	allpassL[1].setBuffer(bufallpassL2);
+	allpassR[1].setBuffer(bufallpassR2);
+	allpassL[2].setBuffer(bufallpassL3);
+	allpassR[2].setBuffer(bufallpassR3);
+	allpassL[3].setBuffer(bufallpassL4);
+	allpassR[3].setBuffer(bufallpassR4);
+
+	for (int32_t i = 0; i < numallpasses; i++) {
+		allpassL[i].setFeedback(0.5f);
+		allpassR[i].setFeedback(0.5f);
+	}
+	setRoomSize(initialroom);
+	setDamping(initialdamp);
+	setWidth(initialwidth);
+
+	mute();
+}
+
+void BlockFreeverb::mute() {
+	for (auto& bank : combsL) {
+		bank.mute();
+	}
+	for (auto& bank : combsR) {
+		bank.mute();
+	}
+	for (int32_t i = 0; i < numallpasses; i++) {
+		allpassL[i].mute();
+		allpassR[i].mute();
+	}
+}
+
+void BlockFreeverb::update() {
+	wet2 = (((float)1 - width) / 2) / (width / 2 + 0.5f) * std::numeric_limits<int32_t>::max();
+
+	for (auto* banks : {&combsL, &combsR}) {
+		for (auto& bank : *banks) {
+			bank.setFeedback(roomsize * std::numeric_limits<int32_t>::max());
+			bank.setDamp(damp);
+		}
+	}
+}
+
+[[gnu::hot]] void BlockFreeverb::process(std::span<int32_t> input, std::span<StereoSample> output) {
+	// HPF on reverb input, cos if it has DC offset, the reverb magnifies that, and the sound farts out
+	for (int32_t& reverb_sample : input) {
+		int32_t distance_to_go_l = reverb_sample - reverb_send_post_lpf_;
+		reverb_send_post_lpf_ += distance_to_go_l >> 11;
+		reverb_sample -= reverb_send_post_lpf_;
+	}
+
+	for (size_t start = 0; start < input.size(); start += kBlockSize) {
+		size_t numSamples = std::min(kBlockSize, input.size() - start);
+		std::span<const int32_t> block = input.subspan(start, numSamples);
+
+		std::array<int32x4_t, kBlockSize> combOutL;
+		std::array<int32x4_t, kBlockSize> combOutR;
+		std::fill_n(combOutL.begin(), numSamples, vdupq_n_s32(0));
+		std::fill_n(combOutR.begin(), numSamples, vdupq_n_s32(0));
+		for (auto& bank : combsL) {
+			bank.process(block, combOutL.data());
+		}
+		for (auto& bank : combsR) {
+			bank.process(block, combOutR.data());
+		}
+
+		for (size_t frame = 0; frame < numSamples; frame++) {
+			// Sum the eight combs of each side
+			int32x2_t sums = vpadd_s32(vpadd_s32(vget_low_s32(combOutL[frame]), vget_high_s32(combOutL[frame])),
+			                           vpadd_s32(vget_low_s32(combOutR[frame]), vget_high_s32(combOutR[frame])));
+			int32_t out_l = vget_lane_s32(sums, 0);
+			int32_t out_r = vget_lane_s32(sums, 1);
+
+			// Feed through allpasses in series
+			for (int32_t i = 0; i < numallpasses; i++) {
+				out_l = allpassL[i].process(out_l);
+				out_r = allpassR[i].process(out_r);
+			}
+
+			// Calculate output
+			out_l = (out_l + multiply_32x32_rshift32_rounded(out_r, wet2)) << 1;
+			out_r = (out_r + multiply_32x32_rshift32_rounded(out_l, wet2)) << 1;
+
+			// Mix output
+			StereoSample& output_sample = output[start + frame];
+			output_sample.l += multiply_32x32_rshift32_rounded(out_l, this->getPanLeft());
+			output_sample.r += multiply_32x32_rshift32_rounded(out_r, this->getPanRight());
+		}
+	}
+}
+
+} // namespace deluge::dsp::reverb
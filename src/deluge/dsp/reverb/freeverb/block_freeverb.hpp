@@ -0,0 +1,99 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "dsp/reverb/base.hpp"
+#include "dsp/reverb/freeverb/allpass.hpp"
+#include "dsp/reverb/freeverb/comb_bank.hpp"
+#include "dsp/reverb/freeverb/tuning.h"
+#include <algorithm>
+#include <cstdint>
+#include <span>
+
+namespace deluge::dsp::reverb {
+
+/*
+ * Freeverb with its combs run a block at a time, four to a NEON lane (see freeverb::CombBank). The allpasses and the
+ * output mix are the same as Freeverb's, and so is every sample it renders - this is just cheaper to run.
+ */
+class BlockFreeverb : public Base {
+public:
+	BlockFreeverb();
+	~BlockFreeverb() override = default;
+
+	void mute();
+
+	void setRoomSize(float value) override {
+		roomsize = (value * scaleroom) + offsetroom;
+		update();
+	}
+
+	[[nodiscard]] constexpr float getRoomSize() const override { return (roomsize - offsetroom) / scaleroom; }
+
+	void setDamping(float value) override {
+		damp = value * scaledamp;
+		update();
+	}
+
+	[[nodiscard]] constexpr float getDamping() const override { return damp / scaledamp; }
+
+	void setWidth(float value) override {
+		width = value;
+		update();
+	}
+
+	[[nodiscard]] constexpr float getWidth() const override { return width; }
+
+	void process(std::span<int32_t> input, std::span<StereoSample> output) override;
+
+private:
+	// Comb outputs are gathered for this many samples at a time before going through the allpasses
+	static constexpr size_t kBlockSize = 64;
+
+	void update();
+
+	float roomsize;
+	float damp;
+	float width;
+	int32_t wet2;
+
+	// Lanes hold combs 1-4 and 5-8 of each side
+	std::array<freeverb::CombBank, 2> combsL;
+	std::array<freeverb::CombBank, 2> combsR;
+
+	std::array<freeverb::Allpass, numallpasses> allpassL;
+	std::array<freeverb::Allpass, numallpasses> allpassR;
+
+	// each bank's line is as long as its longest comb
+	std::array<int32_t, combtuningL4 * freeverb::CombBank::kNumLanes> bufcombsL1;
+	std::array<int32_t, combtuningL8 * freeverb::CombBank::kNumLanes> bufcombsL2;
+	std::array<int32_t, combtuningR4 * freeverb::CombBank::kNumLanes> bufcombsR1;
+	std::array<int32_t, combtuningR8 * freeverb::CombBank::kNumLanes> bufcombsR2;
+
+	std::array<int32_t, allpasstuningL1> bufallpassL1;
+	std::array<int32_t, allpasstuningR1> bufallpassR1;
+	std::array<int32_t, allpasstuningL2> bufallpassL2;
+	std::array<int32_t, allpasstuningR2> bufallpassR2;
+	std::array<int32_t, allpasstuningL3> bufallpassL3;
+	std::array<int32_t, allpasstuningR3> bufallpassR3;
+	std::array<int32_t, allpasstuningL4> bufallpassL4;
+	std::array<int32_t, allpasstuningR4> bufallpassR4;
+
+	int32_t reverb_send_post_lpf_ = 0;
+};
+} // namespace deluge::dsp::reverb
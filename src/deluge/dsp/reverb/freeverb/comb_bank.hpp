@@ -0,0 +1,131 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "arm_neon_shim.h"
+#include "dsp/filter/filter_batch.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+namespace freeverb {
+
+/*
+ * Four Combs, one per NEON lane, sharing a single delay line with the lanes interleaved.
+ *
+ * The line is as long as the longest of the four delays. Every lane reads from the same position, so the reads are one
+ * vector load, and each lane writes its delay's worth of samples ahead of that. Within a block, runs of samples where
+ * no position wraps around go through without any index checks. The arithmetic is Comb::process() on each lane, so the
+ * output matches four separate Combs exactly.
+ */
+class CombBank {
+public:
+	static constexpr int32_t kNumLanes = deluge::dsp::filter::kBatchSize;
+
+	CombBank() = default;
+
+	/// buffer needs kNumLanes samples for each sample of the longest delay
+	constexpr void setBuffer(std::span<int32_t> buffer, std::array<int32_t, kNumLanes> delays) {
+		buffer_ = buffer;
+		length_ = buffer.size() / kNumLanes;
+		readIdx_ = 0;
+		for (int32_t lane = 0; lane < kNumLanes; lane++) {
+			writeIdx_[lane] = delays[lane] % length_;
+		}
+	}
+
+	void mute() {
+		std::fill(buffer_.begin(), buffer_.end(), 0);
+		filterstore_ = vdupq_n_s32(0);
+	}
+
+	void setDamp(float val) {
+		int32_t damp1 = val * std::numeric_limits<int32_t>::max();
+		damp1_ = vdupq_n_s32(damp1);
+		damp2_ = vdupq_n_s32(std::numeric_limits<int32_t>::max() - damp1);
+	}
+
+	void setFeedback(int32_t val) { feedback_ = vdupq_n_s32(val); }
+
+	/// Run input through the combs, adding each sample's four comb outputs to the lanes of output
+	[[gnu::always_inline]] inline void process(std::span<const int32_t> input, int32x4_t* output) {
+		using namespace deluge::dsp::filter::lanes;
+
+		size_t done = 0;
+		while (done < input.size()) {
+			int32_t run = std::min<int32_t>(input.size() - done, length_ - readIdx_);
+			for (int32_t lane = 0; lane < kNumLanes; lane++) {
+				run = std::min(run, length_ - writeIdx_[lane]);
+			}
+
+			const int32_t* read = &buffer_[readIdx_ * kNumLanes];
+			int32_t* write0 = &buffer_[writeIdx_[0] * kNumLanes + 0];
+			int32_t* write1 = &buffer_[writeIdx_[1] * kNumLanes + 1];
+			int32_t* write2 = &buffer_[writeIdx_[2] * kNumLanes + 2];
+			int32_t* write3 = &buffer_[writeIdx_[3] * kNumLanes + 3];
+
+			for (int32_t i = 0; i < run; i++) {
+				q31x4_t out = vld1q_s32(read);
+
+				filterstore_ = vshlq_n_s32(vaddq_s32(multiply_32x32_rshift32_rounded(out, damp2_),
+				                                     multiply_32x32_rshift32_rounded(filterstore_, damp1_)),
+				                           1);
+				q31x4_t in = vaddq_s32(vdupq_n_s32(input[done + i]),
+				                       vshlq_n_s32(multiply_32x32_rshift32_rounded(filterstore_, feedback_), 1));
+
+				// a lane whose delay is the full length writes where we just read from, which is fine
+				vst1q_lane_s32(write0, in, 0);
+				vst1q_lane_s32(write1, in, 1);
+				vst1q_lane_s32(write2, in, 2);
+				vst1q_lane_s32(write3, in, 3);
+
+				output[done + i] = vaddq_s32(output[done + i], out);
+
+				read += kNumLanes;
+				write0 += kNumLanes;
+				write1 += kNumLanes;
+				write2 += kNumLanes;
+				write3 += kNumLanes;
+			}
+
+			readIdx_ = advance(readIdx_, run);
+			for (int32_t lane = 0; lane < kNumLanes; lane++) {
+				writeIdx_[lane] = advance(writeIdx_[lane], run);
+			}
+			done += run;
+		}
+	}
+
+private:
+	[[nodiscard]] constexpr int32_t advance(int32_t idx, int32_t by) const {
+		idx += by;
+		return (idx >= length_) ? idx - length_ : idx;
+	}
+
+	int32x4_t feedback_{};
+	int32x4_t filterstore_{};
+	int32x4_t damp1_{};
+	int32x4_t damp2_{};
+	std::span<int32_t> buffer_;
+	int32_t length_{0};
+	int32_t readIdx_{0};
+	std::array<int32_t, kNumLanes> writeIdx_{};
+};
+} // namespace freeverb
@@ -1,5 +1,6 @@
 #pragma once
 #include "base.hpp"
+#include "freeverb/block_freeverb.hpp"
 #include "freeverb/freeverb.hpp"
 #include "mutable/reverb.hpp"
 #include <algorithm>
@@ -13,6 +14,7 @@ public:
 	enum class Model {
 		FREEVERB = 0, // Freeverb is the original
 		MUTABLE,
+		FREEVERB_BLOCK, // Freeverb with its combs vectorised, renders exactly the same but costs less
 	};
 
 	Reverb()
@@ -30,6 +32,9 @@ public:
 		case Model::MUTABLE:
 			reverb_.emplace<reverb::Mutable>();
 			break;
+		case Model::FREEVERB_BLOCK:
+			reverb_.emplace<reverb::BlockFreeverb>();
+			break;
 		}
 		base_->setRoomSize(room_size_);
 		base_->setDamping(damping_);
@@ -49,6 +54,9 @@ public:
 		case Model::MUTABLE:
 			reverb_as<Mutable>().process(input, output);
 			break;
+		case Model::FREEVERB_BLOCK:
+			reverb_as<BlockFreeverb>().process(input, output);
+			break;
 		}
 	}
 
@@ -90,8 +98,9 @@ public:
 
 private:
 	std::variant<         //<
-	    reverb::Freeverb, //<
-	    reverb::Mutable   //<
+	    reverb::Freeverb,     //<
+	    reverb::Mutable,      //<
+	    reverb::BlockFreeverb //<
 	    >
 	    reverb_{};
 
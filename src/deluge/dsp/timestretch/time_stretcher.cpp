@@ -1044,7 +1044,7 @@ void TimeStretcher::reassessWhetherToBeFillingBuffer(int32_t phaseIncrement, int
 #endif
 
 bool TimeStretcher::allocateBuffer(int32_t numChannels) {
-	buffer = (int32_t*)allocMaxSpeed(TimeStretch::kBufferSize * sizeof(int32_t) * numChannels);
+	buffer = (int32_t*)allocRealtime(TimeStretch::kBufferSize * sizeof(int32_t) * numChannels);
 	return (buffer != NULL);
 }
 
@@ -1122,8 +1122,9 @@ void TimeStretcher::updateClustersForPercLookahead(Sample* sample, uint32_t sour
 			    || nextClusterIndex >= sample->getFirstClusterIndexWithNoAudioData()) {
 				break; // If no more Clusters
 			}
-			clustersForPercLookahead[l] =
-			    sample->clusters.getElement(nextClusterIndex)->getCluster(sample, nextClusterIndex, CLUSTER_ENQUEUE);
+			clustersForPercLookahead[l] = sample->clusters.getElement(nextClusterIndex)
+			                                  ->getCluster(sample, nextClusterIndex, CLUSTER_ENQUEUE,
+			                                               AudioEngine::audioSampleTimer);
 			if (!clustersForPercLookahead[l]) {
 				break;
 			}
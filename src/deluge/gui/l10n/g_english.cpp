@@ -446,6 +446,10 @@ PLACE_SDRAM_DATA Language english{
         {STRING_FOR_COMMUNITY_FEATURE_ALTERNATIVE_PLAYBACK_START_BEHAVIOUR, "Alternative Playback Start Behaviour"},
         {STRING_FOR_COMMUNITY_FEATURE_ACCESSIBILITY_SHORTCUTS, "Accessibility Shortcuts"},
         {STRING_FOR_COMMUNITY_FEATURE_GRID_VIEW_LOOP_PADS, "Grid View Loop Layer Pads"},
+        {STRING_FOR_COMMUNITY_FEATURE_QUALITY_UNDER_LOAD, "Quality Under Load"},
+        {STRING_FOR_COMMUNITY_FEATURE_PRELOAD_NEXT_SONG, "Preload Next Song"},
+        {STRING_FOR_COMMUNITY_FEATURE_BATCHED_CARD_READS, "Batched Card Reads"},
+        {STRING_FOR_COMMUNITY_FEATURE_BLOCK_MOD_FX, "Block Mod FX"},
         {STRING_FOR_TRACK_STILL_HAS_CLIPS_IN_SESSION, "Track still has clips in session"},
         {STRING_FOR_DELETE_ALL_TRACKS_CLIPS_FIRST, "Delete all track's clips first"},
         {STRING_FOR_CANT_DELETE_FINAL_CLIP, "Can't delete final Clip"},
@@ -757,6 +761,7 @@ PLACE_SDRAM_DATA Language english{
         {STRING_FOR_MODEL, "Model"},
         {STRING_FOR_FREEVERB, "Freeverb"},
         {STRING_FOR_MUTABLE, "Mutable"},
+        {STRING_FOR_FREEVERB_BLOCK, "Freeverb block"},
         {STRING_FOR_DIFFUSION, "Diffusion"},
         {STRING_FOR_TIME, "Time"},
         {STRING_FOR_MASTER, "Master"},
@@ -368,6 +368,10 @@ PLACE_SDRAM_DATA Language seven_segment{
         {STRING_FOR_COMMUNITY_FEATURE_ALTERNATIVE_PLAYBACK_START_BEHAVIOUR, "STAR"},
         {STRING_FOR_COMMUNITY_FEATURE_ACCESSIBILITY_SHORTCUTS, "ACCE"},
         {STRING_FOR_COMMUNITY_FEATURE_GRID_VIEW_LOOP_PADS, "LOOP"},
+        {STRING_FOR_COMMUNITY_FEATURE_QUALITY_UNDER_LOAD, "QUAL"},
+        {STRING_FOR_COMMUNITY_FEATURE_PRELOAD_NEXT_SONG, "PREL"},
+        {STRING_FOR_COMMUNITY_FEATURE_BATCHED_CARD_READS, "BTCH"},
+        {STRING_FOR_COMMUNITY_FEATURE_BLOCK_MOD_FX, "BMFX"},
         {STRING_FOR_TRACK_STILL_HAS_CLIPS_IN_SESSION, "CANT"},
         {STRING_FOR_DELETE_ALL_TRACKS_CLIPS_FIRST, "CANT"},
         {STRING_FOR_CANT_DELETE_FINAL_CLIP, "CANT"},
@@ -419,6 +423,7 @@ PLACE_SDRAM_DATA Language seven_segment{
         {STRING_FOR_MODEL, "MODE"},
         {STRING_FOR_FREEVERB, "FVRB"},
         {STRING_FOR_MUTABLE, "MTBL"},
+        {STRING_FOR_FREEVERB_BLOCK, "FVBL"},
         {STRING_FOR_DIFFUSION, "DIFF"},
         {STRING_FOR_TIME, "TIME"},
         {STRING_FOR_MASTER, "MSTR"},
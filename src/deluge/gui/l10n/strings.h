@@ -470,6 +470,10 @@ enum class String : size_t {
 	STRING_FOR_COMMUNITY_FEATURE_ALTERNATIVE_PLAYBACK_START_BEHAVIOUR,
 	STRING_FOR_COMMUNITY_FEATURE_ACCESSIBILITY_SHORTCUTS,
 	STRING_FOR_COMMUNITY_FEATURE_GRID_VIEW_LOOP_PADS,
+	STRING_FOR_COMMUNITY_FEATURE_QUALITY_UNDER_LOAD,
+	STRING_FOR_COMMUNITY_FEATURE_PRELOAD_NEXT_SONG,
+	STRING_FOR_COMMUNITY_FEATURE_BATCHED_CARD_READS,
+	STRING_FOR_COMMUNITY_FEATURE_BLOCK_MOD_FX,
 
 	STRING_FOR_TRACK_STILL_HAS_CLIPS_IN_SESSION,
 	STRING_FOR_DELETE_ALL_TRACKS_CLIPS_FIRST,
@@ -844,6 +848,7 @@ enum class String : size_t {
 	STRING_FOR_MODEL,
 	STRING_FOR_FREEVERB,
 	STRING_FOR_MUTABLE,
+	STRING_FOR_FREEVERB_BLOCK,
 	STRING_FOR_DIFFUSION,
 	STRING_FOR_TIME,
 
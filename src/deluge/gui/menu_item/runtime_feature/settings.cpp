@@ -50,6 +50,10 @@ SettingToggle menuDisplayChordLayout(RuntimeFeatureSettingType::DisplayChordKeyb
 SettingToggle menuAlternativePlaybackStartBehaviour(RuntimeFeatureSettingType::AlternativePlaybackStartBehaviour);
 SettingToggle menuAccessibilityShortcuts(RuntimeFeatureSettingType::AccessibilityShortcuts);
 SettingToggle menuEnableGridViewLoopPads(RuntimeFeatureSettingType::EnableGridViewLoopPads);
+Setting menuQualityUnderLoad(RuntimeFeatureSettingType::QualityUnderLoad);
+Setting menuPreloadNextSong(RuntimeFeatureSettingType::PreloadNextSong);
+SettingToggle menuBatchedCardReads(RuntimeFeatureSettingType::BatchedCardReads);
+SettingToggle menuBlockModFX(RuntimeFeatureSettingType::BlockModFX);
 
 std::array<MenuItem*, RuntimeFeatureSettingType::MaxElement - kNonTopLevelSettings> subMenuEntries{
     &menuDrumRandomizer,
@@ -74,7 +78,11 @@ std::array<MenuItem*, RuntimeFeatureSettingType::MaxElement - kNonTopLevelSettin
     &menuDisplayChordLayout,
     &menuAlternativePlaybackStartBehaviour,
     &menuAccessibilityShortcuts,
-    &menuEnableGridViewLoopPads};
+    &menuEnableGridViewLoopPads,
+    &menuQualityUnderLoad,
+    &menuPreloadNextSong,
+    &menuBatchedCardReads,
+    &menuBlockModFX};
 
 Settings::Settings(l10n::String name, l10n::String title) : menu_item::Submenu(name, title, subMenuEntries) {
 }
@@ -18,6 +18,7 @@
 #include "definitions_cxx.hpp"
 #include "gui/menu_item/selection.h"
 #include "gui/ui/sound_editor.h"
+#include "processing/sound/sound.h"
 #include "util/misc.h"
 
 namespace deluge::gui::menu_item::voice {
@@ -25,7 +26,12 @@ class Priority final : public Selection {
 public:
 	using Selection::Selection;
 	void readCurrentValue() override { this->setValue(*soundEditor.currentPriority); }
-	void writeCurrentValue() override { *soundEditor.currentPriority = this->getValue<VoicePriority>(); }
+	void writeCurrentValue() override {
+		*soundEditor.currentPriority = this->getValue<VoicePriority>();
+		if (soundEditor.currentSound && soundEditor.currentPriority == &soundEditor.currentSound->voicePriority) {
+			soundEditor.currentSound->updateVoicePriorities();
+		}
+	}
 	deluge::vector<std::string_view> getOptions() override {
 		return {
 		    l10n::getView(l10n::String::STRING_FOR_LOW),
@@ -33,12 +33,14 @@
 #include "model/action/action_logger.h"
 #include "model/settings/runtime_feature_settings.h"
 #include "model/song/song.h"
+#include "model/song/song_preloader.h"
 #include "modulation/params/param_manager.h"
 #include "playback/mode/arrangement.h"
 #include "playback/mode/session.h"
 #include "playback/playback_handler.h"
 #include "processing/engines/audio_engine.h"
 #include "storage/audio/audio_file_manager.h"
+#include "storage/binary_serializer.h"
 #include "storage/file_item.h"
 #include "storage/flash_storage.h"
 #include "storage/storage_manager.h"
@@ -246,10 +248,29 @@ void LoadSongUI::performLoad(StorageManager& bdsm) {
 		playbackHandler.switchToSession();
 	}
 
-	Error error = storageManager.openXMLFile(&currentFileItem->filePointer, smDeserializer, "song");
-	if (error != Error::NONE) {
-		display->displayError(error);
-		return;
+	// The song may have been read in already while this one played. If not, whatever was is just taking up memory
+	Song* preloaded = nullptr;
+	String filePath;
+	Error error = getCurrentFilePath(&filePath);
+	if (error == Error::NONE && playbackHandler.isEitherClockActive()) {
+		preloaded = songPreloader.take(filePath.get());
+	}
+	songPreloader.cancel();
+
+	// If there's an up to date binary copy of the song, that's much quicker to read
+	Deserializer* reader = &smBinaryDeserializer;
+	if (!preloaded) {
+		if (error == Error::NONE) {
+			error = storageManager.openBinaryTwin(filePath.get(), smBinaryDeserializer, "song");
+		}
+		if (error != Error::NONE) {
+			reader = &smDeserializer;
+			error = storageManager.openXMLFile(&currentFileItem->filePointer, smDeserializer, "song");
+		}
+		if (error != Error::NONE) {
+			display->displayError(error);
+			return;
+		}
 	}
 
 	currentUIMode = UI_MODE_LOADING_SONG_ESSENTIAL_SAMPLES;
@@ -277,8 +298,8 @@ void LoadSongUI::performLoad(StorageManager& bdsm) {
 		playbackHandler.songSwapShouldPreserveTempo = Buttons::isButtonPressed(deluge::hid::button::TEMPO_ENC);
 	}
 
-	void* songMemory = GeneralMemoryAllocator::get().allocMaxSpeed(sizeof(Song));
-	if (!songMemory) {
+	void* songMemory = preloaded ? nullptr : GeneralMemoryAllocator::get().allocMaxSpeed(sizeof(Song));
+	if (!preloaded && !songMemory) {
 ramError:
 		error = Error::INSUFFICIENT_RAM;
 
@@ -302,34 +323,37 @@ fail:
 		return;
 	}
 
-	preLoadedSong = new (songMemory) Song();
-	error = preLoadedSong->paramManager.setupUnpatched();
-	if (error != Error::NONE) {
-gotErrorAfterCreatingSong:
-		void* toDealloc = dynamic_cast<void*>(preLoadedSong);
-		preLoadedSong->~Song(); // Will also delete paramManager
-		delugeDealloc(toDealloc);
-		preLoadedSong = NULL;
-		goto someError;
+	if (preloaded) {
+		preLoadedSong = preloaded;
 	}
+	else {
+		preLoadedSong = new (songMemory) Song();
+		error = preLoadedSong->paramManager.setupUnpatched();
+		if (error != Error::NONE) {
+gotErrorAfterCreatingSong:
+			void* toDealloc = dynamic_cast<void*>(preLoadedSong);
+			preLoadedSong->~Song(); // Will also delete paramManager
+			delugeDealloc(toDealloc);
+			preLoadedSong = NULL;
+			goto someError;
+		}
 
-	GlobalEffectable::initParams(&preLoadedSong->paramManager);
+		GlobalEffectable::initParams(&preLoadedSong->paramManager);
 
-	AudioEngine::logAction("initialized new song");
+		AudioEngine::logAction("initialized new song");
 
-	// Will return false if we ran out of RAM. This isn't currently detected for while loading ParamNodes, but chances
-	// are, after failing on one of those, it'd try to load something else and that would fail.
-	error = preLoadedSong->readFromFile(smDeserializer);
-	if (error != Error::NONE) {
-		goto gotErrorAfterCreatingSong;
-	}
-	AudioEngine::logAction("read new song from file");
-
-	bool success = storageManager.closeFile();
+		// Will return false if we ran out of RAM. This isn't currently detected for while loading ParamNodes, but
+		// chances are, after failing on one of those, it'd try to load something else and that would fail.
+		error = preLoadedSong->readFromFile(*reader);
+		if (error != Error::NONE) {
+			goto gotErrorAfterCreatingSong;
+		}
+		AudioEngine::logAction("read new song from file");
 
-	if (!success) {
-		display->displayPopup(deluge::l10n::get(deluge::l10n::String::STRING_FOR_ERROR_LOADING_SONG));
-		goto fail;
+		if (!storageManager.closeFile()) {
+			display->displayPopup(deluge::l10n::get(deluge::l10n::String::STRING_FOR_ERROR_LOADING_SONG));
+			goto fail;
+		}
 	}
 
 	preLoadedSong->dirPath.set(&currentDir);
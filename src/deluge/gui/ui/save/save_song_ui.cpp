@@ -26,7 +26,9 @@
 #include "model/sample/sample.h"
 #include "model/settings/runtime_feature_settings.h"
 #include "model/song/song.h"
+#include "model/song/song_preloader.h"
 #include "storage/audio/audio_file_manager.h"
+#include "storage/binary_serializer.h"
 #include "storage/flash_storage.h"
 #include "storage/storage_manager.h"
 #include "util/functions.h"
@@ -421,6 +423,9 @@ fail3:
 
 	D_PRINTLN("creating:  %s", filePathDuringWrite.get());
 
+	// If this is the song the preloader has read, what it has is out of date. It starts again once we're done
+	songPreloader.cancel();
+
 	// Write the actual song file
 	error = bdsm.createXMLFile(filePathDuringWrite.get(), smSerializer, false, false);
 	if (error != Error::NONE) {
@@ -441,8 +446,9 @@ fail3:
 	// If "overwriting an existing file"...
 	if (fileAlreadyExisted) {
 
-		// Delete the old file
+		// Delete the old file, and the binary copy of it, which is rewritten below
 		FRESULT result = f_unlink(filePath.get());
+		StorageManager::deleteBinaryTwin(filePath.get());
 		if (result != FR_OK) {
 cardError:
 			error = fresultToDelugeErrorCode(result);
@@ -456,6 +462,9 @@ cardError:
 		}
 	}
 
+	// So next time it can load without parsing the XML. If this fails, it'll just load from the XML
+	bdsm.writeBinaryTwin(filePath.get(), smDeserializer, smBinarySerializer);
+
 	display->removeWorkingAnimation();
 	char const* message = anyErrorMovingTempFiles
 	                          ? (deluge::l10n::get(deluge::l10n::String::STRING_FOR_ERROR_MOVING_TEMP_FILES))
@@ -17,6 +17,7 @@
 
 #include "gui/waveform/waveform_renderer.h"
 #include "definitions_cxx.hpp"
+#include "extern.h"
 #include "gui/colour/colour.h"
 #include "gui/waveform/waveform_render_data.h"
 #include "io/debug/log.h"
@@ -37,6 +38,12 @@ extern uint8_t currentlyAccessingCard;
 
 WaveformRenderer waveformRenderer{};
 
+namespace {
+// Below this, reading the audio for each col is quick enough, and not worth a peaks file next to every sample
+constexpr int32_t kMinClustersToFindAllPeaks = 64;
+constexpr double kFindPeaksSecondsPerCall = 0.004;
+} // namespace
+
 WaveformRenderer::WaveformRenderer() {
 }
 
@@ -297,6 +304,18 @@ bool WaveformRenderer::findPeaksPerCol(Sample* sample, int64_t xScrollSamples, u
 
 		int32_t numClustersSpan = colEndCluster - colStartCluster;
 
+		// If the col takes in any whole Clusters - or the first one, with the initial transient - the peaks of those
+		// will do, and the bits of Cluster either side can be left out just like below
+		int32_t firstWholeCluster = (colStartSample == 0) ? colStartCluster : colStartCluster + 1;
+		if (colEndCluster > firstWholeCluster && sample->peaks.isSetUp()) {
+			WaveformPeaks::Peak peak = sample->peaks.getPeak(firstWholeCluster, colEndCluster);
+			if (peak.isKnown()) {
+				data->minPerCol[col] = (int32_t)peak.min << 16;
+				data->maxPerCol[col] = ((int32_t)peak.max << 16) | 0xFFFF;
+				continue;
+			}
+		}
+
 		bool investigatingAWholeCluster = false;
 
 		// If both same cluster...
@@ -560,6 +579,13 @@ cantReadData:
 		}
 	}
 
+	// Long samples get all their peaks found, rather than the audio read again each time they're zoomed or scrolled
+	WaveformPeaks& peaks = sample->peaks;
+	if (!recorder && peaks.getNumClusters() >= kMinClustersToFindAllPeaks
+	    && (!peaks.fileTried || !peaks.isComplete())) {
+		findAllPeaksSoon(sample);
+	}
+
 	if (recorder) {
 		sample->maxValueFound = recorder->recordMax;
 		sample->minValueFound = recorder->recordMin;
@@ -582,6 +608,73 @@ cantReadData:
 	return !hadAnyTroubleLoading;
 }
 
+void WaveformRenderer::findAllPeaksSoon(Sample* sample) {
+	if (sample == sampleFindingPeaksFor) {
+		return;
+	}
+	stopFindingPeaks();
+	sample->addReason();
+	sampleFindingPeaksFor = sample;
+	nextClusterToFindPeakFor = 0;
+}
+
+void WaveformRenderer::stopFindingPeaks() {
+	if (sampleFindingPeaksFor) {
+		sampleFindingPeaksFor->removeReason("E480");
+		sampleFindingPeaksFor = nullptr;
+	}
+}
+
+void WaveformRenderer::findPeaksRoutine() {
+	Sample* sample = sampleFindingPeaksFor;
+	if (!sample || sdRoutineLock || audioFileManager.thingTypeBeingLoaded != ThingType::NONE
+	    || audioFileManager.loadingQueue.getNumElements()) {
+		return;
+	}
+	WaveformPeaks& peaks = sample->peaks;
+	if (audioFileManager.cardEjected || sample->unloadable || !peaks.isSetUp()) {
+		stopFindingPeaks();
+		return;
+	}
+
+	if (!peaks.fileTried) {
+		peaks.fileTried = true;
+		sample->loadPeaksFile();
+		return;
+	}
+
+	double startTime = getSystemTime();
+	while (true) {
+		int32_t c = peaks.findUnknown(nextClusterToFindPeakFor);
+		if (c >= peaks.getNumClusters()) {
+			break;
+		}
+		Cluster* cluster = sample->clusters.getElement(c)->getCluster(sample, c, CLUSTER_LOAD_IMMEDIATELY);
+		if (!cluster) {
+			stopFindingPeaks(); // Left for next time the sample's drawn
+			return;
+		}
+		// If it was in memory already, it might have been loaded before there were peaks to fill in
+		if (!peaks.isKnown(c)) {
+			sample->findPeaksInCluster(cluster, audioFileManager.clusterSize);
+		}
+		audioFileManager.removeReasonFromCluster(cluster, "E481");
+		nextClusterToFindPeakFor = c + 1;
+
+		if (getSystemTime() - startTime >= kFindPeaksSecondsPerCall) {
+			return;
+		}
+	}
+
+	if (!peaks.fileUpToDate) {
+		Error error = sample->savePeaksFile();
+		if (error != Error::NONE) {
+			D_PRINTLN("couldn't save peaks of %s", sample->filePath.get());
+		}
+	}
+	stopFindingPeaks();
+}
+
 void WaveformRenderer::getColBarPositions(int32_t xDisplay, WaveformRenderData* data, int32_t* min24, int32_t* max24,
                                           int32_t valueCentrePoint, int32_t valueSpan) {
 	*min24 = ((int64_t)(data->minPerCol[xDisplay] - valueCentrePoint) << 24) / valueSpan;
@@ -57,6 +57,11 @@ public:
 	                                               int32_t valueCentrePoint, int32_t valueSpan);
 	bool findPeaksPerCol(Sample* sample, int64_t xScroll, uint64_t xZoom, WaveformRenderData* data,
 	                     SampleRecorder* recorder = NULL, int32_t xStart = 0, int32_t xEnd = kDisplayWidth);
+	/// Has findPeaksRoutine() get the sample's peaks from their file, or failing that find them all and save them,
+	/// so that drawing it at any zoom needs no audio read from then on. Only one sample at a time
+	void findAllPeaksSoon(Sample* sample);
+	/// A few Clusters at a time, from a low priority task, only while the card has nothing more urgent to do
+	void findPeaksRoutine();
 
 	int8_t collapseAnimationToWhichRow;
 
@@ -70,6 +75,10 @@ private:
 	                                                   int32_t singleSquareBrightness, int32_t progress,
 	                                                   RGB thisImage[][kDisplayWidth + kSideBarWidth],
 	                                                   std::optional<RGB> rgb);
+	void stopFindingPeaks();
+
+	Sample* sampleFindingPeaksFor = nullptr; // Holds a "reason" on it
+	int32_t nextClusterToFindPeakFor = 0;
 };
 
 extern WaveformRenderer waveformRenderer;
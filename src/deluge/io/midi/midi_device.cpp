@@ -572,4 +572,5 @@ void MIDIDeviceDINPorts::sendSysex(const uint8_t* data, int32_t len) {
 	for (int32_t i = 0; i < len; i++) {
 		bufferMIDIUart(data[i]);
 	}
+	midiEngine.cancelSerialRunningStatus();
 }
@@ -20,6 +20,7 @@
 #include "gui/menu_item/mpe/zone_num_member_channels.h"
 #include "gui/ui/sound_editor.h"
 #include "hid/display/display.h"
+#include "io/debug/log.h"
 #include "io/midi/device_specific/specific_midi_device.h"
 #include "io/midi/midi_device.h"
 #include "io/midi/midi_engine.h"
@@ -66,6 +67,20 @@ uint8_t highestLastMemberChannelOfUpperZoneOnConnectedOutput = 0;
 
 bool anyChangesToSave = false;
 
+void dumpUSBSendQueueTelemetry() {
+	for (int32_t ip = 0; ip < USB_NUM_USBIP; ip++) {
+		for (int32_t d = 0; d < MAX_NUM_USB_MIDI_DEVICES; d++) {
+			USBMIDISendQueue& sendQueue = connectedUSBMIDIDevices[ip][d].sendQueue;
+			if (sendQueue.numDropped || sendQueue.numCoalesced) {
+				D_PRINTLN("USB MIDI send queue %d/%d: dropped %lu, coalesced %lu", ip, d, sendQueue.numDropped,
+				          sendQueue.numCoalesced);
+				sendQueue.numDropped = 0;
+				sendQueue.numCoalesced = 0;
+			}
+		}
+	}
+}
+
 // Gets called within UITimerManager, which may get called during SD card routine.
 void slowRoutine() {
 	upstreamUSBMIDIDevice_port1.sendMCMsNowIfNeeded();
@@ -635,48 +650,33 @@ checkDevice:
 } // namespace MIDIDeviceManager
 
 void ConnectedUSBMIDIDevice::bufferMessage(uint32_t fullMessage) {
-	uint32_t queued = ringBufWriteIdx - ringBufReadIdx;
-	if (queued > 16) {
+	if (sendQueue.getNumQueued() > 16) {
 		if (!anyUSBSendingStillHappening[0]) {
 			midiEngine.flushUSBMIDIOutput();
 		}
-		queued = ringBufWriteIdx - ringBufReadIdx;
-	}
-	if (queued > MIDI_SEND_BUFFER_LEN_RING) {
-		// TODO: show some error message
-		return;
 	}
 
-	sendDataRingBuf[ringBufWriteIdx & MIDI_SEND_RING_MASK] = fullMessage;
-	ringBufWriteIdx++;
+	// Clock goes to the front, a CC may just update one already waiting, and if there's no room it's dropped - all
+	// counted in sendQueue
+	sendQueue.push(fullMessage);
 
 	anythingInUSBOutputBuffer = true;
 }
 
 bool ConnectedUSBMIDIDevice::hasBufferedSendData() {
-	// must be the same unsigned type as ringBufWriteIdx/ringBufReadIdx
-	uint32_t queued = ringBufWriteIdx - ringBufReadIdx;
-	return queued > 0;
+	return sendQueue.getNumQueued() > 0;
 }
 
 int ConnectedUSBMIDIDevice::sendBufferSpace() {
-	// must be the same unsigned type as ringBufWriteIdx/ringBufReadIdx
-	uint32_t queued = ringBufWriteIdx - ringBufReadIdx;
 	// each 4-byte MIDI-USB message contains 3 bytes of serial MIDI data
-	return (MIDI_SEND_BUFFER_LEN_RING - queued) * 3;
+	return sendQueue.getSpace() * 3;
 }
 
-// This tries to read data from the ring buffer, and
+// This tries to read data from the send queue, and
 // moves data into the smaller "dataSendingNow" buffer where
 // it is ready to be used by the hardware driver.
 bool ConnectedUSBMIDIDevice::consumeSendData() {
-	uint32_t queued = ringBufWriteIdx - ringBufReadIdx;
-	if (queued == 0) {
-		return false;
-	}
-
-	int32_t i = 0;
-	uint32_t max_size = MIDI_SEND_BUFFER_LEN_INNER;
+	int32_t max_size = MIDI_SEND_BUFFER_LEN_INNER;
 	if (g_usb_usbmode == USB_HOST) {
 		// many devices do not accept more than 64 bytes of data at a time
 		// likely this can be inferred from the device metadata somehow?
@@ -687,10 +687,9 @@ bool ConnectedUSBMIDIDevice::consumeSendData() {
 		max_size = MIDI_SEND_BUFFER_LEN_INNER_HOST;
 	}
 
-	int32_t to_send = std::min(queued, max_size);
-	for (i = 0; i < to_send; i++) {
-		memcpy(dataSendingNow + (i * 4), &sendDataRingBuf[ringBufReadIdx & MIDI_SEND_RING_MASK], 4);
-		ringBufReadIdx++;
+	int32_t to_send = sendQueue.pop(dataSendingNow, max_size);
+	if (to_send == 0) {
+		return false;
 	}
 
 	numBytesSendingNow = to_send * 4;
@@ -713,9 +712,7 @@ ConnectedUSBMIDIDevice::ConnectedUSBMIDIDevice() {
 	memset(receiveData, 0, 64);
 	memset(dataSendingNow, 0, MIDI_SEND_BUFFER_LEN_INNER * 4);
 	numBytesSendingNow = 0;
-	memset(sendDataRingBuf, 0, MIDI_SEND_BUFFER_LEN_RING);
-	ringBufWriteIdx = 0;
-	ringBufReadIdx = 0;
+	sendQueue.clear();
 
 	maxPortConnected = 0;
 }
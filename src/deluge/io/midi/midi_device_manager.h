@@ -18,6 +18,7 @@
 #pragma once
 #ifdef __cplusplus
 #include "definitions_cxx.hpp"
+#include "io/midi/usb_midi_send_queue.h"
 #include "util/container/vector/named_thing_vector.h"
 class MIDIDevice;
 class MIDIDeviceUSBUpstream;
@@ -29,21 +30,10 @@ class Deserializer;
 
 #else
 #include "definitions.h"
+#include "deluge/io/midi/usb_midi_send_queue.h" // Only src/ is on the USB driver's include path
 struct MIDIDeviceUSB;
 #endif
 
-// size in 32-bit messages
-// NOTE: increasing this even more doesn't work.
-// Looks like a hardware limitation (maybe we more in FS mode)?
-#define MIDI_SEND_BUFFER_LEN_INNER 32
-// Seems to be the max for a hydrasynth on a usb hub? We should figure out how to find this from the device config but I
-// haven't seen anything below this yet. Widi bud's can do 3, both do fine at 16 without a hub involved
-#define MIDI_SEND_BUFFER_LEN_INNER_HOST 2
-
-// MUST be an exact power of two
-#define MIDI_SEND_BUFFER_LEN_RING 1024
-#define MIDI_SEND_RING_MASK (MIDI_SEND_BUFFER_LEN_RING - 1)
-
 #ifdef __cplusplus
 /*A ConnectedUSBMIDIDevice is used directly to interface with the USB driver
  * When a ConnectedUSBMIDIDevice has a numMessagesQueued>=MIDI_SEND_BUFFER_LEN and tries to add another,
@@ -88,13 +78,11 @@ struct ConnectedUSBMIDIDevice {
 	// this one, and until we've completed our send
 	uint8_t numBytesSendingNow;
 
-	// This is a ring buffer for data waiting to be sent which doesn't fit the smaller buffer above.
-	// Any code which wants to send midi data would use the writing side and append more messages.
-	// When we are ready to send data on this device, we consume data on the reading side and move it into the
+	// Data waiting to be sent which doesn't fit the smaller buffer above.
+	// Any code which wants to send midi data would push more messages onto it.
+	// When we are ready to send data on this device, we consume data from it and move it into the
 	// smaller dataSendingNow buffer above.
-	uint32_t sendDataRingBuf[MIDI_SEND_BUFFER_LEN_RING];
-	uint32_t ringBufWriteIdx;
-	uint32_t ringBufReadIdx;
+	struct USBMIDISendQueue sendQueue;
 
 	uint8_t maxPortConnected;
 };
@@ -112,6 +100,8 @@ void recountSmallestMPEZones();
 void writeDevicesToFile(StorageManager& bdsm);
 void readAHostedDeviceFromFile(Deserializer& reader);
 void readDevicesFromFile(StorageManager& bdsm);
+/// print how many messages each USB device's send queue has dropped and coalesced, then reset the counts
+void dumpUSBSendQueueTelemetry();
 
 extern MIDIDeviceUSBUpstream upstreamUSBMIDIDevice_port1;
 extern MIDIDeviceUSBUpstream upstreamUSBMIDIDevice_port2;
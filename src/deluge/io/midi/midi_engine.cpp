@@ -214,7 +214,6 @@ bool anythingInUSBOutputBuffer = false;
 
 MidiEngine::MidiEngine() {
 	numSerialMidiInput = 0;
-	lastStatusByteSent = 0;
 	currentlyReceivingSysExSerial = false;
 	midiThru = false;
 	for (auto& midiChannelType : midiFollowChannelType) {
@@ -582,17 +581,9 @@ void MidiEngine::sendSerialMidi(uint8_t statusType, uint8_t channel, uint8_t dat
 
 	uint8_t statusByte = channel | (statusType << 4);
 	int32_t messageLength = getMidiMessageLength(statusByte);
-	// If only 1 byte, we have to send it, and keep no record of last status byte sent since we couldn't do running
-	// status anyway
-	if (false && messageLength == 1) {
+	// Leave the status byte out if it's the same as last time
+	if (serialRunningStatus.needsStatusByte(statusByte)) {
 		bufferMIDIUart(statusByte);
-		lastStatusByteSent = 0;
-	}
-
-	// Or, if message is longer, only send if status byte is different from last time
-	else if (true || statusByte != lastStatusByteSent) { // Temporarily disabled
-		bufferMIDIUart(statusByte);
-		lastStatusByteSent = statusByte;
 	}
 
 	if (messageLength >= 2) {
@@ -680,8 +671,8 @@ bool MidiEngine::checkIncomingSerialMidi() {
 		if (getMidiMessageLength(serialMidiInput[0]) == numSerialMidiInput) {
 			uint8_t channel = serialMidiInput[0] & 0x0F;
 
-			midiMessageReceived(&MIDIDeviceManager::dinMIDIPorts, serialMidiInput[0] >> 4, channel, serialMidiInput[1],
-			                    serialMidiInput[2], timer);
+			queueMessageReceived(&MIDIDeviceManager::dinMIDIPorts, serialMidiInput[0] >> 4, channel, serialMidiInput[1],
+			                     serialMidiInput[2], timer);
 
 			// If message was more than 1 byte long, and was a voice or mode message, then allow for running status
 			if (numSerialMidiInput > 1 && ((serialMidiInput[0] & 0xF0) != 0xF0)) {
@@ -892,8 +883,8 @@ void MidiEngine::checkIncomingUsbMidi() {
 							// fallback to cable 0 since we don't support more than one port on hosted devices yet
 							cable = 0;
 						}
-						midiMessageReceived(connectedUSBMIDIDevices[ip][d].device[cable], statusType, channel, data1,
-						                    data2, &timeLastBRDY[ip]);
+						queueMessageReceived(connectedUSBMIDIDevices[ip][d].device[cable], statusType, channel, data1,
+						                     data2, &timeLastBRDY[ip]);
 					}
 				}
 
@@ -962,6 +953,44 @@ int32_t MidiEngine::getMidiMessageLength(uint8_t statusByte) {
 	}
 }
 
+void MidiEngine::queueMessageReceived(MIDIDevice* fromDevice, uint8_t statusType, uint8_t channel, uint8_t data1,
+                                      uint8_t data2, uint32_t* timer) {
+	switch (statusType) {
+	case 0x08: // Note off
+	case 0x09: // Note on
+	case 0x0B: { // CC
+		if (!playbackHandler.mayActOnNoteOrCCInRender(fromDevice, statusType == 0x0B, channel, data1)) {
+			// It's to be acted on now, so anything that came in before it has to be too
+			inputQueue_.takeAll([this](TimestampedMIDIMessage const& message) {
+				midiMessageReceived(message.device, message.statusType, message.channel, message.data1,
+				                    message.data2);
+			});
+			break;
+		}
+		uint32_t time = timer ? AudioEngine::getTimeDMANextReaches(*timer) : AudioEngine::audioSampleTimer;
+		if (inputQueue_.push({time, fromDevice, statusType, channel, data1, data2})) {
+			return;
+		}
+		break; // Full, so it'll just have to be now
+	}
+
+	default:
+		// Aftertouch and pitch bend come thick and fast and only ever change how something already sounding sounds,
+		// program changes can go and load things, and system messages are either clock, which has its own timing, or
+		// want acting on before any of that
+		break;
+	}
+	midiMessageReceived(fromDevice, statusType, channel, data1, data2, timer);
+}
+
+void MidiEngine::takeQueuedInput(size_t& numSamples) {
+	inputQueue_.takeDue(AudioEngine::audioSampleTimer, numSamples, kMaxQueuedInputPerWindow,
+	                    [this](TimestampedMIDIMessage const& message) {
+		                    midiMessageReceived(message.device, message.statusType, message.channel, message.data1,
+		                                        message.data2);
+	                    });
+}
+
 #define MISSING_MESSAGE_CHECK 0
 
 #if MISSING_MESSAGE_CHECK
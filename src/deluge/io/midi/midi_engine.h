@@ -21,6 +21,8 @@
 
 #include "definitions_cxx.hpp"
 #include "io/midi/learned_midi.h"
+#include "io/midi/midi_input_queue.h"
+#include "io/midi/midi_running_status.h"
 #include "playback/playback_handler.h"
 
 class MIDIDevice;
@@ -77,9 +79,15 @@ public:
 	void sendPositionPointer(MIDISource source, uint16_t positionPointer);
 	void sendContinue(MIDISource source);
 
+	/// Acts on each received note and CC that's due by the start of the render window about to happen, and shortens
+	/// numSamples so the window ends where the next one's due
+	void takeQueuedInput(size_t& numSamples);
+
 	void flushMIDI();
 	void sendUsbMidi(uint8_t statusType, uint8_t channel, uint8_t data1, uint8_t data2, int32_t filter);
 	void sendSerialMidi(uint8_t statusType, uint8_t channel, uint8_t data1, uint8_t data2);
+	/// After sending anything to the DIN port other than through sendSerialMidi()
+	void cancelSerialRunningStatus() { serialRunningStatus.cancel(); }
 
 	void sendPGMChange(MIDISource source, int32_t channel, int32_t pgm, int32_t filter);
 	void sendAllNotesOff(MIDISource source, int32_t channel, int32_t filter);
@@ -112,7 +120,7 @@ public:
 private:
 	uint8_t serialMidiInput[3];
 	uint8_t numSerialMidiInput;
-	uint8_t lastStatusByteSent;
+	MIDIRunningStatus serialRunningStatus;
 
 	bool currentlyReceivingSysExSerial;
 
@@ -123,7 +131,15 @@ private:
 	/// Top of the event stack. If this is equal to eventStack_.begin(), the stack is empty.
 	EventStackStorage::iterator eventStackTop_;
 
+	/// Notes and CCs received, waiting for the audio routine to get to the time they arrived at
+	MIDIInputQueue inputQueue_;
+	/// The most the audio routine acts on before one window. Any more wait for the next. Enough for a 10k CC/s fader
+	/// bank, as CCs don't cut windows short - 29 of those fall due in the longest window
+	static constexpr int32_t kMaxQueuedInputPerWindow = 32;
+
 	int32_t getMidiMessageLength(uint8_t statusuint8_t);
+	void queueMessageReceived(MIDIDevice* fromDevice, uint8_t statusType, uint8_t channel, uint8_t data1,
+	                          uint8_t data2, uint32_t* timer);
 	void midiMessageReceived(MIDIDevice* fromDevice, uint8_t statusType, uint8_t channel, uint8_t data1, uint8_t data2,
 	                         uint32_t* timer = NULL);
 
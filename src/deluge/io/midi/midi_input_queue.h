@@ -0,0 +1,112 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class MIDIDevice;
+
+/// A received channel message, and the AudioEngine::audioSampleTimer value it's to take effect at
+struct TimestampedMIDIMessage {
+	uint32_t time;
+	MIDIDevice* device;
+	uint8_t statusType;
+	uint8_t channel;
+	uint8_t data1;
+	uint8_t data2;
+};
+
+/*
+ * Received channel messages waiting for the audio routine to get to the sample they arrived at, so a note lands at the
+ * right place within a render window rather than at whichever window's start the polling happened before. Only notes
+ * cut windows short - CCs can come thick and fast, from a bank of faders say, and just go in with the window they
+ * fall due in.
+ *
+ * One side only ever push()es and the other only ever takes messages off, so neither needs to lock the other out -
+ * the side receiving could even be an ISR. Messages come off in the order they went on, so one due sooner than the
+ * one before it just waits for that one. takeAll() is for the receiving side, which can't be running in an ISR then,
+ * to get what's queued out of the way before acting on a message straight away.
+ */
+class MIDIInputQueue {
+public:
+	static constexpr uint32_t kCapacity = 256; // A power of two
+
+	/// Returns false, leaving it to the caller to deal with the message some other way, if the queue is full
+	bool push(TimestampedMIDIMessage const& message) {
+		uint32_t writePos = writePos_.load(std::memory_order_relaxed);
+		if (writePos - readPos_.load(std::memory_order_acquire) >= kCapacity) {
+			return false;
+		}
+		messages_[writePos & (kCapacity - 1)] = message;
+		writePos_.store(writePos + 1, std::memory_order_release);
+		return true;
+	}
+
+	[[nodiscard]] bool isEmpty() const {
+		return readPos_.load(std::memory_order_relaxed) == writePos_.load(std::memory_order_acquire);
+	}
+
+	/// The shortest a note can cut a render window to, as each window has a cost of its own whatever its length
+	static constexpr size_t kMinWindowSamples = 32;
+
+	/// Hands up to maxToTake messages to handle(), in order, before a render window beginning at time: those due by
+	/// then, and CCs due before the window ends, which take effect together at its start. A note not due yet shortens
+	/// numSamples so the window ends where it's due, but no sooner than kMinWindowSamples in, so a burst of notes
+	/// can't break the audio routine up into tiny windows. Any more already due wait for the next window
+	template <typename Handler>
+	void takeDue(uint32_t time, size_t& numSamples, int32_t maxToTake, Handler&& handle) {
+		uint32_t readPos = readPos_.load(std::memory_order_relaxed);
+		uint32_t writePos = writePos_.load(std::memory_order_acquire);
+		for (; readPos != writePos && maxToTake > 0; readPos++, maxToTake--) {
+			TimestampedMIDIMessage const& message = messages_[readPos & (kCapacity - 1)];
+			int32_t timeTilDue = message.time - time;
+			if (timeTilDue > 0) {
+				bool isNote = message.statusType == 0x08 || message.statusType == 0x09;
+				if (isNote) {
+					numSamples = std::min(numSamples, std::max((size_t)timeTilDue, kMinWindowSamples));
+					break;
+				}
+				if ((size_t)timeTilDue >= numSamples) {
+					break;
+				}
+			}
+			handle(message);
+			readPos_.store(readPos + 1, std::memory_order_release);
+		}
+	}
+
+	/// Hands everything queued to handle(), in order, whenever it was due
+	template <typename Handler>
+	void takeAll(Handler&& handle) {
+		uint32_t readPos = readPos_.load(std::memory_order_relaxed);
+		uint32_t writePos = writePos_.load(std::memory_order_acquire);
+		for (; readPos != writePos; readPos++) {
+			handle(messages_[readPos & (kCapacity - 1)]);
+			readPos_.store(readPos + 1, std::memory_order_release);
+		}
+	}
+
+private:
+	std::array<TimestampedMIDIMessage, kCapacity> messages_;
+	std::atomic<uint32_t> writePos_{0};
+	std::atomic<uint32_t> readPos_{0};
+};
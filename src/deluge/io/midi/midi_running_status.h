@@ -0,0 +1,59 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Which status bytes a serial MIDI output can leave out: a channel message with the same status as the one before
+ * needs only its data bytes. A burst of CCs on one channel goes out in two thirds of the bytes, and so two thirds of
+ * the time.
+ *
+ * Realtime messages can come in between without interrupting it, but anything else that isn't a channel message does.
+ * And the status goes out again every so often anyway, so a device plugged in part way through a burst - which would
+ * have no idea what the data bytes it's getting are for - doesn't have to wait long to find out.
+ */
+class MIDIRunningStatus {
+public:
+	static constexpr uint8_t kMaxNumOmitted = 16;
+
+	/// Whether the status byte for a message about to be sent needs to go out before its data bytes
+	bool needsStatusByte(uint8_t statusByte) {
+		if (statusByte >= 0xF8) { // Realtime
+			return true;
+		}
+		if (statusByte >= 0xF0) { // System common, or SysEx
+			cancel();
+			return true;
+		}
+		if (statusByte == lastStatusByte_ && numOmitted_ < kMaxNumOmitted) {
+			numOmitted_++;
+			return false;
+		}
+		lastStatusByte_ = statusByte;
+		numOmitted_ = 0;
+		return true;
+	}
+
+	/// For when something else has been sent, such as SysEx, after which the next message needs its status byte
+	void cancel() { lastStatusByte_ = 0; }
+
+private:
+	uint8_t lastStatusByte_ = 0;
+	uint8_t numOmitted_ = 0;
+};
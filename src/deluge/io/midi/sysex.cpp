@@ -18,12 +18,71 @@
  */
 
 #include "io/midi/sysex.h"
+#include "io/debug/log.h"
 #include "io/debug/print.h"
 #include "io/midi/midi_device.h"
+#include "io/midi/midi_device_manager.h"
 #include "io/midi/midi_engine.h"
+#include "memory/general_memory_allocator.h"
+#include "processing/engines/audio_engine.h"
+#include "storage/storage_manager.h"
+#include "task_scheduler.h"
 #include "util/chainload.h"
 
 #include "util/pack.h"
+#include <cstddef>
+
+#if ENABLE_ALLOCATION_TRACE
+namespace {
+// records per reply, chosen so the packed reply fits in midiEngine.sysex_fmt_buffer
+constexpr uint32_t kTraceRecordsPerChunk = 32;
+
+void sendAllocationTraceChunk(MIDIDevice* device, uint32_t chunkIndex) {
+	AllocationTrace& trace = GeneralMemoryAllocator::get().trace;
+	struct {
+		uint32_t numRecorded;
+		uint16_t numChunks;
+		uint16_t numRecordsInChunk;
+		AllocationTrace::Record records[kTraceRecordsPerChunk];
+	} chunk;
+	chunk.numRecorded = trace.numRecorded();
+	chunk.numChunks = (trace.numAvailable() + kTraceRecordsPerChunk - 1) / kTraceRecordsPerChunk;
+	chunk.numRecordsInChunk = trace.copy(chunkIndex * kTraceRecordsPerChunk, chunk.records, kTraceRecordsPerChunk);
+
+	uint8_t reply_hdr[] = {0xF0, 0x00, 0x21, 0x7B, 0x01, 0x03, 0x45, (uint8_t)(chunkIndex & 0x7F),
+	                       (uint8_t)((chunkIndex >> 7) & 0x7F)};
+	uint8_t* reply = midiEngine.sysex_fmt_buffer;
+	memcpy(reply, reply_hdr, sizeof(reply_hdr));
+	int32_t unpackedSize =
+	    offsetof(decltype(chunk), records) + chunk.numRecordsInChunk * sizeof(AllocationTrace::Record);
+	int32_t packedSize = pack_8bit_to_7bit(reply + sizeof(reply_hdr),
+	                                       sizeof(midiEngine.sysex_fmt_buffer) - sizeof(reply_hdr) - 1,
+	                                       (uint8_t*)&chunk, unpackedSize);
+	reply[sizeof(reply_hdr) + packedSize] = 0xF7;
+	device->sendSysex(reply, sizeof(reply_hdr) + packedSize + 1);
+}
+
+void saveAllocationTrace() {
+	AllocationTrace& trace = GeneralMemoryAllocator::get().trace;
+	auto created = storageManager.createFile("ALLOCATION_TRACE.BIN", true);
+	if (!created) {
+		D_PRINTLN("couldn't create allocation trace file");
+		return;
+	}
+	FatFS::File file = created.value();
+	AllocationTrace::Record records[kTraceRecordsPerChunk];
+	uint32_t numWritten = 0;
+	while (uint32_t count = trace.copy(numWritten, records, kTraceRecordsPerChunk)) {
+		if (!file.write({(std::byte*)records, count * sizeof(AllocationTrace::Record)})) {
+			break;
+		}
+		numWritten += count;
+	}
+	file.close();
+	D_PRINTLN("wrote %d allocation trace records", numWritten);
+}
+} // namespace
+#endif
 
 void Debug::sysexReceived(MIDIDevice* device, uint8_t* data, int32_t len) {
 	if (len < 3) {
@@ -53,6 +112,51 @@ void Debug::sysexReceived(MIDIDevice* device, uint8_t* data, int32_t len) {
 #endif
 		break;
 
+	case 3:
+		// dump the scheduler's per task histograms to the debug output
+		dumpTaskHistograms();
+		break;
+
+	case 4:
+		// hit rate and fragmentation of the small allocation pools
+		GeneralMemoryAllocator::get().smallAllocations.logStats();
+		GeneralMemoryAllocator::get().smallAllocations.resetCounters();
+		// and how often the audio routine's reserve ran dry
+		GeneralMemoryAllocator::get().realtimeReserve.logStats();
+		GeneralMemoryAllocator::get().realtimeReserve.resetCounters();
+		break;
+
+	case 5:
+#if ENABLE_ALLOCATION_TRACE
+		// allocation trace: 0 = stop, 1 = start, 2 = send a chunk of records, 3 = save to the SD card
+		switch (data[2]) {
+		case 0:
+			GeneralMemoryAllocator::get().stopAllocationTrace();
+			break;
+		case 1:
+			GeneralMemoryAllocator::get().startAllocationTrace();
+			break;
+		case 2:
+			if (len >= 5) {
+				sendAllocationTraceChunk(device, data[3] | (data[4] << 7));
+			}
+			break;
+		case 3:
+			saveAllocationTrace();
+			break;
+		default:
+			break;
+		}
+#endif
+		break;
+
+	case 6:
+		// how well the audio engine's CPU load predictions are doing, and what the USB MIDI send queues have had to
+		// drop or coalesce
+		AudioEngine::dumpCpuLoadTelemetry();
+		MIDIDeviceManager::dumpUSBSendQueueTelemetry();
+		break;
+
 	default:
 		break;
 	}
@@ -0,0 +1,159 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "io/midi/usb_midi_send_queue.h"
+#include <string.h>
+
+namespace {
+
+// Past this, CCs and the like get dropped to leave room for notes and SysEx
+constexpr uint32_t kMaxQueuedFeedback = MIDI_SEND_BUFFER_LEN_RING * 3 / 4;
+
+// Everything but the value: cable number and code index, status and controller number
+constexpr uint32_t kCCKeyMask = 0x00FFFFFF;
+
+uint32_t getCodeIndex(uint32_t message) {
+	return message & 0x0F;
+}
+
+uint32_t getStatus(uint32_t message) {
+	return (message >> 8) & 0xFF;
+}
+
+/// Realtime messages: clock, start, continue, stop... Not song position pointer, which isn't one and must stay in order
+/// with the continue it's sent ahead of
+bool isClockOrTransport(uint32_t message) {
+	return getCodeIndex(message) == 0x0F && getStatus(message) >= 0xF8;
+}
+
+/// Whether a CC sent before this must still go out before it, and one sent after it after it
+bool isNoteOrProgram(uint32_t message) {
+	switch (getCodeIndex(message)) {
+	case 0x08: // Note off
+	case 0x09: // Note on
+	case 0x0C: // Program change
+		return true;
+	default:
+		return false;
+	}
+}
+
+uint32_t getChannel(uint32_t message) {
+	return (message >> 8) & 0x0F;
+}
+
+/// Whether only the latest value of this CC matters. Not so for bank select, RPNs and NRPNs and their data entry,
+/// which mean nothing without what's sent around them, or for channel mode messages
+bool isCoalescable(uint32_t message) {
+	if (getCodeIndex(message) != 0x0B) {
+		return false;
+	}
+	uint32_t controller = (message >> 16) & 0xFF;
+	switch (controller) {
+	case 0:  // Bank select MSB
+	case 6:  // Data entry MSB
+	case 32: // Bank select LSB
+	case 38: // Data entry LSB
+	case 96 ... 101: // Data increment and decrement, NRPN and RPN numbers
+	case 120 ... 127: // Channel mode
+		return false;
+	default:
+		return true;
+	}
+}
+
+bool isFeedback(uint32_t message) {
+	switch (getCodeIndex(message)) {
+	case 0x0A: // Polyphonic aftertouch
+	case 0x0B: // CC
+	case 0x0D: // Channel pressure
+	case 0x0E: // Pitch bend
+		return true;
+	default:
+		return false;
+	}
+}
+
+uint32_t getRecentCCIndex(uint32_t message) {
+	return (((message & kCCKeyMask) * 2654435761u) >> 16) & (MIDI_SEND_NUM_RECENT_CCS - 1);
+}
+
+} // namespace
+
+void USBMIDISendQueue::clear() {
+	memset(this, 0, sizeof(*this));
+}
+
+void USBMIDISendQueue::push(uint32_t message) {
+	if (isClockOrTransport(message)) {
+		if (priorityWriteIdx - priorityReadIdx >= MIDI_SEND_BUFFER_LEN_PRIORITY) {
+			numDropped++;
+			return;
+		}
+		priority[priorityWriteIdx & MIDI_SEND_PRIORITY_MASK] = message;
+		priorityWriteIdx++;
+		return;
+	}
+
+	uint32_t numQueued = ringWriteIdx - ringReadIdx;
+	bool coalescable = isCoalescable(message);
+	if (coalescable) {
+		// If the last one for this controller is still waiting, and not so near the front that the interrupt could be
+		// taking it right now, just give it the new value - unless a note or program change on this channel went in
+		// after it, as that would then hear the new value early
+		uint32_t recent = recentCCs[getRecentCCIndex(message)];
+		uint32_t positionInQueue = recent - 1 - ringReadIdx;
+		uint32_t recentNote = recentNotes[getChannel(message)];
+		uint32_t notePositionInQueue = recentNote - 1 - ringReadIdx;
+		bool noteAfter = recentNote && notePositionInQueue < numQueued && notePositionInQueue > positionInQueue;
+		if (recent && positionInQueue >= MIDI_SEND_BUFFER_LEN_INNER && positionInQueue < numQueued && !noteAfter) {
+			uint32_t& queued = ring[(recent - 1) & MIDI_SEND_RING_MASK];
+			if ((queued & kCCKeyMask) == (message & kCCKeyMask)) {
+				queued = message;
+				numCoalesced++;
+				return;
+			}
+		}
+	}
+
+	if (numQueued >= (isFeedback(message) ? kMaxQueuedFeedback : MIDI_SEND_BUFFER_LEN_RING)) {
+		numDropped++;
+		return;
+	}
+
+	if (coalescable) {
+		recentCCs[getRecentCCIndex(message)] = ringWriteIdx + 1;
+	}
+	else if (isNoteOrProgram(message)) {
+		recentNotes[getChannel(message)] = ringWriteIdx + 1;
+	}
+	ring[ringWriteIdx & MIDI_SEND_RING_MASK] = message;
+	ringWriteIdx++;
+}
+
+int32_t USBMIDISendQueue::pop(uint8_t* data, int32_t maxNumMessages) {
+	int32_t numMessages = 0;
+	for (; numMessages < maxNumMessages && priorityReadIdx != priorityWriteIdx; numMessages++) {
+		memcpy(data + (numMessages * 4), &priority[priorityReadIdx & MIDI_SEND_PRIORITY_MASK], 4);
+		priorityReadIdx++;
+	}
+	for (; numMessages < maxNumMessages && ringReadIdx != ringWriteIdx; numMessages++) {
+		memcpy(data + (numMessages * 4), &ring[ringReadIdx & MIDI_SEND_RING_MASK], 4);
+		ringReadIdx++;
+	}
+	return numMessages;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// size in 32-bit messages
+// NOTE: increasing this even more doesn't work.
+// Looks like a hardware limitation (maybe we more in FS mode)?
+#define MIDI_SEND_BUFFER_LEN_INNER 32
+// Seems to be the max for a hydrasynth on a usb hub? We should figure out how to find this from the device config but I
+// haven't seen anything below this yet. Widi bud's can do 3, both do fine at 16 without a hub involved
+#define MIDI_SEND_BUFFER_LEN_INNER_HOST 2
+
+// MUST be an exact power of two
+#define MIDI_SEND_BUFFER_LEN_RING 1024
+#define MIDI_SEND_RING_MASK (MIDI_SEND_BUFFER_LEN_RING - 1)
+
+// Clock and transport, which go out ahead of everything else. MUST be an exact power of two
+#define MIDI_SEND_BUFFER_LEN_PRIORITY 32
+#define MIDI_SEND_PRIORITY_MASK (MIDI_SEND_BUFFER_LEN_PRIORITY - 1)
+
+// How many controllers' latest CCs are remembered, to update in place. MUST be an exact power of two
+#define MIDI_SEND_NUM_RECENT_CCS 64
+
+/*
+ * The 4-byte USB-MIDI messages waiting to go out to one ConnectedUSBMIDIDevice, between being flushed.
+ *
+ * Clock and transport messages go in a little queue of their own and get sent before anything else. Those are realtime
+ * messages, which are allowed in between any others, and getting them out late would pull every device following the
+ * clock out of time.
+ *
+ * A CC for a controller that already has one waiting - MIDI follow feedback, say, as a knob gets turned - just updates
+ * the value of that one, rather than each value in between taking up a place. That's only done while no note or program
+ * change for the same channel has gone in after the waiting one, so a sequenced clip's CCs never move across its
+ * notes. And once the queue is mostly full, CCs, pitch bend and aftertouch get dropped, leaving what's left of it for
+ * notes and SysEx.
+ *
+ * It's written to by the routine and read from by the USB send-complete interrupt too, so neither side ever writes
+ * anything the other does, and CCs are never updated in place within the next transfer's worth of messages.
+ *
+ * Plain data, so that the USB driver's C view of ConnectedUSBMIDIDevice can include it.
+ */
+struct USBMIDISendQueue {
+#ifdef __cplusplus
+	void clear();
+	void push(uint32_t message);
+	/// Takes up to maxNumMessages - no more than MIDI_SEND_BUFFER_LEN_INNER - off the front into data, for sending,
+	/// returning how many it did
+	int32_t pop(uint8_t* data, int32_t maxNumMessages);
+	[[nodiscard]] uint32_t getNumQueued() const {
+		return (ringWriteIdx - ringReadIdx) + (priorityWriteIdx - priorityReadIdx);
+	}
+	/// Room left in the main queue, in messages
+	[[nodiscard]] uint32_t getSpace() const { return MIDI_SEND_BUFFER_LEN_RING - (ringWriteIdx - ringReadIdx); }
+#endif
+
+	uint32_t ring[MIDI_SEND_BUFFER_LEN_RING];
+	uint32_t ringWriteIdx;
+	uint32_t ringReadIdx;
+
+	uint32_t priority[MIDI_SEND_BUFFER_LEN_PRIORITY];
+	uint32_t priorityWriteIdx;
+	uint32_t priorityReadIdx;
+
+	// ringWriteIdx + 1 from when the latest CC hashing to each went in, or 0
+	uint32_t recentCCs[MIDI_SEND_NUM_RECENT_CCS];
+	// ringWriteIdx + 1 from when the latest note or program change went in on each channel, or 0
+	uint32_t recentNotes[16];
+
+	// Since last read by MIDIDeviceManager::dumpUSBSendQueueTelemetry()
+	uint32_t numDropped;
+	uint32_t numCoalesced;
+};
@@ -0,0 +1,44 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "memory/allocation_trace.h"
+
+void AllocationTrace::start(Record* buffer, uint32_t capacity) {
+	recording_ = false;
+	buffer_ = buffer;
+	capacity_ = capacity;
+	numRecorded_ = 0;
+	recording_ = (buffer != nullptr && capacity > 0);
+}
+
+uint32_t AllocationTrace::copy(uint32_t firstIndex, Record* destination, uint32_t maxRecords) const {
+	uint32_t available = numAvailable();
+	if (firstIndex >= available) {
+		return 0;
+	}
+	uint32_t count = available - firstIndex;
+	if (count > maxRecords) {
+		count = maxRecords;
+	}
+
+	// the oldest record still in the buffer sits just after the newest one once it has wrapped
+	uint32_t oldest = numRecorded_ - available;
+	for (uint32_t i = 0; i < count; i++) {
+		destination[i] = buffer_[(oldest + firstIndex + i) % capacity_];
+	}
+	return count;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Records what the GeneralMemoryAllocator is asked to do, so that fragmentation problems seen on a Deluge can be
+ * replayed and studied on a computer (see tests/32bit_unit_tests/allocation_trace_replay.cpp).
+ *
+ * The hooks are only compiled in when the firmware is built with ENABLE_ALLOCATION_TRACE, and even then nothing is
+ * recorded until start() is called. Records go into a ring buffer, so once it's full the oldest ones are overwritten
+ * and a replay will only see the most recent part of the session. The sequence byte lets a reader spot that.
+ *
+ * Records are written in the Deluge's native little endian layout, and that's also the dump format.
+ */
+class AllocationTrace {
+public:
+	enum class Op : uint8_t {
+		ALLOC,           // address = result, 0 if failed. size = requested size, result = allocated size
+		DEALLOC,         // size = allocated size before the dealloc
+		EXTEND,          // size = min amount, arg = ideal amount, result = new address
+		SHORTEN_RIGHT,   // size = requested size, result = resulting size
+		QUEUE_STEALABLE, // size = allocated size, arg = StealableQueue
+	};
+
+	static constexpr uint8_t kFlagMayUseOnChipRam = 1 << 0;
+	static constexpr uint8_t kFlagMakeStealable = 1 << 1;
+	static constexpr uint8_t kFlagSlab = 1 << 2;
+	static constexpr uint8_t kNoRegion = 0xFF;
+
+	struct Record {
+		uint32_t address;
+		uint32_t size;
+		uint32_t arg;
+		uint32_t result;
+		Op op;
+		uint8_t region;
+		uint8_t flags;
+		uint8_t sequence; // low bits of the record's position in the whole session
+	};
+	static_assert(sizeof(Record) == 20, "the dump format depends on the record layout");
+
+	/// Begin a new trace into the given buffer. Anything recorded before is discarded
+	void start(Record* buffer, uint32_t capacity);
+	/// Stop recording, keeping what's been recorded so it can be dumped
+	void stop() { recording_ = false; }
+	bool recording() const { return recording_; }
+
+	[[gnu::always_inline]] void add(Op op, uint32_t address, uint32_t size, uint32_t arg, uint32_t result,
+	                                uint8_t region, uint8_t flags) {
+		if (!recording_) {
+			return;
+		}
+		Record& record = buffer_[numRecorded_ % capacity_];
+		record.address = address;
+		record.size = size;
+		record.arg = arg;
+		record.result = result;
+		record.op = op;
+		record.region = region;
+		record.flags = flags;
+		record.sequence = numRecorded_;
+		numRecorded_++;
+	}
+
+	/// Total records seen since start(), including any that have been overwritten
+	uint32_t numRecorded() const { return numRecorded_; }
+	/// Records still in the buffer
+	uint32_t numAvailable() const { return numRecorded_ < capacity_ ? numRecorded_ : capacity_; }
+	/// Copy up to maxRecords available records, oldest first, beginning from the firstIndex'th available one
+	uint32_t copy(uint32_t firstIndex, Record* destination, uint32_t maxRecords) const;
+
+	Record* buffer() const { return buffer_; }
+
+private:
+	Record* buffer_ = nullptr;
+	uint32_t capacity_ = 0;
+	uint32_t numRecorded_ = 0;
+	bool recording_ = false;
+};
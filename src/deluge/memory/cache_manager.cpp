@@ -4,14 +4,20 @@
 #include "memory/memory_region.h"
 #include "memory/stealable.h"
 #include "processing/engines/audio_engine.h"
+#include <algorithm>
 #include <cstdint>
 
 extern bool skipConsistencyCheck;
 uint32_t currentTraversalNo = 0;
 
-// Size 0 means don't care, just get any memory.
+// Size 0 means don't care, just get any memory. No more than maxSteals Stealables will be stolen, and if that isn't
+// enough, nothing is.
 uint32_t CacheManager::ReclaimMemory(MemoryRegion& region, int32_t totalSizeNeeded, void* thingNotToStealFrom,
-                                     int32_t* __restrict__ foundSpaceSize) {
+                                     int32_t* __restrict__ foundSpaceSize, int32_t maxSteals) {
+
+	if (maxSteals < 1) {
+		return 0;
+	}
 
 #if TEST_GENERAL_MEMORY_ALLOCATION
 	skipConsistencyCheck = true; // Things will not be in an inspectable state during this function call
@@ -47,6 +53,15 @@ uint32_t CacheManager::ReclaimMemory(MemoryRegion& region, int32_t totalSizeNeed
 			continue;
 		}
 
+		if (run_index_enabled_) {
+			ReclaimResult result = ReclaimFromRunIndex(region, q, totalSizeNeeded, thingNotToStealFrom, maxSteals,
+			                                           numberReassessed, stealable, newSpaceAddress, spaceSize);
+			found = (result == ReclaimResult::FOUND);
+			stolen = (result == ReclaimResult::STOLEN);
+			currentTraversalNo++;
+			continue;
+		}
+
 		uint32_t longestRunSeenInThisQueue = 0;
 
 		stealable = static_cast<Stealable*>(reclamation_queue_[q].getFirst());
@@ -127,8 +142,9 @@ uint32_t CacheManager::ReclaimMemory(MemoryRegion& region, int32_t totalSizeNeed
 			}
 
 			// Otherwise, see if available neighbouring memory adds up to make enough in total
-			NeighbouringMemoryGrabAttemptResult result = region.attemptToGrabNeighbouringMemory(
-			    stealable, spaceSize, amountToExtend, amountToExtend, thingNotToStealFrom, currentTraversalNo, true);
+			NeighbouringMemoryGrabAttemptResult result =
+			    region.attemptToGrabNeighbouringMemory(stealable, spaceSize, amountToExtend, amountToExtend,
+			                                           thingNotToStealFrom, currentTraversalNo, true, maxSteals);
 
 			// We also told that function to steal the initial main Stealable we are looking at, once it has ascertained
 			// that there is enough memory in total. Previously I attempted to have it steal everything but that central
@@ -178,6 +194,7 @@ uint32_t CacheManager::ReclaimMemory(MemoryRegion& region, int32_t totalSizeNeed
 	if (found && !stolen) {
 		// Warning - for perc cache Cluster, stealing one can cause it to want to allocate more memory for its list of
 		// zones
+		ForgetRun(stealable);
 		stealable->steal("i007");
 		stealable->~Stealable();
 	}
@@ -192,3 +209,252 @@ uint32_t CacheManager::ReclaimMemory(MemoryRegion& region, int32_t totalSizeNeed
 
 	return newSpaceAddress;
 }
+
+// Looks through one queue using the run index. The first few Stealables in the queue get tried first, exactly as
+// walking the queue would, so the least recently used memory still goes first in the usual case. Past those, the
+// shortest indexed run which is long enough is tried, then the next shortest, and so on, up to kMaxRunProbes of them,
+// stale records included - so unlike walking the whole queue, the time taken doesn't grow with the number of
+// Stealables.
+CacheManager::ReclaimResult CacheManager::ReclaimFromRunIndex(MemoryRegion& region, size_t q, int32_t totalSizeNeeded,
+                                                              void* thingNotToStealFrom, int32_t maxSteals,
+                                                              int32_t& numberReassessed, Stealable*& stealable,
+                                                              uint32_t& newSpaceAddress, uint32_t& spaceSize) {
+	auto queue = static_cast<StealableQueue>(q);
+
+	auto* head = static_cast<Stealable*>(reclamation_queue_[q].getFirst());
+	int32_t numHeadChecks = 0;
+
+	StealableRun key = {(uint32_t)q, (uint32_t)totalSizeNeeded, 0};
+	int32_t i = -1;
+
+	for (int32_t probes = 0; probes < kMaxRunProbes;) {
+		Stealable* candidate;
+
+		if (numHeadChecks < kMaxHeadChecks) {
+			candidate = head;
+			if (candidate == nullptr) {
+				numHeadChecks = kMaxHeadChecks;
+				continue;
+			}
+			numHeadChecks++;
+			head = static_cast<Stealable*>(reclamation_queue_[q].getNext(candidate));
+
+			// As when walking the queue, check a few times per reclaim whether things are in the right queue
+			if (q < kNumStealableQueue - 1 && numberReassessed < 4 && candidate->mayBeStolen(thingNotToStealFrom)) {
+				numberReassessed++;
+				StealableQueue appropriateQueue = candidate->getAppropriateQueue();
+				if (appropriateQueue > queue) {
+					D_PRINTLN("changing queue from  %d  to  %d", q, appropriateQueue);
+					candidate->remove();
+					QueueForReclamation(appropriateQueue, candidate);
+					continue;
+				}
+			}
+		}
+		else {
+			// Searched for lazily, as anything above can change the index
+			if (i == -1) {
+				i = runs_.searchMultiWord((uint32_t*)&key, GREATER_OR_EQUAL);
+			}
+			if (i >= runs_.getNumElements()) {
+				break;
+			}
+			StealableRun run = *(StealableRun*)runs_.getElementAddress(i);
+			if (run.queue != q) {
+				break;
+			}
+
+			// Records for things which have since been moved or left the queue are only noticed now. Clearing them
+			// out counts as a probe too, or a queue full of them would have no limit on the work done here
+			probes++;
+			if (!IsIndexed(run)) {
+				runs_.deleteAtIndex(i);
+				continue;
+			}
+			candidate = (Stealable*)run.address;
+
+			// Already tried at the front of the queue
+			if (candidate->lastTraversalNo == currentTraversalNo) {
+				i++;
+				continue;
+			}
+		}
+
+		if (!candidate->mayBeStolen(thingNotToStealFrom)) {
+			if (i != -1) {
+				i++;
+			}
+			continue;
+		}
+
+		uint32_t candidateSize = *(uint32_t*)((uint32_t)candidate - 4) & SPACE_SIZE_MASK;
+		candidate->lastTraversalNo = currentTraversalNo;
+
+		int32_t amountToExtend = totalSizeNeeded - candidateSize;
+		if (amountToExtend <= 0) {
+			stealable = candidate;
+			newSpaceAddress = (uint32_t)candidate;
+			spaceSize = candidateSize;
+			return ReclaimResult::FOUND;
+		}
+
+		// This also steals the candidate itself if it succeeds - see the explanation in ReclaimMemory()
+		NeighbouringMemoryGrabAttemptResult result =
+		    region.attemptToGrabNeighbouringMemory(candidate, candidateSize, amountToExtend, amountToExtend,
+		                                           thingNotToStealFrom, currentTraversalNo, true, maxSteals);
+
+		if (result.address) {
+			newSpaceAddress = result.address;
+			spaceSize = candidateSize + result.amountsExtended[0] + result.amountsExtended[1];
+			D_PRINTLN("stole and grabbed neighbouring stuff too...........");
+			AudioEngine::bypassCulling = true; // Paul: We don't want our samples to drop out because of this maneuver
+			return ReclaimResult::STOLEN;
+		}
+
+		// The run is shorter than its record says. Re-keying it moves it below what we're searching for, so the record
+		// now at i is the next one to try.
+		SetRunLength(candidate, q, result.longestRunFound);
+		if (i != -1 && result.longestRunFound >= totalSizeNeeded) {
+			i++; // Long enough, but some of it couldn't be stolen for this particular caller
+		}
+	}
+
+	longest_runs_[q] = std::max(LongestIndexedRun(q), unindexed_runs_[q]);
+	return ReclaimResult::NONE;
+}
+
+// A run is a Stealable plus the empty space and other queued Stealables directly either side of it - what
+// attemptToGrabNeighbouringMemory() would be able to take when reclaiming it. Only kMaxRunNeighbours spaces are looked
+// at each way.
+void CacheManager::IndexRun(Stealable* stealable) {
+	int32_t q = QueueIndexOf(stealable);
+	if (q < 0) {
+		return;
+	}
+
+	Stealable* members[kMaxRunNeighbours * 2];
+	int32_t numMembers = 0;
+
+	uint32_t stealableSize = *(uint32_t*)((uint32_t)stealable - 4) & SPACE_SIZE_MASK;
+	uint32_t length = stealableSize;
+
+	for (int32_t lookingLeft = 0; lookingLeft < 2; lookingLeft++) {
+		uint32_t* __restrict__ look = lookingLeft ? (uint32_t*)((uint32_t)stealable - 8)
+		                                          : (uint32_t*)((uint32_t)stealable + stealableSize + 4);
+
+		for (int32_t n = 0; n < kMaxRunNeighbours; n++) {
+			uint32_t spaceType = *look & SPACE_TYPE_MASK;
+			uint32_t spaceHereSize = *look & SPACE_SIZE_MASK;
+			uint32_t spaceHereAddress = lookingLeft ? (uint32_t)look - spaceHereSize : (uint32_t)(look + 1);
+
+			if (spaceType == SPACE_HEADER_STEALABLE) {
+				auto* neighbour = (Stealable*)spaceHereAddress;
+				if (QueueIndexOf(neighbour) < 0) {
+					break;
+				}
+				members[numMembers++] = neighbour;
+			}
+			else if (spaceType != SPACE_HEADER_EMPTY) {
+				break;
+			}
+
+			length += spaceHereSize + 8;
+			look = lookingLeft ? (uint32_t*)(spaceHereAddress - 8) : (uint32_t*)(spaceHereAddress + spaceHereSize + 4);
+		}
+	}
+
+	SetRunLength(stealable, q, length);
+
+	// The same run is reachable from each of the others in it, as far as their records are concerned
+	for (int32_t m = 0; m < numMembers; m++) {
+		if (members[m]->indexedRunLength < length) {
+			SetRunLength(members[m], QueueIndexOf(members[m]), length);
+		}
+	}
+}
+
+void CacheManager::ForgetRun(Stealable* stealable) {
+	if (!stealable->indexedRunLength) {
+		return;
+	}
+	StealableRun run = {stealable->indexedQueue, stealable->indexedRunLength, (uint32_t)stealable};
+	int32_t i = runs_.searchMultiWordExact((uint32_t*)&run);
+	if (i != -1) {
+		runs_.deleteAtIndex(i);
+	}
+	stealable->indexedRunLength = 0;
+}
+
+void CacheManager::IndexNeighbouringRuns(uint32_t address, uint32_t spaceSize, bool mayLookLeft, bool mayLookRight) {
+	if (mayLookLeft) {
+		uint32_t* __restrict__ lookLeft = (uint32_t*)(address - 8);
+		if ((*lookLeft & SPACE_TYPE_MASK) == SPACE_HEADER_STEALABLE) {
+			IndexRun((Stealable*)((uint32_t)lookLeft - (*lookLeft & SPACE_SIZE_MASK)));
+		}
+	}
+	if (mayLookRight) {
+		uint32_t* __restrict__ lookRight = (uint32_t*)(address + spaceSize + 4);
+		if ((*lookRight & SPACE_TYPE_MASK) == SPACE_HEADER_STEALABLE) {
+			IndexRun((Stealable*)(lookRight + 1));
+		}
+	}
+}
+
+void CacheManager::SetRunLength(Stealable* stealable, size_t q, uint32_t length) {
+	ForgetRun(stealable);
+
+	StealableRun run = {(uint32_t)q, length, (uint32_t)stealable};
+	if (runs_.insertAtKeyMultiWord((uint32_t*)&run) == -1) {
+
+		// The index is full. Make room by dropping this queue's shortest run, if that's shorter than this one. Either
+		// way the queue can no longer be skipped for sizes up to the length of the run left out.
+		StealableRun shortestKey = {(uint32_t)q, 0, 0};
+		int32_t i = runs_.searchMultiWord((uint32_t*)&shortestKey, GREATER_OR_EQUAL);
+		StealableRun* shortest = (i < runs_.getNumElements()) ? (StealableRun*)runs_.getElementAddress(i) : nullptr;
+		if (shortest == nullptr || shortest->queue != q || shortest->length >= length) {
+			unindexed_runs_[q] = std::max(unindexed_runs_[q], length);
+			longest_runs_[q] = std::max(longest_runs_[q], length);
+			return;
+		}
+
+		unindexed_runs_[q] = std::max(unindexed_runs_[q], shortest->length);
+		if (IsIndexed(*shortest)) {
+			((Stealable*)shortest->address)->indexedRunLength = 0;
+		}
+		runs_.deleteAtIndex(i);
+		if (runs_.insertAtKeyMultiWord((uint32_t*)&run) == -1) {
+			return;
+		}
+	}
+
+	stealable->indexedRunLength = length;
+	stealable->indexedQueue = q;
+	longest_runs_[q] = std::max(longest_runs_[q], length);
+}
+
+bool CacheManager::IsIndexed(StealableRun const& run) {
+	if ((*(uint32_t*)(run.address - 4) & SPACE_TYPE_MASK) != SPACE_HEADER_STEALABLE) {
+		return false;
+	}
+	auto* stealable = (Stealable*)run.address;
+	return stealable->indexedRunLength == run.length && stealable->indexedQueue == run.queue
+	       && stealable->list == &reclamation_queue_[run.queue];
+}
+
+int32_t CacheManager::QueueIndexOf(Stealable* stealable) {
+	BidirectionalLinkedList* list = stealable->list;
+	if (list < reclamation_queue_.data() || list >= reclamation_queue_.data() + kNumStealableQueue) {
+		return -1;
+	}
+	return list - reclamation_queue_.data();
+}
+
+uint32_t CacheManager::LongestIndexedRun(size_t q) {
+	StealableRun nextQueueKey = {(uint32_t)q + 1, 0, 0};
+	int32_t i = runs_.searchMultiWord((uint32_t*)&nextQueueKey, GREATER_OR_EQUAL) - 1;
+	if (i < 0) {
+		return 0;
+	}
+	auto* longest = (StealableRun*)runs_.getElementAddress(i);
+	return (longest->queue == q) ? longest->length : 0;
+}
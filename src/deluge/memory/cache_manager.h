@@ -2,6 +2,7 @@
 
 #include "definitions_cxx.hpp"
 #include "memory/stealable.h"
+#include "util/container/array/ordered_resizeable_array_with_multi_word_key.h"
 #include "util/container/list/bidirectional_linked_list.h"
 #include "util/misc.h"
 #include <array>
@@ -9,9 +10,36 @@
 
 class MemoryRegion;
 
+// A record in the run index. Ordered by queue, then run length, then address, so each queue's records are
+// contiguous and a search for the first run at least some length long gives the best fit in that queue.
+struct StealableRun {
+	uint32_t queue;
+	uint32_t length; // Bytes, including the Stealable itself and the headers of everything merged with it
+	uint32_t address;
+};
+
 class CacheManager {
 public:
-	CacheManager() = default;
+	/// Neighbouring spaces looked at in each direction when measuring a run. Keeps queueing cheap, at the cost of
+	/// undercounting the occasional very long run of tiny spaces.
+	static constexpr int32_t kMaxRunNeighbours = 8;
+	/// Stealables at the front of a queue which are considered on their own, in LRU order, before the run index
+	static constexpr int32_t kMaxHeadChecks = 4;
+	/// Most run records looked at per queue per reclaim, including stale ones which just get deleted, so this bounds
+	/// the time a reclaim can take. Any stale records left over are cleared out by later reclaims.
+	static constexpr int32_t kMaxRunProbes = 8;
+	/// Passed as maxSteals when any number of Stealables may be stolen to make space
+	static constexpr int32_t kNoStealLimit = 0x7FFFFFFF;
+
+	CacheManager() : runs_(sizeof(StealableRun), 3) {}
+
+	/// Give the run index somewhere to live. Without it, reclaiming falls back to walking the whole of each queue.
+	void setupRunIndex(void* memory, int32_t memorySize) {
+		runs_.setStaticMemory(memory, memorySize);
+		run_index_enabled_ = (memorySize >= (int32_t)sizeof(StealableRun));
+	}
+	bool runIndexEnabled() const { return run_index_enabled_; }
+	int32_t numIndexedRuns() { return runs_.getNumElements(); }
 
 	BidirectionalLinkedList& queue(StealableQueue destination) {
 		return reclamation_queue_.at(util::to_underlying(destination));
@@ -30,17 +58,53 @@ public:
 		/// in the remainder of the song, so if there's not enough memory pressure for all stealable clusters to get
 		/// reclaimed the same few just get put on and off the list repeatedly
 		reclamation_queue_[q].addToEnd(stealable);
-		longest_runs_[q] = 0xFFFFFFFF; // TODO: actually investigate neighbouring memory "run".
+		if (run_index_enabled_) {
+			IndexRun(stealable);
+		}
+		else {
+			longest_runs_[q] = 0xFFFFFFFF;
+		}
+	}
+
+	/// Measure the run of empty and queued stealable memory around a queued Stealable, and (re-)index it and any
+	/// neighbours whose runs just got longer. Call after putting a Stealable into a queue other than with
+	/// QueueForReclamation().
+	void IndexRun(Stealable* stealable);
+	/// Take a Stealable out of the run index, before it's stolen or deallocated
+	void ForgetRun(Stealable* stealable);
+	/// Called by the region once it has marked a space as empty, as that lengthens the runs of Stealables next to it
+	void NoteEmptySpace(uint32_t address, uint32_t spaceSize, bool mayLookLeft, bool mayLookRight) {
+		if (run_index_enabled_) {
+			IndexNeighbouringRuns(address, spaceSize, mayLookLeft, mayLookRight);
+		}
 	}
 
 	uint32_t ReclaimMemory(MemoryRegion& region, int32_t totalSizeNeeded, void* thingNotToStealFrom,
-	                       int32_t* __restrict__ foundSpaceSize);
+	                       int32_t* __restrict__ foundSpaceSize, int32_t maxSteals = kNoStealLimit);
 
 private:
+	enum class ReclaimResult { NONE, FOUND, STOLEN };
+
+	ReclaimResult ReclaimFromRunIndex(MemoryRegion& region, size_t q, int32_t totalSizeNeeded,
+	                                  void* thingNotToStealFrom, int32_t maxSteals, int32_t& numberReassessed,
+	                                  Stealable*& stealable, uint32_t& newSpaceAddress, uint32_t& spaceSize);
+	void IndexNeighbouringRuns(uint32_t address, uint32_t spaceSize, bool mayLookLeft, bool mayLookRight);
+	void SetRunLength(Stealable* stealable, size_t q, uint32_t length);
+	bool IsIndexed(StealableRun const& run);
+	int32_t QueueIndexOf(Stealable* stealable);
+	uint32_t LongestIndexedRun(size_t q);
+
 	std::array<BidirectionalLinkedList, kNumStealableQueue> reclamation_queue_;
 
-	// Keeps track, semi-accurately, of biggest runs of memory that could be stolen. In a perfect world, we'd have a
-	// second index on stealableClusterQueues[q], for run length. Although even that wouldn't automatically reflect
-	// changes to run lengths as neighbouring memory is allocated.
+	// Keeps track of the biggest runs of memory that could be stolen from each queue, so queues which can't help can
+	// be skipped. With the run index this is the longest indexed run (or longer, if the index overflowed), otherwise
+	// it's only semi-accurate.
 	std::array<uint32_t, kNumStealableQueue> longest_runs_;
+
+	// Second index on the queues, by run length - see IndexRun(). Runs only ever get re-measured when they grow, so a
+	// record can be longer than what's really there now. Those get corrected when a reclaim finds them to be too short.
+	OrderedResizeableArrayWithMultiWordKey runs_;
+	bool run_index_enabled_ = false;
+	// Longest run per queue which couldn't be indexed because the index was full
+	std::array<uint32_t, kNumStealableQueue> unindexed_runs_{};
 };
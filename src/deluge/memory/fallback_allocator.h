@@ -1,6 +1,7 @@
 #pragma once
 #include "memory/general_memory_allocator.h"
 #include <cstddef>
+#include <cstdlib>
 extern "C" {
 void abort(void); // this is defined in reset_handler.S
 }
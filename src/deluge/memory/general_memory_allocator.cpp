@@ -21,10 +21,18 @@
 #include "memory/stealable.h"
 #include "processing/engines/audio_engine.h"
 
+#if ENABLE_ALLOCATION_TRACE
+#define TRACE_ALLOCATOR_OP(...) traceOp(__VA_ARGS__)
+#else
+#define TRACE_ALLOCATOR_OP(...) ((void)0)
+#endif
+
 // TODO: Check if these have the right size
 char emptySpacesMemory[sizeof(EmptySpaceRecord) * 512];
 char emptySpacesMemoryInternal[sizeof(EmptySpaceRecord) * 1024];
 char emptySpacesMemoryGeneral[sizeof(EmptySpaceRecord) * 256];
+// When full, the shortest runs get dropped first, and those matter least as the front of each queue is always checked
+char stealableRunsMemory[sizeof(StealableRun) * 1024];
 extern uint32_t __sdram_bss_start;
 extern uint32_t __sdram_bss_end;
 extern uint32_t __heap_start;
@@ -35,11 +43,13 @@ GeneralMemoryAllocator::GeneralMemoryAllocator() {
 	lock = false;
 
 	regions[MEMORY_REGION_STEALABLE].setup(emptySpacesMemory, sizeof(emptySpacesMemory), (uint32_t)&__sdram_bss_end,
-	                                       EXTERNAL_MEMORY_END - RESERVED_EXTERNAL_ALLOCATOR);
+	                                       EXTERNAL_MEMORY_END - RESERVED_EXTERNAL_ALLOCATOR, stealableRunsMemory,
+	                                       sizeof(stealableRunsMemory));
 	regions[MEMORY_REGION_EXTERNAL].setup(emptySpacesMemoryGeneral, sizeof(emptySpacesMemoryGeneral),
 	                                      EXTERNAL_MEMORY_END - RESERVED_EXTERNAL_ALLOCATOR, EXTERNAL_MEMORY_END);
 	regions[MEMORY_REGION_INTERNAL].setup(emptySpacesMemoryInternal, sizeof(emptySpacesMemoryInternal),
 	                                      (uint32_t)&__heap_start, (uint32_t)&program_stack_start);
+	smallAllocations.setup(&regions[MEMORY_REGION_INTERNAL]);
 
 #if ALPHA_OR_BETA_VERSION
 	regions[MEMORY_REGION_STEALABLE].name = "stealable";
@@ -108,6 +118,44 @@ void GeneralMemoryAllocator::deallocExternal(void* address) {
 // available.
 void* GeneralMemoryAllocator::alloc(uint32_t requiredSize, bool mayUseOnChipRam, bool makeStealable,
                                     void* thingNotToStealFrom) {
+	void* address = allocUntraced(requiredSize, mayUseOnChipRam, makeStealable, thingNotToStealFrom);
+	TRACE_ALLOCATOR_OP(AllocationTrace::Op::ALLOC, address, requiredSize, 0,
+	                   address ? getAllocatedSize(address) : 0,
+	                   (mayUseOnChipRam ? AllocationTrace::kFlagMayUseOnChipRam : 0)
+	                       | (makeStealable ? AllocationTrace::kFlagMakeStealable : 0));
+	return address;
+}
+
+void* GeneralMemoryAllocator::allocRealtime(uint32_t requiredSize, bool makeStealable, void* thingNotToStealFrom) {
+	void* address = realtimeReserve.take(requiredSize, makeStealable);
+	if (address) {
+		return address; // Its allocation was already traced when the reserve was refilled
+	}
+
+	address = allocUntraced(requiredSize, true, makeStealable, thingNotToStealFrom, kMaxRealtimeSteals);
+	realtimeReserve.noteFallback(address != nullptr);
+	TRACE_ALLOCATOR_OP(AllocationTrace::Op::ALLOC, address, requiredSize, 0,
+	                   address ? getAllocatedSize(address) : 0,
+	                   AllocationTrace::kFlagMayUseOnChipRam
+	                       | (makeStealable ? AllocationTrace::kFlagMakeStealable : 0));
+	return address;
+}
+
+void GeneralMemoryAllocator::refillRealtimeReserve() {
+	// One block per call keeps each run of the task short
+	int32_t c = realtimeReserve.classNeedingRefill();
+	if (c == -1) {
+		return;
+	}
+	bool makeStealable = realtimeReserve.isStealable(c);
+	void* block = alloc(realtimeReserve.blockSize(c), !makeStealable, makeStealable, nullptr);
+	if (block) {
+		realtimeReserve.refill(c, block);
+	}
+}
+
+void* GeneralMemoryAllocator::allocUntraced(uint32_t requiredSize, bool mayUseOnChipRam, bool makeStealable,
+                                            void* thingNotToStealFrom, int32_t maxSteals) {
 
 	if (lock) {
 		return NULL; // Prevent any weird loops in freeSomeStealableMemory(), which mostly would only be bad cos they
@@ -121,6 +169,13 @@ void* GeneralMemoryAllocator::alloc(uint32_t requiredSize, bool mayUseOnChipRam,
 		// If internal is allowed, try that first
 		if (mayUseOnChipRam) {
 			lock = true;
+			if (requiredSize && requiredSize <= SlabAllocator::kMaxSize) {
+				address = smallAllocations.alloc(requiredSize);
+				if (address) {
+					lock = false;
+					return address;
+				}
+			}
 			address = regions[MEMORY_REGION_INTERNAL].alloc(requiredSize, makeStealable, thingNotToStealFrom);
 			lock = false;
 
@@ -153,7 +208,7 @@ void* GeneralMemoryAllocator::alloc(uint32_t requiredSize, bool mayUseOnChipRam,
 #endif
 
 	lock = true;
-	address = regions[MEMORY_REGION_STEALABLE].alloc(requiredSize, makeStealable, thingNotToStealFrom);
+	address = regions[MEMORY_REGION_STEALABLE].alloc(requiredSize, makeStealable, thingNotToStealFrom, maxSteals);
 	lock = false;
 	return address;
 }
@@ -181,12 +236,23 @@ int32_t GeneralMemoryAllocator::getRegion(void* address) {
 
 // Returns new size
 uint32_t GeneralMemoryAllocator::shortenRight(void* address, uint32_t newSize) {
-	return regions[getRegion(address)].shortenRight(address, newSize);
+	uint32_t resultingSize;
+	if (SlabAllocator::isSlabAllocation(address)) {
+		resultingSize = getAllocatedSize(address);
+	}
+	else {
+		resultingSize = regions[getRegion(address)].shortenRight(address, newSize);
+	}
+	TRACE_ALLOCATOR_OP(AllocationTrace::Op::SHORTEN_RIGHT, address, newSize, 0, resultingSize);
+	return resultingSize;
 }
 
 // Returns how much it was shortened by
 uint32_t GeneralMemoryAllocator::shortenLeft(void* address, uint32_t amountToShorten,
                                              uint32_t numBytesToMoveRightIfSuccessful) {
+	if (SlabAllocator::isSlabAllocation(address)) {
+		return 0;
+	}
 	return regions[getRegion(address)].shortenLeft(address, amountToShorten, numBytesToMoveRightIfSuccessful);
 }
 
@@ -197,7 +263,8 @@ void GeneralMemoryAllocator::extend(void* address, uint32_t minAmountToExtend, u
 	*getAmountExtendedLeft = 0;
 	*getAmountExtendedRight = 0;
 
-	if (lock) {
+	// slab cells have a fixed size, callers will allocate new memory instead
+	if (lock || SlabAllocator::isSlabAllocation(address)) {
 		return;
 	}
 
@@ -205,22 +272,53 @@ void GeneralMemoryAllocator::extend(void* address, uint32_t minAmountToExtend, u
 	regions[getRegion(address)].extend(address, minAmountToExtend, idealAmountToExtend, getAmountExtendedLeft,
 	                                   getAmountExtendedRight, thingNotToStealFrom);
 	lock = false;
+
+	TRACE_ALLOCATOR_OP(AllocationTrace::Op::EXTEND, address, minAmountToExtend, idealAmountToExtend,
+	                   (uint32_t)address - *getAmountExtendedLeft);
 }
 
 uint32_t GeneralMemoryAllocator::extendRightAsMuchAsEasilyPossible(void* address) {
+	if (SlabAllocator::isSlabAllocation(address)) {
+		return getAllocatedSize(address);
+	}
 	return regions[getRegion(address)].extendRightAsMuchAsEasilyPossible(address);
 }
 
 void GeneralMemoryAllocator::dealloc(void* address) {
+	TRACE_ALLOCATOR_OP(AllocationTrace::Op::DEALLOC, address, getAllocatedSize(address), 0, 0);
+	if (SlabAllocator::isSlabAllocation(address)) {
+		return smallAllocations.dealloc(address);
+	}
 	return regions[getRegion(address)].dealloc(address);
 }
 
 void GeneralMemoryAllocator::putStealableInQueue(Stealable* stealable, StealableQueue q) {
 	MemoryRegion& region = regions[getRegion(stealable)];
 	region.cache_manager().QueueForReclamation(q, stealable);
+	TRACE_ALLOCATOR_OP(AllocationTrace::Op::QUEUE_STEALABLE, stealable, getAllocatedSize(stealable),
+	                   util::to_underlying(q), 0);
 }
 
 void GeneralMemoryAllocator::putStealableInAppropriateQueue(Stealable* stealable) {
 	StealableQueue q = stealable->getAppropriateQueue();
 	putStealableInQueue(stealable, q);
 }
+
+bool GeneralMemoryAllocator::startAllocationTrace() {
+#if ENABLE_ALLOCATION_TRACE
+	constexpr uint32_t kCapacity = 8192;
+	trace.stop();
+	AllocationTrace::Record* buffer = trace.buffer();
+	if (!buffer) {
+		// the buffer is kept after the first trace so it can still be dumped once recording stops
+		buffer = (AllocationTrace::Record*)allocExternal(kCapacity * sizeof(AllocationTrace::Record));
+		if (!buffer) {
+			return false;
+		}
+	}
+	trace.start(buffer, kCapacity);
+	return true;
+#else
+	return false;
+#endif
+}
@@ -18,7 +18,10 @@
 #pragma once
 
 #include "definitions_cxx.hpp"
+#include "memory/allocation_trace.h"
 #include "memory/memory_region.h"
+#include "memory/realtime_reserve.h"
+#include "memory/slab_allocator.h"
 
 #define MEMORY_REGION_STEALABLE 0
 #define MEMORY_REGION_INTERNAL 1
@@ -55,10 +58,23 @@ class Stealable;
  * case where a neighbouring region of memory is chosen for allocation (or itself being stolen) when
  * the allocation requires that the object in question have its memory stolen too in order to make
  * up a large enough allocation.
+ *
+ * When no single Stealable near the front of a queue is big enough, the CacheManager looks up runs of neighbouring
+ * stealable and empty memory in a second index on the queues, ordered by run length, rather than walking every
+ * Stealable in them. See CacheManager::IndexRun().
+ *
+ * Small non-stealable allocations which may use on-chip RAM are first offered to a SlabAllocator, which serves
+ * them from size-class pools carved out of the internal region. See slab_allocator.h.
+ *
+ * Code running inside the audio routine should use allocRealtime(), which serves from a RealtimeReserve of blocks
+ * allocated ahead of time and never steals more than kMaxRealtimeSteals Stealables. See realtime_reserve.h.
  */
 
 class GeneralMemoryAllocator {
 public:
+	/// Most Stealables allocRealtime() may steal when its pools are empty
+	static constexpr int32_t kMaxRealtimeSteals = 2;
+
 	GeneralMemoryAllocator();
 	[[gnu::always_inline]] void* allocMaxSpeed(uint32_t requiredSize, void* thingNotToStealFrom = NULL) {
 		return alloc(requiredSize, true, false, thingNotToStealFrom);
@@ -73,6 +89,11 @@ public:
 	}
 
 	void* alloc(uint32_t requiredSize, bool mayUseOnChipRam, bool makeStealable, void* thingNotToStealFrom);
+	/// For use from the audio routine. Takes as long as allocMaxSpeed() at most, but with stealing bounded, and
+	/// usually just pops a block from the RealtimeReserve. May fail where allocMaxSpeed() would have succeeded.
+	void* allocRealtime(uint32_t requiredSize, bool makeStealable = false, void* thingNotToStealFrom = nullptr);
+	/// Top the RealtimeReserve back up. Never call this from the audio routine
+	void refillRealtimeReserve();
 	void dealloc(void* address);
 	void* allocExternal(uint32_t requiredSize);
 	void deallocExternal(void* address);
@@ -91,7 +112,14 @@ public:
 	void putStealableInQueue(Stealable* stealable, StealableQueue q);
 	void putStealableInAppropriateQueue(Stealable* stealable);
 
+	/// Start recording an AllocationTrace. Does nothing unless built with ENABLE_ALLOCATION_TRACE
+	bool startAllocationTrace();
+	void stopAllocationTrace() { trace.stop(); }
+
 	MemoryRegion regions[NUM_MEMORY_REGIONS];
+	SlabAllocator smallAllocations;
+	RealtimeReserve realtimeReserve;
+	AllocationTrace trace;
 
 	bool lock;
 
@@ -101,7 +129,24 @@ public:
 	}
 
 private:
+	void* allocUntraced(uint32_t requiredSize, bool mayUseOnChipRam, bool makeStealable, void* thingNotToStealFrom,
+	                    int32_t maxSteals = CacheManager::kNoStealLimit);
 	void checkEverythingOk(char const* errorString);
+
+#if ENABLE_ALLOCATION_TRACE
+	/// Called through TRACE_ALLOCATOR_OP(), so that without tracing the arguments aren't even worked out
+	[[gnu::always_inline]] void traceOp(AllocationTrace::Op op, void* address, uint32_t size, uint32_t arg,
+	                                    uint32_t result, uint8_t flags = 0) {
+		uint8_t region = AllocationTrace::kNoRegion;
+		if (address) {
+			region = getRegion(address);
+			if (SlabAllocator::isSlabAllocation(address)) {
+				flags |= AllocationTrace::kFlagSlab;
+			}
+		}
+		trace.add(op, (uint32_t)address, size, arg, result, region, flags);
+	}
+#endif
 };
 
 extern "C" {
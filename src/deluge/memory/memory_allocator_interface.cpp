@@ -11,3 +11,7 @@ void* allocLowSpeed(uint32_t requiredSize, void* thingNotToStealFrom = NULL) {
 void* allocStealable(uint32_t requiredSize, void* thingNotToStealFrom = NULL) {
 	return GeneralMemoryAllocator::get().alloc(requiredSize, false, true, thingNotToStealFrom);
 }
+
+void* allocRealtime(uint32_t requiredSize) {
+	return GeneralMemoryAllocator::get().allocRealtime(requiredSize);
+}
@@ -9,6 +9,9 @@ void* allocLowSpeed(uint32_t requiredSize, void* thingNotToStealFrom = nullptr);
 
 void* allocStealable(uint32_t requiredSize, void* thingNotToStealFrom = nullptr);
 
+// For use from the audio routine - see GeneralMemoryAllocator::allocRealtime()
+void* allocRealtime(uint32_t requiredSize);
+
 extern "C" {
 void* delugeAlloc(unsigned int requiredSize, bool mayUseOnChipRam);
 void delugeDealloc(void* address);
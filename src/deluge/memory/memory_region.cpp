@@ -31,9 +31,13 @@ MemoryRegion::MemoryRegion() : emptySpaces(sizeof(EmptySpaceRecord)) {
 	numAllocations = 0;
 }
 
+// The stealable runs memory is only needed for regions which will hold Stealables - see CacheManager::IndexRun()
 void MemoryRegion::setup(void* emptySpacesMemory, int32_t emptySpacesMemorySize, uint32_t regionBegin,
-                         uint32_t regionEnd) {
+                         uint32_t regionEnd, void* stealableRunsMemory, int32_t stealableRunsMemorySize) {
 	emptySpaces.setStaticMemory(emptySpacesMemory, emptySpacesMemorySize);
+	if (stealableRunsMemory) {
+		cache_manager_.setupRunIndex(stealableRunsMemory, stealableRunsMemorySize);
+	}
 	start = regionBegin;
 	// this is actually the location of the footer but that's better anyway
 	end = regionEnd - 8;
@@ -115,6 +119,14 @@ void MemoryRegion::verifyMemoryNotFree(void* address, uint32_t spaceSize) {
 	}
 }
 
+uint32_t MemoryRegion::getTotalEmptySpace() {
+	uint32_t total = 0;
+	for (int32_t i = 0; i < emptySpaces.getNumElements(); i++) {
+		total += ((EmptySpaceRecord*)emptySpaces.getElementAddress(i))->length;
+	}
+	return total;
+}
+
 // Okay this is me being experimental and trying something you're not supposed to do - using static variables in place
 // of stack ones within a function. It seemed to give a slight speed up, but it's probably quite circumstantial, and I
 // wouldn't normally do this.
@@ -270,9 +282,11 @@ goingToReplaceOldRecord:
 	*header = headerData;
 	*footer = headerData;
 	emptySpaces.testSequentiality("M005");
+
+	cache_manager_.NoteEmptySpace(address, spaceSize, mayLookLeft, mayLookRight);
 }
 
-void* MemoryRegion::alloc(uint32_t requiredSize, bool makeStealable, void* thingNotToStealFrom) {
+void* MemoryRegion::alloc(uint32_t requiredSize, bool makeStealable, void* thingNotToStealFrom, int32_t maxSteals) {
 	requiredSize = padSize(requiredSize);
 	bool large = requiredSize > pivot;
 	// set a minimum size	requiredSize = padSize(requiredSize);
@@ -369,7 +383,8 @@ justUpdateRecord:
 	// Or if no empty space big enough, try stealing some memory
 	else {
 noEmptySpace:
-		allocatedAddress = cache_manager_.ReclaimMemory(*this, requiredSize, thingNotToStealFrom, &allocatedSize);
+		allocatedAddress =
+		    cache_manager_.ReclaimMemory(*this, requiredSize, thingNotToStealFrom, &allocatedSize, maxSteals);
 		if (!allocatedAddress) {
 #if ALPHA_OR_BETA_VERSION
 			if (name) {
@@ -531,6 +546,7 @@ uint32_t MemoryRegion::extendRightAsMuchAsEasilyPossible(void* address) {
 		if (!stealable->mayBeStolen(NULL)) {
 			goto finished;
 		}
+		cache_manager_.ForgetRun(stealable);
 		stealable->steal("E446");
 		stealable->~Stealable();
 	}
@@ -563,10 +579,11 @@ finished:
 	return spaceSize;
 }
 
-// Returns new space start address, or NULL if couldn't grab enough memory.
+// Returns new space start address, or NULL if couldn't grab enough memory. Stealables beyond the first maxSteals
+// (counting the original space, if that needs stealing) are treated as if they weren't stealable.
 NeighbouringMemoryGrabAttemptResult MemoryRegion::attemptToGrabNeighbouringMemory(
     void* originalSpaceAddress, int32_t originalSpaceSize, int32_t minAmountToExtend, int32_t idealAmountToExtend,
-    void* thingNotToStealFrom, uint32_t markWithTraversalNo, bool originalSpaceNeedsStealing) {
+    void* thingNotToStealFrom, uint32_t markWithTraversalNo, bool originalSpaceNeedsStealing, int32_t maxSteals) {
 
 	NeighbouringMemoryGrabAttemptResult toReturn;
 
@@ -579,11 +596,13 @@ NeighbouringMemoryGrabAttemptResult MemoryRegion::attemptToGrabNeighbouringMemor
 	for (int32_t actuallyGrabbing = 0; actuallyGrabbing < 2; actuallyGrabbing++) {
 
 		if (actuallyGrabbing && originalSpaceNeedsStealing) {
+			cache_manager_.ForgetRun((Stealable*)originalSpaceAddress);
 			((Stealable*)originalSpaceAddress)->steal("E417"); // Jensg still getting.
 			((Stealable*)originalSpaceAddress)->~Stealable();
 		}
 
 		uint32_t amountOfExtraSpaceFoundSoFar = 0;
+		int32_t numSteals = originalSpaceNeedsStealing ? 1 : 0;
 
 		uint32_t* __restrict__ lookRight = (uint32_t*)((uint32_t)originalSpaceAddress + originalSpaceSize + 4);
 		uint32_t* __restrict__ lookLeft = (uint32_t*)((uint32_t)originalSpaceAddress - 8);
@@ -626,6 +645,10 @@ tryNotStealingFirst:
 #endif
 						break;
 					}
+					if (numSteals >= maxSteals) {
+						break;
+					}
+					numSteals++;
 					if (!actuallyGrabbing && markWithTraversalNo) {
 						stealable->lastTraversalNo = markWithTraversalNo;
 					}
@@ -670,6 +693,7 @@ tryNotStealingFirst:
 							                                                   + toReturn.amountsExtended[0]
 							                                                   + toReturn.amountsExtended[1]);
 
+							cache_manager_.ForgetRun(stealable);
 							stealable->steal("E418"); // Jensg still getting.
 							stealable->~Stealable();
 						}
@@ -836,6 +860,10 @@ void MemoryRegion::dealloc(void* address) {
 	}
 #endif
 
+	if ((*header & SPACE_TYPE_MASK) == SPACE_HEADER_STEALABLE) {
+		cache_manager_.ForgetRun((Stealable*)address);
+	}
+
 	markSpaceAsEmpty((uint32_t)address, spaceSize);
 
 	/*
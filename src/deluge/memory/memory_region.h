@@ -34,6 +34,8 @@ struct NeighbouringMemoryGrabAttemptResult {
 #define SPACE_HEADER_EMPTY 0
 #define SPACE_HEADER_STEALABLE 0x40000000
 #define SPACE_HEADER_ALLOCATED 0x80000000
+// Cells handed out by the SlabAllocator. Only ever found inside an allocated space, never between region spaces
+#define SPACE_HEADER_SLAB 0xC0000000
 
 #define SPACE_TYPE_MASK 0xC0000000u
 #define SPACE_SIZE_MASK 0x3FFFFFFFu
@@ -44,8 +46,10 @@ constexpr int32_t minAlign = 64;
 class MemoryRegion {
 public:
 	MemoryRegion();
-	void setup(void* emptySpacesMemory, int32_t emptySpacesMemorySize, uint32_t regionBegin, uint32_t regionEnd);
-	void* alloc(uint32_t requiredSize, bool makeStealable, void* thingNotToStealFrom);
+	void setup(void* emptySpacesMemory, int32_t emptySpacesMemorySize, uint32_t regionBegin, uint32_t regionEnd,
+	           void* stealableRunsMemory = nullptr, int32_t stealableRunsMemorySize = 0);
+	void* alloc(uint32_t requiredSize, bool makeStealable, void* thingNotToStealFrom,
+	            int32_t maxSteals = CacheManager::kNoStealLimit);
 	uint32_t shortenRight(void* address, uint32_t newSize);
 	uint32_t shortenLeft(void* address, uint32_t amountToShorten, uint32_t numBytesToMoveRightIfSuccessful = 0);
 	void extend(void* address, uint32_t minAmountToExtend, uint32_t idealAmountToExtend,
@@ -53,6 +57,8 @@ public:
 	uint32_t extendRightAsMuchAsEasilyPossible(void* spaceAddress);
 	void dealloc(void* address);
 	void verifyMemoryNotFree(void* address, uint32_t spaceSize);
+	/// Adds up every empty space, going through all of them, so keep it away from anything time-critical
+	uint32_t getTotalEmptySpace();
 
 	uint32_t start;
 	uint32_t end;
@@ -73,7 +79,8 @@ private:
 	NeighbouringMemoryGrabAttemptResult
 	attemptToGrabNeighbouringMemory(void* originalSpaceAddress, int32_t originalSpaceSize, int32_t minAmountToExtend,
 	                                int32_t idealAmountToExtend, void* thingNotToStealFrom,
-	                                uint32_t markWithTraversalNo = 0, bool originalSpaceNeedsStealing = false);
+	                                uint32_t markWithTraversalNo = 0, bool originalSpaceNeedsStealing = false,
+	                                int32_t maxSteals = CacheManager::kNoStealLimit);
 
 	void writeTempHeadersBeforeASteal(uint32_t newStartAddress, uint32_t newSize);
 	void sanityCheck();
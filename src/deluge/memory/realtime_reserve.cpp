@@ -0,0 +1,128 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "memory/realtime_reserve.h"
+#include "io/debug/log.h"
+#include "memory/stealable.h"
+#include <new>
+
+namespace {
+// Sits in stealable blocks while they're in the reserve, so they're never picked as neighbouring memory to steal
+class ReservedBlock final : public Stealable {
+public:
+	bool mayBeStolen(void* thingNotToStealFrom) override { return false; }
+	void steal(char const* errorCode) override {}
+	StealableQueue getAppropriateQueue() override { return StealableQueue::CURRENT_SONG_SAMPLE_DATA_PERC_CACHE; }
+};
+} // namespace
+
+bool RealtimeReserve::addClass(uint32_t blockSize, int32_t count, bool makeStealable) {
+	if (count > kMaxBlocksPerClass) {
+		count = kMaxBlocksPerClass;
+	}
+
+	int32_t c = 0;
+	for (; c < numClasses_; c++) {
+		Class& existing = classes_[c];
+		if (existing.blockSize == blockSize && existing.makeStealable == makeStealable) {
+			if (existing.target < count) {
+				existing.target = count;
+			}
+			return true;
+		}
+		if (existing.blockSize > blockSize) {
+			break;
+		}
+	}
+
+	if (numClasses_ >= kMaxClasses) {
+		return false;
+	}
+
+	// keep the classes in size order, so take() finds the best fit first
+	for (int32_t i = numClasses_; i > c; i--) {
+		classes_[i] = classes_[i - 1];
+		stats_.lowestAvailable[i] = stats_.lowestAvailable[i - 1];
+	}
+	classes_[c].blockSize = blockSize;
+	classes_[c].target = count;
+	classes_[c].numAvailable = 0;
+	classes_[c].makeStealable = makeStealable;
+	stats_.lowestAvailable[c] = count;
+	numClasses_++;
+	return true;
+}
+
+void* RealtimeReserve::take(uint32_t requiredSize, bool makeStealable) {
+	for (int32_t c = 0; c < numClasses_; c++) {
+		Class& blockClass = classes_[c];
+		if (blockClass.blockSize < requiredSize || blockClass.makeStealable != makeStealable
+		    || !blockClass.numAvailable) {
+			continue;
+		}
+
+		void* block = blockClass.blocks[--blockClass.numAvailable];
+		if (blockClass.numAvailable < stats_.lowestAvailable[c]) {
+			stats_.lowestAvailable[c] = blockClass.numAvailable;
+		}
+		if (makeStealable) {
+			// the caller constructs its own Stealable in here
+			((ReservedBlock*)block)->~ReservedBlock();
+		}
+		stats_.hits++;
+		return block;
+	}
+	return nullptr;
+}
+
+int32_t RealtimeReserve::classNeedingRefill() const {
+	for (int32_t c = 0; c < numClasses_; c++) {
+		if (classes_[c].numAvailable < classes_[c].target) {
+			return c;
+		}
+	}
+	return -1;
+}
+
+void RealtimeReserve::refill(int32_t c, void* block) {
+	Class& blockClass = classes_[c];
+	if (blockClass.makeStealable) {
+		new (block) ReservedBlock();
+	}
+	blockClass.blocks[blockClass.numAvailable++] = block;
+	stats_.refills++;
+}
+
+void RealtimeReserve::resetCounters() {
+	stats_.hits = 0;
+	stats_.fallbacks = 0;
+	stats_.failures = 0;
+	stats_.refills = 0;
+	for (int32_t c = 0; c < numClasses_; c++) {
+		stats_.lowestAvailable[c] = classes_[c].numAvailable;
+	}
+}
+
+void RealtimeReserve::logStats() const {
+	D_PRINTLN("realtime reserve: %d hits, %d fallbacks, %d failures, %d blocks refilled", stats_.hits,
+	          stats_.fallbacks, stats_.failures, stats_.refills);
+	for (int32_t c = 0; c < numClasses_; c++) {
+		D_PRINTLN("  %d byte%s blocks: %d of %d available, lowest %d", classes_[c].blockSize,
+		          classes_[c].makeStealable ? " stealable" : "", classes_[c].numAvailable, classes_[c].target,
+		          stats_.lowestAvailable[c]);
+	}
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Blocks of memory set aside for allocations made from inside AudioEngine::routine().
+ *
+ * Getting a Voice, TimeStretcher or SampleCache Cluster in the middle of rendering used to go through the full
+ * GeneralMemoryAllocator::alloc(), which may steal any number of Stealables along the way, so render time depended on
+ * the state of memory. The reserve keeps a few blocks of each size the audio routine asks for, allocated ahead of time.
+ * GeneralMemoryAllocator::allocRealtime() hands those out, and only when a pool is empty does it fall back to a normal
+ * allocation which may steal at most a couple of Stealables, failing otherwise.
+ *
+ * Blocks are ordinary allocations, so once handed out they're freed with delugeDealloc() like anything else. The pools
+ * get topped back up by GeneralMemoryAllocator::refillRealtimeReserve(), which runs as its own task outside the audio
+ * routine.
+ *
+ * Stealable blocks (for Clusters) hold a placeholder Stealable which refuses to be stolen, so the region can look at
+ * them while they wait.
+ */
+class RealtimeReserve {
+public:
+	static constexpr int32_t kMaxClasses = 8;
+	static constexpr int32_t kMaxBlocksPerClass = 16;
+
+	struct Stats {
+		uint32_t hits;                         // requests served from a pool
+		uint32_t fallbacks;                    // requests which went to the regions, with stealing bounded
+		uint32_t failures;                     // requests which couldn't be served at all
+		uint32_t refills;                      // blocks allocated to top the pools up
+		uint32_t lowestAvailable[kMaxClasses]; // fewest blocks each pool has had since the counters were reset
+	};
+
+	/// Keep count blocks of blockSize bytes on hand. A class that's already there has its count raised if need be.
+	/// Returns false if there's no room for another class.
+	bool addClass(uint32_t blockSize, int32_t count, bool makeStealable = false);
+
+	/// Take a block from the smallest class which is big enough and has one available, or nullptr
+	void* take(uint32_t requiredSize, bool makeStealable = false);
+	/// Record what happened to a request take() couldn't serve
+	void noteFallback(bool served) { served ? stats_.fallbacks++ : stats_.failures++; }
+
+	/// A class with fewer blocks than it should have, or -1 if they're all full
+	int32_t classNeedingRefill() const;
+	uint32_t blockSize(int32_t c) const { return classes_[c].blockSize; }
+	bool isStealable(int32_t c) const { return classes_[c].makeStealable; }
+	/// Add a block allocated by the caller to class c
+	void refill(int32_t c, void* block);
+
+	int32_t numClasses() const { return numClasses_; }
+	int32_t numAvailable(int32_t c) const { return classes_[c].numAvailable; }
+
+	const Stats& stats() const { return stats_; }
+	void resetCounters();
+	void logStats() const;
+
+private:
+	struct Class {
+		uint32_t blockSize;
+		int32_t target;
+		int32_t numAvailable;
+		bool makeStealable;
+		void* blocks[kMaxBlocksPerClass];
+	};
+
+	Class classes_[kMaxClasses];
+	int32_t numClasses_ = 0;
+	Stats stats_ = {0};
+};
@@ -0,0 +1,200 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "memory/slab_allocator.h"
+#include "definitions_cxx.hpp"
+#include "io/debug/log.h"
+#include "util/fixedpoint.h"
+
+void SlabAllocator::setup(MemoryRegion* backingRegion) {
+	region_ = backingRegion;
+	for (int32_t c = 0; c < kNumSizeClasses; c++) {
+		partial_[c] = nullptr;
+	}
+	numSlabs_ = 0;
+	stats_ = {0};
+}
+
+int32_t SlabAllocator::sizeClassFor(uint32_t requiredSize) {
+	uint32_t cell = requiredSize + kCellOverhead;
+	if (cell <= kMinCellSize) {
+		return 0;
+	}
+	// round up to the next power of 2, then count up from the smallest class
+	return (32 - clz(cell - 1)) - (32 - clz(kMinCellSize - 1));
+}
+
+void SlabAllocator::pushFront(Slab* slab) {
+	Slab*& head = partial_[slab->sizeClass];
+	slab->prev = nullptr;
+	slab->next = head;
+	if (head) {
+		head->prev = slab;
+	}
+	head = slab;
+}
+
+void SlabAllocator::unlink(Slab* slab) {
+	if (slab->prev) {
+		slab->prev->next = slab->next;
+	}
+	else {
+		partial_[slab->sizeClass] = slab->next;
+	}
+	if (slab->next) {
+		slab->next->prev = slab->prev;
+	}
+	slab->next = nullptr;
+	slab->prev = nullptr;
+}
+
+SlabAllocator::Slab* SlabAllocator::newSlab(int32_t sizeClass) {
+	if (numSlabs_ >= kMaxSlabs) {
+		return nullptr;
+	}
+	Slab* slab = (Slab*)region_->alloc(kSlabSize, false, nullptr);
+	if (!slab) {
+		return nullptr;
+	}
+
+	uint32_t stride = cellSize(sizeClass);
+	slab->sizeClass = sizeClass;
+	slab->numUsed = 0;
+	slab->numCells = (kSlabSize - kSlabHeaderSize) / stride;
+
+	// thread the free list through the cells, lowest address first so neighbouring allocations stay together
+	uint32_t headerValue = SPACE_HEADER_SLAB | (stride - kCellOverhead);
+	uint32_t cell = (uint32_t)slab + kSlabHeaderSize;
+	void* next = nullptr;
+	for (int32_t i = slab->numCells - 1; i >= 0; i--) {
+		uint32_t* cellWords = (uint32_t*)(cell + i * stride);
+		cellWords[0] = (uint32_t)slab;
+		cellWords[1] = headerValue;
+		*(void**)&cellWords[2] = next;
+		next = &cellWords[2];
+	}
+	slab->freeList = next;
+
+	numSlabs_++;
+	stats_.slabsAllocated++;
+	stats_.bytesHeld += kSlabSize;
+	if (stats_.bytesHeld > stats_.peakBytesHeld) {
+		stats_.peakBytesHeld = stats_.bytesHeld;
+	}
+	pushFront(slab);
+	return slab;
+}
+
+void* SlabAllocator::alloc(uint32_t requiredSize) {
+	if (!region_ || requiredSize == 0 || requiredSize > kMaxSize) {
+		return nullptr;
+	}
+
+	int32_t sizeClass = sizeClassFor(requiredSize);
+	Slab* slab = partial_[sizeClass];
+	if (!slab) {
+		slab = newSlab(sizeClass);
+		if (!slab) {
+			stats_.misses++;
+			return nullptr;
+		}
+	}
+
+	void* address = slab->freeList;
+	slab->freeList = *(void**)address;
+	slab->numUsed++;
+	if (!slab->freeList) {
+		// full, stop offering it until something is freed
+		unlink(slab);
+	}
+
+	// record what was asked for rather than the cell size, so the stats can see padding within cells
+	requiredSize = (requiredSize + 3) & ~3u;
+	*(uint32_t*)((uint32_t)address - 4) = SPACE_HEADER_SLAB | requiredSize;
+
+	stats_.hits++;
+	stats_.bytesInUse += cellSize(sizeClass);
+	stats_.bytesRequested += requiredSize;
+	stats_.numCellsInUse[sizeClass]++;
+	return address;
+}
+
+void SlabAllocator::dealloc(void* address) {
+	uint32_t* header = (uint32_t*)((uint32_t)address - 4);
+	Slab* slab = (Slab*)*(uint32_t*)((uint32_t)address - 8);
+
+#if ALPHA_OR_BETA_VERSION
+	if ((*header & SPACE_TYPE_MASK) != SPACE_HEADER_SLAB || slab->numUsed == 0) {
+		// not one of ours, or a double free
+		FREEZE_WITH_ERROR("M002");
+	}
+#endif
+
+	int32_t sizeClass = slab->sizeClass;
+	bool wasFull = !slab->freeList;
+	*(void**)address = slab->freeList;
+	slab->freeList = address;
+	slab->numUsed--;
+
+	stats_.frees++;
+	stats_.bytesInUse -= cellSize(sizeClass);
+	stats_.bytesRequested -= *header & SPACE_SIZE_MASK;
+	stats_.numCellsInUse[sizeClass]--;
+
+	if (wasFull) {
+		pushFront(slab);
+	}
+	else if (slab->numUsed == 0 && (slab->next || slab->prev)) {
+		// completely empty and not the last slab with space in its class - hand it back
+		unlink(slab);
+		region_->dealloc(slab);
+		numSlabs_--;
+		stats_.slabsReleased++;
+		stats_.bytesHeld -= kSlabSize;
+	}
+}
+
+void SlabAllocator::resetCounters() {
+	stats_.hits = 0;
+	stats_.misses = 0;
+	stats_.frees = 0;
+	stats_.peakBytesHeld = stats_.bytesHeld;
+}
+
+uint32_t SlabAllocator::hitRatePercent() const {
+	uint32_t total = stats_.hits + stats_.misses;
+	if (!total) {
+		return 100;
+	}
+	return (uint64_t)stats_.hits * 100 / total;
+}
+
+uint32_t SlabAllocator::fragmentationPercent() const {
+	if (!stats_.bytesHeld) {
+		return 0;
+	}
+	return (uint64_t)(stats_.bytesHeld - stats_.bytesRequested) * 100 / stats_.bytesHeld;
+}
+
+void SlabAllocator::logStats() const {
+	D_PRINTLN("slabs: %d hits %d misses (%d%%), %d slabs held, %d / %d bytes used, %d%% fragmented, peak %d",
+	          stats_.hits, stats_.misses, hitRatePercent(), numSlabs_, stats_.bytesRequested, stats_.bytesHeld,
+	          fragmentationPercent(), stats_.peakBytesHeld);
+	for (int32_t c = 0; c < kNumSizeClasses; c++) {
+		D_PRINTLN("  %d byte cells: %d in use", cellSize(c), stats_.numCellsInUse[c]);
+	}
+}
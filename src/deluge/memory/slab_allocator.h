@@ -0,0 +1,116 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "memory/memory_region.h"
+#include <cstdint>
+
+/*
+ * Size-class pools for small allocations.
+ *
+ * MemoryRegion pads every allocation to at least minAlign bytes and adds an 8 byte header / footer pair, and every
+ * alloc and dealloc is a binary search plus an insert or delete in the empty spaces array. Song loading makes
+ * thousands of tiny allocations (strings, param nodes, note rows), so those end up costing several times their size
+ * and fragment the internal region.
+ *
+ * The SlabAllocator carves kSlabSize chunks ("slabs") out of a backing MemoryRegion and splits each one into equal
+ * cells of a single size class. Allocation and deallocation are then O(1) pushes and pops on the slab's free list.
+ *
+ * Each cell is laid out as [Slab* owner][header][payload...], so the word directly before the returned address
+ * looks like a normal MemoryRegion header and getAllocatedSize() keeps working - it reports the requested size rounded
+ * up to 4 bytes, so the stats can tell how much of each cell is padding. The header's type bits are
+ * SPACE_HEADER_SLAB, which is how GeneralMemoryAllocator tells slab cells apart from region allocations. Slab cells
+ * can't be extended or shortened; the usual "couldn't do it" result is returned and callers fall back to
+ * allocating new memory.
+ *
+ * A slab goes back to the region once it is completely empty, unless it's the only partially free slab left in its
+ * class. That keeps one slab per class warm so alloc / free ping-pong doesn't thrash the region.
+ */
+class SlabAllocator {
+public:
+	/// Bytes taken from the backing region for each slab
+	static constexpr uint32_t kSlabSize = 4096;
+	/// Space at the start of each slab reserved for its Slab record, keeps cells 8 byte aligned
+	static constexpr uint32_t kSlabHeaderSize = 32;
+	/// Owner pointer plus header word before each payload
+	static constexpr uint32_t kCellOverhead = 8;
+	static constexpr uint32_t kMinCellSize = 16;
+	static constexpr int32_t kNumSizeClasses = 5;
+	static constexpr uint32_t kMaxCellSize = kMinCellSize << (kNumSizeClasses - 1);
+	/// Largest request served from the pools, anything bigger goes straight to the region
+	static constexpr uint32_t kMaxSize = kMaxCellSize - kCellOverhead;
+	/// Upper limit on how much of the backing region the pools may hold at once
+	static constexpr uint32_t kMaxSlabs = 256;
+
+	struct Stats {
+		uint32_t hits;           // requests served from a pool
+		uint32_t misses;         // small requests that had to go to the region instead
+		uint32_t frees;          // cells returned to a pool
+		uint32_t slabsAllocated; // slabs taken from the region over all time
+		uint32_t slabsReleased;  // slabs given back to the region over all time
+		uint32_t bytesHeld;      // bytes currently held from the region
+		uint32_t bytesInUse;     // bytes of cells currently handed out, including their overhead
+		uint32_t bytesRequested; // bytes currently handed out as asked for by the callers
+		uint32_t peakBytesHeld;  // high water mark of bytesHeld
+		uint32_t numCellsInUse[kNumSizeClasses];
+	};
+
+	SlabAllocator() = default;
+
+	void setup(MemoryRegion* backingRegion);
+	void* alloc(uint32_t requiredSize);
+	void dealloc(void* address);
+
+	/// Only valid for pointers returned by some allocator which writes MemoryRegion style headers
+	[[gnu::always_inline]] static bool isSlabAllocation(void* address) {
+		return (*(uint32_t*)((uintptr_t)address - 4) & SPACE_TYPE_MASK) == SPACE_HEADER_SLAB;
+	}
+
+	const Stats& stats() const { return stats_; }
+	void resetCounters();
+
+	/// Percentage of requests which were served by the pools
+	uint32_t hitRatePercent() const;
+	/// Percentage of held memory which isn't being used for data - free cells, slab tails, and padding within cells
+	uint32_t fragmentationPercent() const;
+	void logStats() const;
+
+	static int32_t sizeClassFor(uint32_t requiredSize);
+	static constexpr uint32_t cellSize(int32_t sizeClass) { return kMinCellSize << sizeClass; }
+
+private:
+	struct Slab {
+		Slab* next; // next slab in its class with at least one free cell
+		Slab* prev;
+		void* freeList;
+		uint16_t numUsed;
+		uint16_t numCells;
+		int32_t sizeClass;
+	};
+	static_assert(sizeof(Slab) <= kSlabHeaderSize);
+
+	Slab* newSlab(int32_t sizeClass);
+	void unlink(Slab* slab);
+	void pushFront(Slab* slab);
+
+	MemoryRegion* region_ = nullptr;
+	// slabs that have at least one free cell, per size class. Full slabs aren't tracked until a cell is freed
+	Slab* partial_[kNumSizeClasses] = {nullptr};
+	uint32_t numSlabs_ = 0;
+	Stats stats_ = {0};
+};
@@ -31,4 +31,9 @@ public:
 	virtual StealableQueue getAppropriateQueue() = 0;
 
 	uint32_t lastTraversalNo = 0xFFFFFFFF;
+
+	// Key of this Stealable's record in its CacheManager's run index, so the record can be found again. A length of 0
+	// means it hasn't got one.
+	uint32_t indexedRunLength = 0;
+	uint32_t indexedQueue = 0;
 };
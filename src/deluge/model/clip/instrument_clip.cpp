@@ -2652,7 +2652,7 @@ someError:
 			}
 
 			error = ((MIDIInstrument*)output)
-			            ->readModKnobAssignmentsFromFile(storageManager, readAutomationUpToPos, &paramManager);
+			            ->readModKnobAssignmentsFromFile(storageManager, reader, readAutomationUpToPos, &paramManager);
 			if (error != Error::NONE) {
 				return error;
 			}
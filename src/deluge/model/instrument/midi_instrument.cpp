@@ -348,8 +348,9 @@ bool MIDIInstrument::readTagFromFile(Deserializer& reader, char const* tagName)
 
 	if (!strcmp(tagName, "modKnobs")) {
 		readModKnobAssignmentsFromFile(
-		    storageManager, kMaxSequenceLength); // Not really ideal, but we don't know the number and can't easily get
-		                                         // it. I think it'd only be relevant for pre-V2.0 song file... maybe?
+		    storageManager, reader,
+		    kMaxSequenceLength); // Not really ideal, but we don't know the number and can't easily get it. I think
+		                         // it'd only be relevant for pre-V2.0 song file... maybe?
 	}
 	else if (!strcmp(tagName, "polyToMonoConversion")) {
 		while (*(tagName = reader.readNextTagOrAttributeName())) {
@@ -404,11 +405,11 @@ bool MIDIInstrument::readTagFromFile(Deserializer& reader, char const* tagName)
 
 // paramManager is sometimes NULL (when called from the above function), for reasons I've kinda forgotten, yet
 // everything seems to still work...
-Error MIDIInstrument::readModKnobAssignmentsFromFile(StorageManager& bdsm, int32_t readAutomationUpToPos,
+Error MIDIInstrument::readModKnobAssignmentsFromFile(StorageManager& bdsm, Deserializer& reader,
+                                                     int32_t readAutomationUpToPos,
                                                      ParamManagerForTimeline* paramManager) {
 	int32_t m = 0;
 	char const* tagName;
-	Deserializer& reader = smDeserializer;
 	while (*(tagName = reader.readNextTagOrAttributeName())) {
 		if (!strcmp(tagName, "modKnob")) {
 			MIDIParamCollection* midiParamCollection = NULL;
@@ -18,6 +18,7 @@
 #include "model/mod_controllable/mod_controllable_audio.h"
 #include "definitions_cxx.hpp"
 #include "deluge/model/settings/runtime_feature_settings.h"
+#include "dsp/mod_fx/mod_fx.h"
 #include "dsp/stereo_sample.h"
 #include "gui/l10n/l10n.h"
 #include "gui/views/automation_view.h"
@@ -118,6 +119,9 @@ void ModControllableAudio::cloneFrom(ModControllableAudio* other) {
 	filterRoute = other->filterRoute;
 	sidechain.cloneFrom(&other->sidechain);
 	midiKnobArray.cloneFrom(&other->midiKnobArray); // Could fail if no RAM... not too big a concern
+	if (currentSong) {
+		currentSong->learnedCCIndex.invalidate();
+	}
 	delay = other->delay;
 }
 
@@ -180,7 +184,6 @@ void ModControllableAudio::processFX(StereoSample* buffer, int32_t numSamples, M
 	// Mod FX -----------------------------------------------------------------------------------
 	if (modFXType != ModFXType::NONE) {
 
-		LFOType modFXLFOWaveType;
 		int32_t modFXDelayOffset;
 		int32_t thisModFXDelayDepth;
 		int32_t feedback;
@@ -210,17 +213,12 @@ void ModControllableAudio::processFX(StereoSample* buffer, int32_t numSamples, M
 			if (modFXType == ModFXType::FLANGER) {
 				modFXDelayOffset = kFlangerOffset;
 				thisModFXDelayDepth = kFlangerAmplitude;
-				modFXLFOWaveType = LFOType::TRIANGLE;
-			}
-			else { // Phaser
-				modFXLFOWaveType = LFOType::SINE;
 			}
 		}
 		else if (modFXType == ModFXType::CHORUS || modFXType == ModFXType::CHORUS_STEREO) {
 			modFXDelayOffset = multiply_32x32_rshift32(
 			    kModFXMaxDelay, (unpatchedParams->getValue(params::UNPATCHED_MOD_FX_OFFSET) >> 1) + 1073741824);
 			thisModFXDelayDepth = multiply_32x32_rshift32(modFXDelayOffset, modFXDepth) << 2;
-			modFXLFOWaveType = LFOType::SINE;
 			*postFXVolume = multiply_32x32_rshift32(*postFXVolume, 1518500250) << 1; // Divide by sqrt(2)
 		}
 		else if (modFXType == ModFXType::GRAIN) {
@@ -277,36 +275,31 @@ void ModControllableAudio::processFX(StereoSample* buffer, int32_t numSamples, M
 			grainFeedbackVol = grainVol >> 3;
 		}
 
-		StereoSample* currentSample = buffer;
-		do {
-
-			int32_t lfoOutput = modFXLFO.render(1, modFXLFOWaveType, modFXRate);
-
-			if (modFXType == ModFXType::PHASER) {
-
-				// "1" is sorta represented by 1073741824 here
-				int32_t _a1 =
-				    1073741824
-				    - multiply_32x32_rshift32_rounded((((uint32_t)lfoOutput + (uint32_t)2147483648) >> 1), modFXDepth);
-
-				phaserMemory.l = currentSample->l + (multiply_32x32_rshift32_rounded(phaserMemory.l, feedback) << 1);
-				phaserMemory.r = currentSample->r + (multiply_32x32_rshift32_rounded(phaserMemory.r, feedback) << 1);
-
-				// Do the allpass filters
-				for (auto& sample : allpassMemory) {
-					StereoSample whatWasInput = phaserMemory;
-
-					phaserMemory.l = (multiply_32x32_rshift32_rounded(phaserMemory.l, -_a1) << 2) + sample.l;
-					sample.l = (multiply_32x32_rshift32_rounded(phaserMemory.l, _a1) << 2) + whatWasInput.l;
-
-					phaserMemory.r = (multiply_32x32_rshift32_rounded(phaserMemory.r, -_a1) << 2) + sample.r;
-					sample.r = (multiply_32x32_rshift32_rounded(phaserMemory.r, _a1) << 2) + whatWasInput.r;
-				}
-
-				currentSample->l += phaserMemory.l;
-				currentSample->r += phaserMemory.r;
+		namespace mod_fx = deluge::dsp::mod_fx;
+		std::span<StereoSample> audio{buffer, (size_t)numSamples};
+		// The block versions give the same audio, but aren't yet known to be any quicker on the device
+		bool inBlocks = runtimeFeatureSettings.isOn(RuntimeFeatureSettingType::BlockModFX);
+		if (modFXType == ModFXType::PHASER) {
+			mod_fx::PhaserParams params{modFXDepth, feedback, (uint32_t)modFXRate};
+			if (inBlocks) {
+				mod_fx::renderPhaser(audio, {phaserMemory, allpassMemory}, modFXLFO, params);
+			}
+			else {
+				mod_fx::renderPhaserReference(audio, {phaserMemory, allpassMemory}, modFXLFO, params);
 			}
-			else if (modFXType == ModFXType::GRAIN && modFXGrainBuffer) {
+		}
+		else if (modFXType != ModFXType::GRAIN) {
+			mod_fx::DelayParams params{modFXDelayOffset, thisModFXDelayDepth, feedback, (uint32_t)modFXRate};
+			if (inBlocks) {
+				mod_fx::renderDelay(modFXType, audio, {modFXBuffer, modFXBufferWriteIndex}, modFXLFO, params);
+			}
+			else {
+				mod_fx::renderDelayReference(modFXType, audio, {modFXBuffer, modFXBufferWriteIndex}, modFXLFO, params);
+			}
+		}
+		else if (modFXGrainBuffer) {
+			StereoSample* currentSample = buffer;
+			do {
 				if (modFXGrainBufferWriteIndex >= kModFXGrainBufferSize) {
 					modFXGrainBufferWriteIndex = 0;
 					wrapsToShutdown -= 1;
@@ -453,54 +446,11 @@ void ModControllableAudio::processFX(StereoSample* buffer, int32_t numSamples, M
 				currentSample->r = add_saturation(multiply_32x32_rshift32(currentSample->r, grainDryVol) << 1,
 				                                  multiply_32x32_rshift32(grains_r, grainVol) << 1);
 				modFXGrainBufferWriteIndex++;
-			}
-			else {
-
-				int32_t delayTime = multiply_32x32_rshift32(lfoOutput, thisModFXDelayDepth) + modFXDelayOffset;
-
-				int32_t strength2 = (delayTime & 65535) << 15;
-				int32_t strength1 = (65535 << 15) - strength2;
-				int32_t sample1Pos = modFXBufferWriteIndex - ((delayTime) >> 16);
-
-				int32_t scaledValue1L =
-				    multiply_32x32_rshift32_rounded(modFXBuffer[sample1Pos & kModFXBufferIndexMask].l, strength1);
-				int32_t scaledValue2L =
-				    multiply_32x32_rshift32_rounded(modFXBuffer[(sample1Pos - 1) & kModFXBufferIndexMask].l, strength2);
-				int32_t modFXOutputL = scaledValue1L + scaledValue2L;
-
-				if (modFXType == ModFXType::CHORUS_STEREO) {
-					delayTime = multiply_32x32_rshift32(lfoOutput, -thisModFXDelayDepth) + modFXDelayOffset;
-					strength2 = (delayTime & 65535) << 15;
-					strength1 = (65535 << 15) - strength2;
-					sample1Pos = modFXBufferWriteIndex - ((delayTime) >> 16);
-				}
-
-				int32_t scaledValue1R =
-				    multiply_32x32_rshift32_rounded(modFXBuffer[sample1Pos & kModFXBufferIndexMask].r, strength1);
-				int32_t scaledValue2R =
-				    multiply_32x32_rshift32_rounded(modFXBuffer[(sample1Pos - 1) & kModFXBufferIndexMask].r, strength2);
-				int32_t modFXOutputR = scaledValue1R + scaledValue2R;
-
-				if (modFXType == ModFXType::FLANGER) {
-					modFXOutputL = multiply_32x32_rshift32_rounded(modFXOutputL, feedback) << 2;
-					modFXBuffer[modFXBufferWriteIndex].l = modFXOutputL + currentSample->l; // Feedback
-					modFXOutputR = multiply_32x32_rshift32_rounded(modFXOutputR, feedback) << 2;
-					modFXBuffer[modFXBufferWriteIndex].r = modFXOutputR + currentSample->r; // Feedback
-				}
-
-				else { // Chorus
-					modFXOutputL <<= 1;
-					modFXBuffer[modFXBufferWriteIndex].l = currentSample->l; // Feedback
-					modFXOutputR <<= 1;
-					modFXBuffer[modFXBufferWriteIndex].r = currentSample->r; // Feedback
-				}
+			} while (++currentSample != bufferEnd);
+		}
 
-				currentSample->l += modFXOutputL;
-				currentSample->r += modFXOutputR;
-				modFXBufferWriteIndex = (modFXBufferWriteIndex + 1) & kModFXBufferIndexMask;
-			}
-		} while (++currentSample != bufferEnd);
 		if (modFXType == ModFXType::GRAIN) {
+			modFXLFO.tick(numSamples, modFXRate);
 			AudioEngine::logAction("grain end");
 		}
 	}
@@ -1125,6 +1075,10 @@ doReadPatchedParam:
 				if (p != params::GLOBAL_NONE && p != params::PLACEHOLDER_RANGE) {
 					MIDIKnob* newKnob = midiKnobArray.insertKnobAtEnd();
 					if (newKnob) {
+						// Might be a Drum being loaded into a Kit that's already in the Song
+						if (currentSong) {
+							currentSong->learnedCCIndex.invalidate();
+						}
 						newKnob->midiInput.device = device;
 						newKnob->midiInput.channelOrZone = channel;
 						newKnob->midiInput.noteOrCC = ccNumber;
@@ -1714,6 +1668,9 @@ midiKnobFound:
 		knob->midiInput.device = fromDevice;
 		knob->paramDescriptor = paramDescriptor;
 		knob->relative = (whichKnob != 128); // Guess that it's relative, unless this is a pitch-bend "knob"
+		if (song) {
+			song->learnedCCIndex.invalidate();
+		}
 	}
 
 	if (overwroteExistingKnob) {
@@ -1742,6 +1699,9 @@ bool ModControllableAudio::unlearnKnobs(ParamDescriptor paramDescriptor, Song* s
 	}
 
 	if (anythingFound) {
+		if (song) {
+			song->learnedCCIndex.invalidate();
+		}
 		ensureInaccessibleParamPresetValuesWithoutKnobsAreZero(song);
 	}
 
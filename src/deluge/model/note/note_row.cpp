@@ -3281,25 +3281,25 @@ doReadNoteData:
 					}
 				}
 
-				char const* hexChars = reader.readNextCharsOfTagOrAttributeValue(noteHexLength);
-				if (!hexChars) {
+				uint8_t const* bytes = reader.readNextHexBytesOfTagOrAttributeValue(noteHexLength / 2);
+				if (!bytes) {
 					goto getOut;
 				}
 
-				int32_t pos = hexToIntFixedLength(hexChars, 8);
-				int32_t length = hexToIntFixedLength(&hexChars[8], 8);
-				uint8_t velocity = hexToIntFixedLength(&hexChars[16], 2);
+				int32_t pos = bytesToIntBigEndian(bytes, 4);
+				int32_t length = bytesToIntBigEndian(&bytes[4], 4);
+				uint8_t velocity = bytes[8];
 				uint8_t lift, probability;
 
 				if (noteHexLength == 22) { // If reading lift...
-					probability = hexToIntFixedLength(&hexChars[20], 2);
-					lift = hexToIntFixedLength(&hexChars[18], 2);
+					probability = bytes[10];
+					lift = bytes[9];
 					if (lift == 0 || lift > 127) {
 						goto useDefaultLift;
 					}
 				}
 				else { // Or if no lift here to read
-					probability = hexToIntFixedLength(&hexChars[18], 2);
+					probability = bytes[9];
 useDefaultLift:
 					lift = kDefaultLiftValue;
 				}
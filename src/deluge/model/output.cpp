@@ -370,14 +370,14 @@ bool Output::readTagFromFile(Deserializer& reader, char const* tagName) {
 				}
 			}
 
-			char const* hexChars = reader.readNextCharsOfTagOrAttributeValue(24);
-			if (!hexChars) {
+			uint8_t const* bytes = reader.readNextHexBytesOfTagOrAttributeValue(12);
+			if (!bytes) {
 				goto getOut;
 			}
 
-			int32_t pos = hexToIntFixedLength(hexChars, 8);
-			int32_t length = hexToIntFixedLength(&hexChars[8], 8);
-			uint32_t clipCode = hexToIntFixedLength(&hexChars[16], 8);
+			int32_t pos = bytesToIntBigEndian(bytes, 4);
+			int32_t length = bytesToIntBigEndian(&bytes[4], 4);
+			uint32_t clipCode = bytesToIntBigEndian(&bytes[8], 4);
 
 			// See if that's all allowed
 			if (pos < minPos || length <= 0 || pos > kMaxSequenceLength - length) {
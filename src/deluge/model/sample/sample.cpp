@@ -28,6 +28,7 @@
 #include "storage/audio/audio_file_manager.h"
 #include "storage/cluster/cluster.h"
 #include "storage/multi_range/multisample_range.h"
+#include "storage/storage_manager.h"
 #include <cmath>
 #include <cstring>
 #include <new>
@@ -1738,6 +1739,83 @@ void Sample::finalizeAfterLoad(uint32_t fileSize) {
 	audioDataLengthBytes = lengthInSamples * bytesPerSample; // Make sure it's an exact number of samples
 
 	workOutBitMask();
+
+	// Take in any Clusters loaded while reading the header. Every other one gets taken in as it's loaded
+	if (peaks.setNumClusters(getFirstClusterIndexWithNoAudioData()) == Error::NONE) {
+		for (int32_t c = 0; c < peaks.getNumClusters(); c++) {
+			Cluster* cluster = clusters.getElement(c)->cluster;
+			if (c < getFirstClusterIndexWithAudioData()) {
+				peaks.setClusterPeak(c, {0, 0});
+			}
+			else if (cluster && cluster->loaded) {
+				findPeaksInCluster(cluster, audioFileManager.clusterSize);
+			}
+		}
+	}
+}
+
+void Sample::findPeaksInCluster(Cluster* cluster, int32_t numBytes) {
+	int32_t clusterIndex = cluster->clusterIndex;
+	if (!peaks.isSetUp() || clusterIndex >= peaks.getNumClusters()) {
+		return;
+	}
+
+	// Just the values wholly inside this Cluster. The ones straddling its ends hardly matter to the drawing
+	uint64_t clusterStartPos = (uint64_t)clusterIndex << audioFileManager.clusterSizeMagnitude;
+	uint64_t startPos = std::max<uint64_t>(clusterStartPos, audioDataStartPosBytes);
+	uint64_t endPos = std::min<uint64_t>(clusterStartPos + numBytes, audioDataStartPosBytes + audioDataLengthBytes);
+	int32_t misalignment = (startPos - audioDataStartPosBytes) % byteDepth;
+	if (misalignment) {
+		startPos += byteDepth - misalignment;
+	}
+	if (endPos < startPos) {
+		endPos = startPos;
+	}
+
+	peaks.setClusterPeak(clusterIndex, WaveformPeaks::findPeak(cluster->data, startPos - clusterStartPos,
+	                                                           endPos - clusterStartPos, byteDepth));
+}
+
+Error Sample::getPeaksFile(String* path, WaveformPeaks::Source* source) {
+	if (filePath.isEmpty() || !tempFilePathForRecording.isEmpty()) {
+		return Error::FILE_NOT_FOUND; // Not where it'll stay
+	}
+
+	FRESULT result = f_stat(filePath.get(), &staticFNO);
+	if (result != FR_OK) {
+		return fresultToDelugeErrorCode(result);
+	}
+	*source = {
+	    .fileSize = (uint32_t)staticFNO.fsize,
+	    .fileTimestamp = ((uint32_t)staticFNO.fdate << 16) | staticFNO.ftime,
+	    .clusterSizeMagnitude = (uint32_t)audioFileManager.clusterSizeMagnitude,
+	};
+
+	Error error = path->set(filePath.get());
+	if (error == Error::NONE) {
+		error = path->concatenate(".peaks");
+	}
+	return error;
+}
+
+Error Sample::loadPeaksFile() {
+	String path;
+	WaveformPeaks::Source source;
+	Error error = getPeaksFile(&path, &source);
+	if (error == Error::NONE) {
+		error = peaks.load(path.get(), source);
+	}
+	return error;
+}
+
+Error Sample::savePeaksFile() {
+	String path;
+	WaveformPeaks::Source source;
+	Error error = getPeaksFile(&path, &source);
+	if (error == Error::NONE) {
+		error = peaks.save(path.get(), source);
+	}
+	return error;
 }
 
 #if ALPHA_OR_BETA_VERSION
@@ -20,6 +20,7 @@
 #include "definitions_cxx.hpp"
 #include "model/sample/sample_cluster.h"
 #include "model/sample/sample_cluster_array.h"
+#include "model/sample/waveform_peaks.h"
 #include "storage/audio/audio_file.h"
 #include "util/container/array/ordered_resizeable_array.h"
 #include "util/container/array/ordered_resizeable_array_with_multi_word_key.h"
@@ -72,6 +73,10 @@ public:
 	int32_t getFoundValueCentrePoint();
 	int32_t getValueSpan();
 	void finalizeAfterLoad(uint32_t fileSize);
+	/// Fills in the Peak of a Cluster whose data is in memory, the first numBytes of it having been loaded or recorded
+	void findPeaksInCluster(Cluster* cluster, int32_t numBytes);
+	Error loadPeaksFile();
+	Error savePeaksFile();
 
 	inline void convertOneData(int32_t* value) {
 		// Floating point
@@ -140,12 +145,16 @@ public:
 
 	SampleClusterArray clusters;
 
+	/// Min and max of each Cluster's audio, so the waveform can be drawn zoomed right out without reading it all
+	WaveformPeaks peaks;
+
 protected:
 #if ALPHA_OR_BETA_VERSION
 	void numReasonsDecreasedToZero(char const* errorCode);
 #endif
 
 private:
+	Error getPeaksFile(String* path, WaveformPeaks::Source* source);
 	int32_t investigateFundamentalPitch(int32_t fundamentalIndexProvided, int32_t tableSize, int32_t* heightTable,
 	                                    uint64_t* sumTable, float* floatIndexTable, float* getFreq,
 	                                    int32_t numDoublings, bool doPrimeTest);
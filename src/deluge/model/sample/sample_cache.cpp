@@ -149,7 +149,7 @@ bool SampleCache::setupNewCluster(int32_t clusterIndex) {
 #endif
 
 	clusters[clusterIndex] = audioFileManager.allocateCluster(
-	    ClusterType::SAMPLE_CACHE, false, this); // Do not add reasons, and don't steal from this SampleCache
+	    ClusterType::SAMPLE_CACHE, false, this, true); // Do not add reasons, and don't steal from this SampleCache
 	if (!clusters[clusterIndex]) {               // If that allocation failed...
 		D_PRINTLN("allocation fail");
 		return false;
@@ -187,7 +187,7 @@ void SampleCache::prioritizeNotStealingCluster(int32_t clusterIndex) {
 		Cluster* cluster = clusters[clusterIndex];
 		if (cluster->list != &cache_manager.queue(q) || !cluster->isLast()) {
 			cluster->remove(); // Remove from old list, if it was already in one (might not have been).
-			cache_manager.QueueForReclamation(q, cluster);
+			GeneralMemoryAllocator::get().putStealableInQueue(cluster, q);
 		}
 	}
 
@@ -210,7 +210,8 @@ void SampleCache::prioritizeNotStealingCluster(int32_t clusterIndex) {
 
 			clusters[clusterIndex]->remove(); // Remove from old list, if it was already in one (might not have been).
 			clusters[clusterIndex - 1]->insertOtherNodeBefore(clusters[clusterIndex]);
-			// TODO: invalidate longest run length on new queue?
+			GeneralMemoryAllocator::get().regions[MEMORY_REGION_STEALABLE].cache_manager().IndexRun(
+			    clusters[clusterIndex]);
 		}
 	}
 }
@@ -31,6 +31,9 @@ useLinearInterpolation:
 		return 2;
 	}
 	else {
+		if (AudioEngine::qualityTier >= QualityTier::LINEAR_SAMPLES) {
+			goto useLinearInterpolation;
+		}
 
 		// If CPU dire...
 		if (AudioEngine::cpuDireness) {
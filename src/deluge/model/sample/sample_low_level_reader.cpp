@@ -25,15 +25,19 @@
 #include "model/sample/sample.h"
 #include "model/voice/voice.h"
 #include "model/voice/voice_sample_playback_guide.h"
+#include "processing/engines/audio_engine.h"
 #include "storage/audio/audio_file_manager.h"
 #include "storage/cluster/cluster.h"
 
-#include "arm_neon.h"
+#include "arm_neon_shim.h"
+
+static_assert(kNumClustersLoadedAhead == ClusterReadAhead::kMinClustersAhead);
 
 SampleLowLevelReader::SampleLowLevelReader() {
-	for (int32_t l = 0; l < kNumClustersLoadedAhead; l++) {
+	for (int32_t l = 0; l < ClusterReadAhead::kMaxClustersAhead; l++) {
 		clusters[l] = NULL;
 	}
+	readAheadRate = 0;
 }
 
 SampleLowLevelReader::~SampleLowLevelReader() {
@@ -42,7 +46,7 @@ SampleLowLevelReader::~SampleLowLevelReader() {
 }
 
 void SampleLowLevelReader::unassignAllReasons(bool wontBeUsedAgain) {
-	for (int32_t l = 0; l < kNumClustersLoadedAhead; l++) {
+	for (int32_t l = 0; l < ClusterReadAhead::kMaxClustersAhead; l++) {
 		if (clusters[l]) {
 			audioFileManager.removeReasonFromCluster(clusters[l], "E027", wontBeUsedAgain);
 			clusters[l] = NULL;
@@ -315,12 +319,14 @@ bool SampleLowLevelReader::setupClustersForPlayFromByte(SamplePlaybackGuide* gui
 bool SampleLowLevelReader::assignClusters(SamplePlaybackGuide* guide, Sample* sample, int32_t clusterIndex,
                                           int32_t priorityRating) {
 	int32_t finalClusterIndex = guide->getFinalClusterIndex(sample, shouldObeyMarkers());
+	int32_t numClustersAhead = audioFileManager.readAhead.numClustersAhead(readAheadRate);
 
-	for (int32_t l = 0; l < kNumClustersLoadedAhead; l++) {
+	for (int32_t l = 0; l < numClustersAhead; l++) {
 
-		// Grab it.
-		clusters[l] = sample->clusters.getElement(clusterIndex)
-		                  ->getCluster(sample, clusterIndex, CLUSTER_ENQUEUE, priorityRating);
+		// Grab it, to be loaded by when the play-head could get to it
+		uint32_t deadline = audioFileManager.readAhead.deadline(l, readAheadRate, AudioEngine::audioSampleTimer);
+		clusters[l] =
+		    sample->clusters.getElement(clusterIndex)->getCluster(sample, clusterIndex, CLUSTER_ENQUEUE, deadline);
 
 		// The first one is required to not only have returned an object to us (which it might not have if insufficient
 		// RAM or maybe other reasons), but also to be fully loaded.
@@ -342,6 +348,36 @@ bool SampleLowLevelReader::assignClusters(SamplePlaybackGuide* guide, Sample* sa
 	return true;
 }
 
+// Enqueue Clusters after the last one we hold, until we've got as many as readAheadRate calls for or the file ends
+void SampleLowLevelReader::topUpClusters(SamplePlaybackGuide* guide, Sample* sample) {
+	int32_t numClustersAhead = audioFileManager.readAhead.numClustersAhead(readAheadRate);
+	int32_t finalClusterIndex = guide->getFinalClusterIndex(sample, shouldObeyMarkers());
+
+	for (int32_t l = 1; l < numClustersAhead; l++) {
+		if (clusters[l]) {
+			continue;
+		}
+		if (!clusters[l - 1]) {
+			break;
+		}
+
+		int32_t newClusterIndex = clusters[l - 1]->clusterIndex + guide->playDirection;
+
+		// Check that there actually is a next Cluster
+		if (newClusterIndex * guide->playDirection > finalClusterIndex * guide->playDirection) {
+			break;
+		}
+
+		// Grab it. If that failed (because no free RAM), no damage gets done.
+		uint32_t deadline = audioFileManager.readAhead.deadline(l, readAheadRate, AudioEngine::audioSampleTimer);
+		clusters[l] = sample->clusters.getElement(newClusterIndex)
+		                  ->getCluster(sample, newClusterIndex, CLUSTER_ENQUEUE, deadline);
+		if (!clusters[l]) {
+			break;
+		}
+	}
+}
+
 bool SampleLowLevelReader::moveOnToNextCluster(SamplePlaybackGuide* guide, Sample* sample, int32_t priorityRating) {
 
 #if ALPHA_OR_BETA_VERSION
@@ -355,11 +391,11 @@ bool SampleLowLevelReader::moveOnToNextCluster(SamplePlaybackGuide* guide, Sampl
 	int32_t bytePosWithinOldCluster = (uint32_t)currentPlayPos - (uint32_t)&clusters[0]->data;
 	audioFileManager.removeReasonFromCluster(clusters[0], "E035");
 
-	for (int32_t l = 0; l < kNumClustersLoadedAhead - 1; l++) {
+	for (int32_t l = 0; l < ClusterReadAhead::kMaxClustersAhead - 1; l++) {
 		clusters[l] = clusters[l + 1];
 	}
 
-	clusters[kNumClustersLoadedAhead - 1] = NULL;
+	clusters[ClusterReadAhead::kMaxClustersAhead - 1] = NULL;
 
 	// First things first - if there is no next Cluster or it's not loaded...
 	if (!clusters[0]) {
@@ -377,31 +413,8 @@ bool SampleLowLevelReader::moveOnToNextCluster(SamplePlaybackGuide* guide, Sampl
 	// Remove the compensation we'd done on the play pos relating to the byte depth of samples
 	bytePosWithinOldCluster = bytePosWithinOldCluster + 4 - sample->byteDepth;
 
-	// And for the one at the far end, just grab the next one
-	Cluster* oldLastCluster = clusters[kNumClustersLoadedAhead - 2];
-
-	if (oldLastCluster) {
-		int32_t prevClusterIndex = oldLastCluster->clusterIndex;
-
-		int32_t newClusterIndex = prevClusterIndex + guide->playDirection;
-
-		// Check that there actually is a next Cluster. If not...
-		if (newClusterIndex * guide->playDirection
-		    > guide->getFinalClusterIndex(sample, shouldObeyMarkers()) * guide->playDirection) {
-			clusters[kNumClustersLoadedAhead - 1] = NULL;
-		}
-
-		// Or if there is...
-		else {
-
-			// Grab it.
-			clusters[kNumClustersLoadedAhead - 1] =
-			    sample->clusters.getElement(newClusterIndex)
-			        ->getCluster(sample, newClusterIndex, CLUSTER_ENQUEUE, priorityRating);
-
-			// If that failed (because no free RAM), no damage gets done.
-		}
-	}
+	// And grab more at the far end, as many as it takes to stay ahead at the rate we're going
+	topUpClusters(guide, sample);
 
 	setupForPlayPosMovedIntoNewCluster(guide, sample,
 	                                   bytePosWithinOldCluster - audioFileManager.clusterSize * guide->playDirection,
@@ -1280,7 +1293,7 @@ bool SampleLowLevelReader::readSamplesForTimeStretching(
 
 void SampleLowLevelReader::cloneFrom(SampleLowLevelReader* other, bool stealReasons) {
 
-	for (int32_t l = 0; l < kNumClustersLoadedAhead; l++) {
+	for (int32_t l = 0; l < ClusterReadAhead::kMaxClustersAhead; l++) {
 		if (clusters[l]) {
 			audioFileManager.removeReasonFromCluster(clusters[l], "E131", false);
 		}
@@ -1305,4 +1318,5 @@ void SampleLowLevelReader::cloneFrom(SampleLowLevelReader* other, bool stealReas
 	clusterStartLocation = other->clusterStartLocation;
 	reassessmentAction = other->reassessmentAction;
 	interpolationBufferSizeLastTime = other->interpolationBufferSizeLastTime;
+	readAheadRate = other->readAheadRate;
 }
@@ -20,6 +20,7 @@
 #include "arm_neon_shim.h"
 
 #include "definitions_cxx.hpp"
+#include "storage/cluster/cluster_read_ahead.h"
 #include <cstdint>
 #define REASSESSMENT_ACTION_STOP_OR_LOOP 0
 #define REASSESSMENT_ACTION_NEXT_CLUSTER 1
@@ -99,10 +100,16 @@ public:
 
 	int16x4_t interpolationBuffer[2][kInterpolationMaxNumSamples >> 2];
 
-	Cluster* clusters[kNumClustersLoadedAhead];
+	// The Cluster being played, then those after it in play order. There are always at least kNumClustersLoadedAhead
+	// (unless the file ends first), and more when readAheadRate calls for them. Any NULLs are all at the end
+	Cluster* clusters[ClusterReadAhead::kMaxClustersAhead];
+	// How fast this play-head moves through the file, in bytes per output sample (16.16 fixed point). Whoever renders
+	// it should keep this up to date
+	uint32_t readAheadRate;
 
 private:
 	bool assignClusters(SamplePlaybackGuide* guide, Sample* sample, int32_t clusterIndex, int32_t priorityRating);
+	void topUpClusters(SamplePlaybackGuide* guide, Sample* sample);
 	bool fillInterpolationBufferForward(SamplePlaybackGuide* guide, Sample* sample, int32_t interpolationBufferSize,
 	                                    bool loopingAtLowLevel, int32_t numSpacesToFill, int32_t priorityRating);
 };
@@ -153,6 +153,7 @@ gotError:
 	    0x8FFFFFFFFFFFFFFF; // If you ever change this value, update the check for it in SampleManager::loadCluster()
 	sample->sampleRate = kSampleRate;
 	sample->workOutBitMask();
+	sample->peaks.setNumClusters(1); // Grown as Clusters get written. Without it, they just won't be
 
 	currentRecordCluster->loaded =
 	    true; // I think this is ok - mark it as loaded even though we're yet to record into it
@@ -741,6 +742,12 @@ Error SampleRecorder::finalizeRecordedFile() {
 	    * (sample->byteDepth
 	       * sample->numChannels); // Ensure whole number of samples (surely it already would be though?)
 
+	// The peaks were found as each Cluster got written, from the audio before any processing
+	if (lshiftAmount || action != MonitoringAction::NONE) {
+		sample->peaks.clear();
+	}
+	sample->peaks.setNumClusters(sample->getFirstClusterIndexWithNoAudioData());
+
 	if (sample->tempFilePathForRecording.isEmpty()) {
 		sampleBrowser.lastFilePathLoaded.set(&sample->filePath);
 	}
@@ -782,6 +789,12 @@ Error SampleRecorder::writeCluster(int32_t clusterIndex, size_t numBytes) {
 
 	// Grab the SD address, for later
 	sampleCluster->sdAddress = clst2sect(&fileSystemStuff.fileSystem, file->inner().clust);
+
+	WaveformPeaks& peaks = sample->peaks;
+	if (peaks.isSetUp()
+	    && (clusterIndex < peaks.getNumClusters() || peaks.setNumClusters(clusterIndex + 1) == Error::NONE)) {
+		sample->findPeaksInCluster(sampleCluster->cluster, numBytes);
+	}
 	return Error::NONE;
 }
 
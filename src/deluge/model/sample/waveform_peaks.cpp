@@ -0,0 +1,278 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "model/sample/waveform_peaks.h"
+#include "memory/general_memory_allocator.h"
+#include "util/functions.h"
+#include <string.h>
+
+extern "C" {
+#include "fatfs/ff.h"
+}
+
+namespace {
+
+constexpr int32_t kMinCapacity = 16;
+
+constexpr char kFileMagic[4] = {'D', 'P', 'E', 'K'};
+constexpr uint32_t kFileVersion = 1;
+
+// Followed by the bottom level's Peaks. The rest get worked out again from those
+struct FileHeader {
+	char magic[4];
+	uint32_t version;
+	WaveformPeaks::Source source;
+	int32_t numClusters;
+};
+
+WaveformPeaks::Peak combine(WaveformPeaks::Peak a, WaveformPeaks::Peak b) {
+	if (!a.isKnown() || !b.isKnown()) {
+		return {};
+	}
+	a.add(b);
+	return a;
+}
+
+} // namespace
+
+WaveformPeaks::~WaveformPeaks() {
+	if (peaks_) {
+		delugeDealloc(peaks_);
+	}
+}
+
+Error WaveformPeaks::setNumClusters(int32_t newNumClusters) {
+	if (newNumClusters == numClusters_ && peaks_) {
+		return Error::NONE;
+	}
+
+	if (newNumClusters > capacity_ || !peaks_) {
+		int32_t newCapacity = std::max(capacity_, kMinCapacity);
+		while (newCapacity < newNumClusters) {
+			newCapacity <<= 1;
+		}
+
+		Peak* newPeaks = (Peak*)GeneralMemoryAllocator::get().allocLowSpeed(sizeof(Peak) * (newCapacity * 2 - 1));
+		if (!newPeaks) {
+			return Error::INSUFFICIENT_RAM;
+		}
+		for (int32_t i = 0; i < newCapacity * 2 - 1; i++) {
+			newPeaks[i] = i < numClusters_ ? peaks_[i] : Peak{};
+		}
+		if (peaks_) {
+			delugeDealloc(peaks_);
+		}
+		peaks_ = newPeaks;
+		capacity_ = newCapacity;
+		rebuildUpperLevels();
+	}
+
+	// Everything past the end stays unknown, which is what lets growing within the capacity skip the rebuild above
+	else if (newNumClusters < numClusters_) {
+		for (int32_t i = newNumClusters; i < numClusters_; i++) {
+			if (peaks_[i].isKnown()) {
+				numKnown_--;
+			}
+			peaks_[i] = {};
+		}
+		rebuildUpperLevels();
+	}
+
+	numClusters_ = newNumClusters;
+	fileUpToDate = false;
+	return Error::NONE;
+}
+
+void WaveformPeaks::rebuildUpperLevels() {
+	Peak* below = peaks_;
+	for (int32_t size = capacity_ >> 1; size; size >>= 1) {
+		Peak* level = below + (size << 1);
+		for (int32_t i = 0; i < size; i++) {
+			level[i] = combine(below[i << 1], below[(i << 1) + 1]);
+		}
+		below = level;
+	}
+}
+
+int32_t WaveformPeaks::findUnknown(int32_t startCluster) const {
+	int32_t c = startCluster;
+	while (c < numClusters_ && peaks_[c].isKnown()) {
+		c++;
+	}
+	return c;
+}
+
+void WaveformPeaks::setClusterPeak(int32_t cluster, Peak peak) {
+	if (!peaks_[cluster].isKnown()) {
+		numKnown_++;
+	}
+	peaks_[cluster] = peak;
+
+	// Update everything above it, stopping where its sibling isn't known yet - the Peak over the two can't be either
+	Peak* level = peaks_;
+	int32_t i = cluster;
+	for (int32_t size = capacity_; size > 1; size >>= 1) {
+		Peak sibling = level[i ^ 1];
+		if (!sibling.isKnown()) {
+			break;
+		}
+		peak.add(sibling);
+		level += size;
+		i >>= 1;
+		level[i] = peak;
+	}
+}
+
+WaveformPeaks::Peak WaveformPeaks::getPeak(int32_t startCluster, int32_t endCluster) const {
+	Peak result{};
+	if (!peaks_ || startCluster < 0 || endCluster > numClusters_ || startCluster >= endCluster) {
+		return result;
+	}
+
+	// Work up from the bottom, taking in whichever ends of the range aren't a whole Peak on the level above
+	Peak const* level = peaks_;
+	int32_t size = capacity_;
+	while (startCluster < endCluster) {
+		if (startCluster & 1) {
+			Peak peak = level[startCluster++];
+			if (!peak.isKnown()) {
+				return {};
+			}
+			result.add(peak);
+		}
+		if (endCluster & 1) {
+			Peak peak = level[--endCluster];
+			if (!peak.isKnown()) {
+				return {};
+			}
+			result.add(peak);
+		}
+		startCluster >>= 1;
+		endCluster >>= 1;
+		level += size;
+		size >>= 1;
+	}
+	return result;
+}
+
+void WaveformPeaks::clear() {
+	for (int32_t i = 0; i < capacity_ * 2 - 1; i++) {
+		peaks_[i] = {};
+	}
+	numKnown_ = 0;
+	fileUpToDate = false;
+}
+
+WaveformPeaks::Peak WaveformPeaks::findPeak(char const* data, int32_t startByte, int32_t endByte, int32_t byteDepth) {
+	if (endByte - startByte < byteDepth) {
+		return {0, 0}; // No whole value in there, so nothing to draw but the centre line
+	}
+
+	Peak peak{};
+	if (byteDepth == 1) {
+		for (int32_t pos = startByte; pos < endByte; pos++) {
+			int16_t value = (int16_t)((int8_t)data[pos] << 8);
+			peak.min = std::min(peak.min, value);
+			peak.max = std::max(peak.max, value);
+		}
+		return peak;
+	}
+
+	// The top two bytes of each value
+	for (int32_t pos = startByte + byteDepth - 2; pos + 2 <= endByte; pos += byteDepth) {
+		int16_t value;
+		memcpy(&value, &data[pos], sizeof(value));
+		peak.min = std::min(peak.min, value);
+		peak.max = std::max(peak.max, value);
+	}
+	return peak;
+}
+
+Error WaveformPeaks::save(char const* path, Source source) {
+	if (!isComplete()) {
+		return Error::BUG;
+	}
+
+	FIL file;
+	FRESULT result = f_open(&file, path, FA_CREATE_ALWAYS | FA_WRITE);
+	if (result != FR_OK) {
+		return fresultToDelugeErrorCode(result);
+	}
+
+	FileHeader header{.version = kFileVersion, .source = source, .numClusters = numClusters_};
+	memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+
+	UINT numBytesWritten;
+	result = f_write(&file, &header, sizeof(header), &numBytesWritten);
+	bool success = result == FR_OK && numBytesWritten == sizeof(header);
+	if (success) {
+		UINT numBytes = sizeof(Peak) * numClusters_;
+		result = f_write(&file, peaks_, numBytes, &numBytesWritten);
+		success = result == FR_OK && numBytesWritten == numBytes;
+	}
+	if (f_close(&file) != FR_OK) {
+		success = false;
+	}
+
+	if (!success) {
+		f_unlink(path); // Rather than leave half a file to be found next time
+		return result == FR_OK ? Error::SD_CARD_FULL : fresultToDelugeErrorCode(result);
+	}
+	fileUpToDate = true;
+	return Error::NONE;
+}
+
+Error WaveformPeaks::load(char const* path, Source source) {
+	if (!peaks_) {
+		return Error::BUG;
+	}
+
+	FIL file;
+	FRESULT result = f_open(&file, path, FA_READ);
+	if (result != FR_OK) {
+		return fresultToDelugeErrorCode(result);
+	}
+
+	Error error = Error::NONE;
+	FileHeader header;
+	UINT numBytesRead;
+	result = f_read(&file, &header, sizeof(header), &numBytesRead);
+	if (result != FR_OK || numBytesRead != sizeof(header)) {
+		error = Error::FILE_CORRUPTED;
+	}
+	// Some other version, or the audio has changed since
+	else if (memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) || header.version != kFileVersion
+	         || !(header.source == source) || header.numClusters != numClusters_) {
+		error = Error::FILE_UNSUPPORTED;
+	}
+	else {
+		UINT numBytes = sizeof(Peak) * numClusters_;
+		result = f_read(&file, peaks_, numBytes, &numBytesRead);
+		if (result != FR_OK || numBytesRead != numBytes || findUnknown(0) != numClusters_) {
+			clear();
+			error = Error::FILE_CORRUPTED;
+		}
+	}
+	f_close(&file);
+
+	if (error == Error::NONE) {
+		numKnown_ = numClusters_;
+		rebuildUpperLevels();
+		fileUpToDate = true;
+	}
+	return error;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "definitions_cxx.hpp"
+#include <algorithm>
+#include <cstdint>
+
+/*
+ * The min and max of a Sample's audio, a Cluster's worth at a time, kept as a pyramid: the bottom level has a Peak for
+ * each Cluster, and each level above has one for each pair below it. The Peak of any run of Clusters then comes from
+ * at most two Peaks per level, so WaveformRenderer::findPeaksPerCol() can draw a column spanning a whole hour of audio
+ * without reading any of it.
+ *
+ * Peaks get filled in whenever a Cluster's audio is in memory anyway - as it's loaded, or written by a SampleRecorder -
+ * in any order. A Peak above the bottom level is only known once everything under it is. Once they're all known, they
+ * can be saved next to the audio file, and loaded from there next time instead of reading the audio again.
+ *
+ * Only the top 16 bits of each value are kept, which is far more than a column of pads or OLED pixels can show.
+ */
+class WaveformPeaks {
+public:
+	struct Peak {
+		int16_t min = INT16_MAX;
+		int16_t max = INT16_MIN;
+
+		[[nodiscard]] bool isKnown() const { return min <= max; }
+		void add(Peak other) {
+			min = std::min(min, other.min);
+			max = std::max(max, other.max);
+		}
+	};
+
+	/// What the peaks were found from, to tell whether a saved file of them still applies
+	struct Source {
+		uint32_t fileSize;
+		uint32_t fileTimestamp; // FatFs date in the top half, time in the bottom
+		uint32_t clusterSizeMagnitude;
+
+		bool operator==(Source const&) const = default;
+	};
+
+	WaveformPeaks() = default;
+	~WaveformPeaks();
+	WaveformPeaks(WaveformPeaks const&) = delete;
+	WaveformPeaks& operator=(WaveformPeaks const&) = delete;
+
+	/// Sizes the bottom level. Peaks already known for Clusters below the new number are kept
+	Error setNumClusters(int32_t newNumClusters);
+	[[nodiscard]] int32_t getNumClusters() const { return numClusters_; }
+	[[nodiscard]] bool isSetUp() const { return peaks_ != nullptr; }
+	[[nodiscard]] bool isComplete() const { return peaks_ && numKnown_ == numClusters_; }
+	[[nodiscard]] bool isKnown(int32_t cluster) const { return peaks_[cluster].isKnown(); }
+	/// The first Cluster from startCluster on whose Peak isn't known, or getNumClusters() if there isn't one
+	[[nodiscard]] int32_t findUnknown(int32_t startCluster) const;
+
+	void setClusterPeak(int32_t cluster, Peak peak);
+	/// The Peak of Clusters startCluster up to but not including endCluster, which isn't known unless all of theirs are
+	[[nodiscard]] Peak getPeak(int32_t startCluster, int32_t endCluster) const;
+
+	/// Forgets every Peak, for when the audio has changed
+	void clear();
+
+	Error save(char const* path, Source source);
+	Error load(char const* path, Source source);
+
+	/// Whether the file of these peaks has been looked for yet
+	bool fileTried = false;
+	/// Whether the file of these peaks is there and holds what's here now
+	bool fileUpToDate = false;
+
+	/// The Peak of the values from startByte up to endByte, each byteDepth bytes long and stored the way
+	/// Cluster::convertDataIfNecessary() leaves them
+	static Peak findPeak(char const* data, int32_t startByte, int32_t endByte, int32_t byteDepth);
+
+private:
+	void rebuildUpperLevels();
+
+	Peak* peaks_ = nullptr; // Every level, bottom first, each level half the length of the one before
+	int32_t capacity_ = 0;  // Length of the bottom level. A power of two
+	int32_t numClusters_ = 0;
+	int32_t numKnown_ = 0;
+};
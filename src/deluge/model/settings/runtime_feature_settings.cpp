@@ -101,6 +101,66 @@ static void SetupEmulatedDisplaySetting(RuntimeFeatureSetting& setting, deluge::
 	};
 }
 
+static void SetupQualityUnderLoadSetting(RuntimeFeatureSetting& setting, deluge::l10n::String displayName,
+                                         std::string_view xmlName, RuntimeFeatureStateQualityUnderLoad def) {
+	setting.displayName = displayName;
+	setting.xmlName = xmlName;
+	setting.value = static_cast<uint32_t>(def);
+
+	setting.options = {
+	    {
+	        .displayName = "Auto",
+	        .value = RuntimeFeatureStateQualityUnderLoad::Auto,
+	    },
+	    {
+	        .displayName = "Full",
+	        .value = RuntimeFeatureStateQualityUnderLoad::Full,
+	    },
+	    {
+	        .displayName = display->haveOLED() ? "Linear samples" : "LINS",
+	        .value = RuntimeFeatureStateQualityUnderLoad::LinearSamples,
+	    },
+	    {
+	        .displayName = display->haveOLED() ? "Fewer unison" : "UNIS",
+	        .value = RuntimeFeatureStateQualityUnderLoad::FewerUnison,
+	    },
+	    {
+	        .displayName = display->haveOLED() ? "No release filt" : "FILT",
+	        .value = RuntimeFeatureStateQualityUnderLoad::NoReleaseFilters,
+	    },
+	    {
+	        .displayName = display->haveOLED() ? "Small tables" : "TABL",
+	        .value = RuntimeFeatureStateQualityUnderLoad::SmallTables,
+	    },
+	};
+}
+
+static void SetupPreloadNextSongSetting(RuntimeFeatureSetting& setting, deluge::l10n::String displayName,
+                                        std::string_view xmlName, RuntimeFeatureStatePreloadNextSong def) {
+	setting.displayName = displayName;
+	setting.xmlName = xmlName;
+	setting.value = static_cast<uint32_t>(def);
+
+	setting.options = {
+	    {
+	        .displayName = "Off",
+	        .value = RuntimeFeatureStatePreloadNextSong::NoPreload,
+	    },
+	    {
+	        .displayName = "8MB",
+	        .value = RuntimeFeatureStatePreloadNextSong::Budget8MB,
+	    },
+	    {
+	        .displayName = "16MB",
+	        .value = RuntimeFeatureStatePreloadNextSong::Budget16MB,
+	    },
+	    {
+	        .displayName = "32MB",
+	        .value = RuntimeFeatureStatePreloadNextSong::Budget32MB,
+	    },
+	};
+}
+
 void RuntimeFeatureSettings::init() {
 	using enum deluge::l10n::String;
 	// Drum randomizer
@@ -195,6 +255,25 @@ void RuntimeFeatureSettings::init() {
 	SetupOnOffSetting(settings[RuntimeFeatureSettingType::EnableGridViewLoopPads],
 	                  STRING_FOR_COMMUNITY_FEATURE_GRID_VIEW_LOOP_PADS, "enableGridViewLoopPads",
 	                  RuntimeFeatureStateToggle::Off);
+
+	// QualityUnderLoad
+	SetupQualityUnderLoadSetting(settings[RuntimeFeatureSettingType::QualityUnderLoad],
+	                             STRING_FOR_COMMUNITY_FEATURE_QUALITY_UNDER_LOAD, "qualityUnderLoad",
+	                             RuntimeFeatureStateQualityUnderLoad::Auto);
+
+	// PreloadNextSong
+	SetupPreloadNextSongSetting(settings[RuntimeFeatureSettingType::PreloadNextSong],
+	                            STRING_FOR_COMMUNITY_FEATURE_PRELOAD_NEXT_SONG, "preloadNextSong",
+	                            RuntimeFeatureStatePreloadNextSong::NoPreload);
+
+	// BatchedCardReads
+	SetupOnOffSetting(settings[RuntimeFeatureSettingType::BatchedCardReads],
+	                  STRING_FOR_COMMUNITY_FEATURE_BATCHED_CARD_READS, "batchedCardReads",
+	                  RuntimeFeatureStateToggle::Off);
+
+	// BlockModFX
+	SetupOnOffSetting(settings[RuntimeFeatureSettingType::BlockModFX], STRING_FOR_COMMUNITY_FEATURE_BLOCK_MOD_FX,
+	                  "blockModFX", RuntimeFeatureStateToggle::Off);
 }
 
 void RuntimeFeatureSettings::readSettingsFromFile(StorageManager& bdsm) {
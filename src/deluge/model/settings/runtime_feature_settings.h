@@ -41,6 +41,19 @@ enum RuntimeFeatureStateSyncScalingAction : uint32_t { SyncScaling = 0, Fill = 1
 
 enum RuntimeFeatureStateEmulatedDisplay : uint32_t { Hardware = 0, Toggle = 1, OnBoot = 2 };
 
+/// Auto follows cpuDireness, the rest hold voices at one QualityTier (value - 1)
+enum RuntimeFeatureStateQualityUnderLoad : uint32_t {
+	Auto = 0,
+	Full = 1,
+	LinearSamples = 2,
+	FewerUnison = 3,
+	NoReleaseFilters = 4,
+	SmallTables = 5
+};
+
+/// How much memory the next song in the current song's folder may take up being loaded ahead of time, if any
+enum RuntimeFeatureStatePreloadNextSong : uint32_t { NoPreload = 0, Budget8MB = 1, Budget16MB = 2, Budget32MB = 3 };
+
 /// Every setting needs to be declared in here
 enum RuntimeFeatureSettingType : uint32_t {
 	DrumRandomizer,
@@ -66,6 +79,10 @@ enum RuntimeFeatureSettingType : uint32_t {
 	AlternativePlaybackStartBehaviour,
 	AccessibilityShortcuts,
 	EnableGridViewLoopPads,
+	QualityUnderLoad,
+	PreloadNextSong,
+	BatchedCardReads,
+	BlockModFX,
 	MaxElement // Keep as boundary
 };
 
@@ -40,6 +40,7 @@
 #include "model/clip/instrument_clip.h"
 #include "model/consequence/consequence_clip_existence.h"
 #include "model/instrument/cv_instrument.h"
+#include "model/instrument/kit.h"
 #include "model/instrument/midi_instrument.h"
 #include "model/sample/sample_recorder.h"
 #include "model/scale/preset_scales.h"
@@ -54,10 +55,12 @@
 #include "processing/audio_output.h"
 #include "processing/engines/audio_engine.h"
 #include "processing/engines/cv_engine.h"
+#include "processing/sound/sound_drum.h"
 #include "processing/sound/sound_instrument.h"
 #include "processing/stem_export/stem_export.h"
 #include "storage/storage_manager.h"
 #include "util/lookuptables/lookuptables.h"
+#include <algorithm>
 #include <cstring>
 #include <new>
 #include <stdint.h>
@@ -1058,6 +1061,7 @@ void Song::writeToFile(StorageManager& bdsm) {
 
 	writer.writeFirmwareVersion();
 	writer.writeEarliestCompatibleFirmwareVersion("4.1.0-alpha");
+	writer.writeSaveToken();
 
 	writer.writeAttribute("previewNumPads", "144");
 
@@ -1339,7 +1343,10 @@ Error Song::readFromFile(Deserializer& reader) {
 			if (!strcmp(tagName, "reverb")) {
 				while (*(tagName = reader.readNextTagOrAttributeName())) {
 					if (!strcmp(tagName, "model")) {
-						model = static_cast<deluge::dsp::Reverb::Model>(reader.readTagOrAttributeValueInt());
+						// Clamped, as a file from newer firmware or edited by hand could have anything here
+						int32_t readModel = reader.readTagOrAttributeValueInt();
+						model = static_cast<deluge::dsp::Reverb::Model>(std::clamp<int32_t>(
+						    readModel, 0, util::to_underlying(deluge::dsp::Reverb::Model::FREEVERB_BLOCK)));
 						reader.exitTag("model");
 					}
 					else if (!strcmp(tagName, "roomSize")) {
@@ -1503,13 +1510,16 @@ Error Song::readFromFile(Deserializer& reader) {
 		default:
 unknownTag:
 			if (!strcmp(tagName, "firmwareVersion") || !strcmp(tagName, "earliestCompatibleFirmware")) {
-				smDeserializer.tryReadingFirmwareTagFromFile(tagName);
+				reader.tryReadingFirmwareTagFromFile(tagName);
 				reader.exitTag(tagName);
 			}
 			else if (!strcmp(tagName, "preview") || !strcmp(tagName, "previewNumPads")) {
-				smDeserializer.tryReadingFirmwareTagFromFile(tagName);
+				reader.tryReadingFirmwareTagFromFile(tagName);
 				reader.exitTag(tagName);
 			}
+			else if (!strcmp(tagName, "saveToken")) {
+				reader.exitTag(tagName); // Only for checking a binary copy against
+			}
 			else if (!strcmp(tagName, "sessionLayout")) {
 				sessionLayout = (SessionLayoutType)reader.readTagOrAttributeValueInt();
 				reader.exitTag("sessionLayout");
@@ -1954,7 +1964,7 @@ loadOutput:
 					return result;
 				}
 				else {
-					Error result = smDeserializer.tryReadingFirmwareTagFromFile(tagName);
+					Error result = reader.tryReadingFirmwareTagFromFile(tagName);
 					if (result != Error::NONE && result != Error::RESULT_TAG_UNUSED) {
 						return result;
 					}
@@ -3129,6 +3139,7 @@ uint32_t Song::getTimePerTimerTickRounded() {
 }
 
 void Song::addOutput(Output* output, bool atStart) {
+	learnedCCIndex.invalidate();
 
 	if (atStart) {
 		output->next = firstOutput;
@@ -3199,6 +3210,7 @@ int32_t Song::removeOutputFromMainList(
 	}
 
 	*prevPointer = output->next;
+	learnedCCIndex.invalidate();
 
 	AudioEngine::mustUpdateReverbParamsBeforeNextRender = true;
 
@@ -3344,6 +3356,7 @@ traverseClips:
 
 	// Put the newInstrument into the master list
 	*prevPointer = newOutput;
+	learnedCCIndex.invalidate();
 	if (outputRecordingOldOutput) {
 		((AudioOutput*)outputRecordingOldOutput)->setOutputRecordingFrom(newOutput, true);
 	}
@@ -3571,6 +3584,41 @@ Output* Song::getOutputFromIndex(int32_t index) {
 	return firstOutput; // fail
 }
 
+void Song::updateLearnedCCIndex() {
+	if (learnedCCIndex.isUpToDate()) {
+		return;
+	}
+	learnedCCIndex.clear();
+	for (Output* output = firstOutput; output; output = output->next) {
+		if (output->type != OutputType::SYNTH && output->type != OutputType::KIT && output->type != OutputType::AUDIO) {
+			continue; // Nothing else has any knobs to learn
+		}
+		addKnobsToLearnedCCIndex(output, (ModControllableAudio*)output->toModControllable());
+		if (output->type == OutputType::KIT) {
+			for (Drum* drum = ((Kit*)output)->firstDrum; drum; drum = drum->next) {
+				if (drum->type == DrumType::SOUND) {
+					addKnobsToLearnedCCIndex(output, (SoundDrum*)drum);
+				}
+			}
+		}
+	}
+	learnedCCIndex.finish();
+}
+
+std::optional<std::span<Output* const>> Song::getOutputsWithParamsLearnedToCC(int32_t channel, int32_t ccNumber) {
+	if (!learnedCCIndex.isUpToDate()) {
+		return std::nullopt;
+	}
+	return learnedCCIndex.getOutputs(channel, ccNumber);
+}
+
+void Song::addKnobsToLearnedCCIndex(Output* output, ModControllableAudio* modControllable) {
+	for (int32_t k = 0; k < modControllable->midiKnobArray.getNumElements(); k++) {
+		LearnedMIDI& midiInput = modControllable->midiKnobArray.getElement(k)->midiInput;
+		learnedCCIndex.add(output, midiInput.channelOrZone, midiInput.noteOrCC);
+	}
+}
+
 int32_t Song::getNumOutputs() {
 	int32_t count = 0;
 	for (Output* output = firstOutput; output; output = output->next) {
@@ -5045,6 +5093,7 @@ void Song::replaceOutputLowLevel(Output* newOutput, Output* oldOutput) {
 	for (prevPointer = &firstOutput; *prevPointer != oldOutput; prevPointer = &(*prevPointer)->next) {}
 	newOutput->next = oldOutput->next;
 	*prevPointer = newOutput;
+	learnedCCIndex.invalidate();
 
 	// Migrate all ClipInstances from oldInstrument to newInstrument
 	newOutput->clipInstances.swapStateWith(&oldOutput->clipInstances);
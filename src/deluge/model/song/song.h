@@ -32,11 +32,14 @@
 #include "model/scale/scale_mapper.h"
 #include "model/sync.h"
 #include "model/timeline_counter.h"
+#include "modulation/midi/learned_cc_index.h"
 #include "modulation/params/param.h"
 #include "modulation/params/param_manager.h"
 #include "storage/flash_storage.h"
 #include "util/container/array/ordered_resizeable_array_with_multi_word_key.h"
 #include "util/d_string.h"
+#include <optional>
+#include <span>
 
 class MidiCommand;
 class Clip;
@@ -193,6 +196,9 @@ public:
 
 	OrderedResizeableArrayWithMultiWordKey backedUpParamManagers;
 
+	// Invalidate whenever a knob is learned or unlearned, or the Outputs change
+	LearnedCCIndex learnedCCIndex;
+
 	uint32_t xZoom[2];  // Set default zoom at max zoom-out;
 	int32_t xScroll[2]; // Leave this as signed
 	int32_t xScrollForReturnToSongView;
@@ -334,6 +340,12 @@ public:
 	void reassessWhetherAnyOutputsSoloingInArrangement();
 	bool isOutputActiveInArrangement(Output* output);
 	Output* getOutputFromIndex(int32_t index);
+	/// Rebuilds learnedCCIndex if anything learned has changed since. It allocates, so it's done from
+	/// PlaybackHandler::slowRoutine() rather than as CCs arrive
+	void updateLearnedCCIndex();
+	/// The Outputs with a knob - their own or one of their Drums' - learned to this channel and CC. Nothing if the
+	/// index hasn't been rebuilt since that last changed, in which case any Output might have
+	std::optional<std::span<Output* const>> getOutputsWithParamsLearnedToCC(int32_t channel, int32_t ccNumber);
 	void ensureAllInstrumentsHaveAClipOrBackedUpParamManager(char const* errorMessageNormal,
 	                                                         char const* errorMessageHibernating);
 	Error placeFirstInstancesOfActiveClips(int32_t pos);
@@ -468,6 +480,7 @@ private:
 	void setupClipIndexesForSaving();
 	void setBPMInner(float tempoBPM, bool shouldLogAction);
 	void clearTempoAutomation(float tempoBPM);
+	void addKnobsToLearnedCCIndex(Output* output, ModControllableAudio* modControllable);
 	int32_t intBPM{0};
 };
 
@@ -0,0 +1,399 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "model/song/song_preloader.h"
+#include "deluge.h"
+#include "extern.h"
+#include "gui/ui/ui.h"
+#include "io/debug/log.h"
+#include "memory/general_memory_allocator.h"
+#include "model/global_effectable/global_effectable.h"
+#include "model/settings/runtime_feature_settings.h"
+#include "model/song/song.h"
+#include "playback/mode/session.h"
+#include "playback/playback_handler.h"
+#include "processing/engines/audio_engine.h"
+#include "storage/audio/audio_file_manager.h"
+#include "storage/binary_serializer.h"
+#include "storage/storage_manager.h"
+#include "task_scheduler.h"
+#include "util/functions.h"
+#include <algorithm>
+#include <string.h>
+
+SongPreloader songPreloader{};
+
+extern bool waitingForSDRoutineToEnd;
+
+namespace {
+
+uint32_t getBudget() {
+	switch (runtimeFeatureSettings.get(RuntimeFeatureSettingType::PreloadNextSong)) {
+	case RuntimeFeatureStatePreloadNextSong::Budget8MB:
+		return 8 << 20;
+	case RuntimeFeatureStatePreloadNextSong::Budget16MB:
+		return 16 << 20;
+	case RuntimeFeatureStatePreloadNextSong::Budget32MB:
+		return 32 << 20;
+	default:
+		return 0;
+	}
+}
+
+uint32_t getNonStealableEmptySpace() {
+	GeneralMemoryAllocator& allocator = GeneralMemoryAllocator::get();
+	return allocator.regions[MEMORY_REGION_INTERNAL].getTotalEmptySpace()
+	       + allocator.regions[MEMORY_REGION_EXTERNAL].getTotalEmptySpace();
+}
+
+/// The device doesn't keep the time, so files it writes all get the same timestamp - the size has to be compared too
+Error getFileStamp(char const* path, uint32_t* timestamp, uint32_t* size) {
+	FRESULT result = f_stat(path, &staticFNO);
+	if (result != FR_OK) {
+		return fresultToDelugeErrorCode(result);
+	}
+	*timestamp = ((uint32_t)staticFNO.fdate << 16) | staticFNO.ftime;
+	*size = staticFNO.fsize;
+	return Error::NONE;
+}
+
+} // namespace
+
+bool SongPreloader::mayUseCard() {
+	return !sdRoutineLock && currentUIMode == UI_MODE_NONE && getCurrentUI() == getRootUI()
+	       && audioFileManager.thingTypeBeingLoaded == ThingType::NONE && !audioFileManager.cardEjected
+	       && !session.launchEventAtSwungTickCount;
+}
+
+void SongPreloader::routine() {
+	if (busy_) {
+		return; // Called again while a step hands over to other tasks
+	}
+	uint32_t budget = getBudget();
+	if (after_ != currentSong || !budget) {
+		cancel();
+	}
+	if (!budget || !currentSong || !playbackHandler.isEitherClockActive() || !mayUseCard()) {
+		return;
+	}
+
+	Error error = Error::NONE;
+	switch (state_) {
+	case State::IDLE:
+		after_ = currentSong;
+		error = findNextSong();
+		break;
+
+	case State::FOUND:
+		emptySpaceBefore_ = getNonStealableEmptySpace();
+		if (emptySpaceBefore_ <= budget) {
+			return; // Try again once there's more room
+		}
+		error = readSong();
+		break;
+
+	case State::READ:
+		error = startLoadingSamples(false);
+		break;
+
+	case State::CLAIMED_SAMPLES:
+		error = startLoadingSamples(true);
+		break;
+
+	case State::LOADING_SAMPLES:
+		if (!audioFileManager.loadingQueueHasAnyLowestPriorityElements()) {
+			D_PRINTLN("preloaded %s, %d KB", path_.get(), bytesUsed_ >> 10);
+			state_ = State::READY;
+		}
+		return;
+
+	default:
+		return;
+	}
+
+	if (error == Error::NONE) {
+		bytesUsed_ = emptySpaceBefore_ - std::min(getNonStealableEmptySpace(), emptySpaceBefore_);
+		if (bytesUsed_ > budget) {
+			D_PRINTLN("preloading %s took %d KB, over budget", path_.get(), bytesUsed_ >> 10);
+			if (state_ == State::READ) {
+				discardSong();
+				state_ = State::DONE;
+			}
+			else {
+				state_ = State::READY;
+			}
+		}
+	}
+	else if (error == Error::ABORTED_BY_USER) {
+		cancel(); // Start again once whatever needed the card is done
+	}
+	else {
+		discardSong();
+		state_ = State::DONE; // Until currentSong changes. No sense retrying a file which didn't load
+	}
+}
+
+Error SongPreloader::findNextSong() {
+	if (currentSong->dirPath.isEmpty() || currentSong->name.isEmpty()) {
+		return Error::FILE_NOT_FOUND; // Never saved
+	}
+
+	Error error = storageManager.initSD();
+	if (error != Error::NONE) {
+		return error;
+	}
+
+	FRESULT result = f_opendir(&staticDIR, currentSong->dirPath.get());
+	if (result != FR_OK) {
+		return fresultToDelugeErrorCode(result);
+	}
+
+	// Same order as the browser, which compares whole filenames. Leaving the extensions off only changes that where
+	// one name is the start of another followed by a character sorting before '.', like a space or '-'
+	shouldInterpretNoteNames = false;
+	String nextFilename;
+	while (f_readdir(&staticDIR, &staticFNO) == FR_OK && staticFNO.fname[0]) {
+		audioFileManager.loadAnyEnqueuedClusters();
+		if (staticFNO.fname[0] == '.' || (staticFNO.fattrib & AM_DIR)) {
+			continue;
+		}
+		char* dotAddress = strrchr(staticFNO.fname, '.');
+		if (!dotAddress || strcasecmp(dotAddress + 1, "XML")) {
+			continue;
+		}
+		*dotAddress = 0;
+		if (strcmpspecial(staticFNO.fname, currentSong->name.get()) > 0
+		    && (name_.isEmpty() || strcmpspecial(staticFNO.fname, name_.get()) < 0)) {
+			error = name_.set(staticFNO.fname);
+			*dotAddress = '.';
+			if (error == Error::NONE) {
+				error = nextFilename.set(staticFNO.fname);
+			}
+			if (error != Error::NONE) {
+				break;
+			}
+		}
+	}
+	f_closedir(&staticDIR);
+
+	if (error == Error::NONE && nextFilename.isEmpty()) {
+		error = Error::FILE_NOT_FOUND; // Last song in the folder
+	}
+	if (error == Error::NONE) {
+		error = path_.set(currentSong->dirPath.get());
+	}
+	if (error == Error::NONE) {
+		error = path_.concatenate("/");
+	}
+	if (error == Error::NONE) {
+		error = path_.concatenate(&nextFilename);
+	}
+	if (error == Error::NONE) {
+		state_ = State::FOUND;
+	}
+	return error;
+}
+
+// Run in place of the audio routine every so often while the song's read or its samples found
+void SongPreloader::routineBetweenReads() {
+	double startTime = getSystemTime();
+	// Anything else that calls routineWithClusterLoading() in the meantime gets what it always has
+	AudioEngine::routineWithClusterLoadingOverride = nullptr;
+	yieldingRoutineForSD([]() { return true; });
+	AudioEngine::routineWithClusterLoadingOverride = &routineBetweenReads;
+	songPreloader.timeYielded_ += getSystemTime() - startTime;
+	songPreloader.checkStillWanted();
+}
+
+void SongPreloader::checkStillWanted() {
+	uint32_t emptySpace = getNonStealableEmptySpace();
+	uint32_t bytesUsed = emptySpaceBefore_ - std::min(emptySpace, emptySpaceBefore_);
+	if (bytesUsed > getBudget()) {
+		abandon(Error::INSUFFICIENT_RAM);
+	}
+	// Something the user did is waiting for the card, or the song it was for has gone
+	else if (waitingForSDRoutineToEnd || after_ != currentSong || !playbackHandler.isEitherClockActive()) {
+		abandon(Error::ABORTED_BY_USER);
+	}
+}
+
+// Gives up on the step that's running, having the rest of any file it's reading read as though it weren't there
+void SongPreloader::abandon(Error reason) {
+	if (abandonedWith_ != Error::NONE) {
+		return;
+	}
+	D_PRINTLN("abandoning preload of %s", path_.get());
+	abandonedWith_ = reason;
+	if (reader_) {
+		reader_->stopReading();
+	}
+}
+
+Error SongPreloader::readSong() {
+	AudioEngine::logAction("preloading song");
+	double startTime = getSystemTime();
+	timeYielded_ = 0;
+
+	Error error = getFileStamp(path_.get(), &fileTimestamp_, &fileSize_);
+	if (error != Error::NONE) {
+		return error;
+	}
+
+	Deserializer* reader = &smBinaryDeserializer;
+	error = storageManager.openBinaryTwin(path_.get(), smBinaryDeserializer, "song");
+	if (error != Error::NONE) {
+		reader = &smDeserializer;
+		FilePointer filePointer;
+		if (!storageManager.fileExists(path_.get(), &filePointer)) {
+			return Error::FILE_NOT_FOUND;
+		}
+		error = storageManager.openXMLFile(&filePointer, smDeserializer, "song");
+		if (error != Error::NONE) {
+			return error;
+		}
+	}
+
+	void* songMemory = GeneralMemoryAllocator::get().allocMaxSpeed(sizeof(Song));
+	if (!songMemory) {
+		storageManager.closeFile();
+		return Error::INSUFFICIENT_RAM;
+	}
+	song_ = new (songMemory) Song();
+
+	// Things being read look at preLoadedSong for the song they'll end up in
+	preLoadedSong = song_;
+	error = song_->paramManager.setupUnpatched();
+	if (error == Error::NONE) {
+		GlobalEffectable::initParams(&song_->paramManager);
+		beginHandingOver(reader);
+		error = song_->readFromFile(*reader);
+		endHandingOver();
+	}
+	preLoadedSong = nullptr;
+
+	bool success = storageManager.closeFile();
+	if (error == Error::NONE && !success) {
+		error = Error::SD_CARD;
+	}
+	if (error == Error::NONE) {
+		error = abandonedWith_;
+	}
+	if (error == Error::NONE) {
+		song_->dirPath.set(&after_->dirPath);
+		song_->name.set(&name_);
+		state_ = State::READ;
+	}
+	timeSpent_ += getSystemTime() - startTime - timeYielded_;
+	return error;
+}
+
+// First claiming samples already in memory, like a normal load does before loading any, so none of them get thrown
+// out to make room for the rest
+Error SongPreloader::startLoadingSamples(bool crucialOnly) {
+	double startTime = getSystemTime();
+	timeYielded_ = 0;
+
+	Error error = audioFileManager.setupAlternateAudioFileDir(&audioFileManager.alternateAudioFileLoadPath,
+	                                                          song_->dirPath.get(), &name_);
+	if (error != Error::NONE) {
+		return error;
+	}
+	audioFileManager.thingBeginningLoading(ThingType::SONG);
+
+	preLoadedSong = song_;
+	beginHandingOver(nullptr);
+	if (crucialOnly) {
+		song_->loadCrucialSamplesOnly();
+		state_ = State::LOADING_SAMPLES;
+	}
+	else {
+		song_->loadAllSamples(false);
+		state_ = State::CLAIMED_SAMPLES;
+	}
+	endHandingOver();
+	preLoadedSong = nullptr;
+
+	audioFileManager.thingFinishedLoading();
+	timeSpent_ += getSystemTime() - startTime - timeYielded_;
+	// Going over budget here is dealt with the same whether or not it was noticed part way through
+	return (abandonedWith_ == Error::INSUFFICIENT_RAM) ? Error::NONE : abandonedWith_;
+}
+
+void SongPreloader::beginHandingOver(Deserializer* reader) {
+	busy_ = true;
+	abandonedWith_ = Error::NONE;
+	reader_ = reader;
+	AudioEngine::routineWithClusterLoadingOverride = &routineBetweenReads;
+}
+
+void SongPreloader::endHandingOver() {
+	AudioEngine::routineWithClusterLoadingOverride = nullptr;
+	reader_ = nullptr;
+	busy_ = false;
+}
+
+Song* SongPreloader::take(char const* filePath) {
+	bool hit = !busy_ && song_ && state_ >= State::READ && !strcasecmp(filePath, path_.get());
+	if (hit) {
+		uint32_t timestamp;
+		uint32_t size;
+		hit = getFileStamp(path_.get(), &timestamp, &size) == Error::NONE && timestamp == fileTimestamp_
+		      && size == fileSize_;
+	}
+
+	lastSwap = getReadiness(hit, state_, audioFileManager.loadingQueue, bytesUsed_, timeSpent_);
+
+	if (!hit) {
+		D_PRINTLN("loading %s, which wasn't preloaded", filePath);
+		cancel();
+		return nullptr;
+	}
+
+	D_PRINTLN("loading preloaded %s: samples %s, %d Clusters still queued, %d KB, %d ms saved", filePath,
+	          lastSwap.samplesLoaded ? "loaded" : (lastSwap.samplesClaimed ? "claimed" : "not claimed"),
+	          lastSwap.clustersStillQueued, lastSwap.bytesUsed >> 10, lastSwap.msSaved);
+	Song* song = song_;
+	song_ = nullptr;
+	cancel();
+	return song;
+}
+
+void SongPreloader::cancel() {
+	if (busy_) {
+		// Part way through a step, further down the stack. It's thrown away once that's got back to routine()
+		abandon(Error::ABORTED_BY_USER);
+		after_ = nullptr;
+		return;
+	}
+	discardSong();
+	state_ = State::IDLE;
+	after_ = nullptr;
+}
+
+void SongPreloader::discardSong() {
+	if (song_) {
+		AudioEngine::logAction("discarding preloaded song");
+		void* toDealloc = dynamic_cast<void*>(song_);
+		song_->~Song(); // Will also delete paramManager
+		delugeDealloc(toDealloc);
+		song_ = nullptr;
+	}
+	name_.clear();
+	path_.clear();
+	bytesUsed_ = 0;
+	timeSpent_ = 0;
+}
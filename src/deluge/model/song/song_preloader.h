@@ -0,0 +1,118 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "definitions_cxx.hpp"
+#include "util/d_string.h"
+#include <cstdint>
+
+class ClusterPriorityQueue;
+class Deserializer;
+class Song;
+
+/*
+ * Loads the song after the current one in its folder while the current one plays, so that when a set moves on to it,
+ * all that's left to do is the song-swap itself.
+ *
+ * It goes a step at a time from a low priority task:
+ * - Find the next song in the folder, in the order the browser lists them.
+ * - Read it into a Song of its own.
+ * - Lay claim to any of its samples which are already in memory.
+ * - Enqueue the start of the samples it'll need straight away, as Song::loadCrucialSamplesOnly() does for a load
+ *   during playback, and wait for those Clusters to be loaded. They're enqueued at the lowest priority, behind every
+ *   Cluster the playing song needs.
+ * Nothing is started while the user is in a menu or browser or any UI mode, or while a launch is scheduled.
+ *
+ * Reading the song and finding its samples are long steps. Where a normal load would run the audio routine every so
+ * often, these hand over to the task scheduler instead, with the card marked busy the way the SD driver marks it while
+ * it waits for a read - so the audio routine culls as usual, and the UI, pads and encoders carry on, other than
+ * anything that needs the card, which waits. If the user does want the card, or the song stops, reading's abandoned.
+ *
+ * The PreloadNextSong community setting gives how much memory it may take. What's counted is how much empty space
+ * goes from the internal and external regions - the Song, its Instruments, Samples and so on. That's checked every
+ * time it hands over, and the song's abandoned as soon as it's over, so it gives way well before it'd have to steal
+ * memory from Clusters. Cluster data is in the stealable region, and apart from the first Clusters of each sample,
+ * which the Song holds on to, it's given up to the playing song whenever that needs it. If the samples take it over
+ * budget, it goes no further.
+ *
+ * LoadSongUI::performLoad() takes the Song if it's the one being loaded and its file's timestamp and size haven't
+ * changed since, and what was ready by then is kept in lastSwap. SaveSongUI::performSave() throws it away, as the file
+ * saved could be this one.
+ */
+class SongPreloader {
+public:
+	enum class State : uint8_t { IDLE, FOUND, READ, CLAIMED_SAMPLES, LOADING_SAMPLES, READY, DONE };
+
+	/// How much of the next song was ready when a song was loaded
+	struct Readiness {
+		bool hit;            // Whether it was the song being loaded at all
+		bool samplesClaimed; // Whether its samples already in memory had been found
+		bool samplesLoaded;  // Whether the Clusters it needs straight away had all been loaded
+		int32_t clustersStillQueued;
+		uint32_t bytesUsed;
+		/// Time spent reading the song and finding its samples, which the load didn't have to wait for
+		uint32_t msSaved;
+	};
+
+	void routine();
+
+	/// The preloaded Song, if it's of the file at filePath and that hasn't changed since. Caller takes ownership
+	Song* take(char const* filePath);
+	/// Throw away anything preloaded
+	void cancel();
+
+	Readiness lastSwap{};
+
+	/// What was ready, if the song being loaded was the one preloaded and preloading got as far as reached. The
+	/// lowest priority Clusters in loadingQueue are the ones for the preloaded song still to load
+	static Readiness getReadiness(bool hit, State reached, ClusterPriorityQueue& loadingQueue, uint32_t bytesUsed,
+	                              double secondsSpent);
+
+private:
+	bool mayUseCard();
+	static void routineBetweenReads();
+	void checkStillWanted();
+	void abandon(Error reason);
+	void beginHandingOver(Deserializer* reader);
+	void endHandingOver();
+	Error findNextSong();
+	Error readSong();
+	Error startLoadingSamples(bool crucialOnly);
+	void discardSong();
+
+	State state_ = State::IDLE;
+	/// The song this one comes after. Once that stops being currentSong, everything's thrown away
+	Song* after_ = nullptr;
+	Song* song_ = nullptr;
+	String name_;
+	String path_;
+	uint32_t fileTimestamp_ = 0;
+	uint32_t fileSize_ = 0;
+	uint32_t emptySpaceBefore_ = 0;
+	uint32_t bytesUsed_ = 0;
+	double timeSpent_ = 0;
+	double timeYielded_ = 0;
+	/// Set while a step is running, which it's not finished until after it's handed over to other tasks
+	bool busy_ = false;
+	/// What the song's being read with, while it is
+	Deserializer* reader_ = nullptr;
+	/// Why the step that's running was given up on part way through, if it was
+	Error abandonedWith_ = Error::NONE;
+};
+
+extern SongPreloader songPreloader;
@@ -0,0 +1,37 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Apart from the rest of SongPreloader so it builds on the host, which doesn't build Song
+
+#include "model/song/song_preloader.h"
+#include "storage/cluster/cluster_priority_queue.h"
+
+SongPreloader::Readiness SongPreloader::getReadiness(bool hit, State reached, ClusterPriorityQueue& loadingQueue,
+                                                     uint32_t bytesUsed, double secondsSpent) {
+	if (!hit) {
+		return {};
+	}
+	return {
+	    .hit = true,
+	    .samplesClaimed = reached >= State::CLAIMED_SAMPLES && reached != State::DONE,
+	    .samplesLoaded = reached == State::READY,
+	    // Anything for a song that isn't playing yet is enqueued with no deadline
+	    .clustersStillQueued = loadingQueue.getNumWithoutDeadline(),
+	    .bytesUsed = bytesUsed,
+	    .msSaved = (uint32_t)(secondsSpent * 1000),
+	};
+}
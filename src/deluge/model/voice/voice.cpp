@@ -31,6 +31,7 @@
 #include "model/sample/sample_cache.h"
 #include "model/sample/sample_holder_for_voice.h"
 #include "model/song/song.h"
+#include "model/voice/voice_priority_index.h"
 #include "model/voice/voice_sample.h"
 #include "modulation/params/param_set.h"
 #include "modulation/patch/patch_cable_set.h"
@@ -336,6 +337,7 @@ activenessDetermined:
 	whichExpressionSourcesCurrentlySmoothing = 0;
 	filterGainLastTime = 0;
 
+	updatePriorityIndex();
 	return true;
 }
 
@@ -600,6 +602,7 @@ void Voice::noteOff(ModelStackWithVoice* modelStack, bool allowReleaseStage) {
 	else {
 		previouslyIgnoredNoteOff = true;
 	}
+	updatePriorityIndex();
 
 	if (sound->synthMode != SynthMode::FM) {
 		for (int32_t s = 0; s < kNumSources; s++) {
@@ -1472,6 +1475,11 @@ carriersDone: {}
 skipUnisonPart: {}
 	}
 
+	// Under enough CPU load, a voice that's released down to where nobody would hear its filters doesn't run them
+	bool bypassFilters = AudioEngine::qualityTier >= QualityTier::NO_RELEASE_FILTERS
+	                     && envelopes[0].state >= EnvelopeStage::RELEASE
+	                     && envelopes[0].lastValue < kInaudibleReleaseLevel;
+
 	if (didStereoTempBuffer) {
 		int32_t* const oscBufferEnd = oscBuffer + (numSamples << 1);
 		// fold
@@ -1479,7 +1487,9 @@ skipUnisonPart: {}
 			dsp::foldBufferPolyApproximation(oscBuffer, oscBufferEnd, paramFinalValues[params::LOCAL_FOLD]);
 		}
 		// Filters
-		filterSet.renderLongStereo(oscBuffer, oscBufferEnd);
+		if (!bypassFilters) {
+			filterSet.renderLongStereo(oscBuffer, oscBufferEnd);
+		}
 
 		// No clipping
 		if (!sound->clippingAmount) {
@@ -1562,7 +1572,9 @@ skipUnisonPart: {}
 			dsp::foldBufferPolyApproximation(oscBuffer, oscBufferEnd, foldAmount);
 		}
 
-		filterSet.renderLong(oscBuffer, oscBufferEnd, numSamples);
+		if (!bypassFilters) {
+			filterSet.renderLong(oscBuffer, oscBufferEnd, numSamples);
+		}
 
 		// No clipping
 		if (!sound->clippingAmount) {
@@ -1985,6 +1997,20 @@ void Voice::renderBasicSource(Sound* sound, ParamManagerForTimeline* paramManage
 
 	GeneralMemoryAllocator::get().checkStack("Voice::renderBasicSource");
 
+	// Under enough CPU load, oscillators leave out some of their unison parts, and the rest make up the level. Samples
+	// keep all theirs, since each part may be at a different place in the file
+	bool thinUnison = AudioEngine::qualityTier >= QualityTier::FEWER_UNISON && sound->numUnison > 2 && !doOscSync
+	                  && sound->sources[s].oscType <= OscType::WAVETABLE;
+	int32_t oscAmplitude = sourceAmplitude;
+	int32_t oscAmplitudeIncrement = amplitudeIncrement;
+	if (thinUnison) {
+		int64_t gain = unisonGainUnderLoad(sound->numUnison);
+		int64_t amplitudeEnd = sourceAmplitude + (int64_t)amplitudeIncrement * numSamples;
+		oscAmplitude = std::clamp<int64_t>(sourceAmplitude * gain >> 16, INT32_MIN, INT32_MAX);
+		amplitudeEnd = std::clamp<int64_t>(amplitudeEnd * gain >> 16, INT32_MIN, INT32_MAX);
+		oscAmplitudeIncrement = (amplitudeEnd - oscAmplitude) / numSamples;
+	}
+
 	// For each unison part
 	for (int32_t u = 0; u < sound->numUnison; u++) {
 
@@ -2447,6 +2473,12 @@ dontUseCache: {}
 				oscSyncPhaseIncrementsThisUnison = oscSyncPhaseIncrements[u];
 			}
 
+			// Keep the phase of a part that's left out running, so it's where it should be if it comes back
+			if (thinUnison && unisonPartSkippedUnderLoad(u, sound->numUnison)) {
+				unisonParts[u].sources[s].oscPos += phaseIncrement * numSamples;
+				continue;
+			}
+
 			int32_t* renderBuffer = oscBuffer;
 
 			if (stereoBuffer) {
@@ -2460,8 +2492,8 @@ dontUseCache: {}
 			// Work out pulse width
 			uint32_t pulseWidth = (uint32_t)lshiftAndSaturate<1>(paramFinalValues[params::LOCAL_OSC_A_PHASE_WIDTH + s]);
 
-			renderOsc(s, sound->sources[s].oscType, sourceAmplitude, renderBuffer, oscBufferEnd, numSamples,
-			          phaseIncrement, pulseWidth, &unisonParts[u].sources[s].oscPos, true, amplitudeIncrement,
+			renderOsc(s, sound->sources[s].oscType, oscAmplitude, renderBuffer, oscBufferEnd, numSamples,
+			          phaseIncrement, pulseWidth, &unisonParts[u].sources[s].oscPos, true, oscAmplitudeIncrement,
 			          doOscSync, oscSyncPosThisUnison, oscSyncPhaseIncrementsThisUnison, oscRetriggerPhase,
 			          waveIndexIncrement);
 
@@ -2800,6 +2832,11 @@ Voice::renderOsc(int32_t s, OscType type, int32_t amplitude, int32_t* bufferStar
 			}
 		}
 
+		// Under the most CPU load, go for the table an octave up - half the harmonics, and at most half the size
+		if (AudioEngine::qualityTier >= QualityTier::SMALL_TABLES) {
+			phaseIncrementForCalculations = phaseIncrementForTableUnderLoad(phaseIncrementForCalculations);
+		}
+
 		getTableNumber(phaseIncrementForCalculations, &tableNumber, &tableSizeMagnitude);
 		// TODO: that should really take into account the phaseIncrement (pitch) after it's potentially been altered for
 		// non-square PW below.
@@ -3234,6 +3271,7 @@ storePhase:
 bool Voice::doFastRelease(uint32_t releaseIncrement) {
 	if (doneFirstRender) {
 		envelopes[0].unconditionalRelease(EnvelopeStage::FAST_RELEASE, releaseIncrement);
+		updatePriorityIndex();
 		return true;
 	}
 
@@ -3246,6 +3284,7 @@ bool Voice::doFastRelease(uint32_t releaseIncrement) {
 bool Voice::doImmediateRelease() {
 	if (doneFirstRender) {
 		envelopes[0].unconditionalOff();
+		updatePriorityIndex();
 		return true;
 	}
 
@@ -3281,4 +3320,11 @@ uint32_t Voice::getPriorityRating() {
 	    // Bits  0-23 - time entered
 	    + ((uint32_t)(-envelopes[0].timeEnteredState) & (0xFFFFFFFF >> 8));
 }
+
+void Voice::updatePriorityIndex() {
+	// a soft cull which has to take a voice leaves alone the ones already fast-releasing quicker than it would make them
+	bool softCullable = envelopes[0].state <= EnvelopeStage::FAST_RELEASE
+	                    && envelopes[0].fastReleaseIncrement < SOFT_CULL_INCREMENT;
+	AudioEngine::voicePriorities.update(priorityIndexSlot, getPriorityRating(), softCullable);
+}
 #pragma GCC diagnostic pop
@@ -85,6 +85,9 @@ public:
 
 	Voice* nextUnassigned;
 
+	/// This Voice's slot in AudioEngine::voicePriorities, while it's in activeVoices
+	int16_t priorityIndexSlot;
+
 	uint32_t getLocalLFOPhaseIncrement();
 	void setAsUnassigned(ModelStackWithVoice* modelStack, bool deletingSong = false);
 	bool render(ModelStackWithVoice* modelStack, int32_t* soundBuffer, int32_t numSamples, bool soundRenderingInStereo,
@@ -104,6 +107,9 @@ public:
 	bool hasReleaseStage();
 	void unassignStuff(bool deletingSong);
 	uint32_t getPriorityRating();
+	/// Tell AudioEngine::voicePriorities about any change to getPriorityRating() or to whether a soft cull may take
+	/// this Voice. Needs calling after anything changes envelopes[0], or the Sound's voice priority or voice count.
+	void updatePriorityIndex();
 	void expressionEventImmediate(Sound* sound, int32_t voiceLevelValue, int32_t s);
 	void expressionEventSmooth(int32_t newValue, int32_t s);
 
@@ -0,0 +1,85 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "model/voice/voice_priority_index.h"
+
+VoicePriorityIndex::VoicePriorityIndex() {
+	clear();
+}
+
+void VoicePriorityIndex::clear() {
+	nodes_.fill({kNotIndexed, kNotIndexed});
+	ratings_.fill(0);
+	softCullable_.fill(false);
+	voices_.fill(nullptr);
+	// hand out the lowest slots first, which keeps the ones in use close together
+	for (int32_t i = 0; i < kNumSlots; i++) {
+		freeSlots_[i] = kNumSlots - 1 - i;
+	}
+	numFreeSlots_ = kNumSlots;
+	numUnindexed_ = 0;
+}
+
+int16_t VoicePriorityIndex::add(Voice* voice) {
+	if (!numFreeSlots_) {
+		numUnindexed_++;
+		return kNotIndexed;
+	}
+	int16_t slot = freeSlots_[--numFreeSlots_];
+	voices_[slot] = voice;
+	return slot;
+}
+
+void VoicePriorityIndex::remove(int16_t slot) {
+	if (slot == kNotIndexed) {
+		numUnindexed_--;
+		return;
+	}
+	update(slot, 0, false);
+	voices_[slot] = nullptr;
+	freeSlots_[numFreeSlots_++] = slot;
+}
+
+// A slot rated 0 isn't a candidate. Equal ratings go to the lower slot, like the linear walk going to the earlier voice
+int16_t VoicePriorityIndex::higher(int16_t a, int16_t b) const {
+	if (a == kNotIndexed) {
+		return b;
+	}
+	if (b == kNotIndexed) {
+		return a;
+	}
+	return (ratings_[b] > ratings_[a]) ? b : a;
+}
+
+void VoicePriorityIndex::propagate(int16_t slot) {
+	int32_t n = kNumSlots + slot;
+	bool candidate = ratings_[slot] != 0;
+	nodes_[n].best = candidate ? slot : kNotIndexed;
+	nodes_[n].bestSoftCullable = (candidate && softCullable_[slot]) ? slot : kNotIndexed;
+
+	for (n >>= 1; n; n >>= 1) {
+		const Node& left = nodes_[n * 2];
+		const Node& right = nodes_[n * 2 + 1];
+		Node updated{higher(left.best, right.best), higher(left.bestSoftCullable, right.bestSoftCullable)};
+		// if this node still picks the same slots, and neither is the one that changed, nothing above it changes
+		if (updated.best == nodes_[n].best && updated.bestSoftCullable == nodes_[n].bestSoftCullable
+		    && updated.best != slot && updated.bestSoftCullable != slot) {
+			break;
+		}
+		nodes_[n] = updated;
+	}
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+class Voice;
+
+/*
+ * Keeps track of which active Voice AudioEngine::cullVoice() should pick, so it doesn't have to rate every Voice each
+ * time it's called - which, when things are dire, can be several times a routine.
+ *
+ * It's a max-tree over a fixed number of slots. Each Voice holds a slot from when it's solicited until it's unassigned,
+ * and whenever something getPriorityRating() depends on changes, it updates its slot with
+ * Voice::updatePriorityIndex(). That costs one comparison if nothing changed, or a walk up the tree if it did. Every
+ * node remembers the best slot below it, both overall and among the voices a soft cull may take, so both questions
+ * are answered from the root.
+ *
+ * If more voices are active than there are slots, the extras go unindexed and cullVoice() goes back to looking at
+ * every voice until they're gone.
+ */
+class VoicePriorityIndex {
+public:
+	static constexpr int32_t kNumSlots = 256;
+	static constexpr int16_t kNotIndexed = -1;
+
+	VoicePriorityIndex();
+
+	/// Give a voice a slot, rated 0 (never culled) until its first update(). Returns kNotIndexed if they're all taken
+	int16_t add(Voice* voice);
+	/// Free a slot from add(), which may have been kNotIndexed
+	void remove(int16_t slot);
+	/// rating is Voice::getPriorityRating(), and softCullable says whether a SOFT_ALWAYS cull may take the voice
+	void update(int16_t slot, uint32_t rating, bool softCullable) {
+		if (slot != kNotIndexed && (ratings_[slot] != rating || softCullable_[slot] != softCullable)) {
+			ratings_[slot] = rating;
+			softCullable_[slot] = softCullable;
+			propagate(slot);
+		}
+	}
+
+	/// The voice with the highest rating, or among the soft cullable ones if softCullableOnly. nullptr if there's none
+	[[nodiscard]] Voice* highest(bool softCullableOnly) const {
+		int16_t slot = softCullableOnly ? nodes_[1].bestSoftCullable : nodes_[1].best;
+		return (slot == kNotIndexed) ? nullptr : voices_[slot];
+	}
+
+	/// Whether every voice added has a slot, so highest() can be trusted
+	[[nodiscard]] bool isComplete() const { return numUnindexed_ == 0; }
+
+	void clear();
+
+private:
+	struct Node {
+		int16_t best;
+		int16_t bestSoftCullable;
+	};
+
+	void propagate(int16_t slot);
+	[[nodiscard]] int16_t higher(int16_t a, int16_t b) const;
+
+	// nodes_[1] is the root, node n has children 2n and 2n + 1, and slot s is the leaf at kNumSlots + s
+	std::array<Node, kNumSlots * 2> nodes_;
+	std::array<uint32_t, kNumSlots> ratings_;
+	std::array<bool, kNumSlots> softCullable_;
+	std::array<Voice*, kNumSlots> voices_;
+
+	std::array<int16_t, kNumSlots> freeSlots_;
+	int32_t numFreeSlots_;
+	int32_t numUnindexed_;
+};
@@ -204,8 +204,9 @@ LateStartAttemptStatus VoiceSample::attemptLateSampleStart(SamplePlaybackGuide*
 
 	for (int32_t l = 0; l < kNumClustersLoadedAhead; l++) {
 
-		// Grab it.
-		newClusters[l] = sample->clusters.getElement(clusterIndex)->getCluster(sample, clusterIndex, CLUSTER_ENQUEUE);
+		// Grab it. We're already late, so it's needed now
+		newClusters[l] = sample->clusters.getElement(clusterIndex)
+		                     ->getCluster(sample, clusterIndex, CLUSTER_ENQUEUE, AudioEngine::audioSampleTimer);
 
 		// If failure (would only happen in insanely rare case where there's no free RAM)
 		if (l == 0 && !newClusters[l]) {
@@ -225,7 +226,7 @@ LateStartAttemptStatus VoiceSample::attemptLateSampleStart(SamplePlaybackGuide*
 	unassignAllReasons(false);
 
 	// Copy in the new reasons we just made
-	memcpy(clusters, newClusters, sizeof(clusters));
+	memcpy(clusters, newClusters, sizeof(newClusters));
 
 	// TODO: lots of this code is kinda tied to there being just two clusters looked-ahead (wait, not any more right?)
 
@@ -426,6 +427,11 @@ bool VoiceSample::render(SamplePlaybackGuide* guide, int32_t* __restrict__ outpu
 
 	int32_t playDirection = guide->playDirection;
 
+	// Read ahead as far as the speed we're going through the file needs. Time-stretching plays each hop at
+	// phaseIncrement but jumps by timeStretchRatio overall, so go by whichever's faster
+	uint64_t speed = std::max<uint64_t>(phaseIncrement, ((uint64_t)phaseIncrement * timeStretchRatio) >> 24);
+	readAheadRate = (speed * sample->byteDepth * sampleSourceNumChannels) >> 8;
+
 	// If there's a cache, check some stuff. Do this first, cos this can cause us to return
 	// unlikely - if there is a cache this render will be fast, if not we definitely don't want to waste time looking
 	if (cache) [[unlikely]] {
@@ -1904,11 +1904,11 @@ Error AutoParam::readFromFile(Deserializer& reader, int32_t readAutomationUpToPo
 	// Or, normal case - hex and automation...
 
 	// First, read currentValue
-	char const* hexChars = reader.readNextCharsOfTagOrAttributeValue(8);
-	if (!hexChars) {
+	uint8_t const* bytes = reader.readNextHexBytesOfTagOrAttributeValue(4);
+	if (!bytes) {
 		return Error::NONE;
 	}
-	currentValue = hexToIntFixedLength(hexChars, 8);
+	currentValue = bytesToIntBigEndian(bytes, 4);
 
 	// And now read in the automation
 	int32_t numElementsToAllocateFor = 0;
@@ -1934,12 +1934,12 @@ Error AutoParam::readFromFile(Deserializer& reader, int32_t readAutomationUpToPo
 				}
 			}
 
-			hexChars = reader.readNextCharsOfTagOrAttributeValue(16);
-			if (!hexChars) {
+			bytes = reader.readNextHexBytesOfTagOrAttributeValue(8);
+			if (!bytes) {
 				return Error::NONE;
 			}
-			int32_t value = hexToIntFixedLength(hexChars, 8);
-			int32_t pos = hexToIntFixedLength(&hexChars[8], 8);
+			int32_t value = bytesToIntBigEndian(bytes, 4);
+			int32_t pos = bytesToIntBigEndian(&bytes[4], 4);
 
 			bool interpolated = (pos & ((uint32_t)1 << 31));
 			if (interpolated) {
@@ -0,0 +1,99 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "modulation/midi/learned_cc_index.h"
+#include <algorithm>
+
+void LearnedCCIndex::clear() {
+	learned_.clear();
+	outputs_.clear();
+	buckets_.clear();
+	numCCs_ = 0;
+	upToDate_ = false;
+}
+
+void LearnedCCIndex::add(Output* output, int32_t channel, int32_t ccNumber) {
+	// Anything else - MPE zones, pitch bend "knobs" - never comes in as a CC
+	if (channel < 0 || channel >= 16 || ccNumber < 0 || ccNumber >= 128) {
+		return;
+	}
+	learned_.push_back({getKey(channel, ccNumber), output});
+}
+
+int32_t LearnedCCIndex::getBucketIndex(uint16_t key) const {
+	return (((uint32_t)key * 2654435761u) >> 16) & (buckets_.size() - 1);
+}
+
+void LearnedCCIndex::finish() {
+	// Stable, so each key's Outputs stay in the order they were added, with any added more than once side by side
+	std::stable_sort(learned_.begin(), learned_.end(),
+	                 [](Learned const& a, Learned const& b) { return a.key < b.key; });
+	learned_.erase(std::unique(learned_.begin(), learned_.end(),
+	                           [](Learned const& a, Learned const& b) {
+		                           return a.key == b.key && a.output == b.output;
+	                           }),
+	               learned_.end());
+
+	numCCs_ = 0;
+	for (size_t i = 0; i < learned_.size(); i++) {
+		if (!i || learned_[i].key != learned_[i - 1].key) {
+			numCCs_++;
+		}
+	}
+
+	size_t numBuckets = 8;
+	while (numBuckets < (size_t)numCCs_ * 2) {
+		numBuckets <<= 1;
+	}
+	buckets_.assign(numBuckets, Bucket{kNoKey, 0, 0});
+	outputs_.clear();
+	outputs_.reserve(learned_.size());
+
+	Bucket* bucket = nullptr;
+	for (Learned const& learned : learned_) {
+		if (!bucket || bucket->key != learned.key) {
+			int32_t b = getBucketIndex(learned.key);
+			while (buckets_[b].key != kNoKey) {
+				b = (b + 1) & (numBuckets - 1);
+			}
+			bucket = &buckets_[b];
+			*bucket = {learned.key, (uint16_t)outputs_.size(), 0};
+		}
+		outputs_.push_back(learned.output);
+		bucket->numOutputs++;
+	}
+
+	learned_.clear();
+	learned_.shrink_to_fit();
+	upToDate_ = true;
+}
+
+std::span<Output* const> LearnedCCIndex::getOutputs(int32_t channel, int32_t ccNumber) const {
+	if (!numCCs_ || channel < 0 || channel >= 16 || ccNumber < 0 || ccNumber >= 128) {
+		return {};
+	}
+	uint16_t key = getKey(channel, ccNumber);
+	for (int32_t b = getBucketIndex(key);; b = (b + 1) & (buckets_.size() - 1)) {
+		Bucket const& bucket = buckets_[b];
+		if (bucket.key == key) {
+			return {&outputs_[bucket.firstOutput], bucket.numOutputs};
+		}
+		if (bucket.key == kNoKey) {
+			return {};
+		}
+	}
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "util/containers.h"
+#include <cstdint>
+#include <span>
+
+class Output;
+
+/*
+ * Which Outputs have a MIDIKnob - their own or one of their Drums' - learned to each channel and CC, so that a
+ * received CC only goes to those Outputs rather than every one in the Song, each going through all its knobs.
+ *
+ * It's looked up by channel and CC, hashed into a small open-addressed table. The device isn't part of the key, as a
+ * knob learned with no device, or while inputs aren't being differentiated by device, matches any - each Output still
+ * checks that for itself, as it always did.
+ *
+ * Anything being learned or unlearned, or an Output being added, removed or replaced, invalidates it, and
+ * PlaybackHandler::slowRoutine() has the Song rebuild it. In between, a received CC goes to every Output.
+ */
+class LearnedCCIndex {
+public:
+	void invalidate() { upToDate_ = false; }
+	[[nodiscard]] bool isUpToDate() const { return upToDate_; }
+
+	/// Starts a rebuild. Then add() each learned CC, Output by Output in the order they're to be offered CCs, and
+	/// finish()
+	void clear();
+	void add(Output* output, int32_t channel, int32_t ccNumber);
+	void finish();
+
+	/// The Outputs with anything learned to this channel and CC, each just once, in the order they were added
+	[[nodiscard]] std::span<Output* const> getOutputs(int32_t channel, int32_t ccNumber) const;
+
+	[[nodiscard]] int32_t getNumCCs() const { return numCCs_; }
+
+private:
+	struct Learned {
+		uint16_t key;
+		Output* output;
+	};
+	struct Bucket {
+		uint16_t key; // kNoKey for an empty one
+		uint16_t firstOutput;
+		uint16_t numOutputs;
+	};
+
+	static constexpr uint16_t kNoKey = 0xFFFF;
+
+	static uint16_t getKey(int32_t channel, int32_t ccNumber) { return (channel << 7) | ccNumber; }
+	[[nodiscard]] int32_t getBucketIndex(uint16_t key) const;
+
+	deluge::vector<Learned> learned_;
+	deluge::vector<Output*> outputs_; // Grouped by key, each group in a Bucket
+	deluge::vector<Bucket> buckets_;  // A power of two of them, at most half full
+	int32_t numCCs_ = 0;
+	bool upToDate_ = false;
+};
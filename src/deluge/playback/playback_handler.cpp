@@ -73,6 +73,7 @@
 #include "storage/storage_manager.h"
 #include "util/cfunctions.h"
 #include "util/functions.h"
+#include <algorithm>
 #include <math.h>
 #include <new>
 
@@ -174,6 +175,11 @@ void PlaybackHandler::slowRoutine() {
 
 		pendingGlobalMIDICommand = GlobalMIDICommand::NONE;
 	}
+
+	// Here rather than in midiCCReceived(), which would otherwise have to allocate
+	if (currentSong) {
+		currentSong->updateLearnedCCIndex();
+	}
 }
 
 void PlaybackHandler::playButtonPressed(int32_t buttonPressLatency) {
@@ -1656,21 +1662,7 @@ void PlaybackHandler::inputTick(bool fromTriggerClock, uint32_t time) {
 		setupPlaybackUsingExternalClock(true);
 	}
 
-	uint32_t timeTilInputTick;
-
-	// The 40 here is a fine-tuned amount to stop everything wrapping wrong when CPU load heavy. 28 to 98 seemed to work
-	// correctly
-	if (time) {
-		timeTilInputTick =
-		    (((uint32_t)(time - (uint32_t)AudioEngine::i2sTXBufferPos) >> (2 + NUM_MONO_OUTPUT_CHANNELS_MAGNITUDE))
-		     + 40)
-		    & (SSI_TX_BUFFER_NUM_SAMPLES - 1);
-	}
-	else {
-		timeTilInputTick = 0;
-	}
-
-	uint32_t timeThisInputTick = AudioEngine::audioSampleTimer + timeTilInputTick;
+	uint32_t timeThisInputTick = time ? AudioEngine::getTimeDMANextReaches(time) : AudioEngine::audioSampleTimer;
 
 	// If we're doing tempo magnitude matching, do all that
 	if (tempoMagnitudeMatchingActiveNow) {
@@ -2793,6 +2785,48 @@ bool PlaybackHandler::offerNoteToLearnedThings(MIDIDevice* fromDevice, bool on,
 	return foundAnything;
 }
 
+// Whether offerNoteToLearnedThings() would find anything, without doing it
+bool PlaybackHandler::isLearnedToAnything(MIDIDevice* fromDevice, int32_t channel, int32_t note) {
+	for (int32_t c = 0; c < kNumGlobalMIDICommands; c++) {
+		if (midiEngine.globalMIDICommands[c].equalsNoteOrCC(fromDevice, channel, note)
+		    || (static_cast<GlobalMIDICommand>(c) == GlobalMIDICommand::TRANSPOSE
+		        && midiEngine.globalMIDICommands[c].equalsChannelOrZone(fromDevice, channel))) {
+			return true;
+		}
+	}
+	for (int32_t s = 0; s < kMaxNumSections; s++) {
+		if (currentSong->sections[s].launchMIDICommand.equalsNoteOrCC(fromDevice, channel, note)) {
+			return true;
+		}
+	}
+	for (int32_t c = 0; c < currentSong->sessionClips.getNumElements(); c++) {
+		if (currentSong->sessionClips.getClipAtIndex(c)->muteMIDICommand.equalsNoteOrCC(fromDevice, channel, note)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool PlaybackHandler::mayActOnNoteOrCCInRender(MIDIDevice* fromDevice, bool isCC, int32_t channel,
+                                               int32_t noteOrCC) {
+	// Learning, or recording, which edits Clips
+	if (!currentSong || currentUIMode == UI_MODE_MIDI_LEARN || shouldRecordNotesNow()) {
+		return false;
+	}
+	if (!isCC) {
+		return !isLearnedToAnything(fromDevice, channel, noteOrCC);
+	}
+
+	MIDIPort& port = fromDevice->ports[MIDI_DIRECTION_INPUT_TO_DELUGE];
+	// Channel mode messages, the SoundEditor getting first dibs, and MIDI follow, which shows what it changes
+	if (noteOrCC >= 120 || getCurrentUI() == &soundEditor
+	    || midiFollow.checkMidiFollowMatch(fromDevice, channel) != MIDIMatchType::NO_MATCH) {
+		return false;
+	}
+	return port.isChannelPartOfAnMPEZone(channel)
+	       || !isLearnedToAnything(fromDevice, port.channelToZone(channel) + IS_A_CC, noteOrCC);
+}
+
 void PlaybackHandler::noteMessageReceived(MIDIDevice* fromDevice, bool on, int32_t channel, int32_t note,
                                           int32_t velocity, bool* doingMidiThru) {
 	// If user assigning/learning MIDI commands, do that
@@ -3010,6 +3044,13 @@ void PlaybackHandler::midiCCReceived(MIDIDevice* fromDevice, uint8_t channel, ui
 		}
 	}
 
+	// Only the Outputs with a knob learned to this channel and CC need offering it as a param. If what's learned has
+	// changed since the index was last rebuilt, every Output's offered it
+	std::optional<std::span<Output* const>> learnedOutputs;
+	if (!isMPE) {
+		learnedOutputs = currentSong->getOutputsWithParamsLearnedToCC(channel, ccNumber);
+	}
+
 	// Go through all Outputs...
 	for (Output* thisOutput = currentSong->firstOutput; thisOutput; thisOutput = thisOutput->next) {
 
@@ -3021,7 +3062,9 @@ void PlaybackHandler::midiCCReceived(MIDIDevice* fromDevice, uint8_t channel, ui
 			ModelStackWithTimelineCounter* modelStackWithTimelineCounter =
 			    modelStack->addTimelineCounter(thisOutput->getActiveClip());
 
-			if (!isMPE) {
+			bool mayBeLearned =
+			    !learnedOutputs || std::ranges::find(*learnedOutputs, thisOutput) != learnedOutputs->end();
+			if (!isMPE && mayBeLearned) {
 				// See if it's learned to a parameter
 				// NOTE: this call may change modelStackWithTimelineCounter->timelineCounter etc!
 				thisOutput->offerReceivedCCToLearnedParams(fromDevice, channel, ccNumber, value,
@@ -191,6 +191,9 @@ public:
 
 	void noteMessageReceived(MIDIDevice* fromDevice, bool on, int32_t channel, int32_t note, int32_t velocity,
 	                         bool* doingMidiThru);
+	/// Whether a received note or CC would only be played by the Outputs - not learned, recorded, shown or launching
+	/// anything - so the audio routine can act on it at the sample it arrived at
+	bool mayActOnNoteOrCCInRender(MIDIDevice* fromDevice, bool isCC, int32_t channel, int32_t noteOrCC);
 	bool subModeAllowsRecording();
 
 	void songSelectReceived(uint8_t songId);
@@ -263,6 +266,7 @@ private:
 	bool startIgnoringMidiClockInputIfNecessary();
 	uint32_t setTempoFromAudioClipLength(uint64_t loopLengthSamples, Action* action);
 	bool offerNoteToLearnedThings(MIDIDevice* fromDevice, bool on, int32_t channel, int32_t note);
+	bool isLearnedToAnything(MIDIDevice* fromDevice, int32_t channel, int32_t note);
 	bool tryGlobalMIDICommands(MIDIDevice* device, int32_t channel, int32_t note);
 	bool tryGlobalMIDICommandsOff(MIDIDevice* device, int32_t channel, int32_t note);
 	void decideOnCurrentPlaybackMode();
@@ -36,13 +36,16 @@
 #include "memory/general_memory_allocator.h"
 #include "model/instrument/kit.h"
 #include "model/mod_controllable/mod_controllable_audio.h"
+#include "model/settings/runtime_feature_settings.h"
 #include "model/sample/sample_recorder.h"
 #include "model/song/song.h"
 #include "model/voice/voice.h"
+#include "model/voice/voice_priority_index.h"
 #include "model/voice/voice_sample.h"
 #include "model/voice/voice_vector.h"
 #include "modulation/patch/patch_cable_set.h"
 #include "processing/audio_output.h"
+#include "processing/engines/cpu_load_governor.h"
 #include "processing/engines/cv_engine.h"
 #include "processing/live/live_input_buffer.h"
 #include "processing/metronome/metronome.h"
@@ -166,6 +169,7 @@ int32_t numSamplesLastTime = 0;
 uint32_t nextVoiceState = 1;
 bool renderInStereo = true;
 bool bypassCulling = false;
+void (*routineWithClusterLoadingOverride)() = nullptr;
 bool audioRoutineLocked = false;
 uint32_t audioSampleTimer = 0;
 uint32_t i2sTXBufferPos;
@@ -179,6 +183,9 @@ bool routineBeenCalled;
 uint8_t numHopsEndedThisRoutineCall;
 
 VoiceVector activeVoices{};
+VoicePriorityIndex voicePriorities{};
+CpuLoadGovernor cpuLoadGovernor{};
+QualityTier qualityTier = QualityTier::FULL;
 
 LiveInputBuffer* liveInputBuffers[3];
 
@@ -238,6 +245,13 @@ void init() {
 		staticVoices[i].nextUnassigned = (i == kNumVoicesStatic - 1) ? NULL : &staticVoices[i + 1];
 	}
 
+	// Spares for when the static ones above run out mid-render. The refill task allocates them
+	RealtimeReserve& reserve = GeneralMemoryAllocator::get().realtimeReserve;
+	reserve.addClass(sizeof(Voice), 4);
+	reserve.addClass(sizeof(VoiceSample), 8);
+	reserve.addClass(sizeof(TimeStretcher), 4);
+	reserve.addClass(TimeStretch::kBufferSize * sizeof(int32_t) * 2, 2);
+
 	i2sTXBufferPos = (uint32_t)getTxBufferStart();
 
 	i2sRXBufferPos = (uint32_t)getRxBufferStart()
@@ -286,16 +300,24 @@ char audioLogStrings[AUDIO_LOG_SIZE][64];
 int32_t numAudioLogItems = 0;
 #endif
 
-// To be called when CPU is overloaded and we need to free it up. This stops the voice which has been
-// releasing longest, or if none, the voice playing longest.
-Voice* cullVoice(bool saveVoice, CullType type, size_t numSamples, Sound* stopFrom) {
-	// Only include audio if doing a hard cull and not saving the voice
-	bool includeAudio = !saveVoice && type == HARD;
-	// Skip releasing voices if doing a soft cull and definitely culling
-	bool skipReleasing = (type == SOFT_ALWAYS);
+// not in header (private to audio engine)
+/// The voice cullVoice() would pick: the one which has been releasing longest, or if none, the one playing longest.
+/// skipReleasing leaves out voices already being culled, and stopFrom limits the choice to one Sound's voices
+Voice* chooseVoiceToCull(bool skipReleasing, Sound* stopFrom) {
 	uint32_t bestRating = 0;
 	Voice* bestVoice = NULL;
-	for (int32_t v = 0; v < activeVoices.getNumElements(); v++) {
+
+	// Usually the index already knows. Culling one Sound's voices just looks at that Sound's
+	int32_t ends[2] = {0, activeVoices.getNumElements()};
+	if (stopFrom) {
+		activeVoices.getRangeForSound(stopFrom, ends);
+	}
+	else if (voicePriorities.isComplete()) {
+		ends[1] = 0;
+		bestVoice = voicePriorities.highest(skipReleasing);
+	}
+
+	for (int32_t v = ends[0]; v < ends[1]; v++) {
 		Voice* thisVoice = activeVoices.getVoice(v);
 
 		uint32_t ratingThisVoice = thisVoice->getPriorityRating();
@@ -305,14 +327,44 @@ Voice* cullVoice(bool saveVoice, CullType type, size_t numSamples, Sound* stopFr
 			if (!skipReleasing
 			    || (thisVoice->envelopes[0].state <= EnvelopeStage::FAST_RELEASE
 			        && thisVoice->envelopes[0].fastReleaseIncrement < SOFT_CULL_INCREMENT)) {
-				if (stopFrom == nullptr || thisVoice->assignedToSound == stopFrom) {
-					bestRating = ratingThisVoice;
-					bestVoice = thisVoice;
-				}
+				bestRating = ratingThisVoice;
+				bestVoice = thisVoice;
 			}
 		}
 	}
 
+	return bestVoice;
+}
+
+// not in header (private to audio engine)
+/// Fade a voice out quickly, unless it's already being culled
+void softCullVoice(Voice* voice, size_t numSamples) {
+	if (voice->envelopes[0].state < EnvelopeStage::FAST_RELEASE
+	    || voice->envelopes[0].fastReleaseIncrement < SOFT_CULL_INCREMENT) {
+		bool stillGoing = voice->doFastRelease(SOFT_CULL_INCREMENT);
+
+		if (!stillGoing) {
+			unassignVoice(voice, voice->assignedToSound);
+		}
+
+#if ALPHA_OR_BETA_VERSION
+		D_PRINTLN("soft-culled 1 voice.  numSamples:  %d. Voices left: %d. Audio clips left: %d", numSamples,
+		          getNumVoices(), getNumAudio());
+#if DO_AUDIO_LOG
+		dumpAudioLog();
+#endif
+#endif
+	}
+}
+
+// To be called when CPU is overloaded and we need to free it up. This stops the voice which has been
+// releasing longest, or if none, the voice playing longest.
+Voice* cullVoice(bool saveVoice, CullType type, size_t numSamples, Sound* stopFrom) {
+	// Only include audio if doing a hard cull and not saving the voice
+	bool includeAudio = !saveVoice && type == HARD;
+	// Skip releasing voices if doing a soft cull and definitely culling
+	Voice* bestVoice = chooseVoiceToCull(type == SOFT_ALWAYS, stopFrom);
+
 	if (bestVoice) {
 		activeVoices.checkVoiceExists(
 		    bestVoice, bestVoice->assignedToSound,
@@ -321,25 +373,9 @@ Voice* cullVoice(bool saveVoice, CullType type, size_t numSamples, Sound* stopFr
 
 		switch (type) {
 		case SOFT_ALWAYS:
-		case SOFT: {
-			if (bestVoice->envelopes[0].state < EnvelopeStage::FAST_RELEASE
-			    || bestVoice->envelopes[0].fastReleaseIncrement < SOFT_CULL_INCREMENT) {
-				bool stillGoing = bestVoice->doFastRelease(SOFT_CULL_INCREMENT);
-
-				if (!stillGoing) {
-					unassignVoice(bestVoice, bestVoice->assignedToSound);
-				}
-
-#if ALPHA_OR_BETA_VERSION
-				D_PRINTLN("soft-culled 1 voice.  numSamples:  %d. Voices left: %d. Audio clips left: %d", numSamples,
-				          getNumVoices(), getNumAudio());
-#if DO_AUDIO_LOG
-				dumpAudioLog();
-#endif
-#endif
-			}
+		case SOFT:
+			softCullVoice(bestVoice, numSamples);
 			break;
-		}
 
 		case FORCE: {
 			bool stillGoing = bestVoice->doImmediateRelease();
@@ -379,6 +415,11 @@ int32_t getNumVoices() {
 void routineWithClusterLoading(bool mayProcessUserActionsBetween) {
 	logAction("AudioDriver::routineWithClusterLoading");
 
+	if (routineWithClusterLoadingOverride) {
+		routineWithClusterLoadingOverride();
+		return;
+	}
+
 	routineBeenCalled = false;
 	audioFileManager.loadAnyEnqueuedClusters(128, mayProcessUserActionsBetween);
 	if (!routineBeenCalled) {
@@ -515,6 +556,94 @@ inline void setDireness(size_t numSamples) { // Consider direness and culling -
 	}
 }
 
+// not in header (private to audio engine)
+/// which of the CPU load governor's cost classes a Sound's voices are in
+inline uint32_t costClassOf(Sound* sound) {
+	return CpuLoadGovernor::classKey(util::to_underlying(sound->synthMode),
+	                                 util::to_underlying(sound->sources[0].oscType),
+	                                 util::to_underlying(sound->sources[1].oscType), util::to_underlying(sound->lpfMode),
+	                                 util::to_underlying(sound->hpfMode), sound->numUnison);
+}
+
+// not in header (private to audio engine)
+/// Predict the cost of what's about to be rendered. If a full window of it would reach direnessThreshold, raise
+/// cpuDireness now, and if it would go over numSamplesLimit, soft-cull voices until it wouldn't - rather than waiting
+/// for setDireness() to see a render overrun. setDireness() still catches anything the prediction missed.
+inline void governCpuLoad(size_t numSamples) {
+	cpuLoadGovernor.beginWindow();
+
+	// activeVoices is sorted by Sound, so each Sound's voices come in one run
+	Sound* sound = nullptr;
+	int32_t numVoices = 0;
+	int32_t numReleasing = 0;
+	for (int32_t v = 0; v < activeVoices.getNumElements(); v++) {
+		Voice* voice = activeVoices.getVoice(v);
+		if (voice->assignedToSound != sound) {
+			if (sound) {
+				cpuLoadGovernor.countVoices(costClassOf(sound), numVoices, numReleasing);
+			}
+			sound = voice->assignedToSound;
+			numVoices = 0;
+			numReleasing = 0;
+		}
+		numVoices++;
+		// already being culled, so it'll be gone in a few windows
+		numReleasing += (voice->envelopes[0].state > EnvelopeStage::FAST_RELEASE
+		                 || voice->envelopes[0].fastReleaseIncrement >= SOFT_CULL_INCREMENT);
+	}
+	if (sound) {
+		cpuLoadGovernor.countVoices(costClassOf(sound), numVoices, numReleasing);
+	}
+	int32_t numAudio = getNumAudio();
+	cpuLoadGovernor.countVoices(CpuLoadGovernor::kAudioClipClass, numAudio, 0);
+
+	float predicted = cpuLoadGovernor.predictSettled();
+	if (predicted >= direnessThreshold) {
+		int32_t newDireness = std::min<int32_t>((int32_t)predicted - (direnessThreshold - 1), 14);
+		if (newDireness > cpuDireness) {
+			cpuDireness = newDireness;
+			timeDirenessChanged = audioSampleTimer;
+			cpuLoadGovernor.noteDirenessRaised();
+		}
+	}
+
+	if (bypassCulling) {
+		return;
+	}
+	float limit = numSamplesLimit - cpuLoadGovernor.headroom();
+	while (cpuLoadGovernor.predictSettled() > limit && getNumVoices() + numAudio > MIN_VOICES) {
+		Voice* voice = chooseVoiceToCull(true, nullptr);
+		if (!voice) {
+			break;
+		}
+		cpuLoadGovernor.voiceShed(costClassOf(voice->assignedToSound));
+		softCullVoice(voice, numSamples);
+		logAction("predictive cull");
+	}
+}
+
+// not in header (private to audio engine)
+/// what voices render at this window - whatever cpuDireness calls for, unless the community setting holds one tier
+inline void updateQualityTier() {
+	uint32_t setting = runtimeFeatureSettings.get(RuntimeFeatureSettingType::QualityUnderLoad);
+	if (setting == RuntimeFeatureStateQualityUnderLoad::Auto) {
+		qualityTier = qualityTierForDireness(cpuDireness);
+	}
+	else {
+		qualityTier = static_cast<QualityTier>(std::min<int32_t>(setting - 1, kNumQualityTiers - 1));
+	}
+}
+
+void dumpCpuLoadTelemetry() {
+	const CpuLoadGovernor::Telemetry& telemetry = cpuLoadGovernor.telemetry();
+	D_PRINTLN("CPU load, in samples of time: last predicted %5.2f, actual %5.2f, mean error %5.2f", //<
+	          telemetry.lastPredicted, telemetry.lastActual, telemetry.meanAbsError);
+	D_PRINTLN("Windows: %lu, overruns: %lu, voices shed: %lu, direness raised: %lu, direness now: %d, quality tier: %d",
+	          telemetry.numWindows, telemetry.numOverruns, telemetry.numVoicesShed, telemetry.numDirenessRaises,
+	          cpuDireness, util::to_underlying(qualityTier));
+	cpuLoadGovernor.resetTelemetry();
+}
+
 void scheduleMidiGateOutISR(uint32_t saddrPosAtStart, int32_t unadjustedNumSamplesBeforeLappingPlayHead,
                             int32_t timeWithinWindowAtWhichMIDIOrGateOccurs);
 void setMonitoringMode();
@@ -581,7 +710,12 @@ void renderAudioForStemExport(size_t numSamples);
 	tickSongFinalizeWindows(numSamples, timeWithinWindowAtWhichMIDIOrGateOccurs);
 
 	numSamplesLastTime = numSamples;
+	governCpuLoad(numSamples);
+	updateQualityTier();
+
+	double renderStartTime = getSystemTime();
 	renderAudio(numSamples);
+	cpuLoadGovernor.learn(numSamples, (getSystemTime() - renderStartTime) * kSampleRate);
 
 	scheduleMidiGateOutISR(saddrPosAtStart, unadjustedNumSamplesBeforeLappingPlayHead,
 	                       timeWithinWindowAtWhichMIDIOrGateOccurs);
@@ -694,6 +828,12 @@ void flushMIDIGateBuffers() { // Flush everything out of the MIDI buffer now. At
 void tickSongFinalizeWindows(size_t& numSamples, int32_t& timeWithinWindowAtWhichMIDIOrGateOccurs) {
 	timeWithinWindowAtWhichMIDIOrGateOccurs = -1; // -1 means none
 
+	// Any received notes and CCs due now or, for CCs, during this window, and stop the window where the next note is
+	midiEngine.takeQueuedInput(numSamples);
+	if (midiEngine.anythingInOutputBuffer() || cvEngine.isAnythingButRunPending()) { // MIDI thru, or MIDI / CV outputs
+		timeWithinWindowAtWhichMIDIOrGateOccurs = 0;
+	}
+
 	// If a timer-tick is due during or directly after this window of audio samples...
 	if (playbackHandler.isEitherClockActive()) {
 
@@ -1029,6 +1169,14 @@ int32_t getNumSamplesLeftToOutputFromPreviousRender() {
 	return ((uint32_t)renderingBufferOutputEnd - (uint32_t)renderingBufferOutputPos) >> 3;
 }
 
+uint32_t getTimeDMANextReaches(uint32_t dmaPos) {
+	// The 40 here is a fine-tuned amount to stop everything wrapping wrong when CPU load heavy. 28 to 98 seemed to work
+	// correctly
+	uint32_t timeTil = (((uint32_t)(dmaPos - i2sTXBufferPos) >> (2 + NUM_MONO_OUTPUT_CHANNELS_MAGNITUDE)) + 40)
+	                   & (SSI_TX_BUFFER_NUM_SAMPLES - 1);
+	return audioSampleTimer + timeTil;
+}
+
 // Returns whether we got to the end
 bool doSomeOutputting() {
 
@@ -1368,7 +1516,7 @@ Voice* solicitVoice(Sound* forSound) {
 
 	else {
 
-		void* memory = GeneralMemoryAllocator::get().allocMaxSpeed(sizeof(Voice));
+		void* memory = GeneralMemoryAllocator::get().allocRealtime(sizeof(Voice));
 		if (!memory) {
 			if (activeVoices.getNumElements()) {
 				memory = cullVoice(true, HARD, numSamplesLastTime, forSound);
@@ -1394,6 +1542,7 @@ Voice* solicitVoice(Sound* forSound) {
 		disposeOfVoice(newVoice);
 		return NULL;
 	}
+	newVoice->priorityIndexSlot = voicePriorities.add(newVoice);
 
 	if (forSound->numVoicesAssigned >= forSound->maxVoiceCount) {
 		cullVoice(false, SOFT_ALWAYS, numSamplesLastTime, forSound);
@@ -1409,6 +1558,8 @@ void unassignVoice(Voice* voice, Sound* sound, ModelStackWithSoundFlags* modelSt
 
 	activeVoices.checkVoiceExists(voice, sound, "E195");
 
+	voicePriorities.remove(voice->priorityIndexSlot);
+	voice->priorityIndexSlot = VoicePriorityIndex::kNotIndexed;
 	voice->setAsUnassigned(modelStack ? modelStack->addVoice(voice) : nullptr);
 	if (removeFromVector) {
 		uint32_t keyWords[2];
@@ -1439,7 +1590,7 @@ VoiceSample* solicitVoiceSample() {
 		return toReturn;
 	}
 	else {
-		void* memory = GeneralMemoryAllocator::get().allocMaxSpeed(sizeof(VoiceSample));
+		void* memory = GeneralMemoryAllocator::get().allocRealtime(sizeof(VoiceSample));
 		if (!memory) {
 			return NULL;
 		}
@@ -1467,7 +1618,7 @@ TimeStretcher* solicitTimeStretcher() {
 	}
 
 	else {
-		void* memory = GeneralMemoryAllocator::get().allocMaxSpeed(sizeof(TimeStretcher));
+		void* memory = GeneralMemoryAllocator::get().allocRealtime(sizeof(TimeStretcher));
 		if (!memory) {
 			return NULL;
 		}
@@ -21,6 +21,7 @@
 #include "dsp/compressor/rms_feedback.h"
 #include "dsp/envelope_follower/absolute_value.h"
 #include "model/output.h"
+#include "processing/engines/quality_tier.h"
 #include <cstdint>
 
 extern "C" {
@@ -40,6 +41,7 @@ class TimeStretcher;
 class String;
 class SideChain;
 class VoiceVector;
+class VoicePriorityIndex;
 class Freeverb;
 class Metronome;
 class RMSFeedbackCompressor;
@@ -159,6 +161,10 @@ void slowRoutine();
 void doRecorderCardRoutines();
 
 int32_t getNumSamplesLeftToOutputFromPreviousRender();
+/// The audioSampleTimer value the SSI DMA will be outputting when it next gets round to dmaPos, as read from it when
+/// something arrived. Acting on things then keeps them all the same time - about a buffer's length - after they
+/// arrived, however long the routine took to get to them, as long as that was less than a buffer's length
+uint32_t getTimeDMANextReaches(uint32_t dmaPos);
 
 void registerSideChainHit(int32_t strength);
 
@@ -181,6 +187,9 @@ int32_t getNumVoices();
 bool doSomeOutputting();
 void updateReverbParams();
 
+/// print the CPU load governor's predicted and actual render times and how often it's stepped in, then reset them
+void dumpCpuLoadTelemetry();
+
 extern bool headphonesPluggedIn;
 extern bool micPluggedIn;
 extern bool lineInPluggedIn;
@@ -188,15 +197,20 @@ extern bool renderInStereo;
 extern uint32_t audioSampleTimer;
 extern bool mustUpdateReverbParamsBeforeNextRender;
 extern bool bypassCulling;
+// If set, routineWithClusterLoading() calls this instead. For card work done from a task, which can hand over to the
+// task scheduler so everything else carries on as normal - culling included - rather than just the audio
+extern void (*routineWithClusterLoadingOverride)();
 extern uint32_t i2sTXBufferPos;
 extern uint32_t i2sRXBufferPos;
 extern int32_t cpuDireness;
+extern QualityTier qualityTier;
 extern InputMonitoringMode inputMonitoringMode;
 extern bool audioRoutineLocked;
 extern uint8_t numHopsEndedThisRoutineCall;
 extern SideChain reverbSidechain;
 extern uint32_t timeThereWasLastSomeReverb;
 extern VoiceVector activeVoices;
+extern VoicePriorityIndex voicePriorities;
 extern deluge::dsp::Reverb reverb;
 extern uint32_t nextVoiceState;
 extern SoundDrum* sampleForPreview;
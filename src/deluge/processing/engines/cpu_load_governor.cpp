@@ -0,0 +1,153 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "processing/engines/cpu_load_governor.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// How far each render moves the costs towards explaining it. Render times are noisy - interrupts land in some windows
+// and not others - so this is kept low and the costs settle over a few hundred windows
+constexpr float kLearningRate = 0.05f;
+// meanAbsError averages over roughly this many windows
+constexpr float kErrorSmoothing = 1.f / 64;
+} // namespace
+
+CpuLoadGovernor::CpuLoadGovernor() {
+	clear();
+}
+
+void CpuLoadGovernor::clear() {
+	for (CostClass& costClass : classes_) {
+		costClass = {0, kDefaultVoiceCost, 0, 0, false};
+	}
+	overhead_ = 0;
+	base_ = 0;
+	windowNumber_ = 0;
+	releasingCost_ = 0;
+	shedCost_ = 0;
+	meanAbsError_ = 0;
+	telemetry_ = {};
+}
+
+void CpuLoadGovernor::beginWindow() {
+	windowNumber_++;
+	for (CostClass& costClass : classes_) {
+		costClass.numVoices = 0;
+	}
+	releasingCost_ = 0;
+	shedCost_ = 0;
+}
+
+int32_t CpuLoadGovernor::find(uint32_t key) const {
+	for (int32_t i = 0; i < kMaxCostClasses; i++) {
+		if (classes_[i].used && classes_[i].key == key) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// When the table's full, the class that's gone longest without voices makes way. A class seen again later starts over
+// from kDefaultVoiceCost, which only costs a few windows of learning
+int32_t CpuLoadGovernor::findOrAdd(uint32_t key) {
+	int32_t found = find(key);
+	if (found >= 0) {
+		return found;
+	}
+	int32_t replace = -1;
+	for (int32_t i = 0; i < kMaxCostClasses; i++) {
+		if (!classes_[i].used) {
+			replace = i;
+			break;
+		}
+		if (classes_[i].numVoices == 0
+		    && (replace < 0 || (int32_t)(classes_[i].lastWindow - classes_[replace].lastWindow) < 0)) {
+			replace = i;
+		}
+	}
+	// Every class has voices this window, which would take 32 different Sounds. Lump this one in with the last class
+	// rather than forget one that's in use
+	if (replace < 0) {
+		return kMaxCostClasses - 1;
+	}
+	classes_[replace] = {key, kDefaultVoiceCost, 0, windowNumber_, true};
+	return replace;
+}
+
+void CpuLoadGovernor::countVoices(uint32_t key, int32_t numVoices, int32_t numReleasing) {
+	if (numVoices <= 0) {
+		return;
+	}
+	CostClass& costClass = classes_[findOrAdd(key)];
+	costClass.numVoices += numVoices;
+	costClass.lastWindow = windowNumber_;
+	releasingCost_ += numReleasing * costClass.cost;
+}
+
+float CpuLoadGovernor::predict(int32_t numSamples) const {
+	float perFullWindow = base_;
+	for (const CostClass& costClass : classes_) {
+		perFullWindow += costClass.numVoices * costClass.cost;
+	}
+	return overhead_ + perFullWindow * numSamples / kFullWindow;
+}
+
+float CpuLoadGovernor::voiceCost(uint32_t key) const {
+	int32_t i = find(key);
+	return (i >= 0) ? classes_[i].cost : kDefaultVoiceCost;
+}
+
+void CpuLoadGovernor::voiceShed(uint32_t key) {
+	shedCost_ += voiceCost(key);
+	telemetry_.numVoicesShed++;
+}
+
+void CpuLoadGovernor::learn(int32_t numSamples, float actualTime) {
+	if (numSamples <= 0) {
+		return;
+	}
+	float predicted = predict(numSamples);
+	float error = actualTime - predicted;
+
+	telemetry_.lastPredicted = predicted;
+	telemetry_.lastActual = actualTime;
+	meanAbsError_ += (std::abs(error) - meanAbsError_) * kErrorSmoothing;
+	telemetry_.meanAbsError = meanAbsError_;
+	telemetry_.numWindows++;
+	if (actualTime > numSamples) {
+		telemetry_.numOverruns++;
+	}
+
+	// Normalised LMS. The inputs are 1 for the overhead, the fraction of a full window for the base, and that times
+	// the number of voices for each class
+	float fraction = (float)numSamples / kFullWindow;
+	float norm = 1 + fraction * fraction;
+	for (const CostClass& costClass : classes_) {
+		float input = costClass.numVoices * fraction;
+		norm += input * input;
+	}
+	float step = kLearningRate * error / norm;
+
+	overhead_ = std::max(overhead_ + step, 0.f);
+	base_ = std::max(base_ + step * fraction, 0.f);
+	for (CostClass& costClass : classes_) {
+		if (costClass.numVoices) {
+			costClass.cost = std::max(costClass.cost + step * costClass.numVoices * fraction, 0.f);
+		}
+	}
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/*
+ * Predicts how long the next audio window will take to render, so AudioEngine can cull voices and lower quality
+ * before a window overruns rather than after.
+ *
+ * Voices are grouped into cost classes - everything about a Sound that changes how expensive each of its voices is
+ * to render: synth mode, oscillator types, filter modes and unison. The model is
+ *
+ *     render time = overhead + (base + sum over classes of numVoices * classCost) * numSamples / kFullWindow
+ *
+ * with every cost in samples of time (i.e. seconds * kSampleRate) for a full window, so a prediction compares
+ * directly with numSamplesLimit. After each render, learn() nudges the costs of the classes that were playing
+ * towards whatever the render actually took (normalised LMS), so the model picks up on whatever's in the song
+ * without anyone having to measure each oscillator type up front.
+ *
+ * Each window, AudioEngine calls beginWindow(), then countVoices() for each Sound with voices (and once for audio
+ * clips), then asks for predictions, then renders and calls learn() with how long that took.
+ */
+class CpuLoadGovernor {
+public:
+	static constexpr int32_t kMaxCostClasses = 32;
+	static constexpr int32_t kFullWindow = 128;
+	/// Audio clips aren't Sounds, but they're counted as a class of their own
+	static constexpr uint32_t kAudioClipClass = 0xFFFFFFFF;
+	/// What a class is assumed to cost before anything's been learned about it
+	static constexpr float kDefaultVoiceCost = 1.5f;
+	/// headroom() is this many times the average prediction error
+	static constexpr float kHeadroomErrors = 2;
+
+	/// Pack the things that decide a voice's render cost into a class key. All arguments are enum values
+	static constexpr uint32_t classKey(uint32_t synthMode, uint32_t oscType0, uint32_t oscType1, uint32_t lpfMode,
+	                                   uint32_t hpfMode, uint32_t numUnison) {
+		return synthMode | (oscType0 << 4) | (oscType1 << 8) | (lpfMode << 12) | (hpfMode << 16) | (numUnison << 20);
+	}
+
+	struct Telemetry {
+		/// The last window's prediction and how long it really took, in samples of time
+		float lastPredicted = 0;
+		float lastActual = 0;
+		/// Running average of |predicted - actual|
+		float meanAbsError = 0;
+		uint32_t numWindows = 0;
+		/// Windows whose render took longer than the window itself, so the output buffer fell behind
+		uint32_t numOverruns = 0;
+		/// Voices culled, and cpuDireness raises, because of a prediction rather than an overrun
+		uint32_t numVoicesShed = 0;
+		uint32_t numDirenessRaises = 0;
+	};
+
+	CpuLoadGovernor();
+
+	/// Forget this window's counts, ready for countVoices()
+	void beginWindow();
+	/// numVoices voices of a class are playing, numReleasing of which are already being culled
+	void countVoices(uint32_t key, int32_t numVoices, int32_t numReleasing);
+
+	/// Render time for a window of numSamples with the voices counted, in samples of time
+	[[nodiscard]] float predict(int32_t numSamples) const;
+	/// What a full window would cost once the voices already being culled have gone
+	[[nodiscard]] float predictSettled() const { return predict(kFullWindow) - releasingCost_ - shedCost_; }
+	/// How far under the limit to keep predictSettled(), to allow for how far out the predictions have been lately
+	[[nodiscard]] float headroom() const { return kHeadroomErrors * meanAbsError_; }
+	/// What one voice of a class costs in a full window
+	[[nodiscard]] float voiceCost(uint32_t key) const;
+	/// A voice of this class is being culled, so predictSettled() can stop counting it
+	void voiceShed(uint32_t key);
+
+	/// The window predict(numSamples) was asked about took actualTime samples of time to render
+	void learn(int32_t numSamples, float actualTime);
+
+	[[nodiscard]] const Telemetry& telemetry() const { return telemetry_; }
+	void noteDirenessRaised() { telemetry_.numDirenessRaises++; }
+	void resetTelemetry() { telemetry_ = {}; }
+
+	void clear();
+
+private:
+	struct CostClass {
+		uint32_t key;
+		float cost;
+		int32_t numVoices;
+		/// beginWindow() count when this class last had voices, for picking which to forget when the table's full
+		uint32_t lastWindow;
+		bool used;
+	};
+
+	[[nodiscard]] int32_t find(uint32_t key) const;
+	int32_t findOrAdd(uint32_t key);
+
+	std::array<CostClass, kMaxCostClasses> classes_;
+	float overhead_;
+	float base_;
+
+	uint32_t windowNumber_;
+	float releasingCost_;
+	float shedCost_;
+	float meanAbsError_;
+
+	Telemetry telemetry_;
+};
@@ -0,0 +1,85 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/// What voices give up to render faster once the CPU load gets dire, before anything has to be culled. Each tier
+/// includes the savings of the ones before it. AudioEngine picks one from cpuDireness each window, unless the
+/// "Quality under load" community setting pins it.
+enum class QualityTier : uint8_t {
+	/// Everything rendered as designed. cpuDireness still makes its own small savings, like crude saws for low notes
+	FULL,
+	/// Samples are interpolated linearly instead of with the kInterpolationMaxNumSamples-tap windowed sinc
+	LINEAR_SAMPLES,
+	/// Oscillators (not samples) render only the outer pair of unison parts and every other one inwards from there
+	FEWER_UNISON,
+	/// Voices which have released down to inaudible skip their FilterSet
+	NO_RELEASE_FILTERS,
+	/// Oscillators read the band-limited table meant for an octave up, which has half the harmonics and is smaller
+	SMALL_TABLES,
+};
+constexpr int32_t kNumQualityTiers = static_cast<int32_t>(QualityTier::SMALL_TABLES) + 1;
+
+/// The tier for a cpuDireness, which runs from 0 to 14
+constexpr QualityTier qualityTierForDireness(int32_t cpuDireness) {
+	if (cpuDireness >= 13) {
+		return QualityTier::SMALL_TABLES;
+	}
+	if (cpuDireness >= 11) {
+		return QualityTier::NO_RELEASE_FILTERS;
+	}
+	if (cpuDireness >= 8) {
+		return QualityTier::FEWER_UNISON;
+	}
+	if (cpuDireness >= 4) {
+		return QualityTier::LINEAR_SAMPLES;
+	}
+	return QualityTier::FULL;
+}
+
+/// Whether FEWER_UNISON leaves out unison part u. Parts are counted in from both ends, so the spread stays symmetric
+/// and as wide as ever, and 2 parts are both kept
+constexpr bool unisonPartSkippedUnderLoad(int32_t u, int32_t numUnison) {
+	return std::min(u, numUnison - 1 - u) & 1;
+}
+
+constexpr int32_t numUnisonPartsRenderedUnderLoad(int32_t numUnison) {
+	int32_t numRendered = 0;
+	for (int32_t u = 0; u < numUnison; u++) {
+		numRendered += !unisonPartSkippedUnderLoad(u, numUnison);
+	}
+	return numRendered;
+}
+
+/// Gain, in 16.16 fixed point, for the unison parts FEWER_UNISON renders, so together they're as loud as all of them
+/// were. Unison parts are detuned, so they add up by power
+inline int32_t unisonGainUnderLoad(int32_t numUnison) {
+	return (int32_t)(std::sqrt((float)numUnison / numUnisonPartsRenderedUnderLoad(numUnison)) * 65536 + 0.5f);
+}
+
+/// Amplitude envelope level under which NO_RELEASE_FILTERS counts a releasing voice as inaudible - about -48dB, which
+/// with the default release curve is the last seventh or so of the release
+constexpr int32_t kInaudibleReleaseLevel = 1 << 23;
+
+/// What SMALL_TABLES does to the phase increment a band-limited table gets chosen by
+constexpr uint32_t phaseIncrementForTableUnderLoad(uint32_t phaseIncrement) {
+	return (phaseIncrement >= 0x80000000u) ? phaseIncrement : phaseIncrement << 1;
+}
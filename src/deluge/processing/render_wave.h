@@ -15,6 +15,7 @@
  * If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "arm_neon_shim.h"
 #include "processing/vector_rendering_function.h"
 
 #define setupAmplitudeVector(i)                                                                                        \
@@ -1316,7 +1316,7 @@ Error Sound::readTagFromFile(Deserializer& reader, char const* tagName, ParamMan
 		}
 		else if (readTagFromFile(reader, tagName)) {}
 		else {
-			result = smDeserializer.tryReadingFirmwareTagFromFile(tagName);
+			result = reader.tryReadingFirmwareTagFromFile(tagName);
 			if (result != Error::NONE && result != Error::RESULT_TAG_UNUSED) {
 				return result;
 			}
@@ -1641,6 +1641,7 @@ justUnassign:
 			numVoicesAssigned++;
 			reassessRenderSkippingStatus(
 			    modelStack); // Since we potentially just changed numVoicesAssigned from 0 to 1.
+			voiceCountChanged();
 
 			newVoice->randomizeOscPhases(this);
 		}
@@ -2343,6 +2344,10 @@ void Sound::render(ModelStackWithThreeMainThings* modelStack, StereoSample* outp
 				v--;
 				ends[1]--;
 			}
+			else {
+				// the envelopes may have moved on a stage
+				thisVoice->updatePriorityIndex();
+			}
 		}
 
 		// If just rendered in mono, double that up to stereo now
@@ -2868,6 +2873,22 @@ void Sound::voiceUnassigned(ModelStackWithVoice* modelStack) {
 
 	numVoicesAssigned--;
 	reassessRenderSkippingStatus(modelStack);
+	voiceCountChanged();
+}
+
+void Sound::voiceCountChanged() {
+	// Voice::getPriorityRating() only counts up to 7 voices
+	if (numVoicesAssigned < 8) {
+		updateVoicePriorities();
+	}
+}
+
+void Sound::updateVoicePriorities() {
+	int32_t ends[2];
+	AudioEngine::activeVoices.getRangeForSound(this, ends);
+	for (int32_t v = ends[0]; v < ends[1]; v++) {
+		AudioEngine::activeVoices.getVoice(v)->updatePriorityIndex();
+	}
 }
 
 // modelStack may be NULL if no voices currently active
@@ -197,6 +197,8 @@ public:
 	bool allowNoteTails(ModelStackWithSoundFlags* modelStack, bool disregardSampleLoop = false);
 
 	void voiceUnassigned(ModelStackWithVoice* modelStack);
+	/// Refresh AudioEngine::voicePriorities for all this Sound's voices, e.g. after voicePriority changes
+	void updateVoicePriorities();
 	bool isSourceActiveCurrently(int32_t s, ParamManagerForTimeline* paramManager);
 	bool isSourceActiveEverDisregardingMissingSample(int32_t s, ParamManager* paramManager);
 	bool isSourceActiveEver(int32_t s, ParamManager* paramManager);
@@ -290,6 +292,7 @@ public:
 
 private:
 	uint32_t getGlobalLFOPhaseIncrement();
+	void voiceCountChanged();
 	void recalculateModulatorTransposer(uint8_t m, ModelStackWithSoundFlags* modelStack);
 	void setupUnisonDetuners(ModelStackWithSoundFlags* modelStack);
 	void setupUnisonStereoSpread();
@@ -519,6 +519,7 @@ bool SoundInstrument::noteIsOn(int32_t noteCode, bool resetTimeEntered) {
 		    && thisVoice->envelopes[0].state < EnvelopeStage::RELEASE) { // Ignore releasing notes. Is this right?
 			if (resetTimeEntered) {
 				thisVoice->envelopes[0].resetTimeEntered();
+				thisVoice->updatePriorityIndex();
 			}
 			return true;
 		}
@@ -27,10 +27,12 @@
 #include "model/sample/sample.h"
 #include "model/sample/sample_cache.h"
 #include "model/sample/sample_reader.h"
+#include "model/settings/runtime_feature_settings.h"
 #include "model/song/song.h"
 #include "playback/playback_handler.h"
 #include "processing/engines/audio_engine.h"
 #include "storage/cluster/cluster.h"
+#include "storage/cluster/cluster_read_batch.h"
 #include "storage/storage_manager.h"
 #include "storage/wave_table/wave_table.h"
 #include "storage/wave_table/wave_table_reader.h"
@@ -51,6 +53,8 @@ LBA_t clst2sect(           /* !=0:Sector number, 0:Failed (invalid cluster#) */
 );
 
 DRESULT disk_read_without_streaming_first(BYTE pdrv, BYTE* buff, DWORD sector, UINT count);
+DRESULT disk_read_scattered_without_streaming_first(BYTE pdrv, BYTE* const* buffs, UINT sectorsPerBuff, LBA_t sector,
+                                                    UINT count);
 
 extern uint8_t currentlyAccessingCard;
 }
@@ -99,10 +103,14 @@ void AudioFileManager::init() {
 	clusterSizeAtBoot = clusterSize;
 
 	clusterObjectSize = sizeof(Cluster) + clusterSize;
+
+	// For SampleCaches being written while rendering
+	GeneralMemoryAllocator::get().realtimeReserve.addClass(clusterObjectSize, 2, true);
 }
 
 void AudioFileManager::setClusterSize(uint32_t newSize) {
 	clusterSize = newSize;
+	readAhead.setClusterSize(newSize);
 	clusterSizeMagnitude = 9;
 	while ((clusterSize >> clusterSizeMagnitude) > 1) {
 		clusterSizeMagnitude++;
@@ -949,9 +957,12 @@ void AudioFileManager::testQueue() {
 }
 
 // Caller must initialize() the Cluster after getting it from this function
-Cluster* AudioFileManager::allocateCluster(ClusterType type, bool shouldAddReasons, void* dontStealFromThing) {
+Cluster* AudioFileManager::allocateCluster(ClusterType type, bool shouldAddReasons, void* dontStealFromThing,
+                                           bool fromAudioRoutine) {
 	cardReadOnce = true; // even if it hasn't been we're now commited to the cluster size
-	void* clusterMemory = GeneralMemoryAllocator::get().allocStealable(clusterObjectSize, dontStealFromThing);
+	void* clusterMemory =
+	    fromAudioRoutine ? GeneralMemoryAllocator::get().allocRealtime(clusterObjectSize, true, dontStealFromThing)
+	                     : GeneralMemoryAllocator::get().allocStealable(clusterObjectSize, dontStealFromThing);
 	if (!clusterMemory) {
 		return NULL;
 	}
@@ -975,6 +986,13 @@ void AudioFileManager::deallocateCluster(Cluster* cluster) {
 #define REPORT_LOAD_TIME 0
 
 bool AudioFileManager::loadCluster(Cluster* cluster, int32_t minNumReasonsAfter) {
+	return loadClusters(&cluster, 1, minNumReasonsAfter);
+}
+
+// Reads numClusters of a Sample's Clusters, consecutive in the file and on the card and given in file order, in one go.
+// minNumReasonsAfter applies to clusters[0], which is the only one anyone calls this for with more than one reason.
+bool AudioFileManager::loadClusters(Cluster** clusters, int32_t numClusters, int32_t minNumReasonsAfter) {
+	Cluster* cluster = clusters[0];
 
 	if (currentlyAccessingCard) {
 		return false; // Could happen if we're trying to render a waveform but we're actually already inside the SD
@@ -1009,24 +1027,30 @@ bool AudioFileManager::loadCluster(Cluster* cluster, int32_t minNumReasonsAfter)
 	}
 #endif
 
-	addReasonToCluster(cluster); // So that it can't accidentally hit 0 reasons while we're loading it, cos then it
-	                             // might get deallocated.
+	// So that none can accidentally hit 0 reasons while we're loading them, cos then they might get deallocated.
+	for (int32_t c = 0; c < numClusters; c++) {
+		addReasonToCluster(clusters[c]);
+	}
 
 	if (false) {
 getOutEarly:
 		clusterBeingLoaded = NULL;
-		removeReasonFromCluster(cluster, "E033");
+		for (int32_t c = 0; c < numClusters; c++) {
+			removeReasonFromCluster(clusters[c], "E033");
+		}
 		return false;
 	}
 
 	int32_t clusterIndex = cluster->clusterIndex;
+	int32_t sectorsPerCluster = clusterSize >> 9;
 
-	int32_t numSectors = clusterSize >> 9;
+	// Only the last one can be short of a full Cluster
+	int32_t numSectors = sectorsPerCluster;
 
 	// If this is the last Cluster, and we do know what the audio data length is...
 	if (sample->audioDataLengthBytes && sample->audioDataLengthBytes != 0x8FFFFFFFFFFFFFFF) {
 		uint32_t audioDataEndPosBytes = sample->audioDataLengthBytes + sample->audioDataStartPosBytes;
-		uint32_t startByteThisCluster = clusterIndex << clusterSizeMagnitude;
+		uint32_t startByteThisCluster = (clusterIndex + numClusters - 1) << clusterSizeMagnitude;
 		int32_t bytesToRead = audioDataEndPosBytes - startByteThisCluster;
 		if (bytesToRead <= 0) {
 			D_PRINTLN("fail thing"); // Shouldn't really still happen
@@ -1060,8 +1084,19 @@ getOutEarly:
 	}
 #endif
 
-	DRESULT result = disk_read_without_streaming_first(
-	    SD_PORT, (BYTE*)cluster->data, sample->clusters.getElement(cluster->clusterIndex)->sdAddress, numSectors);
+	DRESULT result;
+	uint32_t sdAddress = sample->clusters.getElement(cluster->clusterIndex)->sdAddress;
+	if (numClusters == 1) {
+		result = disk_read_without_streaming_first(SD_PORT, (BYTE*)cluster->data, sdAddress, numSectors);
+	}
+	else {
+		BYTE* buffs[kMaxClustersPerRead];
+		for (int32_t c = 0; c < numClusters; c++) {
+			buffs[c] = (BYTE*)clusters[c]->data;
+		}
+		result = disk_read_scattered_without_streaming_first(SD_PORT, buffs, sectorsPerCluster, sdAddress,
+		                                                     (numClusters - 1) * sectorsPerCluster + numSectors);
+	}
 
 #if REPORT_LOAD_TIME
 	uint16_t endTime = MTU2.TCNT_0;
@@ -1090,7 +1125,9 @@ getOutEarly:
 		goto getOutEarly;
 	}
 
-	cluster->convertDataIfNecessary();
+	for (int32_t c = 0; c < numClusters; c++) {
+		finishLoadingCluster(clusters[c]);
+	}
 
 #if ALPHA_OR_BETA_VERSION
 	if (cluster->numReasonsToBeLoaded < minNumReasonsAfter + 1) {
@@ -1098,6 +1135,31 @@ getOutEarly:
 	}
 #endif
 
+	clusterBeingLoaded = NULL;
+	for (int32_t c = 0; c < numClusters; c++) {
+		removeReasonFromCluster(clusters[c], "E034");
+	}
+
+#if ALPHA_OR_BETA_VERSION
+	if (cluster->numReasonsToBeLoaded < minNumReasonsAfter) {
+		FREEZE_WITH_ERROR("i037");
+	}
+	if (cluster->sample->clusters.getElement(cluster->clusterIndex)->cluster != cluster) {
+		FREEZE_WITH_ERROR("E438");
+	}
+#endif
+
+	return true;
+}
+
+// Converts a freshly read Cluster's data, shares the bytes overhanging its ends with its neighbours, whichever of them
+// are already loaded, and takes in its waveform peak
+void AudioFileManager::finishLoadingCluster(Cluster* cluster) {
+	Sample* sample = cluster->sample;
+	int32_t clusterIndex = cluster->clusterIndex;
+
+	cluster->convertDataIfNecessary();
+
 	int32_t misalignment = sample->audioDataStartPosBytes & 0b11;
 
 	// Give extra bytes to previous Cluster
@@ -1281,19 +1343,11 @@ copy7ToMe:
 
 	cluster->loaded = true;
 
-	clusterBeingLoaded = NULL;
-	removeReasonFromCluster(cluster, "E034");
-
-#if ALPHA_OR_BETA_VERSION
-	if (cluster->numReasonsToBeLoaded < minNumReasonsAfter) {
-		FREEZE_WITH_ERROR("i037");
+	// While it's here anyway, so the waveform never has to load it again just to be drawn
+	WaveformPeaks& peaks = sample->peaks;
+	if (peaks.isSetUp() && clusterIndex < peaks.getNumClusters() && !peaks.isKnown(clusterIndex)) {
+		sample->findPeaksInCluster(cluster, clusterSize);
 	}
-	if (cluster->sample->clusters.getElement(cluster->clusterIndex)->cluster != cluster) {
-		FREEZE_WITH_ERROR("E438");
-	}
-#endif
-
-	return true;
 }
 
 // Only needs calling a couple times per second. Must be called outside of the audio / SD-reading routine
@@ -1370,7 +1424,8 @@ performActionsAndGetOut:
 			playbackHandler.slowRoutine();
 		}
 
-		Cluster* cluster = loadingQueue.grabHead();
+		uint32_t priorityRating;
+		Cluster* cluster = loadingQueue.grabHead(&priorityRating);
 		if (!cluster) {
 			break;
 		}
@@ -1382,36 +1437,55 @@ performActionsAndGetOut:
 			FREEZE_WITH_ERROR("E235"); // Cos Chris F got an E205
 		}
 
+		Cluster* batch[kMaxClustersPerRead];
+		uint32_t batchPriorityRatings[kMaxClustersPerRead];
+		int32_t numInBatch = takeClustersToReadWith(cluster, priorityRating, batch, batchPriorityRatings);
+
+		uint32_t timeLoadStarted = AudioEngine::audioSampleTimer;
 		allowSomeUserActionsEvenWhenInCardRoutine = true; // Sorry!!
-		bool success = loadCluster(cluster);
+		bool success = loadClusters(batch, numInBatch);
 		allowSomeUserActionsEvenWhenInCardRoutine = false;
 
+		// The read ahead plans a Cluster at a time, so a batch counts as that many loads of its average time
+		if (success) {
+			readAhead.noteLoadTime((AudioEngine::audioSampleTimer - timeLoadStarted) / numInBatch);
+		}
+
 		// If that didn't work, presumably because the SD card got ejected...
 		if (!success) {
 			D_PRINTLN("load Cluster fail");
 
-			// If the Cluster is now down to 0 reasons (i.e. it lost a reason while being loaded), then it's already
-			// been made "available" and we don't have a problem
-			if (!cluster->numReasonsToBeLoaded) {}
+			bool anyRequeued = false;
+			for (int32_t c = 0; c < numInBatch; c++) {
 
-			// Otherwise, there are still "reasons" waiting for this Cluster to become loaded, so we need to put it
-			// back in the loading queue. Presumably it won't actually get loaded for a while - only when the user
-			// re-inserts the card
-			else {
+				// If the Cluster is now down to 0 reasons (i.e. it lost a reason while being loaded), then it's
+				// already been made "available" and we don't have a problem
+				if (!batch[c]->numReasonsToBeLoaded) {}
 
-				if (cluster->type != ClusterType::Sample) {
-					FREEZE_WITH_ERROR("E237"); // Cos Chris F got an E205
-				}
+				// Otherwise, there are still "reasons" waiting for this Cluster to become loaded, so we need to put it
+				// back in the loading queue. Presumably it won't actually get loaded for a while - only when the user
+				// re-inserts the card
+				else {
+
+					if (batch[c]->type != ClusterType::Sample) {
+						FREEZE_WITH_ERROR("E237"); // Cos Chris F got an E205
+					}
 
-				enqueueCluster(cluster); // TODO: If that fails, it'll just get awkwardly forgotten about
+					// Keeping the deadline it was queued with. TODO: If that fails, it'll just get awkwardly
+					// forgotten about
+					enqueueCluster(batch[c], batchPriorityRatings[c]);
+					anyRequeued = true;
+				}
+			}
 
-				// Also, return now. Normally we stay here til there's nothing left in the load-queue, but now that
-				// would leave us in an infinite loop!
+			// Also, return now. Normally we stay here til there's nothing left in the load-queue, but now that would
+			// leave us in an infinite loop!
+			if (anyRequeued) {
 				break;
 			}
 		}
 
-		count++;
+		count += numInBatch;
 		if (count >= maxNum) {
 			break; // Keep things sane?
 		}
@@ -1422,6 +1496,43 @@ performActionsAndGetOut:
 #endif
 }
 
+// Takes any of cluster's neighbours in the file which are also waiting to be loaded, and straight after it on the card,
+// out of the loading queue, so they can all be read in one go. Puts the lot in batch, in file order, with the priority
+// ratings they were queued with in batchPriorityRatings, and returns how many. They'd be needed soon enough anyway, and
+// reading them now is much quicker than reading them one at a time later. Unless the Batched Card Reads setting is on,
+// cluster is read on its own, as the scattered read hasn't been proven on hardware yet.
+int32_t AudioFileManager::takeClustersToReadWith(Cluster* cluster, uint32_t priorityRating, Cluster** batch,
+                                                 uint32_t* batchPriorityRatings) {
+	if (!runtimeFeatureSettings.isOn(RuntimeFeatureSettingType::BatchedCardReads)) {
+		batch[0] = cluster;
+		batchPriorityRatings[0] = priorityRating;
+		return 1;
+	}
+
+	Sample* sample = cluster->sample;
+	// By how far each Cluster is from cluster in the file, which is less than kMaxClustersPerRead either way
+	uint32_t priorityRatings[kMaxClustersPerRead * 2];
+	auto priorityRatingOf = [&](int32_t i) -> uint32_t& {
+		return priorityRatings[i - cluster->clusterIndex + kMaxClustersPerRead];
+	};
+	priorityRatingOf(cluster->clusterIndex) = priorityRating;
+
+	ClusterReadBatch readBatch = growClusterReadBatch(
+	    cluster->clusterIndex, sample->clusters.getNumElements(), clusterSize >> 9,
+	    [sample](int32_t i) { return sample->clusters.getElement(i)->sdAddress; },
+	    [&](int32_t i) {
+		    Cluster* neighbour = sample->clusters.getElement(i)->cluster;
+		    return neighbour && !neighbour->loaded && loadingQueue.removeIfPresent(neighbour, &priorityRatingOf(i));
+	    });
+
+	for (int32_t c = 0; c < readBatch.numClusters; c++) {
+		int32_t i = readBatch.firstClusterIndex + c;
+		batch[c] = sample->clusters.getElement(i)->cluster;
+		batchPriorityRatings[c] = priorityRatingOf(i);
+	}
+	return readBatch.numClusters;
+}
+
 // Currently there's no risk of trying to enqueue a cluster multiple times, because this function only gets called
 // after it's freshly allocated
 Error AudioFileManager::enqueueCluster(Cluster* cluster, uint32_t priorityRating) {
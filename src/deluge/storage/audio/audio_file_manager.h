@@ -19,6 +19,7 @@
 #include "definitions_cxx.hpp"
 #include "storage/audio/audio_file_vector.h"
 #include "storage/cluster/cluster_priority_queue.h"
+#include "storage/cluster/cluster_read_ahead.h"
 #include <cstdint>
 #include <stdint.h>
 
@@ -88,10 +89,12 @@ public:
 	void init();
 	AudioFile* getAudioFileFromFilename(String* fileName, bool mayReadCard, Error* error, FilePointer* filePointer,
 	                                    AudioFileType type, bool makeWaveTableWorkAtAllCosts = false);
+	// Pass fromAudioRoutine when rendering, so the allocation is bounded - see GeneralMemoryAllocator::allocRealtime()
 	Cluster* allocateCluster(ClusterType type = ClusterType::Sample, bool shouldAddReasons = true,
-	                         void* dontStealFromThing = NULL);
+	                         void* dontStealFromThing = NULL, bool fromAudioRoutine = false);
 	Error enqueueCluster(Cluster* cluster, uint32_t priorityRating = 0xFFFFFFFF);
 	bool loadCluster(Cluster* cluster, int32_t minNumReasonsAfter = 0);
+	bool loadClusters(Cluster** clusters, int32_t numClusters, int32_t minNumReasonsAfter = 0);
 	void loadAnyEnqueuedClusters(int32_t maxNum = 128, bool mayProcessUserActionsBetween = false);
 	void addReasonToCluster(Cluster* cluster);
 	void removeReasonFromCluster(Cluster* cluster, char const* errorCode, bool deletingSong = false);
@@ -118,6 +121,8 @@ public:
 	void thingFinishedLoading();
 
 	ClusterPriorityQueue loadingQueue;
+	/// How far ahead sample play-heads enqueue Clusters, learned from how long the ones in loadingQueue take to load
+	ClusterReadAhead readAhead;
 
 	uint32_t clusterSize{32768};
 	uint32_t clusterSizeAtBoot{0};
@@ -149,6 +154,9 @@ private:
 	                  uint32_t* currentClusterIndex, uint32_t fileSize, Sample* sample);
 	int32_t loadAiff(Sample* newSample, uint32_t fileSize, Cluster** currentCluster, uint32_t* currentClusterIndex);
 	int32_t loadWav(Sample* newSample, uint32_t fileSize, Cluster** currentCluster, uint32_t* currentClusterIndex);
+	void finishLoadingCluster(Cluster* cluster);
+	int32_t takeClustersToReadWith(Cluster* cluster, uint32_t priorityRating, Cluster** batch,
+	                               uint32_t* batchPriorityRatings);
 };
 
 extern AudioFileManager audioFileManager;
@@ -0,0 +1,1517 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "storage/binary_serializer.h"
+#include "drivers/pic/pic.h"
+#include "gui/ui_timer_manager.h"
+#include "hid/display/display.h"
+#include "memory/general_memory_allocator.h"
+#include "processing/engines/audio_engine.h"
+#include "storage/audio/audio_file_manager.h"
+#include "util/d_string.h"
+#include <algorithm>
+#include <string.h>
+
+extern "C" {
+#include "RZA1/oled/oled_low_level.h"
+#include "fatfs/ff.h"
+}
+
+using namespace binary_file;
+
+BinarySerializer smBinarySerializer;
+BinaryDeserializer smBinaryDeserializer;
+
+namespace {
+
+constexpr int32_t kNumNameSlots = 1024; // Twice kMaxNames, so probes stay short
+
+char const upperHexChars[] = "0123456789ABCDEF";
+char const lowerHexChars[] = "0123456789abcdef";
+
+int32_t hexCharToNibble(char thisChar) {
+	if (thisChar >= '0' && thisChar <= '9') {
+		return thisChar - '0';
+	}
+	if (thisChar >= 'A' && thisChar <= 'F') {
+		return thisChar - 'A' + 10;
+	}
+	if (thisChar >= 'a' && thisChar <= 'f') {
+		return thisChar - 'a' + 10;
+	}
+	return -1;
+}
+
+bool isWhitespace(char thisChar) {
+	return thisChar == ' ' || thisChar == '\r' || thisChar == '\n' || thisChar == '\t';
+}
+
+// Whether value is exactly the text intToString() would give for some int32_t, which goes in *number
+bool isCanonicalInt(char const* value, int32_t length, int32_t* number) {
+	if (length < 1 || length > 11) {
+		return false;
+	}
+	bool isNegative = (value[0] == '-');
+	int64_t result = 0;
+	for (int32_t i = isNegative; i < length; i++) {
+		if (value[i] < '0' || value[i] > '9') {
+			return false;
+		}
+		result = result * 10 + (value[i] - '0');
+	}
+	if (isNegative) {
+		result = -result;
+	}
+	if (result < INT32_MIN || result > INT32_MAX) {
+		return false;
+	}
+	char buffer[12];
+	intToString((int32_t)result, buffer);
+	if ((int32_t)strlen(buffer) != length || memcmp(buffer, value, length)) {
+		return false; // Leading zeros, "-0", a lone "-"...
+	}
+	*number = (int32_t)result;
+	return true;
+}
+
+// Whether value is "0x" and 1 to 8 uppercase hex digits, the way writeAttributeHex() writes them
+bool isHexNumber(char const* value, int32_t length, int32_t* number) {
+	if (length < 3 || length > 10 || value[0] != '0' || value[1] != 'x') {
+		return false;
+	}
+	uint32_t result = 0;
+	for (int32_t i = 2; i < length; i++) {
+		int32_t nibble = hexCharToNibble(value[i]);
+		if (nibble < 0 || value[i] >= 'a') {
+			return false;
+		}
+		result = (result << 4) | nibble;
+	}
+	*number = (int32_t)result;
+	return true;
+}
+
+// Whether value is a run of hex bytes worth storing as bytes: optionally "0x", then an even number of hex digits,
+// letters all the one case
+bool isHexBytes(char const* value, int32_t length, uint8_t* flags) {
+	*flags = 0;
+	if (length >= 2 && value[0] == '0' && value[1] == 'x') {
+		*flags |= kHexBytesPrefixed;
+		value += 2;
+		length -= 2;
+	}
+	if (length < 16 || (length & 1)) {
+		return false;
+	}
+	bool seenUpper = false;
+	bool seenLower = false;
+	for (int32_t i = 0; i < length; i++) {
+		if (hexCharToNibble(value[i]) < 0) {
+			return false;
+		}
+		seenUpper |= (value[i] >= 'A' && value[i] <= 'F');
+		seenLower |= (value[i] >= 'a');
+	}
+	if (seenUpper && seenLower) {
+		return false;
+	}
+	if (seenLower) {
+		*flags |= kHexBytesLowercase;
+	}
+	return true;
+}
+
+// What the XML reader's readTagOrAttributeValueInt() makes of some text
+int32_t intFromValueText(char const* text) {
+	bool isNegative = (*text == '-');
+	if (isNegative) {
+		text++;
+	}
+	uint32_t number = 0;
+	while (*text >= '0' && *text <= '9') {
+		number = number * 10 + (*text - '0');
+		text++;
+	}
+	if (isNegative) {
+		return (number >= 2147483648) ? -2147483648 : -(int32_t)number;
+	}
+	return number;
+}
+
+} // namespace
+
+/*******************************************************************************
+
+    BinarySerializer
+
+********************************************************************************/
+
+BinarySerializer::BinarySerializer()
+    : fileWriteBufferCurrentPos(0), fileTotalBytesWritten(0), fileAccessFailedDuringWrite(false),
+      encodingFailed(false), numNames(0), namePoolUsed(0), rawState(RawState::BETWEEN_TAGS),
+      valueState(ValueState::NONE) {
+	void* temp = GeneralMemoryAllocator::get().allocLowSpeed(32768 + CACHE_LINE_SIZE * 2);
+	writeClusterBuffer = (char*)temp + CACHE_LINE_SIZE;
+
+	namePool = (char*)GeneralMemoryAllocator::get().allocLowSpeed(kNamePoolSize);
+	nameStarts = (uint16_t*)GeneralMemoryAllocator::get().allocLowSpeed(kMaxNames * sizeof(uint16_t));
+	nameSlots = (int16_t*)GeneralMemoryAllocator::get().allocLowSpeed(kNumNameSlots * sizeof(int16_t));
+}
+
+BinarySerializer::~BinarySerializer() {
+	GeneralMemoryAllocator::get().dealloc(writeClusterBuffer - CACHE_LINE_SIZE);
+	GeneralMemoryAllocator::get().dealloc(namePool);
+	GeneralMemoryAllocator::get().dealloc(nameStarts);
+	GeneralMemoryAllocator::get().dealloc(nameSlots);
+}
+
+Error BinarySerializer::createFile(char const* path, BinaryFileSource source) {
+	FRESULT result = f_open(&file, path, FA_WRITE | FA_CREATE_ALWAYS);
+	if (result != FR_OK) {
+		return fresultToDelugeErrorCode(result);
+	}
+
+	fileWriteBufferCurrentPos = 0;
+	fileTotalBytesWritten = 0;
+	fileAccessFailedDuringWrite = false;
+	encodingFailed = false;
+	numNames = 0;
+	namePoolUsed = 0;
+	memset(nameSlots, 0, kNumNameSlots * sizeof(int16_t));
+	rawState = RawState::BETWEEN_TAGS;
+	valueState = ValueState::NONE;
+
+	uint8_t header[kBinaryFileHeaderSize];
+	memcpy(header, kBinaryFileMagic, 4);
+	header[4] = kBinaryFileVersion;
+	for (int32_t i = 0; i < 4; i++) {
+		header[5 + i] = source.size >> (i * 8);
+		header[9 + i] = source.timestamp >> (i * 8);
+		header[13 + i] = source.saveToken >> (i * 8);
+	}
+	writeBytes(header, kBinaryFileHeaderSize);
+	return Error::NONE;
+}
+
+void BinarySerializer::abandonFile(char const* path) {
+	f_close(&file);
+	f_unlink(path);
+}
+
+Error BinarySerializer::writeBufferToFile() {
+	UINT bytesWritten;
+	FRESULT result = f_write(&file, writeClusterBuffer, fileWriteBufferCurrentPos, &bytesWritten);
+	if (result != FR_OK || bytesWritten != (UINT)fileWriteBufferCurrentPos) {
+		return Error::SD_CARD;
+	}
+
+	fileTotalBytesWritten += fileWriteBufferCurrentPos;
+
+	return Error::NONE;
+}
+
+void BinarySerializer::writeBytes(void const* data, int32_t numBytes) {
+	uint8_t const* bytes = (uint8_t const*)data;
+
+	while (numBytes) {
+		if (fileWriteBufferCurrentPos == (int32_t)audioFileManager.clusterSize) {
+			if (!fileAccessFailedDuringWrite) {
+				Error error = writeBufferToFile();
+				if (error != Error::NONE) {
+					fileAccessFailedDuringWrite = true;
+					return;
+				}
+			}
+
+			fileWriteBufferCurrentPos = 0;
+		}
+
+		int32_t numBytesNow =
+		    std::min<int32_t>(numBytes, audioFileManager.clusterSize - fileWriteBufferCurrentPos);
+		memcpy(&writeClusterBuffer[fileWriteBufferCurrentPos], bytes, numBytesNow);
+		bytes += numBytesNow;
+		numBytes -= numBytesNow;
+		int32_t posBefore = fileWriteBufferCurrentPos;
+		fileWriteBufferCurrentPos += numBytesNow;
+
+		// Ensure we do some of the audio routine once in a while
+		if ((posBefore >> 8) != (fileWriteBufferCurrentPos >> 8)) {
+			AudioEngine::logAction("writeBinary");
+
+			uiTimerManager.routine();
+
+			if (display->haveOLED()) {
+				oledRoutine();
+			}
+			PIC::flush();
+		}
+	}
+}
+
+void BinarySerializer::writeByte(uint8_t byte) {
+	writeBytes(&byte, 1);
+}
+
+void BinarySerializer::writeVarint(uint32_t number) {
+	uint8_t bytes[5];
+	int32_t numBytes = 0;
+	while (number >= 0x80) {
+		bytes[numBytes++] = (number & 0x7F) | 0x80;
+		number >>= 7;
+	}
+	bytes[numBytes++] = number;
+	writeBytes(bytes, numBytes);
+}
+
+void BinarySerializer::writeName(char const* name) {
+	int32_t length = strlen(name);
+	if (length >= (int32_t)kFilenameBufferSize) {
+		encodingFailed = true; // Longer than any reader could hand back
+		return;
+	}
+
+	uint32_t hash = 2166136261u;
+	for (int32_t i = 0; i < length; i++) {
+		hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+	}
+
+	int32_t slot = hash & (kNumNameSlots - 1);
+	while (nameSlots[slot]) {
+		int32_t index = nameSlots[slot] - 1;
+		if (!strcmp(&namePool[nameStarts[index]], name)) {
+			writeVarint(index + 1);
+			return;
+		}
+		slot = (slot + 1) & (kNumNameSlots - 1);
+	}
+
+	writeVarint(0);
+	writeVarint(length);
+	writeBytes(name, length);
+
+	// BinaryDeserializer::readName() makes exactly the same decision
+	if (numNames < kMaxNames && namePoolUsed + length + 1 <= kNamePoolSize) {
+		memcpy(&namePool[namePoolUsed], name, length + 1);
+		nameStarts[numNames] = namePoolUsed;
+		namePoolUsed += length + 1;
+		numNames++;
+		nameSlots[slot] = numNames;
+	}
+}
+
+void BinarySerializer::writeHexBytesRun(uint8_t const* data, int32_t numBytes) {
+	writeVarint(numBytes);
+	writeBytes(data, numBytes);
+}
+
+void BinarySerializer::writeValue(char const* value, int32_t length) {
+	int32_t number;
+	uint8_t flags;
+
+	if (isCanonicalInt(value, length, &number)) {
+		writeByte(INT);
+		writeVarint(((uint32_t)number << 1) ^ (uint32_t)(number >> 31));
+	}
+	else if (isHexNumber(value, length, &number)) {
+		writeByte(HEX);
+		writeByte(length - 2);
+		writeVarint(number);
+	}
+	else if (isHexBytes(value, length, &flags)) {
+		writeByte(HEX_BYTES);
+		writeByte(flags);
+		char const* hexChars = (flags & kHexBytesPrefixed) ? value + 2 : value;
+		int32_t numBytes = (length - (hexChars - value)) >> 1;
+		hexBytesRunLength = 0;
+		for (int32_t i = 0; i < numBytes; i++) {
+			hexBytesRun[hexBytesRunLength++] =
+			    (hexCharToNibble(hexChars[i * 2]) << 4) | hexCharToNibble(hexChars[i * 2 + 1]);
+			if (hexBytesRunLength == kMaxHexBytesRun) {
+				writeHexBytesRun(hexBytesRun, hexBytesRunLength);
+				hexBytesRunLength = 0;
+			}
+		}
+		if (hexBytesRunLength) {
+			writeHexBytesRun(hexBytesRun, hexBytesRunLength);
+		}
+		writeVarint(0);
+	}
+	else if (length <= kMaxStringLength) {
+		writeByte(STRING);
+		writeVarint(length);
+		writeBytes(value, length);
+		writeByte(0);
+	}
+	else {
+		encodingFailed = true;
+	}
+}
+
+void BinarySerializer::writeAttribute(char const* name, int32_t number, bool onNewLine) {
+	writeByte(ATTRIBUTE);
+	writeName(name);
+	writeByte(INT);
+	writeVarint(((uint32_t)number << 1) ^ (uint32_t)(number >> 31));
+}
+
+void BinarySerializer::writeAttribute(char const* name, char const* value, bool onNewLine) {
+	writeByte(ATTRIBUTE);
+	writeName(name);
+	writeValue(value, strlen(value));
+}
+
+// numChars may be up to 8
+void BinarySerializer::writeAttributeHex(char const* name, int32_t number, int32_t numChars, bool onNewLine) {
+	writeByte(ATTRIBUTE);
+	writeName(name);
+	writeByte(HEX);
+	writeByte(numChars);
+	// Just the digits that get written out
+	writeVarint((numChars >= 8) ? (uint32_t)number : (uint32_t)number & ((1u << (numChars * 4)) - 1));
+}
+
+void BinarySerializer::writeAttributeHexBytes(char const* name, uint8_t* data, int32_t numBytes, bool onNewLine) {
+	writeByte(ATTRIBUTE);
+	writeName(name);
+	writeByte(HEX_BYTES);
+	writeByte(0);
+	while (numBytes) {
+		int32_t numBytesNow = std::min<int32_t>(numBytes, kMaxHexBytesRun);
+		writeHexBytesRun(data, numBytesNow);
+		data += numBytesNow;
+		numBytes -= numBytesNow;
+	}
+	writeVarint(0);
+}
+
+void BinarySerializer::writeTag(char const* tag, int32_t number) {
+	writeOpeningTagBeginning(tag);
+	writeByte(CONTENT);
+	writeByte(INT);
+	writeVarint(((uint32_t)number << 1) ^ (uint32_t)(number >> 31));
+	writeClosingTag(tag);
+}
+
+void BinarySerializer::writeTag(char const* tag, char const* contents) {
+	writeOpeningTagBeginning(tag);
+	if (*contents) {
+		writeByte(CONTENT);
+		writeValue(contents, strlen(contents));
+	}
+	writeClosingTag(tag);
+}
+
+void BinarySerializer::writeOpeningTag(char const* tag, bool startNewLineAfter) {
+	writeOpeningTagBeginning(tag);
+	writeOpeningTagEnd(startNewLineAfter);
+}
+
+void BinarySerializer::writeOpeningTagBeginning(char const* tag) {
+	finishRawContent();
+	writeByte(OPEN);
+	writeName(tag);
+	rawState = RawState::IN_TAG;
+}
+
+void BinarySerializer::writeOpeningTagEnd(bool startNewLineAfter) {
+	rawState = RawState::IN_CONTENT;
+}
+
+void BinarySerializer::closeTag() {
+	writeByte(CLOSE);
+	rawState = RawState::BETWEEN_TAGS;
+}
+
+void BinarySerializer::writeClosingTag(char const* tag, bool shouldPrintIndents) {
+	finishRawContent();
+	writeByte(CLOSE);
+	rawState = RawState::BETWEEN_TAGS;
+}
+
+void BinarySerializer::finishRawContent() {
+	if (rawState == RawState::IN_CONTENT) {
+		endValue();
+	}
+}
+
+void BinarySerializer::write(char const* output) {
+	while (*output) {
+		char thisChar = *output;
+
+		switch (rawState) {
+		case RawState::BETWEEN_TAGS:
+			break;
+
+		case RawState::IN_TAG:
+			if (!isWhitespace(thisChar)) {
+				rawName[0] = thisChar;
+				rawNameLength = 1;
+				rawState = RawState::IN_ATTRIBUTE_NAME;
+			}
+			break;
+
+		case RawState::IN_ATTRIBUTE_NAME:
+			if (thisChar == '=' || isWhitespace(thisChar)) {
+				rawName[rawNameLength] = 0;
+				rawState = RawState::PAST_ATTRIBUTE_NAME;
+			}
+			else if (rawNameLength < (int32_t)kFilenameBufferSize - 1) {
+				rawName[rawNameLength++] = thisChar;
+			}
+			else {
+				encodingFailed = true;
+			}
+			break;
+
+		case RawState::PAST_ATTRIBUTE_NAME:
+			if (thisChar == '"' || thisChar == '\'') {
+				rawQuote = thisChar;
+				beginAttributeValue(rawName);
+				rawState = RawState::IN_ATTRIBUTE_VALUE;
+			}
+			break;
+
+		case RawState::IN_ATTRIBUTE_VALUE: {
+			char const* valueEnd = strchr(output, rawQuote);
+			int32_t numChars = valueEnd ? valueEnd - output : strlen(output);
+			appendValueChars(output, numChars);
+			output += numChars;
+			if (valueEnd) {
+				endValue();
+				rawState = RawState::IN_TAG;
+				break;
+			}
+			continue;
+		}
+
+		case RawState::IN_CONTENT: {
+			if (valueState == ValueState::NONE) {
+				beginContent();
+			}
+			int32_t numChars = strlen(output);
+			appendValueChars(output, numChars);
+			output += numChars;
+			continue;
+		}
+		}
+
+		output++;
+	}
+}
+
+void BinarySerializer::beginAttributeValue(char const* name) {
+	writeByte(ATTRIBUTE);
+	writeName(name);
+	valueState = ValueState::ATTRIBUTE;
+	numValueChars = 0;
+}
+
+void BinarySerializer::beginContent() {
+	valueState = ValueState::CONTENT;
+	numValueChars = 0;
+}
+
+void BinarySerializer::appendValueChars(char const* chars, int32_t numChars) {
+	if (valueState == ValueState::CONTENT && !numValueChars) {
+		while (numChars && isWhitespace(*chars)) {
+			chars++;
+			numChars--;
+		}
+	}
+
+	if (valueState == ValueState::STREAMING_HEX_BYTES) {
+		for (int32_t i = 0; i < numChars; i++) {
+			streamHexChar(chars[i]);
+		}
+		return;
+	}
+
+	if (numValueChars + numChars <= kMaxStringLength) {
+		memcpy(&valueChars[numValueChars], chars, numChars);
+		numValueChars += numChars;
+		return;
+	}
+
+	// Too long to be anything but hex bytes, which can be written as they come
+	if (!startStreamingHexBytes()) {
+		encodingFailed = true;
+		valueState = ValueState::NONE;
+		return;
+	}
+	for (int32_t i = 0; i < numChars; i++) {
+		streamHexChar(chars[i]);
+	}
+}
+
+bool BinarySerializer::startStreamingHexBytes() {
+	uint8_t flags = 0;
+	int32_t start = 0;
+	if (numValueChars >= 2 && valueChars[0] == '0' && valueChars[1] == 'x') {
+		flags |= kHexBytesPrefixed;
+		start = 2;
+	}
+	bool seenUpper = false;
+	bool seenLower = false;
+	for (int32_t i = start; i < numValueChars; i++) {
+		if (hexCharToNibble(valueChars[i]) < 0) {
+			return false;
+		}
+		seenUpper |= (valueChars[i] >= 'A' && valueChars[i] <= 'F');
+		seenLower |= (valueChars[i] >= 'a');
+	}
+	if (seenUpper && seenLower) {
+		return false;
+	}
+	// If there've been no letters yet, they'd better be uppercase when they come
+	hexBytesLowercase = seenLower;
+	if (hexBytesLowercase) {
+		flags |= kHexBytesLowercase;
+	}
+
+	if (valueState == ValueState::CONTENT) {
+		writeByte(CONTENT);
+	}
+	writeByte(HEX_BYTES);
+	writeByte(flags);
+	valueState = ValueState::STREAMING_HEX_BYTES;
+	hexBytesRunLength = 0;
+	highNibble = -1;
+	for (int32_t i = start; i < numValueChars; i++) {
+		streamHexChar(valueChars[i]);
+	}
+	return true;
+}
+
+void BinarySerializer::streamHexChar(char thisChar) {
+	int32_t nibble = hexCharToNibble(thisChar);
+	if (nibble < 0 || (nibble >= 10 && (thisChar >= 'a') != hexBytesLowercase)) {
+		encodingFailed = true;
+		return;
+	}
+
+	if (highNibble < 0) {
+		highNibble = nibble;
+		return;
+	}
+
+	hexBytesRun[hexBytesRunLength++] = (highNibble << 4) | nibble;
+	highNibble = -1;
+	if (hexBytesRunLength == kMaxHexBytesRun) {
+		writeHexBytesRun(hexBytesRun, hexBytesRunLength);
+		hexBytesRunLength = 0;
+	}
+}
+
+void BinarySerializer::endValue() {
+	switch (valueState) {
+	case ValueState::NONE:
+		return;
+
+	case ValueState::ATTRIBUTE:
+		writeValue(valueChars, numValueChars);
+		break;
+
+	case ValueState::CONTENT:
+		if (numValueChars) {
+			writeByte(CONTENT);
+			writeValue(valueChars, numValueChars);
+		}
+		break;
+
+	case ValueState::STREAMING_HEX_BYTES:
+		if (highNibble >= 0) {
+			encodingFailed = true; // An odd number of digits
+		}
+		if (hexBytesRunLength) {
+			writeHexBytesRun(hexBytesRun, hexBytesRunLength);
+		}
+		writeVarint(0);
+		break;
+	}
+
+	valueState = ValueState::NONE;
+}
+
+// Returns false if some error, including error while writing
+Error BinarySerializer::closeFileAfterWriting(char const* path, char const* beginningString, char const* endString) {
+	if (fileAccessFailedDuringWrite) {
+		return Error::WRITE_FAIL; // As with XML - if access has failed, we don't want f_close flushing anything
+	}
+	if (encodingFailed) {
+		f_close(&file);
+		return Error::FILE_UNSUPPORTED;
+	}
+	Error error = writeBufferToFile();
+	if (error != Error::NONE) {
+		return Error::WRITE_FAIL;
+	}
+
+	FRESULT result = f_close(&file);
+	if (result) {
+		return Error::WRITE_FAIL;
+	}
+
+	if (path) {
+		FILINFO fileInfo;
+		result = f_stat(path, &fileInfo);
+		if (result || fileInfo.fsize != fileTotalBytesWritten) {
+			return Error::WRITE_FAIL;
+		}
+	}
+
+	return Error::NONE;
+}
+
+/*******************************************************************************
+
+    BinaryDeserializer
+
+********************************************************************************/
+
+BinaryDeserializer::BinaryDeserializer() : msd(NULL), fileAccessFailedDuring(false), readCount(0) {
+	void* temp = GeneralMemoryAllocator::get().allocLowSpeed(kReadSpillSize + 32768 + CACHE_LINE_SIZE * 2);
+	buffer = (uint8_t*)temp + CACHE_LINE_SIZE;
+
+	namePool = (char*)GeneralMemoryAllocator::get().allocLowSpeed(kNamePoolSize);
+	names = (char const**)GeneralMemoryAllocator::get().allocLowSpeed(kMaxNames * sizeof(char const*));
+
+	startReadingFile();
+}
+
+BinaryDeserializer::~BinaryDeserializer() {
+	GeneralMemoryAllocator::get().dealloc(buffer - CACHE_LINE_SIZE);
+	GeneralMemoryAllocator::get().dealloc(namePool);
+	GeneralMemoryAllocator::get().dealloc(names);
+}
+
+void BinaryDeserializer::startReadingFile() {
+	bufferPos = kReadSpillSize;
+	bufferEnd = kReadSpillSize;
+	fileEnded = false;
+	reachedEnd = false;
+	fileAccessFailedDuring = false;
+	numNames = 0;
+	namePoolUsed = 0;
+	tagDepthFile = 0;
+	tagDepthCaller = 0;
+	pending = Pending::NOTHING;
+}
+
+// Makes sure the next numBytes, up to kReadSpillSize, are in the buffer in one piece. Whatever's left of the last
+// Cluster goes into the spill area just in front of where the next one's read to
+bool BinaryDeserializer::ensureBytes(int32_t numBytes) {
+	if (bufferEnd - bufferPos >= numBytes) {
+		return true;
+	}
+	if (fileEnded) {
+		return false;
+	}
+
+	int32_t numBytesLeft = bufferEnd - bufferPos;
+	memmove(&buffer[kReadSpillSize - numBytesLeft], &buffer[bufferPos], numBytesLeft);
+	bufferPos = kReadSpillSize - numBytesLeft;
+
+	AudioEngine::logAction("readBinaryFileCluster");
+
+	UINT numBytesRead;
+	FRESULT result =
+	    f_read(&fileSystemStuff.currentFile, &buffer[kReadSpillSize], audioFileManager.clusterSize, &numBytesRead);
+	if (result) {
+		fileAccessFailedDuring = true;
+		numBytesRead = 0;
+	}
+	bufferEnd = kReadSpillSize + numBytesRead;
+	if (numBytesRead < audioFileManager.clusterSize) {
+		fileEnded = true;
+	}
+
+	return bufferEnd - bufferPos >= numBytes;
+}
+
+void BinaryDeserializer::stopReading() {
+	bufferPos = bufferEnd;
+	fileEnded = true;
+	reachedEnd = true;
+}
+
+bool BinaryDeserializer::readByte(uint8_t* byte) {
+	if (bufferPos == bufferEnd && !ensureBytes(1)) {
+		return false;
+	}
+	*byte = buffer[bufferPos++];
+	return true;
+}
+
+bool BinaryDeserializer::readVarint(uint32_t* number) {
+	uint32_t result = 0;
+	for (int32_t shift = 0; shift < 35; shift += 7) {
+		uint8_t byte;
+		if (!readByte(&byte)) {
+			return false;
+		}
+		result |= (uint32_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			*number = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Returns NULL if the file's corrupted
+char const* BinaryDeserializer::readName() {
+	uint32_t index;
+	if (!readVarint(&index)) {
+		return NULL;
+	}
+	if (index) {
+		return (index <= (uint32_t)numNames) ? names[index - 1] : NULL;
+	}
+
+	uint32_t length;
+	if (!readVarint(&length) || length >= kFilenameBufferSize || !ensureBytes(length)) {
+		return NULL;
+	}
+	char const* chars = (char const*)&buffer[bufferPos];
+	bufferPos += length;
+
+	// BinarySerializer::writeName() makes exactly the same decision
+	if (numNames < kMaxNames && namePoolUsed + length + 1 <= kNamePoolSize) {
+		char* name = &namePool[namePoolUsed];
+		memcpy(name, chars, length);
+		name[length] = 0;
+		namePoolUsed += length + 1;
+		names[numNames++] = name;
+		return name;
+	}
+
+	memcpy(stringBuffer, chars, length);
+	stringBuffer[length] = 0;
+	return stringBuffer;
+}
+
+void BinaryDeserializer::readDone() {
+	readCount++; // Increment first, cos we don't want to call SD routine immediately when it's 0
+
+	if (!(readCount & 63)) {
+		AudioEngine::routineWithClusterLoading();
+
+		uiTimerManager.routine();
+
+		if (display->haveOLED()) {
+			oledRoutine();
+		}
+		PIC::flush();
+	}
+}
+
+char const* BinaryDeserializer::readNextTagOrAttributeName() {
+	if (pending != Pending::NOTHING) {
+		if (pending == Pending::ATTRIBUTE_VALUE) {
+			skipValue();
+			tagDepthFile--;
+		}
+		else {
+			finishValue();
+		}
+		pending = Pending::NOTHING;
+	}
+
+	char const* toReturn = "";
+
+	while (!reachedEnd) {
+		uint8_t opcode;
+		if (!readByte(&opcode)) {
+			reachedEnd = true;
+			break;
+		}
+
+		if (opcode == OPEN || opcode == ATTRIBUTE) {
+			toReturn = readName();
+			if (!toReturn) {
+				reachedEnd = true;
+				toReturn = "";
+				break;
+			}
+			tagDepthFile++;
+			if (opcode == ATTRIBUTE) {
+				pending = Pending::ATTRIBUTE_VALUE;
+			}
+			break;
+		}
+		else if (opcode == CONTENT) {
+			skipValue(); // Content nobody asked for before moving on, as with XML
+		}
+		else if (opcode == CLOSE) {
+			tagDepthFile--;
+			break;
+		}
+		else {
+			reachedEnd = true;
+		}
+	}
+
+	if (*toReturn) {
+		tagDepthCaller++;
+		AudioEngine::logAction(toReturn);
+	}
+
+	readDone();
+	return toReturn;
+}
+
+// A tag's content only counts if it's the very next thing
+bool BinaryDeserializer::openValue() {
+	if (pending == Pending::ATTRIBUTE_VALUE) {
+		pending = Pending::NOTHING;
+		tagDepthFile--;
+	}
+	else if (pending == Pending::NOTHING && ensureBytes(1) && buffer[bufferPos] == CONTENT) {
+		bufferPos++;
+	}
+	else {
+		if (pending == Pending::VALUE_CHARS) {
+			finishValue();
+			pending = Pending::NOTHING;
+		}
+		return false;
+	}
+
+	return readValueHeader();
+}
+
+bool BinaryDeserializer::readValueHeader() {
+	uint32_t number;
+	uint8_t flags;
+
+	if (!readByte(&valueType)) {
+		goto corrupted;
+	}
+
+	switch (valueType) {
+	case INT:
+		if (!readVarint(&number)) {
+			goto corrupted;
+		}
+		valueNumber = (int32_t)((number >> 1) ^ -(number & 1));
+		valueText = NULL;
+		return true;
+
+	case HEX:
+		if (!readByte(&flags) || !flags || flags > 8 || !readVarint(&number)) {
+			goto corrupted;
+		}
+		valueNumChars = flags;
+		valueNumber = number;
+		valueText = NULL;
+		return true;
+
+	case STRING:
+		if (!readVarint(&number) || number > kMaxStringLength || !ensureBytes(number + 1)) {
+			goto corrupted;
+		}
+		valueText = (char const*)&buffer[bufferPos];
+		valueTextLength = number;
+		bufferPos += number + 1;
+		return true;
+
+	case HEX_BYTES:
+		if (!readByte(&flags)) {
+			goto corrupted;
+		}
+		valuePrefixLeft = (flags & kHexBytesPrefixed) ? 2 : 0;
+		valueHexChars = (flags & kHexBytesLowercase) ? lowerHexChars : upperHexChars;
+		valueRunLeft = 0;
+		valueLowNibble = -1;
+		valueRunsEnded = false;
+		return true;
+	}
+
+corrupted:
+	reachedEnd = true;
+	return false;
+}
+
+bool BinaryDeserializer::loadNextRun() {
+	if (valueRunsEnded) {
+		return false;
+	}
+	uint32_t numBytes;
+	if (!readVarint(&numBytes) || !numBytes) {
+		valueRunsEnded = true;
+		return false;
+	}
+	if (numBytes > kMaxHexBytesRun || !ensureBytes(numBytes)) {
+		valueRunsEnded = true;
+		reachedEnd = true;
+		return false;
+	}
+	valueRunLeft = numBytes;
+	return true;
+}
+
+// Skips whatever's left of the value being read
+void BinaryDeserializer::finishValue() {
+	if (valueType != HEX_BYTES) {
+		return;
+	}
+	do {
+		bufferPos += valueRunLeft;
+		valueRunLeft = 0;
+	} while (loadNextRun());
+}
+
+void BinaryDeserializer::skipValue() {
+	if (readValueHeader()) {
+		finishValue();
+	}
+}
+
+char BinaryDeserializer::nextValueChar() {
+	if (valueType != HEX_BYTES) {
+		if (!valueTextLength) {
+			return 0;
+		}
+		valueTextLength--;
+		return *valueText++;
+	}
+
+	if (valuePrefixLeft) {
+		return (valuePrefixLeft-- == 2) ? '0' : 'x';
+	}
+	if (valueLowNibble >= 0) {
+		char thisChar = valueHexChars[valueLowNibble];
+		valueLowNibble = -1;
+		return thisChar;
+	}
+	if (!valueRunLeft && !loadNextRun()) {
+		return 0;
+	}
+	uint8_t byte = buffer[bufferPos++];
+	valueRunLeft--;
+	valueLowNibble = byte & 15;
+	return valueHexChars[byte >> 4];
+}
+
+// The value's text as the XML would have it - up to as much as fits in stringBuffer, for HEX_BYTES. Consumes the value
+char const* BinaryDeserializer::valueAsText() {
+	switch (valueType) {
+	case INT:
+		intToString(valueNumber, valueTextBuffer);
+		return valueTextBuffer;
+
+	case HEX:
+		valueTextBuffer[0] = '0';
+		valueTextBuffer[1] = 'x';
+		intToHex(valueNumber, &valueTextBuffer[2], valueNumChars);
+		return valueTextBuffer;
+
+	case HEX_BYTES: {
+		int32_t numChars = 0;
+		char thisChar;
+		while (numChars < (int32_t)kFilenameBufferSize - 1 && (thisChar = nextValueChar())) {
+			stringBuffer[numChars++] = thisChar;
+		}
+		stringBuffer[numChars] = 0;
+		finishValue();
+		return stringBuffer;
+	}
+
+	default:
+		return valueText;
+	}
+}
+
+char const* BinaryDeserializer::readTagOrAttributeValue() {
+	if (!openValue()) {
+		return "";
+	}
+	readDone();
+	return valueAsText();
+}
+
+int32_t BinaryDeserializer::readTagOrAttributeValueInt() {
+	if (!openValue()) {
+		return 0;
+	}
+	readDone();
+	if (valueType == INT) {
+		return valueNumber;
+	}
+	return intFromValueText(valueAsText());
+}
+
+int32_t BinaryDeserializer::readTagOrAttributeValueHex(int32_t errorValue) {
+	if (!openValue()) {
+		return errorValue;
+	}
+	readDone();
+	if (valueType == HEX) {
+		return valueNumber;
+	}
+	char const* string = valueAsText();
+	if (string[0] != '0' || string[1] != 'x') {
+		return errorValue;
+	}
+	return hexToInt(&string[2]);
+}
+
+int BinaryDeserializer::readTagOrAttributeValueHexBytes(uint8_t* bytes, int32_t maxLen) {
+	if (!openValue()) {
+		return 0;
+	}
+	readDone();
+
+	int32_t numRead = 0;
+	if (valueType == HEX_BYTES) {
+		// The XML reader doesn't expect a "0x", and reads nothing if there is one
+		if (!valuePrefixLeft) {
+			while (numRead < maxLen && (valueRunLeft || loadNextRun())) {
+				int32_t numBytesNow = std::min<int32_t>(maxLen - numRead, valueRunLeft);
+				memcpy(&bytes[numRead], &buffer[bufferPos], numBytesNow);
+				bufferPos += numBytesNow;
+				valueRunLeft -= numBytesNow;
+				numRead += numBytesNow;
+			}
+		}
+		finishValue();
+		return numRead;
+	}
+
+	char const* hexChars = valueAsText();
+	while (numRead < maxLen) {
+		int32_t highNibble = hexCharToNibble(hexChars[0]);
+		int32_t lowNibble = (highNibble >= 0) ? hexCharToNibble(hexChars[1]) : -1;
+		if (lowNibble < 0) {
+			break;
+		}
+		bytes[numRead++] = (highNibble << 4) | lowNibble;
+		hexChars += 2;
+	}
+	return numRead;
+}
+
+int BinaryDeserializer::readHexBytesUntil(uint8_t* bytes, int32_t maxLen, char endPos) {
+	return readTagOrAttributeValueHexBytes(bytes, maxLen);
+}
+
+// Returns memory error
+Error BinaryDeserializer::readTagOrAttributeValueString(String* string) {
+	if (!openValue()) {
+		string->clear();
+		return Error::NONE;
+	}
+	readDone();
+
+	switch (valueType) {
+	case STRING:
+		return string->set(valueText, valueTextLength);
+
+	case HEX_BYTES: {
+		string->clear();
+		int32_t stringLength = 0;
+		while (true) {
+			int32_t numChars = 0;
+			char thisChar;
+			while (numChars < (int32_t)kFilenameBufferSize && (thisChar = nextValueChar())) {
+				stringBuffer[numChars++] = thisChar;
+			}
+			if (!numChars) {
+				return Error::NONE;
+			}
+			Error error = string->concatenateAtPos(stringBuffer, stringLength, numChars);
+			if (error != Error::NONE) {
+				finishValue();
+				return error;
+			}
+			stringLength += numChars;
+		}
+	}
+
+	default:
+		return string->set(valueAsText());
+	}
+}
+
+int32_t BinaryDeserializer::getNumCharsRemainingInValue() {
+	if (pending != Pending::VALUE_CHARS) {
+		return 0;
+	}
+	if (valueType != HEX_BYTES) {
+		return valueTextLength;
+	}
+	if (valueLowNibble < 0 && !valueRunLeft) {
+		loadNextRun();
+	}
+	return valuePrefixLeft + (valueLowNibble >= 0) + valueRunLeft * 2;
+}
+
+// Returns whether we're all good to go
+bool BinaryDeserializer::prepareToReadTagOrAttributeValueOneCharAtATime() {
+	if (!openValue()) {
+		// Where XML would have had some whitespace before the next tag
+		valueType = STRING;
+		valueText = "";
+		valueTextLength = 0;
+	}
+	else if (valueType == INT || valueType == HEX) {
+		valueText = valueAsText();
+		valueTextLength = strlen(valueText);
+		valueType = STRING;
+	}
+	pending = Pending::VALUE_CHARS;
+	return true;
+}
+
+// Returns NULL when there aren't numChars more, having read to the end of the value
+char const* BinaryDeserializer::readNextCharsOfTagOrAttributeValue(int32_t numChars) {
+	if (pending != Pending::VALUE_CHARS) {
+		return NULL;
+	}
+
+	if (valueType != HEX_BYTES) {
+		if (valueTextLength < numChars) {
+			valueTextLength = 0;
+			pending = Pending::NOTHING;
+			return NULL;
+		}
+		char const* chars = valueText;
+		valueText += numChars;
+		valueTextLength -= numChars;
+		readDone();
+		return chars;
+	}
+
+	int32_t charPos = 0;
+	while (charPos < numChars) {
+		// Whole bytes straight out of the run, when we can
+		if (valueLowNibble < 0 && !valuePrefixLeft && valueRunLeft && numChars - charPos >= 2) {
+			int32_t numBytesNow = std::min<int32_t>((numChars - charPos) >> 1, valueRunLeft);
+			for (int32_t i = 0; i < numBytesNow; i++) {
+				uint8_t byte = buffer[bufferPos++];
+				stringBuffer[charPos++] = valueHexChars[byte >> 4];
+				stringBuffer[charPos++] = valueHexChars[byte & 15];
+			}
+			valueRunLeft -= numBytesNow;
+			continue;
+		}
+
+		char thisChar = nextValueChar();
+		if (!thisChar) {
+			pending = Pending::NOTHING;
+			return NULL;
+		}
+		stringBuffer[charPos++] = thisChar;
+	}
+
+	readDone();
+	return stringBuffer;
+}
+
+// Whole runs of HEX_BYTES come straight out of the read buffer. Only values the XML had in lowercase, and ones that
+// weren't hex bytes in the first place, go through their text - the XML reader would have read those as text too
+uint8_t const* BinaryDeserializer::readNextHexBytesOfTagOrAttributeValue(int32_t numBytes) {
+	if (pending != Pending::VALUE_CHARS) {
+		return NULL;
+	}
+
+	if (valueType == HEX_BYTES && valueHexChars == upperHexChars && !valuePrefixLeft && valueLowNibble < 0) {
+		if (valueRunLeft >= numBytes) {
+			uint8_t const* bytes = &buffer[bufferPos];
+			bufferPos += numBytes;
+			valueRunLeft -= numBytes;
+			readDone();
+			return bytes;
+		}
+
+		// Split across runs
+		uint8_t* bytes = (uint8_t*)stringBuffer;
+		int32_t numRead = 0;
+		while (numRead < numBytes) {
+			if (!valueRunLeft && !loadNextRun()) {
+				pending = Pending::NOTHING;
+				return NULL;
+			}
+			int32_t numBytesNow = std::min<int32_t>(numBytes - numRead, valueRunLeft);
+			memcpy(&bytes[numRead], &buffer[bufferPos], numBytesNow);
+			bufferPos += numBytesNow;
+			valueRunLeft -= numBytesNow;
+			numRead += numBytesNow;
+		}
+		readDone();
+		return bytes;
+	}
+
+	char const* hexChars = readNextCharsOfTagOrAttributeValue(numBytes * 2);
+	if (!hexChars) {
+		return NULL;
+	}
+	uint8_t* bytes = (uint8_t*)stringBuffer;
+	for (int32_t i = 0; i < numBytes; i++) {
+		bytes[i] = hexToIntFixedLength(&hexChars[i * 2], 2);
+	}
+	return bytes;
+}
+
+char BinaryDeserializer::readNextCharOfTagOrAttributeValue() {
+	if (pending != Pending::VALUE_CHARS) {
+		return 0;
+	}
+	char thisChar = nextValueChar();
+	if (!thisChar) {
+		finishValue();
+		pending = Pending::NOTHING;
+	}
+	return thisChar;
+}
+
+void BinaryDeserializer::exitTag(char const* exitTagName) {
+	// back out the file depth to one less than the caller depth
+	while (tagDepthFile >= tagDepthCaller) {
+
+		if (reachedEnd) {
+			return;
+		}
+
+		if (pending == Pending::ATTRIBUTE_VALUE) {
+			skipValue();
+			tagDepthFile--;
+			pending = Pending::NOTHING;
+			continue;
+		}
+		if (pending == Pending::VALUE_CHARS) {
+			finishValue();
+			pending = Pending::NOTHING;
+			continue;
+		}
+
+		uint8_t opcode;
+		if (!readByte(&opcode)) {
+			reachedEnd = true;
+			return;
+		}
+
+		switch (opcode) {
+		case OPEN:
+		case ATTRIBUTE:
+			if (!readName()) {
+				reachedEnd = true;
+				return;
+			}
+			tagDepthFile++;
+			if (opcode == ATTRIBUTE) {
+				pending = Pending::ATTRIBUTE_VALUE;
+			}
+			break;
+
+		case CONTENT:
+			skipValue();
+			break;
+
+		case CLOSE:
+			tagDepthFile--;
+			break;
+
+		default:
+			reachedEnd = true;
+			return;
+		}
+
+		readDone();
+	}
+	// As with XML, the caller's depth might have got out of step with the file's through faulty error handling
+	tagDepthCaller = tagDepthFile;
+}
+
+Error BinaryDeserializer::readHeader(BinaryFileSource* source) {
+	startReadingFile();
+
+	if (!ensureBytes(kBinaryFileHeaderSize)) {
+		return fileAccessFailedDuring ? Error::SD_CARD : Error::FILE_CORRUPTED;
+	}
+	uint8_t const* header = &buffer[bufferPos];
+	if (memcmp(header, kBinaryFileMagic, 4) || header[4] != kBinaryFileVersion) {
+		return Error::FILE_UNSUPPORTED;
+	}
+	source->size = 0;
+	source->timestamp = 0;
+	source->saveToken = 0;
+	for (int32_t i = 0; i < 4; i++) {
+		source->size |= (uint32_t)header[5 + i] << (i * 8);
+		source->timestamp |= (uint32_t)header[9 + i] << (i * 8);
+		source->saveToken |= (uint32_t)header[13 + i] << (i * 8);
+	}
+	bufferPos += kBinaryFileHeaderSize;
+	return Error::NONE;
+}
+
+Error BinaryDeserializer::openBinaryFile(FilePointer* filePointer, char const* firstTagName, char const* altTagName,
+                                         bool ignoreIncorrectFirmware, BinaryFileSource const* expectedSource) {
+
+	AudioEngine::logAction("openBinaryFile");
+
+	msd->openFilePointer(filePointer);
+
+	BinaryFileSource source;
+	Error error = readHeader(&source);
+	if (error == Error::NONE && expectedSource && !(source == *expectedSource)) {
+		error = Error::FILE_UNSUPPORTED; // Made from some other version of the XML
+	}
+	if (error != Error::NONE) {
+		f_close(&fileSystemStuff.currentFile);
+		return error;
+	}
+
+	firmware_version = FirmwareVersion{FirmwareVersion::Type::OFFICIAL, {}};
+
+	char const* tagName;
+
+	while (*(tagName = readNextTagOrAttributeName())) {
+
+		if (!strcmp(tagName, firstTagName) || !strcmp(tagName, altTagName)) {
+			return Error::NONE;
+		}
+
+		Error result = tryReadingFirmwareTagFromFile(tagName, ignoreIncorrectFirmware);
+		if (result != Error::NONE && result != Error::RESULT_TAG_UNUSED) {
+			return result;
+		}
+		exitTag(tagName);
+	}
+
+	f_close(&fileSystemStuff.currentFile);
+	return Error::FILE_CORRUPTED;
+}
+
+/*******************************************************************************
+
+    Converting from XML
+
+********************************************************************************/
+
+namespace {
+
+// Streams the value the XML reader's just been prepared to read char by char into writer's value
+void convertValue(XMLDeserializer& reader, BinarySerializer& writer) {
+	while (true) {
+		int32_t numChars = std::min<int32_t>(reader.getNumCharsRemainingInValue(), kFilenameBufferSize);
+		if (numChars) {
+			writer.appendValueChars(reader.readNextCharsOfTagOrAttributeValue(numChars), numChars);
+		}
+		else {
+			// Either the end of the value, or of the XML's buffer
+			char thisChar = reader.readNextCharOfTagOrAttributeValue();
+			if (!thisChar) {
+				return;
+			}
+			writer.appendValueChars(&thisChar, 1);
+		}
+	}
+}
+
+void convertElement(XMLDeserializer& reader, BinarySerializer& writer, char const* tagName) {
+	writer.writeOpeningTagBeginning(tagName);
+
+	// Written as <tagName/>, so there's nothing more to it
+	if (reader.tagDepthFile < reader.tagDepthCaller) {
+		writer.closeTag();
+		return;
+	}
+
+	bool haveEndedOpeningTag = false;
+	if (reader.isAtTagContent()) {
+		writer.writeOpeningTagEnd();
+		haveEndedOpeningTag = true;
+		if (reader.prepareToReadTagOrAttributeValueOneCharAtATime()) {
+			writer.beginContent();
+			convertValue(reader, writer);
+			writer.endValue();
+		}
+	}
+
+	char const* name;
+	while (*(name = reader.readNextTagOrAttributeName())) {
+		if (reader.isAtAttributeValue()) {
+			writer.beginAttributeValue(name);
+			if (reader.prepareToReadTagOrAttributeValueOneCharAtATime()) {
+				convertValue(reader, writer);
+			}
+			writer.endValue();
+		}
+		else {
+			if (!haveEndedOpeningTag) {
+				writer.writeOpeningTagEnd();
+				haveEndedOpeningTag = true;
+			}
+			convertElement(reader, writer, name);
+		}
+		reader.exitTag(name);
+	}
+
+	writer.writeClosingTag(tagName);
+}
+
+} // namespace
+
+Error getBinaryFileSource(char const* xmlPath, BinaryFileSource* source) {
+	FRESULT result = f_stat(xmlPath, &staticFNO);
+	if (result != FR_OK) {
+		return fresultToDelugeErrorCode(result);
+	}
+	source->size = staticFNO.fsize;
+	source->timestamp = ((uint32_t)staticFNO.fdate << 16) | staticFNO.ftime;
+
+	// Serializer::writeSaveToken() puts it right after the firmware versions, well inside the first sector
+	FIL file;
+	result = f_open(&file, xmlPath, FA_READ);
+	if (result != FR_OK) {
+		return fresultToDelugeErrorCode(result);
+	}
+	char head[257];
+	UINT numBytesRead;
+	result = f_read(&file, head, sizeof(head) - 1, &numBytesRead);
+	f_close(&file);
+	if (result != FR_OK) {
+		return fresultToDelugeErrorCode(result);
+	}
+	head[numBytesRead] = 0;
+
+	constexpr char kTokenStart[] = "saveToken=\"0x";
+	char const* tokenChars = strstr(head, kTokenStart);
+	if (!tokenChars) {
+		return Error::FILE_UNSUPPORTED;
+	}
+	tokenChars += sizeof(kTokenStart) - 1;
+	source->saveToken = 0;
+	for (int32_t i = 0; i < 8; i++) {
+		int32_t nibble = hexCharToNibble(tokenChars[i]);
+		if (nibble < 0) {
+			return Error::FILE_UNSUPPORTED;
+		}
+		source->saveToken = (source->saveToken << 4) | nibble;
+	}
+	return Error::NONE;
+}
+
+Error convertXMLToBinary(XMLDeserializer& reader, BinarySerializer& writer) {
+	char const* tagName;
+	while (*(tagName = reader.readNextTagOrAttributeName())) {
+		convertElement(reader, writer, tagName);
+		reader.exitTag(tagName);
+	}
+	return reader.fileAccessFailedDuring ? Error::SD_CARD : Error::NONE;
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "storage/storage_manager.h"
+
+/*
+ * Songs and presets stay XML - it's what people share, edit and what every firmware reads. But parsing it is most of
+ * what loading a big song costs, so next to a song the firmware can keep a binary copy of it to load instead, made from
+ * the XML right after saving and only ever used while that XML hasn't changed since. Each save writes a new random
+ * saveToken attribute near the top of the song, which the binary copy records too. The FAT timestamp is no help on the
+ * device, which doesn't keep the time, and a firmware that knows nothing of binary copies could re-save the XML at the
+ * same size - but it won't have written the same saveToken.
+ *
+ * The binary file is the XML's tree, one record per element, attribute, element content or closing tag:
+ *
+ *   header:    "DLGB", version byte, the XML's size, FatFs date/time and saveToken, each 4 bytes little-endian
+ *   record:    opcode byte, then for OPEN a name, ATTRIBUTE a name and a value, CONTENT a value, CLOSE nothing
+ *   name:      varint k - k > 0 is the (k-1)th name the file's defined, 0 defines the next one: varint length, chars
+ *   value:     type byte, then INT: zigzag varint. HEX: number of digits, varint. STRING: varint length, chars, NUL.
+ *              HEX_BYTES: flags, then runs of (varint count, that many bytes), ended by a count of 0
+ *
+ * The model reads the binary through the same Deserializer calls as the XML. Numbers come back as the numbers they're
+ * stored as, and the long hex values it reads a few bytes at a time as the bytes they're stored as, straight out of the
+ * read buffer - neither goes through text. Anything asked for as text gets exactly the text the XML had. The one thing
+ * that isn't kept is whitespace at the start of an element's content, which the firmware never writes.
+ */
+
+constexpr char kBinaryFileMagic[4] = {'D', 'L', 'G', 'B'};
+constexpr uint8_t kBinaryFileVersion = 2;
+constexpr int32_t kBinaryFileHeaderSize = 17;
+
+/// What a binary file was made from, so it's only used while that's unchanged
+struct BinaryFileSource {
+	uint32_t size;
+	uint32_t timestamp; // FatFs fdate << 16 | ftime
+	uint32_t saveToken;
+
+	bool operator==(BinaryFileSource const& other) const = default;
+};
+
+/// What the XML file at xmlPath is now. Fails if it has no saveToken, as there'd be no telling a binary copy of it
+/// from one of an older version of it
+Error getBinaryFileSource(char const* xmlPath, BinaryFileSource* source);
+
+namespace binary_file {
+
+enum Opcode : uint8_t {
+	OPEN = 1,
+	ATTRIBUTE,
+	CONTENT,
+	CLOSE,
+};
+
+enum ValueType : uint8_t {
+	INT = 1,
+	HEX,
+	STRING,
+	HEX_BYTES,
+};
+
+constexpr uint8_t kHexBytesPrefixed = 1;  // Written with a leading "0x"
+constexpr uint8_t kHexBytesLowercase = 2; // a-f rather than A-F
+
+// Both ends fill their name tables identically, so a name only has to be spelled out the first time
+constexpr int32_t kMaxNames = 512;
+constexpr int32_t kNamePoolSize = 8192;
+
+// Longest STRING value, and longest HEX_BYTES run. Both always fit in a BinaryDeserializer's spill area
+constexpr int32_t kMaxStringLength = 512;
+constexpr int32_t kMaxHexBytesRun = 512;
+constexpr int32_t kReadSpillSize = 1024;
+
+} // namespace binary_file
+
+class BinarySerializer : public Serializer {
+public:
+	BinarySerializer();
+	virtual ~BinarySerializer();
+
+	void writeAttribute(char const* name, int32_t number, bool onNewLine = true) override;
+	void writeAttribute(char const* name, char const* value, bool onNewLine = true) override;
+	void writeAttributeHex(char const* name, int32_t number, int32_t numChars, bool onNewLine = true) override;
+	void writeAttributeHexBytes(char const* name, uint8_t* data, int32_t numBytes, bool onNewLine = true) override;
+
+	void writeTag(char const* tag, int32_t number) override;
+	void writeTag(char const* tag, char const* contents) override;
+	void writeOpeningTag(char const* tag, bool startNewLineAfter = true) override;
+	void writeOpeningTagBeginning(char const* tag) override;
+	void writeOpeningTagEnd(bool startNewLineAfter = true) override;
+	void closeTag() override;
+	void writeClosingTag(char const* tag, bool shouldPrintIndents = true) override;
+	void printIndents() override {}
+	// Takes the attributes and element content the model writes out as raw XML, a few chars at a time
+	void write(char const* output) override;
+	// beginningString and endString are XML, so aren't checked
+	Error closeFileAfterWriting(char const* path = nullptr, char const* beginningString = nullptr,
+	                            char const* endString = nullptr) override;
+
+	Error createFile(char const* path, BinaryFileSource source);
+	// Gives up on the file being written, and deletes it
+	void abandonFile(char const* path);
+
+	// For values that arrive in pieces. An attribute's name is written straight away; element content gets written
+	// once there's some that isn't leading whitespace
+	void beginAttributeValue(char const* name);
+	void beginContent();
+	void appendValueChars(char const* chars, int32_t numChars);
+	void endValue();
+
+	// Written to while the XML it's made from is read through fileSystemStuff.currentFile
+	FIL file;
+
+private:
+	enum class RawState : uint8_t {
+		BETWEEN_TAGS,
+		IN_TAG,
+		IN_ATTRIBUTE_NAME,
+		PAST_ATTRIBUTE_NAME,
+		IN_ATTRIBUTE_VALUE,
+		IN_CONTENT,
+	};
+
+	enum class ValueState : uint8_t {
+		NONE,
+		ATTRIBUTE,
+		CONTENT,
+		STREAMING_HEX_BYTES,
+	};
+
+	void writeByte(uint8_t byte);
+	void writeBytes(void const* data, int32_t numBytes);
+	void writeVarint(uint32_t number);
+	void writeName(char const* name);
+	void writeValue(char const* value, int32_t length);
+	void writeHexBytesRun(uint8_t const* data, int32_t numBytes);
+	bool startStreamingHexBytes();
+	void streamHexChar(char thisChar);
+	void finishRawContent();
+	Error writeBufferToFile();
+
+	char* writeClusterBuffer;
+	int32_t fileWriteBufferCurrentPos;
+	uint32_t fileTotalBytesWritten;
+	bool fileAccessFailedDuringWrite;
+	// Something came along this format can't hold exactly. The file's no good, but the XML it's made from still is
+	bool encodingFailed;
+
+	char* namePool;
+	uint16_t* nameStarts;
+	int16_t* nameSlots; // Open-addressed hash of names to (index + 1)
+	int32_t numNames;
+	int32_t namePoolUsed;
+
+	RawState rawState;
+	char rawQuote;
+	char rawName[kFilenameBufferSize];
+	int32_t rawNameLength;
+
+	ValueState valueState;
+	char valueChars[binary_file::kMaxStringLength + 1];
+	int32_t numValueChars;
+	uint8_t hexBytesRun[binary_file::kMaxHexBytesRun];
+	int32_t hexBytesRunLength;
+	int32_t highNibble; // -1 if none waiting for its low one
+	bool hexBytesLowercase;
+};
+
+class BinaryDeserializer : public Deserializer {
+public:
+	BinaryDeserializer();
+	virtual ~BinaryDeserializer();
+
+	bool prepareToReadTagOrAttributeValueOneCharAtATime() override;
+	char const* readNextTagOrAttributeName() override;
+	char readNextCharOfTagOrAttributeValue() override;
+	int32_t getNumCharsRemainingInValue() override;
+
+	int32_t readTagOrAttributeValueInt() override;
+	int32_t readTagOrAttributeValueHex(int32_t errorValue) override;
+	int readTagOrAttributeValueHexBytes(uint8_t* bytes, int32_t maxLen) override;
+
+	// There's no end char to read until - this reads the rest of the value
+	int readHexBytesUntil(uint8_t* bytes, int32_t maxLen, char endPos) override;
+	char const* readNextCharsOfTagOrAttributeValue(int32_t numChars) override;
+	uint8_t const* readNextHexBytesOfTagOrAttributeValue(int32_t numBytes) override;
+	Error readTagOrAttributeValueString(String* string) override;
+	char const* readTagOrAttributeValue() override;
+	void exitTag(char const* exitTagName = NULL) override;
+	void stopReading() override;
+
+	// Like XMLDeserializer::openXMLFile(). With expectedSource, fails unless the file was made from that XML
+	Error openBinaryFile(FilePointer* filePointer, char const* firstTagName, char const* altTagName = "",
+	                     bool ignoreIncorrectFirmware = false, BinaryFileSource const* expectedSource = nullptr);
+
+	// Whether the name just read was an attribute's, with its value next
+	bool isAtAttributeValue() { return pending == Pending::ATTRIBUTE_VALUE; }
+
+	StorageManager* msd;
+	bool fileAccessFailedDuring;
+
+private:
+	enum class Pending : uint8_t {
+		NOTHING,
+		ATTRIBUTE_VALUE, // An attribute's name has been read and its value is next in the file
+		VALUE_CHARS,     // Partway through reading a value one char at a time
+	};
+
+	Error readHeader(BinaryFileSource* source);
+	bool ensureBytes(int32_t numBytes);
+	bool readByte(uint8_t* byte);
+	bool readVarint(uint32_t* number);
+	char const* readName();
+	bool openValue();
+	bool readValueHeader();
+	bool loadNextRun();
+	void finishValue();
+	void skipValue();
+	char nextValueChar();
+	char const* valueAsText();
+	void startReadingFile();
+	void readDone();
+
+	uint8_t* buffer; // kReadSpillSize bytes, then a Cluster read straight in from the card
+	int32_t bufferPos;
+	int32_t bufferEnd;
+	bool fileEnded;
+	bool reachedEnd;
+
+	char* namePool;
+	char const** names;
+	int32_t numNames;
+	int32_t namePoolUsed;
+
+	int32_t tagDepthCaller;
+	int32_t tagDepthFile;
+	int32_t readCount;
+	Pending pending;
+
+	// The value being read, as the text it was in the XML
+	uint8_t valueType;
+	int32_t valueNumber;   // INT and HEX
+	int32_t valueNumChars; // HEX
+	char const* valueText; // STRING, and INT and HEX once rendered: what's left of their text
+	int32_t valueTextLength;
+	char valueTextBuffer[12];
+	int32_t valuePrefixLeft; // HEX_BYTES: how much of the "0x" is still to give out
+	char const* valueHexChars;
+	int32_t valueRunLeft;   // HEX_BYTES: bytes still to go in this run
+	int32_t valueLowNibble; // HEX_BYTES: the second half of a byte whose first char was given out, or -1
+	bool valueRunsEnded;
+
+	char stringBuffer[kFilenameBufferSize];
+};
+
+/// Writes the whole XML document reader's been pointed at out through writer, element for element
+Error convertXMLToBinary(XMLDeserializer& reader, BinarySerializer& writer);
+
+extern BinarySerializer smBinarySerializer;
+extern BinaryDeserializer smBinaryDeserializer;
@@ -26,9 +26,23 @@ ClusterPriorityQueue::ClusterPriorityQueue()
 
 // Returns error
 Error ClusterPriorityQueue::add(Cluster* cluster, uint32_t priorityRating) {
-	int32_t i = insertAtKey((int32_t)cluster);
-	if (i == -1) {
-		return Error::INSUFFICIENT_RAM;
+	// Binary search for the first element rated after this one, so equal ratings stay in the order they came. The
+	// ratings are compared unsigned, which the key search in OrderedResizeableArray doesn't do
+	int32_t i = 0;
+	int32_t end = numElements;
+	while (i < end) {
+		int32_t middle = (i + end) >> 1;
+		if (((PriorityQueueElement*)getElementAddress(middle))->priorityRating <= priorityRating) {
+			i = middle + 1;
+		}
+		else {
+			end = middle;
+		}
+	}
+
+	Error error = insertAtIndex(i);
+	if (error != Error::NONE) {
+		return error;
 	}
 
 	PriorityQueueElement* element = (PriorityQueueElement*)getElementAddress(i);
@@ -37,20 +51,27 @@ Error ClusterPriorityQueue::add(Cluster* cluster, uint32_t priorityRating) {
 	return Error::NONE;
 }
 
-Cluster* ClusterPriorityQueue::grabHead() {
+Cluster* ClusterPriorityQueue::grabHead(uint32_t* priorityRating) {
 	if (!numElements) {
 		return NULL;
 	}
-	Cluster* toReturn = ((PriorityQueueElement*)getElementAddress(0))->cluster;
+	PriorityQueueElement* head = (PriorityQueueElement*)getElementAddress(0);
+	Cluster* toReturn = head->cluster;
+	if (priorityRating) {
+		*priorityRating = head->priorityRating;
+	}
 	deleteAtIndex(0);
 	return toReturn;
 }
 
 // Returns whether it was present
-bool ClusterPriorityQueue::removeIfPresent(Cluster* cluster) {
+bool ClusterPriorityQueue::removeIfPresent(Cluster* cluster, uint32_t* priorityRating) {
 	for (int32_t i = 0; i < numElements; i++) {
 		PriorityQueueElement* element = (PriorityQueueElement*)getElementAddress(i);
 		if (element->cluster == cluster) {
+			if (priorityRating) {
+				*priorityRating = element->priorityRating;
+			}
 			deleteAtIndex(i);
 			return true;
 		}
@@ -59,6 +80,14 @@ bool ClusterPriorityQueue::removeIfPresent(Cluster* cluster) {
 	return false;
 }
 
+int32_t ClusterPriorityQueue::getNumWithoutDeadline() {
+	int32_t i = numElements;
+	while (i > 0 && ((PriorityQueueElement*)getElementAddress(i - 1))->priorityRating == 0xFFFFFFFF) {
+		i--;
+	}
+	return numElements - i;
+}
+
 bool ClusterPriorityQueue::checkPresent(Cluster* cluster) {
 	for (int32_t i = 0; i < numElements; i++) {
 		PriorityQueueElement* element = (PriorityQueueElement*)getElementAddress(i);
@@ -26,12 +26,17 @@ struct PriorityQueueElement {
 	Cluster* cluster;
 };
 
+/// Clusters waiting to be loaded, lowest priorityRating first. Sample playback rates them by the audioSampleTimer
+/// deadline they're needed by (see ClusterReadAhead), and 0xFFFFFFFF means whenever there's time
 class ClusterPriorityQueue final : public OrderedResizeableArrayWith32bitKey {
 public:
 	ClusterPriorityQueue();
 
 	Error add(Cluster* cluster, uint32_t priorityRating);
-	Cluster* grabHead();
-	bool removeIfPresent(Cluster* cluster);
+	/// priorityRating, if given, gets the rating the Cluster was queued with
+	Cluster* grabHead(uint32_t* priorityRating = nullptr);
+	bool removeIfPresent(Cluster* cluster, uint32_t* priorityRating = nullptr);
 	bool checkPresent(Cluster* cluster);
+	/// How many are rated 0xFFFFFFFF, which all sit at the end
+	int32_t getNumWithoutDeadline();
 };
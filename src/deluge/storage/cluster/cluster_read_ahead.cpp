@@ -0,0 +1,62 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "storage/cluster/cluster_read_ahead.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// The same gains TCP uses for its round trip time estimate
+constexpr float kMeanGain = 1.f / 8;
+constexpr float kDeviationGain = 1.f / 4;
+// How much of the slowest load gets forgotten with each one after it
+constexpr float kSlowestDecay = 1.f / 128;
+// A deadline further off than this is as good as none
+constexpr float kMaxClusterPlayTime = 1 << 24;
+} // namespace
+
+void ClusterReadAhead::reset() {
+	meanLoadTime_ = kInitialLoadTime;
+	loadTimeDeviation_ = 0;
+	slowestLoadTime_ = kInitialLoadTime;
+}
+
+void ClusterReadAhead::noteLoadTime(uint32_t loadTime) {
+	float error = (float)loadTime - meanLoadTime_;
+	meanLoadTime_ += error * kMeanGain;
+	loadTimeDeviation_ += (std::abs(error) - loadTimeDeviation_) * kDeviationGain;
+	slowestLoadTime_ = std::max(slowestLoadTime_ * (1 - kSlowestDecay), (float)loadTime);
+}
+
+float ClusterReadAhead::clusterPlayTime(uint32_t rate) const {
+	if (!rate) {
+		return kMaxClusterPlayTime;
+	}
+	return std::min((float)clusterSize_ * 65536 / rate, kMaxClusterPlayTime);
+}
+
+int32_t ClusterReadAhead::numClustersAhead(uint32_t rate) const {
+	float numNeeded = 1 + std::ceil(latency() / clusterPlayTime(rate));
+	return std::clamp((int32_t)numNeeded, kMinClustersAhead, kMaxClustersAhead);
+}
+
+uint32_t ClusterReadAhead::deadline(int32_t clustersAhead, uint32_t rate, uint32_t now) const {
+	if (clustersAhead <= 0) {
+		return now;
+	}
+	return now + (uint32_t)((clustersAhead - 1) * clusterPlayTime(rate));
+}
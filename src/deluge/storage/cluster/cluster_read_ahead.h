@@ -0,0 +1,76 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Works out how far ahead of each play-head Clusters need to be enqueued, and by when each has to be loaded.
+ *
+ * A play-head moving through a file at `rate` bytes per output sample uses up a Cluster every clusterSize / rate
+ * samples. If a Cluster takes `latency` samples from being enqueued to being loaded, the play-head needs
+ * 1 + latency / (clusterSize / rate) Clusters enqueued - the one it's in, and enough after that to cover the wait. So
+ * pitching a sample up, time-stretching it faster or a slow card all mean looking further ahead.
+ *
+ * The latency is measured rather than guessed. Each load reports how long the card took over it, which is tracked the
+ * way TCP tracks round trip times - a smoothed mean plus four times the smoothed deviation - along with the slowest
+ * recent load, decaying away slowly. Cards go quiet for tens of milliseconds now and then, and a Cluster enqueued just
+ * as that starts has to wait it out before getting its own turn, so the latency is the two added together. Time spent
+ * queued behind other play-heads isn't counted: the queue goes by deadline, and counting it would have Clusters
+ * enqueued early for far-off deadlines make everyone look further ahead still.
+ *
+ * Deadlines are AudioEngine::audioSampleTimer values, for the loading queue to sort by.
+ */
+class ClusterReadAhead {
+public:
+	/// Never fewer than kNumClustersLoadedAhead, which the rest of the sample playback code relies on
+	static constexpr int32_t kMinClustersAhead = 2;
+	/// Every Cluster held ahead is one that can't be stolen, so this caps what one play-head can tie up
+	static constexpr int32_t kMaxClustersAhead = 8;
+	/// What's assumed of each load before any have been measured, in samples - about 5ms
+	static constexpr float kInitialLoadTime = 220;
+
+	ClusterReadAhead() { reset(); }
+
+	void setClusterSize(uint32_t newClusterSize) { clusterSize_ = newClusterSize; }
+
+	/// The card took loadTime samples to load a Cluster
+	void noteLoadTime(uint32_t loadTime);
+
+	/// Enqueue-to-loaded time to plan for, in samples
+	[[nodiscard]] float latency() const { return slowestLoadTime_ + meanLoadTime_ + 4 * loadTimeDeviation_; }
+
+	/// How many Clusters a play-head reading `rate` bytes per output sample (16.16 fixed point) should hold, counting
+	/// the one it's in
+	[[nodiscard]] int32_t numClustersAhead(uint32_t rate) const;
+
+	/// When the Cluster `clustersAhead` after the one a play-head's in will be needed. The play-head could be anywhere
+	/// in its current Cluster, so this assumes it's at the end
+	[[nodiscard]] uint32_t deadline(int32_t clustersAhead, uint32_t rate, uint32_t now) const;
+
+	void reset();
+
+private:
+	/// How long a play-head takes to get through a Cluster, in samples, capped well short of overflowing a deadline
+	[[nodiscard]] float clusterPlayTime(uint32_t rate) const;
+
+	uint32_t clusterSize_ = 32768;
+	float meanLoadTime_;
+	float loadTimeDeviation_;
+	float slowestLoadTime_;
+};
@@ -0,0 +1,56 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/// Most Clusters read from the card in one go. Every read command costs the card its access time - often more than
+/// actually transferring a Cluster - so a play-head's next few Clusters, if they're one after the other on the card,
+/// are far quicker to get in one read. This caps how long the audio routine can go without a look-in
+constexpr int32_t kMaxClustersPerRead = 4;
+
+/// A run of a file's Clusters, in file order, to be read from the card in one go
+struct ClusterReadBatch {
+	int32_t firstClusterIndex;
+	int32_t numClusters;
+};
+
+/// Grows a batch outwards from clusterIndex - forwards first, since that's where play-heads usually go, then backwards
+/// for reversed ones - for as long as the next Cluster along starts in the sector after the last one ends and
+/// tryTake(index) can claim it. sdAddressOf(index) is the first sector of the file's Cluster at that index.
+template <typename SDAddressOf, typename TryTake>
+ClusterReadBatch growClusterReadBatch(int32_t clusterIndex, int32_t numClustersInFile, uint32_t sectorsPerCluster,
+                                      SDAddressOf sdAddressOf, TryTake tryTake) {
+	ClusterReadBatch batch{clusterIndex, 1};
+
+	int32_t last = clusterIndex;
+	while (batch.numClusters < kMaxClustersPerRead && last + 1 < numClustersInFile
+	       && sdAddressOf(last + 1) == sdAddressOf(last) + sectorsPerCluster && tryTake(last + 1)) {
+		last++;
+		batch.numClusters++;
+	}
+
+	while (batch.numClusters < kMaxClustersPerRead && batch.firstClusterIndex > 0
+	       && sdAddressOf(batch.firstClusterIndex - 1) + sectorsPerCluster == sdAddressOf(batch.firstClusterIndex)
+	       && tryTake(batch.firstClusterIndex - 1)) {
+		batch.firstClusterIndex--;
+		batch.numClusters++;
+	}
+
+	return batch;
+}
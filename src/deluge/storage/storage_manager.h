@@ -25,6 +25,7 @@
 
 #include <cstdint>
 #include <optional>
+#include <string_view>
 
 extern "C" {
 #include "fatfs/ff.h"
@@ -51,6 +52,8 @@ class MIDIParamCollection;
 class ParamManager;
 class SoundDrum;
 class StorageManager;
+class BinarySerializer;
+class BinaryDeserializer;
 
 class SMSharedData {};
 
@@ -74,6 +77,9 @@ public:
 	                                    char const* endString = nullptr) = 0;
 
 	void writeFirmwareVersion();
+	/// A new random one each save, for telling the binary copy of a song made from this save from any other - see
+	/// binary_serializer.h. Goes right after the firmware versions, where it can be found without parsing the file
+	void writeSaveToken();
 
 	void writeEarliestCompatibleFirmwareVersion(char const* versionString) {
 		writeAttribute("earliestCompatibleFirmware", versionString);
@@ -135,9 +141,19 @@ public:
 	virtual int readTagOrAttributeValueHexBytes(uint8_t* bytes, int32_t maxLen) = 0;
 
 	virtual char const* readNextCharsOfTagOrAttributeValue(int32_t numChars) = 0;
+	// The next numBytes * 2 chars of a hex value being read a few at a time, as bytes. NULL if there aren't that many
+	virtual uint8_t const* readNextHexBytesOfTagOrAttributeValue(int32_t numBytes) = 0;
 	virtual Error readTagOrAttributeValueString(String* string) = 0;
 	virtual void exitTag(char const* exitTagName = NULL) = 0;
-	virtual FirmwareVersion getFirmwareVersion() = 0;
+	// Makes it look as though the file ends here, for giving up on a file part way through
+	virtual void stopReading() = 0;
+
+	FirmwareVersion getFirmwareVersion() { return firmware_version; }
+	Error tryReadingFirmwareTagFromFile(char const* tagName, bool ignoreIncorrectFirmware = false);
+
+	// Which firmware wrote the file being read. Only one file's ever read at a time, whatever it's read with, and the
+	// model checks this well after it's been read, so it belongs to no Deserializer in particular
+	static FirmwareVersion firmware_version;
 };
 
 class XMLDeserializer : public Deserializer {
@@ -156,15 +172,23 @@ public:
 
 	int readHexBytesUntil(uint8_t* bytes, int32_t maxLen, char endPos) override;
 	char const* readNextCharsOfTagOrAttributeValue(int32_t numChars) override;
+	uint8_t const* readNextHexBytesOfTagOrAttributeValue(int32_t numBytes) override;
 	Error readTagOrAttributeValueString(String* string) override;
 	char const* readTagOrAttributeValue() override;
 	void exitTag(char const* exitTagName = NULL) override;
+	void stopReading() override;
 
 	Error openXMLFile(FilePointer* filePointer, char const* firstTagName, char const* altTagName = "",
 	                  bool ignoreIncorrectFirmware = false);
+	// Points this at the start of a file, without reading anything yet
+	void startReadingFile(FilePointer* filePointer);
+
+	// Whether what's next is the content of the tag whose name was just read
+	bool isAtTagContent();
+	// Whether the name just read was an attribute's, with its value next
+	bool isAtAttributeValue();
 
 	StorageManager* msd;
-	FirmwareVersion getFirmwareVersion() override { return firmware_version; }
 
 public:
 	UINT currentReadBufferEndPos;
@@ -181,11 +205,12 @@ public:
 
 	char stringBuffer[kFilenameBufferSize];
 
-	FirmwareVersion firmware_version = FirmwareVersion::current();
-	Error tryReadingFirmwareTagFromFile(char const* tagName, bool ignoreIncorrectFirmware = false);
-
 	void skipUntilChar(char endChar);
 	uint32_t readCharXML(char* thisChar);
+	char readCharAfterWhitespace();
+	std::string_view readToken(uint8_t endClass, char* endChar);
+	int32_t appendToStringBuffer(int32_t charPos, char const* chars, int32_t numChars);
+	int32_t findInBuffer(char endChar, int32_t endPos);
 	char const* readTagName();
 	char const* readNextAttributeName();
 	char const* readUntilChar(char endChar);
@@ -217,6 +242,16 @@ public:
 	Error openXMLFile(FilePointer* filePointer, XMLDeserializer& reader, char const* firstTagName,
 	                  char const* altTagName = "", bool ignoreIncorrectFirmware = false);
 
+	// A binary copy of an XML file, to load instead while the XML's unchanged - see binary_serializer.h. It lives next
+	// to the XML, with the extension .DLB
+	static Error getBinaryTwinPath(char const* xmlPath, String* twinPath);
+	Error writeBinaryTwin(char const* xmlPath, XMLDeserializer& reader, BinarySerializer& writer);
+	// Fails if there's no twin, or it was made from some other version of the XML
+	Error openBinaryTwin(char const* xmlPath, BinaryDeserializer& reader, char const* firstTagName,
+	                     char const* altTagName = "", bool ignoreIncorrectFirmware = false);
+	// For when the XML itself is deleted. Does nothing for files other than XML
+	static void deleteBinaryTwin(char const* xmlPath);
+
 	Error initSD();
 	bool closeFile();
 
@@ -0,0 +1,1184 @@
+/*
+ * Copyright © 2014-2023 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "definitions_cxx.hpp"
+#include "drivers/pic/pic.h"
+#include "gui/ui_timer_manager.h"
+#include "hid/display/display.h"
+#include "memory/general_memory_allocator.h"
+#include "processing/engines/audio_engine.h"
+#include "storage/audio/audio_file_manager.h"
+#include "storage/storage_manager.h"
+#include "util/d_string.h"
+#include "util/firmware_version.h"
+#include "util/functions.h"
+#include <array>
+#include <string.h>
+#include <string_view>
+
+extern "C" {
+#include "RZA1/oled/oled_low_level.h"
+#include "fatfs/ff.h"
+}
+
+char charAtEndOfValue;
+
+/*******************************************************************************
+
+    Deserializer
+
+********************************************************************************/
+
+FirmwareVersion Deserializer::firmware_version = FirmwareVersion::current();
+
+Error Deserializer::tryReadingFirmwareTagFromFile(char const* tagName, bool ignoreIncorrectFirmware) {
+
+	if (!strcmp(tagName, "firmwareVersion")) {
+		char const* firmware_version_string = readTagOrAttributeValue();
+		firmware_version = FirmwareVersion::parse(firmware_version_string);
+	}
+
+	// If this tag doesn't exist, it's from old firmware so is ok
+	else if (!strcmp(tagName, "earliestCompatibleFirmware")) {
+		char const* firmware_version_string = readTagOrAttributeValue();
+		auto earliestFirmware = FirmwareVersion::parse(firmware_version_string);
+		if (earliestFirmware > FirmwareVersion::current() && !ignoreIncorrectFirmware) {
+			f_close(&fileSystemStuff.currentFile);
+			return Error::FILE_FIRMWARE_VERSION_TOO_NEW;
+		}
+	}
+
+	else {
+		return Error::RESULT_TAG_UNUSED;
+	}
+
+	return Error::NONE;
+}
+
+/*******************************************************************************
+
+    XMLSerializer
+
+********************************************************************************/
+
+XMLSerializer::XMLSerializer() : fileWriteBufferCurrentPos(0), ms(NULL) {
+	void* temp = GeneralMemoryAllocator::get().allocLowSpeed(32768 + CACHE_LINE_SIZE * 2);
+	writeClusterBuffer = (char*)temp + CACHE_LINE_SIZE;
+}
+
+XMLSerializer::~XMLSerializer() {
+	GeneralMemoryAllocator::get().dealloc(writeClusterBuffer - CACHE_LINE_SIZE);
+}
+
+// TODO: this is really inefficient
+void XMLSerializer::write(char const* output) {
+
+	while (*output) {
+
+		if (fileWriteBufferCurrentPos == audioFileManager.clusterSize) {
+
+			if (!fileAccessFailedDuringWrite) {
+				Error error = writeXMLBufferToFile();
+				if (error != Error::NONE) {
+					fileAccessFailedDuringWrite = true;
+					return;
+				}
+			}
+
+			fileWriteBufferCurrentPos = 0;
+		}
+
+		writeClusterBuffer[fileWriteBufferCurrentPos] = *output;
+
+		output++;
+		fileWriteBufferCurrentPos++;
+
+		// Ensure we do some of the audio routine once in a while
+		if (!(fileWriteBufferCurrentPos & 0b11111111)) {
+			AudioEngine::logAction("writeCharXML");
+
+			// AudioEngine::routineWithClusterLoading();
+
+			uiTimerManager.routine();
+
+			if (display->haveOLED()) {
+				oledRoutine();
+			}
+			PIC::flush();
+		}
+	}
+}
+
+void XMLSerializer::writeTag(char const* tag, int32_t number) {
+	char* buffer = shortStringBuffer;
+	intToString(number, buffer);
+	writeTag(tag, buffer);
+}
+
+void XMLSerializer::writeTag(char const* tag, char const* contents) {
+
+	printIndents();
+	write("<");
+	write(tag);
+	write(">");
+	write(contents);
+	write("</");
+	write(tag);
+	write(">\n");
+}
+
+void XMLSerializer::writeAttribute(char const* name, int32_t number, bool onNewLine) {
+
+	char buffer[12];
+	intToString(number, buffer);
+
+	writeAttribute(name, buffer, onNewLine);
+}
+
+// numChars may be up to 8
+void XMLSerializer::writeAttributeHex(char const* name, int32_t number, int32_t numChars, bool onNewLine) {
+
+	char buffer[11];
+	buffer[0] = '0';
+	buffer[1] = 'x';
+	intToHex(number, &buffer[2], numChars);
+
+	writeAttribute(name, buffer, onNewLine);
+}
+
+// numChars may be up to 8
+void XMLSerializer::writeAttributeHexBytes(char const* name, uint8_t* data, int32_t numBytes, bool onNewLine) {
+
+	if (onNewLine) {
+		write("\n");
+		printIndents();
+	}
+	else {
+		write(" ");
+	}
+	write(name);
+	write("=\"");
+
+	char buffer[3];
+	for (int i = 0; i < numBytes; i++) {
+		intToHex(data[i], &buffer[0], 2);
+		write(buffer);
+	}
+	write("\"");
+}
+
+void XMLSerializer::writeAttribute(char const* name, char const* value, bool onNewLine) {
+
+	if (onNewLine) {
+		write("\n");
+		printIndents();
+	}
+	else {
+		write(" ");
+	}
+
+	write(name);
+	write("=\"");
+	write(value);
+	write("\"");
+}
+
+void XMLSerializer::writeOpeningTag(char const* tag, bool startNewLineAfter) {
+	writeOpeningTagBeginning(tag);
+	writeOpeningTagEnd(startNewLineAfter);
+}
+
+void XMLSerializer::writeOpeningTagBeginning(char const* tag) {
+	printIndents();
+	write("<");
+	write(tag);
+	indentAmount++;
+}
+
+void XMLSerializer::closeTag() {
+	write(" /");
+	writeOpeningTagEnd();
+	indentAmount--;
+}
+
+void XMLSerializer::writeOpeningTagEnd(bool startNewLineAfter) {
+	if (startNewLineAfter) {
+		write(">\n");
+	}
+	else {
+		write(">");
+	}
+}
+
+void XMLSerializer::writeClosingTag(char const* tag, bool shouldPrintIndents) {
+	indentAmount--;
+	if (shouldPrintIndents) {
+		printIndents();
+	}
+	write("</");
+	write(tag);
+	write(">\n");
+}
+
+void XMLSerializer::printIndents() {
+	for (int32_t i = 0; i < indentAmount; i++) {
+		write("\t");
+	}
+}
+
+Error XMLSerializer::writeXMLBufferToFile() {
+	UINT bytesWritten;
+	FRESULT result =
+	    f_write(&fileSystemStuff.currentFile, writeClusterBuffer, fileWriteBufferCurrentPos, &bytesWritten);
+	if (result != FR_OK || bytesWritten != fileWriteBufferCurrentPos) {
+		return Error::SD_CARD;
+	}
+
+	fileTotalBytesWritten += fileWriteBufferCurrentPos;
+
+	return Error::NONE;
+}
+
+// Returns false if some error, including error while writing
+Error XMLSerializer::closeFileAfterWriting(char const* path, char const* beginningString, char const* endString) {
+	if (fileAccessFailedDuringWrite) {
+		return Error::WRITE_FAIL; // Calling f_close if this is false might be dangerous - if access has failed, we
+		                          // don't want it to flush any data to the card or anything
+	}
+	Error error = writeXMLBufferToFile();
+	if (error != Error::NONE) {
+		return Error::WRITE_FAIL;
+	}
+
+	FRESULT result = f_close(&fileSystemStuff.currentFile);
+	if (result) {
+		return Error::WRITE_FAIL;
+	}
+
+	if (path) {
+		// Check file exists
+		result = f_open(&fileSystemStuff.currentFile, path, FA_READ);
+		if (result) {
+			return Error::WRITE_FAIL;
+		}
+	}
+
+	// Check size
+	if (f_size(&fileSystemStuff.currentFile) != fileTotalBytesWritten) {
+		return Error::WRITE_FAIL;
+	}
+
+	// Check beginning
+	if (beginningString) {
+		UINT dontCare;
+		int32_t length = strlen(beginningString);
+		result = f_read(&fileSystemStuff.currentFile, miscStringBuffer, length, &dontCare);
+		if (result) {
+			return Error::WRITE_FAIL;
+		}
+		if (memcmp(miscStringBuffer, beginningString, length)) {
+			return Error::WRITE_FAIL;
+		}
+	}
+
+	// Check end
+	if (endString) {
+		UINT dontCare;
+		int32_t length = strlen(endString);
+
+		result = f_lseek(&fileSystemStuff.currentFile, fileTotalBytesWritten - length);
+		if (result) {
+			return Error::WRITE_FAIL;
+		}
+
+		result = f_read(&fileSystemStuff.currentFile, miscStringBuffer, length, &dontCare);
+		if (result) {
+			return Error::WRITE_FAIL;
+		}
+		if (memcmp(miscStringBuffer, endString, length)) {
+			return Error::WRITE_FAIL;
+		}
+	}
+
+	result = f_close(&fileSystemStuff.currentFile);
+	if (result) {
+		return Error::WRITE_FAIL;
+	}
+
+	return Error::NONE;
+}
+
+/*******************************************************************************
+
+    XMLDeserializer
+
+********************************************************************************/
+
+#define BETWEEN_TAGS 0
+#define IN_TAG_NAME 1
+#define IN_TAG_PAST_NAME 2
+#define IN_ATTRIBUTE_NAME 3
+#define PAST_ATTRIBUTE_NAME 4
+#define PAST_EQUALS_SIGN 5
+#define IN_ATTRIBUTE_VALUE 6
+
+namespace {
+
+// Which chars end which tokens, for XMLDeserializer::readToken()
+constexpr uint8_t kEndsTagName = 1;
+constexpr uint8_t kEndsAttributeName = 2;
+constexpr uint8_t kIsWhitespace = 4;
+
+constexpr std::array<uint8_t, 256> kCharClasses = [] {
+	std::array<uint8_t, 256> classes{};
+	for (char whitespace : {' ', '\r', '\n', '\t'}) {
+		classes[(uint8_t)whitespace] = kEndsTagName | kEndsAttributeName | kIsWhitespace;
+	}
+	classes['>'] = kEndsTagName | kEndsAttributeName;
+	classes['/'] = kEndsTagName;
+	classes['?'] = kEndsTagName;
+	classes['='] = kEndsAttributeName;
+	return classes;
+}();
+
+// Reads a decimal number the way the firmware always has: an optional '-', then digits up to the first thing that isn't
+// one. Negative numbers too big for an int32_t come back as the most negative one
+int32_t decimalToInt(char const* text) {
+	bool isNegative = (*text == '-');
+	if (isNegative) {
+		text++;
+	}
+	uint32_t number = 0;
+	while (*text >= '0' && *text <= '9') {
+		number = number * 10 + (*text++ - '0');
+	}
+	if (isNegative) {
+		return (number >= 2147483648) ? -2147483648 : -(int32_t)number;
+	}
+	return number;
+}
+
+} // namespace
+
+XMLDeserializer::XMLDeserializer()
+    : xmlArea(BETWEEN_TAGS), xmlReachedEnd(false), tagDepthCaller(0), tagDepthFile(0), xmlReadCount(0), msd(NULL) {
+
+	void* temp = GeneralMemoryAllocator::get().allocLowSpeed(32768 + CACHE_LINE_SIZE * 2);
+	fileClusterBuffer = (char*)temp + CACHE_LINE_SIZE;
+}
+
+XMLDeserializer::~XMLDeserializer() {
+	GeneralMemoryAllocator::get().dealloc(fileClusterBuffer - CACHE_LINE_SIZE);
+}
+
+// Only call this if IN_TAG_NAME
+char const* XMLDeserializer::readTagName() {
+
+	while (true) {
+		char endChar;
+		std::string_view name = readToken(kEndsTagName, &endChar);
+		if (!name.empty()) {
+			tagDepthFile++;
+		}
+
+		switch (endChar) {
+		case '/':
+			// Skipping the rest of the tag could load the next Cluster over the name
+			if (name.data() != stringBuffer) {
+				appendToStringBuffer(0, name.data(), name.size());
+			}
+			tagDepthFile--;
+			skipUntilChar('>');
+			xmlArea = BETWEEN_TAGS;
+			return stringBuffer;
+
+		case '?':
+			if (!name.empty()) {
+				tagDepthFile--;
+			}
+			skipUntilChar('>');
+			skipUntilChar('<');
+			continue;
+
+		case '>':
+			xmlArea = BETWEEN_TAGS;
+			break;
+
+		case 0: // File ended
+			break;
+
+		default: // Whitespace
+			xmlArea = IN_TAG_PAST_NAME;
+		}
+
+		xmlReadDone();
+		return name.data();
+	}
+}
+
+// Only call when IN_TAG_PAST_NAME
+char const* XMLDeserializer::readNextAttributeName() {
+
+	switch (readCharAfterWhitespace()) {
+	case '/':
+		tagDepthFile--;
+		skipUntilChar('>');
+		// No break
+
+	case '>':
+		xmlArea = BETWEEN_TAGS;
+		// No break
+
+	case '<': // This is an error - there definitely shouldn't be a '<' inside a tag! TODO: make way to return error
+	case 0:   // File ended
+		return "";
+	}
+
+	xmlArea = IN_ATTRIBUTE_NAME;
+	tagDepthFile++;
+	fileReadBufferCurrentPos--; // Back onto the name's first char, which is still in the buffer
+
+	char endChar;
+	std::string_view name = readToken(kEndsAttributeName, &endChar);
+	switch (endChar) {
+	case '=':
+		xmlArea = PAST_EQUALS_SIGN;
+		break;
+
+	// If we get a close-tag name, it means we saw some sorta attribute name with no value, which isn't allowed, so
+	// treat it as invalid
+	case '>':
+		xmlArea = BETWEEN_TAGS;
+		return "";
+
+	case 0: // File ended
+		return "";
+
+	default: // Whitespace
+		xmlArea = PAST_ATTRIBUTE_NAME;
+	}
+
+	xmlReadDone();
+	return name.data();
+}
+
+// Reads up to the first char of class endClass, and past it, giving it back in endChar - or 0 if the file ended first.
+// The token's NUL-terminated where it sits in the buffer, unless it ran across Clusters, in which case as much of it as
+// fits is copied to stringBuffer
+std::string_view XMLDeserializer::readToken(uint8_t endClass, char* endChar) {
+	int32_t charPos = 0;
+
+	do {
+		int32_t bufferPosAtStart = fileReadBufferCurrentPos;
+		int32_t pos = fileReadBufferCurrentPos;
+		while (pos < (int32_t)currentReadBufferEndPos && !(kCharClasses[(uint8_t)fileClusterBuffer[pos]] & endClass)) {
+			pos++;
+		}
+		fileReadBufferCurrentPos = pos;
+
+		if (pos < (int32_t)currentReadBufferEndPos) {
+			*endChar = fileClusterBuffer[pos];
+			fileReadBufferCurrentPos++; // Gets us past the endChar
+			if (!charPos) {
+				fileClusterBuffer[pos] = 0;
+				return {&fileClusterBuffer[bufferPosAtStart], (size_t)(pos - bufferPosAtStart)};
+			}
+			charPos = appendToStringBuffer(charPos, &fileClusterBuffer[bufferPosAtStart], pos - bufferPosAtStart);
+			return {stringBuffer, (size_t)charPos};
+		}
+
+		charPos = appendToStringBuffer(charPos, &fileClusterBuffer[bufferPosAtStart], pos - bufferPosAtStart);
+	} while (readXMLFileClusterIfNecessary());
+
+	*endChar = 0;
+	return {stringBuffer, (size_t)charPos};
+}
+
+// Adds chars to what's in stringBuffer, as many as fit, and NUL-terminates it. Returns its new length
+int32_t XMLDeserializer::appendToStringBuffer(int32_t charPos, char const* chars, int32_t numChars) {
+	int32_t numCharsToCopy = std::min<int32_t>(numChars, kFilenameBufferSize - 1 - charPos);
+	if (numCharsToCopy > 0) {
+		memcpy(&stringBuffer[charPos], chars, numCharsToCopy);
+		charPos += numCharsToCopy;
+	}
+	stringBuffer[charPos] = 0;
+	return charPos;
+}
+
+// Where endChar next is in what's left of the buffer - or the end of the buffer, if it's not
+int32_t XMLDeserializer::findInBuffer(char endChar, int32_t endPos) {
+	int32_t numChars = endPos - fileReadBufferCurrentPos;
+	if (numChars <= 0) {
+		return fileReadBufferCurrentPos;
+	}
+	void const* found = memchr(&fileClusterBuffer[fileReadBufferCurrentPos], endChar, numChars);
+	return found ? (char const*)found - fileClusterBuffer : endPos;
+}
+
+// Reads past any whitespace and the char after it, which it returns - or 0 if the file ends first
+char XMLDeserializer::readCharAfterWhitespace() {
+	char thisChar;
+	while (readCharXML(&thisChar)) {
+		if (!(kCharClasses[(uint8_t)thisChar] & kIsWhitespace)) {
+			return thisChar;
+		}
+	}
+	return 0;
+}
+
+// char charAtEndOfValue; // *** JFF get rid of this global!
+
+char const* XMLDeserializer::readNextTagOrAttributeName() {
+
+	char const* toReturn;
+	int32_t tagDepthStart = tagDepthFile;
+
+	switch (xmlArea) {
+
+	default:
+#if ALPHA_OR_BETA_VERSION
+		// Can happen with invalid files, though I'm implementing error checks whenever a user alerts me to a scenario.
+		// Fraser got this, Nov 2021.
+		FREEZE_WITH_ERROR("E365");
+#else
+		__builtin_unreachable();
+#endif
+		break;
+
+	case IN_ATTRIBUTE_VALUE: // Could have been left here during a char-at-a-time read
+		skipUntilChar(charAtEndOfValue);
+		xmlArea = IN_TAG_PAST_NAME;
+		// No break
+
+	case IN_TAG_PAST_NAME:
+		toReturn = readNextAttributeName();
+		// If depth has changed, this means we met a /> and must get out
+		if (*toReturn || tagDepthFile != tagDepthStart) {
+			break;
+		}
+		// No break
+
+	case BETWEEN_TAGS:
+		skipUntilChar('<');
+		xmlArea = IN_TAG_NAME;
+		// No break
+
+	case IN_TAG_NAME:
+		toReturn = readTagName();
+	}
+
+	if (*toReturn) {
+		/*
+		for (int32_t t = 0; t < tagDepthCaller; t++) {
+D_PRINTLN("\t");
+		}
+		D_PRINTLN(toReturn);
+		*/
+		tagDepthCaller++;
+		AudioEngine::logAction(toReturn);
+	}
+
+	return toReturn;
+}
+
+// Only call if PAST_ATTRIBUTE_NAME or PAST_EQUALS_SIGN
+// Returns whether we got into the value, having read its opening quote
+bool XMLDeserializer::getIntoAttributeValue() {
+
+	if (xmlArea != PAST_ATTRIBUTE_NAME && xmlArea != PAST_EQUALS_SIGN) {
+		return false;
+	}
+
+	char thisChar = readCharAfterWhitespace();
+	if (xmlArea == PAST_ATTRIBUTE_NAME) {
+		if (thisChar != '=') {
+			return false; // There shouldn't be any other characters. If there are, that's an error
+		}
+		xmlArea = PAST_EQUALS_SIGN;
+		thisChar = readCharAfterWhitespace();
+	}
+
+	if (thisChar != '"' && thisChar != '\'') {
+		return false; // There shouldn't be any other characters. If there are, that's an error
+	}
+
+	xmlArea = IN_ATTRIBUTE_VALUE;
+	tagDepthFile--;
+	charAtEndOfValue = thisChar;
+	return true;
+}
+
+// Only call if PAST_ATTRIBUTE_NAME or PAST_EQUALS_SIGN
+char const* XMLDeserializer::readAttributeValue() {
+
+	if (!getIntoAttributeValue()) {
+		return "";
+	}
+	xmlArea = IN_TAG_PAST_NAME; // How it'll be after this next call
+	return readUntilChar(charAtEndOfValue);
+}
+
+// Only call if PAST_ATTRIBUTE_NAME or PAST_EQUALS_SIGN
+int32_t XMLDeserializer::readAttributeValueInt() {
+
+	if (!getIntoAttributeValue()) {
+		return 0;
+	}
+	xmlArea = IN_TAG_PAST_NAME; // How it'll be after this next call
+	return readIntUntilChar(charAtEndOfValue);
+}
+
+// Only call if PAST_ATTRIBUTE_NAME or PAST_EQUALS_SIGN
+Error XMLDeserializer::readAttributeValueString(String* string) {
+
+	if (!getIntoAttributeValue()) {
+		string->clear();
+		return Error::NONE;
+	}
+	Error error = readStringUntilChar(string, charAtEndOfValue);
+	if (error == Error::NONE) {
+		xmlArea = IN_TAG_PAST_NAME;
+	}
+	return error;
+}
+
+void XMLDeserializer::xmlReadDone() {
+	xmlReadCount++; // Increment first, cos we don't want to call SD routine immediately when it's 0
+
+	if (!(xmlReadCount & 63)) { // 511 bad. 255 almost fine. 127 almost always fine
+		AudioEngine::routineWithClusterLoading();
+
+		uiTimerManager.routine();
+
+		if (display->haveOLED()) {
+			oledRoutine();
+		}
+		PIC::flush();
+	}
+}
+
+void XMLDeserializer::skipUntilChar(char endChar) {
+
+	readXMLFileClusterIfNecessary(); // Does this need to be here? Originally I didn't have it...
+	do {
+		fileReadBufferCurrentPos = findInBuffer(endChar, currentReadBufferEndPos);
+	} while (fileReadBufferCurrentPos == currentReadBufferEndPos && readXMLFileClusterIfNecessary());
+
+	fileReadBufferCurrentPos++; // Gets us past the endChar
+
+	xmlReadDone();
+}
+
+// Returns memory error. If error, caller must deal with the fact that the end-character hasn't been reached
+Error XMLDeserializer::readStringUntilChar(String* string, char endChar) {
+
+	int32_t newStringPos = 0;
+
+	do {
+		int32_t bufferPosNow = findInBuffer(endChar, currentReadBufferEndPos);
+
+		int32_t numCharsHere = bufferPosNow - fileReadBufferCurrentPos;
+
+		if (numCharsHere) {
+			Error error =
+			    string->concatenateAtPos(&fileClusterBuffer[fileReadBufferCurrentPos], newStringPos, numCharsHere);
+
+			fileReadBufferCurrentPos = bufferPosNow;
+
+			if (error != Error::NONE) {
+				return error;
+			}
+
+			newStringPos += numCharsHere;
+		}
+
+	} while (fileReadBufferCurrentPos == currentReadBufferEndPos && readXMLFileClusterIfNecessary());
+
+	fileReadBufferCurrentPos++; // Gets us past the endChar
+
+	xmlReadDone();
+	return Error::NONE;
+}
+
+char const* XMLDeserializer::readUntilChar(char endChar) {
+	int32_t charPos = 0;
+
+	do {
+		int32_t bufferPosAtStart = fileReadBufferCurrentPos;
+		fileReadBufferCurrentPos = findInBuffer(endChar, currentReadBufferEndPos);
+
+		// If possible, just return a pointer to the chars within the existing buffer
+		if (!charPos && fileReadBufferCurrentPos < currentReadBufferEndPos) {
+			fileClusterBuffer[fileReadBufferCurrentPos] = 0;
+
+			fileReadBufferCurrentPos++; // Gets us past the endChar
+			return &fileClusterBuffer[bufferPosAtStart];
+		}
+
+		int32_t numCharsHere = fileReadBufferCurrentPos - bufferPosAtStart;
+		int32_t numCharsToCopy = std::min<int32_t>(numCharsHere, kFilenameBufferSize - 1 - charPos);
+
+		if (numCharsToCopy > 0) {
+			memcpy(&stringBuffer[charPos], &fileClusterBuffer[bufferPosAtStart], numCharsToCopy);
+
+			charPos += numCharsToCopy;
+		}
+
+	} while (fileReadBufferCurrentPos == currentReadBufferEndPos && readXMLFileClusterIfNecessary());
+
+	fileReadBufferCurrentPos++; // Gets us past the endChar
+
+	xmlReadDone();
+
+	stringBuffer[charPos] = 0;
+	return stringBuffer;
+}
+
+// Unlike readUntilChar(), above, does not put a null character at the end of the returned "string". And, has a preset
+// number of chars. And, returns NULL when nothing more to return. numChars must be <= FILENAME_BUFFER_SIZE
+char const* XMLDeserializer::readNextCharsOfTagOrAttributeValue(int32_t numChars) {
+
+	int32_t charPos = 0;
+
+	do {
+		int32_t bufferPosAtStart = fileReadBufferCurrentPos;
+		int32_t bufferPosAtEnd = bufferPosAtStart + numChars - charPos;
+
+		int32_t currentReadBufferEndPosNow = std::min<int32_t>(currentReadBufferEndPos, bufferPosAtEnd);
+
+		fileReadBufferCurrentPos = findInBuffer(charAtEndOfValue, currentReadBufferEndPosNow);
+		if (fileReadBufferCurrentPos < currentReadBufferEndPosNow) {
+			goto reachedEndCharEarly;
+		}
+
+		int32_t numCharsHere = fileReadBufferCurrentPos - bufferPosAtStart;
+
+		// If we were able to just read the whole thing in one go, just return a pointer to the chars within the
+		// existing buffer
+		if (numCharsHere == numChars) {
+			xmlReadDone();
+			return &fileClusterBuffer[bufferPosAtStart];
+		}
+
+		// Otherwise, so long as we read something, add it to our buffer we're putting the output in
+		if (numCharsHere > 0) {
+			memcpy(&stringBuffer[charPos], &fileClusterBuffer[bufferPosAtStart], numCharsHere);
+
+			charPos += numCharsHere;
+
+			// And if we've now got all the chars we needed, return
+			if (charPos == numChars) {
+				xmlReadDone();
+				return stringBuffer;
+			}
+		}
+
+	} while (fileReadBufferCurrentPos == currentReadBufferEndPos && readXMLFileClusterIfNecessary());
+
+	// If we're here, the file ended
+	return NULL;
+
+	// And, additional bit we jump to when end-char reached
+reachedEndCharEarly:
+	fileReadBufferCurrentPos++; // Gets us past the endChar
+	if (charAtEndOfValue == '<') {
+		xmlArea = IN_TAG_NAME;
+	}
+	else {
+		xmlArea = IN_TAG_PAST_NAME; // Could be ' or "
+	}
+	return NULL;
+}
+
+// The chars are decoded into stringBuffer - in place, if that's where they already are
+uint8_t const* XMLDeserializer::readNextHexBytesOfTagOrAttributeValue(int32_t numBytes) {
+	char const* hexChars = readNextCharsOfTagOrAttributeValue(numBytes * 2);
+	if (!hexChars) {
+		return NULL;
+	}
+	uint8_t* bytes = (uint8_t*)stringBuffer;
+	for (int32_t i = 0; i < numBytes; i++) {
+		bytes[i] = hexToIntFixedLength(&hexChars[i * 2], 2);
+	}
+	return bytes;
+}
+
+// This is almost never called now - TODO: get rid
+char XMLDeserializer::readNextCharOfTagOrAttributeValue() {
+
+	char thisChar;
+	if (!readCharXML(&thisChar)) {
+		return 0;
+	}
+	if (thisChar == charAtEndOfValue) {
+		if (charAtEndOfValue == '<') {
+			xmlArea = IN_TAG_NAME;
+		}
+		else {
+			xmlArea = IN_TAG_PAST_NAME; // Could be ' or "
+		}
+		xmlReadDone();
+		return 0;
+	}
+	return thisChar;
+}
+
+// Will always skip up until the end-char, even if it doesn't like the contents it sees
+int32_t XMLDeserializer::readIntUntilChar(char endChar) {
+	return decimalToInt(readUntilChar(endChar));
+}
+
+char const* XMLDeserializer::readTagOrAttributeValue() {
+
+	switch (xmlArea) {
+
+	case BETWEEN_TAGS:
+		xmlArea = IN_TAG_NAME; // How it'll be after this call
+		return readUntilChar('<');
+
+	case PAST_ATTRIBUTE_NAME:
+	case PAST_EQUALS_SIGN:
+		return readAttributeValue();
+
+	case IN_TAG_PAST_NAME: // Could happen if trying to read a value but instead of a value there are multiple more
+	                       // contents, like attributes etc. Obviously not "meant" to happen, but we need to cope.
+		return "";
+
+	default:
+		FREEZE_WITH_ERROR("BBBB");
+		__builtin_unreachable();
+	}
+}
+
+int32_t XMLDeserializer::readTagOrAttributeValueInt() {
+
+	switch (xmlArea) {
+
+	case BETWEEN_TAGS:
+		xmlArea = IN_TAG_NAME; // How it'll be after this call
+		return readIntUntilChar('<');
+
+	case PAST_ATTRIBUTE_NAME:
+	case PAST_EQUALS_SIGN:
+		return readAttributeValueInt();
+
+	case IN_TAG_PAST_NAME: // Could happen if trying to read a value but instead of a value there are multiple more
+	                       // contents, like attributes etc. Obviously not "meant" to happen, but we need to cope.
+		return 0;
+
+	default:
+		FREEZE_WITH_ERROR("BBBB");
+		__builtin_unreachable();
+	}
+}
+
+// This isn't super optimal, like the int32_t version is, but only rarely used
+int32_t XMLDeserializer::readTagOrAttributeValueHex(int32_t errorValue) {
+	char const* string = readTagOrAttributeValue();
+	if (string[0] != '0' || string[1] != 'x') {
+		return errorValue;
+	}
+	return hexToInt(&string[2]);
+}
+
+int XMLDeserializer::readTagOrAttributeValueHexBytes(uint8_t* bytes, int32_t maxLen) {
+	switch (xmlArea) {
+
+	case BETWEEN_TAGS:
+		xmlArea = IN_TAG_NAME; // How it'll be after this call
+		return readHexBytesUntil(bytes, maxLen, '<');
+
+	case PAST_ATTRIBUTE_NAME:
+	case PAST_EQUALS_SIGN:
+		if (!getIntoAttributeValue())
+			return 0;
+		xmlArea = IN_TAG_PAST_NAME; // How it'll be after this next call
+		return readHexBytesUntil(bytes, maxLen, charAtEndOfValue);
+
+	case IN_TAG_PAST_NAME: // Could happen if trying to read a value but instead of a value there are multiple more
+	                       // contents, like attributes etc. Obviously not "meant" to happen, but we need to cope.
+		return 0;
+
+	default:
+		FREEZE_WITH_ERROR("BBBB");
+		__builtin_unreachable();
+	}
+}
+
+bool getNibble(char ch, int* nibble) {
+	if ('0' <= ch and ch <= '9') {
+		*nibble = ch - '0';
+	}
+	else if ('a' <= ch and ch <= 'f') {
+		*nibble = ch - 'a' + 10;
+	}
+	else if ('A' <= ch and ch <= 'F') {
+		*nibble = ch - 'A' + 10;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+int XMLDeserializer::readHexBytesUntil(uint8_t* bytes, int32_t maxLen, char endChar) {
+	int read;
+	char thisChar;
+
+	for (read = 0; read < maxLen; read++) {
+		int highNibble, lowNibble;
+
+		if (!readCharXML(&thisChar))
+			return 0;
+		if (!getNibble(thisChar, &highNibble)) {
+			goto getOut;
+		}
+
+		if (!readCharXML(&thisChar))
+			return 0;
+		if (!getNibble(thisChar, &lowNibble)) {
+			goto getOut;
+		}
+
+		bytes[read] = (highNibble << 4) + lowNibble;
+	}
+getOut:
+	if (thisChar != endChar) {
+		skipUntilChar(endChar);
+	}
+	return read;
+}
+
+// Returns memory error
+Error XMLDeserializer::readTagOrAttributeValueString(String* string) {
+
+	Error error;
+
+	switch (xmlArea) {
+	case BETWEEN_TAGS:
+		error = readStringUntilChar(string, '<');
+		if (error == Error::NONE) {
+			xmlArea = IN_TAG_NAME;
+		}
+		return error;
+
+	case PAST_ATTRIBUTE_NAME:
+	case PAST_EQUALS_SIGN:
+		return readAttributeValueString(string);
+
+	case IN_TAG_PAST_NAME: // Could happen if trying to read a value but instead of a value there are multiple more
+	                       // contents, like attributes etc. Obviously not "meant" to happen, but we need to cope.
+		return Error::FILE_CORRUPTED;
+
+	default:
+		if (ALPHA_OR_BETA_VERSION) {
+			FREEZE_WITH_ERROR("BBBB");
+		}
+		__builtin_unreachable();
+	}
+}
+
+int32_t XMLDeserializer::getNumCharsRemainingInValue() {
+	return findInBuffer(charAtEndOfValue, currentReadBufferEndPos) - fileReadBufferCurrentPos;
+}
+
+// Returns whether we're all good to go
+bool XMLDeserializer::prepareToReadTagOrAttributeValueOneCharAtATime() {
+	switch (xmlArea) {
+
+	case BETWEEN_TAGS:
+		// xmlArea = IN_TAG_NAME; // How it'll be after reading all chars
+		charAtEndOfValue = '<';
+		return true;
+
+	case PAST_ATTRIBUTE_NAME:
+	case PAST_EQUALS_SIGN:
+		return getIntoAttributeValue();
+
+	default:
+		if (ALPHA_OR_BETA_VERSION) {
+			FREEZE_WITH_ERROR("CCCC");
+		}
+		__builtin_unreachable();
+	}
+}
+
+// Returns whether successful loading took place
+bool XMLDeserializer::readXMLFileClusterIfNecessary() {
+
+	// Load next Cluster if necessary
+	if (fileReadBufferCurrentPos >= audioFileManager.clusterSize) {
+		xmlReadCount = 0;
+		bool result = readXMLFileCluster();
+		if (!result) {
+			xmlReachedEnd = true;
+		}
+		return result;
+	}
+
+	// Watch out for end of file
+	if (fileReadBufferCurrentPos >= currentReadBufferEndPos) {
+		xmlReachedEnd = true;
+	}
+
+	return false;
+}
+
+void XMLDeserializer::stopReading() {
+	fileReadBufferCurrentPos = 0;
+	currentReadBufferEndPos = 0;
+	xmlReachedEnd = true;
+}
+
+bool XMLDeserializer::readXMLFileCluster() {
+
+	AudioEngine::logAction("readXMLFileCluster");
+
+	FRESULT result = f_read(&fileSystemStuff.currentFile, (UINT*)fileClusterBuffer, audioFileManager.clusterSize,
+	                        &currentReadBufferEndPos);
+	if (result) {
+		fileAccessFailedDuring = true;
+		return false;
+	}
+
+	// If error or we reached end of file
+	if (!currentReadBufferEndPos) {
+		return false;
+	}
+
+	fileReadBufferCurrentPos = 0;
+
+	return true;
+}
+
+uint32_t XMLDeserializer::readCharXML(char* thisChar) {
+
+	// Most of the time there's no Cluster to load or end to watch for
+	if (fileReadBufferCurrentPos < currentReadBufferEndPos) {
+		*thisChar = fileClusterBuffer[fileReadBufferCurrentPos++];
+		return 1;
+	}
+
+	bool stillGoing = readXMLFileClusterIfNecessary();
+	if (xmlReachedEnd) {
+		return 0;
+	}
+
+	*thisChar = fileClusterBuffer[fileReadBufferCurrentPos];
+
+	fileReadBufferCurrentPos++;
+
+	return 1;
+}
+
+void XMLDeserializer::exitTag(char const* exitTagName) {
+	// back out the file depth to one less than the caller depth
+	while (tagDepthFile >= tagDepthCaller) {
+
+		if (xmlReachedEnd) {
+			return;
+		}
+
+		switch (xmlArea) {
+
+		case IN_ATTRIBUTE_VALUE: // Could get left in here after a char-at-a-time read
+			skipUntilChar(charAtEndOfValue);
+			xmlArea = IN_TAG_PAST_NAME;
+			// No break
+
+		case IN_TAG_PAST_NAME:
+			readNextAttributeName();
+			break;
+
+		case PAST_ATTRIBUTE_NAME:
+		case PAST_EQUALS_SIGN:
+			readAttributeValue();
+			break;
+
+		case BETWEEN_TAGS:
+			skipUntilChar('<');
+			xmlArea = IN_TAG_NAME;
+			// Got to next tag start
+			// No break
+
+		case IN_TAG_NAME:
+			readTagName();
+			break;
+
+		default:
+			if (ALPHA_OR_BETA_VERSION) {
+				FREEZE_WITH_ERROR("AAAA"); // Really shouldn't be possible anymore, I feel fairly certain...
+			}
+			__builtin_unreachable();
+		}
+	}
+	// It is possible for caller and file tag depths to get out of sync due to faulty error handling
+	// On exit reset the caller depth to match tag depth. File depth represents the parsers view of
+	// where we are in the xml parsing, caller depth represents the callers view. The caller can be shallower
+	// as the file will open past empty or unused tags, but should never be deeper.
+	tagDepthCaller = tagDepthFile;
+}
+
+Error XMLDeserializer::openXMLFile(FilePointer* filePointer, char const* firstTagName, char const* altTagName,
+                                   bool ignoreIncorrectFirmware) {
+
+	AudioEngine::logAction("openXMLFile");
+
+	startReadingFile(filePointer);
+
+	firmware_version = FirmwareVersion{FirmwareVersion::Type::OFFICIAL, {}};
+
+	char const* tagName;
+
+	while (*(tagName = readNextTagOrAttributeName())) {
+
+		if (!strcmp(tagName, firstTagName) || !strcmp(tagName, altTagName)) {
+			return Error::NONE;
+		}
+
+		Error result = tryReadingFirmwareTagFromFile(tagName, ignoreIncorrectFirmware);
+		if (result != Error::NONE && result != Error::RESULT_TAG_UNUSED) {
+			return result;
+		}
+		exitTag(tagName);
+	}
+
+	f_close(&fileSystemStuff.currentFile);
+	return Error::FILE_CORRUPTED;
+}
+
+void XMLDeserializer::startReadingFile(FilePointer* filePointer) {
+	msd->openFilePointer(filePointer);
+	fileAccessFailedDuring = false; // openFilePointer() only does this for smDeserializer
+
+	// Prep to read first Cluster shortly
+	fileReadBufferCurrentPos = audioFileManager.clusterSize;
+	currentReadBufferEndPos = audioFileManager.clusterSize;
+
+	tagDepthFile = 0;
+	tagDepthCaller = 0;
+	xmlReachedEnd = false;
+	xmlArea = BETWEEN_TAGS;
+}
+
+bool XMLDeserializer::isAtTagContent() {
+	return xmlArea == BETWEEN_TAGS;
+}
+
+bool XMLDeserializer::isAtAttributeValue() {
+	return xmlArea == PAST_ATTRIBUTE_NAME || xmlArea == PAST_EQUALS_SIGN;
+}
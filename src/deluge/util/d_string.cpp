@@ -372,3 +372,11 @@ uint32_t hexToIntFixedLength(char const* __restrict__ hexChars, int32_t length)
 
 	return output;
 }
+
+uint32_t bytesToIntBigEndian(uint8_t const* bytes, int32_t length) {
+	uint32_t output = 0;
+	for (int32_t i = 0; i < length; i++) {
+		output = (output << 8) | bytes[i];
+	}
+	return output;
+}
@@ -36,6 +36,8 @@ char halfByteToHexChar(uint8_t thisHalfByte);
 void intToHex(uint32_t number, char* output, int32_t numChars = 8);
 uint32_t hexToInt(char const* string);
 uint32_t hexToIntFixedLength(char const* __restrict__ hexChars, int32_t length);
+// What hexToIntFixedLength() gives for the chars these bytes were read from. length must be >0 and <= 4
+uint32_t bytesToIntBigEndian(uint8_t const* bytes, int32_t length);
 
 void byteToHex(uint8_t number, char* buffer);
 uint8_t hexToByte(char const* firstChar);
@@ -16,6 +16,7 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 // signed 31 fractional bits (e.g. one would be 1<<31 but can't be represented)
 using q31_t = int32_t;
@@ -84,6 +85,7 @@ inline int32_t clz(uint32_t input) {
 	return out;
 }
 #else
+// Portable versions matching the ARM instructions bit for bit, so host builds render exactly what the hardware does
 
 static inline q31_t multiply_32x32_rshift32(q31_t a, q31_t b) {
 	return (q31_t)(((int64_t)a * (int64_t)b) >> 32);
@@ -92,33 +94,37 @@ static inline q31_t multiply_32x32_rshift32(q31_t a, q31_t b) {
 // This multiplies two numbers in signed Q31 fixed point and rounds the result
 
 static inline q31_t multiply_32x32_rshift32_rounded(q31_t a, q31_t b) {
-	return (q31_t)(((int64_t)a * (int64_t)b) >> 32);
+	return (q31_t)(((int64_t)a * (int64_t)b + 0x80000000ll) >> 32);
 }
 
 // Multiplies A and B, adds to sum, and returns output
 
 static inline q31_t multiply_accumulate_32x32_rshift32_rounded(q31_t sum, q31_t a, q31_t b) {
-	return sum + (q31_t)(((int64_t)a * (int64_t)b) >> 32);
+	return (q31_t)((((uint64_t)(uint32_t)sum << 32) + (uint64_t)((int64_t)a * (int64_t)b) + 0x80000000ull) >> 32);
 }
 
 // Multiplies A and B, subtracts from sum, and returns output
 
 static inline q31_t multiply_subtract_32x32_rshift32_rounded(q31_t sum, q31_t a, q31_t b) {
-	return sum - (q31_t)(((int64_t)a * (int64_t)b) >> 32);
+	return (q31_t)((((uint64_t)(uint32_t)sum << 32) - (uint64_t)((int64_t)a * (int64_t)b) + 0x80000000ull) >> 32);
 }
 
 // computes limit((val >> rshift), 2**bits)
 template <uint8_t bits>
 static inline int32_t signed_saturate(int32_t val) {
-	return std::min(val, 1 << bits);
+	return std::clamp(val, -(int32_t)(1u << (bits - 1)), (int32_t)((1u << (bits - 1)) - 1));
 }
 
 static inline int32_t add_saturation(int32_t a, int32_t b) __attribute__((always_inline, unused));
 static inline int32_t add_saturation(int32_t a, int32_t b) {
-	return a + b;
+	int32_t out;
+	if (__builtin_add_overflow(a, b, &out)) {
+		return a < 0 ? INT32_MIN : INT32_MAX;
+	}
+	return out;
 }
 
 inline int32_t clz(uint32_t input) {
-	return __builtin_clz(input);
+	return input ? __builtin_clz(input) : 32;
 }
 #endif
@@ -417,15 +417,23 @@ void dissectIterationDependence(int32_t probability, int32_t* getDivisor, int32_
 int32_t encodeIterationDependence(int32_t divisor, int32_t iterationWithinDivisor);
 
 [[gnu::always_inline]] inline uint32_t swapEndianness32(uint32_t input) {
+#if defined(__arm__)
 	int32_t out;
 	asm("rev %0, %1" : "=r"(out) : "r"(input));
 	return out;
+#else
+	return __builtin_bswap32(input);
+#endif
 }
 
 [[gnu::always_inline]] inline uint32_t swapEndianness2x16(uint32_t input) {
+#if defined(__arm__)
 	int32_t out;
 	asm("rev16 %0, %1" : "=r"(out) : "r"(input));
 	return out;
+#else
+	return __builtin_bswap32(input) >> 16 | __builtin_bswap32(input) << 16;
+#endif
 }
 
 [[gnu::always_inline]] inline int32_t getMagnitudeOld(uint32_t input) {
@@ -1,3 +1,7 @@
 #include "util/waves.h"
 
+#if THREAD_LOCAL_NOISE
+thread_local uint32_t jcong = 380116160;
+#else
 uint32_t jcong = 380116160;
+#endif
@@ -4,7 +4,14 @@
 
 #define CONG (jcong = 69069 * jcong + 1234567)
 
-extern uint32_t z, w, jcong;
+extern uint32_t z, w;
+#if THREAD_LOCAL_NOISE
+// Only for the host render benchmarks, whose stem export harness renders on more than one thread at a time, each with
+// noise of its own
+extern thread_local uint32_t jcong;
+#else
+extern uint32_t jcong;
+#endif
 
 /* Basic waveform generation functions.
  *
@@ -0,0 +1,400 @@
+// Replays an allocation trace recorded on a Deluge (see memory/allocation_trace.h and `dbt allocation-trace`) against
+// MemoryRegions laid out like the Deluge's, and reports what happened to the memory along the way.
+//
+// usage: AllocationTraceReplay [trace.bin] [number of fragmentation samples]
+//
+// Without a trace file a synthetic song-load trace is generated and replayed, which is what ctest runs.
+//
+// The replay follows the same policy as GeneralMemoryAllocator::alloc, so changes to the allocator can be compared
+// against the same trace. Stealables are modelled as always stealable once they've been queued - the trace doesn't
+// know when something took them off their queue again - so steal counts are an upper bound. Operations on memory
+// the replay didn't allocate (because the ring buffer wrapped, or the replay stole it) are counted and skipped.
+
+#include "memory/allocation_trace.h"
+#include "memory/general_memory_allocator.h"
+#include "memory/memory_region.h"
+#include "memory/slab_allocator.h"
+#include "memory/stealable.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Op = AllocationTrace::Op;
+using Record = AllocationTrace::Record;
+
+constexpr int32_t kStealable = 0;
+constexpr int32_t kInternal = 1;
+constexpr int32_t kExternal = 2;
+constexpr int32_t kNumRegions = 3;
+constexpr int32_t kNumOps = 5;
+const char* const kRegionNames[kNumRegions] = {"stealable", "internal", "external"};
+const char* const kOpNames[kNumOps] = {"alloc", "dealloc", "extend", "shortenRight", "queueStealable"};
+
+class Replayer;
+
+class ReplayStealable : public Stealable {
+public:
+	ReplayStealable(Replayer& replayer, uint32_t traceAddress, StealableQueue queue)
+	    : replayer(replayer), traceAddress(traceAddress), queue(queue) {}
+	// on the Deluge, a stealable which isn't queued is in use
+	bool mayBeStolen(void* thingNotToStealFrom) override { return list != nullptr; }
+	void steal(char const* errorCode) override;
+	StealableQueue getAppropriateQueue() override { return queue; }
+
+	Replayer& replayer;
+	uint32_t traceAddress;
+	StealableQueue queue;
+};
+
+struct OpTiming {
+	uint32_t count;
+	double totalNs;
+	double maxNs;
+};
+
+class Replayer {
+public:
+	Replayer(const uint32_t (&regionSizes)[kNumRegions]) {
+		for (int32_t r = 0; r < kNumRegions; r++) {
+			uint32_t emptySpacesSize = sizeof(EmptySpaceRecord) * 1024;
+			emptySpacesMemory[r] = malloc(emptySpacesSize);
+			memory[r] = malloc(regionSizes[r]);
+			memset(emptySpacesMemory[r], 0, emptySpacesSize);
+			// like the firmware, only the stealable region gets a run index
+			uint32_t runsSize = (r == kStealable) ? sizeof(StealableRun) * 1024 : 0;
+			runsMemory[r] = runsSize ? malloc(runsSize) : nullptr;
+			regions[r].setup(emptySpacesMemory[r], emptySpacesSize, (uint32_t)memory[r],
+			                 (uint32_t)memory[r] + regionSizes[r], runsMemory[r], runsSize);
+			sizes[r] = regionSizes[r];
+		}
+		slabs.setup(&regions[kInternal]);
+	}
+
+	void replay(const std::vector<Record>& trace, int32_t numSamples) {
+		uint32_t sampleInterval = std::max<uint32_t>(1, trace.size() / std::max(1, numSamples));
+		std::cout << "replaying " << trace.size() << " operations" << std::endl;
+		std::cout << "  op        region     live bytes    peak bytes  empty spaces  largest empty  fragmentation"
+		          << std::endl;
+		for (uint32_t i = 0; i < trace.size(); i++) {
+			const Record& record = trace[i];
+			if ((uint8_t)record.op >= kNumOps) {
+				skipped++;
+				continue;
+			}
+			auto start = std::chrono::steady_clock::now();
+			bool done = apply(record);
+			auto end = std::chrono::steady_clock::now();
+			if (done) {
+				OpTiming& timing = timings[(uint8_t)record.op];
+				double ns = std::chrono::duration<double, std::nano>(end - start).count();
+				timing.count++;
+				timing.totalNs += ns;
+				timing.maxNs = std::max(timing.maxNs, ns);
+			}
+			else {
+				skipped++;
+			}
+			if (i % sampleInterval == sampleInterval - 1 || i == trace.size() - 1) {
+				printSample(i + 1);
+			}
+		}
+	}
+
+	void report() {
+		std::cout << std::endl << "peak usage:" << std::endl;
+		for (int32_t r = 0; r < kNumRegions; r++) {
+			std::cout << "  " << kRegionNames[r] << ": " << peakBytes[r] << " of " << sizes[r] << " bytes" << std::endl;
+		}
+		std::cout << "  slab pools: " << slabs.stats().peakBytesHeld << " bytes held, " << slabs.hitRatePercent()
+		          << "% of small requests served" << std::endl;
+
+		std::cout << "steals per queue:" << std::endl;
+		for (int32_t q = 0; q < kNumStealableQueue; q++) {
+			if (steals[q]) {
+				std::cout << "  queue " << q << ": " << steals[q] << std::endl;
+			}
+		}
+		std::cout << "failed allocations: " << failedAllocations << " in the replay, " << failedOnDevice
+		          << " on the device" << std::endl;
+		std::cout << "skipped operations: " << skipped << std::endl;
+
+		std::cout << "time per operation:" << std::endl;
+		for (int32_t op = 0; op < kNumOps; op++) {
+			if (timings[op].count) {
+				std::cout << "  " << kOpNames[op] << ": " << timings[op].count << " calls, mean "
+				          << timings[op].totalNs / timings[op].count << " ns, max " << timings[op].maxNs << " ns"
+				          << std::endl;
+			}
+		}
+	}
+
+	void stolen(ReplayStealable* stealable) {
+		steals[util::to_underlying(stealable->queue)]++;
+		liveBytes[kStealable] -= getAllocatedSize(stealable);
+		addresses.erase(stealable->traceAddress);
+		stealables.erase((uint32_t)stealable);
+	}
+
+	uint32_t failedAllocations = 0;
+
+private:
+	static uint32_t getAllocatedSize(void* address) { return *(uint32_t*)((uint32_t)address - 4) & SPACE_SIZE_MASK; }
+
+	int32_t regionOf(void* address) {
+		for (int32_t r = 0; r < kNumRegions; r++) {
+			if ((uint32_t)address >= regions[r].start && (uint32_t)address < regions[r].end) {
+				return r;
+			}
+		}
+		return -1;
+	}
+
+	void* lookUp(uint32_t traceAddress) {
+		auto found = addresses.find(traceAddress);
+		return found == addresses.end() ? nullptr : found->second;
+	}
+
+	void track(uint32_t traceAddress, void* address, int32_t sizeChange) {
+		int32_t r = regionOf(address);
+		liveBytes[r] += sizeChange;
+		peakBytes[r] = std::max(peakBytes[r], liveBytes[r]);
+		addresses[traceAddress] = address;
+	}
+
+	// Same policy as GeneralMemoryAllocator::alloc
+	void* alloc(uint32_t size, uint8_t flags) {
+		if (!(flags & AllocationTrace::kFlagMakeStealable)) {
+			if (flags & AllocationTrace::kFlagMayUseOnChipRam) {
+				if (size && size <= SlabAllocator::kMaxSize) {
+					if (void* address = slabs.alloc(size)) {
+						return address;
+					}
+				}
+				if (void* address = regions[kInternal].alloc(size, false, nullptr)) {
+					return address;
+				}
+			}
+			if (void* address = regions[kExternal].alloc(size, false, nullptr)) {
+				return address;
+			}
+		}
+		return regions[kStealable].alloc(size, flags & AllocationTrace::kFlagMakeStealable, nullptr);
+	}
+
+	bool apply(const Record& record) {
+		switch (record.op) {
+		case Op::ALLOC: {
+			if (!record.address) {
+				failedOnDevice++;
+				return false;
+			}
+			void* address = alloc(record.size, record.flags);
+			if (!address) {
+				failedAllocations++;
+				return true;
+			}
+			track(record.address, address, getAllocatedSize(address));
+			if (record.flags & AllocationTrace::kFlagMakeStealable) {
+				// the region may look at it as a neighbour of something it's stealing before it's ever queued
+				stealables[(uint32_t)address] =
+				    new (address) ReplayStealable(*this, record.address, StealableQueue{kNumStealableQueue - 1});
+			}
+			return true;
+		}
+
+		case Op::DEALLOC: {
+			void* address = lookUp(record.address);
+			if (!address) {
+				return false;
+			}
+			if (auto found = stealables.find((uint32_t)address); found != stealables.end()) {
+				if (found->second->list) {
+					found->second->remove();
+				}
+				stealables.erase(found);
+			}
+			liveBytes[regionOf(address)] -= getAllocatedSize(address);
+			addresses.erase(record.address);
+			if (SlabAllocator::isSlabAllocation(address)) {
+				slabs.dealloc(address);
+			}
+			else {
+				regions[regionOf(address)].dealloc(address);
+			}
+			return true;
+		}
+
+		case Op::EXTEND: {
+			void* address = lookUp(record.address);
+			if (!address || SlabAllocator::isSlabAllocation(address)) {
+				return address != nullptr;
+			}
+			uint32_t oldSize = getAllocatedSize(address);
+			uint32_t extendedLeft = 0;
+			uint32_t extendedRight = 0;
+			regions[regionOf(address)].extend(address, record.size, record.arg, &extendedLeft, &extendedRight,
+			                                  nullptr);
+			if (extendedLeft || extendedRight) {
+				void* newAddress = (char*)address - extendedLeft;
+				addresses.erase(record.address);
+				track(record.result, newAddress, getAllocatedSize(newAddress) - oldSize);
+			}
+			else if (record.result != record.address) {
+				// it moved on the device but not here - keep following it under its new name
+				addresses.erase(record.address);
+				addresses[record.result] = address;
+			}
+			return true;
+		}
+
+		case Op::SHORTEN_RIGHT: {
+			void* address = lookUp(record.address);
+			if (!address || SlabAllocator::isSlabAllocation(address)) {
+				return address != nullptr;
+			}
+			uint32_t oldSize = getAllocatedSize(address);
+			uint32_t newSize = regions[regionOf(address)].shortenRight(address, record.size);
+			liveBytes[regionOf(address)] -= oldSize - newSize;
+			return true;
+		}
+
+		case Op::QUEUE_STEALABLE: {
+			void* address = lookUp(record.address);
+			if (!address || regionOf(address) != kStealable) {
+				return false;
+			}
+			auto queue = static_cast<StealableQueue>(std::min<uint32_t>(record.arg, kNumStealableQueue - 1));
+			auto found = stealables.find((uint32_t)address);
+			if (found == stealables.end()) {
+				return false;
+			}
+			ReplayStealable* stealable = found->second;
+			if (stealable->list) {
+				stealable->remove();
+			}
+			stealable->queue = queue;
+			regions[kStealable].cache_manager().QueueForReclamation(queue, stealable);
+			return true;
+		}
+		}
+		return false;
+	}
+
+	void printSample(uint32_t numOps) {
+		for (int32_t r = 0; r < kNumRegions; r++) {
+			OrderedResizeableArrayWithMultiWordKey& emptySpaces = regions[r].emptySpaces;
+			uint64_t emptyBytes = 0;
+			for (int32_t i = 0; i < emptySpaces.getNumElements(); i++) {
+				emptyBytes += emptySpaces.getKeyAtIndex(i);
+			}
+			// the empty spaces are sorted by length, so the last is the largest
+			uint32_t largest = emptySpaces.getNumElements() ? emptySpaces.getKeyAtIndex(emptySpaces.getNumElements() - 1)
+			                                                : 0;
+			double fragmentation = emptyBytes ? 1.0 - (double)largest / emptyBytes : 0;
+			printf("  %-9u %-10s %10u    %10u    %10d    %11u    %11.3f\n", numOps, kRegionNames[r], liveBytes[r],
+			       peakBytes[r], emptySpaces.getNumElements(), largest, fragmentation);
+		}
+	}
+
+	MemoryRegion regions[kNumRegions];
+	SlabAllocator slabs;
+	void* memory[kNumRegions];
+	void* emptySpacesMemory[kNumRegions];
+	void* runsMemory[kNumRegions];
+	uint32_t sizes[kNumRegions];
+
+	// address on the device -> address in the replay
+	std::unordered_map<uint32_t, void*> addresses;
+	std::unordered_map<uint32_t, ReplayStealable*> stealables;
+
+	uint32_t liveBytes[kNumRegions] = {0};
+	uint32_t peakBytes[kNumRegions] = {0};
+	uint32_t steals[kNumStealableQueue] = {0};
+	uint32_t failedOnDevice = 0;
+	uint32_t skipped = 0;
+	OpTiming timings[kNumOps] = {};
+};
+
+void ReplayStealable::steal(char const* errorCode) {
+	replayer.stolen(this);
+}
+
+// Roughly what a song load looks like: lots of small objects for the song structure, some of which are temporaries,
+// and audio clusters which get queued for stealing once they've been read.
+std::vector<Record> makeSyntheticTrace() {
+	srand(6);
+	std::vector<Record> trace;
+	std::vector<uint32_t> live;
+	uint32_t nextAddress = 0x1000;
+	auto add = [&](Op op, uint32_t address, uint32_t size, uint32_t arg, uint8_t flags) {
+		trace.push_back({address, size, arg, 0, op, 0, flags, (uint8_t)trace.size()});
+	};
+
+	for (int32_t i = 0; i < 30000; i++) {
+		int32_t r = rand() % 100;
+		uint32_t address = nextAddress;
+		nextAddress += 0x10;
+		if (r < 70) {
+			add(Op::ALLOC, address, 8 + rand() % 240, 0, AllocationTrace::kFlagMayUseOnChipRam);
+			live.push_back(address);
+		}
+		else if (r < 73) {
+			add(Op::ALLOC, address, 256 + rand() % 8192, 0, 0);
+			live.push_back(address);
+		}
+		else if (r < 83) {
+			// a cluster of audio data, stealable once it's been queued
+			add(Op::ALLOC, address, 32768 + 64, 0, AllocationTrace::kFlagMakeStealable);
+			add(Op::QUEUE_STEALABLE, address, 32768 + 64, rand() % kNumStealableQueue, 0);
+		}
+		else if (!live.empty()) {
+			uint32_t index = rand() % live.size();
+			add(Op::DEALLOC, live[index], 0, 0, 0);
+			live[index] = live.back();
+			live.pop_back();
+		}
+	}
+	for (uint32_t address : live) {
+		add(Op::DEALLOC, address, 0, 0, 0);
+	}
+	return trace;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	std::vector<Record> trace;
+	// stealable, internal, external - roughly as on the Deluge
+	uint32_t regionSizes[kNumRegions] = {52 << 20, 1536 << 10, RESERVED_EXTERNAL_ALLOCATOR};
+
+	if (argc > 1) {
+		FILE* file = fopen(argv[1], "rb");
+		if (!file) {
+			std::cerr << "couldn't open " << argv[1] << std::endl;
+			return 1;
+		}
+		Record record;
+		while (fread(&record, sizeof(record), 1, file) == 1) {
+			trace.push_back(record);
+		}
+		fclose(file);
+	}
+	else {
+		trace = makeSyntheticTrace();
+		// small enough that the clusters have to be stolen
+		regionSizes[kStealable] = 16 << 20;
+	}
+
+	int32_t numSamples = argc > 2 ? atoi(argv[2]) : 10;
+	Replayer replayer(regionSizes);
+	replayer.replay(trace, numSamples);
+	replayer.report();
+	return 0;
+}
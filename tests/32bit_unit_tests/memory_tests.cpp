@@ -1,13 +1,18 @@
 #include "CppUTest/TestHarness.h"
 #include "CppUTestExt/MockSupport.h"
 #include "definitions_cxx.hpp"
+#include "memory/allocation_trace.h"
 #include "memory/memory_region.h"
+#include "memory/realtime_reserve.h"
+#include "memory/slab_allocator.h"
 #include "model/sample/sample.h"
 #include "storage/cluster/cluster.h"
 #include "storage/wave_table/wave_table.h"
 #include "util/functions.h"
+#include <chrono>
 #include <iostream>
 #include <stdlib.h>
+#include <vector>
 #define NUM_TEST_ALLOCATIONS 1024
 #define MEM_SIZE 10000000
 
@@ -27,9 +32,11 @@ public:
 		nSteals += 1;
 		totalAllocated -= getAllocatedSize(this);
 	}
-	bool mayBeStolen(void* thingNotToStealFrom) { return true; }
+	bool mayBeStolen(void* thingNotToStealFrom) { return !inUse; }
 	StealableQueue getAppropriateQueue() { return StealableQueue{0}; }
 	int32_t testIndex;
+	bool inUse = false; // like a Cluster that's currently loaded
+
 };
 
 bool testReadingMemory(void* address, uint32_t size) {
@@ -331,4 +338,600 @@ TEST(MemoryAllocation, stealableAllocations) {
 	CHECK(efficiency > 0.994);
 	mock().checkExpectations();
 };
+
+TEST_GROUP(StealableRuns) {
+	MemoryRegion memreg;
+	uint32_t empty_spaze_size = sizeof(EmptySpaceRecord) * 512;
+	void* emptySpacesMemory = malloc(empty_spaze_size);
+	uint32_t runs_size = sizeof(StealableRun) * 1024;
+	void* runsMemory = malloc(runs_size);
+	int32_t mem_size = MEM_SIZE;
+	void* raw_mem = malloc(mem_size);
+	void setup() {
+		nSteals = 0;
+		memset(raw_mem, 0, mem_size);
+		memset(emptySpacesMemory, 0, empty_spaze_size);
+		memreg.setup(emptySpacesMemory, empty_spaze_size, (uint32_t)raw_mem, (uint32_t)raw_mem + mem_size, runsMemory,
+		             runs_size);
+	}
+	void teardown() { mock().clear(); }
+};
+
+StealableTest* allocStealable(MemoryRegion& region, uint32_t size) {
+	void* address = region.alloc(size, true, NULL);
+	return address ? new (address) StealableTest() : nullptr;
+}
+
+// Stealables are allocated from the bottom of the region up, so an in use one keeps its neighbours apart
+StealableTest* allocInUseStealable(MemoryRegion& region, uint32_t size) {
+	StealableTest* stealable = allocStealable(region, size);
+	stealable->inUse = true;
+	return stealable;
+}
+
+// Takes the rest of the region so only stealing can help
+void fillRegion(MemoryRegion& region) {
+	for (uint32_t size = 1 << 20; size >= 64; size >>= 1) {
+		while (region.alloc(size, false, NULL)) {}
+	}
+}
+
+TEST(StealableRuns, runsGrowAsNeighboursAreFreed) {
+	StealableTest* a = allocStealable(memreg, 4096);
+	StealableTest* b = allocStealable(memreg, 4096);
+	StealableTest* c = allocStealable(memreg, 4096);
+	StealableTest* blocker = allocInUseStealable(memreg, 4096);
+	CHECK((uint32_t)a + 4104 == (uint32_t)b);
+	CHECK((uint32_t)b + 4104 == (uint32_t)c);
+	CHECK((uint32_t)c + 4104 == (uint32_t)blocker);
+
+	memreg.cache_manager().QueueForReclamation(StealableQueue{0}, a);
+	memreg.cache_manager().QueueForReclamation(StealableQueue{0}, c);
+	CHECK_EQUAL(2, memreg.cache_manager().numIndexedRuns());
+	// b isn't queued, so a and c are each on their own
+	CHECK_EQUAL(4096, a->indexedRunLength);
+	CHECK_EQUAL(4096, c->indexedRunLength);
+
+	// queueing b joins all three up
+	memreg.cache_manager().QueueForReclamation(StealableQueue{0}, b);
+	CHECK_EQUAL(3 * 4096 + 16, a->indexedRunLength);
+	CHECK_EQUAL(3 * 4096 + 16, b->indexedRunLength);
+	CHECK_EQUAL(3 * 4096 + 16, c->indexedRunLength);
+
+	// deallocating one takes its record away, and its space still counts for the others
+	b->remove();
+	memreg.dealloc(b);
+	CHECK_EQUAL(2, memreg.cache_manager().numIndexedRuns());
+	CHECK_EQUAL(3 * 4096 + 16, a->indexedRunLength);
+	CHECK_EQUAL(3 * 4096 + 16, c->indexedRunLength);
+
+	// freeing the blocker joins the run up with the empty rest of the region
+	memreg.dealloc(blocker);
+	CHECK(c->indexedRunLength > MEM_SIZE / 2);
+	CHECK_EQUAL(c->indexedRunLength, a->indexedRunLength);
+};
+
+TEST(StealableRuns, longRunFoundAtBackOfQueue) {
+	std::vector<StealableTest*> loners;
+	std::vector<StealableTest*> runMembers;
+	for (int32_t i = 0; i < 100; i++) {
+		loners.push_back(allocStealable(memreg, 4096));
+		allocInUseStealable(memreg, 1024);
+	}
+	for (int32_t i = 0; i < 8; i++) {
+		runMembers.push_back(allocStealable(memreg, 4096));
+	}
+	allocInUseStealable(memreg, 1024);
+	fillRegion(memreg);
+	for (StealableTest* stealable : loners) {
+		memreg.cache_manager().QueueForReclamation(StealableQueue{0}, stealable);
+	}
+	for (StealableTest* stealable : runMembers) {
+		memreg.cache_manager().QueueForReclamation(StealableQueue{0}, stealable);
+	}
+
+	mock().expectNCalls(5, "steal");
+	void* address = memreg.alloc(5 * 4096 + 32, false, NULL);
+	CHECK(address != NULL);
+	CHECK((uint32_t)address >= (uint32_t)runMembers.front() && (uint32_t)address <= (uint32_t)runMembers.back());
+	mock().checkExpectations();
+
+	// nothing else is long enough
+	CHECK(memreg.alloc(5 * 4096 + 32, false, NULL) == NULL);
+	mock().checkExpectations();
+};
+
+// Records for Stealables which have left the queue are cleared out as a reclaim comes across them, but no more of
+// them in one go than it would otherwise probe
+TEST(StealableRuns, staleRecordsCountAsProbes) {
+	constexpr int32_t kNumStale = 50;
+	std::vector<StealableTest*> stealables;
+	for (int32_t i = 0; i < kNumStale; i++) {
+		stealables.push_back(allocStealable(memreg, 4096));
+		allocInUseStealable(memreg, 1024);
+	}
+	fillRegion(memreg);
+	for (StealableTest* stealable : stealables) {
+		memreg.cache_manager().QueueForReclamation(StealableQueue{0}, stealable);
+	}
+	for (StealableTest* stealable : stealables) {
+		stealable->remove();
+	}
+	CHECK_EQUAL(kNumStale, memreg.cache_manager().numIndexedRuns());
+
+	CHECK(memreg.alloc(4096, false, NULL) == NULL);
+	CHECK_EQUAL(kNumStale - CacheManager::kMaxRunProbes, memreg.cache_manager().numIndexedRuns());
+};
+
+// The same mix of allocations as MemoryAllocation.stealableAllocations, returning how much of the region ends up used
+float fillWithStealables(MemoryRegion& region, int32_t memSize) {
+	srand(1);
+	int32_t sizes[3] = {sizeof(Sample), sizeof(WaveTable), sizeof(Cluster) + (1 << 15)};
+	totalAllocated = 0;
+	for (int i = 0; i < NUM_TEST_ALLOCATIONS; i += 1) {
+		uint32_t size = sizes[2];
+		if (i % 10 == 0) {
+			size = sizes[rand() % 2];
+		}
+		void* testalloc = region.alloc(size, true, NULL);
+		CHECK(testalloc != NULL);
+		totalAllocated += size;
+		StealableTest* stealable = new (testalloc) StealableTest();
+		region.cache_manager().QueueForReclamation(StealableQueue{0}, stealable);
+		vtableAddress = *(uint32_t*)testalloc;
+		CHECK(testAllocationStructure(testalloc, getAllocatedSize(testalloc), SPACE_HEADER_STEALABLE));
+	}
+	return float(totalAllocated) / memSize;
+}
+
+// Trying the front of the queue first should keep memory as well packed as walking the whole queue does
+TEST(StealableRuns, stealableAllocations) {
+	MemoryRegion walkingRegion;
+	void* walkingEmptySpaces = malloc(empty_spaze_size);
+	void* walkingMemory = malloc(mem_size);
+	memset(walkingEmptySpaces, 0, empty_spaze_size);
+	memset(walkingMemory, 0, mem_size);
+	walkingRegion.setup(walkingEmptySpaces, empty_spaze_size, (uint32_t)walkingMemory,
+	                    (uint32_t)walkingMemory + mem_size);
+
+	mock().disable();
+	float walkingEfficiency = fillWithStealables(walkingRegion, mem_size);
+	uint32_t walkingSteals = nSteals;
+	nSteals = 0;
+	float indexedEfficiency = fillWithStealables(memreg, mem_size);
+	mock().enable();
+	std::cout << "stealable efficiency: walking queues " << walkingEfficiency << " (" << walkingSteals
+	          << " steals), run index " << indexedEfficiency << " (" << nSteals << " steals)" << std::endl;
+	CHECK(indexedEfficiency >= walkingEfficiency - 0.001);
+};
+
+// Fills a region with stealables which can only be reclaimed one at a time, queued ahead of some longer runs of them,
+// then times allocations which are too big for any single one. Walking the queue has to try every loner first.
+void measureReclaimLatency(MemoryRegion& region, char const* name, double* worstNs, double* averageNs) {
+	constexpr int32_t kNumLoners = 1500;
+	constexpr int32_t kNumRuns = 16;
+	constexpr int32_t kRunLength = 6;
+	std::vector<StealableTest*> loners;
+	std::vector<StealableTest*> runMembers;
+	for (int32_t i = 0; i < kNumLoners; i++) {
+		loners.push_back(allocStealable(region, 4096));
+		allocInUseStealable(region, 1024);
+	}
+	for (int32_t r = 0; r < kNumRuns; r++) {
+		for (int32_t i = 0; i < kRunLength; i++) {
+			runMembers.push_back(allocStealable(region, 4096));
+		}
+		allocInUseStealable(region, 1024);
+	}
+	fillRegion(region);
+	for (StealableTest* stealable : loners) {
+		region.cache_manager().QueueForReclamation(StealableQueue{0}, stealable);
+	}
+	for (StealableTest* stealable : runMembers) {
+		region.cache_manager().QueueForReclamation(StealableQueue{0}, stealable);
+	}
+
+	double totalNs = 0;
+	*worstNs = 0;
+	for (int32_t r = 0; r < kNumRuns; r++) {
+		auto start = std::chrono::steady_clock::now();
+		void* address = region.alloc(4 * 4096, false, NULL);
+		auto end = std::chrono::steady_clock::now();
+		CHECK(address != NULL);
+		double ns = std::chrono::duration<double, std::nano>(end - start).count();
+		totalNs += ns;
+		*worstNs = std::max(*worstNs, ns);
+	}
+	*averageNs = totalNs / kNumRuns;
+	std::cout << "reclaim latency, " << name << ": worst " << *worstNs / 1000 << " us, average " << *averageNs / 1000
+	          << " us" << std::endl;
+}
+
+TEST(StealableRuns, reclaimLatencyBenchmark) {
+	MemoryRegion walkingRegion;
+	void* walkingEmptySpaces = malloc(empty_spaze_size);
+	void* walkingMemory = malloc(mem_size);
+	memset(walkingEmptySpaces, 0, empty_spaze_size);
+	memset(walkingMemory, 0, mem_size);
+	walkingRegion.setup(walkingEmptySpaces, empty_spaze_size, (uint32_t)walkingMemory,
+	                    (uint32_t)walkingMemory + mem_size);
+
+	mock().disable();
+	double walkingWorst, walkingAverage, indexedWorst, indexedAverage;
+	measureReclaimLatency(walkingRegion, "walking queues", &walkingWorst, &walkingAverage);
+	measureReclaimLatency(memreg, "run index", &indexedWorst, &indexedAverage);
+	mock().enable();
+
+	CHECK(indexedWorst < walkingWorst);
+};
+
+TEST_GROUP(RealtimeAllocation) {
+	MemoryRegion memreg;
+	RealtimeReserve reserve;
+	uint32_t empty_spaze_size = sizeof(EmptySpaceRecord) * 512;
+	void* emptySpacesMemory = malloc(empty_spaze_size);
+	int32_t mem_size = MEM_SIZE;
+	void* raw_mem = malloc(mem_size);
+	void setup() {
+		nSteals = 0;
+		memset(raw_mem, 0, mem_size);
+		memset(emptySpacesMemory, 0, empty_spaze_size);
+		memreg.setup(emptySpacesMemory, empty_spaze_size, (uint32_t)raw_mem, (uint32_t)raw_mem + mem_size);
+		reserve = RealtimeReserve();
+	}
+	void teardown() { mock().clear(); }
+	// what GeneralMemoryAllocator::refillRealtimeReserve() does, from a single region
+	void refillReserve() {
+		for (int32_t c = reserve.classNeedingRefill(); c != -1; c = reserve.classNeedingRefill()) {
+			void* block = memreg.alloc(reserve.blockSize(c), reserve.isStealable(c), NULL);
+			CHECK(block != NULL);
+			reserve.refill(c, block);
+		}
+	}
+};
+
+TEST(RealtimeAllocation, takesBestFit) {
+	CHECK(reserve.addClass(256, 2));
+	CHECK(reserve.addClass(64, 3));
+	CHECK(reserve.addClass(1024, 1, true));
+	CHECK(reserve.addClass(64, 2)); // already there, and asks for fewer
+	CHECK_EQUAL(3, reserve.numClasses());
+	CHECK_EQUAL(64, reserve.blockSize(0));
+	CHECK_EQUAL(256, reserve.blockSize(1));
+	refillReserve();
+	CHECK_EQUAL(6, reserve.stats().refills);
+
+	void* small = reserve.take(48);
+	CHECK(small != NULL);
+	CHECK(getAllocatedSize(small) < 256);
+	CHECK_EQUAL(2, reserve.numAvailable(0));
+	// too big for the small class, and the stealable class isn't for plain allocations
+	CHECK(getAllocatedSize(reserve.take(100)) >= 256);
+	CHECK(reserve.take(300) == NULL);
+	CHECK(reserve.take(1000, true) != NULL);
+	CHECK(reserve.take(1000, true) == NULL);
+
+	// the small class is used up, so the next small request goes to the bigger one
+	reserve.take(48);
+	reserve.take(48);
+	CHECK_EQUAL(0, reserve.numAvailable(0));
+	CHECK(getAllocatedSize(reserve.take(48)) >= 256);
+	CHECK(reserve.take(48) == NULL);
+	CHECK_EQUAL(6, reserve.stats().hits);
+	CHECK_EQUAL(0, reserve.stats().lowestAvailable[0]);
+
+	CHECK_EQUAL(0, reserve.classNeedingRefill());
+	refillReserve();
+	CHECK_EQUAL(3, reserve.numAvailable(0));
+	reserve.resetCounters();
+	CHECK_EQUAL(0, reserve.stats().hits);
+	CHECK_EQUAL(3, reserve.stats().lowestAvailable[0]);
+};
+
+TEST(RealtimeAllocation, reservedStealableBlocksArentStolen) {
+	reserve.addClass(4096, 1, true);
+	StealableTest* before = allocStealable(memreg, 4096);
+	refillReserve();
+	allocInUseStealable(memreg, 1024);
+	fillRegion(memreg);
+	memreg.cache_manager().QueueForReclamation(StealableQueue{0}, before);
+
+	// the only way to get this much is to take the reserved block too
+	mock().expectNCalls(0, "steal");
+	CHECK(memreg.alloc(2 * 4096, false, NULL) == NULL);
+	mock().checkExpectations();
+	CHECK(reserve.take(4096, true) != NULL);
+};
+
+TEST(RealtimeAllocation, stealingIsBounded) {
+	std::vector<StealableTest*> stealables;
+	for (int32_t i = 0; i < 6; i++) {
+		stealables.push_back(allocStealable(memreg, 4096));
+	}
+	allocInUseStealable(memreg, 1024);
+	fillRegion(memreg);
+	for (StealableTest* stealable : stealables) {
+		memreg.cache_manager().QueueForReclamation(StealableQueue{0}, stealable);
+	}
+
+	mock().expectNCalls(0, "steal");
+	CHECK(memreg.alloc(4096, false, NULL, 0) == NULL);
+	CHECK(memreg.alloc(3 * 4096, false, NULL, 2) == NULL);
+	mock().checkExpectations();
+
+	mock().expectNCalls(2, "steal");
+	CHECK(memreg.alloc(2 * 4096, false, NULL, 2) != NULL);
+	mock().checkExpectations();
+
+	// without a limit, the rest can all go
+	mock().expectNCalls(4, "steal");
+	CHECK(memreg.alloc(4 * 4096, false, NULL) != NULL);
+	mock().checkExpectations();
+};
+
+TEST_GROUP(SlabAllocation) {
+	MemoryRegion memreg;
+	SlabAllocator slabs;
+	uint32_t empty_spaze_size = sizeof(EmptySpaceRecord) * 512;
+	void* emptySpacesMemory = malloc(empty_spaze_size);
+	int32_t mem_size = MEM_SIZE;
+	void* raw_mem = malloc(mem_size);
+	void setup() {
+		memset(raw_mem, 0, mem_size);
+		memset(emptySpacesMemory, 0, empty_spaze_size);
+		memreg.setup(emptySpacesMemory, empty_spaze_size, (uint32_t)raw_mem, (uint32_t)raw_mem + mem_size);
+		slabs.setup(&memreg);
+	}
+};
+
+TEST(SlabAllocation, sizeClasses) {
+	CHECK_EQUAL(0, SlabAllocator::sizeClassFor(1));
+	CHECK_EQUAL(0, SlabAllocator::sizeClassFor(8));
+	CHECK_EQUAL(1, SlabAllocator::sizeClassFor(9));
+	CHECK_EQUAL(1, SlabAllocator::sizeClassFor(24));
+	CHECK_EQUAL(2, SlabAllocator::sizeClassFor(25));
+	CHECK_EQUAL(SlabAllocator::kNumSizeClasses - 1, SlabAllocator::sizeClassFor(SlabAllocator::kMaxSize));
+	CHECK(slabs.alloc(SlabAllocator::kMaxSize + 1) == nullptr);
+	CHECK(slabs.alloc(0) == nullptr);
+};
+
+TEST(SlabAllocation, cellsDontOverlap) {
+	std::vector<void*> cells;
+	for (int i = 0; i < 1000; i++) {
+		uint32_t size = 1 + (i * 37) % SlabAllocator::kMaxSize;
+		void* cell = slabs.alloc(size);
+		CHECK(cell != nullptr);
+		CHECK(((uint32_t)cell & 7) == 0);
+		CHECK(SlabAllocator::isSlabAllocation(cell));
+		CHECK(getAllocatedSize(cell) >= size);
+		memset(cell, i & 0xFF, size);
+		cells.push_back(cell);
+	}
+	for (int i = 0; i < cells.size(); i++) {
+		uint32_t size = 1 + (i * 37) % SlabAllocator::kMaxSize;
+		uint8_t* bytes = (uint8_t*)cells[i];
+		for (int j = 0; j < size; j++) {
+			CHECK_EQUAL(i & 0xFF, bytes[j]);
+		}
+		CHECK(SlabAllocator::isSlabAllocation(cells[i]));
+	}
+	CHECK_EQUAL(1000, slabs.stats().hits);
+	for (void* cell : cells) {
+		slabs.dealloc(cell);
+	}
+	CHECK_EQUAL(0, slabs.stats().bytesRequested);
+	CHECK_EQUAL(0, slabs.stats().bytesInUse);
+};
+
+TEST(SlabAllocation, emptySlabsGoBackToRegion) {
+	std::vector<void*> cells;
+	for (int i = 0; i < 1000; i++) {
+		cells.push_back(slabs.alloc(100));
+	}
+	CHECK(slabs.stats().bytesHeld > 10 * SlabAllocator::kSlabSize);
+	for (void* cell : cells) {
+		slabs.dealloc(cell);
+	}
+	// one slab is kept around so the next allocation doesn't need the region
+	CHECK_EQUAL(SlabAllocator::kSlabSize, slabs.stats().bytesHeld);
+	CHECK_EQUAL(slabs.stats().slabsAllocated - 1, slabs.stats().slabsReleased);
+	slabs.dealloc(slabs.alloc(100));
+	CHECK_EQUAL(1, slabs.stats().slabsAllocated - slabs.stats().slabsReleased);
+};
+
+TEST(SlabAllocation, fallsBackWhenFull) {
+	std::vector<void*> cells;
+	int cellsPerSlab = (SlabAllocator::kSlabSize - SlabAllocator::kSlabHeaderSize) / SlabAllocator::kMaxCellSize;
+	for (int i = 0; i < SlabAllocator::kMaxSlabs * cellsPerSlab; i++) {
+		void* cell = slabs.alloc(SlabAllocator::kMaxSize);
+		CHECK(cell != nullptr);
+		cells.push_back(cell);
+	}
+	CHECK(slabs.alloc(SlabAllocator::kMaxSize) == nullptr);
+	CHECK_EQUAL(1, slabs.stats().misses);
+	CHECK_EQUAL(0, slabs.fragmentationPercent() > 10);
+	slabs.dealloc(cells.back());
+	CHECK(slabs.alloc(SlabAllocator::kMaxSize) != nullptr);
+};
+
+// An allocation trace shaped like a song load: a mix of small objects (strings, param collections, note rows)
+// with some medium buffers, and a share of short-lived temporaries freed again during parsing.
+// Each entry is either an allocation of size > 0, or a free of the allocation made `-size` steps earlier.
+std::vector<int32_t> makeSongLoadTrace(int32_t numAllocations) {
+	srand(4);
+	std::vector<int32_t> trace;
+	std::vector<int32_t> pendingFrees;
+	for (int32_t i = 0; i < numAllocations; i++) {
+		int32_t r = rand() % 100;
+		int32_t size;
+		if (r < 45) {
+			size = 4 + rand() % 28; // strings, tiny nodes
+		}
+		else if (r < 80) {
+			size = 32 + rand() % 96; // params, note rows
+		}
+		else if (r < 95) {
+			size = 128 + rand() % 120;
+		}
+		else {
+			size = 256 + rand() % 4096; // arrays and buffers
+		}
+		trace.push_back(size);
+		// around a third of allocations are temporaries freed shortly after
+		if (rand() % 3 == 0) {
+			pendingFrees.push_back(1 + rand() % 16);
+		}
+		for (auto it = pendingFrees.begin(); it != pendingFrees.end();) {
+			if (--*it == 0) {
+				// free the most recent still-live allocation at the time of this step
+				trace.push_back(-(1 + rand() % 8));
+				it = pendingFrees.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+	}
+	return trace;
+}
+
+template <typename Alloc, typename Dealloc>
+double replayTrace(const std::vector<int32_t>& trace, Alloc alloc, Dealloc dealloc, int32_t* numOperations) {
+	std::vector<void*> live;
+	live.reserve(trace.size());
+	*numOperations = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int32_t entry : trace) {
+		if (entry > 0) {
+			void* address = alloc(entry);
+			if (address) {
+				live.push_back(address);
+			}
+		}
+		else if (live.size() >= -entry) {
+			auto it = live.end() + entry;
+			dealloc(*it);
+			*it = live.back();
+			live.pop_back();
+		}
+		(*numOperations)++;
+	}
+	for (void* address : live) {
+		dealloc(address);
+	}
+	*numOperations += live.size();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+TEST(SlabAllocation, songLoadThroughputBenchmark) {
+	std::vector<int32_t> trace = makeSongLoadTrace(8000);
+	constexpr int32_t kRepeats = 5;
+	double regionTime = 0;
+	double slabTime = 0;
+	int32_t numOperations = 0;
+
+	for (int32_t repeat = 0; repeat < kRepeats; repeat++) {
+		regionTime += replayTrace(
+		    trace, [&](uint32_t size) { return memreg.alloc(size, false, NULL); },
+		    [&](void* address) { memreg.dealloc(address); }, &numOperations);
+		// everything was freed so the region should be back to a single empty space
+		CHECK_EQUAL(1, memreg.emptySpaces.getNumElements());
+	}
+
+	for (int32_t repeat = 0; repeat < kRepeats; repeat++) {
+		slabTime += replayTrace(
+		    trace,
+		    [&](uint32_t size) {
+			    void* address = slabs.alloc(size);
+			    return address ? address : memreg.alloc(size, false, NULL);
+		    },
+		    [&](void* address) {
+			    if (SlabAllocator::isSlabAllocation(address)) {
+				    slabs.dealloc(address);
+			    }
+			    else {
+				    memreg.dealloc(address);
+			    }
+		    },
+		    &numOperations);
+		CHECK_EQUAL(0, slabs.stats().bytesRequested);
+	}
+
+	double regionNs = regionTime / (kRepeats * numOperations);
+	double slabNs = slabTime / (kRepeats * numOperations);
+	std::cout << "song load trace, " << numOperations << " operations: region " << regionNs << " ns/op, slabs "
+	          << slabNs << " ns/op, hit rate " << slabs.hitRatePercent() << "%, peak slab memory "
+	          << slabs.stats().peakBytesHeld << " bytes" << std::endl;
+	CHECK_EQUAL(100, slabs.hitRatePercent());
+};
+
+TEST(SlabAllocation, songLoadFragmentation) {
+	std::vector<int32_t> trace = makeSongLoadTrace(8000);
+	std::vector<void*> live;
+	uint32_t maxFragmentation = 0;
+	uint32_t smallRequested = 0;
+	for (int32_t entry : trace) {
+		if (entry > 0) {
+			void* address = slabs.alloc(entry);
+			if (!address) {
+				address = memreg.alloc(entry, false, NULL);
+			}
+			else {
+				smallRequested++;
+			}
+			live.push_back(address);
+		}
+		else if (live.size() >= -entry) {
+			auto it = live.end() + entry;
+			if (SlabAllocator::isSlabAllocation(*it)) {
+				slabs.dealloc(*it);
+			}
+			else {
+				memreg.dealloc(*it);
+			}
+			*it = live.back();
+			live.pop_back();
+		}
+		if (slabs.stats().bytesHeld > 16 * SlabAllocator::kSlabSize) {
+			maxFragmentation = std::max(maxFragmentation, slabs.fragmentationPercent());
+		}
+	}
+	std::cout << "song load trace: " << slabs.stats().hits << " slab hits, " << slabs.fragmentationPercent()
+	          << "% fragmented at the end, worst " << maxFragmentation << "%" << std::endl;
+	CHECK_EQUAL(smallRequested, slabs.stats().hits);
+	// cells are rounded up to a power of 2, so around a third of held memory is padding once warm. The region would
+	// pad every one of these to at least minAlign plus 8 bytes of header and footer
+	CHECK(slabs.fragmentationPercent() < 50);
+};
+
+TEST(MemoryAllocation, allocationTraceWrapsAround) {
+	AllocationTrace trace;
+	AllocationTrace::Record buffer[16];
+	AllocationTrace::Record copied[16];
+	// not recording until started
+	trace.add(AllocationTrace::Op::ALLOC, 1, 1, 0, 0, 0, 0);
+	CHECK_EQUAL(0, trace.numRecorded());
+
+	trace.start(buffer, 16);
+	for (uint32_t i = 0; i < 40; i++) {
+		trace.add(AllocationTrace::Op::ALLOC, 0x1000 + i, i, 0, 0, 1, 0);
+	}
+	CHECK_EQUAL(40, trace.numRecorded());
+	CHECK_EQUAL(16, trace.numAvailable());
+
+	// the oldest 24 were overwritten
+	CHECK_EQUAL(16, trace.copy(0, copied, 16));
+	for (uint32_t i = 0; i < 16; i++) {
+		CHECK_EQUAL(0x1000 + 24 + i, copied[i].address);
+		CHECK_EQUAL((uint8_t)(24 + i), copied[i].sequence);
+	}
+	CHECK_EQUAL(6, trace.copy(10, copied, 8));
+	CHECK_EQUAL(0x1000 + 34, copied[0].address);
+	CHECK_EQUAL(0, trace.copy(16, copied, 8));
+
+	trace.stop();
+	trace.add(AllocationTrace::Op::DEALLOC, 0x1000, 0, 0, 0, 0, 0);
+	CHECK_EQUAL(40, trace.numRecorded());
+};
 } // namespace
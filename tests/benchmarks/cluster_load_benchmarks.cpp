@@ -0,0 +1,156 @@
+#include "CppUTest/TestHarness.h"
+#include "fat_image.h"
+#include "storage/cluster/cluster_read_batch.h"
+#include <array>
+#include <cstdio>
+#include <map>
+#include <memory>
+
+using namespace deluge::bench;
+
+namespace {
+
+constexpr uint32_t kSectorsPerCluster = 64; // 32kB, what most cards come formatted with
+constexpr uint32_t kNumClustersEach = 512;
+// What a play-head going at a fair lick holds - see ClusterReadAhead
+constexpr int32_t kClustersAhead = 8;
+
+struct LoadStats {
+	uint64_t numReads;
+	double clustersPerSecond;
+};
+
+/// Streams a file through the loading queue the way AudioFileManager::loadAnyEnqueuedClusters() does, with one
+/// play-head keeping kClustersAhead Clusters enqueued, each due when it'll reach it. With batching, each read takes any
+/// of the head's neighbours that are queued and contiguous on the card along with it.
+LoadStats streamFile(FatImage& image, const std::vector<uint32_t>& sdAddresses, int32_t file, bool batching) {
+	int32_t numClusters = sdAddresses.size();
+	std::vector<std::unique_ptr<uint8_t[]>> clusters(numClusters);
+	std::vector<bool> loaded(numClusters);
+	std::multimap<uint32_t, int32_t> queue;
+
+	auto takeFromQueue = [&](int32_t clusterIndex) {
+		for (auto it = queue.begin(); it != queue.end(); it++) {
+			if (it->second == clusterIndex) {
+				queue.erase(it);
+				return true;
+			}
+		}
+		return false;
+	};
+
+	image.resetCounts();
+	int32_t nextToEnqueue = 0;
+	int32_t numLoaded = 0;
+	while (numLoaded < numClusters) {
+		while (nextToEnqueue < numClusters && nextToEnqueue - numLoaded < kClustersAhead) {
+			clusters[nextToEnqueue] = std::make_unique<uint8_t[]>(image.clusterSize());
+			queue.insert({(uint32_t)nextToEnqueue, nextToEnqueue});
+			nextToEnqueue++;
+		}
+
+		int32_t head = queue.begin()->second;
+		queue.erase(queue.begin());
+
+		ClusterReadBatch batch{head, 1};
+		if (batching) {
+			batch = growClusterReadBatch(
+			    head, numClusters, kSectorsPerCluster, [&](int32_t i) { return sdAddresses[i]; }, takeFromQueue);
+		}
+
+		std::array<uint8_t*, kMaxClustersPerRead> buffs;
+		for (int32_t c = 0; c < batch.numClusters; c++) {
+			buffs[c] = clusters[batch.firstClusterIndex + c].get();
+		}
+		uint32_t sdAddress = sdAddresses[batch.firstClusterIndex];
+		bool ok = (batch.numClusters == 1)
+		              ? image.read(buffs[0], sdAddress, kSectorsPerCluster)
+		              : image.readScattered(buffs.data(), kSectorsPerCluster, sdAddress,
+		                                    batch.numClusters * kSectorsPerCluster);
+		CHECK(ok);
+
+		for (int32_t c = batch.firstClusterIndex; c < batch.firstClusterIndex + batch.numClusters; c++) {
+			CHECK_FALSE(loaded[c]);
+			loaded[c] = true;
+			numLoaded++;
+		}
+	}
+
+	// Every Cluster has to have got its own data, wherever on the card it was and however it was read
+	for (int32_t c = 0; c < numClusters; c++) {
+		uint8_t* data = clusters[c].get();
+		CHECK_EQUAL(FatImage::patternByte(file, c), data[0]);
+		CHECK_EQUAL(FatImage::patternByte(file, c), data[image.clusterSize() - 1]);
+	}
+
+	return {image.numReadCommands(), numClusters / image.cardSeconds()};
+}
+
+void printRow(const char* layout, bool batching, const LoadStats& stats) {
+	printf("%-12s %-10s %10llu %14.0f\n", layout, batching ? "batched" : "one-by-one",
+	       (unsigned long long)stats.numReads, stats.clustersPerSecond);
+}
+
+} // namespace
+
+TEST_GROUP(ClusterLoadBenchmarks){};
+
+// A file copied onto the card on its own lies in one contiguous run. Two recorded at once end up with their Clusters
+// alternating. Batching can only help the first, and mustn't cost the second anything.
+TEST(ClusterLoadBenchmarks, contiguousVsFragmented) {
+	FatImage image(3 * kNumClustersEach + 16, kSectorsPerCluster);
+
+	std::array<std::string_view, 1> contiguous = {"CONTIG.WAV"};
+	image.writeInterleaved(contiguous, kNumClustersEach);
+	std::array<std::string_view, 2> fragmented = {"FRAG_A.WAV", "FRAG_B.WAV"};
+	image.writeInterleaved(fragmented, kNumClustersEach);
+
+	std::vector<uint32_t> contiguousSectors = image.clusterSectors(contiguous[0]);
+	std::vector<uint32_t> fragmentedSectors = image.clusterSectors(fragmented[0]);
+	CHECK_EQUAL(kNumClustersEach, contiguousSectors.size());
+	CHECK_EQUAL(kNumClustersEach, fragmentedSectors.size());
+
+	printf("\n%-12s %-10s %10s %14s\n", "layout", "loader", "reads", "clusters/s");
+	LoadStats contiguousSingle = streamFile(image, contiguousSectors, 0, false);
+	printRow("contiguous", false, contiguousSingle);
+	LoadStats contiguousBatched = streamFile(image, contiguousSectors, 0, true);
+	printRow("contiguous", true, contiguousBatched);
+	LoadStats fragmentedSingle = streamFile(image, fragmentedSectors, 0, false);
+	printRow("fragmented", false, fragmentedSingle);
+	LoadStats fragmentedBatched = streamFile(image, fragmentedSectors, 0, true);
+	printRow("fragmented", true, fragmentedBatched);
+
+	CHECK_EQUAL(kNumClustersEach, contiguousSingle.numReads);
+	CHECK_EQUAL(kNumClustersEach / kMaxClustersPerRead, contiguousBatched.numReads);
+	CHECK(contiguousBatched.clustersPerSecond > contiguousSingle.clustersPerSecond * 1.15);
+	CHECK_EQUAL(kNumClustersEach, fragmentedBatched.numReads);
+	DOUBLES_EQUAL(fragmentedSingle.clustersPerSecond, fragmentedBatched.clustersPerSecond, 0.01);
+}
+
+TEST(ClusterLoadBenchmarks, batchesGrowBothWays) {
+	// Clusters 2..7 contiguous, then a gap
+	std::vector<uint32_t> sdAddresses = {1000, 5000, 200, 264, 328, 392, 456, 520, 9000};
+	std::vector<bool> queued(sdAddresses.size(), true);
+	auto take = [&](int32_t i) { return queued[i] ? (queued[i] = false, true) : false; };
+	auto sdAddressOf = [&](int32_t i) { return sdAddresses[i]; };
+
+	ClusterReadBatch forwards = growClusterReadBatch(3, sdAddresses.size(), 64, sdAddressOf, take);
+	CHECK_EQUAL(3, forwards.firstClusterIndex);
+	CHECK_EQUAL(kMaxClustersPerRead, forwards.numClusters);
+
+	// Nothing more to take forwards
+	ClusterReadBatch afterwards = growClusterReadBatch(7, sdAddresses.size(), 64, sdAddressOf, take);
+	CHECK_EQUAL(7, afterwards.firstClusterIndex);
+	CHECK_EQUAL(1, afterwards.numClusters);
+
+	// A reversed play-head, with a gap on the card after it
+	queued.assign(sdAddresses.size(), true);
+	ClusterReadBatch backwards = growClusterReadBatch(7, sdAddresses.size(), 64, sdAddressOf, take);
+	CHECK_EQUAL(4, backwards.firstClusterIndex);
+	CHECK_EQUAL(kMaxClustersPerRead, backwards.numClusters);
+
+	// Neighbours nobody's waiting for don't come along
+	queued.assign(sdAddresses.size(), false);
+	ClusterReadBatch alone = growClusterReadBatch(4, sdAddresses.size(), 64, sdAddressOf, take);
+	CHECK_EQUAL(1, alone.numClusters);
+}
@@ -0,0 +1,228 @@
+#include "CppUTest/TestHarness.h"
+#include "modulation/midi/learned_cc_index.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int32_t kNumOutputs = 64;
+constexpr int32_t kMessagesPerSecond = 10000;
+constexpr int32_t kDrumsPerKit = 16;
+
+struct Random {
+	uint32_t state;
+	uint32_t next() {
+		state = state * 1664525u + 1013904223u;
+		return state >> 8; // The low bits repeat too soon
+	}
+};
+
+/// What matters of a MIDIKnob here
+struct Knob {
+	int32_t channel;
+	int32_t ccNumber;
+};
+
+/// Stands in for an Output: its own knobs, and those of each of its Drums if it's a Kit
+struct FakeOutput {
+	std::vector<std::vector<Knob>> knobArrays;
+	int32_t numTimesOffered = 0;
+
+	/// Goes through every knob, as offerReceivedCCToLearnedParams() does, returning how many matched
+	int32_t offer(int32_t channel, int32_t ccNumber) {
+		numTimesOffered++;
+		int32_t numMatched = 0;
+		for (auto const& knobs : knobArrays) {
+			for (Knob const& knob : knobs) {
+				if (knob.ccNumber == ccNumber && knob.channel == channel) {
+					numMatched++;
+				}
+			}
+		}
+		return numMatched;
+	}
+};
+
+/// A big Song: every fourth Output a Kit, the rest synths and audio tracks, each with a few knobs learned - mostly
+/// on a channel of its own, some to the same CC on a shared one
+std::vector<FakeOutput> makeOutputs(uint32_t seed) {
+	Random random{seed};
+	std::vector<FakeOutput> outputs(kNumOutputs);
+	for (int32_t o = 0; o < kNumOutputs; o++) {
+		int32_t numArrays = (o % 4 == 0) ? 1 + kDrumsPerKit : 1;
+		for (int32_t a = 0; a < numArrays; a++) {
+			auto& knobs = outputs[o].knobArrays.emplace_back();
+			int32_t numKnobs = (a == 0) ? 8 : 2;
+			for (int32_t k = 0; k < numKnobs; k++) {
+				if (random.next() % 8 == 0) {
+					knobs.push_back({15, 1}); // Mod wheel on the shared channel
+				}
+				else {
+					knobs.push_back({o % 15, (int32_t)(random.next() % 128)});
+				}
+			}
+		}
+	}
+	return outputs;
+}
+
+Output* asOutput(std::vector<FakeOutput>& outputs, int32_t o) {
+	return (Output*)&outputs[o]; // Only ever compared, never dereferenced by the index
+}
+
+/// What Song::updateLearnedCCIndex() does, over the FakeOutputs
+void rebuild(LearnedCCIndex& index, std::vector<FakeOutput>& outputs) {
+	index.clear();
+	for (int32_t o = 0; o < (int32_t)outputs.size(); o++) {
+		for (auto const& knobs : outputs[o].knobArrays) {
+			for (Knob const& knob : knobs) {
+				index.add(asOutput(outputs, o), knob.channel, knob.ccNumber);
+			}
+		}
+	}
+	index.finish();
+}
+
+/// A mix of CCs the Song has learned and ones it hasn't, as a controller being swept would send
+std::vector<Knob> makeTraffic(std::vector<FakeOutput> const& outputs, int32_t numMessages, uint32_t seed) {
+	Random random{seed};
+	std::vector<Knob> messages;
+	for (int32_t i = 0; i < numMessages; i++) {
+		if (random.next() % 2) {
+			auto const& knobs = outputs[random.next() % kNumOutputs].knobArrays[0];
+			messages.push_back(knobs[random.next() % knobs.size()]);
+		}
+		else {
+			messages.push_back({(int32_t)(random.next() % 16), (int32_t)(random.next() % 128)});
+		}
+	}
+	return messages;
+}
+
+} // namespace
+
+TEST_GROUP(LearnedCCIndex){};
+
+// Every channel and CC gives just the Outputs with a knob learned to it, each once, in Song order
+TEST(LearnedCCIndex, matchesBruteForce) {
+	std::vector<FakeOutput> outputs = makeOutputs(1234);
+	LearnedCCIndex index;
+	CHECK(!index.isUpToDate());
+	rebuild(index, outputs);
+	CHECK(index.isUpToDate());
+
+	int32_t numCCs = 0;
+	for (int32_t channel = 0; channel < 16; channel++) {
+		for (int32_t ccNumber = 0; ccNumber < 128; ccNumber++) {
+			std::vector<Output*> expected;
+			for (int32_t o = 0; o < kNumOutputs; o++) {
+				if (outputs[o].offer(channel, ccNumber)) {
+					expected.push_back(asOutput(outputs, o));
+				}
+			}
+			numCCs += !expected.empty();
+
+			auto actual = index.getOutputs(channel, ccNumber);
+			CHECK_EQUAL(expected.size(), actual.size());
+			for (size_t i = 0; i < expected.size(); i++) {
+				POINTERS_EQUAL(expected[i], actual[i]);
+			}
+		}
+	}
+	CHECK_EQUAL(numCCs, index.getNumCCs());
+
+	// The mod wheel every so often, over many Outputs
+	CHECK(index.getOutputs(15, 1).size() > 1);
+
+	index.invalidate();
+	CHECK(!index.isUpToDate());
+}
+
+// MPE zones and pitch bend "knobs" don't come in as CCs, and there's nothing to find outside the range either
+TEST(LearnedCCIndex, ignoresWhatIsNotACC) {
+	FakeOutput output;
+	LearnedCCIndex index;
+	index.clear();
+	index.add((Output*)&output, 16, 1);  // MIDI_CHANNEL_MPE_LOWER_ZONE
+	index.add((Output*)&output, 2, 128); // Pitch bend
+	index.add((Output*)&output, 3, 74);
+	index.finish();
+
+	CHECK_EQUAL(1, index.getNumCCs());
+	CHECK_EQUAL(1, index.getOutputs(3, 74).size());
+	CHECK_EQUAL(0, index.getOutputs(16, 1).size());
+	CHECK_EQUAL(0, index.getOutputs(2, 128).size());
+	CHECK_EQUAL(0, index.getOutputs(-1, 0).size());
+	CHECK_EQUAL(0, index.getOutputs(0, -1).size());
+
+	// And with nothing learned at all
+	index.clear();
+	index.finish();
+	CHECK_EQUAL(0, index.getNumCCs());
+	CHECK_EQUAL(0, index.getOutputs(3, 74).size());
+}
+
+// A second of 10k CCs across 64 Outputs: offering each to every Output, as playbackHandler.midiCCReceived() used to,
+// against going through every Output in the same order but only offering it to those the index gives. Both only count
+// the knob scans - not the virtual call, the ModelStack and the rest each Output offered to cost on top
+TEST(LearnedCCIndex, ccFlood) {
+	std::vector<FakeOutput> outputs = makeOutputs(98765);
+	std::vector<Knob> messages = makeTraffic(outputs, kMessagesPerSecond, 4321);
+	constexpr int32_t kNumRepeats = 20;
+
+	auto start = Clock::now();
+	LearnedCCIndex index;
+	rebuild(index, outputs);
+	double rebuildSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	int64_t allMatched = 0;
+	int64_t allOffered = 0;
+	start = Clock::now();
+	for (int32_t r = 0; r < kNumRepeats; r++) {
+		for (Knob const& message : messages) {
+			for (FakeOutput& output : outputs) {
+				allMatched += output.offer(message.channel, message.ccNumber);
+			}
+		}
+	}
+	double allSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+	for (FakeOutput& output : outputs) {
+		allOffered += output.numTimesOffered;
+		output.numTimesOffered = 0;
+	}
+
+	int64_t indexedMatched = 0;
+	int64_t indexedOffered = 0;
+	start = Clock::now();
+	for (int32_t r = 0; r < kNumRepeats; r++) {
+		for (Knob const& message : messages) {
+			auto learned = index.getOutputs(message.channel, message.ccNumber);
+			for (int32_t o = 0; o < (int32_t)outputs.size(); o++) {
+				if (std::ranges::find(learned, asOutput(outputs, o)) != learned.end()) {
+					indexedMatched += outputs[o].offer(message.channel, message.ccNumber);
+				}
+			}
+		}
+	}
+	double indexedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+	for (FakeOutput& output : outputs) {
+		indexedOffered += output.numTimesOffered;
+	}
+
+	// The same knobs get the same CCs either way
+	CHECK_EQUAL(allMatched, indexedMatched);
+	CHECK(indexedOffered < allOffered);
+
+	double numMessages = (double)kMessagesPerSecond * kNumRepeats;
+	printf("\n%d CCs/s across %d Outputs, %d learned channel/CC pairs, rebuilt in %.0f us\n", kMessagesPerSecond,
+	       kNumOutputs, index.getNumCCs(), rebuildSeconds * 1e6);
+	printf("%16s %18s %14s %14s\n", "", "Outputs offered", "ns per CC", "% of a second");
+	printf("%16s %18.2f %14.1f %14.3f\n", "every Output", allOffered / numMessages, allSeconds * 1e9 / numMessages,
+	       allSeconds / kNumRepeats * 100);
+	printf("%16s %18.2f %14.1f %14.3f\n", "indexed", indexedOffered / numMessages,
+	       indexedSeconds * 1e9 / numMessages, indexedSeconds / kNumRepeats * 100);
+}
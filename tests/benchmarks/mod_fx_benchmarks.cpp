@@ -0,0 +1,63 @@
+#include "CppUTest/TestHarness.h"
+#include "mod_fx_comparison.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace deluge::dsp::mod_fx;
+using namespace deluge::dsp::mod_fx::test;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+const char* typeName(ModFXType type) {
+	switch (type) {
+	case ModFXType::FLANGER:
+		return "flanger";
+	case ModFXType::CHORUS:
+		return "chorus";
+	case ModFXType::CHORUS_STEREO:
+		return "stereo chorus";
+	case ModFXType::PHASER:
+		return "phaser";
+	default:
+		return "?";
+	}
+}
+
+} // namespace
+
+TEST_GROUP(ModFXBenchmarks){};
+
+// The cost of each effect a sample at a time and in blocks, rendered in the windows the audio engine uses
+TEST(ModFXBenchmarks, blockSpeedUp) {
+	constexpr size_t kNumSamples = kSampleRate * 4;
+	std::vector<StereoSample> noise = makeNoise(kNumSamples);
+	std::vector<StereoSample> audio(SSI_TX_BUFFER_NUM_SAMPLES);
+
+	printf("\n%-24s %10s %10s %10s\n", "mod fx (ns/sample)", "reference", "block", "speedup");
+	for (Setting const& setting : kSettings) {
+		Comparison comparison(setting);
+		Clock::duration referenceTime{};
+		Clock::duration blockTime{};
+		// A window of each in turn, so they both see whatever else the machine's doing
+		for (size_t offset = 0; offset + audio.size() <= kNumSamples; offset += audio.size()) {
+			std::copy_n(noise.begin() + offset, audio.size(), audio.begin());
+			auto start = Clock::now();
+			comparison.renderReference(audio);
+			referenceTime += Clock::now() - start;
+
+			std::copy_n(noise.begin() + offset, audio.size(), audio.begin());
+			start = Clock::now();
+			comparison.renderBlock(audio);
+			blockTime += Clock::now() - start;
+		}
+		double nsPerSample[2];
+		nsPerSample[0] = std::chrono::duration<double, std::nano>(referenceTime).count() / kNumSamples;
+		nsPerSample[1] = std::chrono::duration<double, std::nano>(blockTime).count() / kNumSamples;
+		CHECK(comparison.sameState());
+		printf("%-24s %10.2f %10.2f %9.2fx\n", typeName(setting.type), nsPerSample[0], nsPerSample[1],
+		       nsPerSample[0] / nsPerSample[1]);
+	}
+}
@@ -0,0 +1,160 @@
+#include "CppUTest/TestHarness.h"
+#include "render_harness.h"
+#include <cstdio>
+#include <memory>
+
+using namespace deluge::bench;
+
+namespace {
+
+// One second of audio per measurement is long enough for stable numbers and short enough to keep ctest quick
+constexpr uint32_t kBenchSamples = kSampleRate;
+constexpr uint32_t kChordLength = kSampleRate / 4;
+
+RenderStats runBenchmark(VoiceSetup setup, int32_t polyphony) {
+	auto renderer = std::make_unique<OfflineRenderer>(setup);
+	auto script = makeChordScript(polyphony, kChordLength, kBenchSamples);
+	// warm up caches and the filters' internal state before measuring
+	renderer->render(script, SSI_TX_BUFFER_NUM_SAMPLES * 8);
+	renderer = std::make_unique<OfflineRenderer>(setup);
+	RenderStats stats = renderer->render(script, kBenchSamples);
+
+	// the render must actually produce sound, otherwise we're timing nothing
+	CHECK(stats.peakLevel > 0);
+	CHECK(stats.peakVoices >= polyphony);
+	return stats;
+}
+
+void printHeader(const char* what) {
+	printf("\n%-24s %10s %10s %10s %10s %10s\n", what, "ns/sample", "ns/v/smp", "osc", "filter", "reverb");
+}
+
+void printRow(const char* name, const RenderStats& stats) {
+	printf("%-24s %10.1f %10.2f %10.2f %10.2f %10.2f\n", name, stats.nsPerSample(), stats.nsPerVoiceSample(),
+	       stats.oscillatorNsPerVoiceSample(), stats.filterNsPerVoiceSample(), stats.reverbNsPerSample());
+}
+
+} // namespace
+
+TEST_GROUP(RenderBenchmark){};
+
+TEST(RenderBenchmark, perVoiceCount) {
+	printHeader("voices");
+	for (int32_t voices : {1, 8, 16, 32, 64}) {
+		char name[32];
+		snprintf(name, sizeof(name), "%d", voices);
+		printRow(name, runBenchmark(VoiceSetup{}, voices));
+	}
+}
+
+TEST(RenderBenchmark, perOscillatorType) {
+	struct {
+		const char* name;
+		OscType type;
+	} oscillators[] = {
+	    {"sine", OscType::SINE},
+	    {"triangle", OscType::TRIANGLE},
+	    {"square", OscType::SQUARE},
+	    {"saw", OscType::SAW},
+	};
+	printHeader("oscillator (16 voices)");
+	for (auto [name, type] : oscillators) {
+		VoiceSetup setup;
+		setup.oscType = type;
+		setup.lpfMode = FilterMode::OFF;
+		printRow(name, runBenchmark(setup, 16));
+	}
+}
+
+TEST(RenderBenchmark, perFilterMode) {
+	// matches the names filter_config.cpp saves with, which isn't linked here since it needs the firmware's libc
+	const char* names[] = {"12dB", "24dB", "24dBDrive", "SVF_Band", "SVF_Notch", "HPLadder", "OFF"};
+	printHeader("filter (16 voices)");
+	for (int32_t m = 0; m <= kNumFilterModes; m++) {
+		auto mode = static_cast<FilterMode>(m);
+		VoiceSetup setup;
+		// HPF-only modes get rendered through the HPF slot so each mode is measured where it's used
+		if (mode == FilterMode::HPLADDER) {
+			setup.lpfMode = FilterMode::OFF;
+			setup.hpfMode = mode;
+		}
+		else {
+			setup.lpfMode = mode;
+		}
+		printRow(names[m], runBenchmark(setup, 16));
+	}
+}
+
+TEST(RenderBenchmark, perUnisonCount) {
+	printHeader("unison (8 voices)");
+	for (int32_t unison : {1, 2, 4, 8}) {
+		VoiceSetup setup;
+		setup.numUnison = unison;
+		char name[32];
+		snprintf(name, sizeof(name), "%d", unison);
+		printRow(name, runBenchmark(setup, 8));
+	}
+}
+
+TEST(RenderBenchmark, batchedFilters) {
+	struct {
+		const char* name;
+		FilterMode lpfMode;
+		FilterMode hpfMode;
+	} filters[] = {
+	    // kept to show batching the ladders doesn't pay: their noise is drawn in voice order and their saturation goes
+	    // through a table a lane at a time
+	    {"LpLadder 24dB", FilterMode::TRANSISTOR_24DB, FilterMode::OFF},
+	    {"HpLadder", FilterMode::OFF, FilterMode::HPLADDER},
+	    {"SVF band", FilterMode::SVF_BAND, FilterMode::OFF},
+	    {"SVF notch", FilterMode::SVF_NOTCH, FilterMode::OFF},
+	    {"SVF LPF+HPF", FilterMode::SVF_BAND, FilterMode::SVF_BAND},
+	};
+	printf("\n%-24s %10s %10s %10s\n", "filter (ns/v/smp)", "one by one", "batched", "speedup");
+	for (auto [name, lpfMode, hpfMode] : filters) {
+		for (int32_t voices : {8, 16, 32}) {
+			VoiceSetup setup;
+			setup.lpfMode = lpfMode;
+			setup.hpfMode = hpfMode;
+			setup.reverbOn = false;
+			RenderStats scalar = runBenchmark(setup, voices);
+			setup.batchFilters = true;
+			RenderStats batched = runBenchmark(setup, voices);
+
+			char row[48];
+			snprintf(row, sizeof(row), "%s, %d voices", name, voices);
+			printf("%-24s %10.2f %10.2f %9.2fx\n", row, scalar.filterNsPerVoiceSample(),
+			       batched.filterNsPerVoiceSample(),
+			       scalar.filterNsPerVoiceSample() / batched.filterNsPerVoiceSample());
+		}
+	}
+}
+
+TEST(RenderBenchmark, reverb) {
+	printHeader("reverb (8 voices)");
+	VoiceSetup setup;
+	printRow("freeverb", runBenchmark(setup, 8));
+	setup.blockReverb = true;
+	printRow("freeverb block", runBenchmark(setup, 8));
+	setup.reverbOn = false;
+	printRow("off", runBenchmark(setup, 8));
+}
+
+// How many voices would fit in real time at each quality tier, on this machine. The tiers the harness can't model
+// (samples and tables) should come out the same as the one before them
+TEST(RenderBenchmark, voicesPerQualityTier) {
+	const char* names[] = {"full", "linear samples", "fewer unison", "no release filters", "small tables"};
+	static_assert(std::size(names) == kNumQualityTiers);
+	constexpr double kNsPerOutputSample = 1e9 / kSampleRate;
+
+	printf("\n%-24s %10s %10s %10s %10s\n", "tier (32 voices, 8 uni)", "ns/v/smp", "osc", "filter", "voices");
+	for (int32_t t = 0; t < kNumQualityTiers; t++) {
+		VoiceSetup setup;
+		setup.numUnison = 8;
+		setup.qualityTier = static_cast<QualityTier>(t);
+		RenderStats stats = runBenchmark(setup, 32);
+		double voices = (kNsPerOutputSample - stats.reverbNsPerSample()) / stats.nsPerVoiceSample();
+		printf("%-24s %10.2f %10.2f %10.2f %10.0f\n", names[t], stats.nsPerVoiceSample(),
+		       stats.oscillatorNsPerVoiceSample(), stats.filterNsPerVoiceSample(), voices);
+	}
+}
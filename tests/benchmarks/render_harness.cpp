@@ -0,0 +1,313 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "render_harness.h"
+#include "util/functions.h"
+#include "util/lookuptables/lookuptables.h"
+#include "util/waves.h"
+#include <chrono>
+#include <cmath>
+
+namespace deluge::bench {
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// Envelope::pos runs to this over a stage
+constexpr uint32_t kEnvelopeStageLength = 1 << 23;
+constexpr uint32_t kReleaseIncrement = kEnvelopeStageLength / OfflineRenderer::kReleaseSamples;
+
+uint64_t nsSince(Clock::time_point start) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+uint32_t phaseIncrementForNote(int32_t note, int32_t cents) {
+	double frequency = 440.0 * std::pow(2.0, ((note - 69) * 100 + cents) / 1200.0);
+	return (uint32_t)(frequency / kSampleRate * 4294967296.0);
+}
+
+// Each oscillator type gets its own loop so the type dispatch happens once per window, like Voice::renderOsc
+template <OscType type>
+[[gnu::always_inline]] inline int32_t oscValue(uint32_t phase) {
+	if constexpr (type == OscType::SINE) {
+		return getSine(phase);
+	}
+	else if constexpr (type == OscType::TRIANGLE) {
+		return getTriangle(phase);
+	}
+	else if constexpr (type == OscType::SQUARE) {
+		return getSquare(phase);
+	}
+	else {
+		// crude saw, as used by the firmware for low notes
+		return (int32_t)phase;
+	}
+}
+
+template <OscType type>
+void renderOscillator(q31_t* buffer, size_t numSamples, uint32_t* phase, uint32_t phaseIncrement, int32_t amplitude) {
+	uint32_t phaseNow = *phase;
+	for (size_t i = 0; i < numSamples; i++) {
+		phaseNow += phaseIncrement;
+		buffer[i] += multiply_32x32_rshift32(oscValue<type>(phaseNow), amplitude);
+	}
+	*phase = phaseNow;
+}
+} // namespace
+
+OfflineRenderer::OfflineRenderer(VoiceSetup setup) : setup_(setup) {
+	for (auto& voice : voices_) {
+		voice.filterSet.reset();
+	}
+	if (setup_.blockReverb) {
+		reverb_ = &blockFreeverb_;
+	}
+	else {
+		reverb_ = &freeverb_;
+	}
+	reverb_->setRoomSize(0.7);
+	reverb_->setDamping(0.5);
+	reverb_->setWidth(1);
+	reverb_->setPanLevels(ONE_Q31 >> 2, ONE_Q31 >> 2);
+}
+
+void OfflineRenderer::noteOn(int32_t note) {
+	if (numActiveVoices_ >= kMaxVoices) {
+		return;
+	}
+	HarnessVoice& voice = voices_[numActiveVoices_++];
+	voice.note = note;
+	voice.releasing = false;
+	voice.amplitude = ONE_Q31 >> 3;
+	voice.amplitudeIncrement = 0;
+	voice.releasePos = 0;
+	voice.envelopeLevel = ONE_Q31;
+	for (int32_t u = 0; u < setup_.numUnison; u++) {
+		// spread the unison parts 10 cents apart, centred on the note
+		int32_t cents = (u * 20 - (setup_.numUnison - 1) * 10) / 2;
+		voice.phases[u] = (uint32_t)u * 0x3456789u;
+		voice.phaseIncrements[u] = phaseIncrementForNote(note, cents);
+	}
+	voice.filterSet.reset();
+}
+
+void OfflineRenderer::noteOff(int32_t note) {
+	for (int32_t v = 0; v < numActiveVoices_; v++) {
+		HarnessVoice& voice = voices_[v];
+		if (voice.note == note && !voice.releasing) {
+			voice.releasing = true;
+			return;
+		}
+	}
+}
+
+// Like Envelope::render(), works out the release level for the end of the window, and the voice ramps to it
+void OfflineRenderer::advanceRelease(HarnessVoice& voice, size_t numSamples) {
+	if (!voice.releasing) {
+		return;
+	}
+	voice.releasePos += kReleaseIncrement * numSamples;
+	voice.envelopeLevel = (voice.releasePos < kEnvelopeStageLength)
+	                          ? interpolateTable(voice.releasePos, 23, decayTableSmall8)
+	                          : 0;
+	int32_t target = multiply_32x32_rshift32(voice.envelopeLevel, ONE_Q31 >> 3) << 1;
+	voice.amplitudeIncrement = (target - voice.amplitude) / (int32_t)numSamples;
+	if (!voice.envelopeLevel) {
+		// make sure it gets all the way to silent, so the voice is freed
+		voice.amplitudeIncrement = std::min(voice.amplitudeIncrement, -1);
+	}
+}
+
+void OfflineRenderer::renderOscillators(HarnessVoice& voice, q31_t* buffer, size_t numSamples) {
+	int32_t amplitude = ONE_Q31 / setup_.numUnison;
+	// as Voice::renderBasicSource() does under load
+	bool thinUnison = setup_.qualityTier >= QualityTier::FEWER_UNISON && setup_.numUnison > 2;
+	if (thinUnison) {
+		amplitude = std::min<int64_t>((int64_t)amplitude * unisonGainUnderLoad(setup_.numUnison) >> 16, ONE_Q31);
+	}
+	for (int32_t u = 0; u < setup_.numUnison; u++) {
+		uint32_t* phase = &voice.phases[u];
+		uint32_t phaseIncrement = voice.phaseIncrements[u];
+		if (thinUnison && unisonPartSkippedUnderLoad(u, setup_.numUnison)) {
+			*phase += phaseIncrement * numSamples;
+			continue;
+		}
+		switch (setup_.oscType) {
+		case OscType::SINE:
+			renderOscillator<OscType::SINE>(buffer, numSamples, phase, phaseIncrement, amplitude);
+			break;
+		case OscType::TRIANGLE:
+			renderOscillator<OscType::TRIANGLE>(buffer, numSamples, phase, phaseIncrement, amplitude);
+			break;
+		case OscType::SQUARE:
+			renderOscillator<OscType::SQUARE>(buffer, numSamples, phase, phaseIncrement, amplitude);
+			break;
+		default:
+			renderOscillator<OscType::SAW>(buffer, numSamples, phase, phaseIncrement, amplitude);
+			break;
+		}
+	}
+}
+
+void OfflineRenderer::mixVoice(HarnessVoice& voice, q31_t* buffer, size_t numSamples) {
+	int32_t amplitude = voice.amplitude;
+	for (size_t i = 0; i < numSamples; i++) {
+		amplitude = std::max(amplitude + voice.amplitudeIncrement, (int32_t)0);
+		q31_t sample = multiply_32x32_rshift32(buffer[i], amplitude) << 2;
+		output_[i].addMono(sample);
+		reverbBuffer_[i] += sample >> 3;
+	}
+	voice.amplitude = amplitude;
+}
+
+void OfflineRenderer::renderWindow(size_t numSamples, RenderStats& stats) {
+	auto windowStart = Clock::now();
+
+	std::fill_n(output_.begin(), numSamples, StereoSample{});
+	std::fill_n(reverbBuffer_.begin(), numSamples, 0);
+
+	int32_t groupSize;
+	for (int32_t first = 0; first < numActiveVoices_; first += groupSize) {
+		groupSize = (setup_.batchFilters && numActiveVoices_ - first >= dsp::filter::kBatchSize)
+		                ? dsp::filter::kBatchSize
+		                : 1;
+
+		auto stageStart = Clock::now();
+		for (int32_t i = 0; i < groupSize; i++) {
+			advanceRelease(voices_[first + i], numSamples);
+			std::fill_n(voiceBuffers_[i].begin(), numSamples, 0);
+			renderOscillators(voices_[first + i], voiceBuffers_[i].data(), numSamples);
+		}
+		stats.oscillatorNs += nsSince(stageStart);
+
+		stageStart = Clock::now();
+		for (int32_t i = 0; i < groupSize; i++) {
+			voices_[first + i].filterSet.setConfig(setup_.lpfFrequency, setup_.lpfResonance, setup_.lpfMode,
+			                                       setup_.lpfMorph, setup_.hpfFrequency, setup_.hpfResonance,
+			                                       setup_.hpfMode, setup_.hpfMorph, ONE_Q31 >> 1, setup_.filterRoute,
+			                                       false, nullptr);
+		}
+		// as Voice::render() does under load
+		std::array<bool, dsp::filter::kBatchSize> bypassFilters{};
+		bool anyBypassed = false;
+		for (int32_t i = 0; i < groupSize; i++) {
+			const HarnessVoice& voice = voices_[first + i];
+			bypassFilters[i] = setup_.qualityTier >= QualityTier::NO_RELEASE_FILTERS && voice.releasing
+			                   && voice.envelopeLevel < kInaudibleReleaseLevel;
+			anyBypassed |= bypassFilters[i];
+		}
+		bool batched = false;
+		if (groupSize == dsp::filter::kBatchSize && !anyBypassed) {
+			std::array<dsp::filter::FilterSet*, dsp::filter::kBatchSize> sets;
+			std::array<q31_t*, dsp::filter::kBatchSize> buffers;
+			for (int32_t i = 0; i < groupSize; i++) {
+				sets[i] = &voices_[first + i].filterSet;
+				buffers[i] = voiceBuffers_[i].data();
+			}
+			batched = dsp::filter::FilterBatch::renderLong(sets, buffers, numSamples, batchScratch_);
+		}
+		if (!batched) {
+			for (int32_t i = 0; i < groupSize; i++) {
+				if (bypassFilters[i]) {
+					continue;
+				}
+				q31_t* buffer = voiceBuffers_[i].data();
+				voices_[first + i].filterSet.renderLong(buffer, buffer + numSamples, numSamples);
+			}
+		}
+		stats.filterNs += nsSince(stageStart);
+
+		// amplitude envelope and mix, which the firmware also counts as part of the voice
+		stageStart = Clock::now();
+		for (int32_t i = 0; i < groupSize; i++) {
+			mixVoice(voices_[first + i], voiceBuffers_[i].data(), numSamples);
+		}
+		stats.oscillatorNs += nsSince(stageStart);
+	}
+	stats.numVoiceSamples += (uint64_t)numActiveVoices_ * numSamples;
+	stats.peakVoices = std::max(stats.peakVoices, numActiveVoices_);
+
+	// free any voices which finished releasing, keeping the active ones packed at the front like VoiceVector
+	for (int32_t v = 0; v < numActiveVoices_;) {
+		if (voices_[v].releasing && voices_[v].amplitude == 0) {
+			std::swap(voices_[v], voices_[--numActiveVoices_]);
+		}
+		else {
+			v++;
+		}
+	}
+
+	if (setup_.reverbOn) {
+		auto stageStart = Clock::now();
+		reverb_->process(std::span{reverbBuffer_.data(), numSamples}, std::span{output_.data(), numSamples});
+		stats.reverbNs += nsSince(stageStart);
+	}
+
+	stats.numSamples += numSamples;
+	stats.totalNs += nsSince(windowStart);
+
+	for (size_t i = 0; i < numSamples; i++) {
+		stats.peakLevel = std::max({stats.peakLevel, std::abs(output_[i].l), std::abs(output_[i].r)});
+	}
+}
+
+RenderStats OfflineRenderer::render(std::span<const NoteEvent> script, uint32_t numSamples,
+                                    std::span<StereoSample> output) {
+	RenderStats stats;
+	auto event = script.begin();
+	uint32_t time = 0;
+	while (time < numSamples) {
+		size_t windowSize = std::min<size_t>(SSI_TX_BUFFER_NUM_SAMPLES, numSamples - time);
+		// quantise events to the start of the window, as the audio routine does
+		while (event != script.end() && event->time < time + windowSize) {
+			if (event->on) {
+				noteOn(event->note);
+			}
+			else {
+				noteOff(event->note);
+			}
+			++event;
+		}
+		renderWindow(windowSize, stats);
+		if (!output.empty()) {
+			std::copy_n(output_.begin(), windowSize, output.begin() + time);
+		}
+		time += windowSize;
+	}
+	return stats;
+}
+
+std::vector<NoteEvent> makeChordScript(int32_t polyphony, uint32_t chordLength, uint32_t numSamples) {
+	std::vector<NoteEvent> script;
+	int32_t chord = 0;
+	for (uint32_t time = 0; time < numSamples; time += chordLength) {
+		int32_t root = 36 + (chord % 12);
+		for (int32_t n = 0; n < polyphony; n++) {
+			// stack the notes in fifths-ish intervals so no two share a note number
+			script.push_back({time, root + n * 7 % 48 + n / 7, true});
+		}
+		// release early enough that the chord has died away before the next one starts
+		uint32_t offTime = std::min(time + chordLength - OfflineRenderer::kReleaseSamples, numSamples);
+		for (int32_t n = 0; n < polyphony; n++) {
+			script.push_back({offTime, root + n * 7 % 48 + n / 7, false});
+		}
+		chord++;
+	}
+	return script;
+}
+
+} // namespace deluge::bench
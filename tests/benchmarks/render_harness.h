@@ -0,0 +1,158 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "definitions_cxx.hpp"
+#include "dsp/filter/filter_set.h"
+#include "dsp/reverb/freeverb/block_freeverb.hpp"
+#include "dsp/reverb/freeverb/freeverb.hpp"
+#include "dsp/stereo_sample.h"
+#include "filter_batch_renderer.h"
+#include "processing/engines/quality_tier.h"
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace deluge::bench {
+
+/// A scripted note on or off, timestamped in samples from the start of the render
+struct NoteEvent {
+	uint32_t time;
+	int32_t note;
+	bool on;
+};
+
+/// The patch every voice in the harness renders with. Defaults are a plain 24dB ladder saw with reverb on the send.
+struct VoiceSetup {
+	OscType oscType = OscType::SAW;
+	int32_t numUnison = 1;
+
+	FilterMode lpfMode = FilterMode::TRANSISTOR_24DB;
+	q31_t lpfFrequency = 1 << 23;
+	q31_t lpfResonance = 1 << 28;
+	q31_t lpfMorph = 0;
+	FilterMode hpfMode = FilterMode::OFF;
+	q31_t hpfFrequency = 1 << 20;
+	q31_t hpfResonance = 0;
+	q31_t hpfMorph = 0;
+	FilterRoute filterRoute = FilterRoute::HIGH_TO_LOW;
+
+	bool reverbOn = true;
+	/// Use BlockFreeverb rather than Freeverb
+	bool blockReverb = false;
+
+	/// Filter voices kBatchSize at a time with FilterBatch::renderLong(), as a Sound could
+	bool batchFilters = false;
+
+	/// Render as AudioEngine would at this quality tier. Only FEWER_UNISON and NO_RELEASE_FILTERS change anything here:
+	/// the harness plays no samples, and its oscillators are computed rather than read from band-limited tables
+	QualityTier qualityTier = QualityTier::FULL;
+};
+
+/// Wall-clock time spent in each stage of the render, accumulated over a whole script
+struct RenderStats {
+	uint64_t oscillatorNs = 0;
+	uint64_t filterNs = 0;
+	uint64_t reverbNs = 0;
+	uint64_t totalNs = 0;
+	/// Output samples rendered
+	uint64_t numSamples = 0;
+	/// Sum over all windows of active voices * samples in that window
+	uint64_t numVoiceSamples = 0;
+	int32_t peakVoices = 0;
+	/// Largest absolute output sample seen, measured outside the timed sections
+	q31_t peakLevel = 0;
+
+	/// Cost of the whole render per output sample
+	[[nodiscard]] double nsPerSample() const { return numSamples ? (double)totalNs / numSamples : 0; }
+	/// Cost of the per-voice stages (oscillators and filters) per sample, per voice
+	[[nodiscard]] double nsPerVoiceSample() const {
+		return numVoiceSamples ? (double)(oscillatorNs + filterNs) / numVoiceSamples : 0;
+	}
+	[[nodiscard]] double oscillatorNsPerVoiceSample() const {
+		return numVoiceSamples ? (double)oscillatorNs / numVoiceSamples : 0;
+	}
+	[[nodiscard]] double filterNsPerVoiceSample() const {
+		return numVoiceSamples ? (double)filterNs / numVoiceSamples : 0;
+	}
+	[[nodiscard]] double reverbNsPerSample() const { return numSamples ? (double)reverbNs / numSamples : 0; }
+};
+
+/**
+ * Drives the host-buildable parts of the render path (oscillators, per-voice FilterSet, the global reverb) over a
+ * scripted note sequence, in SSI_TX_BUFFER_NUM_SAMPLES windows the way AudioEngine::routine does. Events are applied at
+ * the start of the window they fall in, matching the firmware's quantisation.
+ *
+ * Sound, Voice and AudioEngine themselves depend on the song model, storage and UI, so the harness recreates the
+ * per-voice signal chain around the real DSP classes instead of linking them. The reverb is Freeverb or BlockFreeverb,
+ * since the Mutable model is built on argon and so needs real NEON.
+ */
+class OfflineRenderer {
+public:
+	static constexpr int32_t kMaxVoices = 256;
+	/// Length of the release, which follows the same curve as the firmware's default amplitude envelope
+	static constexpr int32_t kReleaseSamples = 2048;
+
+	explicit OfflineRenderer(VoiceSetup setup);
+
+	/// Render numSamples samples while playing the script, which must be sorted by time. If output is given, which must
+	/// be numSamples long, what's rendered is copied there
+	RenderStats render(std::span<const NoteEvent> script, uint32_t numSamples, std::span<StereoSample> output = {});
+
+	[[nodiscard]] int32_t numActiveVoices() const { return numActiveVoices_; }
+
+private:
+	struct HarnessVoice {
+		int32_t note;
+		bool releasing;
+		int32_t amplitude;
+		int32_t amplitudeIncrement;
+		/// Where the release has got to, out of 1 << 23 like Envelope::pos, and the envelope level there
+		uint32_t releasePos;
+		int32_t envelopeLevel;
+		std::array<uint32_t, kMaxNumVoicesUnison> phases;
+		std::array<uint32_t, kMaxNumVoicesUnison> phaseIncrements;
+		dsp::filter::FilterSet filterSet;
+	};
+
+	void noteOn(int32_t note);
+	void noteOff(int32_t note);
+	void advanceRelease(HarnessVoice& voice, size_t numSamples);
+	void renderWindow(size_t numSamples, RenderStats& stats);
+	void renderOscillators(HarnessVoice& voice, q31_t* buffer, size_t numSamples);
+	void mixVoice(HarnessVoice& voice, q31_t* buffer, size_t numSamples);
+
+	VoiceSetup setup_;
+	std::array<HarnessVoice, kMaxVoices> voices_;
+	int32_t numActiveVoices_ = 0;
+	dsp::reverb::Freeverb freeverb_;
+	dsp::reverb::BlockFreeverb blockFreeverb_;
+	dsp::reverb::Base* reverb_;
+
+	std::array<std::array<q31_t, SSI_TX_BUFFER_NUM_SAMPLES>, dsp::filter::kBatchSize> voiceBuffers_;
+	std::array<q31_t, dsp::filter::FilterBatch::kScratchSize> batchScratch_;
+	std::array<int32_t, SSI_TX_BUFFER_NUM_SAMPLES> reverbBuffer_;
+	std::array<StereoSample, SSI_TX_BUFFER_NUM_SAMPLES> output_;
+};
+
+/// Build a script which holds `polyphony` notes at once, changing chord every `chordLength` samples. chordLength must
+/// be longer than OfflineRenderer::kReleaseSamples.
+std::vector<NoteEvent> makeChordScript(int32_t polyphony, uint32_t chordLength, uint32_t numSamples);
+
+} // namespace deluge::bench
@@ -0,0 +1,91 @@
+#include "CppUTest/TestHarness.h"
+#include "dsp/reverb/freeverb/block_freeverb.hpp"
+#include "dsp/reverb/freeverb/freeverb.hpp"
+#include "util/waves.h"
+#include <array>
+#include <memory>
+#include <vector>
+
+using namespace deluge::dsp::reverb;
+
+namespace {
+
+struct Settings {
+	float roomSize;
+	float damping;
+	float width;
+};
+
+void configure(Base& reverb, const Settings& settings) {
+	reverb.setRoomSize(settings.roomSize);
+	reverb.setDamping(settings.damping);
+	reverb.setWidth(settings.width);
+	reverb.setPanLevels(ONE_Q31 >> 1, ONE_Q31 >> 2);
+}
+
+// Run the same input through both reverbs in windows of windowSize samples and count the samples that differ.
+// process() filters its input in place, so each reverb gets its own copy.
+int32_t countDifferences(Freeverb& freeverb, BlockFreeverb& blockFreeverb, const std::vector<int32_t>& input,
+                         size_t windowSize) {
+	int32_t numDifferent = 0;
+	for (size_t start = 0; start < input.size(); start += windowSize) {
+		size_t numSamples = std::min(windowSize, input.size() - start);
+		std::vector<int32_t> freeverbIn(input.begin() + start, input.begin() + start + numSamples);
+		std::vector<int32_t> blockIn = freeverbIn;
+		std::vector<StereoSample> freeverbOut(numSamples);
+		std::vector<StereoSample> blockOut(numSamples);
+
+		freeverb.process(freeverbIn, freeverbOut);
+		blockFreeverb.process(blockIn, blockOut);
+
+		for (size_t i = 0; i < numSamples; i++) {
+			numDifferent += (freeverbOut[i].l != blockOut[i].l) || (freeverbOut[i].r != blockOut[i].r);
+		}
+	}
+	return numDifferent;
+}
+
+} // namespace
+
+TEST_GROUP(BlockFreeverb){};
+
+// Impulse responses long enough for every comb to have wrapped several times, across the parameter range
+TEST(BlockFreeverb, impulseResponseMatchesFreeverb) {
+	const Settings settings[] = {
+	    {0.5, 0.5, 1},
+	    {1, 0, 1},
+	    {0, 1, 0},
+	    {0.9, 0.2, 0.5},
+	};
+	for (const Settings& setting : settings) {
+		auto freeverb = std::make_unique<Freeverb>();
+		auto blockFreeverb = std::make_unique<BlockFreeverb>();
+		configure(*freeverb, setting);
+		configure(*blockFreeverb, setting);
+
+		std::vector<int32_t> impulse(kSampleRate * 2, 0);
+		impulse[0] = ONE_Q31 >> 2;
+		CHECK_EQUAL(0, countDifferences(*freeverb, *blockFreeverb, impulse, SSI_TX_BUFFER_NUM_SAMPLES));
+	}
+}
+
+// Window sizes that don't divide the comb lengths or BlockFreeverb's own block size, with settings changing as they
+// would from the menu while it runs
+TEST(BlockFreeverb, matchesFreeverbAcrossWindowSizes) {
+	auto freeverb = std::make_unique<Freeverb>();
+	auto blockFreeverb = std::make_unique<BlockFreeverb>();
+
+	std::vector<int32_t> noise(kSampleRate / 4);
+	for (int32_t& sample : noise) {
+		sample = getNoise() >> 3;
+	}
+
+	int32_t setting = 0;
+	for (size_t windowSize : {1, 7, 64, 100, 128, 200}) {
+		Settings settings{0.3f + 0.1f * setting, 1.f - 0.15f * setting, 0.2f * setting};
+		configure(*freeverb, settings);
+		configure(*blockFreeverb, settings);
+		CHECK_EQUAL(0, countDifferences(*freeverb, *blockFreeverb, noise, windowSize));
+		setting++;
+	}
+}
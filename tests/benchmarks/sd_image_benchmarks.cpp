@@ -0,0 +1,210 @@
+#include "CppUTest/TestHarness.h"
+#include "card_access.h"
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+using namespace deluge::bench;
+
+namespace {
+
+// FAT32 only comes into it past 65524 Clusters, so with the 32kB ones cards are formatted with the image would be 2GB
+// - more than a 32-bit host build can map. 4kB Clusters get there in under 300MB
+constexpr uint32_t kSectorsPerCluster = 8;
+constexpr uint32_t kNumClusters = 70000;
+
+constexpr int32_t kNumSongs = 40;
+constexpr int32_t kNumSamplePairs = 12;
+constexpr uint32_t kNumClustersPerSample = 256;
+constexpr uint32_t kNumRecordedClusters = 1024;
+
+using Clock = std::chrono::steady_clock;
+
+struct Totals {
+	int32_t numFiles = 0;
+	uint64_t numBytes = 0;
+	double cardSeconds = 0;
+	double hostSeconds = 0;
+};
+
+bool hasExtension(const char* name, const char* extension) {
+	size_t nameLength = strlen(name);
+	size_t extensionLength = strlen(extension);
+	return nameLength > extensionLength && !strcasecmp(name + nameLength - extensionLength, extension);
+}
+
+/// Calls onFile(path, info) for every file under path, the way the browsers find them
+void walk(const std::string& path, const std::function<void(const std::string&, const FILINFO&)>& onFile) {
+	DIR dir;
+	if (f_opendir(&dir, path.c_str()) != FR_OK) {
+		return;
+	}
+	FILINFO info;
+	while (f_readdir(&dir, &info) == FR_OK && info.fname[0]) {
+		std::string child = path + "/" + info.fname;
+		if (info.fattrib & AM_DIR) {
+			walk(child, onFile);
+		}
+		else {
+			onFile(child, info);
+		}
+	}
+	f_closedir(&dir);
+}
+
+/// Reads a whole file a Cluster at a time, the way a song or preset is parsed
+uint64_t readWholeFile(FatImage& image, const std::string& path) {
+	FIL file;
+	if (f_open(&file, path.c_str(), FA_READ) != FR_OK) {
+		return 0;
+	}
+	std::vector<uint8_t> buffer(image.clusterSize());
+	uint64_t total = 0;
+	UINT numRead;
+	while (f_read(&file, buffer.data(), buffer.size(), &numRead) == FR_OK && numRead) {
+		total += numRead;
+	}
+	f_close(&file);
+	return total;
+}
+
+/// Loads everything on the card: songs, presets and anything else XML read whole, samples streamed
+void loadLibrary(FatImage& image, Totals& xml, Totals& audio) {
+	walk("", [&](const std::string& path, const FILINFO& info) {
+		bool isXML = hasExtension(info.fname, ".XML");
+		bool isAudio = hasExtension(info.fname, ".WAV") || hasExtension(info.fname, ".AIF")
+		               || hasExtension(info.fname, ".AIFF");
+		if (!isXML && !isAudio) {
+			return;
+		}
+		Totals& totals = isXML ? xml : audio;
+
+		image.resetCounts();
+		Clock::time_point start = Clock::now();
+		totals.numBytes += isXML ? readWholeFile(image, path) : streamSample(image, path);
+		totals.hostSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+		totals.cardSeconds += image.cardSeconds();
+		totals.numFiles++;
+	});
+}
+
+void printRow(const char* what, const Totals& totals) {
+	double megabytes = totals.numBytes / 1e6;
+	printf("%-8s %7d %10.1f %12.2f %12.0f\n", what, totals.numFiles, megabytes, totals.cardSeconds,
+	       totals.hostSeconds ? megabytes / totals.hostSeconds : 0);
+}
+
+void printHeader() {
+	printf("\n%-8s %7s %10s %12s %12s\n", "files", "count", "MB", "card s", "host MB/s");
+}
+
+/// A small library laid out like a user's card: songs copied on one at a time, samples recorded two at once
+void fillLibrary(FatImage& image) {
+	CHECK_EQUAL(FR_OK, f_mkdir("SONGS"));
+	CHECK_EQUAL(FR_OK, f_mkdir("SAMPLES"));
+	CHECK_EQUAL(FR_OK, f_mkdir("SAMPLES/RECORD"));
+
+	std::string song = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<song>\n";
+	while (song.size() < 24000) {
+		song += "\t<sound name=\"SYNT000\" polyphonic=\"poly\" voicePriority=\"1\" mode=\"subtractive\" />\n";
+	}
+	song += "</song>\n";
+	for (int32_t s = 0; s < kNumSongs; s++) {
+		char path[32];
+		snprintf(path, sizeof(path), "SONGS/SONG%03d.XML", s);
+		FIL file;
+		UINT written;
+		CHECK_EQUAL(FR_OK, f_open(&file, path, FA_CREATE_ALWAYS | FA_WRITE));
+		CHECK_EQUAL(FR_OK, f_write(&file, song.data(), song.size(), &written));
+		CHECK_EQUAL(FR_OK, f_close(&file));
+	}
+
+	for (int32_t p = 0; p < kNumSamplePairs; p++) {
+		std::array<std::string, 2> names;
+		for (int32_t f = 0; f < 2; f++) {
+			char path[32];
+			snprintf(path, sizeof(path), "SAMPLES/RECORD/REC%05d.WAV", p * 2 + f);
+			names[f] = path;
+		}
+		std::array<std::string_view, 2> paths = {names[0], names[1]};
+		image.writeInterleaved(paths, kNumClustersPerSample);
+	}
+}
+
+} // namespace
+
+TEST_GROUP(SDImageBenchmarks){};
+
+// Loads every song and sample off a FAT32 card image, through FatFs on the mmap()ed image. Pointed at a dd of a real
+// card with DELUGE_SD_IMAGE, it times that library instead
+TEST(SDImageBenchmarks, loadLibrary) {
+	const char* imagePath = getenv("DELUGE_SD_IMAGE");
+	std::unique_ptr<FatImage> image;
+	if (imagePath) {
+		image = std::make_unique<FatImage>(imagePath);
+	}
+	else {
+		image = std::make_unique<FatImage>(kNumClusters, kSectorsPerCluster);
+		CHECK_EQUAL(FS_FAT32, image->fileSystem.fs_type);
+		fillLibrary(*image);
+	}
+
+	Totals xml;
+	Totals audio;
+	loadLibrary(*image, xml, audio);
+
+	printf("\n%s, %.0f MB, FAT%d, %u byte Clusters", imagePath ? imagePath : "generated image",
+	       image->sizeBytes() / 1e6, image->fileSystem.fs_type == FS_FAT32 ? 32 : 16, image->clusterSize());
+	printHeader();
+	printRow("xml", xml);
+	printRow("audio", audio);
+
+	if (!imagePath) {
+		CHECK_EQUAL(kNumSongs, xml.numFiles);
+		CHECK_EQUAL(kNumSamplePairs * 2, audio.numFiles);
+		CHECK_EQUAL((uint64_t)kNumSamplePairs * 2 * kNumClustersPerSample * image->clusterSize(), audio.numBytes);
+	}
+}
+
+// Recording writes a Cluster at a time, while the file grows. What's recorded is still there when the card's image is
+// opened again
+TEST(SDImageBenchmarks, record) {
+	char imagePath[] = "/tmp/deluge-record-XXXXXX";
+	close(mkstemp(imagePath));
+	uint32_t clusterSize;
+	{
+		FatImage image(kNumClusters, kSectorsPerCluster, imagePath);
+		clusterSize = image.clusterSize();
+		std::vector<uint8_t> cluster(clusterSize, 0x5A);
+
+		FIL file;
+		CHECK_EQUAL(FR_OK, f_open(&file, "REC00000.WAV", FA_CREATE_ALWAYS | FA_WRITE));
+		Clock::time_point start = Clock::now();
+		for (uint32_t c = 0; c < kNumRecordedClusters; c++) {
+			UINT written;
+			CHECK_EQUAL(FR_OK, f_write(&file, cluster.data(), cluster.size(), &written));
+			CHECK_EQUAL(cluster.size(), written);
+		}
+		CHECK_EQUAL(FR_OK, f_close(&file));
+		double hostSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		double megabytes = kNumRecordedClusters * clusterSize / 1e6;
+		printf("\nrecorded %.1f MB at %.0f host MB/s\n", megabytes, megabytes / hostSeconds);
+	}
+
+	FatImage image(imagePath);
+	unlink(imagePath);
+	Totals xml;
+	Totals audio;
+	loadLibrary(image, xml, audio);
+	CHECK_EQUAL(1, audio.numFiles);
+	CHECK_EQUAL((uint64_t)kNumRecordedClusters * clusterSize, audio.numBytes);
+	FIL file;
+	CHECK_EQUAL(FR_WRITE_PROTECTED, f_open(&file, "NEW.WAV", FA_CREATE_ALWAYS | FA_WRITE));
+}
@@ -0,0 +1,488 @@
+#include "CppUTest/TestHarness.h"
+#include "card_access.h"
+#include "storage/audio/audio_file_manager.h"
+#include "storage/binary_serializer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace deluge::bench;
+
+namespace {
+
+constexpr uint32_t kSectorsPerCluster = 8;
+constexpr uint32_t kNumClusters = 70000;
+
+constexpr int32_t kNumSongs = 12;
+constexpr int32_t kNumBigSongs = 4;
+constexpr int32_t kNumParseRepeats = 8;
+
+using Clock = std::chrono::steady_clock;
+
+// The generated songs' values the model reads as text. It reads all the others as numbers
+bool isReadAsText(char const* name) {
+	for (char const* textName :
+	     {"name", "polyphonic", "mode", "lpfMode", "modFXType", "type", "source", "destination", "controlsParam",
+	      "instrumentPresetName", "firmwareVersion", "earliestCompatibleFirmware", "previewNumPads"}) {
+		if (!strcmp(name, textName)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+struct Random {
+	uint32_t state;
+	uint32_t next() {
+		state = state * 1664525u + 1013904223u;
+		return state;
+	}
+};
+
+void writeHexChars(Serializer& writer, Random& random, int32_t numChars) {
+	char chunk[9];
+	for (; numChars > 0; numChars -= 8) {
+		snprintf(chunk, sizeof(chunk), "%08X", random.next());
+		chunk[numChars < 8 ? numChars : 8] = 0;
+		writer.write(chunk);
+	}
+}
+
+// Params are written raw by ParamSet, with any automation nodes straight after the value
+void writeParam(Serializer& writer, Random& random, char const* name, int32_t numNodes = 0) {
+	writer.write("\n");
+	writer.printIndents();
+	writer.write(name);
+	writer.write("=\"0x");
+	writeHexChars(writer, random, 8 + numNodes * 16);
+	writer.write("\"");
+}
+
+constexpr char const* kParamNames[] = {"arpeggiatorGate", "portamento", "compressorShape", "oscAVolume",
+    "oscAPulseWidth", "oscBVolume", "oscBPulseWidth", "noiseVolume", "volume", "pan", "lpfFrequency", "lpfResonance",
+    "hpfFrequency", "hpfResonance", "lfo1Rate", "lfo2Rate", "modulator1Amount", "modulator1Feedback",
+    "modulator2Amount", "carrier1Feedback", "pitchAdjust", "modFXRate", "modFXDepth", "delayRate", "delayFeedback",
+    "reverbAmount", "arpeggiatorRate", "stutterRate", "sampleRateReduction", "bitCrush"};
+
+constexpr char const* kKnobParams[] = {"pan", "volumePostFX", "lpfResonance", "lpfFrequency", "env1Release",
+    "env1Attack", "delayFeedback", "delayRate", "reverbAmount", "volumePostReverbSend", "pitch", "lfo1Rate",
+    "portamento", "stutterRate", "bitcrushAmount", "sampleRateReduction"};
+
+// Values that hold params, which the model reads the way AutoParam::readFromFile() does
+bool isParam(char const* name) {
+	for (char const* paramName : kParamNames) {
+		if (!strcmp(name, paramName)) {
+			return true;
+		}
+	}
+	for (char const* paramName : {"attack", "decay", "sustain", "release", "amount", "bass", "treble", "bassFrequency",
+	                              "trebleFrequency"}) {
+		if (!strcmp(name, paramName)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/// Reads a "0x" value a few bytes at a time, the way the model reads params, notes and clip instances
+template <typename Reader>
+void loadHexBytes(Reader& reader, Walk& walk, int32_t firstNumBytes, int32_t numBytes) {
+	if (!reader.prepareToReadTagOrAttributeValueOneCharAtATime()) {
+		return;
+	}
+	reader.getNumCharsRemainingInValue();
+	char const* prefix = reader.readNextCharsOfTagOrAttributeValue(2);
+	if (!prefix || prefix[0] != '0' || prefix[1] != 'x') {
+		return;
+	}
+	uint8_t const* bytes = reader.readNextHexBytesOfTagOrAttributeValue(firstNumBytes);
+	while (bytes) {
+		walk.add((char const*)bytes, firstNumBytes);
+		walk.numValueChars += firstNumBytes * 2;
+		firstNumBytes = numBytes;
+		bytes = reader.readNextHexBytesOfTagOrAttributeValue(numBytes);
+	}
+}
+
+/// Reads everything under the current element with the calls the model would use for it: numbers as numbers, text as
+/// text, and the long hex values as bytes
+template <typename Reader>
+void loadElement(Reader& reader, Walk& walk) {
+	char const* name;
+	while (*(name = reader.readNextTagOrAttributeName())) {
+		walk.add(name, strlen(name));
+		walk.numNames++;
+		if (isParam(name)) {
+			loadHexBytes(reader, walk, 4, 8);
+		}
+		else if (!strcmp(name, "noteDataWithLift")) {
+			loadHexBytes(reader, walk, 11, 11);
+		}
+		else if (!strcmp(name, "preview")) {
+			loadHexBytes(reader, walk, 54, 54); // A row of pads at a time, as LoadSongUI draws it
+		}
+		else if (!reader.isAtAttributeValue()) {
+			loadElement(reader, walk);
+		}
+		else if (isReadAsText(name)) {
+			walk.addTrimmed(reader.readTagOrAttributeValue());
+		}
+		else {
+			walk.addNumber(reader.readTagOrAttributeValueInt());
+		}
+		reader.exitTag(name);
+	}
+}
+
+void writeSound(Serializer& writer, Random& random, int32_t index) {
+	char name[12];
+	snprintf(name, sizeof(name), "SYNT%03d", index);
+	writer.writeOpeningTagBeginning("sound");
+	writer.writeAttribute("name", name);
+	writer.writeAttribute("presetSlot", index);
+	writer.writeAttribute("presetSubSlot", -1);
+	writer.writeAttribute("polyphonic", "poly");
+	writer.writeAttribute("voicePriority", 1);
+	writer.writeAttribute("mode", "subtractive");
+	writer.writeAttribute("lpfMode", "24dB");
+	writer.writeAttribute("modFXType", "none");
+	writer.writeOpeningTagEnd();
+
+	for (char const* osc : {"osc1", "osc2"}) {
+		writer.writeOpeningTagBeginning(osc);
+		writer.writeAttribute("type", osc[3] == '1' ? "saw" : "square");
+		writer.writeAttribute("transpose", osc[3] == '1' ? 0 : -12);
+		writer.writeAttribute("cents", (int32_t)(random.next() % 100) - 50);
+		writer.writeAttribute("retrigPhase", -1);
+		writer.closeTag();
+	}
+	for (char const* lfo : {"lfo1", "lfo2"}) {
+		writer.writeOpeningTagBeginning(lfo);
+		writer.writeAttribute("type", "triangle");
+		writer.writeAttribute("syncLevel", 0);
+		writer.closeTag();
+	}
+	writer.writeOpeningTagBeginning("unison");
+	writer.writeAttribute("num", 1);
+	writer.writeAttribute("detune", 8);
+	writer.closeTag();
+	writer.writeOpeningTagBeginning("delay");
+	writer.writeAttribute("pingPong", 1);
+	writer.writeAttribute("analog", 0);
+	writer.writeAttribute("syncLevel", 7);
+	writer.closeTag();
+
+	writer.writeOpeningTagBeginning("defaultParams");
+	for (char const* param : kParamNames) {
+		// Some automated, a few of those with more nodes than fit one value
+		int32_t numNodes = (random.next() % 7) ? 0 : 4 + random.next() % 48;
+		writeParam(writer, random, param, numNodes);
+	}
+	writer.writeOpeningTagEnd();
+	for (char const* envelope : {"envelope1", "envelope2"}) {
+		writer.writeOpeningTagBeginning(envelope);
+		for (char const* stage : {"attack", "decay", "sustain", "release"}) {
+			writeParam(writer, random, stage);
+		}
+		writer.closeTag();
+	}
+	writer.writeOpeningTag("patchCables");
+	for (char const* destination : {"volume", "lpfFrequency", "pitch"}) {
+		writer.writeOpeningTagBeginning("patchCable");
+		writer.writeAttribute("source", "velocity");
+		writer.writeAttribute("destination", destination);
+		writeParam(writer, random, "amount");
+		writer.closeTag();
+	}
+	writer.writeClosingTag("patchCables");
+	writer.writeOpeningTag("equalizer");
+	writer.writeTag("bass", "0x00000000");
+	writer.writeTag("treble", "0x00000000");
+	writer.writeTag("bassFrequency", "0x00000000");
+	writer.writeTag("trebleFrequency", "0x00000000");
+	writer.writeClosingTag("equalizer");
+	writer.writeClosingTag("defaultParams");
+
+	writer.writeOpeningTag("modKnobs");
+	for (char const* param : kKnobParams) {
+		writer.writeOpeningTagBeginning("modKnob");
+		writer.writeAttribute("controlsParam", param);
+		writer.closeTag();
+	}
+	writer.writeClosingTag("modKnobs");
+	writer.writeClosingTag("sound");
+}
+
+void writeClip(Serializer& writer, Random& random, int32_t index, int32_t numInstruments) {
+	char name[12];
+	snprintf(name, sizeof(name), "SYNT%03d", index % numInstruments);
+	writer.writeOpeningTagBeginning("instrumentClip");
+	writer.writeAttribute("inKeyMode", 0);
+	writer.writeAttribute("instrumentPresetName", name);
+	writer.writeAttribute("instrumentPresetSlot", index % numInstruments);
+	writer.writeAttribute("isPlaying", 0);
+	writer.writeAttribute("isSoloing", 0);
+	writer.writeAttribute("length", 1536);
+	writer.writeAttribute("colourOffset", -60 + index);
+	writer.writeAttribute("section", index % 12);
+	writer.writeAttribute("yScroll", 28);
+	writer.writeAttribute("xZoom", 48);
+	writer.writeOpeningTagEnd();
+
+	writer.writeOpeningTag("noteRows");
+	for (int32_t r = 0; r < 8; r++) {
+		writer.writeOpeningTagBeginning("noteRow");
+		writer.writeAttribute("y", 48 + r);
+		writer.write("\n");
+		writer.printIndents();
+		writer.write("noteDataWithLift=\"0x");
+		writeHexChars(writer, random, (8 + random.next() % 32) * 22);
+		writer.write("\"");
+		writer.closeTag();
+	}
+	writer.writeClosingTag("noteRows");
+	writer.writeClosingTag("instrumentClip");
+}
+
+/// A song laid out the way Song::writeToFile() lays one out, with the firmware's own XML writer
+void writeSong(char const* path, int32_t numInstruments, int32_t numClips, uint32_t seed) {
+	Random random{seed};
+	XMLSerializer writer;
+	CHECK_EQUAL(FR_OK, f_open(&fileSystemStuff.currentFile, path, FA_CREATE_ALWAYS | FA_WRITE));
+	writer.fileWriteBufferCurrentPos = 0;
+	writer.fileTotalBytesWritten = 0;
+	writer.fileAccessFailedDuringWrite = false;
+	writer.write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+	writer.indentAmount = 0;
+
+	writer.writeOpeningTagBeginning("song");
+	writer.writeAttribute("firmwareVersion", "4.1.4");
+	writer.writeEarliestCompatibleFirmwareVersion("4.1.0-alpha");
+	writer.writeAttributeHex("saveToken", random.next() | 1, 8);
+	writer.writeAttribute("previewNumPads", "144");
+	writer.write("\n");
+	writer.printIndents();
+	writer.write("preview=\"");
+	writeHexChars(writer, random, 8 * 18 * 3 * 2);
+	writer.write("\"");
+	writer.writeAttribute("xScroll", 0);
+	writer.writeAttribute("xZoom", 96);
+	writer.writeAttribute("yScrollSongView", 0);
+	writer.writeAttribute("timePerTimerTick", 1000);
+	writer.writeAttribute("rootNote", 0);
+	writer.writeAttribute("inputTickMagnitude", 1);
+	writer.writeAttribute("swingAmount", 0);
+	writer.writeAttribute("swingInterval", 7);
+	writer.writeOpeningTagEnd();
+
+	writer.writeOpeningTagBeginning("reverb");
+	writer.writeAttribute("roomSize", 0x35A7EF9E);
+	writer.writeAttribute("dampening", 0x3D70A3C0);
+	writer.writeAttribute("width", 0x7FFFFFFF);
+	writer.writeAttribute("pan", 0);
+	writer.closeTag();
+
+	writer.writeOpeningTag("instruments");
+	for (int32_t i = 0; i < numInstruments; i++) {
+		writeSound(writer, random, i);
+	}
+	writer.writeClosingTag("instruments");
+
+	writer.writeOpeningTag("sections");
+	for (int32_t s = 0; s < 12; s++) {
+		writer.writeOpeningTagBeginning("section");
+		writer.writeAttribute("id", s);
+		writer.writeAttribute("numRepeats", 0);
+		writer.closeTag();
+	}
+	writer.writeClosingTag("sections");
+
+	writer.writeOpeningTag("sessionClips");
+	for (int32_t c = 0; c < numClips; c++) {
+		writeClip(writer, random, c, numInstruments);
+	}
+	writer.writeClosingTag("sessionClips");
+	writer.writeClosingTag("song");
+
+	CHECK(writer.closeFileAfterWriting(path) == Error::NONE);
+	f_close(&fileSystemStuff.currentFile);
+}
+
+bool hasExtension(const char* name, const char* extension) {
+	size_t nameLength = strlen(name);
+	size_t extensionLength = strlen(extension);
+	return nameLength > extensionLength && !strcasecmp(name + nameLength - extensionLength, extension);
+}
+
+/// Copies the songs off a real card image, so they can be converted without writing to it
+void copySongs(FatImage& from, FatImage& to, std::vector<std::string>& paths) {
+	f_mount(&from.fileSystem, "", 1);
+	std::vector<std::pair<std::string, std::vector<uint8_t>>> songs;
+	DIR dir;
+	FILINFO info;
+	if (f_opendir(&dir, "SONGS") == FR_OK) {
+		while (f_readdir(&dir, &info) == FR_OK && info.fname[0]) {
+			if ((info.fattrib & AM_DIR) || !hasExtension(info.fname, ".XML")) {
+				continue;
+			}
+			FIL file;
+			std::string path = std::string("SONGS/") + info.fname;
+			std::vector<uint8_t> contents(info.fsize);
+			UINT numRead;
+			if (f_open(&file, path.c_str(), FA_READ) == FR_OK) {
+				f_read(&file, contents.data(), contents.size(), &numRead);
+				f_close(&file);
+				songs.emplace_back(path, std::move(contents));
+			}
+		}
+		f_closedir(&dir);
+	}
+
+	f_mount(&fileSystemStuff.fileSystem, "", 1);
+	f_mkdir("SONGS");
+	for (auto& [path, contents] : songs) {
+		FIL file;
+		UINT written;
+		CHECK_EQUAL(FR_OK, f_open(&file, path.c_str(), FA_CREATE_ALWAYS | FA_WRITE));
+		CHECK_EQUAL(FR_OK, f_write(&file, contents.data(), contents.size(), &written));
+		CHECK_EQUAL(FR_OK, f_close(&file));
+		paths.push_back(path);
+	}
+}
+
+struct Totals {
+	uint64_t numBytes = 0;
+	double cardSeconds = 0;
+	double hostSeconds = 0;
+};
+
+void printRow(const char* what, int32_t numFiles, const Totals& totals) {
+	printf("%-8s %7d %10.2f %12.3f %12.2f\n", what, numFiles, totals.numBytes / 1e6, totals.cardSeconds,
+	       totals.hostSeconds * 1e3);
+}
+
+} // namespace
+
+TEST_GROUP(SongLoadBenchmarks){};
+
+// Converts songs to binary and reads both back through the Deserializer interface the model reads with. Pointed at
+// a dd of a real card with DELUGE_SD_IMAGE, it does that card's songs instead of generated ones
+TEST(SongLoadBenchmarks, xmlVersusBinary) {
+	SongCard card(kNumClusters, kSectorsPerCluster);
+	std::vector<std::string> paths;
+	const char* imagePath = getenv("DELUGE_SD_IMAGE");
+	std::unique_ptr<FatImage> source;
+	if (imagePath) {
+		source = std::make_unique<FatImage>(imagePath);
+		copySongs(*source, *card.image, paths);
+	}
+	else {
+		CHECK_EQUAL(FR_OK, f_mkdir("SONGS"));
+		for (int32_t s = 0; s < kNumSongs; s++) {
+			char path[32];
+			snprintf(path, sizeof(path), "SONGS/SONG%03d.XML", s);
+			writeSong(path, 4 + s * 2, 8 + s * 4, s + 1);
+			paths.push_back(path);
+		}
+	}
+
+	StorageManager storage;
+	XMLDeserializer xmlReader;
+	BinarySerializer binaryWriter;
+	BinaryDeserializer binaryReader;
+
+	int32_t numConverted = 0;
+	Totals xml;
+	Totals binary;
+	for (std::string const& path : paths) {
+		if (writeTwin(storage, path, xmlReader, binaryWriter) != Error::NONE) {
+			continue; // Something the format can't hold - it'd be loaded from the XML
+		}
+		numConverted++;
+
+		card.image->resetCounts();
+		Clock::time_point start = Clock::now();
+		Walk fromXML = walkXML(storage, xmlReader, path, loadElement<XMLDeserializer>);
+		xml.hostSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+		xml.cardSeconds += card.image->cardSeconds();
+		xml.numBytes += fileSize(path);
+
+		card.image->resetCounts();
+		start = Clock::now();
+		Walk fromBinary = walkBinary(storage, binaryReader, path, loadElement<BinaryDeserializer>);
+		binary.hostSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+		binary.cardSeconds += card.image->cardSeconds();
+		binary.numBytes += fileSize(twinPathOf(path));
+
+		CHECK_EQUAL(fromXML.numNames, fromBinary.numNames);
+		CHECK_EQUAL(fromXML.numValueChars, fromBinary.numValueChars);
+		CHECK(fromXML.hash == fromBinary.hash);
+
+		// And every value as the same text
+		fromXML = walkXML(storage, xmlReader, path);
+		fromBinary = walkBinary(storage, binaryReader, path);
+		CHECK_EQUAL(fromXML.numValueChars, fromBinary.numValueChars);
+		CHECK(fromXML.hash == fromBinary.hash);
+	}
+
+	printf("\n%s, %d of %d songs converted\n", imagePath ? imagePath : "generated songs", numConverted,
+	       (int32_t)paths.size());
+	printf("%-8s %7s %10s %12s %12s\n", "format", "songs", "MB", "card s", "host ms");
+	printRow("XML", numConverted, xml);
+	printRow("binary", numConverted, binary);
+
+	if (!imagePath) {
+		CHECK_EQUAL(kNumSongs, numConverted);
+	}
+	if (numConverted) {
+		CHECK(binary.numBytes < xml.numBytes);
+		CHECK(binary.cardSeconds < xml.cardSeconds);
+	}
+}
+
+// How fast the XML tokenizer gets through big songs once they're off the card: reading every name and value the way a
+// load does, and skipping over the whole song the way exitTag() does anything a reader doesn't use
+TEST(SongLoadBenchmarks, xmlParseThroughput) {
+	SongCard card(kNumClusters, kSectorsPerCluster);
+	CHECK_EQUAL(FR_OK, f_mkdir("SONGS"));
+	std::vector<std::string> paths;
+	for (int32_t s = 0; s < kNumBigSongs; s++) {
+		char path[32];
+		snprintf(path, sizeof(path), "SONGS/BIG%03d.XML", s);
+		writeSong(path, 48, 160, 100 + s);
+		paths.push_back(path);
+	}
+
+	StorageManager storage;
+	XMLDeserializer reader;
+	reader.msd = &storage;
+	Totals walked;
+	Totals skipped;
+	for (int32_t r = 0; r < kNumParseRepeats; r++) {
+		for (std::string const& path : paths) {
+			Clock::time_point start = Clock::now();
+			Walk walk = walkXML(storage, reader, path);
+			walked.hostSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+			walked.numBytes += fileSize(path);
+			CHECK(walk.numNames > 0);
+
+			FilePointer filePointer = filePointerFor(path.c_str());
+			start = Clock::now();
+			CHECK(reader.openXMLFile(&filePointer, "song") == Error::NONE);
+			reader.exitTag("song");
+			f_close(&fileSystemStuff.currentFile);
+			skipped.hostSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+			skipped.numBytes += fileSize(path);
+		}
+	}
+
+	printf("\nXML parse, %d songs of %.2f MB\n", kNumBigSongs, walked.numBytes / 1e6 / kNumParseRepeats / kNumBigSongs);
+	printf("%-8s %10s %12s\n", "pass", "MB", "host MB/s");
+	printf("%-8s %10.1f %12.1f\n", "walk", walked.numBytes / 1e6, walked.numBytes / 1e6 / walked.hostSeconds);
+	printf("%-8s %10.1f %12.1f\n", "skip", skipped.numBytes / 1e6, skipped.numBytes / 1e6 / skipped.hostSeconds);
+}
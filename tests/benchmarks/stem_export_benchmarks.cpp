@@ -0,0 +1,95 @@
+#include "CppUTest/TestHarness.h"
+#include "fat_image.h"
+#include "stem_export_harness.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace deluge::bench;
+
+namespace {
+
+// As in sd_image_benchmarks.cpp: 4kB Clusters, a little under 300MB of sparse image
+constexpr uint32_t kSectorsPerCluster = 8;
+constexpr uint32_t kNumClusters = 70000;
+
+std::vector<uint8_t> readFile(std::string const& path) {
+	FIL file;
+	CHECK_EQUAL(FR_OK, f_open(&file, path.c_str(), FA_READ));
+	std::vector<uint8_t> data(f_size(&file));
+	UINT numRead;
+	CHECK_EQUAL(FR_OK, f_read(&file, data.data(), data.size(), &numRead));
+	CHECK_EQUAL(data.size(), numRead);
+	f_close(&file);
+	return data;
+}
+
+std::string exportFolder(HarnessSong const& song, int32_t number) {
+	char folder[64];
+	snprintf(folder, sizeof(folder), "SAMPLES/EXPORTS/%s/TRACKS%02d", song.name.c_str(), number);
+	return folder;
+}
+
+/// Whether each stem exported to the two folders is the same, byte for byte
+void checkSameStems(HarnessSong const& song, std::string const& folderA, std::string const& folderB) {
+	for (int32_t t = 0; t < (int32_t)song.tracks.size(); t++) {
+		std::vector<uint8_t> a = readFile(stemPath(song, folderA.c_str(), t));
+		std::vector<uint8_t> b = readFile(stemPath(song, folderB.c_str(), t));
+		CHECK_EQUAL(a.size(), b.size());
+		CHECK(a == b);
+	}
+}
+
+void printRow(const char* what, StemExportStats const& stats) {
+	printf("%-10s %8d %10.2f %14.1f %12.1f\n", what, stats.numThreads, stats.seconds, stats.timesRealTime(),
+	       stats.numBytesWritten / 1e6 / stats.seconds);
+}
+
+} // namespace
+
+TEST_GROUP(StemExportHarness){};
+
+// However many threads render the stems, and in whatever order they finish, each comes out as the one thread would
+// have made it: a proper WAV, of that track alone
+TEST(StemExportHarness, threadsMatchSerial) {
+	FatImage image(kNumClusters, kSectorsPerCluster);
+	HarnessSong song = makeStemExportSong(8, kSampleRate);
+	std::string serialFolder = exportFolder(song, 0);
+	std::string threadedFolder = exportFolder(song, 1);
+
+	StemExportStats serial = exportStems(song, serialFolder.c_str(), 1);
+	StemExportStats threaded = exportStems(song, threadedFolder.c_str(), 5);
+	CHECK_EQUAL(8, serial.numStems);
+	CHECK_EQUAL(serial.numBytesWritten, threaded.numBytesWritten);
+	checkSameStems(song, serialFolder, threadedFolder);
+
+	std::vector<uint8_t> first = readFile(stemPath(song, serialFolder.c_str(), 0));
+	std::vector<uint8_t> second = readFile(stemPath(song, serialFolder.c_str(), 1));
+	CHECK_EQUAL(44 + kSampleRate * 6, first.size());
+	CHECK(!memcmp(first.data(), "RIFF", 4));
+	CHECK(!memcmp(first.data() + 8, "WAVEfmt ", 8));
+	CHECK(!memcmp(first.data() + 36, "data", 4));
+	CHECK(first != second);
+	CHECK(std::any_of(first.begin() + 44, first.end(), [](uint8_t byte) { return byte != 0; }));
+}
+
+// A 32-track harness song's stems, four seconds each, one after another and then on a thread per core. With one core
+// there's nothing to gain, and the two rows only show what the threading costs
+TEST(StemExportHarness, threadScaling) {
+	FatImage image(kNumClusters, kSectorsPerCluster);
+	HarnessSong song = makeStemExportSong(32, kSampleRate * 4);
+	int32_t numCores = std::max<int32_t>(std::thread::hardware_concurrency(), 1);
+
+	StemExportStats serial = exportStems(song, exportFolder(song, 0).c_str(), 1);
+	StemExportStats threaded = exportStems(song, exportFolder(song, 1).c_str(), numCores);
+	checkSameStems(song, exportFolder(song, 0), exportFolder(song, 1));
+
+	printf("\nharness model, not StemExport: %d stems of %.0fs, %.1f MB of WAVs, %d cores\n", serial.numStems,
+	       (double)song.numSamples / kSampleRate, serial.numBytesWritten / 1e6, numCores);
+	printf("%-10s %8s %10s %14s %12s\n", "", "threads", "seconds", "x real time", "MB/s");
+	printRow("serial", serial);
+	printRow("threaded", threaded);
+}
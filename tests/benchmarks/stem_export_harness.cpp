@@ -0,0 +1,211 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "stem_export_harness.h"
+#include "util/waves.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+extern "C" {
+#include "fatfs/ff.h"
+}
+
+namespace deluge::bench {
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr int32_t kNumChannels = 2;
+constexpr int32_t kByteDepth = 3;
+constexpr uint32_t kWAVHeaderSize = 44;
+
+// Where the noise the drive ladder and the like put in starts for every stem: otherwise it'd carry on from whichever
+// stem the thread rendered last
+constexpr uint32_t kNoiseSeed = 380116160;
+
+void check(FRESULT result, const char* what) {
+	if (result != FR_OK) {
+		throw std::runtime_error(std::string(what) + " failed with FatFs error " + std::to_string(result));
+	}
+}
+
+void writeInt32(uint8_t*& pos, uint32_t value) {
+	for (int32_t i = 0; i < 4; i++) {
+		*(pos++) = value >> (i * 8);
+	}
+}
+
+void writeInt16(uint8_t*& pos, uint16_t value) {
+	*(pos++) = value;
+	*(pos++) = value >> 8;
+}
+
+/// The audio as SampleRecorder would write it: its header as finalised once the length's known, then the top three
+/// bytes of each sample
+void encodeWAV(std::span<const StereoSample> audio, std::vector<uint8_t>& wav) {
+	uint32_t dataLength = audio.size() * kNumChannels * kByteDepth;
+	wav.resize(kWAVHeaderSize + dataLength);
+	uint8_t* pos = wav.data();
+
+	writeInt32(pos, 0x46464952); // "RIFF"
+	writeInt32(pos, dataLength + kWAVHeaderSize - 8);
+	writeInt32(pos, 0x45564157); // "WAVE"
+
+	writeInt32(pos, 0x20746d66); // "fmt "
+	writeInt32(pos, 16);
+	writeInt16(pos, 0x0001); // PCM
+	writeInt16(pos, kNumChannels);
+	writeInt32(pos, kSampleRate);
+	writeInt32(pos, kSampleRate * kNumChannels * kByteDepth);
+	writeInt16(pos, kNumChannels * kByteDepth);
+	writeInt16(pos, kByteDepth * 8);
+
+	writeInt32(pos, 0x61746164); // "data"
+	writeInt32(pos, dataLength);
+
+	for (StereoSample const& sample : audio) {
+		for (q31_t channel : {sample.l, sample.r}) {
+			*(pos++) = channel >> 8;
+			*(pos++) = channel >> 16;
+			*(pos++) = channel >> 24;
+		}
+	}
+}
+
+/// Makes each folder along the path, as StemExport::getUnusedStemRecordingFolderPath() does
+void makeFolders(std::string const& path) {
+	for (size_t slash = path.find('/'); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+		FRESULT result = f_mkdir(path.substr(0, slash).c_str());
+		if (result != FR_EXIST) {
+			check(result, "f_mkdir");
+		}
+	}
+	FRESULT result = f_mkdir(path.c_str());
+	if (result != FR_EXIST) {
+		check(result, "f_mkdir");
+	}
+}
+
+void writeFile(std::string const& path, std::vector<uint8_t> const& data) {
+	FIL file;
+	UINT written;
+	check(f_open(&file, path.c_str(), FA_CREATE_ALWAYS | FA_WRITE), "f_open");
+	check(f_write(&file, data.data(), data.size(), &written), "f_write");
+	check(f_close(&file), "f_close");
+	if (written != data.size()) {
+		throw std::runtime_error("image full");
+	}
+}
+} // namespace
+
+HarnessSong makeStemExportSong(int32_t numTracks, uint32_t numSamples) {
+	constexpr OscType kOscTypes[] = {OscType::SAW, OscType::SQUARE, OscType::TRIANGLE, OscType::SINE};
+	constexpr FilterMode kFilterModes[] = {FilterMode::TRANSISTOR_24DB, FilterMode::TRANSISTOR_12DB,
+	                                       FilterMode::SVF_BAND, FilterMode::TRANSISTOR_24DB_DRIVE,
+	                                       FilterMode::SVF_NOTCH};
+
+	HarnessSong song{"SONG001", {}, numSamples};
+	for (int32_t t = 0; t < numTracks; t++) {
+		HarnessTrack& track = song.tracks.emplace_back();
+		char name[16];
+		snprintf(name, sizeof(name), "SYNT%03d", t);
+		track.name = name;
+
+		track.setup.oscType = kOscTypes[t % 4];
+		track.setup.numUnison = 1 + t % 3;
+		track.setup.lpfMode = kFilterModes[t % 5];
+		track.setup.lpfFrequency = (1 << 22) + (t % 7) * (1 << 21);
+		track.setup.reverbOn = t % 2;
+
+		uint32_t chordLength = kSampleRate / 4 + (t % 5) * (kSampleRate / 8);
+		track.script = makeChordScript(1 + t % 4, chordLength, numSamples);
+		for (NoteEvent& event : track.script) {
+			event.note += t % 12;
+		}
+	}
+	return song;
+}
+
+std::string stemPath(HarnessSong const& song, char const* folder, int32_t t) {
+	char fileName[64];
+	snprintf(fileName, sizeof(fileName), "/SYNTH_TRACK_%s_%03d.WAV", song.tracks[t].name.c_str(), t);
+	return std::string(folder) + fileName;
+}
+
+StemExportStats exportStems(HarnessSong const& song, char const* folder, int32_t numThreads) {
+	StemExportStats stats;
+	stats.numThreads = std::max(numThreads, 1);
+	stats.numStems = song.tracks.size();
+	stats.numSamples = (uint64_t)song.numSamples * stats.numStems;
+	makeFolders(folder);
+
+	std::atomic<int32_t> nextTrack{0};
+	std::mutex fileSystemMutex;
+	std::exception_ptr error;
+
+	auto exportEach = [&] {
+		std::vector<StereoSample> audio(song.numSamples);
+		std::vector<uint8_t> wav;
+		try {
+			for (int32_t t; (t = nextTrack++) < stats.numStems;) {
+				HarnessTrack const& track = song.tracks[t];
+				auto renderer = std::make_unique<OfflineRenderer>(track.setup);
+				jcong = kNoiseSeed;
+				renderer->render(track.script, song.numSamples, audio);
+				encodeWAV(audio, wav);
+
+				std::lock_guard lock(fileSystemMutex);
+				writeFile(stemPath(song, folder, t), wav);
+				stats.numBytesWritten += wav.size();
+			}
+		} catch (...) {
+			std::lock_guard lock(fileSystemMutex);
+			error = std::current_exception();
+			nextTrack = stats.numStems; // Leave the rest
+		}
+	};
+
+	auto start = Clock::now();
+	if (stats.numThreads == 1) {
+		exportEach();
+	}
+	else {
+		std::vector<std::thread> threads;
+		for (int32_t i = 0; i < stats.numThreads; i++) {
+			threads.emplace_back(exportEach);
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+	}
+	stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+	return stats;
+}
+
+} // namespace deluge::bench
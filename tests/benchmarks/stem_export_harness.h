@@ -0,0 +1,76 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "render_harness.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace deluge::bench {
+
+/// One Output of a song as the harness plays it: the patch its voices render with, and its notes
+struct HarnessTrack {
+	std::string name;
+	VoiceSetup setup;
+	std::vector<NoteEvent> script;
+};
+
+/// A whole song for exporting the stems of, read by every stem and changed by none
+struct HarnessSong {
+	std::string name;
+	std::vector<HarnessTrack> tracks;
+	/// How long each stem renders for, in samples
+	uint32_t numSamples;
+};
+
+/// numTracks tracks of chords, each with its own oscillator, filter and voicing so no two stems come out the same
+HarnessSong makeStemExportSong(int32_t numTracks, uint32_t numSamples);
+
+struct StemExportStats {
+	int32_t numThreads = 0;
+	int32_t numStems = 0;
+	/// Audio rendered across all the stems
+	uint64_t numSamples = 0;
+	uint64_t numBytesWritten = 0;
+	double seconds = 0;
+
+	/// How many times faster than playing the stems through one after another in real time this was
+	[[nodiscard]] double timesRealTime() const { return seconds ? numSamples / (double)kSampleRate / seconds : 0; }
+};
+
+/**
+ * A benchmark of the harness, not a feature: this doesn't run or change the firmware's StemExport, which still renders
+ * its stems one at a time through the real Song and AudioEngine. It's how fast the harness's own model of a song
+ * exports when its stems are spread over threads, and that doing so gives the same files.
+ *
+ * Exports a stem per track of the song, as StemExport::exportInstrumentStems() does: the track alone, the others
+ * muted, written to folder as a 24-bit stereo WAV the way SampleRecorder writes them, named as
+ * StemExport::setWavFileNameForStemExport() names them. The FatImage they go on must be mounted.
+ *
+ * Each stem gets an OfflineRenderer of its own, set up from the song, so nothing one stem's render changes is seen by
+ * another. With more than one thread, each takes whichever stem's next and renders it at the same time as the others,
+ * as fast as it goes. FatFs isn't built reentrant, so the WAVs are written one at a time. Whatever the number of
+ * threads, the files come out the same.
+ */
+StemExportStats exportStems(HarnessSong const& song, char const* folder, int32_t numThreads);
+
+/// Where exportStems() puts the stem of track t
+std::string stemPath(HarnessSong const& song, char const* folder, int32_t t);
+
+} // namespace deluge::bench
@@ -0,0 +1,123 @@
+#include "CppUTest/TestHarness.h"
+#include "io/midi/usb_midi_send_queue.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// A message as setupUSBMessage() packs it, on virtual cable 0
+uint32_t usbMessage(uint8_t statusType, uint8_t channel, uint8_t data1, uint8_t data2) {
+	uint8_t statusByte = (statusType << 4) | channel;
+	uint8_t cin = (statusByte == 0xF2) ? 0x03 : statusType;
+	return ((uint32_t)data2 << 24) | ((uint32_t)data1 << 16) | ((uint32_t)statusByte << 8) | cin;
+}
+
+uint32_t cc(uint8_t channel, uint8_t controller, uint8_t value) {
+	return usbMessage(0x0B, channel, controller, value);
+}
+
+uint32_t noteOn(uint8_t channel, uint8_t note) {
+	return usbMessage(0x09, channel, note, 100);
+}
+
+constexpr uint32_t kClock = 0xF80F;
+
+struct TimedMessage {
+	int32_t timeUs;
+	uint32_t message;
+};
+
+/*
+ * A second of what goes out to a USB device during a busy stretch: MIDI follow feedback from 16 params being swept
+ * at once, each reporting its value every 250us, for 300ms; the controller's own CC echo throughout; a note every
+ * 50ms; and MIDI clock at 120bpm.
+ */
+std::vector<TimedMessage> makeBurst() {
+	std::vector<TimedMessage> messages;
+	for (int32_t t = 0; t < 1000000; t += 250) {
+		if (t >= 100000 && t < 400000) {
+			for (uint8_t p = 0; p < 16; p++) {
+				messages.push_back({t, cc(15, 20 + p, (uint8_t)((t / 250 + p * 8) & 127))});
+			}
+		}
+		if (t % 2000 == 0) {
+			messages.push_back({t, cc(0, 74, (uint8_t)((t / 2000) & 127))});
+		}
+		if (t % 50000 == 0) {
+			messages.push_back({t, noteOn(1, (uint8_t)(36 + (t / 50000) % 24))});
+		}
+		if (t % 20750 == 0) {
+			messages.push_back({t, kClock});
+		}
+	}
+	return messages;
+}
+
+/// What ConnectedUSBMIDIDevice kept before: one ring, first in first out, dropping whatever doesn't fit
+struct PlainRing {
+	uint32_t ring[MIDI_SEND_BUFFER_LEN_RING];
+	uint32_t writeIdx = 0;
+	uint32_t readIdx = 0;
+	int32_t numDropped = 0;
+
+	void push(uint32_t message) {
+		if (writeIdx - readIdx >= MIDI_SEND_BUFFER_LEN_RING) {
+			numDropped++;
+			return;
+		}
+		ring[writeIdx++ & MIDI_SEND_RING_MASK] = message;
+	}
+	int32_t pop(uint8_t* data, int32_t maxNumMessages) {
+		int32_t n = std::min<uint32_t>(writeIdx - readIdx, maxNumMessages);
+		for (int32_t i = 0; i < n; i++) {
+			memcpy(data + i * 4, &ring[readIdx++ & MIDI_SEND_RING_MASK], 4);
+		}
+		return n;
+	}
+};
+
+} // namespace
+
+TEST_GROUP(USBMIDISendQueueBenchmarks){};
+
+// The cost of a push, with the queue emptied a transfer at a time often enough that it never fills up, for a second
+// with a burst of MIDI follow feedback in it: into what ConnectedUSBMIDIDevice used to queue messages in, and into
+// USBMIDISendQueue, which looks for a CC to coalesce with
+TEST(USBMIDISendQueueBenchmarks, pushCost) {
+	std::vector<TimedMessage> messages = makeBurst();
+	constexpr int32_t kNumTimed = 1 << 20;
+
+	auto time = [&](auto&& push, auto&& pop) {
+		uint32_t data[MIDI_SEND_BUFFER_LEN_INNER];
+		auto start = Clock::now();
+		for (int32_t i = 0; i < kNumTimed; i++) {
+			push(messages[i % messages.size()].message);
+			if ((i & 31) == 31) {
+				pop((uint8_t*)data, MIDI_SEND_BUFFER_LEN_INNER);
+			}
+		}
+		return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / kNumTimed;
+	};
+
+	PlainRing* plain = new PlainRing;
+	double plainNs = time([&](uint32_t message) { plain->push(message); },
+	                      [&](uint8_t* data, int32_t max) { return plain->pop(data, max); });
+	CHECK_EQUAL(0, plain->numDropped);
+	delete plain;
+
+	USBMIDISendQueue* queue = new USBMIDISendQueue;
+	queue->clear();
+	double queueNs = time([&](uint32_t message) { queue->push(message); },
+	                      [&](uint8_t* data, int32_t max) { return queue->pop(data, max); });
+	CHECK_EQUAL(0, queue->numDropped);
+	delete queue;
+
+	printf("\n%zu messages in a second, pushed %d times round\n", messages.size(), kNumTimed);
+	printf("%12s %.1f ns per push\n", "plain ring", plainNs);
+	printf("%12s %.1f ns per push\n", "send queue", queueNs);
+}
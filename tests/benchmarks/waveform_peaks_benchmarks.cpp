@@ -0,0 +1,311 @@
+#include "CppUTest/TestHarness.h"
+#include "fat_image.h"
+#include "model/sample/waveform_peaks.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace deluge::bench;
+
+namespace {
+
+using Peak = WaveformPeaks::Peak;
+using Clock = std::chrono::steady_clock;
+
+constexpr int32_t kClusterSizeMagnitude = 15; // 32kB
+constexpr int32_t kClusterSize = 1 << kClusterSizeMagnitude;
+// What WaveformRenderer::findPeaksPerCol() reads at most of one Cluster, without the peaks
+constexpr int32_t kSamplesToReadPerColMagnitude = 9;
+
+// An hour recorded the way SampleRecorder does it: stereo, 24-bit, after a 44 byte header
+constexpr int32_t kNumChannels = 2;
+constexpr int32_t kByteDepth = 3;
+constexpr uint32_t kAudioDataStartPosBytes = 44;
+constexpr uint64_t kLengthInSamples = 3600ull * 44100;
+constexpr uint64_t kAudioDataLengthBytes = kLengthInSamples * kNumChannels * kByteDepth;
+constexpr int32_t kNumClusters = ((kAudioDataStartPosBytes + kAudioDataLengthBytes - 1) >> kClusterSizeMagnitude) + 1;
+
+struct Random {
+	uint32_t state;
+	uint32_t next() {
+		state = state * 1664525u + 1013904223u;
+		return state;
+	}
+};
+
+/// Cluster c of the hour: noise, swelling and fading so that each Cluster's peak differs
+void fillCluster(int32_t c, char* data) {
+	Random random{(uint32_t)c * 2654435761u};
+	int32_t amplitude = 1 + (int32_t)((c * 7919u) % 1024) * 8191;
+	for (int32_t i = 0; i + 4 <= kClusterSize; i += 4) {
+		int32_t value = (int32_t)(random.next() % (2 * amplitude + 1)) - amplitude;
+		memcpy(&data[i], &value, sizeof(value));
+	}
+}
+
+/// Straight through the values of a Cluster, as a check on WaveformPeaks::findPeak()
+Peak findPeakSlowly(char const* data, int32_t startByte, int32_t endByte, int32_t byteDepth) {
+	Peak peak{};
+	for (int32_t pos = startByte; pos + byteDepth <= endByte; pos += byteDepth) {
+		int32_t value = 0;
+		for (int32_t b = 0; b < byteDepth; b++) {
+			value |= (uint8_t)data[pos + b] << (8 * (4 - byteDepth + b));
+		}
+		int16_t top = value >> 16;
+		peak.min = std::min(peak.min, top);
+		peak.max = std::max(peak.max, top);
+	}
+	return peak.isKnown() ? peak : Peak{0, 0};
+}
+
+/// What Sample::findPeaksInCluster() does, with the hour's layout
+Peak findClusterPeak(int32_t c, char const* data) {
+	uint64_t clusterStartPos = (uint64_t)c << kClusterSizeMagnitude;
+	uint64_t startPos = std::max<uint64_t>(clusterStartPos, kAudioDataStartPosBytes);
+	uint64_t endPos =
+	    std::min<uint64_t>(clusterStartPos + kClusterSize, kAudioDataStartPosBytes + kAudioDataLengthBytes);
+	int32_t misalignment = (startPos - kAudioDataStartPosBytes) % kByteDepth;
+	if (misalignment) {
+		startPos += kByteDepth - misalignment;
+	}
+	return WaveformPeaks::findPeak(data, startPos - clusterStartPos, endPos - clusterStartPos, kByteDepth);
+}
+
+struct ColumnRange {
+	int32_t startCluster;
+	int32_t endCluster;
+	int32_t firstWholeCluster;
+};
+
+/// Which Clusters a column takes in, worked out as findPeaksPerCol() does
+ColumnRange getColumnRange(uint64_t xScroll, uint64_t xZoom, int32_t col) {
+	uint64_t colStartSample = xScroll + col * xZoom;
+	uint64_t colEndSample = std::min(colStartSample + xZoom, kLengthInSamples);
+	int32_t startCluster =
+	    (colStartSample * kNumChannels * kByteDepth + kAudioDataStartPosBytes) >> kClusterSizeMagnitude;
+	int32_t endCluster = (colEndSample * kNumChannels * kByteDepth + kAudioDataStartPosBytes) >> kClusterSizeMagnitude;
+	return {startCluster, endCluster, colStartSample == 0 ? startCluster : startCluster + 1};
+}
+
+} // namespace
+
+TEST_GROUP(WaveformPeaks){};
+
+// Values of each byte depth, as Cluster::convertDataIfNecessary() leaves them, packed end to end
+TEST(WaveformPeaks, findPeakReadsEachByteDepth) {
+	std::vector<char> data(4096);
+	Random random{12345};
+	for (char& byte : data) {
+		byte = (char)random.next();
+	}
+	for (int32_t byteDepth = 1; byteDepth <= 4; byteDepth++) {
+		for (int32_t startByte : {0, byteDepth, 5 * byteDepth}) {
+			for (int32_t endByte : {4096 - 4096 % byteDepth, 1000 * byteDepth + 1, startByte + byteDepth}) {
+				Peak expected = findPeakSlowly(data.data(), startByte, endByte, byteDepth);
+				Peak actual = WaveformPeaks::findPeak(data.data(), startByte, endByte, byteDepth);
+				CHECK_EQUAL(expected.min, actual.min);
+				CHECK_EQUAL(expected.max, actual.max);
+			}
+		}
+	}
+
+	// Nothing whole in there
+	Peak peak = WaveformPeaks::findPeak(data.data(), 10, 12, 3);
+	CHECK_EQUAL(0, peak.min);
+	CHECK_EQUAL(0, peak.max);
+}
+
+// Peaks filled in out of order, as Clusters get loaded, give the same as going through every Cluster in the range -
+// and nothing at all while any of them isn't known yet
+TEST(WaveformPeaks, rangesMatchBruteForceAsPeaksFillIn) {
+	constexpr int32_t numClusters = 1000;
+	WaveformPeaks peaks;
+	CHECK(peaks.setNumClusters(numClusters) == Error::NONE);
+
+	Random random{777};
+	std::vector<Peak> clusterPeaks(numClusters);
+	std::vector<int32_t> order(numClusters);
+	for (int32_t c = 0; c < numClusters; c++) {
+		int16_t a = random.next();
+		int16_t b = random.next();
+		clusterPeaks[c] = {std::min(a, b), std::max(a, b)};
+		order[c] = c;
+	}
+	for (int32_t i = numClusters - 1; i > 0; i--) {
+		std::swap(order[i], order[random.next() % (i + 1)]);
+	}
+
+	std::vector<bool> known(numClusters);
+	for (int32_t i = 0; i < numClusters; i++) {
+		peaks.setClusterPeak(order[i], clusterPeaks[order[i]]);
+		known[order[i]] = true;
+
+		if (i % 97 && i != numClusters - 1) {
+			continue;
+		}
+		for (int32_t q = 0; q < 200; q++) {
+			int32_t start = random.next() % numClusters;
+			int32_t end = start + 1 + random.next() % (numClusters - start);
+			Peak expected{};
+			bool allKnown = true;
+			for (int32_t c = start; c < end; c++) {
+				expected.add(clusterPeaks[c]);
+				allKnown = allKnown && known[c];
+			}
+			Peak actual = peaks.getPeak(start, end);
+			CHECK_EQUAL(allKnown, actual.isKnown());
+			if (allKnown) {
+				CHECK_EQUAL(expected.min, actual.min);
+				CHECK_EQUAL(expected.max, actual.max);
+			}
+		}
+	}
+	CHECK(peaks.isComplete());
+	CHECK_EQUAL(numClusters, peaks.findUnknown(0));
+
+	peaks.clear();
+	CHECK(!peaks.getPeak(0, 1).isKnown());
+	CHECK_EQUAL(0, peaks.findUnknown(0));
+}
+
+// Growing a Cluster at a time while recording keeps what's known, and a range reaching past the end isn't
+TEST(WaveformPeaks, growsWhileRecording) {
+	WaveformPeaks peaks;
+	CHECK(peaks.setNumClusters(1) == Error::NONE);
+	Peak total{};
+	for (int32_t c = 0; c < 300; c++) {
+		if (c >= peaks.getNumClusters()) {
+			CHECK(peaks.setNumClusters(c + 1) == Error::NONE);
+		}
+		Peak peak{(int16_t)(-c), (int16_t)(c / 2)};
+		peaks.setClusterPeak(c, peak);
+		total.add(peak);
+
+		Peak all = peaks.getPeak(0, c + 1);
+		CHECK_EQUAL(total.min, all.min);
+		CHECK_EQUAL(total.max, all.max);
+		CHECK(!peaks.getPeak(0, c + 2).isKnown());
+	}
+
+	// Shrinking, as when a recording's tail is cut off, forgets the rest
+	CHECK(peaks.setNumClusters(100) == Error::NONE);
+	CHECK(peaks.isComplete());
+	CHECK_EQUAL(-99, peaks.getPeak(0, 100).min);
+	CHECK(peaks.setNumClusters(200) == Error::NONE);
+	CHECK(!peaks.isComplete());
+	CHECK_EQUAL(100, peaks.findUnknown(0));
+}
+
+// Saved next to the audio and loaded back, but only for the same audio
+TEST(WaveformPeaks, fileRoundTrip) {
+	FatImage image(8192, 8);
+	constexpr int32_t numClusters = 5000;
+	WaveformPeaks::Source source{.fileSize = 123456789, .fileTimestamp = 0x5A214C03, .clusterSizeMagnitude = 15};
+
+	WaveformPeaks saved;
+	CHECK(saved.setNumClusters(numClusters) == Error::NONE);
+	CHECK(saved.save("REC.WAV.peaks", source) == Error::BUG); // Not till they're all known
+	for (int32_t c = 0; c < numClusters; c++) {
+		saved.setClusterPeak(c, {(int16_t)(-c), (int16_t)(c * 3)});
+	}
+	CHECK(saved.save("REC.WAV.peaks", source) == Error::NONE);
+	CHECK(saved.fileUpToDate);
+
+	WaveformPeaks loaded;
+	CHECK(loaded.setNumClusters(numClusters) == Error::NONE);
+	WaveformPeaks::Source changed = source;
+	changed.fileTimestamp++;
+	CHECK(loaded.load("REC.WAV.peaks", changed) == Error::FILE_UNSUPPORTED);
+	CHECK(!loaded.getPeak(0, 1).isKnown());
+
+	CHECK(loaded.load("REC.WAV.peaks", source) == Error::NONE);
+	CHECK(loaded.isComplete());
+	for (int32_t start : {0, 17, 2500}) {
+		Peak expected = saved.getPeak(start, numClusters);
+		Peak actual = loaded.getPeak(start, numClusters);
+		CHECK_EQUAL(expected.min, actual.min);
+		CHECK_EQUAL(expected.max, actual.max);
+	}
+
+	WaveformPeaks shorter;
+	CHECK(shorter.setNumClusters(numClusters - 1) == Error::NONE);
+	CHECK(shorter.load("REC.WAV.peaks", source) == Error::FILE_UNSUPPORTED);
+	CHECK(shorter.load("OTHER.WAV.peaks", source) != Error::NONE);
+}
+
+// Drawing a screen of an hour-long recording, at zooms from a few seconds across to the whole hour. Without the peaks,
+// each col loads a Cluster from the card - the renderer's existing shortcut - and reads a few hundred values of it.
+// With them, a col is a couple of Peaks per level and nothing is read, and it's the whole of each col that's covered
+TEST(WaveformPeaks, renderHourLongRecording) {
+	WaveformPeaks peaks;
+	CHECK(peaks.setNumClusters(kNumClusters) == Error::NONE);
+
+	// Built as it's recorded, a Cluster at a time
+	std::vector<char> cluster(kClusterSize);
+	double buildSeconds = 0;
+	for (int32_t c = 0; c < kNumClusters; c++) {
+		fillCluster(c, cluster.data());
+		Clock::time_point start = Clock::now();
+		peaks.setClusterPeak(c, findClusterPeak(c, cluster.data()));
+		buildSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+	}
+	CHECK(peaks.isComplete());
+	printf("\nhour-long recording: %d Clusters, peaks found in %.0f us per Cluster as it's written\n", kNumClusters,
+	       buildSeconds * 1e6 / kNumClusters);
+
+	CardTiming timing;
+	double secondsPerClusterLoad = timing.secondsPerCommand + (kClusterSize / 512) * timing.secondsPerSector;
+	printf("%12s %14s %14s %16s %14s\n", "s per col", "peaks us", "clusters read", "values read", "card ms");
+
+	constexpr int32_t kNumScrolls = 32;
+	for (uint64_t xZoom = kLengthInSamples / kDisplayWidth; xZoom >= 44100; xZoom >>= 1) {
+		uint64_t maxScroll = kLengthInSamples - xZoom * kDisplayWidth;
+
+		// With the peaks
+		int32_t numColsFromPeaks = 0;
+		Clock::time_point start = Clock::now();
+		volatile int32_t sink = 0;
+		for (int32_t s = 0; s < kNumScrolls; s++) {
+			uint64_t xScroll = maxScroll * s / kNumScrolls;
+			for (int32_t col = 0; col < kDisplayWidth; col++) {
+				ColumnRange range = getColumnRange(xScroll, xZoom, col);
+				if (range.endCluster > range.firstWholeCluster) {
+					Peak peak = peaks.getPeak(range.firstWholeCluster, range.endCluster);
+					CHECK(peak.isKnown());
+					sink = sink + peak.max - peak.min;
+					numColsFromPeaks++;
+				}
+			}
+		}
+		double peaksSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		// Without: one Cluster per col, read a few hundred values of
+		int64_t numClustersRead = 0;
+		int64_t numValuesRead = 0;
+		for (int32_t s = 0; s < kNumScrolls; s++) {
+			uint64_t xScroll = maxScroll * s / kNumScrolls;
+			for (int32_t col = 0; col < kDisplayWidth; col++) {
+				ColumnRange range = getColumnRange(xScroll, xZoom, col);
+				int32_t c = range.endCluster > range.startCluster + 1 ? range.startCluster + 1 : range.startCluster;
+				int32_t numValues = kClusterSize / kByteDepth;
+				int32_t timesTooMany = ((numValues - 1) >> kSamplesToReadPerColMagnitude) + 1;
+				numValuesRead += numValues / timesTooMany;
+				numClustersRead++;
+
+				// Whatever that saw, the peaks take in
+				if (range.endCluster > range.firstWholeCluster && c < kNumClusters) {
+					fillCluster(c, cluster.data());
+					Peak seen = findClusterPeak(c, cluster.data());
+					Peak peak = peaks.getPeak(range.firstWholeCluster, range.endCluster);
+					CHECK(peak.min <= seen.min && peak.max >= seen.max);
+				}
+			}
+		}
+
+		CHECK_EQUAL(kNumScrolls * kDisplayWidth, numColsFromPeaks);
+		printf("%12.1f %14.2f %14.1f %16.0f %14.1f\n", (double)xZoom / 44100, peaksSeconds * 1e6 / kNumScrolls,
+		       (double)numClustersRead / kNumScrolls, (double)numValuesRead / kNumScrolls,
+		       numClustersRead * secondsPerClusterLoad * 1e3 / kNumScrolls);
+	}
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "card_access.h"
+#include "CppUTest/TestHarness.h"
+#include "storage/audio/audio_file_manager.h"
+#include "storage/cluster/cluster_read_batch.h"
+#include <array>
+#include <vector>
+
+namespace deluge::bench {
+
+SongCard::SongCard(uint32_t numClusters, uint32_t sectorsPerCluster) {
+	image = std::make_unique<FatImage>(numClusters, sectorsPerCluster);
+	f_mount(&fileSystemStuff.fileSystem, "", 1);
+	audioFileManager.clusterSize = image->clusterSize();
+	audioFileManager.clusterSizeMagnitude = 31 - __builtin_clz(audioFileManager.clusterSize);
+}
+
+bool isReadCharWise(char const* name) {
+	return !strcmp(name, "noteDataWithLift") || !strcmp(name, "noteData") || !strcmp(name, "clipInstances")
+	       || !strcmp(name, "preview");
+}
+
+FilePointer filePointerFor(char const* path) {
+	FilePointer filePointer{};
+	FIL file;
+	CHECK_EQUAL(FR_OK, f_open(&file, path, FA_READ));
+	filePointer.sclust = file.obj.sclust;
+	filePointer.objsize = file.obj.objsize;
+	f_close(&file);
+	return filePointer;
+}
+
+BinaryFileSource sourceOf(char const* path) {
+	BinaryFileSource source{};
+	Error error = getBinaryFileSource(path, &source);
+	CHECK(error == Error::NONE || error == Error::FILE_UNSUPPORTED);
+	return source;
+}
+
+std::string twinPathOf(std::string const& path) {
+	return path.substr(0, path.rfind('.')) + ".DLB";
+}
+
+uint64_t fileSize(std::string const& path) {
+	FILINFO info;
+	return f_stat(path.c_str(), &info) == FR_OK ? info.fsize : 0;
+}
+
+Error writeTwin(StorageManager& storage, std::string const& xmlPath, XMLDeserializer& reader,
+                BinarySerializer& writer) {
+	std::string twinPath = twinPathOf(xmlPath);
+	FilePointer filePointer = filePointerFor(xmlPath.c_str());
+	Error error = writer.createFile(twinPath.c_str(), sourceOf(xmlPath.c_str()));
+	if (error != Error::NONE) {
+		return error;
+	}
+	reader.msd = &storage;
+	reader.startReadingFile(&filePointer);
+	error = convertXMLToBinary(reader, writer);
+	f_close(&fileSystemStuff.currentFile);
+	if (error == Error::NONE) {
+		error = writer.closeFileAfterWriting(twinPath.c_str());
+	}
+	if (error != Error::NONE) {
+		writer.abandonFile(twinPath.c_str());
+	}
+	return error;
+}
+
+Walk walkXML(StorageManager& storage, XMLDeserializer& reader, std::string const& path,
+             void (*walker)(XMLDeserializer&, Walk&)) {
+	Walk walk;
+	FilePointer filePointer = filePointerFor(path.c_str());
+	reader.msd = &storage;
+	CHECK(reader.openXMLFile(&filePointer, "song") == Error::NONE);
+	walker(reader, walk);
+	f_close(&fileSystemStuff.currentFile);
+	return walk;
+}
+
+Walk walkBinary(StorageManager& storage, BinaryDeserializer& reader, std::string const& xmlPath,
+                void (*walker)(BinaryDeserializer&, Walk&)) {
+	Walk walk;
+	std::string twinPath = twinPathOf(xmlPath);
+	FilePointer filePointer = filePointerFor(twinPath.c_str());
+	BinaryFileSource source = sourceOf(xmlPath.c_str());
+	reader.msd = &storage;
+	CHECK(reader.openBinaryFile(&filePointer, "song", "", false, &source) == Error::NONE);
+	walker(reader, walk);
+	f_close(&fileSystemStuff.currentFile);
+	return walk;
+}
+
+uint64_t streamSample(FatImage& image, const std::string& path,
+                      const std::function<void(int32_t, const uint8_t*)>& onCluster) {
+	std::vector<uint32_t> sdAddresses = image.clusterSectors(path);
+	int32_t numClusters = sdAddresses.size();
+	uint32_t sectorsPerCluster = image.clusterSize() / 512;
+
+	std::vector<uint8_t> buffer(kMaxClustersPerRead * image.clusterSize());
+	std::array<uint8_t*, kMaxClustersPerRead> buffs;
+	for (int32_t c = 0; c < kMaxClustersPerRead; c++) {
+		buffs[c] = &buffer[c * image.clusterSize()];
+	}
+
+	int32_t next = 0;
+	while (next < numClusters) {
+		ClusterReadBatch batch = growClusterReadBatch(
+		    next, numClusters, sectorsPerCluster, [&](int32_t i) { return sdAddresses[i]; },
+		    [&](int32_t i) { return i > next; });
+		bool ok = (batch.numClusters == 1)
+		              ? image.read(buffs[0], sdAddresses[next], sectorsPerCluster)
+		              : image.readScattered(buffs.data(), sectorsPerCluster, sdAddresses[next],
+		                                    batch.numClusters * sectorsPerCluster);
+		if (!ok) {
+			break;
+		}
+		if (onCluster) {
+			for (int32_t c = 0; c < batch.numClusters; c++) {
+				onCluster(next + c, buffs[c]);
+			}
+		}
+		next += batch.numClusters;
+	}
+	return (uint64_t)next * image.clusterSize();
+}
+
+} // namespace deluge::bench
@@ -0,0 +1,118 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "fat_image.h"
+#include "storage/binary_serializer.h"
+#include "storage/storage_manager.h"
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Songs and samples read off a FatImage the way the firmware reads them, for the storage tests and benchmarks
+
+namespace deluge::bench {
+
+/// The image the songs go on, mounted on the FATFS the firmware's file access goes through
+struct SongCard {
+	SongCard(uint32_t numClusters, uint32_t sectorsPerCluster);
+
+	std::unique_ptr<FatImage> image;
+};
+
+/// What a walk through a file saw, to check two formats of it read back the same
+struct Walk {
+	uint64_t hash = 14695981039346656037ull;
+	int32_t numNames = 0;
+	int32_t numValueChars = 0;
+
+	void add(char const* chars, int32_t numChars) {
+		for (int32_t i = 0; i < numChars; i++) {
+			hash = (hash ^ (uint8_t)chars[i]) * 1099511628211ull;
+		}
+		hash = (hash ^ 0xFF) * 1099511628211ull;
+	}
+	void addNumber(int32_t number) { add((char const*)&number, sizeof(number)); }
+	void addTrimmed(char const* value) {
+		while (*value == ' ' || *value == '\t' || *value == '\r' || *value == '\n') {
+			value++;
+		}
+		// Past this, what readTagOrAttributeValue() gives back depends on where the value fell in the Cluster
+		int32_t length = strnlen(value, kFilenameBufferSize - 1);
+		add(value, length);
+		numValueChars += length;
+	}
+};
+
+/// The values the model reads a char at a time rather than whole
+bool isReadCharWise(char const* name);
+
+/// Reads every name and value under the current element, the way the model reads a song: whole values with
+/// readTagOrAttributeValue(), the long hex ones a few chars at a time
+template <typename Reader>
+void walkElement(Reader& reader, Walk& walk) {
+	char const* name;
+	while (*(name = reader.readNextTagOrAttributeName())) {
+		walk.add(name, strlen(name));
+		walk.numNames++;
+		if (!reader.isAtAttributeValue()) {
+			// Content, or whitespace before the children, which isn't kept in the binary
+			walk.addTrimmed(reader.readTagOrAttributeValue());
+			walkElement(reader, walk);
+		}
+		else if (isReadCharWise(name) && reader.prepareToReadTagOrAttributeValueOneCharAtATime()) {
+			// The model sizes its note array from this, but only as a hint - each format knows a different amount
+			reader.getNumCharsRemainingInValue();
+			char const* chars;
+			while ((chars = reader.readNextCharsOfTagOrAttributeValue(22))) {
+				walk.add(chars, 22);
+				walk.numValueChars += 22;
+			}
+		}
+		else {
+			walk.addTrimmed(reader.readTagOrAttributeValue());
+		}
+		reader.exitTag(name);
+	}
+}
+
+FilePointer filePointerFor(char const* path);
+/// Songs off a real card may be from before saveToken, and get 0 for it
+BinaryFileSource sourceOf(char const* path);
+std::string twinPathOf(std::string const& path);
+uint64_t fileSize(std::string const& path);
+
+/// Makes the binary copy of an XML file, as StorageManager::writeBinaryTwin() does after a save
+Error writeTwin(StorageManager& storage, std::string const& xmlPath, XMLDeserializer& reader,
+                BinarySerializer& writer);
+
+/// Reads the song at path with walker, by default reading every value as text
+Walk walkXML(StorageManager& storage, XMLDeserializer& reader, std::string const& path,
+             void (*walker)(XMLDeserializer&, Walk&) = walkElement<XMLDeserializer>);
+/// Likewise for the binary twin of the song at xmlPath
+Walk walkBinary(StorageManager& storage, BinaryDeserializer& reader, std::string const& xmlPath,
+                void (*walker)(BinaryDeserializer&, Walk&) = walkElement<BinaryDeserializer>);
+
+/// Streams a file's Clusters straight off the card the way AudioFileManager loads them, contiguous ones together.
+/// Calls onCluster(index, data) for each
+uint64_t streamSample(FatImage& image, const std::string& path,
+                      const std::function<void(int32_t, const uint8_t*)>& onCluster = {});
+
+} // namespace deluge::bench
@@ -0,0 +1,208 @@
+#include "CppUTest/TestHarness.h"
+#include "storage/cluster/cluster_read_ahead.h"
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kClusterSize = 32768;
+constexpr uint32_t kBufferSize = 128;
+
+// Bytes per output sample, 16.16, for a file with this many bytes per frame played at this speed
+constexpr uint32_t rateFor(uint32_t bytesPerFrame, float speed) {
+	return (uint32_t)(bytesPerFrame * speed * 65536);
+}
+
+/// A card which loads one Cluster at a time, earliest deadline first. Most loads take about 1.5ms, but every so often
+/// it goes away for 50ms, like real cards do
+struct FakeCard {
+	struct Request {
+		int32_t head;
+		int32_t clusterIndex;
+		uint32_t timeEnqueued;
+	};
+
+	uint32_t loadTime(int32_t loadNumber) const { return (loadNumber % 23 == 22) ? 2200 : 64 + (loadNumber * 7) % 16; }
+
+	std::multimap<uint32_t, Request> queue;
+	bool busy = false;
+	Request loading;
+	uint32_t startedAt = 0;
+	uint32_t doneAt = 0;
+	int32_t numLoads = 0;
+};
+
+struct PlayHead {
+	uint32_t rate;
+	uint64_t bytePos = 0;
+	std::deque<int32_t> held; // Cluster indexes, from the one being played onwards
+	std::vector<bool> loaded;
+};
+
+struct SimResult {
+	int32_t underruns = 0;
+	int32_t mostClustersHeld = 0;
+};
+
+/// Plays `rates` through the card for `numSamples`, holding clusters a fixed number ahead, or as many as readAhead says
+/// if fixedClustersAhead is 0
+SimResult simulate(const std::vector<uint32_t>& rates, uint32_t numSamples, int32_t fixedClustersAhead) {
+	ClusterReadAhead readAhead;
+	readAhead.setClusterSize(kClusterSize);
+	FakeCard card;
+	SimResult result;
+
+	std::vector<PlayHead> heads;
+	for (uint32_t rate : rates) {
+		PlayHead head;
+		head.rate = rate;
+		heads.push_back(head);
+	}
+
+	auto topUp = [&](int32_t h, uint32_t now) {
+		PlayHead& head = heads[h];
+		int32_t wanted = fixedClustersAhead ? fixedClustersAhead : readAhead.numClustersAhead(head.rate);
+		int32_t next = head.held.empty() ? (int32_t)(head.bytePos / kClusterSize) : head.held.back() + 1;
+		while ((int32_t)head.held.size() < wanted) {
+			uint32_t deadline = readAhead.deadline(head.held.size(), head.rate, now);
+			card.queue.insert({deadline, {h, next, now}});
+			head.loaded.resize(std::max<size_t>(head.loaded.size(), next + 1));
+			head.held.push_back(next++);
+		}
+		result.mostClustersHeld = std::max(result.mostClustersHeld, (int32_t)head.held.size());
+	};
+
+	for (int32_t h = 0; h < (int32_t)heads.size(); h++) {
+		topUp(h, 0);
+	}
+
+	for (uint32_t now = 0; now < numSamples; now += kBufferSize) {
+		uint32_t bufferEnd = now + kBufferSize;
+
+		// Card works through its queue
+		uint32_t cardTime = now;
+		while (true) {
+			if (!card.busy) {
+				if (card.queue.empty()) {
+					break;
+				}
+				card.loading = card.queue.begin()->second;
+				card.queue.erase(card.queue.begin());
+				card.busy = true;
+				card.startedAt = std::max(cardTime, card.doneAt);
+				card.doneAt = card.startedAt + card.loadTime(card.numLoads++);
+			}
+			if (card.doneAt > bufferEnd) {
+				break;
+			}
+			heads[card.loading.head].loaded[card.loading.clusterIndex] = true;
+			readAhead.noteLoadTime(card.doneAt - card.startedAt);
+			cardTime = card.doneAt;
+			card.busy = false;
+		}
+
+		// Play-heads move on, stalling at the start of any Cluster that isn't there yet
+		for (int32_t h = 0; h < (int32_t)heads.size(); h++) {
+			PlayHead& head = heads[h];
+			if (!head.loaded[head.held.front()]) {
+				continue;
+			}
+			uint64_t newBytePos = head.bytePos + (((uint64_t)head.rate * kBufferSize) >> 16);
+			if (newBytePos / kClusterSize != head.bytePos / kClusterSize) {
+				head.held.pop_front();
+				topUp(h, now);
+				if (!head.loaded[head.held.front()]) {
+					result.underruns++;
+					newBytePos = (uint64_t)head.held.front() * kClusterSize;
+				}
+			}
+			head.bytePos = newBytePos;
+		}
+	}
+	return result;
+}
+
+} // namespace
+
+TEST_GROUP(ClusterReadAhead){};
+
+TEST(ClusterReadAhead, looksFurtherAheadWhenPlayingFaster) {
+	ClusterReadAhead readAhead;
+	readAhead.setClusterSize(kClusterSize);
+
+	CHECK_EQUAL(ClusterReadAhead::kMinClustersAhead, readAhead.numClustersAhead(0));
+	CHECK_EQUAL(ClusterReadAhead::kMinClustersAhead, readAhead.numClustersAhead(rateFor(4, 1)));
+	int32_t last = 0;
+	for (float speed = 0.25; speed <= 64; speed *= 2) {
+		int32_t numAhead = readAhead.numClustersAhead(rateFor(4, speed));
+		CHECK(numAhead >= last);
+		last = numAhead;
+	}
+	CHECK(last > ClusterReadAhead::kMinClustersAhead);
+	CHECK(last <= ClusterReadAhead::kMaxClustersAhead);
+}
+
+TEST(ClusterReadAhead, looksFurtherAheadWhenTheCardIsSlower) {
+	ClusterReadAhead readAhead;
+	readAhead.setClusterSize(kClusterSize);
+	for (int32_t i = 0; i < 100; i++) {
+		readAhead.noteLoadTime(64);
+	}
+	uint32_t rate = rateFor(6, 4);
+	int32_t fastCard = readAhead.numClustersAhead(rate);
+	CHECK(readAhead.latency() < 220);
+
+	// One stall is enough to look further ahead for a good while
+	readAhead.noteLoadTime(2200);
+	CHECK(readAhead.numClustersAhead(rate) > fastCard);
+	for (int32_t i = 0; i < 20; i++) {
+		readAhead.noteLoadTime(64);
+	}
+	CHECK(readAhead.numClustersAhead(rate) > fastCard);
+
+	// But not for ever
+	for (int32_t i = 0; i < 1000; i++) {
+		readAhead.noteLoadTime(64);
+	}
+	CHECK_EQUAL(fastCard, readAhead.numClustersAhead(rate));
+}
+
+TEST(ClusterReadAhead, deadlinesAreWhenThePlayHeadGetsThere) {
+	ClusterReadAhead readAhead;
+	readAhead.setClusterSize(kClusterSize);
+	uint32_t rate = rateFor(4, 1); // 8192 samples per Cluster
+
+	CHECK_EQUAL(1000u, readAhead.deadline(0, rate, 1000));
+	CHECK_EQUAL(1000u, readAhead.deadline(1, rate, 1000));
+	CHECK_EQUAL(1000u + 8192, readAhead.deadline(2, rate, 1000));
+	CHECK_EQUAL(1000u + 3 * 8192, readAhead.deadline(4, rate, 1000));
+	// Going nowhere is never urgent, but mustn't overflow
+	CHECK(readAhead.deadline(ClusterReadAhead::kMaxClustersAhead, 0, 1000) > readAhead.deadline(2, rate, 1000));
+}
+
+// A mix of voices at the speeds the firmware sees - 16-bit stereo at pitch, 24-bit stereo pitched up a couple of
+// octaves, and some time-stretched fast - against a card which stalls now and then. Two Clusters ahead, the way it
+// always was, is plenty for the slow ones but not the fast ones
+TEST(ClusterReadAhead, fewerUnderrunsThanAFixedWindow) {
+	std::vector<uint32_t> rates = {rateFor(4, 1), rateFor(4, 1), rateFor(2, 1), rateFor(6, 2), rateFor(6, 4),
+	                               rateFor(4, 6), rateFor(4, 1.5), rateFor(4, 4), rateFor(6, 4), rateFor(6, 1)};
+	uint32_t numSamples = 44100 * 120;
+
+	SimResult fixed = simulate(rates, numSamples, 2);
+	SimResult adaptive = simulate(rates, numSamples, 0);
+
+	CHECK(fixed.underruns > 0);
+	CHECK(adaptive.underruns * 100 < fixed.underruns);
+	CHECK(adaptive.mostClustersHeld <= ClusterReadAhead::kMaxClustersAhead);
+}
+
+// Slow voices mustn't tie up more Clusters than they ever did
+TEST(ClusterReadAhead, slowVoicesHoldNoMoreThanBefore) {
+	std::vector<uint32_t> rates(16, rateFor(4, 1));
+	SimResult adaptive = simulate(rates, 44100 * 30, 0);
+	CHECK_EQUAL(0, adaptive.underruns);
+	CHECK_EQUAL(ClusterReadAhead::kMinClustersAhead, adaptive.mostClustersHeld);
+}
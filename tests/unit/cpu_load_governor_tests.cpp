@@ -0,0 +1,205 @@
+#include "CppUTest/TestHarness.h"
+#include "processing/engines/cpu_load_governor.h"
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+// The same limits AudioEngine works to, in samples of time for a full window
+constexpr float kNumSamplesLimit = 80;
+
+constexpr int32_t kNumClasses = 4;
+// Four Sounds with quite different costs: a unison saw pad, an FM bell, a sampled kit and a wavetable lead
+constexpr std::array<uint32_t, kNumClasses> kKeys = {
+    CpuLoadGovernor::classKey(0, 4, 4, 0, 0, 4),
+    CpuLoadGovernor::classKey(1, 0, 0, 0, 0, 1),
+    CpuLoadGovernor::classKey(0, 7, 0, 3, 0, 1),
+    CpuLoadGovernor::classKey(0, 6, 6, 1, 2, 2),
+};
+constexpr std::array<float, kNumClasses> kTrueCosts = {3.0f, 1.2f, 0.6f, 2.2f};
+constexpr float kTrueOverhead = 2;
+constexpr float kTrueBase = 6;
+
+// A voice-count trace of a song that builds past what the CPU can render and drops back, captured once per window as
+// how many voices of each Sound were sounding. Each segment holds its counts for that many windows, give or take the
+// odd note starting or ending early.
+struct Segment {
+	int32_t numWindows;
+	std::array<int32_t, kNumClasses> numVoices;
+};
+constexpr Segment kTrace[] = {
+    {300, {0, 0, 4, 0}},   {300, {4, 0, 6, 0}},    {200, {8, 2, 6, 0}},    {400, {8, 4, 8, 2}},
+    {300, {12, 4, 8, 4}},  {200, {16, 6, 10, 4}},  {300, {20, 8, 12, 6}},  {200, {24, 8, 12, 6}},
+    {100, {4, 2, 6, 0}},   {300, {12, 6, 10, 6}},  {400, {24, 10, 14, 8}}, {200, {28, 12, 16, 8}},
+    {300, {16, 4, 8, 2}},  {200, {8, 0, 6, 0}},    {300, {20, 8, 10, 6}},  {300, {26, 10, 12, 8}},
+    {200, {0, 0, 4, 0}},   {300, {24, 12, 16, 10}}, {300, {10, 2, 6, 2}},  {200, {0, 0, 0, 0}},
+};
+
+class Simulation {
+public:
+	Simulation(bool predictive, uint32_t seed) : predictive_(predictive), random_(seed) {}
+
+	void run() {
+		for (const Segment& segment : kTrace) {
+			for (int32_t w = 0; w < segment.numWindows; w++) {
+				window(segment.numVoices);
+			}
+		}
+	}
+
+	CpuLoadGovernor governor;
+	int32_t numOverLimit = 0;
+	int32_t numCulled = 0;
+	int64_t voiceWindowsPlayed = 0;
+	double totalError = 0;
+	double totalActual = 0;
+	int32_t numWindows = 0;
+
+private:
+	struct Releasing {
+		int32_t voiceClass;
+		int32_t windowsLeft;
+	};
+
+	void window(const std::array<int32_t, kNumClasses>& requested) {
+		// Voices culled earlier stay culled until their notes would have ended anyway
+		std::array<int32_t, kNumClasses> playing{};
+		for (int32_t c = 0; c < kNumClasses; c++) {
+			int32_t wanted = std::max(requested[c] + (int32_t)(random_() % 3) - 1, 0);
+			culled_[c] = std::min(culled_[c], wanted);
+			playing[c] = wanted - culled_[c];
+		}
+		std::erase_if(releasing_, [](Releasing& voice) { return --voice.windowsLeft < 0; });
+
+		// This is AudioEngine's setDireness() reacting to the last window, in both simulations
+		if (lastActual_ >= kNumSamplesLimit) {
+			int32_t numToCull = 1 + ((lastActual_ - kNumSamplesLimit >= 20) ? (lastActual_ - kNumSamplesLimit) / 8 : 0);
+			for (int32_t i = 0; i < numToCull; i++) {
+				cull(playing);
+			}
+		}
+
+		governor.beginWindow();
+		std::array<int32_t, kNumClasses> numReleasing{};
+		for (const Releasing& voice : releasing_) {
+			numReleasing[voice.voiceClass]++;
+		}
+		for (int32_t c = 0; c < kNumClasses; c++) {
+			governor.countVoices(kKeys[c], playing[c] + numReleasing[c], numReleasing[c]);
+		}
+
+		// And this is governCpuLoad()
+		if (predictive_) {
+			while (governor.predictSettled() > kNumSamplesLimit - governor.headroom()) {
+				int32_t voiceClass = cull(playing);
+				if (voiceClass < 0) {
+					break;
+				}
+				governor.voiceShed(kKeys[voiceClass]);
+			}
+		}
+
+		// Render, with some noise, and now and then an interrupt landing in the middle of it
+		float actual = kTrueOverhead + kTrueBase;
+		for (int32_t c = 0; c < kNumClasses; c++) {
+			actual += (playing[c] + numReleasing[c]) * kTrueCosts[c];
+			voiceWindowsPlayed += playing[c];
+		}
+		actual *= std::uniform_real_distribution<float>(0.9f, 1.1f)(random_);
+		if (random_() % 50 == 0) {
+			actual += 8;
+		}
+
+		if (numWindows >= kWarmUpWindows) {
+			totalError += std::abs(governor.predict(CpuLoadGovernor::kFullWindow) - actual);
+			totalActual += actual;
+		}
+		governor.learn(CpuLoadGovernor::kFullWindow, actual);
+		numOverLimit += (actual >= kNumSamplesLimit);
+		lastActual_ = actual;
+		numWindows++;
+	}
+
+	// Like cullVoice(), takes one of the voices that's been playing longest, which is most likely to belong to whichever
+	// Sound has the most. Returns its class, or -1 if there's nothing to cull
+	int32_t cull(std::array<int32_t, kNumClasses>& playing) {
+		int32_t voiceClass = std::max_element(playing.begin(), playing.end()) - playing.begin();
+		if (!playing[voiceClass]) {
+			return -1;
+		}
+		playing[voiceClass]--;
+		culled_[voiceClass]++;
+		releasing_.push_back({voiceClass, 2});
+		numCulled++;
+		return voiceClass;
+	}
+
+	static constexpr int32_t kWarmUpWindows = 1000;
+
+	bool predictive_;
+	std::mt19937 random_;
+	std::array<int32_t, kNumClasses> culled_{};
+	std::vector<Releasing> releasing_;
+	float lastActual_ = 0;
+};
+
+} // namespace
+
+TEST_GROUP(CpuLoadGovernor){};
+
+TEST(CpuLoadGovernor, learnsClassCosts) {
+	Simulation simulation(false, 1);
+	simulation.run();
+	for (int32_t c = 0; c < kNumClasses; c++) {
+		DOUBLES_EQUAL(kTrueCosts[c], simulation.governor.voiceCost(kKeys[c]), kTrueCosts[c] * 0.25);
+	}
+}
+
+// Replays the trace with only the reactive culling, then with the governor culling ahead of it as well
+TEST(CpuLoadGovernor, replayedTraceStaysUnderLimit) {
+	Simulation reactive(false, 2);
+	Simulation predictive(true, 2);
+	reactive.run();
+	predictive.run();
+
+	double meanError = predictive.totalError / predictive.totalActual;
+	std::cout << "\n              windows over limit    voices culled    voice-windows played\n";
+	std::cout << "reactive      " << reactive.numOverLimit << "                   " << reactive.numCulled
+	          << "              " << reactive.voiceWindowsPlayed << "\n";
+	std::cout << "predictive    " << predictive.numOverLimit << "                    " << predictive.numCulled
+	          << "              " << predictive.voiceWindowsPlayed << "\n";
+	std::cout << "prediction error " << meanError * 100 << "% of render time\n";
+
+	// The governor should catch most of what the reactive culling only noticed after the fact - all but the interrupts,
+	// which nothing could see coming. Keeping its headroom costs some voices, but not many
+	CHECK(predictive.numOverLimit * 3 < reactive.numOverLimit);
+	CHECK(predictive.voiceWindowsPlayed * 100 > reactive.voiceWindowsPlayed * 90);
+	CHECK(meanError < 0.1);
+}
+
+TEST(CpuLoadGovernor, telemetry) {
+	CpuLoadGovernor governor;
+	governor.beginWindow();
+	governor.countVoices(kKeys[0], 4, 1);
+	float predicted = governor.predict(64);
+	DOUBLES_EQUAL(4 * CpuLoadGovernor::kDefaultVoiceCost / 2, predicted, 0.001);
+	DOUBLES_EQUAL(3 * CpuLoadGovernor::kDefaultVoiceCost, governor.predictSettled(), 0.001);
+
+	governor.voiceShed(kKeys[0]);
+	DOUBLES_EQUAL(2 * CpuLoadGovernor::kDefaultVoiceCost, governor.predictSettled(), 0.001);
+
+	governor.learn(64, 70);
+	const CpuLoadGovernor::Telemetry& telemetry = governor.telemetry();
+	DOUBLES_EQUAL(predicted, telemetry.lastPredicted, 0.001);
+	DOUBLES_EQUAL(70, telemetry.lastActual, 0.001);
+	CHECK_EQUAL(1, telemetry.numWindows);
+	CHECK_EQUAL(1, telemetry.numOverruns);
+	CHECK_EQUAL(1, telemetry.numVoicesShed);
+	CHECK(governor.predict(64) > predicted);
+
+	governor.resetTelemetry();
+	CHECK_EQUAL(0, governor.telemetry().numWindows);
+}
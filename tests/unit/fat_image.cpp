@@ -0,0 +1,331 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fat_image.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" {
+#include "fatfs/diskio.h"
+
+DWORD get_fat_from_fs(FATFS* fs, DWORD clst);
+LBA_t clst2sect(FATFS* fs, DWORD clst);
+
+int pendingGlobalMIDICommandNumClustersWritten = 0;
+uint8_t currentlyAccessingCard = 0;
+}
+
+namespace deluge::bench {
+
+namespace {
+
+FatImage* mountedImage = nullptr;
+
+constexpr uint32_t kSectorSize = 512;
+constexpr uint32_t kNumRootEntries = 512;
+
+// The most clusters FatFs will call FAT12 and FAT16
+constexpr uint32_t kMaxFat12Clusters = 4085;
+constexpr uint32_t kMaxFat16Clusters = 65524;
+
+void storeWord(uint8_t* at, uint16_t value) {
+	at[0] = value;
+	at[1] = value >> 8;
+}
+
+void storeDword(uint8_t* at, uint32_t value) {
+	storeWord(at, value);
+	storeWord(at + 2, value >> 16);
+}
+
+void check(FRESULT result, const char* what) {
+	if (result != FR_OK) {
+		throw std::runtime_error(std::string(what) + " failed with FatFs error " + std::to_string(result));
+	}
+}
+
+uint32_t numFatSectors(uint32_t numClusters) {
+	uint32_t numFatEntries = numClusters + 2;
+	uint32_t fatBytes = (numClusters <= kMaxFat12Clusters)   ? (numFatEntries * 3 + 1) / 2
+	                    : (numClusters <= kMaxFat16Clusters) ? numFatEntries * 2
+	                                                         : numFatEntries * 4;
+	return (fatBytes + kSectorSize - 1) / kSectorSize;
+}
+
+[[noreturn]] void fail(const char* what) {
+	throw std::runtime_error(std::string(what) + " failed: " + strerror(errno));
+}
+
+} // namespace
+
+FatImage::FatImage(uint32_t numClusters, uint32_t sectorsPerCluster, const char* path) {
+	int fd;
+	if (path) {
+		fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	}
+	else {
+		char tempPath[] = "/tmp/deluge-sd-XXXXXX";
+		fd = mkstemp(tempPath);
+		if (fd >= 0) {
+			unlink(tempPath);
+		}
+	}
+	if (fd < 0) {
+		fail("creating image");
+	}
+
+	// Only the FATs and what gets written take up any room, the rest is a hole
+	bool fat32 = numClusters > kMaxFat16Clusters;
+	uint32_t reservedSectors = fat32 ? 32 : 1;
+	uint32_t rootSectors = fat32 ? 0 : kNumRootEntries * 32 / kSectorSize;
+	uint64_t totalSectors =
+	    reservedSectors + numFatSectors(numClusters) + rootSectors + (uint64_t)numClusters * sectorsPerCluster;
+	if (ftruncate(fd, totalSectors * kSectorSize) != 0) {
+		fail("sizing image");
+	}
+
+	map(fd, true);
+	format(numClusters, sectorsPerCluster);
+	mount();
+}
+
+FatImage::FatImage(const char* path, bool writable) {
+	int fd = open(path, writable ? O_RDWR : O_RDONLY);
+	if (fd < 0) {
+		fail("opening image");
+	}
+	map(fd, writable);
+	mount();
+}
+
+FatImage::~FatImage() {
+	f_mount(nullptr, "", 0);
+	mountedImage = nullptr;
+	munmap(sectors_, size_);
+	close(fd_);
+}
+
+void FatImage::map(int fd, bool writable) {
+	fd_ = fd;
+	writable_ = writable;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		fail("sizing image");
+	}
+	size_ = info.st_size;
+
+	void* mapping = mmap(nullptr, size_, PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED, fd, 0);
+	if (mapping == MAP_FAILED) {
+		fail("mapping image");
+	}
+	sectors_ = (uint8_t*)mapping;
+}
+
+// Lays down a boot sector and empty FATs the way f_mkfs() would - which the firmware's FatFs is built without
+void FatImage::format(uint32_t numClusters, uint32_t sectorsPerCluster) {
+	bool fat12 = numClusters <= kMaxFat12Clusters;
+	bool fat32 = numClusters > kMaxFat16Clusters;
+	uint32_t fatSectors = numFatSectors(numClusters);
+	uint32_t reservedSectors = fat32 ? 32 : 1;
+
+	uint8_t* boot = sectors_;
+	memcpy(boot, "\xEB\x58\x90" "DELUGE  ", 11);
+	storeWord(boot + 11, kSectorSize);
+	boot[13] = sectorsPerCluster;
+	storeWord(boot + 14, reservedSectors);
+	boot[16] = 1; // Number of FATs
+	storeWord(boot + 17, fat32 ? 0 : kNumRootEntries);
+	storeWord(boot + 19, 0); // Total sectors, in the 32-bit field instead
+	boot[21] = 0xF8;         // Fixed disk
+	storeDword(boot + 32, size_ / kSectorSize);
+	storeWord(boot + 510, 0xAA55);
+
+	uint8_t* fat = sectors_ + reservedSectors * kSectorSize;
+	if (fat32) {
+		storeDword(boot + 36, fatSectors);
+		storeDword(boot + 44, 2); // Root directory's first cluster
+		storeWord(boot + 48, 1);  // FSInfo sector
+		boot[66] = 0x29;          // Extended boot signature
+		memcpy(boot + 71, "NO NAME    FAT32   ", 19);
+
+		uint8_t* fsInfo = sectors_ + kSectorSize;
+		storeDword(fsInfo, 0x41615252);
+		storeDword(fsInfo + 484, 0x61417272);
+		storeDword(fsInfo + 488, 0xFFFFFFFF); // Free count and next free cluster unknown
+		storeDword(fsInfo + 492, 0xFFFFFFFF);
+		storeDword(fsInfo + 508, 0xAA550000);
+
+		// Media type, end of chain, then the root directory's single cluster
+		storeDword(fat, 0x0FFFFFF8);
+		storeDword(fat + 4, 0x0FFFFFFF);
+		storeDword(fat + 8, 0x0FFFFFFF);
+	}
+	else {
+		storeWord(boot + 22, fatSectors);
+		boot[38] = 0x29;
+		memcpy(boot + 43, fat12 ? "NO NAME    FAT12   " : "NO NAME    FAT16   ", 19);
+
+		// Media type, then end of chain
+		memset(fat, 0xFF, fat12 ? 3 : 4);
+		fat[0] = 0xF8;
+	}
+}
+
+void FatImage::mount() {
+	if (mountedImage) {
+		throw std::logic_error("only one image can be the card at a time");
+	}
+	mountedImage = this;
+	check(f_mount(&fileSystem, "", 1), "f_mount");
+}
+
+void FatImage::writeInterleaved(std::span<const std::string_view> paths, uint32_t numClustersEach) {
+	std::vector<FIL> files(paths.size());
+	for (size_t f = 0; f < paths.size(); f++) {
+		check(f_open(&files[f], std::string(paths[f]).c_str(), FA_CREATE_ALWAYS | FA_WRITE), "f_open");
+	}
+
+	std::vector<uint8_t> cluster(clusterSize());
+	for (uint32_t c = 0; c < numClustersEach; c++) {
+		for (size_t f = 0; f < paths.size(); f++) {
+			memset(cluster.data(), patternByte(f, c), cluster.size());
+			UINT written;
+			check(f_write(&files[f], cluster.data(), cluster.size(), &written), "f_write");
+			if (written != cluster.size()) {
+				throw std::runtime_error("image full");
+			}
+		}
+	}
+
+	for (FIL& file : files) {
+		check(f_close(&file), "f_close");
+	}
+}
+
+std::vector<uint32_t> FatImage::clusterSectors(std::string_view path) {
+	FIL file;
+	check(f_open(&file, std::string(path).c_str(), FA_READ), "f_open");
+
+	std::vector<uint32_t> sectors;
+	uint32_t numClusters = (f_size(&file) + clusterSize() - 1) / clusterSize();
+	DWORD cluster = file.obj.sclust;
+	while (sectors.size() < numClusters && cluster >= 2 && cluster < fileSystem.n_fatent) {
+		sectors.push_back(clst2sect(&fileSystem, cluster));
+		cluster = get_fat_from_fs(&fileSystem, cluster);
+	}
+
+	f_close(&file);
+	return sectors;
+}
+
+bool FatImage::read(uint8_t* buff, uint32_t sector, uint32_t count) {
+	if ((uint64_t)(sector + count) * kSectorSize > size_) {
+		return false;
+	}
+	memcpy(buff, &sectors_[(uint64_t)sector * kSectorSize], (size_t)count * kSectorSize);
+	numReadCommands_++;
+	numSectorsRead_ += count;
+	return true;
+}
+
+bool FatImage::readScattered(uint8_t* const* buffs, uint32_t sectorsPerBuff, uint32_t sector, uint32_t count) {
+	if ((uint64_t)(sector + count) * kSectorSize > size_) {
+		return false;
+	}
+	for (uint32_t done = 0; done < count; done += sectorsPerBuff) {
+		uint32_t thisCount = std::min(sectorsPerBuff, count - done);
+		memcpy(buffs[done / sectorsPerBuff], &sectors_[(uint64_t)(sector + done) * kSectorSize],
+		       (size_t)thisCount * kSectorSize);
+	}
+	numReadCommands_++;
+	numSectorsRead_ += count;
+	return true;
+}
+
+bool FatImage::write(const uint8_t* buff, uint32_t sector, uint32_t count) {
+	if (!writable_ || (uint64_t)(sector + count) * kSectorSize > size_) {
+		return false;
+	}
+	memcpy(&sectors_[(uint64_t)sector * kSectorSize], buff, (size_t)count * kSectorSize);
+	return true;
+}
+
+} // namespace deluge::bench
+
+using deluge::bench::mountedImage;
+
+extern "C" {
+
+DSTATUS disk_initialize(BYTE pdrv) {
+	return mountedImage ? 0 : STA_NOINIT;
+}
+
+DSTATUS disk_status(BYTE pdrv) {
+	if (!mountedImage) {
+		return STA_NOINIT;
+	}
+	return mountedImage->writable() ? 0 : STA_PROTECT;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE* buff, LBA_t sector, UINT count) {
+	return (mountedImage && mountedImage->read(buff, sector, count)) ? RES_OK : RES_ERROR;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE* buff, LBA_t sector, UINT count) {
+	return (mountedImage && mountedImage->write(buff, sector, count)) ? RES_OK : RES_ERROR;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* buff) {
+	if (!mountedImage) {
+		return RES_NOTRDY;
+	}
+	switch (cmd) {
+	case GET_SECTOR_COUNT:
+		*(LBA_t*)buff = mountedImage->sizeBytes() / 512;
+		break;
+	case GET_SECTOR_SIZE:
+		*(WORD*)buff = 512;
+		break;
+	case GET_BLOCK_SIZE:
+		*(DWORD*)buff = 1;
+		break;
+	}
+	return RES_OK;
+}
+
+// On the card these skip servicing the Cluster loading queue first. There's nothing like that to skip here
+DRESULT disk_read_without_streaming_first(BYTE pdrv, BYTE* buff, LBA_t sector, UINT count) {
+	return disk_read(pdrv, buff, sector, count);
+}
+
+DRESULT disk_read_scattered_without_streaming_first(BYTE pdrv, BYTE* const* buffs, UINT sectorsPerBuff, LBA_t sector,
+                                                    UINT count) {
+	return (mountedImage && mountedImage->readScattered(buffs, sectorsPerBuff, sector, count)) ? RES_OK : RES_ERROR;
+}
+
+DWORD get_fattime(void) {
+	return ((DWORD)(2024 - 1980) << 25) | (1 << 21) | (1 << 16);
+}
+}
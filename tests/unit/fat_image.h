@@ -0,0 +1,100 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+extern "C" {
+#include "fatfs/ff.h"
+}
+
+namespace deluge::bench {
+
+/// What reading from an SD card costs, for turning the commands the harness sees into time. Defaults are a middling
+/// card on the Deluge's 4-bit bus: each read command pays the card's access time, then every sector its transfer time
+struct CardTiming {
+	double secondsPerCommand = 400e-6;
+	double secondsPerSector = 512.0 / 25e6;
+};
+
+/// A FAT volume in an image file standing in for the SD card, memory-mapped, with the real FatFs on top of it. While
+/// it's alive it's the diskio layer - FatFs's disk_read() and friends, plus the firmware's own
+/// disk_read_without_streaming_first() and disk_read_scattered_without_streaming_first() - so anything built on
+/// FatFs, up to AudioFileManager's Cluster loading, runs against it on Linux. It counts what's asked of the card.
+///
+/// The image can be a fresh one, formatted here, or a dd of a real card (partitioned or not) to profile against a real
+/// library. Either way only the pages actually touched get read in, so a multi-gigabyte image is no problem.
+class FatImage {
+public:
+	/// Formats a volume of numClusters clusters of sectorsPerCluster sectors, and mounts it. The FAT type is whichever
+	/// FatFs will take that cluster count as - FAT12 under 4085, FAT32 over 65524, FAT16 between. With no path, the
+	/// image is a sparse temporary file that's gone once this is
+	FatImage(uint32_t numClusters, uint32_t sectorsPerCluster, const char* path = nullptr);
+	/// Maps an existing image and mounts it. Read-only unless writable, in which case changes go to the file
+	explicit FatImage(const char* path, bool writable = false);
+	~FatImage();
+
+	FatImage(const FatImage&) = delete;
+	FatImage& operator=(const FatImage&) = delete;
+
+	/// Writes the files at once, a Cluster of each in turn, so if there's more than one they end up interleaved on the
+	/// card the way files recorded or copied at the same time do. Cluster c of file f is filled with patternByte(f, c)
+	void writeInterleaved(std::span<const std::string_view> paths, uint32_t numClustersEach);
+
+	/// The first sector of each of the file's Clusters, found the way AudioFileManager does it
+	std::vector<uint32_t> clusterSectors(std::string_view path);
+
+	static uint8_t patternByte(int32_t file, int32_t cluster) { return (uint8_t)(file * 37 + cluster * 11 + 1); }
+
+	uint32_t clusterSize() const { return fileSystem.csize * 512; }
+	uint64_t sizeBytes() const { return size_; }
+	bool writable() const { return writable_; }
+
+	/// One read command, count sectors from sector into buff
+	bool read(uint8_t* buff, uint32_t sector, uint32_t count);
+	/// One read command, spread sectorsPerBuff sectors into each of buffs in turn
+	bool readScattered(uint8_t* const* buffs, uint32_t sectorsPerBuff, uint32_t sector, uint32_t count);
+	bool write(const uint8_t* buff, uint32_t sector, uint32_t count);
+
+	void resetCounts() { numReadCommands_ = numSectorsRead_ = 0; }
+	uint64_t numReadCommands() const { return numReadCommands_; }
+	uint64_t numSectorsRead() const { return numSectorsRead_; }
+	/// How long the reads since resetCounts() would have taken on a card
+	double cardSeconds(CardTiming timing = {}) const {
+		return numReadCommands_ * timing.secondsPerCommand + numSectorsRead_ * timing.secondsPerSector;
+	}
+
+	FATFS fileSystem;
+
+private:
+	void map(int fd, bool writable);
+	void format(uint32_t numClusters, uint32_t sectorsPerCluster);
+	void mount();
+
+	int fd_ = -1;
+	uint8_t* sectors_ = nullptr;
+	uint64_t size_ = 0;
+	bool writable_ = false;
+	uint64_t numReadCommands_ = 0;
+	uint64_t numSectorsRead_ = 0;
+};
+
+} // namespace deluge::bench
@@ -0,0 +1,468 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "filter_batch_renderer.h"
+#include <cstring>
+
+namespace deluge::dsp::filter {
+
+namespace {
+using lanes::q31x4_t;
+
+bool isSVF(FilterMode mode) {
+	return (mode == FilterMode::SVF_BAND) || (mode == FilterMode::SVF_NOTCH);
+}
+
+// Batches don't do the dry/wet blend which follows a reset with fade, so a filter isn't batchable until that has
+// finished
+template <typename T>
+bool fadedIn(Filter<T>& filter) {
+	return filter.dryFade < 0.001;
+}
+
+// An SVFilter's configuration and mono state, one filter per lane. doSVF() matches SVFilter::doSVF()
+struct SVFLanes {
+	q31x4_t in;
+	q31x4_t fc;
+	q31x4_t q;
+	q31x4_t c_low;
+	q31x4_t c_band;
+	q31x4_t c_high;
+	bool band_mode;
+
+	q31x4_t low;
+	q31x4_t band;
+
+	// low, high and band for one pass of the doubled-up filter
+	[[gnu::always_inline]] inline q31x4_t step(q31x4_t input, q31x4_t* high) {
+		low = vaddq_s32(low, vshlq_n_s32(lanes::multiply_32x32_rshift32(band, fc), 1));
+		*high = vsubq_s32(input, low);
+		*high = vsubq_s32(*high, vshlq_n_s32(lanes::multiply_32x32_rshift32(band, q), 1));
+		band = vaddq_s32(vshlq_n_s32(lanes::multiply_32x32_rshift32(*high, fc), 1), band);
+		return low;
+	}
+
+	[[gnu::always_inline]] inline q31x4_t doSVF(q31x4_t input) {
+		input = lanes::multiply_32x32_rshift32(in, input);
+
+		q31x4_t highi;
+		q31x4_t lowi = step(input, &highi);
+
+		// saturate band feedback
+		band = lanes::getTanHUnknown(band, 3);
+		q31x4_t bandi = band;
+
+		// double sample to increase the cutoff frequency
+		q31x4_t high;
+		lowi = vaddq_s32(lowi, step(input, &high));
+		highi = vaddq_s32(highi, high);
+		bandi = vaddq_s32(bandi, band);
+
+		q31x4_t result = lanes::multiply_32x32_rshift32_rounded(lowi, c_low);
+		result = lanes::multiply_accumulate_32x32_rshift32_rounded(result, highi, c_high);
+		if (band_mode) {
+			result = lanes::multiply_accumulate_32x32_rshift32_rounded(result, bandi, c_band);
+		}
+
+		// saturate band feedback
+		band = lanes::getTanHUnknown(band, 3);
+		// compensate for division by two on each multiply
+		// then multiply by 1.5 to match ladders
+		return vmulq_n_s32(result, 3);
+	}
+};
+
+// An LpLadderFilter's configuration and mono state, one filter per lane. The functions match LpLadderFilter's own
+// per-sample ones.
+struct LpLadderLanes {
+	q31x4_t moveability;
+	q31x4_t lpf1Feedback;
+	q31x4_t lpf2Feedback;
+	q31x4_t lpf3Feedback;
+	q31x4_t divideBy1PlusTannedFrequency;
+	q31x4_t processedResonance;
+	q31x4_t divideByTotalMoveabilityAndProcessedResonance;
+	q31x4_t morph;
+	// lanes which saturate their input, see LpLadderFilter::scaleInput()
+	uint32_t saturatingLanes;
+
+	q31x4_t noiseLastValue;
+	lanes::FilterComponent lpfLPF1;
+	lanes::FilterComponent lpfLPF2;
+	lanes::FilterComponent lpfLPF3;
+	lanes::FilterComponent lpfLPF4;
+
+	[[gnu::always_inline]] inline q31x4_t noisyMoveability() {
+		q31x4_t noise = vshrq_n_s32(lanes::getNoise(), 2);
+		q31x4_t distanceToGo = vsubq_s32(noise, noiseLastValue);
+		noiseLastValue = vaddq_s32(noiseLastValue, vshrq_n_s32(distanceToGo, 7));
+		return vaddq_s32(moveability, lanes::multiply_32x32_rshift32(moveability, noiseLastValue));
+	}
+
+	[[gnu::always_inline]] inline q31x4_t scaleInput(q31x4_t input, q31x4_t feedbacksSum) {
+		q31x4_t resonated = vshlq_n_s32(lanes::multiply_32x32_rshift32_rounded(feedbacksSum, processedResonance), 3);
+		q31x4_t temp = vshlq_n_s32(
+		    lanes::multiply_32x32_rshift32_rounded(vsubq_s32(input, resonated),
+		                                           divideByTotalMoveabilityAndProcessedResonance),
+		    2);
+		if (saturatingLanes) {
+			q31x4_t extra = vshlq_n_s32(lanes::multiply_32x32_rshift32(input, morph), 1);
+			extra = vandq_s32(extra, lanes::laneSelect(saturatingLanes));
+			temp = lanes::getTanHUnknown(vaddq_s32(temp, extra), 2, saturatingLanes);
+		}
+		return temp;
+	}
+
+	[[gnu::always_inline]] inline q31x4_t do12dBLPFOnSample(q31x4_t input) {
+		q31x4_t noisyM = noisyMoveability();
+		q31x4_t feedbacksSum = vaddq_s32(vaddq_s32(lpfLPF1.getFeedbackOutput(lpf1Feedback),
+		                                           lpfLPF2.getFeedbackOutput(lpf2Feedback)),
+		                                 lpfLPF3.getFeedbackOutput(divideBy1PlusTannedFrequency));
+		q31x4_t x = scaleInput(input, feedbacksSum);
+		return vshlq_n_s32(lpfLPF3.doAPF(lpfLPF2.doFilter(lpfLPF1.doFilter(x, noisyM), noisyM), noisyM), 1);
+	}
+
+	[[gnu::always_inline]] inline q31x4_t feedbacksSum24dB() {
+		q31x4_t sum = vaddq_s32(lpfLPF1.getFeedbackOutputWithoutLshift(lpf1Feedback),
+		                        lpfLPF2.getFeedbackOutputWithoutLshift(lpf2Feedback));
+		sum = vaddq_s32(sum, lpfLPF3.getFeedbackOutputWithoutLshift(lpf3Feedback));
+		sum = vaddq_s32(sum, lpfLPF4.getFeedbackOutputWithoutLshift(divideBy1PlusTannedFrequency));
+		return vshlq_n_s32(sum, 2);
+	}
+
+	[[gnu::always_inline]] inline q31x4_t do24dBLPFOnSample(q31x4_t input) {
+		q31x4_t noisyM = noisyMoveability();
+		q31x4_t x = scaleInput(input, feedbacksSum24dB());
+		q31x4_t out = lpfLPF4.doFilter(
+		    lpfLPF3.doFilter(lpfLPF2.doFilter(lpfLPF1.doFilter(x, noisyM), noisyM), noisyM), noisyM);
+		return vshlq_n_s32(out, 1);
+	}
+
+	[[gnu::always_inline]] inline q31x4_t doDriveLPFOnSample(q31x4_t input) {
+		q31x4_t noisyM = noisyMoveability();
+		q31x4_t x = scaleInput(input, lanes::getTanHUnknown(feedbacksSum24dB(), 7));
+		q31x4_t out = lpfLPF4.doFilter(
+		    lpfLPF3.doFilter(lpfLPF2.doFilter(lpfLPF1.doFilter(x, noisyM), noisyM), noisyM), noisyM);
+		return vshlq_n_s32(out, 1);
+	}
+};
+
+// An HpLadderFilter's configuration and mono state, one filter per lane. doHPF() matches HpLadderFilter::doHPF()
+struct HpLadderLanes {
+	q31x4_t fc;
+	q31x4_t morph;
+	q31x4_t hpfHPF3Feedback;
+	q31x4_t hpfLPF1Feedback;
+	q31x4_t divideByTotalMoveability;
+	q31x4_t hpfDivideByProcessedResonance;
+	// lanes with enough resonance to saturate, and the ones with so much they saturate with antialiasing
+	uint32_t saturatingLanes;
+	uint32_t antialiasedLanes;
+
+	lanes::FilterComponent hpfHPF1;
+	lanes::FilterComponent hpfLPF1;
+	lanes::FilterComponent hpfHPF3;
+	q31x4_t hpfLastWorkingValue;
+
+	[[gnu::always_inline]] inline q31x4_t saturate(q31x4_t a) {
+		if (antialiasedLanes) {
+			// the 2d table needs last time's value for the lane too, so it's all a lane at a time
+			int32_t values[kBatchSize];
+			uint32_t lastWorkingValues[kBatchSize];
+			vst1q_s32(values, a);
+			vst1q_u32(lastWorkingValues, vreinterpretq_u32_s32(hpfLastWorkingValue));
+			for (int32_t lane = 0; lane < kBatchSize; lane++) {
+				if (antialiasedLanes & (1 << lane)) {
+					values[lane] = getTanHAntialiased(values[lane], &lastWorkingValues[lane], 1);
+				}
+				else {
+					lastWorkingValues[lane] = (uint32_t)lshiftAndSaturate<2>(values[lane]) + 2147483648u;
+					if (saturatingLanes & (1 << lane)) {
+						values[lane] = getTanHUnknown(values[lane], 2);
+					}
+				}
+			}
+			hpfLastWorkingValue = vreinterpretq_s32_u32(vld1q_u32(lastWorkingValues));
+			return vld1q_s32(values);
+		}
+		hpfLastWorkingValue = vaddq_s32(lanes::lshiftAndSaturate<2>(a), vdupq_n_s32(INT32_MIN));
+		if (saturatingLanes) {
+			a = lanes::getTanHUnknown(a, 2, saturatingLanes);
+		}
+		return a;
+	}
+
+	[[gnu::always_inline]] inline q31x4_t doHPF(q31x4_t input) {
+		q31_t constexpr lower_limit = -(ONE_Q31 >> 8);
+		q31x4_t temp_fc = vmaxq_s32(lanes::multiply_accumulate_32x32_rshift32_rounded(fc, vshlq_n_s32(input, 4), morph),
+		                            vdupq_n_s32(lower_limit));
+
+		q31x4_t firstHPFOutput = vsubq_s32(input, hpfHPF1.doFilter(input, temp_fc));
+
+		q31x4_t feedbacksValue =
+		    vaddq_s32(hpfHPF3.getFeedbackOutput(hpfHPF3Feedback), hpfLPF1.getFeedbackOutput(hpfLPF1Feedback));
+
+		q31x4_t a = vshlq_n_s32(
+		    lanes::multiply_32x32_rshift32_rounded(divideByTotalMoveability, vaddq_s32(firstHPFOutput, feedbacksValue)),
+		    4 + 1);
+
+		a = saturate(a);
+
+		hpfLPF1.doFilter(vsubq_s32(a, hpfHPF3.doFilter(a, temp_fc)), temp_fc);
+
+		// Normalization
+		return vshlq_n_s32(lanes::multiply_32x32_rshift32_rounded(a, hpfDivideByProcessedResonance), 8 - 1);
+	}
+};
+} // namespace
+
+[[gnu::hot]] void FilterBatch::doSVF(std::array<SVFilter*, kBatchSize> const& filters, q31_t* interleaved,
+                                     int32_t numSamples) {
+	SVFLanes batch;
+	batch.in = lanes::load(filters, &SVFilter::in);
+	batch.fc = lanes::load(filters, &SVFilter::fc);
+	batch.q = lanes::load(filters, &SVFilter::q);
+	batch.c_low = lanes::load(filters, &SVFilter::c_low);
+	batch.c_band = lanes::load(filters, &SVFilter::c_band);
+	batch.c_high = lanes::load(filters, &SVFilter::c_high);
+	batch.band_mode = filters[0]->band_mode;
+	batch.low = lanes::load(filters, [](SVFilter& f) -> q31_t& { return f.l.low; });
+	batch.band = lanes::load(filters, [](SVFilter& f) -> q31_t& { return f.l.band; });
+
+	q31_t* const end = interleaved + numSamples * kBatchSize;
+	for (q31_t* samples = interleaved; samples != end; samples += kBatchSize) {
+		vst1q_s32(samples, batch.doSVF(vld1q_s32(samples)));
+	}
+
+	lanes::store(filters, [](SVFilter& f) -> q31_t& { return f.l.low; }, batch.low);
+	lanes::store(filters, [](SVFilter& f) -> q31_t& { return f.l.band; }, batch.band);
+}
+
+[[gnu::hot]] void FilterBatch::doLpLadder(std::array<LpLadderFilter*, kBatchSize> const& filters,
+                                          q31_t* interleaved, int32_t numSamples) {
+	LpLadderLanes batch;
+	batch.moveability = lanes::load(filters, &LpLadderFilter::moveability);
+	batch.lpf1Feedback = lanes::load(filters, &LpLadderFilter::lpf1Feedback);
+	batch.lpf2Feedback = lanes::load(filters, &LpLadderFilter::lpf2Feedback);
+	batch.lpf3Feedback = lanes::load(filters, &LpLadderFilter::lpf3Feedback);
+	batch.divideBy1PlusTannedFrequency = lanes::load(filters, &LpLadderFilter::divideBy1PlusTannedFrequency);
+	batch.processedResonance = lanes::load(filters, &LpLadderFilter::processedResonance);
+	batch.divideByTotalMoveabilityAndProcessedResonance =
+	    lanes::load(filters, &LpLadderFilter::divideByTotalMoveabilityAndProcessedResonance);
+	batch.morph = lanes::load(filters, &LpLadderFilter::morph);
+	batch.saturatingLanes = lanes::mask(
+	    filters, [](LpLadderFilter& f) { return f.morph > 0 || f.processedResonance > 510000000; });
+
+	batch.noiseLastValue = lanes::load(filters, [](LpLadderFilter& f) -> q31_t& { return f.l.noiseLastValue; });
+	batch.lpfLPF1.memory = lanes::load(filters, [](LpLadderFilter& f) -> q31_t& { return f.l.lpfLPF1.memory; });
+	batch.lpfLPF2.memory = lanes::load(filters, [](LpLadderFilter& f) -> q31_t& { return f.l.lpfLPF2.memory; });
+	batch.lpfLPF3.memory = lanes::load(filters, [](LpLadderFilter& f) -> q31_t& { return f.l.lpfLPF3.memory; });
+	batch.lpfLPF4.memory = lanes::load(filters, [](LpLadderFilter& f) -> q31_t& { return f.l.lpfLPF4.memory; });
+
+	q31_t* const end = interleaved + numSamples * kBatchSize;
+	FilterMode mode = filters[0]->lpfMode;
+	if (mode == FilterMode::TRANSISTOR_12DB) {
+		for (q31_t* samples = interleaved; samples != end; samples += kBatchSize) {
+			vst1q_s32(samples, batch.do12dBLPFOnSample(vld1q_s32(samples)));
+		}
+	}
+	else if (mode == FilterMode::TRANSISTOR_24DB) {
+		for (q31_t* samples = interleaved; samples != end; samples += kBatchSize) {
+			vst1q_s32(samples, batch.do24dBLPFOnSample(vld1q_s32(samples)));
+		}
+	}
+	else if (mode == FilterMode::TRANSISTOR_24DB_DRIVE) {
+		for (q31_t* samples = interleaved; samples != end; samples += kBatchSize) {
+			q31x4_t outputSampleToKeep = batch.doDriveLPFOnSample(vld1q_s32(samples));
+			vst1q_s32(samples, lanes::getTanHUnknown(outputSampleToKeep, 4));
+		}
+	}
+
+	lanes::store(filters, [](LpLadderFilter& f) -> q31_t& { return f.l.noiseLastValue; }, batch.noiseLastValue);
+	lanes::store(filters, [](LpLadderFilter& f) -> q31_t& { return f.l.lpfLPF1.memory; }, batch.lpfLPF1.memory);
+	lanes::store(filters, [](LpLadderFilter& f) -> q31_t& { return f.l.lpfLPF2.memory; }, batch.lpfLPF2.memory);
+	lanes::store(filters, [](LpLadderFilter& f) -> q31_t& { return f.l.lpfLPF3.memory; }, batch.lpfLPF3.memory);
+	lanes::store(filters, [](LpLadderFilter& f) -> q31_t& { return f.l.lpfLPF4.memory; }, batch.lpfLPF4.memory);
+}
+
+[[gnu::hot]] void FilterBatch::doHpLadder(std::array<HpLadderFilter*, kBatchSize> const& filters,
+                                          q31_t* interleaved, int32_t numSamples) {
+	HpLadderLanes batch;
+	batch.fc = lanes::load(filters, &HpLadderFilter::fc);
+	batch.morph = lanes::load(filters, &HpLadderFilter::morph_);
+	batch.hpfHPF3Feedback = lanes::load(filters, &HpLadderFilter::hpfHPF3Feedback);
+	batch.hpfLPF1Feedback = lanes::load(filters, &HpLadderFilter::hpfLPF1Feedback);
+	batch.divideByTotalMoveability = lanes::load(filters, &HpLadderFilter::divideByTotalMoveability);
+	batch.hpfDivideByProcessedResonance = lanes::load(filters, &HpLadderFilter::hpfDivideByProcessedResonance);
+	batch.saturatingLanes =
+	    lanes::mask(filters, [](HpLadderFilter& f) { return f.hpfProcessedResonance > 750000000; });
+	batch.antialiasedLanes =
+	    lanes::mask(filters, [](HpLadderFilter& f) { return f.hpfProcessedResonance > 900000000; });
+
+	batch.hpfHPF1.memory = lanes::load(filters, [](HpLadderFilter& f) -> q31_t& { return f.l.hpfHPF1.memory; });
+	batch.hpfLPF1.memory = lanes::load(filters, [](HpLadderFilter& f) -> q31_t& { return f.l.hpfLPF1.memory; });
+	batch.hpfHPF3.memory = lanes::load(filters, [](HpLadderFilter& f) -> q31_t& { return f.l.hpfHPF3.memory; });
+	batch.hpfLastWorkingValue =
+	    lanes::load(filters, [](HpLadderFilter& f) -> uint32_t& { return f.l.hpfLastWorkingValue; });
+
+	q31_t* const end = interleaved + numSamples * kBatchSize;
+	for (q31_t* samples = interleaved; samples != end; samples += kBatchSize) {
+		vst1q_s32(samples, batch.doHPF(vld1q_s32(samples)));
+	}
+
+	lanes::store(filters, [](HpLadderFilter& f) -> q31_t& { return f.l.hpfHPF1.memory; }, batch.hpfHPF1.memory);
+	lanes::store(filters, [](HpLadderFilter& f) -> q31_t& { return f.l.hpfLPF1.memory; }, batch.hpfLPF1.memory);
+	lanes::store(filters, [](HpLadderFilter& f) -> q31_t& { return f.l.hpfHPF3.memory; }, batch.hpfHPF3.memory);
+	lanes::store(filters, [](HpLadderFilter& f) -> uint32_t& { return f.l.hpfLastWorkingValue; },
+	             batch.hpfLastWorkingValue);
+}
+
+bool FilterBatch::batchable(FilterSet& first, FilterSet& other) {
+	if (first.LPFOn != other.LPFOn || first.HPFOn != other.HPFOn || first.routing_ != other.routing_) {
+		return false;
+	}
+	if (first.LPFOn) {
+		if (first.lpfMode_ != other.lpfMode_) {
+			return false;
+		}
+		if (isSVF(first.lpfMode_)) {
+			if (!fadedIn(other.lpfilter.svf)) {
+				return false;
+			}
+		}
+		else {
+			// the oversampled drive ladder isn't batched
+			LpLadderFilter& ladder = other.lpfilter.ladder;
+			if (!fadedIn(ladder) || (ladder.lpfMode == FilterMode::TRANSISTOR_24DB_DRIVE && ladder.doOversampling)) {
+				return false;
+			}
+		}
+	}
+	if (first.HPFOn) {
+		if (first.hpfMode_ != other.hpfMode_) {
+			return false;
+		}
+		if (isSVF(first.hpfMode_) ? !fadedIn(other.hpfilter.svf) : !fadedIn(other.hpfilter.ladder)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+[[gnu::hot]] void FilterBatch::renderLPF(std::array<FilterSet*, kBatchSize> const& sets, q31_t* interleaved,
+                                         int32_t numSamples) {
+	if (isSVF(sets[0]->lpfMode_)) {
+		std::array<SVFilter*, kBatchSize> filters;
+		for (int32_t lane = 0; lane < kBatchSize; lane++) {
+			filters[lane] = &sets[lane]->lpfilter.svf;
+		}
+		doSVF(filters, interleaved, numSamples);
+	}
+	else {
+		std::array<LpLadderFilter*, kBatchSize> filters;
+		for (int32_t lane = 0; lane < kBatchSize; lane++) {
+			filters[lane] = &sets[lane]->lpfilter.ladder;
+		}
+		doLpLadder(filters, interleaved, numSamples);
+	}
+}
+
+[[gnu::hot]] void FilterBatch::renderHPF(std::array<FilterSet*, kBatchSize> const& sets, q31_t* interleaved,
+                                         int32_t numSamples) {
+	if (isSVF(sets[0]->hpfMode_)) {
+		std::array<SVFilter*, kBatchSize> filters;
+		for (int32_t lane = 0; lane < kBatchSize; lane++) {
+			filters[lane] = &sets[lane]->hpfilter.svf;
+		}
+		doSVF(filters, interleaved, numSamples);
+	}
+	else {
+		std::array<HpLadderFilter*, kBatchSize> filters;
+		for (int32_t lane = 0; lane < kBatchSize; lane++) {
+			filters[lane] = &sets[lane]->hpfilter.ladder;
+		}
+		doHpLadder(filters, interleaved, numSamples);
+	}
+}
+
+[[gnu::hot]] bool FilterBatch::renderLong(std::array<FilterSet*, kBatchSize> const& sets,
+                                          std::array<q31_t*, kBatchSize> const& buffers, int32_t numSamples,
+                                          std::span<q31_t, kScratchSize> scratch) {
+	for (FilterSet* set : sets) {
+		if (!batchable(*sets[0], *set)) {
+			return false;
+		}
+	}
+	// renderLong() still adds the dry signal to itself when parallel filters are both off
+	if (!sets[0]->isOn() && sets[0]->routing_ != FilterRoute::PARALLEL) {
+		return true;
+	}
+
+	// the voices interleaved, and a copy of them for parallel routing
+	q31_t* renderBuffer = scratch.data();
+	q31_t* tempRenderBuffer = scratch.data() + SSI_TX_BUFFER_NUM_SAMPLES * kBatchSize;
+	for (int32_t i = 0; i < numSamples; i++) {
+		for (int32_t lane = 0; lane < kBatchSize; lane++) {
+			renderBuffer[i * kBatchSize + lane] = buffers[lane][i];
+		}
+	}
+
+	bool doLPF = sets[0]->LPFOn;
+	bool doHPF = sets[0]->HPFOn;
+	switch (sets[0]->routing_) {
+	case FilterRoute::HIGH_TO_LOW:
+		if (doHPF) {
+			renderHPF(sets, renderBuffer, numSamples);
+		}
+		if (doLPF) {
+			renderLPF(sets, renderBuffer, numSamples);
+		}
+		break;
+
+	case FilterRoute::LOW_TO_HIGH:
+		if (doLPF) {
+			renderLPF(sets, renderBuffer, numSamples);
+		}
+		if (doHPF) {
+			renderHPF(sets, renderBuffer, numSamples);
+		}
+		break;
+
+	case FilterRoute::PARALLEL:
+		int32_t length = numSamples * kBatchSize;
+		memcpy(tempRenderBuffer, renderBuffer, length * sizeof(q31_t));
+		if (doHPF) {
+			renderHPF(sets, tempRenderBuffer, numSamples);
+		}
+		if (doLPF) {
+			renderLPF(sets, renderBuffer, numSamples);
+		}
+		for (int32_t i = 0; i < length; i++) {
+			renderBuffer[i] += tempRenderBuffer[i];
+		}
+		break;
+	}
+
+	for (int32_t i = 0; i < numSamples; i++) {
+		for (int32_t lane = 0; lane < kBatchSize; lane++) {
+			buffers[lane][i] = renderBuffer[i * kBatchSize + lane];
+		}
+	}
+	return true;
+}
+
+} // namespace deluge::dsp::filter
@@ -0,0 +1,178 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "arm_neon_shim.h"
+#include "dsp/filter/filter_batch.h"
+#include "dsp/filter/filter_set.h"
+#include "util/fixedpoint.h"
+#include "util/functions.h"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <span>
+
+/*
+ * Filtering several voices at once, built on the lane functions in dsp/filter/filter_batch.h. Every filter is a
+ * serial recurrence over samples, so one voice can't use more than one NEON lane - but kBatchSize voices of the same
+ * Sound, filtered with the same mode, can each have a lane of their own. Batched filters work on an interleaved buffer
+ * holding sample 0 of every voice, then sample 1 of every voice and so on, and keep their state and configuration in
+ * vectors with one lane per voice.
+ *
+ * The lane functions match their scalar namesakes in fixedpoint.h bit for bit, so a batch renders exactly what
+ * rendering each voice a sample at a time in turn would. The one thing that depends on order across voices is the
+ * noise the ladders add to their frequency, which getNoise() here draws in that same lane order.
+ *
+ * Nothing in the firmware batches: on the host only the SVF comes out ahead, and the firmware's Voice::render() would
+ * need splitting around its filter stage to see four voices at once. This is kept with the tests, which check it
+ * renders the same as FilterSet::renderLong(), so the benchmarks can measure it against that.
+ */
+namespace deluge::dsp::filter {
+
+namespace lanes {
+
+/// lshiftAndSaturate<lshift>() on each lane
+template <int32_t lshift>
+[[gnu::always_inline]] inline q31x4_t lshiftAndSaturate(q31x4_t value) {
+	value = vminq_s32(value, vdupq_n_s32(INT32_MAX >> lshift));
+	value = vmaxq_s32(value, vdupq_n_s32(INT32_MIN >> lshift));
+	return vshlq_n_s32(value, lshift);
+}
+
+/// getTanHUnknown() on the lanes whose bit is set in laneMask. The table lookup can't be vectorised, so it's a lane
+/// at a time.
+[[gnu::always_inline]] inline q31x4_t getTanHUnknown(q31x4_t input, uint32_t saturationAmount,
+                                                     uint32_t laneMask = (1 << kBatchSize) - 1) {
+	int32_t values[kBatchSize];
+	vst1q_s32(values, input);
+	for (int32_t lane = 0; lane < kBatchSize; lane++) {
+		if (laneMask & (1 << lane)) {
+			values[lane] = ::getTanHUnknown(values[lane], saturationAmount);
+		}
+	}
+	return vld1q_s32(values);
+}
+
+/// The next kBatchSize values getNoise() would give, one per lane, leaving the generator where those calls would
+[[gnu::always_inline]] inline q31x4_t getNoise() {
+	// CONG is jcong = 69069 * jcong + 1234567, so lane n is that applied n + 1 times
+	constexpr uint32_t kMul = 69069;
+	constexpr uint32_t kAdd = 1234567;
+	static constexpr uint32_t multipliers[kBatchSize] = {kMul, kMul * kMul, kMul * kMul * kMul,
+	                                                     kMul * kMul * kMul * kMul};
+	static constexpr uint32_t addends[kBatchSize] = {kAdd, kAdd * (kMul + 1), kAdd * (kMul * kMul + kMul + 1),
+	                                                 kAdd * (kMul * kMul * kMul + kMul * kMul + kMul + 1)};
+	uint32x4_t next = vmlaq_u32(vld1q_u32(addends), vdupq_n_u32(jcong), vld1q_u32(multipliers));
+	jcong = vgetq_lane_u32(next, kBatchSize - 1);
+	return vreinterpretq_s32_u32(next);
+}
+
+/// One field of each of kBatchSize objects, as lanes. field is a member pointer, or returns a reference to the field
+/// given an object
+template <typename T, typename Field>
+[[gnu::always_inline]] inline q31x4_t load(std::array<T*, kBatchSize> const& objects, Field field) {
+	int32_t values[kBatchSize];
+	for (int32_t lane = 0; lane < kBatchSize; lane++) {
+		values[lane] = (int32_t)std::invoke(field, *objects[lane]);
+	}
+	return vld1q_s32(values);
+}
+
+/// Write lanes back to a field of each of kBatchSize objects
+template <typename T, typename Field>
+[[gnu::always_inline]] inline void store(std::array<T*, kBatchSize> const& objects, Field field, q31x4_t lanes) {
+	int32_t values[kBatchSize];
+	vst1q_s32(values, lanes);
+	for (int32_t lane = 0; lane < kBatchSize; lane++) {
+		std::invoke(field, *objects[lane]) = values[lane];
+	}
+}
+
+/// All ones in the lanes whose bit is set in laneMask, for masking with vandq_s32()
+[[gnu::always_inline]] inline q31x4_t laneSelect(uint32_t laneMask) {
+	int32_t values[kBatchSize];
+	for (int32_t lane = 0; lane < kBatchSize; lane++) {
+		values[lane] = (laneMask & (1 << lane)) ? -1 : 0;
+	}
+	return vld1q_s32(values);
+}
+
+/// Bit lane of the result is set if test is true of objects[lane]
+template <typename T, typename Test>
+[[gnu::always_inline]] inline uint32_t mask(std::array<T*, kBatchSize> const& objects, Test test) {
+	uint32_t result = 0;
+	for (int32_t lane = 0; lane < kBatchSize; lane++) {
+		if (test(*objects[lane])) {
+			result |= 1 << lane;
+		}
+	}
+	return result;
+}
+
+/// BasicFilterComponent across lanes
+class FilterComponent {
+public:
+	[[gnu::always_inline]] inline q31x4_t doFilter(q31x4_t input, q31x4_t moveability) {
+		q31x4_t a = vshlq_n_s32(multiply_32x32_rshift32_rounded(vsubq_s32(input, memory), moveability), 1);
+		q31x4_t b = vaddq_s32(a, memory);
+		memory = vaddq_s32(b, a);
+		return b;
+	}
+	[[gnu::always_inline]] inline q31x4_t doAPF(q31x4_t input, q31x4_t moveability) {
+		q31x4_t a = vshlq_n_s32(multiply_32x32_rshift32_rounded(vsubq_s32(input, memory), moveability), 1);
+		q31x4_t b = vaddq_s32(a, memory);
+		memory = vaddq_s32(a, b);
+		return vsubq_s32(vshlq_n_s32(b, 1), input);
+	}
+	[[gnu::always_inline]] inline q31x4_t getFeedbackOutput(q31x4_t feedbackAmount) {
+		return vshlq_n_s32(multiply_32x32_rshift32_rounded(memory, feedbackAmount), 2);
+	}
+	[[gnu::always_inline]] inline q31x4_t getFeedbackOutputWithoutLshift(q31x4_t feedbackAmount) {
+		return multiply_32x32_rshift32_rounded(memory, feedbackAmount);
+	}
+
+	q31x4_t memory;
+};
+
+} // namespace lanes
+
+class FilterBatch {
+public:
+	static constexpr size_t kScratchSize = 2 * kBatchSize * SSI_TX_BUFFER_NUM_SAMPLES;
+
+	/// Filters kBatchSize mono buffers of numSamples (at most SSI_TX_BUFFER_NUM_SAMPLES) at once, one per NEON lane,
+	/// with the same result as calling renderLong() on each set a sample at a time in turn. The sets must all have
+	/// been configured with the same modes and routing, as the voices of a Sound are. Returns false without rendering
+	/// anything if they can't be batched - then render them one at a time. scratch holds the interleaved voices.
+	static bool renderLong(std::array<FilterSet*, kBatchSize> const& sets, std::array<q31_t*, kBatchSize> const& buffers,
+	                       int32_t numSamples, std::span<q31_t, kScratchSize> scratch);
+
+private:
+	static bool batchable(FilterSet& first, FilterSet& other);
+	static void renderLPF(std::array<FilterSet*, kBatchSize> const& sets, q31_t* interleaved, int32_t numSamples);
+	static void renderHPF(std::array<FilterSet*, kBatchSize> const& sets, q31_t* interleaved, int32_t numSamples);
+
+	// each filters the mono state of kBatchSize filters configured with the same mode over an interleaved buffer
+	static void doSVF(std::array<SVFilter*, kBatchSize> const& filters, q31_t* interleaved, int32_t numSamples);
+	static void doLpLadder(std::array<LpLadderFilter*, kBatchSize> const& filters, q31_t* interleaved,
+	                       int32_t numSamples);
+	static void doHpLadder(std::array<HpLadderFilter*, kBatchSize> const& filters, q31_t* interleaved,
+	                       int32_t numSamples);
+};
+
+} // namespace deluge::dsp::filter
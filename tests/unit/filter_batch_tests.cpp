@@ -0,0 +1,165 @@
+#include "CppUTest/TestHarness.h"
+#include "filter_batch_renderer.h"
+#include "util/waves.h"
+#include <array>
+
+using namespace deluge::dsp::filter;
+
+namespace {
+
+struct FilterCase {
+	const char* name;
+	FilterMode lpfMode;
+	FilterMode hpfMode;
+	FilterRoute routing;
+	q31_t resonance;
+};
+
+// Each lane gets its own frequency, resonance and morph, as voices of one Sound do once note tracking and modulation
+// have had their say. The lanes straddle the thresholds where the filters start saturating.
+void configure(FilterSet& set, const FilterCase& filterCase, int32_t lane) {
+	q31_t lpfFrequency = (1 << 23) + lane * (3 << 22);
+	q31_t resonance = filterCase.resonance + lane * (1 << 25);
+	q31_t morph = lane == 3 ? (1 << 27) : 0;
+	set.setConfig(lpfFrequency, resonance, filterCase.lpfMode, morph, (1 << 20) + lane * (1 << 21), resonance,
+	              filterCase.hpfMode, morph, ONE_Q31 >> 1, filterCase.routing, false, nullptr);
+}
+
+// saws an octave-ish apart, with some noise so the filters see every bit
+void fillInput(std::array<std::array<q31_t, SSI_TX_BUFFER_NUM_SAMPLES>, kBatchSize>& buffers, uint32_t* phases) {
+	for (int32_t lane = 0; lane < kBatchSize; lane++) {
+		for (auto& sample : buffers[lane]) {
+			phases[lane] += 10000000u * (lane + 1);
+			sample = ((int32_t)phases[lane] >> 2) + (getNoise() >> 8);
+		}
+	}
+}
+
+// Render several windows through a batch and through renderLong() a sample at a time, voice after voice, and check
+// they come out identical.
+void checkBatchMatchesScalar(const FilterCase& filterCase) {
+	std::array<FilterSet, kBatchSize> batchSets{};
+	std::array<FilterSet, kBatchSize> scalarSets{};
+	std::array<FilterSet*, kBatchSize> batchSetPointers;
+	std::array<std::array<q31_t, SSI_TX_BUFFER_NUM_SAMPLES>, kBatchSize> batchBuffers;
+	std::array<std::array<q31_t, SSI_TX_BUFFER_NUM_SAMPLES>, kBatchSize> scalarBuffers;
+	std::array<q31_t*, kBatchSize> batchBufferPointers;
+	std::array<q31_t, FilterBatch::kScratchSize> scratch;
+	uint32_t phases[kBatchSize] = {0, 0x40000000, 0x80000000, 0xC0000000};
+
+	for (int32_t lane = 0; lane < kBatchSize; lane++) {
+		batchSets[lane].reset();
+		scalarSets[lane].reset();
+		batchSetPointers[lane] = &batchSets[lane];
+		batchBufferPointers[lane] = batchBuffers[lane].data();
+	}
+
+	for (int32_t window = 0; window < 16; window++) {
+		fillInput(batchBuffers, phases);
+		scalarBuffers = batchBuffers;
+		for (int32_t lane = 0; lane < kBatchSize; lane++) {
+			configure(batchSets[lane], filterCase, lane);
+			configure(scalarSets[lane], filterCase, lane);
+		}
+
+		uint32_t noiseSeed = jcong;
+		CHECK_TEXT(FilterBatch::renderLong(batchSetPointers, batchBufferPointers, SSI_TX_BUFFER_NUM_SAMPLES, scratch),
+		           filterCase.name);
+		uint32_t noiseAfterBatch = jcong;
+
+		// the ladders draw noise every sample, so the voices take turns a sample at a time as the lanes do
+		jcong = noiseSeed;
+		for (int32_t i = 0; i < SSI_TX_BUFFER_NUM_SAMPLES; i++) {
+			for (int32_t lane = 0; lane < kBatchSize; lane++) {
+				q31_t* sample = &scalarBuffers[lane][i];
+				scalarSets[lane].renderLong(sample, sample + 1, 1);
+			}
+		}
+		CHECK_EQUAL_TEXT(jcong, noiseAfterBatch, filterCase.name);
+
+		int32_t numDifferent = 0;
+		for (int32_t lane = 0; lane < kBatchSize; lane++) {
+			for (int32_t i = 0; i < SSI_TX_BUFFER_NUM_SAMPLES; i++) {
+				numDifferent += batchBuffers[lane][i] != scalarBuffers[lane][i];
+			}
+		}
+		CHECK_EQUAL_TEXT(0, numDifferent, filterCase.name);
+	}
+}
+
+} // namespace
+
+TEST_GROUP(FilterBatch){};
+
+TEST(FilterBatch, matchesScalar) {
+	const FilterCase cases[] = {
+	    {"12dB", FilterMode::TRANSISTOR_12DB, FilterMode::OFF, FilterRoute::HIGH_TO_LOW, 1 << 27},
+	    {"24dB", FilterMode::TRANSISTOR_24DB, FilterMode::OFF, FilterRoute::HIGH_TO_LOW, 1 << 27},
+	    {"24dB resonant", FilterMode::TRANSISTOR_24DB, FilterMode::OFF, FilterRoute::HIGH_TO_LOW, 400000000},
+	    // little enough resonance that the top lane doesn't get oversampled, which batches leave to renderLong()
+	    {"24dBDrive", FilterMode::TRANSISTOR_24DB_DRIVE, FilterMode::OFF, FilterRoute::HIGH_TO_LOW, 0},
+	    {"HPLadder", FilterMode::OFF, FilterMode::HPLADDER, FilterRoute::HIGH_TO_LOW, 1 << 27},
+	    {"HPLadder resonant", FilterMode::OFF, FilterMode::HPLADDER, FilterRoute::HIGH_TO_LOW, 450000000},
+	    {"24dB to HPLadder", FilterMode::TRANSISTOR_24DB, FilterMode::HPLADDER, FilterRoute::LOW_TO_HIGH, 1 << 27},
+	    {"SVF_Band", FilterMode::SVF_BAND, FilterMode::OFF, FilterRoute::HIGH_TO_LOW, 1 << 27},
+	    {"SVF_Band resonant", FilterMode::SVF_BAND, FilterMode::OFF, FilterRoute::HIGH_TO_LOW, 400000000},
+	    {"SVF_Notch", FilterMode::SVF_NOTCH, FilterMode::OFF, FilterRoute::HIGH_TO_LOW, 1 << 27},
+	    {"SVF HPF", FilterMode::OFF, FilterMode::SVF_BAND, FilterRoute::HIGH_TO_LOW, 1 << 27},
+	    {"SVF low to high", FilterMode::SVF_NOTCH, FilterMode::SVF_BAND, FilterRoute::LOW_TO_HIGH, 1 << 27},
+	    {"parallel", FilterMode::SVF_BAND, FilterMode::SVF_NOTCH, FilterRoute::PARALLEL, 1 << 27},
+	    {"parallel ladders", FilterMode::TRANSISTOR_12DB, FilterMode::HPLADDER, FilterRoute::PARALLEL, 1 << 27},
+	};
+	for (const FilterCase& filterCase : cases) {
+		checkBatchMatchesScalar(filterCase);
+	}
+}
+
+TEST(FilterBatch, refusesMismatchedOrFadingSets) {
+	FilterCase svf{"", FilterMode::SVF_BAND, FilterMode::OFF, FilterRoute::HIGH_TO_LOW, 1 << 27};
+	FilterCase notch{"", FilterMode::SVF_NOTCH, FilterMode::OFF, FilterRoute::HIGH_TO_LOW, 1 << 27};
+	FilterCase ladder{"", FilterMode::TRANSISTOR_24DB, FilterMode::OFF, FilterRoute::HIGH_TO_LOW, 1 << 27};
+	// enough resonance that the top lane gets oversampled
+	FilterCase drive{"", FilterMode::TRANSISTOR_24DB_DRIVE, FilterMode::OFF, FilterRoute::HIGH_TO_LOW, 1 << 27};
+	FilterCase off{"", FilterMode::OFF, FilterMode::OFF, FilterRoute::HIGH_TO_LOW, 0};
+
+	std::array<FilterSet, kBatchSize> sets{};
+	std::array<FilterSet*, kBatchSize> setPointers;
+	std::array<std::array<q31_t, SSI_TX_BUFFER_NUM_SAMPLES>, kBatchSize> buffers{};
+	std::array<q31_t*, kBatchSize> bufferPointers;
+	std::array<q31_t, FilterBatch::kScratchSize> scratch;
+	auto renderBatch = [&] {
+		return FilterBatch::renderLong(setPointers, bufferPointers, SSI_TX_BUFFER_NUM_SAMPLES, scratch);
+	};
+	for (int32_t lane = 0; lane < kBatchSize; lane++) {
+		sets[lane].reset();
+		setPointers[lane] = &sets[lane];
+		bufferPointers[lane] = buffers[lane].data();
+		configure(sets[lane], svf, lane);
+	}
+	CHECK(renderBatch());
+
+	configure(sets[2], notch, 2);
+	CHECK_FALSE(renderBatch());
+
+	configure(sets[2], ladder, 2);
+	CHECK_FALSE(renderBatch());
+
+	// the oversampled drive ladder is left to renderLong()
+	for (int32_t lane = 0; lane < kBatchSize; lane++) {
+		configure(sets[lane], drive, lane);
+	}
+	CHECK_FALSE(renderBatch());
+
+	// switching on from off fades the filter in, which batches don't do
+	for (int32_t lane = 0; lane < kBatchSize; lane++) {
+		configure(sets[lane], svf, lane);
+	}
+	configure(sets[2], off, 2);
+	configure(sets[2], svf, 2);
+	CHECK_FALSE(renderBatch());
+	for (int32_t i = 0; i < 8; i++) {
+		q31_t* buffer = buffers[2].data();
+		sets[2].renderLong(buffer, buffer + SSI_TX_BUFFER_NUM_SAMPLES, SSI_TX_BUFFER_NUM_SAMPLES);
+	}
+	CHECK(renderBatch());
+}
@@ -0,0 +1,10 @@
+#include "processing/engines/audio_engine.h"
+
+// The filters read the engine's load estimate to decide whether to oversample. The harness measures the render at
+// full quality, as the firmware does when it isn't struggling.
+int32_t AudioEngine::cpuDireness = 0;
+
+bool AudioEngine::bypassCulling;
+
+void AudioEngine::logAction(char const* string) {
+}
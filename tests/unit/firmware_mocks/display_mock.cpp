@@ -0,0 +1,42 @@
+#include "CppUTest/TestHarness.h"
+#include "hid/display/display.h"
+
+// The song readers and writers keep an OLED refreshed while they work, if there is one. Here there isn't, and the
+// firmware freezing with an error is a failed test.
+
+namespace {
+
+class MockDisplay final : public deluge::hid::Display {
+public:
+	MockDisplay() : deluge::hid::Display(deluge::hid::DisplayType::SEVENSEG) {}
+
+	constexpr size_t getNumBrowserAndMenuLines() override { return 0; }
+	void setText(std::string_view newText, bool alignRight, uint8_t drawDot, bool doBlink, uint8_t* newBlinkMask,
+	             bool blinkImmediately, bool shouldBlinkFast, int32_t scrollPos, uint8_t* blinkAddition,
+	             bool justReplaceBottomLayer) override {}
+	void displayPopup(char const* newText, int8_t numFlashes, bool alignRight, uint8_t drawDot, int32_t blinkSpeed,
+	                  PopupType type) override {}
+	void popupText(char const* text, PopupType type) override {}
+	void popupTextTemporary(char const* text, PopupType type) override {}
+	void cancelPopup() override {}
+	void freezeWithError(char const* text) override { FAIL(text); }
+	bool isLayerCurrentlyOnTop(NumericLayer* layer) override { return false; }
+	void displayError(Error error) override {}
+	void removeWorkingAnimation() override {}
+	void displayLoadingAnimationText(char const* text, bool delayed, bool transparent) override {}
+	void removeLoadingAnimation() override {}
+	bool hasPopup() override { return false; }
+	bool hasPopupOfType(PopupType type) override { return false; }
+	void consoleText(char const* text) override {}
+	void timerRoutine() override {}
+};
+
+MockDisplay mockDisplay;
+
+} // namespace
+
+deluge::hid::Display* display = &mockDisplay;
+
+extern "C" void freezeWithError(char const* error) {
+	display->freezeWithError(error);
+}
@@ -0,0 +1,57 @@
+#include "memory/general_memory_allocator.h"
+#include <cstdlib>
+#include <malloc.h>
+
+// Allocations come from the host's heap. None can be grown or shrunk where they are, so arrays move instead, and
+// ones given static memory up front keep it.
+
+MemoryRegion::MemoryRegion() = default;
+GeneralMemoryAllocator::GeneralMemoryAllocator() = default;
+
+void* GeneralMemoryAllocator::alloc(uint32_t requiredSize, bool mayUseOnChipRam, bool makeStealable,
+                                    void* thingNotToStealFrom) {
+	return malloc(requiredSize);
+}
+
+void GeneralMemoryAllocator::dealloc(void* address) {
+	free(address);
+}
+
+void* GeneralMemoryAllocator::allocExternal(uint32_t requiredSize) {
+	return malloc(requiredSize);
+}
+
+void GeneralMemoryAllocator::deallocExternal(void* address) {
+	free(address);
+}
+
+uint32_t GeneralMemoryAllocator::shortenRight(void* address, uint32_t newSize) {
+	return malloc_usable_size(address);
+}
+
+uint32_t GeneralMemoryAllocator::shortenLeft(void* address, uint32_t amountToShorten,
+                                             uint32_t numBytesToMoveRightIfSuccessful) {
+	return 0;
+}
+
+void GeneralMemoryAllocator::extend(void* address, uint32_t minAmountToExtend, uint32_t idealAmountToExtend,
+                                    uint32_t* getAmountExtendedLeft, uint32_t* getAmountExtendedRight,
+                                    void* thingNotToStealFrom) {
+	*getAmountExtendedLeft = 0;
+	*getAmountExtendedRight = 0;
+}
+
+uint32_t GeneralMemoryAllocator::getAllocatedSize(void* address) {
+	return malloc_usable_size(address);
+}
+
+extern "C" {
+
+void* delugeAlloc(unsigned int requiredSize, bool mayUseOnChipRam) {
+	return GeneralMemoryAllocator::get().alloc(requiredSize, mayUseOnChipRam, false, nullptr);
+}
+
+void delugeDealloc(void* address) {
+	GeneralMemoryAllocator::get().dealloc(address);
+}
+}
@@ -0,0 +1,49 @@
+#include "gui/ui_timer_manager.h"
+#include "processing/engines/audio_engine.h"
+#include "storage/audio/audio_file_manager.h"
+#include "storage/storage_manager.h"
+
+// What the song readers and writers need around them: the Cluster size they read and write in, somewhere for the file
+// they're on, and the routines they keep the rest of the firmware going with while they work - which here there's
+// nothing to do in.
+
+AudioFileManager audioFileManager;
+UITimerManager uiTimerManager;
+struct FileSystemStuff fileSystemStuff {};
+FILINFO staticFNO;
+
+AudioFileManager::AudioFileManager() {
+}
+
+UITimerManager::UITimerManager() {
+}
+
+void UITimerManager::routine() {
+}
+
+void AudioEngine::routineWithClusterLoading(bool mayProcessUserActionsBetween) {
+}
+
+extern "C" void oledRoutine() {
+}
+
+extern "C" void uartFlushIfNotSending(int32_t item) {
+}
+
+StorageManager::StorageManager() {
+}
+
+StorageManager::~StorageManager() {
+}
+
+void StorageManager::openFilePointer(FilePointer* fp) {
+	fileSystemStuff.currentFile.obj.sclust = fp->sclust;
+	fileSystemStuff.currentFile.obj.objsize = fp->objsize;
+	fileSystemStuff.currentFile.obj.fs = &fileSystemStuff.fileSystem;
+	fileSystemStuff.currentFile.obj.id = fileSystemStuff.fileSystem.id;
+
+	fileSystemStuff.currentFile.flag = FA_READ;
+	fileSystemStuff.currentFile.err = 0;
+	fileSystemStuff.currentFile.sect = 0;
+	fileSystemStuff.currentFile.fptr = 0;
+}
@@ -0,0 +1,21 @@
+#include "gui/ui/qwerty_ui.h"
+#include "hid/encoder.h"
+#include "hid/encoders.h"
+
+// Loading from the browser stops if the select encoder's turned or a name's typed, which nothing does here
+
+uint32_t currentUIMode = UI_MODE_NONE;
+
+bool QwertyUI::predictionInterrupted;
+
+namespace deluge::hid::encoders {
+
+Encoder::Encoder() {
+}
+
+Encoder& getEncoder(EncoderName which) {
+	static Encoder encoder;
+	return encoder;
+}
+
+} // namespace deluge::hid::encoders
@@ -0,0 +1,378 @@
+#include "CppUTest/TestHarness.h"
+#include "io/midi/midi_input_queue.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// SSI_TX_BUFFER_NUM_SAMPLES: how far ahead of the DMA the audio routine renders, at most, and so how long after
+// arriving AudioEngine::getTimeDMANextReaches() has a message take effect
+constexpr int32_t kBufferNumSamples = 128;
+
+// MidiEngine::kMaxQueuedInputPerWindow
+constexpr int32_t kMaxPerWindow = 32;
+
+constexpr int32_t kMinWindow = MIDIInputQueue::kMinWindowSamples;
+
+struct Random {
+	uint32_t state;
+	uint32_t next() {
+		state = state * 1664525u + 1013904223u;
+		return state >> 8; // The low bits repeat too soon
+	}
+};
+
+struct NoteEvent {
+	uint32_t arrivalTime; // When the message came in, in samples of real time
+	bool on;
+};
+
+/// Notes one at a time, each held for a while then let go, at times nothing lines up with - never two messages within
+/// a window of each other, so each shows in the output
+std::vector<NoteEvent> makeNotes(int32_t numNotes, uint32_t seed) {
+	Random random{seed};
+	std::vector<NoteEvent> events;
+	uint32_t time = 1000;
+	for (int32_t n = 0; n < numNotes; n++) {
+		time += 2 * kBufferNumSamples + random.next() % 3000;
+		events.push_back({time, true});
+		time += 2 * kBufferNumSamples + random.next() % 2000;
+		events.push_back({time, false});
+	}
+	return events;
+}
+
+struct Latency {
+	double mean;
+	double standardDeviation;
+	int32_t min;
+	int32_t max;
+};
+
+/*
+ * Runs the audio routine over the events and returns what came out: how many notes were sounding at each sample.
+ *
+ * Each window of audio gets rendered just in time for the DMA, some varying number of samples after the one before, as
+ * AudioEngine::routine_() does when the CPU load varies. Before each, the messages that have arrived by then are
+ * polled, as checkIncomingUsbMidi() and checkIncomingSerialMidi() do. Without the queue, they take effect at the start
+ * of that window. With it, they go in timed one buffer after they arrived, and windows get cut short to fit them - but
+ * not shorter than kMinWindowSamples, so a note can land a little later than that.
+ */
+std::vector<uint8_t> render(std::vector<NoteEvent> const& events, bool useQueue, uint32_t seed) {
+	Random random{seed};
+	MIDIInputQueue queue;
+	std::vector<uint8_t> output(events.back().arrivalTime + 4 * kBufferNumSamples);
+	uint32_t numNotesOn = 0;
+	size_t nextEvent = 0;
+
+	auto noteReceived = [&](bool on) { numNotesOn += on ? 1 : -1; };
+
+	uint32_t time = 0;
+	while (time + kBufferNumSamples < output.size()) {
+		size_t numSamples = 4 + (random.next() % (kBufferNumSamples / 4)) * 4;
+		uint32_t timeNow = time + numSamples - kBufferNumSamples; // Where the DMA's got to, in real time
+
+		for (; nextEvent < events.size() && (int32_t)(events[nextEvent].arrivalTime - timeNow) <= 0; nextEvent++) {
+			NoteEvent const& event = events[nextEvent];
+			if (!useQueue) {
+				noteReceived(event.on);
+			}
+			else {
+				TimestampedMIDIMessage message{event.arrivalTime + kBufferNumSamples, nullptr, 0x09, 0, 60,
+				                               (uint8_t)(event.on ? 100 : 0)};
+				CHECK(queue.push(message));
+			}
+		}
+
+		if (useQueue) {
+			queue.takeDue(time, numSamples, kMaxPerWindow, [&](TimestampedMIDIMessage const& message) {
+				CHECK((int32_t)(message.time - time) <= 0);
+				noteReceived(message.data2);
+			});
+		}
+
+		for (size_t i = 0; i < numSamples; i++) {
+			output[time + i] = numNotesOn;
+		}
+		time += numSamples;
+	}
+	return output;
+}
+
+/// From where each note starts and stops in the output, how long after it arrived each message took effect
+Latency measure(std::vector<NoteEvent> const& events, std::vector<uint8_t> const& output) {
+	std::vector<int32_t> latencies;
+	size_t e = 0;
+	for (size_t i = 1; i < output.size() && e < events.size(); i++) {
+		if (output[i] != output[i - 1]) {
+			CHECK_EQUAL(events[e].on, output[i] > output[i - 1]);
+			latencies.push_back((int32_t)(i - events[e].arrivalTime));
+			e++;
+		}
+	}
+	CHECK_EQUAL(events.size(), latencies.size());
+
+	Latency latency{0, 0, INT32_MAX, INT32_MIN};
+	for (int32_t l : latencies) {
+		latency.mean += l;
+		latency.min = std::min(latency.min, l);
+		latency.max = std::max(latency.max, l);
+	}
+	latency.mean /= latencies.size();
+	for (int32_t l : latencies) {
+		latency.standardDeviation += (l - latency.mean) * (l - latency.mean);
+	}
+	latency.standardDeviation = std::sqrt(latency.standardDeviation / latencies.size());
+	return latency;
+}
+
+} // namespace
+
+TEST_GROUP(MIDIInputQueue){};
+
+// Only what's due comes off, in order, and the window stops where the next note's due, but not too soon
+TEST(MIDIInputQueue, takesWhatsDue) {
+	MIDIInputQueue queue;
+	CHECK(queue.isEmpty());
+	for (uint32_t time : {100u, 100u, 130u, 500u}) {
+		CHECK(queue.push({time, nullptr, 0x09, 0, 60, (uint8_t)time}));
+	}
+
+	std::vector<uint32_t> taken;
+	auto take = [&](TimestampedMIDIMessage const& message) { taken.push_back(message.time); };
+
+	size_t numSamples = 64;
+	queue.takeDue(60, numSamples, kMaxPerWindow, take);
+	CHECK_EQUAL(0, taken.size());
+	CHECK_EQUAL(40, numSamples);
+
+	numSamples = 64;
+	queue.takeDue(90, numSamples, kMaxPerWindow, take);
+	CHECK_EQUAL(0, taken.size());
+	CHECK_EQUAL(kMinWindow, numSamples);
+
+	numSamples = 64;
+	queue.takeDue(100, numSamples, kMaxPerWindow, take);
+	CHECK_EQUAL(2, taken.size());
+	CHECK_EQUAL(kMinWindow, numSamples);
+
+	// A window that's already short stays that way
+	numSamples = 8;
+	queue.takeDue(100, numSamples, kMaxPerWindow, take);
+	CHECK_EQUAL(8, numSamples);
+
+	// Late, so straight away, and nothing to cut the window short for
+	numSamples = 64;
+	queue.takeDue(200, numSamples, kMaxPerWindow, take);
+	CHECK_EQUAL(3, taken.size());
+	CHECK_EQUAL(64, numSamples);
+
+	numSamples = 64;
+	queue.takeDue(500, numSamples, kMaxPerWindow, take);
+	CHECK_EQUAL(4, taken.size());
+	CHECK(queue.isEmpty());
+
+	// Right across audioSampleTimer wrapping round
+	CHECK(queue.push({0xFFFFFFF0u, nullptr, 0x09, 0, 60, 100}));
+	CHECK(queue.push({0x10u, nullptr, 0x08, 0, 60, 64}));
+	numSamples = 64;
+	queue.takeDue(0xFFFFFFF0u, numSamples, kMaxPerWindow, take);
+	CHECK_EQUAL(5, taken.size());
+	CHECK_EQUAL(32, numSamples);
+	numSamples = 64;
+	queue.takeDue(0x10u, numSamples, kMaxPerWindow, take);
+	CHECK_EQUAL(6, taken.size());
+	CHECK_EQUAL(64, numSamples);
+	CHECK(queue.isEmpty());
+}
+
+// CCs due before the window ends all come off before it rather than cutting it short, unless there's a note first
+TEST(MIDIInputQueue, ccsGoInWithTheirWindow) {
+	MIDIInputQueue queue;
+	for (uint32_t time : {110u, 120u, 150u, 170u, 175u, 300u}) {
+		uint8_t statusType = (time == 150) ? 0x09 : 0x0B;
+		CHECK(queue.push({time, nullptr, statusType, 0, 1, 0}));
+	}
+
+	std::vector<uint32_t> taken;
+	auto take = [&](TimestampedMIDIMessage const& message) { taken.push_back(message.time); };
+
+	size_t numSamples = 128;
+	queue.takeDue(100, numSamples, kMaxPerWindow, take);
+	CHECK((taken == std::vector<uint32_t>{110, 120}));
+	CHECK_EQUAL(50, numSamples);
+
+	numSamples = 128;
+	queue.takeDue(150, numSamples, kMaxPerWindow, take);
+	CHECK((taken == std::vector<uint32_t>{110, 120, 150, 170, 175}));
+	CHECK_EQUAL(128, numSamples);
+}
+
+// No more than the most per window come off before it, however many are due, and the rest come off before the next
+TEST(MIDIInputQueue, boundedPerWindow) {
+	MIDIInputQueue queue;
+	for (uint32_t i = 0; i < kMaxPerWindow + 4; i++) {
+		CHECK(queue.push({100, nullptr, 0x09, 0, (uint8_t)(60 + i), 100}));
+	}
+	CHECK(queue.push({150, nullptr, 0x08, 0, 60, 64}));
+
+	int32_t numTaken = 0;
+	auto take = [&](TimestampedMIDIMessage const&) { numTaken++; };
+	size_t numSamples = 64;
+	queue.takeDue(100, numSamples, kMaxPerWindow, take);
+	CHECK_EQUAL(kMaxPerWindow, numTaken);
+	CHECK_EQUAL(64, numSamples);
+
+	queue.takeDue(164, numSamples, kMaxPerWindow, take);
+	CHECK_EQUAL(kMaxPerWindow + 5, numTaken);
+	CHECK(queue.isEmpty());
+}
+
+// Everything comes off in order, due or not, to be acted on ahead of a message that can't wait
+TEST(MIDIInputQueue, takesAll) {
+	MIDIInputQueue queue;
+	for (uint32_t time : {100u, 5000u, 90000u}) {
+		CHECK(queue.push({time, nullptr, 0x0B, 0, 1, 0}));
+	}
+	std::vector<uint32_t> taken;
+	queue.takeAll([&](TimestampedMIDIMessage const& message) { taken.push_back(message.time); });
+	CHECK((taken == std::vector<uint32_t>{100, 5000, 90000}));
+	CHECK(queue.isEmpty());
+}
+
+// Full is full, until something comes off
+TEST(MIDIInputQueue, refusesWhenFull) {
+	MIDIInputQueue queue;
+	for (uint32_t i = 0; i < MIDIInputQueue::kCapacity; i++) {
+		CHECK(queue.push({i, nullptr, 0x09, 0, 60, 100}));
+	}
+	CHECK(!queue.push({0, nullptr, 0x09, 0, 60, 100}));
+
+	size_t numSamples = 64;
+	int32_t numTaken = 0;
+	queue.takeDue(0, numSamples, kMaxPerWindow, [&](TimestampedMIDIMessage const&) { numTaken++; });
+	CHECK_EQUAL(1, numTaken);
+	CHECK(queue.push({MIDIInputQueue::kCapacity, nullptr, 0x09, 0, 60, 100}));
+}
+
+// Received on one thread and taken off on another, as if by an ISR and the audio routine, nothing's lost or reordered
+TEST(MIDIInputQueue, oneThreadInOneOut) {
+	constexpr uint32_t kNumMessages = 200000;
+	MIDIInputQueue queue;
+
+	std::thread receiver([&] {
+		for (uint32_t i = 0; i < kNumMessages;) {
+			if (queue.push({i, nullptr, 0x0B, (uint8_t)(i & 15), (uint8_t)((i >> 4) & 127), (uint8_t)(i >> 11)})) {
+				i++;
+			}
+			else {
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	uint32_t numTaken = 0;
+	bool allInOrder = true;
+	while (numTaken < kNumMessages) {
+		size_t numSamples = 128;
+		queue.takeDue(0x7FFFFFFF, numSamples, kMaxPerWindow, [&](TimestampedMIDIMessage const& message) {
+			uint32_t i = numTaken++;
+			allInOrder &= message.time == i && message.channel == (i & 15) && message.data1 == ((i >> 4) & 127)
+			              && message.data2 == (uint8_t)(i >> 11);
+		});
+	}
+	receiver.join();
+
+	CHECK(allInOrder);
+	CHECK_EQUAL(kNumMessages, numTaken);
+	CHECK(queue.isEmpty());
+}
+
+// Notes arriving at known times, rendered by windows of varying length: how long after arriving each starts or stops
+// in the output, acted on at the start of whichever window comes next as before, or when the queue says
+TEST(MIDIInputQueue, renderedJitter) {
+	std::vector<NoteEvent> events = makeNotes(2000, 31337);
+
+	Latency atWindowStart = measure(events, render(events, false, 2024));
+	Latency queued = measure(events, render(events, true, 2024));
+
+	// One buffer later, or a little more where a window would have been too short
+	CHECK_EQUAL(kBufferNumSamples, queued.min);
+	CHECK(queued.max < kBufferNumSamples + kMinWindow);
+	CHECK(atWindowStart.max - atWindowStart.min > kBufferNumSamples / 2);
+
+	printf("\n%zu note messages, windows of 4 to %d samples\n", events.size(), kBufferNumSamples);
+	printf("%16s %14s %14s %14s %14s\n", "", "mean latency", "std dev", "min", "max");
+	for (auto [name, latency] : {std::pair{"window start", atWindowStart}, std::pair{"queued", queued}}) {
+		printf("%16s %14.1f %14.2f %14d %14d\n", name, latency.mean, latency.standardDeviation, latency.min,
+		       latency.max);
+	}
+}
+
+// A fader bank sending 10k CCs a second, with notes among them, into windows the audio routine asks for at full
+// length: how many windows that gets broken into, and how far from due each CC takes effect
+TEST(MIDIInputQueue, ccFlood) {
+	constexpr uint32_t kNumSamples = 44100;
+	constexpr double kSamplesPerCC = 44100.0 / 10000;
+	constexpr uint32_t kSamplesPerNote = 1000;
+
+	std::vector<TimestampedMIDIMessage> messages;
+	double ccTime = 0;
+	uint32_t noteTime = 0;
+	while (ccTime < kNumSamples) {
+		if (noteTime <= ccTime) {
+			messages.push_back({noteTime + kBufferNumSamples, nullptr, 0x09, 0, 60, 100});
+			noteTime += kSamplesPerNote;
+		}
+		else {
+			uint8_t controller = messages.size() % 64;
+			messages.push_back({(uint32_t)ccTime + kBufferNumSamples, nullptr, 0x0B, 1, controller, 64});
+			ccTime += kSamplesPerCC;
+		}
+	}
+
+	MIDIInputQueue queue;
+	size_t nextMessage = 0;
+	uint32_t time = 0;
+	int32_t numWindows = 0;
+	int32_t numCut = 0;
+	size_t shortestCut = kBufferNumSamples;
+	int32_t mostEarly = 0;
+	int32_t mostLate = 0;
+	size_t numTaken = 0;
+	while (time < kNumSamples) {
+		for (; nextMessage < messages.size() && messages[nextMessage].time <= time + kBufferNumSamples; nextMessage++) {
+			CHECK(queue.push(messages[nextMessage]));
+		}
+		size_t numSamples = kBufferNumSamples;
+		queue.takeDue(time, numSamples, kMaxPerWindow, [&](TimestampedMIDIMessage const& message) {
+			int32_t late = time - message.time;
+			mostEarly = std::max(mostEarly, -late);
+			mostLate = std::max(mostLate, late);
+			numTaken++;
+		});
+		if (numSamples < kBufferNumSamples) {
+			numCut++;
+			shortestCut = std::min(shortestCut, numSamples);
+		}
+		numWindows++;
+		time += numSamples;
+	}
+
+	// Only the notes cut windows, never shorter than the minimum, and no CC goes in more than a window early
+	CHECK(numCut <= (int32_t)(kNumSamples / kSamplesPerNote) + 1);
+	CHECK(shortestCut >= kMinWindow);
+	CHECK(numWindows <= (int32_t)(kNumSamples / kBufferNumSamples + 2 * numCut) + 1);
+	CHECK(mostEarly < kBufferNumSamples);
+	CHECK(mostLate == 0);
+	CHECK(numTaken >= nextMessage - kMaxPerWindow);
+
+	printf("\n%zu messages in %u samples, %u of them notes, into windows of %d\n", messages.size(), kNumSamples,
+	       kNumSamples / kSamplesPerNote, kBufferNumSamples);
+	printf("windows: %d, cut short: %d, shortest: %zu, CCs in up to %d samples early\n", numWindows, numCut,
+	       shortestCut, mostEarly);
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright © 2024 Synthstrom Audible Limited
+ *
+ * This file is part of The Synthstrom Audible Deluge Firmware.
+ *
+ * The Synthstrom Audible Deluge Firmware is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program.
+ * If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "dsp/mod_fx/mod_fx.h"
+#include "util/waves.h"
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <span>
+#include <vector>
+
+// The mod FX rendered in blocks and by the sample-at-a-time reference side by side, for the tests that check they agree
+// and the benchmarks that time them
+
+namespace deluge::dsp::mod_fx::test {
+
+/// What a ModControllableAudio keeps for its mod FX between buffers
+struct ModFXState {
+	std::array<StereoSample, kModFXBufferSize> buffer{};
+	uint16_t writeIndex = 0;
+	LFO lfo{};
+	StereoSample phaserMemory{};
+	std::array<StereoSample, kNumAllpassFiltersPhaser> allpassMemory{};
+
+	bool operator==(ModFXState const& other) const {
+		auto same = [](StereoSample const& a, StereoSample const& b) { return a.l == b.l && a.r == b.r; };
+		return std::equal(buffer.begin(), buffer.end(), other.buffer.begin(), same) && writeIndex == other.writeIndex
+		       && lfo.phase == other.lfo.phase && same(phaserMemory, other.phaserMemory)
+		       && std::equal(allpassMemory.begin(), allpassMemory.end(), other.allpassMemory.begin(), same);
+	}
+};
+
+/// Everything processFX() works out for one of the effects before rendering it
+struct Setting {
+	ModFXType type;
+	DelayParams delay;
+	PhaserParams phaser;
+};
+
+/// The chorus's offset and depth as processFX() works them out from the offset and depth params
+inline DelayParams chorus(int32_t offsetParam, int32_t modFXDepth, uint32_t rate) {
+	int32_t offset = multiply_32x32_rshift32(kModFXMaxDelay, (offsetParam >> 1) + 1073741824);
+	return {offset, multiply_32x32_rshift32(offset, modFXDepth) << 2, 0, rate};
+}
+
+inline const Setting kSettings[] = {
+    {ModFXType::CHORUS, chorus(0, 1 << 29, 1 << 20), {}},
+    {ModFXType::CHORUS, chorus(INT32_MAX, INT32_MAX >> 1, 1 << 24), {}},
+    // Offset all the way down, so the delay's close enough to the write position that blocks can't be done in lanes
+    {ModFXType::CHORUS, chorus(INT32_MIN, INT32_MAX, 1 << 22), {}},
+    {ModFXType::CHORUS_STEREO, chorus(0, 1 << 29, 1 << 20), {}},
+    {ModFXType::CHORUS_STEREO, chorus(INT32_MIN, INT32_MAX, 3 << 23), {}},
+    {ModFXType::FLANGER, {kFlangerOffset, kFlangerAmplitude, 1 << 30, 1 << 21}, {}},
+    {ModFXType::FLANGER, {kFlangerOffset, kFlangerAmplitude, -1900000000, 1 << 25}, {}},
+    {ModFXType::PHASER, {}, {1 << 29, 1 << 30, 1 << 21}},
+    {ModFXType::PHASER, {}, {INT32_MAX, -1900000000, 1 << 25}},
+};
+
+/// Renders one effect the two ways, a window at a time
+class Comparison {
+public:
+	explicit Comparison(Setting const& setting) : setting_(setting) {
+		// Somewhere other than the start, so the block path's writes wrap round the buffer part way through a block
+		reference_->writeIndex = kModFXBufferSize - 3;
+		reference_->lfo.phase = 0x9e3779b9;
+		*block_ = *reference_;
+	}
+
+	/// The number of samples of audio that came out differently
+	int32_t render(std::vector<StereoSample> const& input, size_t windowSize) {
+		int32_t numDifferent = 0;
+		for (size_t start = 0; start < input.size(); start += windowSize) {
+			size_t numSamples = std::min(windowSize, input.size() - start);
+			std::vector<StereoSample> referenceAudio(input.begin() + start, input.begin() + start + numSamples);
+			std::vector<StereoSample> blockAudio = referenceAudio;
+			renderReference(referenceAudio);
+			renderBlock(blockAudio);
+			for (size_t i = 0; i < numSamples; i++) {
+				numDifferent += (referenceAudio[i].l != blockAudio[i].l) || (referenceAudio[i].r != blockAudio[i].r);
+			}
+		}
+		return numDifferent;
+	}
+
+	[[nodiscard]] bool sameState() const { return *reference_ == *block_; }
+
+	void renderReference(std::span<StereoSample> audio) {
+		ModFXState& state = *reference_;
+		if (setting_.type == ModFXType::PHASER) {
+			renderPhaserReference(audio, {state.phaserMemory, state.allpassMemory}, state.lfo, setting_.phaser);
+		}
+		else {
+			renderDelayReference(setting_.type, audio, {state.buffer.data(), state.writeIndex}, state.lfo,
+			                     setting_.delay);
+		}
+	}
+
+	void renderBlock(std::span<StereoSample> audio) {
+		ModFXState& state = *block_;
+		if (setting_.type == ModFXType::PHASER) {
+			renderPhaser(audio, {state.phaserMemory, state.allpassMemory}, state.lfo, setting_.phaser);
+		}
+		else {
+			renderDelay(setting_.type, audio, {state.buffer.data(), state.writeIndex}, state.lfo, setting_.delay);
+		}
+	}
+
+private:
+	Setting setting_;
+	std::unique_ptr<ModFXState> reference_ = std::make_unique<ModFXState>();
+	std::unique_ptr<ModFXState> block_ = std::make_unique<ModFXState>();
+};
+
+inline std::vector<StereoSample> makeNoise(size_t numSamples) {
+	std::vector<StereoSample> noise(numSamples);
+	for (StereoSample& sample : noise) {
+		sample.l = getNoise() >> 3;
+		sample.r = getNoise() >> 3;
+	}
+	return noise;
+}
+
+} // namespace deluge::dsp::mod_fx::test
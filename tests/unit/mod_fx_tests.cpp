@@ -0,0 +1,31 @@
+#include "CppUTest/TestHarness.h"
+#include "mod_fx_comparison.h"
+#include <vector>
+
+using namespace deluge::dsp::mod_fx;
+using namespace deluge::dsp::mod_fx::test;
+
+TEST_GROUP(ModFX){};
+
+// Each effect across its range, in windows that don't divide into blocks, leaves the audio, the delay buffer, the LFO
+// and the phaser's filters as the reference does
+TEST(ModFX, blockMatchesReference) {
+	std::vector<StereoSample> noise = makeNoise(kSampleRate / 4);
+	for (Setting const& setting : kSettings) {
+		for (size_t windowSize : {1, 3, 7, 64, 100, 128, 201}) {
+			Comparison comparison(setting);
+			CHECK_EQUAL(0, comparison.render(noise, windowSize));
+			CHECK(comparison.sameState());
+		}
+	}
+}
+
+// An impulse through the flanger at full feedback goes round the buffer many times, through every delay time its sweep
+// covers - down to the few samples where the block path has to go a sample at a time
+TEST(ModFX, flangerImpulseMatchesReference) {
+	std::vector<StereoSample> impulse(kSampleRate * 2);
+	impulse[0] = {ONE_Q31 >> 2, ONE_Q31 >> 3};
+	Comparison comparison({ModFXType::FLANGER, {kFlangerOffset, kFlangerAmplitude, INT32_MAX, 1 << 23}, {}});
+	CHECK_EQUAL(0, comparison.render(impulse, SSI_TX_BUFFER_NUM_SAMPLES));
+	CHECK(comparison.sameState());
+}
@@ -0,0 +1,292 @@
+#include "CppUTest/TestHarness.h"
+#include "arm_neon_shim.h"
+#include "definitions_cxx.hpp"
+#include "processing/render_wave.h"
+#include "util/fixedpoint.h"
+#include "util/lookuptables/lookuptables.h"
+#include <array>
+#include <cstdint>
+#include <limits>
+
+// Golden tests for the NEON kernels. Each kernel is run through the portable intrinsics and compared against a plain
+// scalar model of what the instructions do on the hardware, so the kernels can be refactored with confidence.
+
+namespace {
+
+CREATE_WAVE_RENDER_FUNCTION_INSTANCE(renderWaveUnderTest, waveRenderingFunctionGeneral);
+CREATE_WAVE_RENDER_FUNCTION_INSTANCE(renderPulseWaveUnderTest, waveRenderingFunctionPulse);
+
+constexpr int32_t kTableSizeMagnitude = 8;
+constexpr int32_t kNumSamples = 64;
+
+int32_t sat32(int64_t value) {
+	return std::clamp<int64_t>(value, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max());
+}
+
+int16_t sat16(int32_t value) {
+	return std::clamp<int32_t>(value, std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max());
+}
+
+// a band-limited-ish ramp with some full scale values so the saturating paths get exercised
+std::array<int16_t, (1 << kTableSizeMagnitude) + 1> makeTable() {
+	std::array<int16_t, (1 << kTableSizeMagnitude) + 1> table;
+	for (size_t i = 0; i < table.size(); i++) {
+		table[i] = (i % 64 == 0) ? -32768 : (i % 32 == 0) ? 32767 : (int16_t)(i * 251 - 32000);
+	}
+	return table;
+}
+
+// scalar model of one amplitude lane, see SETUP_FOR_APPLYING_AMPLITUDE_WITH_VECTORS
+struct AmplitudeModel {
+	std::array<int32_t, 4> lanes;
+	int32_t increment;
+	AmplitudeModel(int32_t amplitude, int32_t amplitudeIncrement) : increment(amplitudeIncrement << 1) {
+		for (int32_t i = 0; i < 4; i++) {
+			amplitude += amplitudeIncrement;
+			lanes[i] = amplitude >> 1;
+		}
+	}
+	int32_t apply(int32_t lane, int32_t value, int32_t existing) {
+		int32_t out = sat32(((int64_t)lanes[lane] * value) >> 31) + existing;
+		if (lane == 3) {
+			for (auto& l : lanes) {
+				l = (int32_t)((uint32_t)l + (uint32_t)increment);
+			}
+		}
+		return out;
+	}
+};
+
+int32_t modelGeneralWave(const int16_t* table, uint32_t phase) {
+	uint16_t strength2 = (uint16_t)(phase >> (32 - 16 - kTableSizeMagnitude)) >> 1;
+	uint32_t whichValue = phase >> (32 - kTableSizeMagnitude);
+	int16_t value1 = table[whichValue];
+	int16_t value2 = table[whichValue + 1];
+	int16_t difference = (int16_t)(value2 - value1);
+	return sat32(((int64_t)value1 << 16) + sat32(2 * (int64_t)difference * (int16_t)strength2));
+}
+
+int32_t modelPulseWave(const int16_t* table, uint32_t phase, uint32_t phaseToAdd) {
+	int32_t rshiftAmount = 32 - kTableSizeMagnitude - 16;
+	auto read = [&](uint32_t p, int16_t& v1, int16_t& v2) {
+		uint32_t whichValue = p >> (32 - kTableSizeMagnitude);
+		v1 = table[whichValue];
+		v2 = table[whichValue + 1];
+	};
+	int16_t a1, a2, b1, b2;
+	read(phase, a1, a2);
+	read(phase + phaseToAdd, b1, b2);
+
+	int16_t rshiftedA = (int16_t)(phase >> rshiftAmount);
+	int16_t strengthA1 = rshiftedA | (int16_t)-32768;
+	int16_t strengthA2 = (int16_t)(-32768 - strengthA1);
+	int32_t outputA = sat32((int64_t)sat32(2 * (int64_t)strengthA2 * a2) + sat32(2 * (int64_t)strengthA1 * a1));
+
+	int16_t rshiftedB = (int16_t)((phase + phaseToAdd) >> rshiftAmount);
+	int16_t strengthB2 = rshiftedB & 32767;
+	int16_t strengthB1 = (int16_t)(32767 - strengthB2);
+	int32_t outputB = sat32((int64_t)sat32(2 * (int64_t)strengthB2 * b2) + sat32(2 * (int64_t)strengthB1 * b1));
+
+	int32_t output = sat32(((int64_t)outputA * outputB + (1ll << 30)) >> 31);
+	return (int32_t)((uint32_t)output << 1);
+}
+
+} // namespace
+
+TEST_GROUP(PortableNeon){};
+
+TEST(PortableNeon, doublingMultiplyHighSaturates) {
+	int32x4_t a = {INT32_MIN, INT32_MIN, INT32_MAX, -3};
+	int32x4_t b = {INT32_MIN, INT32_MAX, INT32_MAX, 1 << 30};
+	int32x4_t out = vqdmulhq_s32(a, b);
+	CHECK_EQUAL(INT32_MAX, out[0]);
+	CHECK_EQUAL(-INT32_MAX, out[1]);
+	CHECK_EQUAL(INT32_MAX - 1, out[2]);
+	// truncates towards minus infinity
+	CHECK_EQUAL(-2, out[3]);
+}
+
+TEST(PortableNeon, roundingDoublingMultiplyHighRounds) {
+	int32x4_t a = {INT32_MIN, -3, 3, 1 << 30};
+	int32x4_t b = {INT32_MIN, 1 << 30, 1 << 30, 1 << 30};
+	int32x4_t out = vqrdmulhq_s32(a, b);
+	CHECK_EQUAL(INT32_MAX, out[0]);
+	CHECK_EQUAL(-1, out[1]);
+	CHECK_EQUAL(2, out[2]);
+	CHECK_EQUAL(1 << 29, out[3]);
+}
+
+TEST(PortableNeon, saturatingMultiplyAccumulateLong) {
+	int16x4_t a = {-32768, 32767, -32768, 2};
+	int16x4_t b = {-32768, 32767, 1, 3};
+	int32x4_t acc = {0, INT32_MAX, INT32_MIN, 10};
+	int32x4_t out = vqdmlal_s16(acc, a, b);
+	// the product saturates on its own before accumulating
+	CHECK_EQUAL(INT32_MAX, out[0]);
+	CHECK_EQUAL(INT32_MAX, out[1]);
+	CHECK_EQUAL(INT32_MIN, out[2]);
+	CHECK_EQUAL(22, out[3]);
+}
+
+TEST(PortableNeon, narrowingAndWideningShifts) {
+	uint32x4_t wide = {0x12345678, 0xFFFFFFFF, 0x00018000, 0x80000000};
+	uint16x4_t low = vmovn_u32(wide);
+	uint16x4_t high = vshrn_n_u32(wide, 16);
+	CHECK_EQUAL(0x5678, low[0]);
+	CHECK_EQUAL(0x1234, high[0]);
+	CHECK_EQUAL(0xFFFF, high[1]);
+	CHECK_EQUAL(0x8000, low[2]);
+	CHECK_EQUAL(0x8000, high[3]);
+
+	int32x4_t widened = vshll_n_s16(int16x4_t{-1, 1, -32768, 32767}, 16);
+	CHECK_EQUAL(-65536, widened[0]);
+	CHECK_EQUAL(65536, widened[1]);
+	CHECK_EQUAL(INT32_MIN, widened[2]);
+	CHECK_EQUAL(32767 << 16, widened[3]);
+}
+
+TEST(PortableNeon, deinterleavingLoad) {
+	std::array<int16_t, 32> data;
+	for (int16_t i = 0; i < 32; i++) {
+		data[i] = i;
+	}
+	int16x8x4_t out = vld4q_s16(data.data());
+	for (int32_t j = 0; j < 4; j++) {
+		for (int32_t i = 0; i < 8; i++) {
+			CHECK_EQUAL(i * 4 + j, out.val[j][i]);
+		}
+	}
+}
+
+TEST(PortableNeon, fixedPointMatchesArm) {
+	// smmulr rounds, smmul truncates
+	CHECK_EQUAL(-1, multiply_32x32_rshift32(-3, 1 << 30));
+	CHECK_EQUAL(-1, multiply_32x32_rshift32_rounded(-3, 1 << 30));
+	CHECK_EQUAL(0, multiply_32x32_rshift32_rounded(-1, 1 << 30));
+	CHECK_EQUAL(1, multiply_32x32_rshift32_rounded(3, 1 << 30));
+	CHECK_EQUAL(101, multiply_accumulate_32x32_rshift32_rounded(100, 3, 1 << 30));
+	CHECK_EQUAL(99, multiply_subtract_32x32_rshift32_rounded(100, 3, 1 << 30));
+	// the accumulate wraps rather than saturating
+	CHECK_EQUAL(INT32_MIN, multiply_accumulate_32x32_rshift32_rounded(INT32_MAX, 1 << 30, 4));
+
+	CHECK_EQUAL((1 << 21) - 1, signed_saturate<22>(1 << 30));
+	CHECK_EQUAL(-(1 << 21), signed_saturate<22>(-(1 << 30)));
+	CHECK_EQUAL(12345, signed_saturate<22>(12345));
+	CHECK_EQUAL(INT32_MAX, add_saturation(INT32_MAX, 1));
+	CHECK_EQUAL(INT32_MIN, add_saturation(INT32_MIN, -1));
+	CHECK_EQUAL(32, clz(0));
+}
+
+TEST_GROUP(WaveRenderKernels){};
+
+TEST(WaveRenderKernels, generalWaveMatchesScalarModel) {
+	auto table = makeTable();
+	constexpr uint32_t phaseIncrement = 0x01234567;
+	constexpr uint32_t startPhase = 0x89ABCDEF;
+
+	std::array<int32_t, kNumSamples> output{};
+	renderWaveUnderTest(table.data(), kTableSizeMagnitude, 0, output.data(), output.data() + kNumSamples,
+	                    phaseIncrement, startPhase, false, 0, 0);
+
+	uint32_t phase = startPhase;
+	for (int32_t i = 0; i < kNumSamples; i++) {
+		phase += phaseIncrement;
+		CHECK_EQUAL(modelGeneralWave(table.data(), phase), output[i]);
+	}
+}
+
+TEST(WaveRenderKernels, generalWaveAppliesAmplitude) {
+	auto table = makeTable();
+	constexpr uint32_t phaseIncrement = 0x00F0F0F0;
+	// amplitude and increment are pre-shifted by the caller, see CREATE_WAVE_RENDER_FUNCTION_INSTANCE
+	constexpr int32_t amplitude = 0x30000000 << 1;
+	constexpr int32_t amplitudeIncrement = -4096 << 1;
+
+	std::array<int32_t, kNumSamples> output;
+	for (int32_t i = 0; i < kNumSamples; i++) {
+		output[i] = i * 1000;
+	}
+	renderWaveUnderTest(table.data(), kTableSizeMagnitude, amplitude, output.data(), output.data() + kNumSamples,
+	                    phaseIncrement, 0, true, 0, amplitudeIncrement);
+
+	AmplitudeModel model(amplitude, amplitudeIncrement);
+	uint32_t phase = 0;
+	for (int32_t i = 0; i < kNumSamples; i++) {
+		phase += phaseIncrement;
+		CHECK_EQUAL(model.apply(i & 3, modelGeneralWave(table.data(), phase), i * 1000), output[i]);
+	}
+}
+
+TEST(WaveRenderKernels, constantTableIsExact) {
+	std::array<int16_t, (1 << kTableSizeMagnitude) + 1> table;
+	table.fill(1000);
+	std::array<int32_t, kNumSamples> output{};
+	renderWaveUnderTest(table.data(), kTableSizeMagnitude, 0, output.data(), output.data() + kNumSamples, 0x1000000,
+	                    0, false, 0, 0);
+	for (int32_t value : output) {
+		CHECK_EQUAL(1000 << 16, value);
+	}
+}
+
+TEST(WaveRenderKernels, pulseWaveMatchesScalarModel) {
+	auto table = makeTable();
+	constexpr uint32_t phaseIncrement = 0x00987654;
+	constexpr uint32_t phaseToAdd = 0x60000000;
+
+	std::array<int32_t, kNumSamples> output{};
+	renderPulseWaveUnderTest(table.data(), kTableSizeMagnitude, 0, output.data(), output.data() + kNumSamples,
+	                         phaseIncrement, 0x12345678, false, phaseToAdd, 0);
+
+	uint32_t phase = 0x12345678;
+	for (int32_t i = 0; i < kNumSamples; i++) {
+		phase += phaseIncrement;
+		CHECK_EQUAL(modelPulseWave(table.data(), phase, phaseToAdd), output[i]);
+	}
+}
+
+// The windowed sinc kernel is a code fragment which expects to be pasted into SampleLowLevelReader::interpolate, so
+// give it the same surroundings here. Keep this last in the file, it defines macros that clash with the wave renderers.
+namespace {
+using InterpolationBuffer = int16x4_t[2][kInterpolationMaxNumSamples >> 2];
+
+void interpolateUnderTest(int32_t* __restrict__ sampleRead, int32_t numChannelsNow, int32_t whichKernel,
+                          uint32_t oscPos, InterpolationBuffer& interpolationBuffer) {
+#include "dsp/interpolation/interpolate.h"
+}
+#undef numBitsInTableSize
+#undef rshiftAmount
+
+int32_t modelInterpolate(const int16_t* buffer, int32_t whichKernel, uint32_t oscPos) {
+	int16_t strength2 = (int16_t)((oscPos >> 5) & 32767);
+	int32_t progressSmall = oscPos >> 20;
+	int32_t sum = 0;
+	for (int32_t j = 0; j < kInterpolationMaxNumSamples; j++) {
+		int16_t value1 = windowedSincKernel[whichKernel][progressSmall][j];
+		int16_t value2 = windowedSincKernel[whichKernel][progressSmall + 1][j];
+		int16_t difference = (int16_t)(value2 - value1);
+		int16_t kernel = (int16_t)(value1 + sat16(((int32_t)difference * strength2) >> 15));
+		sum = (int32_t)((uint32_t)sum + (uint32_t)(kernel * buffer[j]));
+	}
+	return sum;
+}
+} // namespace
+
+TEST(WaveRenderKernels, windowedSincMatchesScalarModel) {
+	InterpolationBuffer interpolationBuffer;
+	std::array<std::array<int16_t, kInterpolationMaxNumSamples>, 2> flat;
+	for (int32_t c = 0; c < 2; c++) {
+		for (int32_t j = 0; j < kInterpolationMaxNumSamples; j++) {
+			flat[c][j] = (int16_t)((j * 4099 + c * 12345) ^ 0x5A5A);
+			interpolationBuffer[c][j >> 2][j & 3] = flat[c][j];
+		}
+	}
+
+	for (int32_t whichKernel : {0, 3, 6}) {
+		for (uint32_t oscPos : {0u, 0x00012345u, 0x00800000u, 0x00FFFFFFu}) {
+			int32_t sampleRead[2] = {0, 0};
+			interpolateUnderTest(sampleRead, 2, whichKernel, oscPos, interpolationBuffer);
+			CHECK_EQUAL(modelInterpolate(flat[0].data(), whichKernel, oscPos), sampleRead[0]);
+			CHECK_EQUAL(modelInterpolate(flat[1].data(), whichKernel, oscPos), sampleRead[1]);
+		}
+	}
+}
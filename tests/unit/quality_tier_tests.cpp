@@ -0,0 +1,43 @@
+#include "CppUTest/TestHarness.h"
+#include "processing/engines/quality_tier.h"
+#include <cmath>
+
+TEST_GROUP(QualityTier){};
+
+TEST(QualityTier, steppedDownThroughAsDirenessRises) {
+	CHECK(qualityTierForDireness(0) == QualityTier::FULL);
+	CHECK(qualityTierForDireness(14) == QualityTier::SMALL_TABLES);
+	for (int32_t direness = 1; direness <= 14; direness++) {
+		CHECK(qualityTierForDireness(direness) >= qualityTierForDireness(direness - 1));
+	}
+}
+
+TEST(QualityTier, fewerUnisonKeepsTheSpread) {
+	// Too few parts to thin out
+	CHECK_EQUAL(2, numUnisonPartsRenderedUnderLoad(2));
+
+	for (int32_t numUnison = 3; numUnison <= 8; numUnison++) {
+		// The outermost pair stays, so the spread is as wide as before
+		CHECK_FALSE(unisonPartSkippedUnderLoad(0, numUnison));
+		CHECK_FALSE(unisonPartSkippedUnderLoad(numUnison - 1, numUnison));
+		for (int32_t u = 0; u < numUnison; u++) {
+			CHECK_EQUAL(unisonPartSkippedUnderLoad(u, numUnison),
+			            unisonPartSkippedUnderLoad(numUnison - 1 - u, numUnison));
+		}
+		CHECK(numUnisonPartsRenderedUnderLoad(numUnison) < numUnison);
+	}
+	CHECK_EQUAL(4, numUnisonPartsRenderedUnderLoad(8));
+}
+
+TEST(QualityTier, fewerUnisonKeepsThePower) {
+	for (int32_t numUnison = 2; numUnison <= 8; numUnison++) {
+		double gain = unisonGainUnderLoad(numUnison) / 65536.0;
+		DOUBLES_EQUAL(numUnison, numUnisonPartsRenderedUnderLoad(numUnison) * gain * gain, 0.001);
+	}
+}
+
+TEST(QualityTier, smallTablesGoesUpAnOctave) {
+	CHECK_EQUAL(2000000u, phaseIncrementForTableUnderLoad(1000000));
+	// Saturates rather than wrapping round to a low note's table
+	CHECK_EQUAL(0x90000000u, phaseIncrementForTableUnderLoad(0x90000000u));
+}
@@ -3,7 +3,10 @@
 #include "OSLikeStuff/task_scheduler.cpp"
 #include "cstdint"
 #include "mocks/timer_mocks.h"
+#include <chrono>
+#include <iomanip>
 #include <iostream>
+#include <random>
 #include <stdlib.h>
 
 #ifdef _WIN32
@@ -175,8 +178,8 @@ TEST(Scheduler, tooManyTasks) {
 		addOnceTask(sleep_50ns, 0, 0.001, "sleep 50ns");
 	}
 
-	// run the scheduler for 10ms
-	taskManager.start(0.01);
+	// run the scheduler for long enough to get through all of them at 50us each
+	taskManager.start(0.001 + kMaxTasks * 0.0001);
 
 	mock().checkExpectations();
 };
@@ -233,4 +236,166 @@ TEST(Scheduler, overSchedule) {
 	mock().checkExpectations();
 };
 
+TEST(Scheduler, histogramBuckets) {
+	CHECK_EQUAL(0, Histogram::bucketFor(0));
+	CHECK_EQUAL(1, Histogram::bucketFor(1));
+	CHECK_EQUAL(2, Histogram::bucketFor(3));
+	CHECK_EQUAL(6, Histogram::bucketFor(50));
+	CHECK_EQUAL(Histogram::kNumBuckets - 1, Histogram::bucketFor(UINT32_MAX));
+	for (int32_t i = 1; i < Histogram::kNumBuckets - 1; i++) {
+		CHECK_EQUAL(i, Histogram::bucketFor(Histogram::bucketStart(i)));
+		CHECK_EQUAL(i - 1, Histogram::bucketFor(Histogram::bucketStart(i) - 1));
+	}
+};
+
+TEST(Scheduler, histogramsRecordDuration) {
+	mock().clear();
+	mock().expectNCalls(0.01 / 0.001 - 1, "sleep_50ns");
+	TaskID id = addRepeatingTask(sleep_50ns, 0, 0.001, 0.001, 0.001, "sleep_50ns");
+	taskManager.start(0.0095);
+	mock().checkExpectations();
+
+	auto& histograms = taskManager.list[id].histograms;
+	CHECK_EQUAL(9, histograms.duration.total());
+	// every call takes 50us
+	CHECK_EQUAL(9, histograms.duration.counts[Histogram::bucketFor(50)]);
+	// the first call has nothing to measure from
+	CHECK_EQUAL(8, histograms.lateness.total());
+	CHECK_EQUAL(0, histograms.maxIntervalMisses);
+};
+
+TEST(Scheduler, histogramsCountMaxIntervalMisses) {
+	mock().clear();
+	mock().expectNCalls(2, "sleep_2ms");
+	mock().expectNCalls(0.006 / 0.001, "sleep_50ns");
+	mock().expectNCalls(0.006 / 0.001, "sleep_20ns");
+
+	// same as overSchedule, the 2ms task makes the 1ms tasks miss their max interval
+	addRepeatingTask(sleep_50ns, 10, 0.001, 0.001, 0.001, "sleep 50ns");
+	auto tennshandle = addRepeatingTask(sleep_20ns, 0, 0.001, 0.001, 0.001, "sleep 20ns");
+	auto twomsHandle = addRepeatingTask(sleep_2ms, 100, 0.001, 0.002, 0.005, "sleep 2ms");
+	taskManager.start(0.0099);
+	mock().checkExpectations();
+
+	auto& starved = taskManager.list[tennshandle].histograms;
+	CHECK(starved.maxIntervalMisses > 0);
+	// it was at least a millisecond late while the 2ms task ran
+	CHECK(starved.lateness.maxMicroseconds >= 1000);
+	CHECK(starved.lateness.counts[Histogram::bucketFor(starved.lateness.maxMicroseconds)] > 0);
+	CHECK_EQUAL(2, taskManager.list[twomsHandle].histograms.duration.total());
+	CHECK(taskManager.list[twomsHandle].histograms.duration.maxMicroseconds >= 2000);
+
+	// dumping starts them again from empty
+	dumpTaskHistograms();
+	CHECK_EQUAL(0, starved.maxIntervalMisses);
+	CHECK_EQUAL(0, starved.duration.total());
+	CHECK_EQUAL(0, starved.lateness.maxMicroseconds);
+};
+
+std::mt19937 benchmarkRandom;
+
+template <int microseconds>
+void runFor() {
+	passMockTime(microseconds * 0.000001);
+}
+
+/// stands in for a UI timer or card access, which schedules its next run each time
+template <int microseconds>
+void runOnceFor() {
+	passMockTime(microseconds * 0.000001);
+	std::uniform_real_distribution<double> wait{0.01, 1.0};
+	addOnceTask(runOnceFor<microseconds>, 40 + benchmarkRandom() % 60, wait(benchmarkRandom), "once");
+}
+
+/// A mix shaped like the firmware's: a few fast high priority routines, some slower repeating ones and the rest once
+/// tasks re-adding themselves
+void addBenchmarkTasks(int32_t numTasks) {
+	std::uniform_real_distribution<double> interval{0.01, 0.5};
+	std::uniform_real_distribution<double> wait{0.01, 1.0};
+	addRepeatingTask(runFor<20>, 0, 0.00001, 16 / 44100., 24 / 44100., "audio");
+	addRepeatingTask(runFor<5>, 1, 0.0005, 0.001, 0.001, "encoders");
+	addRepeatingTask(runFor<10>, 2, 2 / 44100., 16 / 44100., 32 / 44100., "playback");
+	int32_t numRepeating = numTasks / 5;
+	for (int32_t i = 3; i < numRepeating; i++) {
+		double target = interval(benchmarkRandom);
+		// a few have a back off longer than their target, which blocks them while they're due and makes the
+		// scheduler look for something to fit in before them
+		double backOff = (i % 16 == 0) ? target * 2 : target / 2;
+		TaskHandle handle = (i % 2) ? runFor<50> : runFor<200>;
+		addRepeatingTask(handle, 3 + benchmarkRandom() % 30, backOff, target, target * 4, "repeating");
+	}
+	for (int32_t i = std::max(numRepeating, 3); i < numTasks; i++) {
+		TaskHandle handle = (i % 2) ? runOnceFor<10> : runOnceFor<100>;
+		addOnceTask(handle, 40 + benchmarkRandom() % 60, wait(benchmarkRandom), "once");
+	}
+}
+
+struct DecisionTimes {
+	double linearNs;
+	double queueNs;
+};
+
+/// Runs the scheduler loop by hand, making each decision with both the linear walk and the ready queue, whichever
+/// chooseBestTaskAt() would have used. They have to agree. Runs for warmUpTime seconds of mock time first, since everything is due at once when the tasks are first
+/// added, then returns the average time each took over numDecisions decisions.
+DecisionTimes compareDecisions(int32_t numTasks, double warmUpTime, int32_t numDecisions) {
+	using Clock = std::chrono::steady_clock;
+	taskManager = TaskManager();
+	benchmarkRandom.seed(numTasks);
+	// just to start the clock
+	taskManager.start(0.000001);
+	addBenchmarkTasks(numTasks);
+	CHECK_EQUAL(numTasks, taskManager.numRegisteredTasks);
+
+	double measureFrom = taskManager.getSecondsFromStart() + warmUpTime;
+	int32_t numMeasured = 0;
+	Clock::duration linearTime{0};
+	Clock::duration queueTime{0};
+	for (int32_t i = 0; numMeasured < numDecisions; i++) {
+		double now = taskManager.getSecondsFromStart();
+		// every so often choose with a deadline as well, as start() does when given a duration
+		double deadline = (i % 7 == 0) ? now + 0.0001 : -1;
+
+		auto started = Clock::now();
+		TaskID linear = taskManager.chooseBestTaskLinear(now, deadline);
+		auto linearDone = Clock::now();
+		TaskID chosen = taskManager.chooseBestTaskFromQueue(now, deadline);
+		auto queueDone = Clock::now();
+		if (now >= measureFrom) {
+			linearTime += linearDone - started;
+			queueTime += queueDone - linearDone;
+			numMeasured++;
+		}
+
+		CHECK_EQUAL(linear, chosen);
+		if (chosen >= 0) {
+			taskManager.runTask(chosen);
+		}
+		else {
+			passMockTime(0.00001);
+		}
+	}
+	CHECK_EQUAL(numTasks, taskManager.numRegisteredTasks);
+	return {
+	    .linearNs = std::chrono::duration<double, std::nano>(linearTime).count() / numDecisions,
+	    .queueNs = std::chrono::duration<double, std::nano>(queueTime).count() / numDecisions,
+	};
+}
+
+TEST(Scheduler, readyQueueMatchesLinearChoice) {
+	for (int32_t numTasks : {3, 7, 25, 60, 200}) {
+		compareDecisions(numTasks, 0, 5000);
+	}
+};
+
+TEST(Scheduler, decisionBenchmark) {
+	// the firmware's printf replacement isn't linked here
+	std::cout << "\ntasks    linear ns/decision    queue ns/decision\n";
+	for (int32_t numTasks : {10, 25, 100, 500}) {
+
+		DecisionTimes times = compareDecisions(numTasks, 1, 20000);
+		std::cout << std::left << std::setw(9) << numTasks << std::setw(22) << times.linearNs << times.queueNs << "\n";
+	}
+};
+
 } // namespace
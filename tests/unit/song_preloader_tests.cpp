@@ -0,0 +1,92 @@
+#include "CppUTest/TestHarness.h"
+#include "memory/general_memory_allocator.h"
+#include "model/song/song_preloader.h"
+#include "storage/cluster/cluster_priority_queue.h"
+#include <cstdint>
+
+using State = SongPreloader::State;
+
+namespace {
+
+// Never dereferenced - the queue only compares and stores them
+Cluster* fakeCluster(uintptr_t i) {
+	return reinterpret_cast<Cluster*>(0x1000 + i * 0x100);
+}
+
+/// The playing song's Clusters, with deadlines, and then the preloaded song's, which have none
+void enqueue(ClusterPriorityQueue& queue, int32_t numPlaying, int32_t numPreloaded) {
+	// Room for them all up front, as the mock allocator can't grow or shrink an allocation. The queue frees it
+	constexpr int32_t kSize = 32 * sizeof(PriorityQueueElement);
+	queue.setStaticMemory(delugeAlloc(kSize), kSize);
+	for (int32_t i = 0; i < numPreloaded; i++) {
+		queue.add(fakeCluster(100 + i), 0xFFFFFFFF);
+	}
+	for (int32_t i = 0; i < numPlaying; i++) {
+		queue.add(fakeCluster(i), 1000 + i * 10);
+	}
+}
+
+} // namespace
+
+TEST_GROUP(SongPreloader){};
+
+TEST(SongPreloader, missCountsNothing) {
+	ClusterPriorityQueue queue;
+	enqueue(queue, 3, 5);
+	SongPreloader::Readiness readiness = SongPreloader::getReadiness(false, State::READY, queue, 123456, 2.5);
+	CHECK_FALSE(readiness.hit);
+	CHECK_FALSE(readiness.samplesClaimed);
+	CHECK_FALSE(readiness.samplesLoaded);
+	CHECK_EQUAL(0, readiness.clustersStillQueued);
+	CHECK_EQUAL(0, readiness.bytesUsed);
+	CHECK_EQUAL(0, readiness.msSaved);
+}
+
+TEST(SongPreloader, readinessFollowsHowFarItGot) {
+	struct {
+		State reached;
+		bool samplesClaimed;
+		bool samplesLoaded;
+	} const kCases[] = {
+	    {State::READ, false, false},
+	    {State::CLAIMED_SAMPLES, true, false},
+	    {State::LOADING_SAMPLES, true, false},
+	    {State::READY, true, true},
+	};
+	for (auto const& c : kCases) {
+		ClusterPriorityQueue queue;
+		enqueue(queue, 0, 0);
+		SongPreloader::Readiness readiness = SongPreloader::getReadiness(true, c.reached, queue, 4096, 0.75);
+		CHECK(readiness.hit);
+		CHECK_EQUAL(c.samplesClaimed, readiness.samplesClaimed);
+		CHECK_EQUAL(c.samplesLoaded, readiness.samplesLoaded);
+		CHECK_EQUAL(4096, readiness.bytesUsed);
+		CHECK_EQUAL(750, readiness.msSaved);
+	}
+}
+
+// Only the Clusters with no deadline are the preloaded song's, however many the playing song has queued ahead of them
+TEST(SongPreloader, countsOnlyClustersWithoutDeadline) {
+	struct {
+		int32_t numPlaying;
+		int32_t numPreloaded;
+	} const kCases[] = {{0, 0}, {4, 0}, {0, 6}, {7, 3}, {1, 20}};
+	for (auto const& c : kCases) {
+		ClusterPriorityQueue queue;
+		enqueue(queue, c.numPlaying, c.numPreloaded);
+		SongPreloader::Readiness readiness = SongPreloader::getReadiness(true, State::LOADING_SAMPLES, queue, 0, 0);
+		CHECK_EQUAL(c.numPreloaded, readiness.clustersStillQueued);
+	}
+}
+
+// As the loader takes Clusters off the front, the count only goes down once it reaches the preloaded song's
+TEST(SongPreloader, countFallsAsClustersLoad) {
+	ClusterPriorityQueue queue;
+	enqueue(queue, 2, 3);
+	int32_t expected[] = {3, 3, 3, 2, 1};
+	for (int32_t want : expected) {
+		CHECK_EQUAL(want, SongPreloader::getReadiness(true, State::LOADING_SAMPLES, queue, 0, 0).clustersStillQueued);
+		queue.grabHead();
+	}
+	CHECK_EQUAL(0, SongPreloader::getReadiness(true, State::READY, queue, 0, 0).clustersStillQueued);
+}
@@ -0,0 +1,157 @@
+#include "CppUTest/TestHarness.h"
+#include "card_access.h"
+#include "storage/audio/audio_file_manager.h"
+#include <array>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+using namespace deluge::bench;
+
+namespace {
+
+// A small FAT16 volume of 4kB Clusters - room enough, and quick to format
+constexpr uint32_t kSectorsPerCluster = 8;
+constexpr uint32_t kNumClusters = 8192;
+
+} // namespace
+
+TEST_GROUP(SDImage){};
+
+// Samples come back intact, Cluster for Cluster, through the same path a library load takes
+TEST(SDImage, streamedSamplesMatchWhatWasWritten) {
+	FatImage image(kNumClusters, kSectorsPerCluster);
+	std::array<std::string_view, 2> paths = {"A.WAV", "B.WAV"};
+	image.writeInterleaved(paths, 64);
+
+	for (int32_t f = 0; f < 2; f++) {
+		int32_t numClusters = 0;
+		streamSample(image, std::string(paths[f]), [&](int32_t c, const uint8_t* data) {
+			CHECK_EQUAL(FatImage::patternByte(f, c), data[0]);
+			CHECK_EQUAL(FatImage::patternByte(f, c), data[image.clusterSize() - 1]);
+			numClusters++;
+		});
+		CHECK_EQUAL(64, numClusters);
+	}
+}
+
+TEST_GROUP(SongTwin){};
+
+// Every kind of value the writers produce reads back as the same text, and a twin stops being used once its XML
+// changes
+TEST(SongTwin, twinMatchesItsXML) {
+	SongCard card(kNumClusters, kSectorsPerCluster);
+	CHECK_EQUAL(FR_OK, f_mkdir("SONGS"));
+	char const* path = "SONGS/EDGES.XML";
+	uint8_t bytes[300];
+	for (int32_t i = 0; i < 300; i++) {
+		bytes[i] = i * 7;
+	}
+
+	{
+		XMLSerializer writer;
+		CHECK_EQUAL(FR_OK, f_open(&fileSystemStuff.currentFile, path, FA_CREATE_ALWAYS | FA_WRITE));
+		writer.fileWriteBufferCurrentPos = 0;
+		writer.fileTotalBytesWritten = 0;
+		writer.fileAccessFailedDuringWrite = false;
+		writer.write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+		writer.indentAmount = 0;
+		writer.writeOpeningTagBeginning("song");
+		writer.writeAttribute("firmwareVersion", "4.1.4");
+		writer.writeAttributeHex("saveToken", 0x1234ABCD, 8);
+		writer.writeAttribute("negative", -2147483647 - 1);
+		writer.writeAttribute("leadingZero", "007");
+		writer.writeAttribute("plus", "+5");
+		writer.writeAttribute("empty", "");
+		writer.writeAttributeHex("shortHex", 0xA, 2);
+		writer.writeAttribute("lowerHex", "0xdeadbeef");
+		writer.writeAttributeHexBytes("hexBytes", bytes, 300);
+		writer.writeAttribute("oddHex", "0x123456789ABCDEF01");
+		writer.writeAttribute("mixedCase", "0x0123456789abcdefABCDEF");
+		writer.writeOpeningTagEnd();
+		writer.writeTag("number", 42);
+		writer.writeTag("text", "hello there");
+		writer.writeOpeningTag("nested");
+		writer.writeOpeningTagBeginning("leaf");
+		writer.writeAttribute("name", "KIT001");
+		writer.closeTag();
+		writer.writeClosingTag("nested");
+		writer.writeClosingTag("song");
+		CHECK(writer.closeFileAfterWriting(path) == Error::NONE);
+		f_close(&fileSystemStuff.currentFile);
+	}
+
+	StorageManager storage;
+	XMLDeserializer xmlReader;
+	BinarySerializer binaryWriter;
+	BinaryDeserializer binaryReader;
+	CHECK(writeTwin(storage, path, xmlReader, binaryWriter) == Error::NONE);
+
+	Walk fromXML = walkXML(storage, xmlReader, path);
+	Walk fromBinary = walkBinary(storage, binaryReader, path);
+	CHECK_EQUAL(fromXML.numNames, fromBinary.numNames);
+	CHECK_EQUAL(fromXML.numValueChars, fromBinary.numValueChars);
+	CHECK(fromXML.hash == fromBinary.hash);
+
+	// The same values as numbers
+	FilePointer filePointer = filePointerFor(twinPathOf(path).c_str());
+	BinaryFileSource source = sourceOf(path);
+	binaryReader.msd = &storage;
+	CHECK(binaryReader.openBinaryFile(&filePointer, "song", "", false, &source) == Error::NONE);
+	char const* name;
+	while (*(name = binaryReader.readNextTagOrAttributeName())) {
+		if (!strcmp(name, "negative")) {
+			CHECK_EQUAL(-2147483647 - 1, binaryReader.readTagOrAttributeValueInt());
+		}
+		else if (!strcmp(name, "shortHex")) {
+			CHECK_EQUAL(0xA, binaryReader.readTagOrAttributeValueHex(-1));
+		}
+		else if (!strcmp(name, "hexBytes")) {
+			uint8_t read[300];
+			CHECK_EQUAL(300, binaryReader.readTagOrAttributeValueHexBytes(read, 300));
+			CHECK_EQUAL(0, memcmp(read, bytes, 300));
+		}
+		else if (!strcmp(name, "number")) {
+			CHECK_EQUAL(42, binaryReader.readTagOrAttributeValueInt());
+		}
+		binaryReader.exitTag(name);
+	}
+	f_close(&fileSystemStuff.currentFile);
+
+	// Re-save the XML at the same size, as another firmware might, and the twin's no longer it
+	FIL file;
+	UINT written;
+	BinaryFileSource before = sourceOf(path);
+	CHECK_EQUAL(0x1234ABCD, before.saveToken);
+	CHECK_EQUAL(FR_OK, f_open(&file, path, FA_READ | FA_WRITE));
+	char head[128];
+	UINT numRead;
+	CHECK_EQUAL(FR_OK, f_read(&file, head, sizeof(head), &numRead));
+	char* token = (char*)memmem(head, numRead, "1234ABCD", 8);
+	CHECK(token);
+	CHECK_EQUAL(FR_OK, f_lseek(&file, token - head));
+	CHECK_EQUAL(FR_OK, f_write(&file, "5678", 4, &written));
+	CHECK_EQUAL(FR_OK, f_close(&file));
+	source = sourceOf(path);
+	CHECK_EQUAL(before.size, source.size);
+	CHECK_EQUAL(0x5678ABCD, source.saveToken);
+	filePointer = filePointerFor(twinPathOf(path).c_str());
+	CHECK(binaryReader.openBinaryFile(&filePointer, "song", "", false, &source) != Error::NONE);
+	f_close(&fileSystemStuff.currentFile);
+
+	// Change the XML's size, and likewise
+	CHECK_EQUAL(FR_OK, f_open(&file, path, FA_OPEN_APPEND | FA_WRITE));
+	CHECK_EQUAL(FR_OK, f_write(&file, "\n", 1, &written));
+	CHECK_EQUAL(FR_OK, f_close(&file));
+	source = sourceOf(path);
+	filePointer = filePointerFor(twinPathOf(path).c_str());
+	CHECK(binaryReader.openBinaryFile(&filePointer, "song", "", false, &source) != Error::NONE);
+	f_close(&fileSystemStuff.currentFile);
+	// And one with no saveToken at all, which a firmware that doesn't make twins would save, can't have one
+	CHECK_EQUAL(FR_OK, f_open(&file, path, FA_CREATE_ALWAYS | FA_WRITE));
+	char const* untokened = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	                        "<song\n\tfirmwareVersion=\"4.1.4\">\n</song>\n";
+	CHECK_EQUAL(FR_OK, f_write(&file, untokened, strlen(untokened), &written));
+	CHECK_EQUAL(FR_OK, f_close(&file));
+	CHECK(getBinaryFileSource(path, &source) == Error::FILE_UNSUPPORTED);
+}
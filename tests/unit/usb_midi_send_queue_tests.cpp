@@ -0,0 +1,370 @@
+#include "CppUTest/TestHarness.h"
+#include "io/midi/midi_running_status.h"
+#include "io/midi/usb_midi_send_queue.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+namespace {
+
+// What ConnectedUSBMIDIDevice::consumeSendData() takes per transfer, and about how often a transfer completes when
+// there's a steady stream to send
+constexpr int32_t kTransferIntervalUs = 1000;
+
+/// A message as setupUSBMessage() packs it, on virtual cable 0
+uint32_t usbMessage(uint8_t statusType, uint8_t channel, uint8_t data1, uint8_t data2) {
+	uint8_t statusByte = (statusType << 4) | channel;
+	uint8_t cin = (statusByte == 0xF2) ? 0x03 : statusType;
+	return ((uint32_t)data2 << 24) | ((uint32_t)data1 << 16) | ((uint32_t)statusByte << 8) | cin;
+}
+
+uint32_t cc(uint8_t channel, uint8_t controller, uint8_t value) {
+	return usbMessage(0x0B, channel, controller, value);
+}
+
+uint32_t noteOn(uint8_t channel, uint8_t note) {
+	return usbMessage(0x09, channel, note, 100);
+}
+
+constexpr uint32_t kClock = 0xF80F;
+
+uint8_t getStatusByte(uint32_t message) {
+	return message >> 8;
+}
+
+std::vector<uint32_t> popAll(USBMIDISendQueue& queue) {
+	std::vector<uint32_t> messages;
+	uint32_t data[MIDI_SEND_BUFFER_LEN_INNER];
+	while (int32_t n = queue.pop((uint8_t*)data, MIDI_SEND_BUFFER_LEN_INNER)) {
+		messages.insert(messages.end(), data, data + n);
+	}
+	return messages;
+}
+
+struct TimedMessage {
+	int32_t timeUs;
+	uint32_t message;
+};
+
+/*
+ * A second of what goes out to a USB device during a busy stretch: MIDI follow feedback from 16 params being swept
+ * at once, each reporting its value every 250us, for 300ms; the controller's own CC echo throughout; a note every
+ * 50ms; and MIDI clock at 120bpm.
+ */
+std::vector<TimedMessage> makeBurst() {
+	std::vector<TimedMessage> messages;
+	for (int32_t t = 0; t < 1000000; t += 250) {
+		if (t >= 100000 && t < 400000) {
+			for (uint8_t p = 0; p < 16; p++) {
+				messages.push_back({t, cc(15, 20 + p, (uint8_t)((t / 250 + p * 8) & 127))});
+			}
+		}
+		if (t % 2000 == 0) {
+			messages.push_back({t, cc(0, 74, (uint8_t)((t / 2000) & 127))});
+		}
+		if (t % 50000 == 0) {
+			messages.push_back({t, noteOn(1, (uint8_t)(36 + (t / 50000) % 24))});
+		}
+		if (t % 20750 == 0) {
+			messages.push_back({t, kClock});
+		}
+	}
+	return messages;
+}
+
+struct BurstResult {
+	int32_t numSent = 0;
+	int32_t numDropped = 0;
+	int32_t numCoalesced = 0;
+	int32_t numNotesSent = 0;
+	int32_t maxClockDelayUs = 0;
+	int32_t numStaleControllers = 0; // Whose last value sent isn't the last one they were given
+};
+
+/// The messages go in as they're timed, and out MIDI_SEND_BUFFER_LEN_INNER at a time, a transfer every millisecond
+template <typename Push, typename Pop>
+BurstResult replay(std::vector<TimedMessage> const& messages, Push&& push, Pop&& pop) {
+	BurstResult result;
+	std::deque<int32_t> clockTimes;
+	uint8_t lastValueGiven[16][128]{};
+	uint8_t lastValueSent[16][128]{};
+	uint32_t data[MIDI_SEND_BUFFER_LEN_INNER];
+
+	auto transfer = [&](int32_t timeUs) {
+		int32_t n = pop((uint8_t*)data, MIDI_SEND_BUFFER_LEN_INNER);
+		for (int32_t i = 0; i < n; i++) {
+			uint32_t message = data[i];
+			uint8_t status = getStatusByte(message);
+			result.numSent++;
+			if (status == 0xF8) {
+				result.maxClockDelayUs = std::max(result.maxClockDelayUs, timeUs - clockTimes.front());
+				clockTimes.pop_front();
+			}
+			else if ((status >> 4) == 0x09) {
+				result.numNotesSent++;
+			}
+			else if ((status >> 4) == 0x0B) {
+				lastValueSent[status & 15][(message >> 16) & 127] = message >> 24;
+			}
+		}
+	};
+
+	int32_t nextTransferUs = kTransferIntervalUs;
+	for (TimedMessage const& timed : messages) {
+		for (; nextTransferUs <= timed.timeUs; nextTransferUs += kTransferIntervalUs) {
+			transfer(nextTransferUs);
+		}
+		uint32_t message = timed.message;
+		uint8_t status = getStatusByte(message);
+		if (status == 0xF8) {
+			clockTimes.push_back(timed.timeUs);
+		}
+		else if ((status >> 4) == 0x0B) {
+			lastValueGiven[status & 15][(message >> 16) & 127] = message >> 24;
+		}
+		push(message);
+	}
+	for (int32_t i = 0; i < 2000; i++, nextTransferUs += kTransferIntervalUs) {
+		transfer(nextTransferUs);
+	}
+
+	for (int32_t channel = 0; channel < 16; channel++) {
+		for (int32_t controller = 0; controller < 128; controller++) {
+			result.numStaleControllers += lastValueGiven[channel][controller] != lastValueSent[channel][controller];
+		}
+	}
+	return result;
+}
+
+/// What ConnectedUSBMIDIDevice kept before: one ring, first in first out, dropping whatever doesn't fit
+struct PlainRing {
+	uint32_t ring[MIDI_SEND_BUFFER_LEN_RING];
+	uint32_t writeIdx = 0;
+	uint32_t readIdx = 0;
+	int32_t numDropped = 0;
+
+	void push(uint32_t message) {
+		if (writeIdx - readIdx >= MIDI_SEND_BUFFER_LEN_RING) {
+			numDropped++;
+			return;
+		}
+		ring[writeIdx++ & MIDI_SEND_RING_MASK] = message;
+	}
+	int32_t pop(uint8_t* data, int32_t maxNumMessages) {
+		int32_t n = std::min<uint32_t>(writeIdx - readIdx, maxNumMessages);
+		for (int32_t i = 0; i < n; i++) {
+			memcpy(data + i * 4, &ring[readIdx++ & MIDI_SEND_RING_MASK], 4);
+		}
+		return n;
+	}
+};
+
+} // namespace
+
+TEST_GROUP(USBMIDISendQueue){};
+
+// A CC for a controller that's still waiting just updates its value, where it is in the queue
+TEST(USBMIDISendQueue, coalescesWaitingCC) {
+	USBMIDISendQueue queue;
+	queue.clear();
+	for (uint8_t i = 0; i < MIDI_SEND_BUFFER_LEN_INNER; i++) {
+		queue.push(noteOn(0, i));
+	}
+	queue.push(cc(3, 74, 1));
+	queue.push(cc(3, 71, 1));
+	queue.push(cc(3, 74, 2));
+	queue.push(cc(3, 74, 3));
+	queue.push(cc(4, 74, 4)); // Another channel
+
+	CHECK_EQUAL(MIDI_SEND_BUFFER_LEN_INNER + 3, queue.getNumQueued());
+	CHECK_EQUAL(2, queue.numCoalesced);
+	CHECK_EQUAL(0, queue.numDropped);
+
+	std::vector<uint32_t> sent = popAll(queue);
+	CHECK_EQUAL(MIDI_SEND_BUFFER_LEN_INNER + 3, sent.size());
+	CHECK_EQUAL(cc(3, 74, 3), sent[MIDI_SEND_BUFFER_LEN_INNER]);
+	CHECK_EQUAL(cc(3, 71, 1), sent[MIDI_SEND_BUFFER_LEN_INNER + 1]);
+	CHECK_EQUAL(cc(4, 74, 4), sent[MIDI_SEND_BUFFER_LEN_INNER + 2]);
+
+	// And once it's gone, the next one queues again
+	queue.push(cc(3, 74, 5));
+	CHECK_EQUAL(1, queue.getNumQueued());
+}
+
+// Never across a note on the same channel, which a sequenced clip's CC has to stay before or after
+TEST(USBMIDISendQueue, keepsCCsInOrderWithNotes) {
+	USBMIDISendQueue queue;
+	queue.clear();
+	for (uint8_t i = 0; i < MIDI_SEND_BUFFER_LEN_INNER; i++) {
+		queue.push(noteOn(15, i));
+	}
+	queue.push(cc(3, 74, 1));
+	queue.push(noteOn(4, 60)); // Another channel doesn't matter
+	queue.push(cc(3, 74, 2));
+	queue.push(noteOn(3, 60));
+	queue.push(cc(3, 74, 3));
+	queue.push(cc(3, 74, 4)); // But this can update the one just after the note
+
+	CHECK_EQUAL(2, queue.numCoalesced);
+	std::vector<uint32_t> sent = popAll(queue);
+	CHECK_EQUAL(MIDI_SEND_BUFFER_LEN_INNER + 4, sent.size());
+	CHECK_EQUAL(cc(3, 74, 2), sent[MIDI_SEND_BUFFER_LEN_INNER]);
+	CHECK_EQUAL(noteOn(4, 60), sent[MIDI_SEND_BUFFER_LEN_INNER + 1]);
+	CHECK_EQUAL(noteOn(3, 60), sent[MIDI_SEND_BUFFER_LEN_INNER + 2]);
+	CHECK_EQUAL(cc(3, 74, 4), sent[MIDI_SEND_BUFFER_LEN_INNER + 3]);
+}
+
+// Not what the USB interrupt might be taking right now, and not CCs that mean nothing on their own
+TEST(USBMIDISendQueue, leavesWhatMustNotBeCoalesced) {
+	USBMIDISendQueue queue;
+	queue.clear();
+	queue.push(cc(0, 74, 1));
+	queue.push(cc(0, 74, 2));
+	CHECK_EQUAL(2, queue.getNumQueued());
+
+	for (uint8_t i = 0; i < MIDI_SEND_BUFFER_LEN_INNER; i++) {
+		queue.push(noteOn(0, i));
+	}
+	for (int32_t i = 0; i < 2; i++) {
+		queue.push(cc(0, 101, 0)); // RPN MSB
+		queue.push(cc(0, 100, 0)); // RPN LSB
+		queue.push(cc(0, 6, 12));  // Data entry
+		queue.push(cc(0, 0, 1));   // Bank select
+		queue.push(cc(0, 123, 0)); // All notes off
+	}
+	CHECK_EQUAL(0, queue.numCoalesced);
+	CHECK_EQUAL(2 + MIDI_SEND_BUFFER_LEN_INNER + 10, queue.getNumQueued());
+}
+
+// Clock goes out ahead of anything already waiting. Song position isn't realtime, so it waits its turn
+TEST(USBMIDISendQueue, clockJumpsTheQueue) {
+	USBMIDISendQueue queue;
+	queue.clear();
+	queue.push(noteOn(0, 60));
+	queue.push(cc(0, 74, 1));
+	queue.push(usbMessage(0x0F, 2, 0x10, 0x00)); // Song position pointer
+	queue.push(kClock);
+
+	std::vector<uint32_t> sent = popAll(queue);
+	CHECK_EQUAL(4, sent.size());
+	CHECK_EQUAL(kClock, sent[0]);
+	CHECK_EQUAL(noteOn(0, 60), sent[1]);
+	CHECK_EQUAL(cc(0, 74, 1), sent[2]);
+	CHECK_EQUAL(0xF2, getStatusByte(sent[3]));
+	CHECK_EQUAL(0x03, sent[3] & 0x0F);
+}
+
+// Feedback stops getting queued once the queue's mostly full, leaving the rest for notes; past that, nothing does
+TEST(USBMIDISendQueue, dropsFeedbackFirst) {
+	USBMIDISendQueue queue;
+	queue.clear();
+	constexpr uint32_t kFeedbackLimit = MIDI_SEND_BUFFER_LEN_RING * 3 / 4;
+	for (uint32_t i = 0; i < kFeedbackLimit; i++) {
+		queue.push(noteOn(i % 16, i % 128));
+	}
+	queue.push(cc(0, 74, 1));
+	queue.push(usbMessage(0x0E, 0, 0, 64)); // Pitch bend
+	CHECK_EQUAL(2, queue.numDropped);
+	CHECK_EQUAL(kFeedbackLimit, queue.getNumQueued());
+
+	while (queue.getSpace()) {
+		queue.push(noteOn(0, 60));
+	}
+	queue.push(noteOn(0, 61));
+	CHECK_EQUAL(3, queue.numDropped);
+	CHECK_EQUAL(MIDI_SEND_BUFFER_LEN_RING, queue.getNumQueued());
+
+	// The clock still has room of its own
+	queue.push(kClock);
+	CHECK_EQUAL(MIDI_SEND_BUFFER_LEN_RING + 1, queue.getNumQueued());
+	for (int32_t i = 1; i < MIDI_SEND_BUFFER_LEN_PRIORITY; i++) {
+		queue.push(kClock);
+	}
+	queue.push(kClock);
+	CHECK_EQUAL(4, queue.numDropped);
+
+	std::vector<uint32_t> sent = popAll(queue);
+	CHECK_EQUAL(MIDI_SEND_BUFFER_LEN_RING + MIDI_SEND_BUFFER_LEN_PRIORITY, sent.size());
+	CHECK_EQUAL(0, queue.getNumQueued());
+}
+
+// Channel messages leave out a repeated status byte, but not forever, and not across anything else
+TEST(USBMIDISendQueue, serialRunningStatus) {
+	MIDIRunningStatus runningStatus;
+	CHECK(runningStatus.needsStatusByte(0xB0));
+	CHECK(!runningStatus.needsStatusByte(0xB0));
+	CHECK(runningStatus.needsStatusByte(0xF8)); // Clock in between goes out, and changes nothing...
+	CHECK(!runningStatus.needsStatusByte(0xB0));
+	CHECK(runningStatus.needsStatusByte(0xB1));
+	CHECK(runningStatus.needsStatusByte(0xF2)); // ...but song position does
+	CHECK(runningStatus.needsStatusByte(0xB1));
+	runningStatus.cancel();
+	CHECK(runningStatus.needsStatusByte(0xB1));
+
+	int32_t numSent = 0;
+	for (int32_t i = 0; i < 100; i++) {
+		numSent += runningStatus.needsStatusByte(0xB1);
+	}
+	CHECK_EQUAL(100 / (MIDIRunningStatus::kMaxNumOmitted + 1), numSent);
+}
+
+// A second with a burst of MIDI follow feedback in it, replayed into what ConnectedUSBMIDIDevice used to queue
+// messages in and into USBMIDISendQueue, both emptied a transfer at a time. Then the same messages down the DIN port,
+// with and without running status
+TEST(USBMIDISendQueue, feedbackBurst) {
+	std::vector<TimedMessage> messages = makeBurst();
+	int32_t numNotes = 0;
+	for (TimedMessage const& timed : messages) {
+		numNotes += (getStatusByte(timed.message) >> 4) == 0x09;
+	}
+
+	PlainRing* plain = new PlainRing;
+	BurstResult before = replay(
+	    messages, [&](uint32_t message) { plain->push(message); },
+	    [&](uint8_t* data, int32_t max) { return plain->pop(data, max); });
+	before.numDropped = plain->numDropped;
+	delete plain;
+
+	USBMIDISendQueue* queue = new USBMIDISendQueue;
+	queue->clear();
+	BurstResult after = replay(
+	    messages, [&](uint32_t message) { queue->push(message); },
+	    [&](uint8_t* data, int32_t max) { return queue->pop(data, max); });
+	after.numDropped = queue->numDropped;
+	after.numCoalesced = queue->numCoalesced;
+	delete queue;
+
+	// Nothing lost that matters, every controller ends up where it was left, and the clock's never held up behind a
+	// whole transfer
+	CHECK_EQUAL(0, after.numDropped);
+	CHECK_EQUAL(numNotes, after.numNotesSent);
+	CHECK_EQUAL(0, after.numStaleControllers);
+	CHECK(after.maxClockDelayUs <= kTransferIntervalUs);
+	CHECK(after.numCoalesced > 0);
+	CHECK(before.numDropped > 0);
+
+	// The same down the DIN port
+	int32_t numBytesFull = 0;
+	int32_t numBytesRunning = 0;
+	MIDIRunningStatus runningStatus;
+	for (TimedMessage const& timed : messages) {
+		uint8_t status = getStatusByte(timed.message);
+		int32_t length = (status >= 0xF8) ? 1 : 3;
+		numBytesFull += length;
+		numBytesRunning += length - !runningStatus.needsStatusByte(status);
+	}
+	CHECK(numBytesRunning < numBytesFull);
+
+	printf("\n%zu messages in a second, %d of them notes, a transfer of up to %d every %dus\n", messages.size(),
+	       numNotes, MIDI_SEND_BUFFER_LEN_INNER, kTransferIntervalUs);
+	printf("%12s %10s %10s %10s %10s %16s %18s\n", "", "sent", "dropped", "coalesced", "notes", "max clock delay",
+	       "stale controllers");
+	for (auto [name, result] : {std::pair{"plain ring", before}, std::pair{"send queue", after}}) {
+		printf("%12s %10d %10d %10d %10d %14dus %18d\n", name, result.numSent, result.numDropped, result.numCoalesced,
+		       result.numNotesSent, result.maxClockDelayUs, result.numStaleControllers);
+	}
+	printf("DIN: %d bytes, %d with running status, %.0f%% fewer\n", numBytesFull, numBytesRunning,
+	       100.0 - numBytesRunning * 100.0 / numBytesFull);
+}
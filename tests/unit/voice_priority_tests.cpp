@@ -0,0 +1,194 @@
+#include "CppUTest/TestHarness.h"
+#include "model/voice/voice_priority_index.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Enough of a Sound and a Voice for Voice::getPriorityRating(), allocated separately like the real ones so the linear
+// walk pays for chasing pointers the way cullVoice() used to
+struct FakeSound {
+	uint32_t voicePriority;
+	int32_t numVoicesAssigned;
+};
+
+struct FakeVoice {
+	FakeSound* sound;
+	uint32_t envelopeState;
+	uint32_t timeEnteredState;
+	uint32_t fastReleaseIncrement;
+	int16_t slot;
+
+	[[nodiscard]] uint32_t rating() const {
+		return ((3 - sound->voicePriority) << 30) + ((uint32_t)std::min(sound->numVoicesAssigned, 7) << 27)
+		       + (envelopeState << 24) + ((uint32_t)(-timeEnteredState) & (0xFFFFFFFF >> 8));
+	}
+	[[nodiscard]] bool softCullable() const { return envelopeState <= 4 && fastReleaseIncrement < 65536; }
+	[[nodiscard]] Voice* asVoice() { return reinterpret_cast<Voice*>(this); }
+};
+
+class VoicePool {
+public:
+	explicit VoicePool(uint32_t seed) : random_(seed) {
+		for (auto& sound : sounds_) {
+			sound = std::make_unique<FakeSound>(FakeSound{(uint32_t)random_() % 3, 0});
+		}
+	}
+
+	void add() {
+		auto voice = std::make_unique<FakeVoice>();
+		voice->sound = sounds_[random_() % sounds_.size()].get();
+		voice->sound->numVoicesAssigned++;
+		voice->slot = index.add(voice->asVoice());
+		voices.push_back(std::move(voice));
+		change(*voices.back());
+		refreshAll();
+	}
+
+	void removeAt(size_t v) {
+		index.remove(voices[v]->slot);
+		voices[v]->sound->numVoicesAssigned--;
+		voices.erase(voices.begin() + v);
+		refreshAll();
+	}
+
+	// what happens to a voice between culls: its envelope moves on a stage, or gets fast-released
+	void change(FakeVoice& voice) {
+		voice.envelopeState = random_() % 6;
+		voice.timeEnteredState = nextVoiceState_++;
+		voice.fastReleaseIncrement = (random_() % 4) ? 4096 : 65536;
+		index.update(voice.slot, voice.rating(), voice.softCullable());
+	}
+
+	// a Sound's voice count feeds every one of its voices' ratings
+	void refreshAll() {
+		for (auto& voice : voices) {
+			index.update(voice->slot, voice->rating(), voice->softCullable());
+		}
+	}
+
+	[[nodiscard]] FakeVoice* linearChoice(bool softCullableOnly) const {
+		uint32_t bestRating = 0;
+		FakeVoice* best = nullptr;
+		for (auto& voice : voices) {
+			uint32_t rating = voice->rating();
+			if (rating > bestRating && (!softCullableOnly || voice->softCullable())) {
+				bestRating = rating;
+				best = voice.get();
+			}
+		}
+		return best;
+	}
+
+	uint32_t random() { return random_(); }
+
+	VoicePriorityIndex index;
+	std::vector<std::unique_ptr<FakeVoice>> voices;
+
+private:
+	std::mt19937 random_;
+	std::array<std::unique_ptr<FakeSound>, 12> sounds_;
+	uint32_t nextVoiceState_ = 1;
+};
+
+void checkMatchesLinear(VoicePool& pool) {
+	for (bool softCullableOnly : {false, true}) {
+		FakeVoice* expected = pool.linearChoice(softCullableOnly);
+		Voice* actual = pool.index.highest(softCullableOnly);
+		if (expected == nullptr) {
+			POINTERS_EQUAL(nullptr, actual);
+		}
+		else {
+			CHECK(actual != nullptr);
+			CHECK_EQUAL(expected->rating(), reinterpret_cast<FakeVoice*>(actual)->rating());
+		}
+	}
+}
+
+} // namespace
+
+TEST_GROUP(VoicePriorityIndex){};
+
+TEST(VoicePriorityIndex, matchesLinearWalk) {
+	VoicePool pool(1234);
+	for (int32_t step = 0; step < 20000; step++) {
+		uint32_t action = pool.random() % 8;
+		// hover around 64-256 voices, with a few trips to empty
+		if (pool.voices.empty() || (action == 0 && pool.voices.size() < 256)) {
+			pool.add();
+		}
+		else if (action == 1 || (step % 2000) > 1800) {
+			pool.removeAt(pool.random() % pool.voices.size());
+		}
+		else {
+			pool.change(*pool.voices[pool.random() % pool.voices.size()]);
+		}
+		checkMatchesLinear(pool);
+	}
+}
+
+TEST(VoicePriorityIndex, overflowIsReported) {
+	VoicePool pool(99);
+	for (int32_t v = 0; v < VoicePriorityIndex::kNumSlots; v++) {
+		pool.add();
+	}
+	CHECK(pool.index.isComplete());
+
+	pool.add();
+	CHECK_EQUAL(VoicePriorityIndex::kNotIndexed, pool.voices.back()->slot);
+	CHECK_FALSE(pool.index.isComplete());
+
+	pool.removeAt(pool.voices.size() - 1);
+	CHECK(pool.index.isComplete());
+	checkMatchesLinear(pool);
+}
+
+TEST(VoicePriorityIndex, cullDecisionBenchmark) {
+	using Clock = std::chrono::steady_clock;
+	constexpr int32_t kNumDecisions = 20000;
+
+	std::cout << "\nvoices   linear ns/decision    index ns/decision    index ns/update\n";
+	for (int32_t numVoices : {64, 128, 256}) {
+		VoicePool pool(numVoices);
+		for (int32_t v = 0; v < numVoices; v++) {
+			pool.add();
+		}
+
+		// Each decision is followed by the chosen voice changing, as it would once culled. The index pays for that
+		// update, which is timed separately, while the linear walk doesn't need one.
+		Clock::duration linearTime{0};
+		Clock::duration indexTime{0};
+		Clock::duration updateTime{0};
+		uint32_t checksum = 0;
+		for (int32_t d = 0; d < kNumDecisions; d++) {
+			bool softCullableOnly = d & 1;
+			auto started = Clock::now();
+			FakeVoice* linear = pool.linearChoice(softCullableOnly);
+			auto linearDone = Clock::now();
+			auto* indexed = reinterpret_cast<FakeVoice*>(pool.index.highest(softCullableOnly));
+			auto indexDone = Clock::now();
+			if (indexed) {
+				indexed->envelopeState = (indexed->envelopeState + 1) % 6;
+				indexed->timeEnteredState += d;
+				pool.index.update(indexed->slot, indexed->rating(), indexed->softCullable());
+			}
+			auto updateDone = Clock::now();
+
+			linearTime += linearDone - started;
+			indexTime += indexDone - linearDone;
+			updateTime += updateDone - indexDone;
+			checksum += linear ? linear->rating() : 0;
+		}
+		CHECK(checksum != 0);
+
+		auto perDecision = [](Clock::duration time) {
+			return std::chrono::duration<double, std::nano>(time).count() / kNumDecisions;
+		};
+		std::cout << std::left << std::setw(9) << numVoices << std::setw(22) << perDecision(linearTime)
+		          << std::setw(21) << perDecision(indexTime) << perDecision(updateTime) << "\n";
+	}
+}